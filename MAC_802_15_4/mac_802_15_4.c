@@ -159,31 +159,33 @@ aes_results_e rx_aes_802_15_4(mac_frame_802_15_4_format_t *mac_frame_ptr, uint16
     uint8_t             nonce[13];
     int8_t              status;
     int16_t             payload_len;
-    uint64_t            src_addr,dst_addr;
-    security_state_e    security_state;
+    mac_frame_view_t    view;
 
     /* the length of frame needs to be at least == header */
     if ((frame_length-FCS_LEN) >= aes_job->header_len)
     {
-        /* Get the MAC unencrypted data (MHR) */
+        /* Get the MAC unencrypted data (MHR) and find its fields in one pass */
         dwt_readrxdata((uint8_t *)MHR_802_15_4_PTR(mac_frame_ptr), aes_job->header_len, 0);
+        if (mac_frame_parse_802_15_4((uint8_t *)MHR_802_15_4_PTR(mac_frame_ptr), aes_job->header_len, frame_length, &view) != DWT_SUCCESS)
+            return AES_RES_ERROR_IGNORE_FRAME; // Not a frame we can parse
 
         /* Place a breakpoint here to see an unencrypted header */
 
-        get_src_and_dst_frame_addr(mac_frame_ptr,&src_addr,&dst_addr);
-        security_state = get_security_state(mac_frame_ptr);
-        //Check if we got a secure frame with the right destination and source addresses
-        if ((security_state != SECURITY_STATE_SECURE)||(exp_src_addr != src_addr)||(exp_dst_addr != dst_addr))
+        //Check if we got a secure frame of the expected layout with the right destination and source addresses
+        if ((!view.security)||(view.hdr_len != aes_job->header_len)||
+            (view.src_addr_len != EXTENDED_ADDR)||(view.dst_addr_len != EXTENDED_ADDR)||(view.src_pan_off != 0)||(view.key_id_len != 1)||
+            (exp_src_addr != mac_frame_view_get_addr(&view,view.src_addr_off,view.src_addr_len))||
+            (exp_dst_addr != mac_frame_view_get_addr(&view,view.dst_addr_off,view.dst_addr_len)))
             return AES_RES_ERROR_IGNORE_FRAME; // This is not for us
 
         /* next get the MIC size */
-        aes_job->mic_size = mac_frame_get_aux_mic_size(mac_frame_ptr);
-        if(aes_job->mic_size == MIC_ERROR)
+        if (view.sec_level == AUX_SEC_LEVEL_RESERVED)
             return AES_RES_ERROR_FRAME;
+        aes_job->mic_size = view.mic_len;
 
-        payload_len = frame_length - (aes_job->header_len + aes_job->mic_size + FCS_LEN); /* to get unencrypted payload length subtract MIC, FCS and MHR lengths */
+        payload_len = view.payload_len; /* unencrypted payload length: frame length minus MIC, FCS and MHR lengths */
         /* Check if payload_len is valid */
-        if ((payload_len < 0) || (payload_len > max_payload))
+        if (payload_len > max_payload)
             return AES_RES_ERROR_FRAME;
 
         /* next get the nonce (SS-TWR AES example uses 13-byte nonce*/
@@ -266,3 +268,278 @@ void get_src_and_dst_frame_addr(mac_frame_802_15_4_format_t *mac_frame_ptr, uint
     }
 }
 
+/* @fn      mac_frame_parse_802_15_4
+ * @brief   Find the fields of a received frame in one pass over its header, without copying: frame control,
+ *          sequence number, PAN IDs and addresses (PAN ID compression of frame versions 0 to 2), auxiliary security
+ *          header, header IEs, then the payload and MIC from the frame length. Multipurpose, fragment and extended
+ *          frame types are not parsed. The buffer can hold the header only, e.g. the part read from the RX buffer
+ *          by mac_frame_read_header_802_15_4(): the payload offset then indexes the DW IC RX buffer.
+ *
+ * @param   buf       - frame bytes, from the frame control
+ * @param   buf_len   - bytes in buf
+ * @param   frame_len - frame length, FCS included (RX frame info)
+ * @param   view      - filled with the field offsets
+ * @return  DWT_SUCCESS, or DWT_ERROR for a frame type not parsed, a reserved mode, or a header longer than buf
+ *          or the frame
+*/
+int mac_frame_parse_802_15_4(const uint8_t *buf, uint16_t buf_len, uint16_t frame_len, mac_frame_view_t *view)
+{
+    static const uint8_t addr_len[4] = { 0, 0, 2, EXTENDED_ADDR };
+    static const uint8_t key_id_len[4] = { 0, 1, 5, 9 };
+    static const uint8_t mic_len[8] = { 0, 4, 8, 16, 0, 4, 8, 16 };
+    uint8_t  dst_mode, src_mode, pan_comp, dst_pan, src_pan;
+    uint16_t off, end;
+
+    end = (frame_len < FCS_LEN) ? 0 : (frame_len - FCS_LEN);
+    if (buf_len > end)
+        buf_len = end;
+    if (buf_len < 2)
+        return DWT_ERROR;
+
+    memset(view, 0, sizeof(*view));
+    view->frame     = buf;
+    view->frame_len = frame_len;
+    view->type      = buf[0] & 0x7;
+    view->security  = (buf[0] >> MAC_FRAME_SECURITY_ENABLED_SHIFT_VALUE) & 1;
+    view->ack_req   = (buf[0] >> MAC_FRAME_AR_SHIFT_VALUE) & 1;
+    view->version   = (buf[1] >> MAC_FRAME_FRAME_VER_SHIFT_VALUE) & 0x3;
+    pan_comp        = (buf[0] >> MAC_FRAME_PAN_ID_SHIFT_VALUE) & 1;
+    dst_mode        = (buf[1] >> MAC_FRAME_DEST_ADDR_MODE_SHIFT_VALUE) & 0x3;
+    src_mode        = (buf[1] >> MAC_FRAME_SRC_ADDR_MODE_SHIFT_VALUE) & 0x3;
+
+    if ((view->type >= MAC_FRAME_TYPE_802_15_4_RESERVED) || (view->version == 3) ||
+        (dst_mode == MAC_DEST_ADDR_MODE_RESERVED) || (src_mode == MAC_SRC_ADDR_MODE_RESERVED))
+        return DWT_ERROR;
+
+    off = 2;
+    view->seq = -1;
+    if ((view->version < DATA_FRAME_VERSION) || !((buf[1] >> MAC_FRAME_SEQ_NUM_SUPPRESS_SHIFT_VALUE) & 1))
+    {
+        if (off >= buf_len)
+            return DWT_ERROR;
+        view->seq = buf[off++];
+    }
+
+    /* PAN IDs present: 802.15.4-2006 compression elides the source one, 802.15.4-2015 table 7-2 */
+    if (view->version < DATA_FRAME_VERSION)
+    {
+        dst_pan = (dst_mode != 0);
+        src_pan = (src_mode != 0) && !(pan_comp && (dst_mode != 0));
+    }
+    else if ((dst_mode == 0) && (src_mode == 0))
+    {
+        dst_pan = pan_comp;
+        src_pan = 0;
+    }
+    else if ((dst_mode == 0) || (src_mode == 0))
+    {
+        dst_pan = (dst_mode != 0) && !pan_comp;
+        src_pan = (src_mode != 0) && !pan_comp;
+    }
+    else
+    {
+        /* both addresses: one PAN ID unless both are extended, and compression drops the source one */
+        uint8_t ext = (dst_mode == MAC_DEST_ADDR_MODE_EXT_ADDR_64_BITS) && (src_mode == MAC_SRC_ADDR_MODE_EXT_ADDR_64_BITS);
+
+        dst_pan = !pan_comp || !ext;
+        src_pan = !pan_comp && !ext;
+    }
+
+    if (dst_pan)
+    {
+        view->dst_pan_off = off;
+        off += 2;
+    }
+    view->dst_addr_off = off;
+    view->dst_addr_len = addr_len[dst_mode];
+    off += view->dst_addr_len;
+    if (src_pan)
+    {
+        view->src_pan_off = off;
+        off += 2;
+    }
+    view->src_addr_off = off;
+    view->src_addr_len = addr_len[src_mode];
+    off += view->src_addr_len;
+
+    if (view->security)
+    {
+        uint8_t sec_ctrl;
+
+        if (off >= buf_len)
+            return DWT_ERROR;
+        sec_ctrl = buf[off];
+        view->aux_off = off;
+        view->sec_level = (sec_ctrl >> AUX_SECURITY_LEVEL_SHIFT_VALUE) & 0x7;
+        view->mic_len = mic_len[view->sec_level];
+        off++;
+        if ((view->version < DATA_FRAME_VERSION) || !((sec_ctrl >> AUX_FRAME_CNT_SUPPRESSION_SHIFT_VALUE) & 1))
+        {
+            view->frame_cnt_off = off;
+            off += AUX_FRAME_CNT_SIZE;
+        }
+        view->key_id_len = key_id_len[(sec_ctrl >> AUX_KEY_IDENTIFIER_MODE_SHIFT_VALUE) & 0x3];
+        if (view->key_id_len)
+            view->key_id_off = off;
+        off += view->key_id_len;
+        view->aux_len = (uint8_t)(off - view->aux_off);
+    }
+    if (off > buf_len)
+        return DWT_ERROR;
+
+    /* Header IEs, up to a header termination IE or the end of the frame */
+    if ((view->version >= DATA_FRAME_VERSION) && ((buf[1] >> MAC_FRAME_IE_PRESET_SHIFT_VALUE) & 1))
+    {
+        while (off < end)
+        {
+            uint16_t desc, id;
+
+            if ((off + 2) > buf_len)
+                return DWT_ERROR;
+            desc = buf[off] | ((uint16_t)buf[off + 1] << 8);
+            id = (desc >> MAC_HEADER_IE_ID_SHIFT_VALUE) & 0xFF;
+            off += 2 + (desc & MAC_HEADER_IE_LEN_MASK);
+            if ((id == MAC_HEADER_IE_ID_HT1) || (id == MAC_HEADER_IE_ID_HT2))
+                break;
+        }
+        if (off > end)
+            return DWT_ERROR;
+    }
+
+    if ((off + view->mic_len) > end)
+        return DWT_ERROR;
+    view->hdr_len = off;
+    view->payload_off = off;
+    view->payload_len = end - off - view->mic_len;
+    return DWT_SUCCESS;
+}
+
+/* @fn      mac_frame_read_header_802_15_4
+ * @brief   Read the first bytes of the received frame (one SPI read, no more than the frame) and parse its header.
+ *          The payload is left in the RX buffer, at view->payload_off, e.g. for dwt_readrxdata() or the AES engine.
+ *
+ * @param   buf       - buffer for the header
+ * @param   buf_len   - bytes to read, e.g. MAC_FRAME_MHR_MAX_LEN plus the header IEs expected
+ * @param   frame_len - frame length, FCS included (RX frame info)
+ * @param   view      - filled with the field offsets
+ * @return  DWT_SUCCESS, or DWT_ERROR (see mac_frame_parse_802_15_4)
+*/
+int mac_frame_read_header_802_15_4(uint8_t *buf, uint16_t buf_len, uint16_t frame_len, mac_frame_view_t *view)
+{
+    if (frame_len <= FCS_LEN)
+        return DWT_ERROR;
+    if (buf_len > (frame_len - FCS_LEN))
+        buf_len = frame_len - FCS_LEN;
+
+    dwt_readrxdata(buf, buf_len, 0);
+    return mac_frame_parse_802_15_4(buf, buf_len, frame_len, view);
+}
+
+/* @fn      mac_frame_view_get_addr
+ * @brief   Read a little endian field of a parsed frame, e.g. an address: view->src_addr_off, view->src_addr_len.
+ *
+ * @param   view - parsed frame
+ * @param   off  - field offset
+ * @param   len  - field length, up to 8 bytes
+ * @return  field value, 0 for an absent field
+*/
+uint64_t mac_frame_view_get_addr(const mac_frame_view_t *view, uint16_t off, uint8_t len)
+{
+    uint64_t addr = 0;
+
+    while (len--)
+    {
+        addr = (addr << 8) | view->frame[off + len];
+    }
+    return addr;
+}
+
+/* @fn      mac_frame_template_init
+ * @brief   Build the secured frame header template of a peer and key: frame control, PAN ID and addresses,
+ *          security control and key index, and the source address and security level part of the nonce.
+ *          The sequence number and the frame counter are set to 0, see mac_frame_template_update().
+ *
+ * @param   tpl_ptr     - template to build
+ * @param   dest_pan_id - destination PAN ID
+ * @param   dest_addr   - destination address
+ * @param   src_addr    - source address
+ * @param   sec_level   - security level (MIC size and data confidentiality)
+ * @param   key_index   - key index carried in the key identifier (0 is forbidden)
+ * @return  DWT_SUCCESS, or DWT_ERROR for the reserved security level or a key index of 0
+*/
+int mac_frame_template_init(mac_frame_template_802_15_4_t *tpl_ptr, uint16_t dest_pan_id, uint64_t dest_addr, uint64_t src_addr,
+        aux_security_level_e sec_level, uint8_t key_index)
+{
+    mac_frame_802_15_4_format_t *mac_frame_ptr = &tpl_ptr->frame;
+
+    if ((sec_level == AUX_SEC_LEVEL_RESERVED) || (key_index == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(tpl_ptr, 0, sizeof(*tpl_ptr));
+
+    mac_frame_init_mac_frame_ctrl(mac_frame_ptr);
+    mac_frame_set_pan_ids_and_addresses_802_15_4(mac_frame_ptr, dest_pan_id, dest_addr, src_addr);
+
+    /* Key determined from key index, has frame cnt, frame cnt generates the nonce */
+    MAC_FRAME_AUX_SECURITY_CTRL_802_15_4(mac_frame_ptr)=((uint8_t)sec_level<<AUX_SECURITY_LEVEL_SHIFT_VALUE)|
+            (AUX_KEY_IDEN_MODE_KEY_INDEX<<AUX_KEY_IDENTIFIER_MODE_SHIFT_VALUE)|
+            (AUX_FRAME_CNT_SUPPRESS_OFF<<AUX_FRAME_CNT_SUPPRESSION_SHIFT_VALUE)|(AUX_ASN_IN_NOUNCE_FRAME_CNT_GEN_NONCE<<AUX_ASN_IN_NONCE);
+    MAC_FRAME_AUX_KEY_IDENTIFY_802_15_4(mac_frame_ptr)=key_index;
+
+    tpl_ptr->mic_size = mac_frame_get_aux_mic_size(mac_frame_ptr);
+    mac_frame_get_nonce(mac_frame_ptr, tpl_ptr->nonce);
+
+    return DWT_SUCCESS;
+}
+
+/* @fn      mac_frame_template_update
+ * @brief   Set the sequence number and the frame counter of the next frame in the template MHR and nonce.
+ *
+ * @param   tpl_ptr   - template
+ * @param   seq_num   - sequence number
+ * @param   frame_cnt - frame counter
+ * @return  None
+*/
+void mac_frame_template_update(mac_frame_template_802_15_4_t *tpl_ptr, uint8_t seq_num, uint32_t frame_cnt)
+{
+    uint8_t cnt;
+
+    MAC_FRAME_SEQ_NUM_802_15_4(&tpl_ptr->frame)=seq_num;
+
+    for (cnt=0;cnt<AUX_FRAME_CNT_SIZE;cnt++)
+    {
+        MAC_FRAME_AUX_FRAME_CNT_802_15_4(&tpl_ptr->frame,cnt)=(uint8_t)(frame_cnt);
+        tpl_ptr->nonce[MAC_FRAME_NONCE_FRAME_CNT_IDX+cnt]=(uint8_t)(frame_cnt);
+        frame_cnt>>=8;
+    }
+}
+
+/* @fn      mac_frame_template_aes_job
+ * @brief   Point an encryption job to the template header and nonce, and set its MIC size.
+ *          The job stays valid across mac_frame_template_update() calls, only its payload has to be set.
+ *
+ * @param   tpl_ptr - template
+ * @param   aes_job - AES job
+ * @return  None
+*/
+void mac_frame_template_aes_job(mac_frame_template_802_15_4_t *tpl_ptr, dwt_aes_job_t *aes_job)
+{
+    aes_job->nonce      = tpl_ptr->nonce;
+    aes_job->header     = (uint8_t *)MHR_802_15_4_PTR(&tpl_ptr->frame);
+    aes_job->header_len = MAC_FRAME_HEADER_SIZE(&tpl_ptr->frame);
+    aes_job->mic_size   = tpl_ptr->mic_size;
+}
+
+/* @fn      mac_frame_template_write
+ * @brief   Write the template MHR to the DW IC TX buffer, e.g. ahead of a payload written or encrypted separately.
+ *
+ * @param   tpl_ptr          - template
+ * @param   tx_buffer_offset - offset in the TX buffer
+ * @return  DWT_SUCCESS or DWT_ERROR (see dwt_writetxdata)
+*/
+int mac_frame_template_write(mac_frame_template_802_15_4_t *tpl_ptr, uint16_t tx_buffer_offset)
+{
+    return dwt_writetxdata(MAC_FRAME_HEADER_SIZE(&tpl_ptr->frame), (uint8_t *)MHR_802_15_4_PTR(&tpl_ptr->frame), tx_buffer_offset);
+}
@@ -209,6 +209,15 @@ typedef enum
 
 #define SECURITY_ENABLE_BIT_MASK                    0x8
 
+/* Header IE descriptor (2 bytes, little endian): length bits 0-6, element ID bits 7-14, type bit 15 (0) */
+#define MAC_HEADER_IE_LEN_MASK                      0x7F
+#define MAC_HEADER_IE_ID_SHIFT_VALUE                7
+#define MAC_HEADER_IE_ID_HT1                        0x7E    /* header termination, payload IEs follow */
+#define MAC_HEADER_IE_ID_HT2                        0x7F    /* header termination, payload follows */
+
+/* Longest MHR without header IEs: frame control, seq, 2 PAN IDs, 2 extended addresses, aux security header */
+#define MAC_FRAME_MHR_MAX_LEN                       37
+
 /* This is the structure of the MAC frame. The structure defined here applies for the SS-TWR AES example frames
  * the mhr_802_15_4_t defines a data frame with: with 2 byte frame control, seq number, dest PAN ID, 64-bit source
  * and destination addresses and the aux security header fields
@@ -221,6 +230,20 @@ typedef struct
 }mac_frame_802_15_4_format_t;
 
 
+/* CCM* nonce: Source Address (8), Frame Counter (4) and Nonce Security Level (1), see mac_frame_get_nonce() */
+#define MAC_FRAME_NONCE_LEN             13
+#define MAC_FRAME_NONCE_FRAME_CNT_IDX   8
+
+/* Secured frame header template (see mac_frame_template_init).
+ * The MHR and the nonce of a peer and key are built once, only the sequence number
+ * and the frame counter change from one frame to the next */
+typedef struct
+{
+    mac_frame_802_15_4_format_t frame;                      /* MHR of the frames, payload_ptr not used */
+    uint8_t                     nonce[MAC_FRAME_NONCE_LEN]; /* nonce of the current frame counter */
+    uint8_t                     mic_size;                   /* from the security level, bytes */
+}mac_frame_template_802_15_4_t;
+
 typedef enum
 {
     SECURITY_STATE_SECURE=0,
@@ -259,6 +282,14 @@ aes_results_e rx_aes_802_15_4(mac_frame_802_15_4_format_t   *mac_frame_ptr,uint1
         dwt_aes_key_t *aes_key_ptr,uint64_t exp_src_addr,uint64_t exp_dst_addr,dwt_aes_config_t *aes_config);
 security_state_e get_security_state(mac_frame_802_15_4_format_t *mac_frame_ptr);
 void get_src_and_dst_frame_addr(mac_frame_802_15_4_format_t *mac_frame_ptr,uint64_t *src, uint64_t *dst);
+int mac_frame_template_init(mac_frame_template_802_15_4_t *tpl_ptr,uint16_t dest_pan_id,uint64_t dest_addr,uint64_t src_addr,
+        aux_security_level_e sec_level,uint8_t key_index);
+void mac_frame_template_update(mac_frame_template_802_15_4_t *tpl_ptr,uint8_t seq_num,uint32_t frame_cnt);
+void mac_frame_template_aes_job(mac_frame_template_802_15_4_t *tpl_ptr,dwt_aes_job_t *aes_job);
+int mac_frame_template_write(mac_frame_template_802_15_4_t *tpl_ptr,uint16_t tx_buffer_offset);
+int mac_frame_parse_802_15_4(const uint8_t *buf,uint16_t buf_len,uint16_t frame_len,mac_frame_view_t *view);
+int mac_frame_read_header_802_15_4(uint8_t *buf,uint16_t buf_len,uint16_t frame_len,mac_frame_view_t *view);
+uint64_t mac_frame_view_get_addr(const mac_frame_view_t *view,uint16_t off,uint8_t len);
 
 
 
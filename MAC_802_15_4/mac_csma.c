@@ -0,0 +1,134 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_csma.c
+ * @brief   Unslotted CSMA/CA channel access on the DW IC preamble CCA
+ *
+ *          See mac_csma.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <mac_csma.h>
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn csma_rand()
+ *
+ * @brief Next value of the xorshift32 generator.
+ *
+ * @param csma - context
+ *
+ * @return random value
+ */
+static uint32_t csma_rand(mac_csma_t *csma)
+{
+    uint32_t x = csma->rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    csma->rng = x;
+
+    return x;
+}
+
+void mac_csma_default_config(mac_csma_config_t *cfg)
+{
+    cfg->min_be = 3;
+    cfg->max_be = 5;
+    cfg->max_backoffs = 4;
+    cfg->cca_pacs = 3;
+    cfg->unit_uus = 1000;
+    cfg->seed = 0;
+}
+
+int mac_csma_init(mac_csma_t *csma, const mac_csma_config_t *cfg)
+{
+    if ((csma == NULL) || (cfg == NULL) || (cfg->min_be > cfg->max_be) || (cfg->max_be > MAC_CSMA_MAX_BE) ||
+        (cfg->max_backoffs > MAC_CSMA_MAX_BACKOFFS) || (cfg->cca_pacs == 0) || (cfg->unit_uus == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(csma, 0, sizeof(*csma));
+    csma->cfg = *cfg;
+
+    /* The part ID differs between devices, the system time between boots */
+    csma->rng = (cfg->seed != 0) ? cfg->seed : (dwt_getpartid() ^ dwt_getlotid() ^ dwt_readsystimestamphi32());
+    if (csma->rng == 0)
+    {
+        csma->rng = 1;
+    }
+
+    return DWT_SUCCESS;
+}
+
+void mac_csma_begin(mac_csma_t *csma)
+{
+    csma->nb = 0;
+    csma->be = csma->cfg.min_be;
+    csma->frame_uus = 0;
+    csma->stats.frames++;
+}
+
+void mac_csma_tx_setup(const mac_csma_t *csma)
+{
+    dwt_setpreambledetecttimeout(csma->cfg.cca_pacs);
+}
+
+int mac_csma_tx(const mac_csma_t *csma, uint8_t mode)
+{
+    mac_csma_tx_setup(csma);
+
+    return dwt_starttx((mode & DWT_RESPONSE_EXPECTED) | DWT_START_TX_CCA);
+}
+
+int32_t mac_csma_busy(mac_csma_t *csma)
+{
+    uint32_t backoff;
+
+    csma->stats.busy++;
+
+    if (++csma->nb > csma->cfg.max_backoffs)
+    {
+        csma->stats.failures++;
+        return MAC_CSMA_FAILURE;
+    }
+
+    /* Random number of unit periods in [0, 2^BE - 1] */
+    backoff = (csma_rand(csma) & ((1U << csma->be) - 1)) * csma->cfg.unit_uus;
+    if (csma->be < csma->cfg.max_be)
+    {
+        csma->be++;
+    }
+
+    csma->frame_uus += backoff;
+    csma->stats.backoff_uus += backoff;
+    if (csma->frame_uus > csma->stats.backoff_max_uus)
+    {
+        csma->stats.backoff_max_uus = csma->frame_uus;
+    }
+
+    return (int32_t)backoff;
+}
+
+uint8_t mac_csma_sent(mac_csma_t *csma)
+{
+    csma->stats.sent++;
+    csma->stats.sent_at[(csma->nb <= MAC_CSMA_MAX_BACKOFFS) ? csma->nb : MAC_CSMA_MAX_BACKOFFS]++;
+
+    return csma->nb;
+}
+
+const mac_csma_stats_t * mac_csma_get_stats(const mac_csma_t *csma)
+{
+    return &csma->stats;
+}
+
+void mac_csma_clear_stats(mac_csma_t *csma)
+{
+    memset(&csma->stats, 0, sizeof(csma->stats));
+}
@@ -0,0 +1,192 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_csma.h
+ * @brief   Unslotted CSMA/CA channel access on the DW IC preamble CCA
+ *
+ *          The IEEE 802.15.4 unslotted CSMA/CA algorithm over the CCA of the
+ *          DW IC (dwt_starttx() with DWT_START_TX_CCA): the receiver looks for
+ *          a preamble for the preamble detection timeout (the CCA window, in
+ *          PACs) and sends the frame only if it sees none, see ex_01e NOTE 1.
+ *
+ *          For each frame (mac_csma_begin()), every busy CCA (CCA_FAIL event)
+ *          is reported with mac_csma_busy(), which returns the random backoff
+ *          to wait before the next attempt: a whole number of unit periods
+ *          drawn in [0, 2^BE - 1], BE starting at min_be and growing by one
+ *          per busy CCA up to max_be. After max_backoffs busy CCAs the frame
+ *          is a channel access failure. The random draws use a xorshift
+ *          generator seeded per device, so that tags which collided once do
+ *          not back off in step.
+ *
+ *          The layer does not wait: the engine that owns the transmission
+ *          waits the backoff in its own context (k_usleep() in a thread, a
+ *          delayed TX or a timer), so that it works for the interrupt driven
+ *          TWR engine (twr_config_t.cca, TWR_ERR_BUSY results) as well as for
+ *          frames sent with mac_csma_tx() or tx_slots_send() (mode
+ *          DWT_START_TX_CCA, after mac_csma_tx_setup()).
+ *
+ *          The context is given by the application, one per engine. The
+ *          functions are not reentrant: call them from one context.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MAC_CSMA_H_
+#define _MAC_CSMA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define MAC_CSMA_MAX_BACKOFFS   8           /* max_backoffs limit */
+#define MAC_CSMA_MAX_BE         10          /* max_be limit */
+#define MAC_CSMA_FAILURE        (-1)        /* mac_csma_busy(): channel access failure, drop or defer the frame */
+
+/* Channel access configuration (802.15.4 names: macMinBE, macMaxBE, macMaxCSMABackoffs) */
+typedef struct
+{
+    uint8_t     min_be;             /* initial backoff exponent */
+    uint8_t     max_be;             /* backoff exponent limit */
+    uint8_t     max_backoffs;       /* busy CCAs before a channel access failure */
+    uint8_t     cca_pacs;           /* CCA window: preamble detection timeout, in PACs */
+    uint32_t    unit_uus;           /* backoff unit period, in UWB microseconds */
+    uint32_t    seed;               /* random seed, 0 to seed from the device (part ID and system time) */
+} mac_csma_config_t;
+
+/* Channel access statistics */
+typedef struct
+{
+    uint32_t    frames;             /* frames started (mac_csma_begin()) */
+    uint32_t    sent;               /* frames sent after a clear CCA (mac_csma_sent()) */
+    uint32_t    failures;           /* channel access failures */
+    uint32_t    busy;               /* busy CCAs */
+    uint32_t    sent_at[MAC_CSMA_MAX_BACKOFFS + 1];     /* frames sent after n busy CCAs */
+    uint64_t    backoff_uus;        /* total backoff time returned */
+    uint32_t    backoff_max_uus;    /* longest total backoff of one frame */
+} mac_csma_stats_t;
+
+/* Channel access context */
+typedef struct
+{
+    mac_csma_config_t   cfg;
+    uint32_t            rng;        /* xorshift32 state */
+    uint8_t             nb;         /* busy CCAs of the frame */
+    uint8_t             be;         /* backoff exponent of the frame */
+    uint32_t            frame_uus;  /* backoff time of the frame */
+    mac_csma_stats_t    stats;
+} mac_csma_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_default_config()
+ *
+ * @brief Fill a configuration with the 802.15.4 defaults (BE 3 to 5, 4 backoffs), a 3 PAC CCA window (ex_01e) and a
+ *        1 ms unit period.
+ *
+ * @param cfg - configuration to fill
+ *
+ * @return none
+ */
+void mac_csma_default_config(mac_csma_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_init()
+ *
+ * @brief Set up a channel access context. With a zero seed the device must be awake (the seed is read from it).
+ *
+ * @param csma - context
+ * @param cfg - configuration (copied)
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters)
+ */
+int mac_csma_init(mac_csma_t *csma, const mac_csma_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_begin()
+ *
+ * @brief Start the channel access of a new frame.
+ *
+ * @param csma - context
+ *
+ * @return none
+ */
+void mac_csma_begin(mac_csma_t *csma);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_tx_setup()
+ *
+ * @brief Set the CCA window (preamble detection timeout) before a DWT_START_TX_CCA transmission. The same timeout
+ *        applies to the reception enabled after the TX with DWT_RESPONSE_EXPECTED.
+ *
+ * @param csma - context
+ *
+ * @return none
+ */
+void mac_csma_tx_setup(const mac_csma_t *csma);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_tx()
+ *
+ * @brief Start a CCA attempt of the frame written in the TX buffer (dwt_writetxdata(), dwt_writetxfctrl()): set the
+ *        CCA window and call dwt_starttx() with DWT_START_TX_CCA. The outcome is a TX done (mac_csma_sent()) or a
+ *        CCA_FAIL (mac_csma_busy()) event.
+ *
+ * @param csma - context
+ * @param mode - DWT_START_TX_IMMEDIATE, with DWT_RESPONSE_EXPECTED if needed (the CCA is immediate only)
+ *
+ * @return dwt_starttx() result
+ */
+int mac_csma_tx(const mac_csma_t *csma, uint8_t mode);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_busy()
+ *
+ * @brief Report a busy CCA of the frame and draw the backoff before the next attempt.
+ *
+ * @param csma - context
+ *
+ * @return backoff to wait, in UWB microseconds, or MAC_CSMA_FAILURE after max_backoffs busy CCAs
+ */
+int32_t mac_csma_busy(mac_csma_t *csma);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_sent()
+ *
+ * @brief Report that the frame was sent (clear CCA).
+ *
+ * @param csma - context
+ *
+ * @return number of busy CCAs before it
+ */
+uint8_t mac_csma_sent(mac_csma_t *csma);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_get_stats()
+ *
+ * @brief Return the statistics of a context.
+ *
+ * @param csma - context
+ *
+ * @return statistics
+ */
+const mac_csma_stats_t * mac_csma_get_stats(const mac_csma_t *csma);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_clear_stats()
+ *
+ * @brief Clear the statistics of a context.
+ *
+ * @param csma - context
+ *
+ * @return none
+ */
+void mac_csma_clear_stats(mac_csma_t *csma);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MAC_CSMA_H_ */
@@ -0,0 +1,261 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_frag.c
+ * @brief   Fragmentation and reassembly of payloads larger than one frame
+ *
+ *          See mac_frag.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <mac_frag.h>
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frag_free()
+ *
+ * @brief Free a slot.
+ *
+ * @param s - slot
+ *
+ * @return none
+ */
+static void frag_free(mac_frag_slot_t *s)
+{
+    s->in_use = 0;
+    s->received = 0;
+    s->len = 0;
+    memset(s->map, 0, sizeof(s->map));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frag_slot()
+ *
+ * @brief Find the slot of a datagram, or take a free one for it.
+ *
+ * @param pool - pool
+ * @param src - source address
+ * @param tag - datagram number
+ * @param count - fragments of the datagram
+ *
+ * @return slot, or NULL if all slots are busy
+ */
+static mac_frag_slot_t * frag_slot(mac_frag_pool_t *pool, uint16_t src, uint8_t tag, uint16_t count)
+{
+    mac_frag_slot_t *free_slot = NULL;
+    uint8_t i;
+
+    for (i = 0; i < pool->slots; i++)
+    {
+        mac_frag_slot_t *s = &pool->slot[i];
+
+        if (!s->in_use)
+        {
+            if (free_slot == NULL)
+            {
+                free_slot = s;
+            }
+        }
+        else if ((s->src == src) && (s->tag == tag))
+        {
+            if (s->count != count)
+            {
+                /* tag reused for a new datagram, the old one cannot complete */
+                pool->stats.timeouts++;
+                frag_free(s);
+                free_slot = s;
+                break;
+            }
+            return s;
+        }
+    }
+
+    if (free_slot != NULL)
+    {
+        free_slot->in_use = 1;
+        free_slot->src = src;
+        free_slot->tag = tag;
+        free_slot->count = count;
+    }
+    return free_slot;
+}
+
+int mac_frag_tx_init(mac_frag_tx_t *tx, const uint8_t *data, uint16_t len, uint16_t unit, uint8_t tag)
+{
+    uint32_t count;
+
+    if ((data == NULL) || (len == 0) || (unit == 0))
+    {
+        return DWT_ERROR;
+    }
+    count = ((uint32_t)len + unit - 1) / unit;
+    if (count > MAC_FRAG_MAX_FRAGS)
+    {
+        return DWT_ERROR;
+    }
+
+    tx->data = data;
+    tx->len = len;
+    tx->unit = unit;
+    tx->count = (uint16_t)count;
+    tx->index = 0;
+    tx->tag = tag;
+    return DWT_SUCCESS;
+}
+
+uint16_t mac_frag_tx_next(mac_frag_tx_t *tx, uint8_t *buf, uint16_t buf_len)
+{
+    uint32_t offset = (uint32_t)tx->index * tx->unit;
+    uint16_t len;
+
+    if (tx->index >= tx->count)
+    {
+        return 0;
+    }
+    len = (uint16_t)(((tx->len - offset) > tx->unit) ? tx->unit : (tx->len - offset));
+    if (buf_len < (MAC_FRAG_HDR_LEN + len))
+    {
+        return 0;
+    }
+
+    buf[MAC_FRAG_TAG_IDX] = tx->tag;
+    buf[MAC_FRAG_INDEX_IDX] = (uint8_t)tx->index;
+    buf[MAC_FRAG_LAST_IDX] = (uint8_t)(tx->count - 1);
+    buf[MAC_FRAG_UNIT_IDX] = (uint8_t)tx->unit;
+    buf[MAC_FRAG_UNIT_IDX + 1] = (uint8_t)(tx->unit >> 8);
+    memcpy(&buf[MAC_FRAG_HDR_LEN], &tx->data[offset], len);
+
+    tx->index++;
+    return MAC_FRAG_HDR_LEN + len;
+}
+
+int mac_frag_pool_init(mac_frag_pool_t *pool, mac_frag_slot_t *slots, uint8_t count, uint8_t *buf, uint16_t buf_len,
+                       uint32_t timeout_ms, mac_frag_cb_t cb)
+{
+    uint8_t i;
+
+    if ((slots == NULL) || (count == 0) || (buf == NULL) || (buf_len == 0) || (cb == NULL))
+    {
+        return DWT_ERROR;
+    }
+
+    pool->slot = slots;
+    pool->slots = count;
+    pool->buf_len = buf_len;
+    pool->timeout_ms = timeout_ms;
+    pool->cb = cb;
+    memset(&pool->stats, 0, sizeof(pool->stats));
+
+    for (i = 0; i < count; i++)
+    {
+        slots[i].buf = &buf[(uint32_t)i * buf_len];
+        frag_free(&slots[i]);
+    }
+    return DWT_SUCCESS;
+}
+
+int mac_frag_put(mac_frag_pool_t *pool, uint16_t src, uint8_t tag, uint16_t index, uint16_t count, uint32_t offset,
+                 const uint8_t *data, uint16_t len, uint32_t now_ms)
+{
+    mac_frag_slot_t *s;
+    uint8_t bit;
+
+    if ((count == 0) || (count > MAC_FRAG_MAX_FRAGS) || (index >= count) ||
+        ((offset + len) > pool->buf_len))
+    {
+        pool->stats.bad++;
+        return DWT_ERROR;
+    }
+
+    mac_frag_expire(pool, now_ms);
+
+    s = frag_slot(pool, src, tag, count);
+    if (s == NULL)
+    {
+        pool->stats.no_slot++;
+        return DWT_ERROR;
+    }
+
+    bit = (uint8_t)(1 << (index & 7));
+    if (s->map[index >> 3] & bit)
+    {
+        pool->stats.dup++;
+        return DWT_SUCCESS;
+    }
+
+    memcpy(&s->buf[offset], data, len);
+    s->map[index >> 3] |= bit;
+    s->received++;
+    s->last_ms = now_ms;
+    if ((offset + len) > s->len)
+    {
+        s->len = (uint16_t)(offset + len);
+    }
+    pool->stats.fragments++;
+
+    if (s->received == s->count)
+    {
+        pool->stats.datagrams++;
+        pool->cb(src, tag, s->buf, s->len);
+        frag_free(s);
+    }
+    return DWT_SUCCESS;
+}
+
+int mac_frag_rx(mac_frag_pool_t *pool, uint16_t src, const uint8_t *frag, uint16_t len, uint32_t now_ms)
+{
+    uint16_t unit;
+    uint16_t index;
+
+    if (len < MAC_FRAG_HDR_LEN)
+    {
+        pool->stats.bad++;
+        return DWT_ERROR;
+    }
+
+    index = frag[MAC_FRAG_INDEX_IDX];
+    unit = frag[MAC_FRAG_UNIT_IDX] | ((uint16_t)frag[MAC_FRAG_UNIT_IDX + 1] << 8);
+    len -= MAC_FRAG_HDR_LEN;
+
+    /* all fragments but the last one are one unit long */
+    if ((len > unit) || ((index != frag[MAC_FRAG_LAST_IDX]) && (len != unit)))
+    {
+        pool->stats.bad++;
+        return DWT_ERROR;
+    }
+
+    return mac_frag_put(pool, src, frag[MAC_FRAG_TAG_IDX], index, (uint16_t)frag[MAC_FRAG_LAST_IDX] + 1,
+                        (uint32_t)index * unit, &frag[MAC_FRAG_HDR_LEN], len, now_ms);
+}
+
+int mac_frag_xfer_rx(mac_frag_pool_t *pool, const mac_xfer_rx_t *rx, uint32_t now_ms)
+{
+    return mac_frag_put(pool, rx->peer, rx->id, rx->index, rx->frames, rx->offset, rx->data, rx->len, now_ms);
+}
+
+int mac_frag_expire(mac_frag_pool_t *pool, uint32_t now_ms)
+{
+    int dropped = 0;
+    uint8_t i;
+
+    for (i = 0; i < pool->slots; i++)
+    {
+        mac_frag_slot_t *s = &pool->slot[i];
+
+        if (s->in_use && ((uint32_t)(now_ms - s->last_ms) > pool->timeout_ms))
+        {
+            frag_free(s);
+            dropped++;
+        }
+    }
+    pool->stats.timeouts += dropped;
+    return dropped;
+}
+
+const mac_frag_stats_t * mac_frag_get_stats(const mac_frag_pool_t *pool)
+{
+    return &pool->stats;
+}
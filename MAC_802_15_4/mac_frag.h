@@ -0,0 +1,228 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_frag.h
+ * @brief   Fragmentation and reassembly of payloads larger than one frame
+ *
+ *          Sender: mac_frag_tx_init() cuts a buffer into fragments of a fixed
+ *          unit, mac_frag_tx_next() writes them one at a time, each behind a
+ *          MAC_FRAG_HDR_LEN bytes header, into the payload of the application
+ *          frames (standard or long, see MAC_FRAG_UNIT()):
+ *
+ *          - tag: datagram number, chosen by the sender
+ *          - index: fragment number, from 0
+ *          - last: index of the last fragment (count - 1)
+ *          - unit: fragment size, LE, all fragments but the last one
+ *
+ *          Receiver: a pool of reassembly slots in storage given by the
+ *          application, one datagram of up to buf_len bytes each, keyed by
+ *          source address and tag. Fragments are copied at index * unit, in
+ *          any order, copies are dropped, and the datagram is handed to the
+ *          callback once all fragments are in. A slot without a new fragment
+ *          for timeout_ms is freed (mac_frag_expire(), also done by each
+ *          fragment received).
+ *
+ *          The reliable transfer engine (mac_xfer.h) already cuts its
+ *          transfers into numbered frames: mac_frag_xfer_rx(), called from
+ *          its frame callback, rebuilds them in the pool with the transfer ID
+ *          as tag, no fragment header needed.
+ *
+ *          Times are in ms, from any free running clock of the application.
+ *          The functions are not reentrant: call them from one context.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MAC_FRAG_H_
+#define _MAC_FRAG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+#include <mac_xfer.h>
+
+/* Fragment header */
+#define MAC_FRAG_TAG_IDX        0
+#define MAC_FRAG_INDEX_IDX      1
+#define MAC_FRAG_LAST_IDX       2
+#define MAC_FRAG_UNIT_IDX       3
+#define MAC_FRAG_HDR_LEN        5
+
+#define MAC_FRAG_MAX_FRAGS      256                     /* fragments of a datagram */
+
+/* Fragment unit filling frames of frame_len bytes (FCS included) behind a MAC header of hdr_len bytes */
+#define MAC_FRAG_UNIT(frame_len, hdr_len)   ((frame_len) - (hdr_len) - 2 - MAC_FRAG_HDR_LEN)
+
+typedef struct
+{
+    const uint8_t  *data;
+    uint16_t        len;
+    uint16_t        unit;
+    uint16_t        count;                      /* fragments */
+    uint16_t        index;                      /* next fragment */
+    uint8_t         tag;
+} mac_frag_tx_t;
+
+typedef struct
+{
+    uint8_t        *buf;
+    uint8_t         in_use;
+    uint8_t         tag;
+    uint16_t        src;
+    uint16_t        count;                      /* fragments of the datagram */
+    uint16_t        received;                   /* fragments in */
+    uint16_t        len;                        /* end of the furthest fragment in */
+    uint32_t        last_ms;                    /* time of the last new fragment */
+    uint8_t         map[MAC_FRAG_MAX_FRAGS / 8];
+} mac_frag_slot_t;
+
+typedef struct
+{
+    uint32_t        datagrams;                  /* datagrams completed */
+    uint32_t        fragments;                  /* new fragments */
+    uint32_t        dup;                        /* copies dropped */
+    uint32_t        bad;                        /* fragments dropped: header, size */
+    uint32_t        no_slot;                    /* fragments dropped: all slots busy */
+    uint32_t        timeouts;                   /* datagrams dropped incomplete */
+} mac_frag_stats_t;
+
+/* Datagram callback: data is valid until the callback returns */
+typedef void (*mac_frag_cb_t)(uint16_t src, uint8_t tag, const uint8_t *data, uint16_t len);
+
+typedef struct
+{
+    mac_frag_slot_t *slot;
+    uint8_t         slots;
+    uint16_t        buf_len;                    /* bytes per slot */
+    uint32_t        timeout_ms;
+    mac_frag_cb_t   cb;
+    mac_frag_stats_t stats;
+} mac_frag_pool_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_frag_tx_init()
+ *
+ * @brief Start cutting a buffer into fragments. The buffer must stay unchanged until the last fragment is written.
+ *
+ * @param tx - fragmenter
+ * @param data - buffer
+ * @param len - buffer length, at least 1 byte
+ * @param unit - fragment size, e.g. MAC_FRAG_UNIT(127, mac header length)
+ * @param tag - datagram number
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the buffer needs more than MAC_FRAG_MAX_FRAGS fragments
+ */
+int mac_frag_tx_init(mac_frag_tx_t *tx, const uint8_t *data, uint16_t len, uint16_t unit, uint8_t tag);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_frag_tx_next()
+ *
+ * @brief Write the header and the data of the next fragment.
+ *
+ * @param tx - fragmenter
+ * @param buf - frame payload
+ * @param buf_len - room in buf, at least MAC_FRAG_HDR_LEN + unit
+ *
+ * @return bytes written, or 0 when all fragments have been written (or buf is too short)
+ */
+uint16_t mac_frag_tx_next(mac_frag_tx_t *tx, uint8_t *buf, uint16_t buf_len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_frag_pool_init()
+ *
+ * @brief Start a reassembly pool with all slots free.
+ *
+ * @param pool - pool
+ * @param slots - slot storage
+ * @param count - slots, 1 to 255
+ * @param buf - datagram storage, count * buf_len bytes
+ * @param buf_len - longest datagram
+ * @param timeout_ms - lifetime of an incomplete datagram without new fragment
+ * @param cb - datagram callback
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR for a bad parameter
+ */
+int mac_frag_pool_init(mac_frag_pool_t *pool, mac_frag_slot_t *slots, uint8_t count, uint8_t *buf, uint16_t buf_len,
+                       uint32_t timeout_ms, mac_frag_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_frag_put()
+ *
+ * @brief Add a fragment to its datagram, calling the callback if it completes it. A fragment with a different count
+ *        than the datagram in progress for the same source and tag starts a new datagram.
+ *
+ * @param pool - pool
+ * @param src - source address
+ * @param tag - datagram number
+ * @param index - fragment number
+ * @param count - fragments of the datagram
+ * @param offset - position of the fragment in the datagram
+ * @param data - fragment data
+ * @param len - fragment length
+ * @param now_ms - current time
+ *
+ * @return DWT_SUCCESS (also for a copy), or DWT_ERROR if the fragment was dropped
+ */
+int mac_frag_put(mac_frag_pool_t *pool, uint16_t src, uint8_t tag, uint16_t index, uint16_t count, uint32_t offset,
+                 const uint8_t *data, uint16_t len, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_frag_rx()
+ *
+ * @brief Add a fragment written by mac_frag_tx_next(): parse its header and call mac_frag_put().
+ *
+ * @param pool - pool
+ * @param src - source address of the frame
+ * @param frag - fragment header and data (frame payload)
+ * @param len - frame payload length
+ * @param now_ms - current time
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the fragment was dropped
+ */
+int mac_frag_rx(mac_frag_pool_t *pool, uint16_t src, const uint8_t *frag, uint16_t len, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_frag_xfer_rx()
+ *
+ * @brief Add a frame delivered by the reliable transfer engine (mac_xfer_init() rx_cb) to its transfer.
+ *
+ * @param pool - pool
+ * @param rx - frame
+ * @param now_ms - current time
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the frame was dropped
+ */
+int mac_frag_xfer_rx(mac_frag_pool_t *pool, const mac_xfer_rx_t *rx, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_frag_expire()
+ *
+ * @brief Free the slots of the incomplete datagrams without new fragment for the pool timeout.
+ *
+ * @param pool - pool
+ * @param now_ms - current time
+ *
+ * @return number of datagrams dropped
+ */
+int mac_frag_expire(mac_frag_pool_t *pool, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_frag_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @param pool - pool
+ *
+ * @return counters
+ */
+const mac_frag_stats_t * mac_frag_get_stats(const mac_frag_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MAC_FRAG_H_ */
@@ -0,0 +1,357 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_pend_table.c
+ * @brief   Host-side table of short addresses with data pending (LE_PEND)
+ *
+ *          See mac_pend_table.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <mac_pend_table.h>
+
+#define MAC_PEND_ADDR_NONE      0xFFFE      /* "no short address", never added */
+#define MAC_PEND_HASH_MULT      40503U      /* 2^16 / golden ratio */
+
+static const uint16_t le_en[MAC_PEND_HW_SLOTS] =
+{
+    DWT_FF_MAC_LE0_EN, DWT_FF_MAC_LE1_EN, DWT_FF_MAC_LE2_EN, DWT_FF_MAC_LE3_EN
+};
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pend_home()
+ *
+ * @brief Home entry of an address (Fibonacci hash: sequential addresses spread over the table).
+ *
+ * @param tbl - table
+ * @param addr - short address
+ *
+ * @return entry index
+ */
+static uint16_t pend_home(const mac_pend_table_t *tbl, uint16_t addr)
+{
+    return (uint16_t)((uint16_t)(addr * MAC_PEND_HASH_MULT) >> tbl->shift) & tbl->mask;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pend_find()
+ *
+ * @brief Find the entry of an address, or the free entry where it would go.
+ *
+ * @param tbl - table
+ * @param addr - short address
+ *
+ * @return entry index
+ */
+static uint16_t pend_find(const mac_pend_table_t *tbl, uint16_t addr)
+{
+    uint16_t i = pend_home(tbl, addr);
+
+    /* The load is at most 3/4, so there is always a free entry */
+    while ((tbl->entry[i].addr != addr) && (tbl->entry[i].addr != MAC_PEND_ADDR_EMPTY))
+    {
+        i = (i + 1) & tbl->mask;
+    }
+    return i;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pend_hw_slot()
+ *
+ * @brief Find the hardware slot of an address.
+ *
+ * @param tbl - table
+ * @param addr - short address
+ *
+ * @return slot, or -1
+ */
+static int pend_hw_slot(const mac_pend_table_t *tbl, uint16_t addr)
+{
+    int s;
+
+    for (s = 0; s < MAC_PEND_HW_SLOTS; s++)
+    {
+        if (tbl->hw[s] == addr)
+        {
+            return s;
+        }
+    }
+    return -1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pend_hw_write()
+ *
+ * @brief Write a hardware slot.
+ *
+ * @param tbl - table
+ * @param slot - slot
+ * @param addr - short address, or MAC_PEND_ADDR_EMPTY
+ *
+ * @return none
+ */
+static void pend_hw_write(mac_pend_table_t *tbl, int slot, uint16_t addr)
+{
+    tbl->hw[slot] = addr;
+    dwt_configure_le_address(addr, slot);
+    tbl->stats.le_writes++;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pend_ff_update()
+ *
+ * @brief Enable the LE bits of the slots in use in the frame filter, if they changed.
+ *
+ * @param tbl - table
+ *
+ * @return none
+ */
+static void pend_ff_update(mac_pend_table_t *tbl)
+{
+    uint16_t le = 0;
+    int s;
+
+    for (s = 0; s < MAC_PEND_HW_SLOTS; s++)
+    {
+        if (tbl->hw[s] != MAC_PEND_ADDR_EMPTY)
+        {
+            le |= le_en[s];
+        }
+    }
+    if (le != tbl->ff_le)
+    {
+        tbl->ff_le = le;
+        dwt_configureframefilter(DWT_FF_ENABLE_802_15_4, tbl->ff_mode | le);
+    }
+}
+
+int mac_pend_table_init(mac_pend_table_t *tbl, mac_pend_entry_t *entries, uint16_t count, uint16_t ff_mode)
+{
+    uint16_t i;
+    uint8_t bits = 0;
+
+    if ((entries == NULL) || (count < 4) || (count > MAC_PEND_MAX_ENTRIES) || ((count & (count - 1)) != 0))
+    {
+        return DWT_ERROR;
+    }
+
+    while ((1U << bits) < count)
+    {
+        bits++;
+    }
+
+    memset(tbl, 0, sizeof(*tbl));
+    tbl->entry = entries;
+    tbl->mask = count - 1;
+    tbl->limit = count - count / 4;
+    tbl->shift = 16 - bits;
+    tbl->ff_mode = ff_mode;
+
+    for (i = 0; i < count; i++)
+    {
+        entries[i].addr = MAC_PEND_ADDR_EMPTY;
+        entries[i].polls = 0;
+    }
+    for (i = 0; i < MAC_PEND_HW_SLOTS; i++)
+    {
+        pend_hw_write(tbl, i, MAC_PEND_ADDR_EMPTY);
+    }
+    tbl->stats.le_writes = 0;
+
+    dwt_configureframefilter(DWT_FF_ENABLE_802_15_4, ff_mode);
+
+    return DWT_SUCCESS;
+}
+
+int mac_pend_table_add(mac_pend_table_t *tbl, uint16_t addr)
+{
+    uint16_t i;
+
+    if ((addr == MAC_PEND_ADDR_EMPTY) || (addr == MAC_PEND_ADDR_NONE))
+    {
+        return DWT_ERROR;
+    }
+
+    i = pend_find(tbl, addr);
+    if (tbl->entry[i].addr == addr)
+    {
+        return DWT_SUCCESS;
+    }
+    if (tbl->count >= tbl->limit)
+    {
+        tbl->stats.full++;
+        return DWT_ERROR;
+    }
+
+    tbl->entry[i].addr = addr;
+    tbl->entry[i].polls = 0;
+    tbl->count++;
+
+    return DWT_SUCCESS;
+}
+
+int mac_pend_table_remove(mac_pend_table_t *tbl, uint16_t addr)
+{
+    uint16_t i, j, k;
+    int slot;
+
+    if (addr == MAC_PEND_ADDR_EMPTY)
+    {
+        return DWT_ERROR;
+    }
+
+    i = pend_find(tbl, addr);
+    if (tbl->entry[i].addr != addr)
+    {
+        return DWT_ERROR;
+    }
+
+    /* Move back the entries of the probe run that could not be placed at i, so lookups never stop early */
+    j = i;
+    for (;;)
+    {
+        j = (j + 1) & tbl->mask;
+        if (tbl->entry[j].addr == MAC_PEND_ADDR_EMPTY)
+        {
+            break;
+        }
+        k = pend_home(tbl, tbl->entry[j].addr);
+        if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+        {
+            continue;
+        }
+        tbl->entry[i] = tbl->entry[j];
+        i = j;
+    }
+    tbl->entry[i].addr = MAC_PEND_ADDR_EMPTY;
+    tbl->entry[i].polls = 0;
+    tbl->count--;
+
+    slot = pend_hw_slot(tbl, addr);
+    if (slot >= 0)
+    {
+        pend_hw_write(tbl, slot, MAC_PEND_ADDR_EMPTY);
+        pend_ff_update(tbl);
+    }
+
+    return DWT_SUCCESS;
+}
+
+mac_pend_entry_t * mac_pend_table_lookup(const mac_pend_table_t *tbl, uint16_t addr)
+{
+    uint16_t i;
+
+    if (addr == MAC_PEND_ADDR_EMPTY)
+    {
+        return NULL;
+    }
+
+    i = pend_find(tbl, addr);
+    return (tbl->entry[i].addr == addr) ? &tbl->entry[i] : NULL;
+}
+
+int mac_pend_table_poll(mac_pend_table_t *tbl, uint16_t addr)
+{
+    mac_pend_entry_t *e = mac_pend_table_lookup(tbl, addr);
+
+    tbl->stats.polls++;
+    if (e == NULL)
+    {
+        return MAC_PEND_NONE;
+    }
+
+    if (e->polls != UINT16_MAX)
+    {
+        e->polls++;
+    }
+    if (pend_hw_slot(tbl, addr) >= 0)
+    {
+        tbl->stats.hw++;
+        return MAC_PEND_HW;
+    }
+    tbl->stats.sw++;
+    return MAC_PEND_SW;
+}
+
+int mac_pend_table_sync(mac_pend_table_t *tbl)
+{
+    uint16_t top[MAC_PEND_HW_SLOTS];
+    uint16_t top_polls[MAC_PEND_HW_SLOTS];
+    uint8_t keep[MAC_PEND_HW_SLOTS];
+    uint32_t writes = tbl->stats.le_writes;
+    int n = 0;
+    int s, t;
+    uint32_t i;
+
+    /* The MAC_PEND_HW_SLOTS most polled addresses, in decreasing order */
+    for (i = 0; i <= tbl->mask; i++)
+    {
+        mac_pend_entry_t *e = &tbl->entry[i];
+
+        if (e->addr == MAC_PEND_ADDR_EMPTY)
+        {
+            continue;
+        }
+        if ((n < MAC_PEND_HW_SLOTS) || (e->polls > top_polls[n - 1]))
+        {
+            t = (n < MAC_PEND_HW_SLOTS) ? n++ : (n - 1);
+            while ((t > 0) && (top_polls[t - 1] < e->polls))
+            {
+                top[t] = top[t - 1];
+                top_polls[t] = top_polls[t - 1];
+                t--;
+            }
+            top[t] = e->addr;
+            top_polls[t] = e->polls;
+        }
+        e->polls >>= 1;
+    }
+
+    /* Slots already holding one of them are kept, the others get the rest */
+    for (s = 0; s < MAC_PEND_HW_SLOTS; s++)
+    {
+        keep[s] = 0;
+        for (t = 0; t < n; t++)
+        {
+            if (tbl->hw[s] == top[t])
+            {
+                keep[s] = 1;
+                top[t] = MAC_PEND_ADDR_EMPTY;
+                break;
+            }
+        }
+    }
+    t = 0;
+    for (s = 0; s < MAC_PEND_HW_SLOTS; s++)
+    {
+        if (keep[s])
+        {
+            continue;
+        }
+        while ((t < n) && (top[t] == MAC_PEND_ADDR_EMPTY))
+        {
+            t++;
+        }
+        if (t < n)
+        {
+            pend_hw_write(tbl, s, top[t++]);
+        }
+        else if (tbl->hw[s] != MAC_PEND_ADDR_EMPTY)
+        {
+            pend_hw_write(tbl, s, MAC_PEND_ADDR_EMPTY);
+        }
+    }
+
+    pend_ff_update(tbl);
+
+    return (int)(tbl->stats.le_writes - writes);
+}
+
+const mac_pend_stats_t * mac_pend_table_get_stats(const mac_pend_table_t *tbl)
+{
+    return &tbl->stats;
+}
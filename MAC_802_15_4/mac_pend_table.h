@@ -0,0 +1,174 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_pend_table.h
+ * @brief   Host-side table of short addresses with data pending (LE_PEND)
+ *
+ *          The DW IC sets the frame pending bit of the auto-ACK to a data
+ *          request when the source address of the request is in one of its
+ *          four LE_PEND registers (dwt_configure_le_address(), with the
+ *          DWT_FF_MAC_LEx_EN frame filter bits). A coordinator serving more
+ *          sleepy tags than that keeps the full set here:
+ *
+ *          - an open-addressing hash of 16-bit short addresses (linear
+ *            probing, deletion by backward shift, no tombstones), 4 bytes per
+ *            entry in storage given by the application, so a lookup is one or
+ *            two probes at the load the table allows (3/4)
+ *          - a poll count per address, aged by mac_pend_table_sync()
+ *          - mac_pend_table_sync() puts the most polled addresses in the four
+ *            LE_PEND registers, writing only the slots that changed
+ *
+ *          The hardware ACKs the hot tags with the pending bit set. For the
+ *          other ones mac_pend_table_poll(), called for each data request
+ *          received, tells the application the tag has data pending although
+ *          the ACK did not say so (MAC_PEND_SW), the fast software path.
+ *
+ *          Addresses 0xFFFE and 0xFFFF (no short address, broadcast) cannot
+ *          be added. The functions are not reentrant: call them from one
+ *          context.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MAC_PEND_TABLE_H_
+#define _MAC_PEND_TABLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define MAC_PEND_HW_SLOTS       4           /* LE_PEND registers, LE0 to LE3 */
+#define MAC_PEND_ADDR_EMPTY     0xFFFF      /* free entry / hardware slot */
+#define MAC_PEND_MAX_ENTRIES    32768
+
+/* mac_pend_table_poll() results */
+#define MAC_PEND_NONE           0           /* no data pending */
+#define MAC_PEND_HW             1           /* data pending, the auto-ACK had the pending bit set */
+#define MAC_PEND_SW             2           /* data pending, not in a hardware slot: the ACK did not say so */
+
+typedef struct
+{
+    uint16_t    addr;
+    uint16_t    polls;                      /* data requests since the last sync(s), halved at each sync */
+} mac_pend_entry_t;
+
+typedef struct
+{
+    uint32_t    polls;                      /* mac_pend_table_poll() calls */
+    uint32_t    hw;                         /* ... MAC_PEND_HW */
+    uint32_t    sw;                         /* ... MAC_PEND_SW */
+    uint32_t    le_writes;                  /* LE_PEND register writes */
+    uint32_t    full;                       /* mac_pend_table_add() refused, table full */
+} mac_pend_stats_t;
+
+typedef struct
+{
+    mac_pend_entry_t *entry;
+    uint16_t    mask;                       /* entries - 1 */
+    uint16_t    count;                      /* addresses in the table */
+    uint16_t    limit;                      /* most addresses allowed (3/4 of the entries) */
+    uint8_t     shift;                      /* hash shift, 16 - log2(entries) */
+    uint16_t    ff_mode;                    /* frame filter mode without the LE bits */
+    uint16_t    ff_le;                      /* DWT_FF_MAC_LEx_EN bits programmed */
+    uint16_t    hw[MAC_PEND_HW_SLOTS];      /* LE_PEND registers contents */
+    mac_pend_stats_t stats;
+} mac_pend_table_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_pend_table_init()
+ *
+ * @brief Start an empty table, clear the LE_PEND registers and set the frame filter (DWT_FF_ENABLE_802_15_4) to
+ *        ff_mode. The LE bits are added by mac_pend_table_sync() for the slots in use.
+ *
+ * @param tbl - table
+ * @param entries - storage
+ * @param count - entries in the storage, a power of 2 up to MAC_PEND_MAX_ENTRIES
+ * @param ff_mode - frame filter mode (DWT_FF_..._EN), without DWT_FF_MAC_LEx_EN
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR for a bad count
+ */
+int mac_pend_table_init(mac_pend_table_t *tbl, mac_pend_entry_t *entries, uint16_t count, uint16_t ff_mode);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_pend_table_add()
+ *
+ * @brief Mark an address as having data pending. It is programmed into a hardware slot by the next sync if it is
+ *        among the most polled ones.
+ *
+ * @param tbl - table
+ * @param addr - short address
+ *
+ * @return DWT_SUCCESS (also if already there), or DWT_ERROR if the table is full or the address is reserved
+ */
+int mac_pend_table_add(mac_pend_table_t *tbl, uint16_t addr);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_pend_table_remove()
+ *
+ * @brief Clear the data pending of an address. Its hardware slot, if any, is freed at once.
+ *
+ * @param tbl - table
+ * @param addr - short address
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the address was not in the table
+ */
+int mac_pend_table_remove(mac_pend_table_t *tbl, uint16_t addr);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_pend_table_lookup()
+ *
+ * @brief Find the entry of an address.
+ *
+ * @param tbl - table
+ * @param addr - short address
+ *
+ * @return entry, or NULL if the address has no data pending
+ */
+mac_pend_entry_t * mac_pend_table_lookup(const mac_pend_table_t *tbl, uint16_t addr);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_pend_table_poll()
+ *
+ * @brief Account for a data request received from an address and tell how it is to be served. Call for each data
+ *        request, right after it is received.
+ *
+ * @param tbl - table
+ * @param addr - source short address of the request
+ *
+ * @return MAC_PEND_NONE, MAC_PEND_HW or MAC_PEND_SW
+ */
+int mac_pend_table_poll(mac_pend_table_t *tbl, uint16_t addr);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_pend_table_sync()
+ *
+ * @brief Put the most polled addresses into the LE_PEND registers and age the poll counts. An address already in a
+ *        slot keeps it, only the slots that change are written, and the frame filter only when the set of slots in
+ *        use changes. Call periodically, e.g. once per beacon interval, not during a reception.
+ *
+ * @param tbl - table
+ *
+ * @return number of LE_PEND registers written
+ */
+int mac_pend_table_sync(mac_pend_table_t *tbl);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_pend_table_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @param tbl - table
+ *
+ * @return counters
+ */
+const mac_pend_stats_t * mac_pend_table_get_stats(const mac_pend_table_t *tbl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MAC_PEND_TABLE_H_ */
@@ -0,0 +1,844 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_xfer.c
+ * @brief   Event driven reliable data transfer engine (auto-ACK or block ACK)
+ *
+ *          See mac_xfer.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <shared_defines.h>
+#include <mac_xfer.h>
+#ifdef MAC_XFER_FRAME_POOL
+#include <dw_framepool.h>
+#endif
+
+#define XFER_FC_DATA            0x41    /* data frame, PAN ID compression */
+#define XFER_FC_DATA_AR         0x61    /* ... ACK requested */
+#define XFER_FC_ADDR            0x88    /* 16-bit addresses */
+#define XFER_ACK_LEN            5       /* 802.15.4 ACK, with FCS */
+
+/* System time (dwt_readsystimestamphi32(), 256 device time units) per UWB microsecond */
+#define XFER_SYSTIME_PER_UUS    256
+
+/* Engine state, only changed by the API calls when idle and by the driver callbacks */
+static struct
+{
+    mac_xfer_config_t   cfg;
+    mac_xfer_done_cb_t  done_cb;
+    mac_xfer_rx_cb_t    rx_cb;
+    volatile mac_xfer_state_e state;
+    uint8_t         seq;                            /* next 802.15.4 sequence number */
+    uint8_t         ack_seq;                        /* auto-ACK: sequence number of the ACK request */
+    mac_xfer_stats_t stats;
+    /* sender */
+    uint16_t        peer;
+    uint8_t         id;                             /* transfer ID */
+    const uint8_t   *data;
+    uint32_t        len;
+    uint16_t        total;                          /* frames */
+    uint16_t        base;                           /* first frame not acknowledged */
+    uint16_t        next;                           /* first frame never sent */
+    uint32_t        acked;                          /* bit i: frame base + i acknowledged */
+    uint32_t        lost;                           /* bit i: frame base + i reported missing */
+    uint8_t         tries[MAC_XFER_WINDOW_MAX];     /* transmissions, by frame % window */
+    uint32_t        sent_at[MAC_XFER_WINDOW_MAX];   /* system time of the last TX, by frame % window */
+    uint16_t        burst[MAC_XFER_WINDOW_MAX];     /* frames of the burst in progress */
+    uint8_t         burst_len;
+    uint8_t         burst_pos;                      /* next frame of the burst to send */
+    uint16_t        burst_flen;                     /* length of that frame, already written */
+    uint8_t         ack_miss;                       /* ACK requests not answered in a row */
+    uint32_t        now;                            /* system time at the last burst start */
+    uint64_t        elapsed;                        /* system time since mac_xfer_send() */
+    uint32_t        tx;                             /* frames sent in the transfer */
+    uint16_t        region;                         /* TX buffer offset of every other frame, 0 without pipelining */
+    /* receiver */
+    uint16_t        rx_peer;
+    uint8_t         rx_id;
+    uint8_t         rx_valid;                       /* rx_peer/rx_id hold a transfer */
+    uint16_t        rx_next;                        /* first frame missing */
+    uint32_t        rx_map;                         /* bit i: frame rx_next + 1 + i received */
+    uint8_t         hdr[MAC_XFER_DATA_HDR_LEN];
+    uint8_t         rx_buf[MAC_XFER_FRAME_LEN_MAX];
+} xfer;
+
+static void xfer_tx_done_cb(const dwt_cb_data_t *cb_data);
+static void xfer_rx_ok_cb(const dwt_cb_data_t *cb_data);
+static void xfer_rx_to_cb(const dwt_cb_data_t *cb_data);
+static void xfer_rx_err_cb(const dwt_cb_data_t *cb_data);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_msg_init()
+ *
+ * @brief Write the common part of a frame (frame control, sequence number, PAN ID, addresses, function code and
+ *        transfer ID).
+ *
+ * @param buf - frame buffer
+ * @param fc0 - first frame control byte
+ * @param func - function code
+ * @param dst - destination address
+ * @param id - transfer ID
+ *
+ * @return none
+ */
+static void xfer_msg_init(uint8_t *buf, uint8_t fc0, uint8_t func, uint16_t dst, uint8_t id)
+{
+    buf[0] = fc0;
+    buf[1] = XFER_FC_ADDR;
+    buf[MAC_XFER_MSG_SN_IDX] = xfer.seq++;
+    buf[MAC_XFER_MSG_PAN_IDX] = (uint8_t)xfer.cfg.pan_id;
+    buf[MAC_XFER_MSG_PAN_IDX + 1] = (uint8_t)(xfer.cfg.pan_id >> 8);
+    buf[MAC_XFER_MSG_DST_IDX] = (uint8_t)dst;
+    buf[MAC_XFER_MSG_DST_IDX + 1] = (uint8_t)(dst >> 8);
+    buf[MAC_XFER_MSG_SRC_IDX] = (uint8_t)xfer.cfg.addr;
+    buf[MAC_XFER_MSG_SRC_IDX + 1] = (uint8_t)(xfer.cfg.addr >> 8);
+    buf[MAC_XFER_MSG_FUNC_IDX] = func;
+    buf[MAC_XFER_MSG_ID_IDX] = id;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_msg_check()
+ *
+ * @brief Read the header of the received frame and check it is a transfer frame with the given function code, on our
+ *        PAN and addressed to this device.
+ *
+ * @param cb_data - RX callback data
+ * @param func - expected function code
+ * @param len - header length (without FCS)
+ *
+ * @return source address, or -1 if the frame is not the expected one
+ */
+static int32_t xfer_msg_check(const dwt_cb_data_t *cb_data, uint8_t func, uint16_t len)
+{
+    if ((cb_data->datalength > MAC_XFER_FRAME_LEN_MAX) || (cb_data->datalength < (len + FCS_LEN)))
+    {
+        return -1;
+    }
+    dwt_readrxdata(xfer.rx_buf, len, 0);
+
+    if (((xfer.rx_buf[0] != XFER_FC_DATA) && (xfer.rx_buf[0] != XFER_FC_DATA_AR)) ||
+        (xfer.rx_buf[1] != XFER_FC_ADDR) ||
+        (xfer.rx_buf[MAC_XFER_MSG_FUNC_IDX] != func) ||
+        (xfer.rx_buf[MAC_XFER_MSG_PAN_IDX] != (uint8_t)xfer.cfg.pan_id) ||
+        (xfer.rx_buf[MAC_XFER_MSG_PAN_IDX + 1] != (uint8_t)(xfer.cfg.pan_id >> 8)) ||
+        (xfer.rx_buf[MAC_XFER_MSG_DST_IDX] != (uint8_t)xfer.cfg.addr) ||
+        (xfer.rx_buf[MAC_XFER_MSG_DST_IDX + 1] != (uint8_t)(xfer.cfg.addr >> 8)))
+    {
+        return -1;
+    }
+
+    return xfer.rx_buf[MAC_XFER_MSG_SRC_IDX] | ((uint16_t)xfer.rx_buf[MAC_XFER_MSG_SRC_IDX + 1] << 8);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_rx_listen()
+ *
+ * @brief Receiver: enable the receiver, without timeout, for the next frame.
+ *
+ * @return none
+ */
+static void xfer_rx_listen(void)
+{
+    xfer.state = MAC_XFER_STATE_LISTEN;
+    dwt_setrxtimeout(0);
+    dwt_setpreambledetecttimeout(0);
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_clock()
+ *
+ * @brief Sender: read the system time and add the time since the last read to the transfer time. Reads are less than
+ *        the system time wrap (17 s) apart.
+ *
+ * @return none
+ */
+static void xfer_clock(void)
+{
+    uint32_t now = dwt_readsystimestamphi32();
+
+    xfer.elapsed += now - xfer.now;
+    xfer.now = now;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_done()
+ *
+ * @brief Sender: end the transfer and report the result.
+ *
+ * @param status - transfer status
+ *
+ * @return none
+ */
+static void xfer_done(mac_xfer_status_e status)
+{
+    mac_xfer_result_t result;
+    uint16_t acked = xfer.base;
+    uint8_t i;
+
+    xfer_clock();
+    xfer.state = MAC_XFER_STATE_IDLE;
+
+    for (i = 0; i < (xfer.next - xfer.base); i++)
+    {
+        acked += (xfer.acked >> i) & 1;
+    }
+
+    result.status = status;
+    result.peer = xfer.peer;
+    result.id = xfer.id;
+    result.frames = xfer.total;
+    result.acked = acked;
+    result.tx = xfer.tx;
+    result.bytes = (status == MAC_XFER_OK) ? xfer.len : (uint32_t)xfer.base * xfer.cfg.payload_len;
+    /* 1 us = 249.6 system time units */
+    result.elapsed_us = (uint32_t)((xfer.elapsed * 10) / 2496);
+    result.kbps = (result.elapsed_us != 0) ? (uint32_t)(((uint64_t)result.bytes * 8000) / result.elapsed_us) : 0;
+
+    xfer.stats.transfers++;
+    if (status != MAC_XFER_OK)
+    {
+        xfer.stats.failed++;
+    }
+
+    if (xfer.done_cb != NULL)
+    {
+        xfer.done_cb(&result);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_frame_write()
+ *
+ * @brief Sender: write a data frame (header and payload) into a region of the TX buffer.
+ *
+ * @param pos - position in the burst
+ *
+ * @return frame length, with FCS
+ */
+static uint16_t xfer_frame_write(uint8_t pos)
+{
+    uint16_t idx = xfer.burst[pos];
+    uint16_t offset = (pos & 1) ? xfer.region : 0;
+    uint32_t start = (uint32_t)idx * xfer.cfg.payload_len;
+    uint16_t plen = ((xfer.len - start) < xfer.cfg.payload_len) ? (uint16_t)(xfer.len - start) : xfer.cfg.payload_len;
+    uint8_t auto_ack = (xfer.cfg.ack == MAC_XFER_ACK_AUTO);
+    uint8_t last = (pos == (xfer.burst_len - 1));
+
+    xfer_msg_init(xfer.hdr, auto_ack ? XFER_FC_DATA_AR : XFER_FC_DATA, MAC_XFER_FUNC_DATA, xfer.peer, xfer.id);
+    xfer.hdr[MAC_XFER_DATA_FLAGS_IDX] = (!auto_ack && last) ? MAC_XFER_FLAG_ACK_REQ : 0;
+    xfer.hdr[MAC_XFER_DATA_INDEX_IDX] = (uint8_t)idx;
+    xfer.hdr[MAC_XFER_DATA_INDEX_IDX + 1] = (uint8_t)(idx >> 8);
+    xfer.hdr[MAC_XFER_DATA_TOTAL_IDX] = (uint8_t)xfer.total;
+    xfer.hdr[MAC_XFER_DATA_TOTAL_IDX + 1] = (uint8_t)(xfer.total >> 8);
+    xfer.hdr[MAC_XFER_DATA_UNIT_IDX] = (uint8_t)xfer.cfg.payload_len;
+    xfer.hdr[MAC_XFER_DATA_UNIT_IDX + 1] = (uint8_t)(xfer.cfg.payload_len >> 8);
+    if (last)
+    {
+        xfer.ack_seq = xfer.hdr[MAC_XFER_MSG_SN_IDX];
+    }
+
+    dwt_writetxdata(MAC_XFER_DATA_HDR_LEN, xfer.hdr, offset);
+    dwt_writetxdata(plen, (uint8_t *)&xfer.data[start], offset + MAC_XFER_DATA_HDR_LEN);
+
+    return MAC_XFER_DATA_HDR_LEN + plen + FCS_LEN;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_frame_send()
+ *
+ * @brief Sender: send the next frame of the burst, already written, and write the one after it into the other TX
+ *        buffer region while it is on the air. The last frame of the burst requests the (block) ACK.
+ *
+ * @param len - frame length, with FCS
+ *
+ * @return none
+ */
+static void xfer_frame_send(uint16_t len)
+{
+    uint8_t pos = xfer.burst_pos++;
+    uint16_t idx = xfer.burst[pos];
+    uint8_t slot = idx % MAC_XFER_WINDOW_MAX;
+    uint8_t last = (pos == (xfer.burst_len - 1));
+
+    if (xfer.tries[slot]++ != 0)
+    {
+        xfer.stats.retx++;
+    }
+    xfer.sent_at[slot] = xfer.now;
+    xfer.stats.frames_tx++;
+    xfer.tx++;
+
+    dwt_writetxfctrl(len, (pos & 1) ? xfer.region : 0, 0);
+
+    if (last)
+    {
+        xfer.state = MAC_XFER_STATE_WAIT_ACK;
+        xfer.stats.ack_req++;
+        dwt_setrxaftertxdelay(0);
+        dwt_setrxtimeout(xfer.cfg.ack_timeout_uus);
+        dwt_setpreambledetecttimeout(0);
+        dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+    }
+    else
+    {
+        xfer.state = MAC_XFER_STATE_TX;
+        dwt_starttx(DWT_START_TX_IMMEDIATE);
+        if (xfer.region != 0)
+        {
+            xfer.burst_flen = xfer_frame_write(xfer.burst_pos);
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_burst()
+ *
+ * @brief Sender: start the next burst: the frames in flight reported missing or whose retransmission timer expired,
+ *        then new frames up to the window. With nothing to send (all the frames in flight within their timer), the
+ *        first frame not acknowledged is sent again as the ACK request. Ends the transfer when a frame is out of
+ *        retries.
+ *
+ * @return none
+ */
+static void xfer_burst(void)
+{
+    uint32_t rto = xfer.cfg.rto_uus * XFER_SYSTIME_PER_UUS;
+    uint8_t window = (xfer.cfg.ack == MAC_XFER_ACK_AUTO) ? 1 : xfer.cfg.window;
+    uint8_t n = 0;
+    uint8_t i;
+
+    xfer_clock();
+
+    for (i = 0; i < (xfer.next - xfer.base); i++)
+    {
+        uint16_t idx = xfer.base + i;
+        uint8_t slot = idx % MAC_XFER_WINDOW_MAX;
+
+        if ((xfer.acked & (1UL << i)) ||
+            (!(xfer.lost & (1UL << i)) && ((xfer.now - xfer.sent_at[slot]) < rto)))
+        {
+            continue;
+        }
+        if (xfer.tries[slot] > xfer.cfg.max_retries)
+        {
+            xfer_done(MAC_XFER_ERR_RETRY);
+            return;
+        }
+        xfer.burst[n++] = idx;
+    }
+    xfer.lost = 0;
+
+    while ((xfer.next < xfer.total) && ((xfer.next - xfer.base) < window))
+    {
+        xfer.tries[xfer.next % MAC_XFER_WINDOW_MAX] = 0;
+        xfer.burst[n++] = xfer.next++;
+    }
+
+    if (n == 0)
+    {
+        if (xfer.tries[xfer.base % MAC_XFER_WINDOW_MAX] > xfer.cfg.max_retries)
+        {
+            xfer_done(MAC_XFER_ERR_RETRY);
+            return;
+        }
+        xfer.burst[n++] = xfer.base;
+    }
+
+    xfer.burst_len = n;
+    xfer.burst_pos = 0;
+    xfer_frame_send(xfer_frame_write(0));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_ack()
+ *
+ * @brief Sender: apply a (block) ACK, slide the window and go on with the next burst, or end the transfer.
+ *
+ * @param next - first frame missing at the receiver
+ * @param map - bit i: frame next + 1 + i received
+ *
+ * @return none
+ */
+static void xfer_ack(uint16_t next, uint32_t map)
+{
+    uint8_t in_flight = xfer.next - xfer.base;
+    uint8_t i;
+
+    xfer.stats.acks++;
+    xfer.ack_miss = 0;
+
+    for (i = 0; i < in_flight; i++)
+    {
+        uint16_t idx = xfer.base + i;
+        uint16_t d = idx - next;
+
+        if ((idx < next) || ((d >= 1) && (d <= 32) && (map & (1UL << (d - 1)))))
+        {
+            xfer.acked |= 1UL << i;
+        }
+    }
+    /* The ACK request was the last frame sent: the frames in flight not acknowledged are lost */
+    xfer.lost = ~xfer.acked & ((in_flight < 32) ? ((1UL << in_flight) - 1) : 0xFFFFFFFFUL);
+
+    while ((xfer.base < xfer.next) && (xfer.acked & 1))
+    {
+        xfer.acked >>= 1;
+        xfer.lost >>= 1;
+        xfer.base++;
+    }
+
+    if (xfer.base >= xfer.total)
+    {
+        xfer_done(MAC_XFER_OK);
+        return;
+    }
+
+    xfer_burst();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_ack_missed()
+ *
+ * @brief Sender: no (block) ACK for the request. Go on with the next burst (the frames whose timer expired, or the
+ *        request again), or end the transfer after max_retries requests in a row.
+ *
+ * @return none
+ */
+static void xfer_ack_missed(void)
+{
+    xfer.stats.ack_timeouts++;
+
+    if (xfer.cfg.ack == MAC_XFER_ACK_AUTO)
+    {
+        /* stop-and-wait: the frame is known lost */
+        xfer.lost = 1;
+    }
+    else if (++xfer.ack_miss > xfer.cfg.max_retries)
+    {
+        xfer_done(MAC_XFER_ERR_ACK);
+        return;
+    }
+
+    xfer_burst();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_back_send()
+ *
+ * @brief Receiver: answer an ACK request with a block ACK, and listen again after it.
+ *
+ * @param peer - sender address
+ *
+ * @return none
+ */
+static void xfer_back_send(uint16_t peer)
+{
+    uint8_t *buf = xfer.hdr;
+
+    xfer_msg_init(buf, XFER_FC_DATA, MAC_XFER_FUNC_BACK, peer, xfer.rx_id);
+    buf[MAC_XFER_BACK_NEXT_IDX] = (uint8_t)xfer.rx_next;
+    buf[MAC_XFER_BACK_NEXT_IDX + 1] = (uint8_t)(xfer.rx_next >> 8);
+    buf[MAC_XFER_BACK_MAP_IDX] = (uint8_t)xfer.rx_map;
+    buf[MAC_XFER_BACK_MAP_IDX + 1] = (uint8_t)(xfer.rx_map >> 8);
+    buf[MAC_XFER_BACK_MAP_IDX + 2] = (uint8_t)(xfer.rx_map >> 16);
+    buf[MAC_XFER_BACK_MAP_IDX + 3] = (uint8_t)(xfer.rx_map >> 24);
+
+    dwt_writetxdata(MAC_XFER_BACK_LEN, buf, 0);
+    dwt_writetxfctrl(MAC_XFER_BACK_LEN + FCS_LEN, 0, 0);
+
+    /* the receiver is enabled right after the TX, without timeout */
+    dwt_setrxaftertxdelay(0);
+    dwt_setrxtimeout(0);
+    dwt_setpreambledetecttimeout(0);
+    if (dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED) == DWT_SUCCESS)
+    {
+        xfer.stats.back_tx++;
+    }
+    else
+    {
+        xfer_rx_listen();
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_rx_data()
+ *
+ * @brief Receiver: handle a data frame: drop the copies, record the new frames in the bitmap, answer the ACK request
+ *        if any, then deliver the payload. With the double buffered RX, the block ACK is sent (or the receiver
+ *        enabled) before the payload is read, and dwt_isr() hands the buffer back to the DW IC after this callback.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return none
+ */
+static void xfer_rx_data(const dwt_cb_data_t *cb_data)
+{
+    int32_t src = xfer_msg_check(cb_data, MAC_XFER_FUNC_DATA, MAC_XFER_DATA_HDR_LEN);
+    mac_xfer_rx_t rx;
+    uint8_t *payload = &xfer.rx_buf[MAC_XFER_DATA_HDR_LEN];
+    uint8_t ack_req, auto_ack, fresh = 0;
+    uint16_t d;
+
+    if (src < 0)
+    {
+        xfer_rx_listen();
+        return;
+    }
+
+    auto_ack = (xfer.rx_buf[0] == XFER_FC_DATA_AR);
+    ack_req = (xfer.rx_buf[MAC_XFER_DATA_FLAGS_IDX] & MAC_XFER_FLAG_ACK_REQ);
+
+    rx.peer = (uint16_t)src;
+    rx.id = xfer.rx_buf[MAC_XFER_MSG_ID_IDX];
+    rx.index = xfer.rx_buf[MAC_XFER_DATA_INDEX_IDX] | ((uint16_t)xfer.rx_buf[MAC_XFER_DATA_INDEX_IDX + 1] << 8);
+    rx.frames = xfer.rx_buf[MAC_XFER_DATA_TOTAL_IDX] | ((uint16_t)xfer.rx_buf[MAC_XFER_DATA_TOTAL_IDX + 1] << 8);
+    rx.offset = (uint32_t)rx.index *
+                (xfer.rx_buf[MAC_XFER_DATA_UNIT_IDX] | ((uint16_t)xfer.rx_buf[MAC_XFER_DATA_UNIT_IDX + 1] << 8));
+    rx.len = cb_data->datalength - MAC_XFER_DATA_HDR_LEN - FCS_LEN;
+    rx.frame = NULL;
+
+    if (!xfer.rx_valid || (rx.peer != xfer.rx_peer) || (rx.id != xfer.rx_id))
+    {
+        /* new transfer */
+        xfer.rx_valid = 1;
+        xfer.rx_peer = rx.peer;
+        xfer.rx_id = rx.id;
+        xfer.rx_next = 0;
+        xfer.rx_map = 0;
+    }
+
+    d = rx.index - xfer.rx_next;
+    if (rx.index == xfer.rx_next)
+    {
+        xfer.rx_next++;
+        while (xfer.rx_map & 1)
+        {
+            xfer.rx_map >>= 1;
+            xfer.rx_next++;
+        }
+        xfer.rx_map >>= 1;
+        fresh = 1;
+    }
+    else if ((rx.index > xfer.rx_next) && (d <= 32) && !(xfer.rx_map & (1UL << (d - 1))))
+    {
+        xfer.rx_map |= 1UL << (d - 1);
+        fresh = 1;
+    }
+
+    if (!fresh)
+    {
+        xfer.stats.dup_rx++;
+    }
+#ifdef MAC_XFER_FRAME_POOL
+    else if ((rx.len != 0) && (rx.len <= DW_FRAMEPOOL_BUF_LEN))
+    {
+        /* the payload is read once, into a frame the callback can keep */
+        rx.frame = dw_frame_alloc();
+        if (rx.frame != NULL)
+        {
+            rx.frame->len = rx.len;
+            payload = rx.frame->data;
+        }
+    }
+#endif
+    rx.data = payload;
+
+    if (!xfer.cfg.rx_dbl_buff && fresh && (rx.len != 0))
+    {
+        /* single RX buffer: read the payload before the receiver is enabled again */
+        dwt_readrxdata(payload, rx.len, MAC_XFER_DATA_HDR_LEN);
+    }
+
+    if (auto_ack)
+    {
+        /* the DW IC sends the ACK, the receiver is enabled after its TX */
+        xfer.state = MAC_XFER_STATE_ACK_TX;
+    }
+    else if (ack_req)
+    {
+        xfer_back_send(rx.peer);
+    }
+    else
+    {
+        xfer_rx_listen();
+    }
+
+    if (xfer.cfg.rx_dbl_buff && fresh && (rx.len != 0))
+    {
+        /* the next frame goes to the other RX buffer while this one is read, dwt_isr() frees it after the callback */
+        dwt_readrxdata(payload, rx.len, MAC_XFER_DATA_HDR_LEN);
+    }
+
+    if (fresh)
+    {
+        xfer.stats.frames_rx++;
+        xfer.stats.bytes_rx += rx.len;
+        rx.complete = (xfer.rx_next >= rx.frames);
+        if (xfer.rx_cb != NULL)
+        {
+            xfer.rx_cb(&rx);
+        }
+#ifdef MAC_XFER_FRAME_POOL
+        dw_frame_unref(rx.frame);
+#endif
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xfer_rx_ack()
+ *
+ * @brief Sender: handle the frame received after an ACK request.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return none
+ */
+static void xfer_rx_ack(const dwt_cb_data_t *cb_data)
+{
+    if (xfer.cfg.ack == MAC_XFER_ACK_AUTO)
+    {
+        if (cb_data->datalength == XFER_ACK_LEN)
+        {
+            dwt_readrxdata(xfer.rx_buf, XFER_ACK_LEN - FCS_LEN, 0);
+            if ((xfer.rx_buf[0] == 0x02) && (xfer.rx_buf[1] == 0x00) && (xfer.rx_buf[2] == xfer.ack_seq))
+            {
+                xfer_ack(xfer.base + 1, 0);
+                return;
+            }
+        }
+    }
+    else if ((xfer_msg_check(cb_data, MAC_XFER_FUNC_BACK, MAC_XFER_BACK_LEN) == xfer.peer) &&
+             (xfer.rx_buf[MAC_XFER_MSG_ID_IDX] == xfer.id))
+    {
+        const uint8_t *p = &xfer.rx_buf[MAC_XFER_BACK_MAP_IDX];
+
+        xfer_ack(xfer.rx_buf[MAC_XFER_BACK_NEXT_IDX] | ((uint16_t)xfer.rx_buf[MAC_XFER_BACK_NEXT_IDX + 1] << 8),
+                 p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        return;
+    }
+
+    /* another frame in the ACK window: counted as a missed ACK */
+    xfer_ack_missed();
+}
+
+/* DW IC callbacks */
+
+static void xfer_tx_done_cb(const dwt_cb_data_t *cb_data)
+{
+    (void)cb_data;
+
+    switch (xfer.state)
+    {
+        case MAC_XFER_STATE_TX:
+            /* the next frame is already written, unless it does not fit beside this one */
+            xfer_frame_send((xfer.region != 0) ? xfer.burst_flen : xfer_frame_write(xfer.burst_pos));
+            break;
+        case MAC_XFER_STATE_ACK_TX:
+            /* auto-ACK sent */
+            xfer_rx_listen();
+            break;
+        default:
+            /* ACK request or block ACK sent, the RX is enabled after it */
+            break;
+    }
+}
+
+static void xfer_rx_ok_cb(const dwt_cb_data_t *cb_data)
+{
+    switch (xfer.state)
+    {
+        case MAC_XFER_STATE_WAIT_ACK:
+            xfer_rx_ack(cb_data);
+            break;
+        case MAC_XFER_STATE_LISTEN:
+            xfer_rx_data(cb_data);
+            break;
+        default:
+            break;
+    }
+}
+
+static void xfer_rx_to_cb(const dwt_cb_data_t *cb_data)
+{
+    (void)cb_data;
+
+    switch (xfer.state)
+    {
+        case MAC_XFER_STATE_WAIT_ACK:
+            xfer_ack_missed();
+            break;
+        case MAC_XFER_STATE_LISTEN:
+            xfer_rx_listen();
+            break;
+        default:
+            break;
+    }
+}
+
+static void xfer_rx_err_cb(const dwt_cb_data_t *cb_data)
+{
+    xfer_rx_to_cb(cb_data);
+}
+
+/* API */
+
+void mac_xfer_default_config(mac_xfer_config_t *cfg, uint16_t addr)
+{
+    cfg->pan_id = MAC_XFER_DEFAULT_PAN_ID;
+    cfg->addr = addr;
+    cfg->ack = MAC_XFER_ACK_BLOCK;
+    cfg->window = 8;
+    cfg->max_retries = 3;
+    cfg->payload_len = MAC_XFER_PAYLOAD_STD;
+    cfg->ack_timeout_uus = 1500;
+    cfg->rto_uus = 3000;
+    cfg->rx_dbl_buff = 0;
+}
+
+int mac_xfer_init(const mac_xfer_config_t *cfg, mac_xfer_done_cb_t done_cb, mac_xfer_rx_cb_t rx_cb)
+{
+    if ((cfg == NULL) || (xfer.state != MAC_XFER_STATE_IDLE) ||
+        (cfg->window == 0) || (cfg->window > MAC_XFER_WINDOW_MAX) ||
+        (cfg->payload_len == 0) || (cfg->payload_len > MAC_XFER_PAYLOAD_MAX))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.cfg = *cfg;
+    xfer.done_cb = done_cb;
+    xfer.rx_cb = rx_cb;
+
+    /* Two frames in the TX buffer: the second one within the directly written bytes when it fits */
+    if ((MAC_XFER_DATA_HDR_LEN + cfg->payload_len) <= 128)
+    {
+        xfer.region = 128;
+    }
+    else if ((MAC_XFER_DATA_HDR_LEN + cfg->payload_len) <= (TX_BUFFER_MAX_LEN / 2))
+    {
+        xfer.region = TX_BUFFER_MAX_LEN / 2;
+    }
+
+    dwt_setcallbacks(&xfer_tx_done_cb, &xfer_rx_ok_cb, &xfer_rx_to_cb, &xfer_rx_err_cb, NULL, NULL);
+
+    dwt_setinterrupt(SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFTO_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXPTO_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXPHE_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFCE_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFSL_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXSTO_ENABLE_BIT_MASK,
+                     0,
+                     DWT_ENABLE_INT);
+
+    return DWT_SUCCESS;
+}
+
+int mac_xfer_send(uint16_t peer, const uint8_t *data, uint32_t len)
+{
+    uint32_t total;
+
+    if ((xfer.state != MAC_XFER_STATE_IDLE) || (data == NULL) || (len == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    total = (len + xfer.cfg.payload_len - 1) / xfer.cfg.payload_len;
+    if (total > 0xFFFF)
+    {
+        return DWT_ERROR;
+    }
+
+    xfer.peer = peer;
+    xfer.id++;
+    xfer.data = data;
+    xfer.len = len;
+    xfer.total = (uint16_t)total;
+    xfer.base = 0;
+    xfer.next = 0;
+    xfer.acked = 0;
+    xfer.lost = 0;
+    xfer.ack_miss = 0;
+    xfer.tx = 0;
+    xfer.elapsed = 0;
+    xfer.now = dwt_readsystimestamphi32();
+    xfer.state = MAC_XFER_STATE_TX;
+
+    xfer_burst();
+
+    return DWT_SUCCESS;
+}
+
+int mac_xfer_listen(void)
+{
+    if (xfer.state != MAC_XFER_STATE_IDLE)
+    {
+        return DWT_ERROR;
+    }
+
+    if (xfer.cfg.ack == MAC_XFER_ACK_AUTO)
+    {
+        /* Frame filtering must be enabled for the auto-ACK */
+        dwt_setpanid(xfer.cfg.pan_id);
+        dwt_setaddress16(xfer.cfg.addr);
+        dwt_configureframefilter(DWT_FF_ENABLE_802_15_4, DWT_FF_DATA_EN);
+        dwt_enableautoack(0, 1);
+    }
+    if (xfer.cfg.rx_dbl_buff)
+    {
+        dwt_setdblrxbuffmode(DBL_BUF_STATE_EN, DBL_BUF_MODE_MAN);
+    }
+
+    xfer.rx_valid = 0;
+    xfer_rx_listen();
+
+    return DWT_SUCCESS;
+}
+
+void mac_xfer_stop(void)
+{
+    mac_xfer_state_e state = xfer.state;
+
+    dwt_forcetrxoff();
+
+    if ((state == MAC_XFER_STATE_LISTEN) || (state == MAC_XFER_STATE_ACK_TX))
+    {
+        if (xfer.cfg.ack == MAC_XFER_ACK_AUTO)
+        {
+            dwt_enableautoack(0, 0);
+            dwt_configureframefilter(DWT_FF_DISABLE, 0);
+        }
+        if (xfer.cfg.rx_dbl_buff)
+        {
+            dwt_setdblrxbuffmode(DBL_BUF_STATE_DIS, DBL_BUF_MODE_MAN);
+        }
+        xfer.state = MAC_XFER_STATE_IDLE;
+    }
+    else if (state != MAC_XFER_STATE_IDLE)
+    {
+        xfer_done(MAC_XFER_ERR_STOPPED);
+    }
+}
+
+mac_xfer_state_e mac_xfer_get_state(void)
+{
+    return xfer.state;
+}
+
+const mac_xfer_stats_t * mac_xfer_get_stats(void)
+{
+    return &xfer.stats;
+}
+
+void mac_xfer_clear_stats(void)
+{
+    memset(&xfer.stats, 0, sizeof(xfer.stats));
+}
@@ -0,0 +1,279 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_xfer.h
+ * @brief   Event driven reliable data transfer engine (auto-ACK or block ACK)
+ *
+ *          mac_xfer_send() pushes a buffer to a peer in frames of payload_len
+ *          bytes, numbered by their index in the transfer. Each frame is sent
+ *          again until it is acknowledged, up to max_retries times. The
+ *          receiver (mac_xfer_listen()) drops the copies of the frames it
+ *          already has, from a bitmap of the indexes received.
+ *
+ *          Two acknowledgement modes:
+ *
+ *          - MAC_XFER_ACK_AUTO: stop-and-wait on the 802.15.4 ACK sent by the
+ *            DW IC itself (AR bit, dwt_enableautoack() on the receiver, as in
+ *            ex_07a/ex_07b). One frame in flight.
+ *          - MAC_XFER_ACK_BLOCK: sliding window of up to MAC_XFER_WINDOW_MAX
+ *            frames sent back to back, the last one of each burst requesting
+ *            a block ACK. The block ACK carries the first index missing and a
+ *            bitmap of the following ones, so a burst costs one turnaround.
+ *            The frames it reports missing are sent again in the next burst
+ *            with the new ones; after a lost block ACK, the frames whose
+ *            retransmission timer (rto_uus from their last TX) expired.
+ *
+ *          The next frame of a burst is written into the other region of the
+ *          TX buffer while the current one is on the air, so a TX done event
+ *          only costs the frame control write and the TX start. With
+ *          rx_dbl_buff, the receiver is enabled again into the other RX buffer
+ *          (or the block ACK sent) before the payload is read, so the next
+ *          frame is received while the host reads the last one.
+ *
+ *          Long frames: with the device configured for DWT_PHRMODE_EXT and
+ *          MAC_XFER_FRAME_LEN_MAX raised (up to EXT_FRAME_LEN, e.g. with
+ *          -DMAC_XFER_FRAME_LEN_MAX=1023 for the static RX buffer), payload_len
+ *          goes up to MAC_XFER_PAYLOAD_MAX. Frames of up to half the TX buffer
+ *          (MAC_XFER_PAYLOAD_HALF) keep the TX pipelining; longer ones are
+ *          written after the TX done event of the previous one.
+ *
+ *          With MAC_XFER_FRAME_POOL (platform/dw_framepool.c), the receiver
+ *          reads each new payload into a frame of the pool instead of its
+ *          static RX buffer, and gives it to the frame callback (rx->frame):
+ *          the callback keeps it with dw_frame_ref(), e.g. to queue it to a
+ *          thread, without copy. The static buffer is used when the pool is
+ *          empty.
+ *
+ *          Like the TWR engine, it runs from the dwt_setcallbacks() events and
+ *          owns them while in use: the callbacks are called from the DW IC
+ *          interrupt context.
+ *
+ *          Frame: 802.15.4 data frame, 16-bit addresses, PAN ID compression,
+ *          then the transfer header (function code, transfer ID, flags,
+ *          index, frame count and payload unit) and the payload.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MAC_XFER_H_
+#define _MAC_XFER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define MAC_XFER_DEFAULT_PAN_ID     0xDECA
+#define MAC_XFER_DEFAULT_TX_ADDR    0x5854  /* 'TX' */
+#define MAC_XFER_DEFAULT_RX_ADDR    0x5852  /* 'RX' */
+
+/* Frame layout */
+#define MAC_XFER_MSG_SN_IDX         2
+#define MAC_XFER_MSG_PAN_IDX        3
+#define MAC_XFER_MSG_DST_IDX        5
+#define MAC_XFER_MSG_SRC_IDX        7
+#define MAC_XFER_MSG_FUNC_IDX       9
+#define MAC_XFER_MSG_ID_IDX         10
+/* data frame */
+#define MAC_XFER_DATA_FLAGS_IDX     11
+#define MAC_XFER_DATA_INDEX_IDX     12
+#define MAC_XFER_DATA_TOTAL_IDX     14
+#define MAC_XFER_DATA_UNIT_IDX      16
+#define MAC_XFER_DATA_HDR_LEN       18
+/* block ACK */
+#define MAC_XFER_BACK_NEXT_IDX      11      /* first index missing */
+#define MAC_XFER_BACK_MAP_IDX       13      /* bit i: index next + 1 + i received */
+#define MAC_XFER_BACK_LEN           17
+
+/* Function codes */
+#define MAC_XFER_FUNC_DATA          0x30
+#define MAC_XFER_FUNC_BACK          0x31
+
+/* Data frame flags */
+#define MAC_XFER_FLAG_ACK_REQ       0x01    /* block ACK requested */
+
+#define MAC_XFER_WINDOW_MAX         32
+#ifndef MAC_XFER_FRAME_LEN_MAX
+#define MAC_XFER_FRAME_LEN_MAX      127     /* longest frame, with FCS: 127 (standard PHR) up to 1023 (DWT_PHRMODE_EXT) */
+#endif
+#define MAC_XFER_PAYLOAD_MAX        (MAC_XFER_FRAME_LEN_MAX - MAC_XFER_DATA_HDR_LEN - 2)
+#define MAC_XFER_PAYLOAD_STD        (127 - MAC_XFER_DATA_HDR_LEN - 2)   /* longest payload with the standard PHR */
+#define MAC_XFER_PAYLOAD_HALF       (512 - MAC_XFER_DATA_HDR_LEN)       /* longest payload with two frames in the TX buffer */
+
+typedef enum
+{
+    MAC_XFER_ACK_AUTO = 0,      /* hardware ACK per frame, stop-and-wait */
+    MAC_XFER_ACK_BLOCK,         /* block ACK per burst, sliding window */
+} mac_xfer_ack_e;
+
+typedef enum
+{
+    MAC_XFER_STATE_IDLE = 0,
+    MAC_XFER_STATE_TX,          /* sender: burst in progress */
+    MAC_XFER_STATE_WAIT_ACK,    /* sender: ACK request sent, waiting for the (block) ACK */
+    MAC_XFER_STATE_LISTEN,      /* receiver: waiting for frames */
+    MAC_XFER_STATE_ACK_TX,      /* receiver: auto-ACK being sent */
+} mac_xfer_state_e;
+
+typedef enum
+{
+    MAC_XFER_OK = 0,
+    MAC_XFER_ERR_RETRY = -1,    /* a frame was not acknowledged after max_retries retransmissions */
+    MAC_XFER_ERR_ACK = -2,      /* no (block) ACK after max_retries requests */
+    MAC_XFER_ERR_STOPPED = -3,  /* mac_xfer_stop() */
+} mac_xfer_status_e;
+
+typedef struct
+{
+    uint16_t        pan_id;
+    uint16_t        addr;                   /* own short address */
+    mac_xfer_ack_e  ack;
+    uint8_t         window;                 /* block ACK: frames in flight, 1 to MAC_XFER_WINDOW_MAX */
+    uint8_t         max_retries;            /* retransmissions of a frame, and block ACK requests in a row */
+    uint16_t        payload_len;            /* sender: data bytes per frame, up to MAC_XFER_PAYLOAD_MAX */
+    uint32_t        ack_timeout_uus;        /* sender: (block) ACK RX timeout */
+    uint32_t        rto_uus;                /* sender: retransmission timeout of a frame, from its last TX */
+    uint8_t         rx_dbl_buff;            /* receiver: double buffered RX, see above */
+} mac_xfer_config_t;
+
+/* Counters, since mac_xfer_init() or mac_xfer_clear_stats() */
+typedef struct
+{
+    /* sender */
+    uint32_t        transfers;              /* transfers ended */
+    uint32_t        failed;                 /* ... not with MAC_XFER_OK */
+    uint32_t        frames_tx;              /* data frames sent */
+    uint32_t        retx;                   /* ... of which retransmissions */
+    uint32_t        ack_req;                /* frames sent with an ACK request */
+    uint32_t        acks;                   /* (block) ACKs received */
+    uint32_t        ack_timeouts;           /* ACK requests not answered */
+    /* receiver */
+    uint32_t        frames_rx;              /* data frames received and delivered */
+    uint32_t        dup_rx;                 /* ... dropped as copies */
+    uint32_t        back_tx;                /* block ACKs sent */
+    uint32_t        bytes_rx;               /* payload delivered */
+} mac_xfer_stats_t;
+
+/* Sender: outcome of a transfer */
+typedef struct
+{
+    mac_xfer_status_e status;
+    uint16_t        peer;
+    uint8_t         id;                     /* transfer ID */
+    uint16_t        frames;                 /* frames in the transfer */
+    uint16_t        acked;                  /* frames acknowledged */
+    uint32_t        tx;                     /* frames sent, with the retransmissions */
+    uint32_t        bytes;                  /* bytes acknowledged */
+    uint32_t        elapsed_us;             /* from mac_xfer_send() to the last ACK (device time) */
+    uint32_t        kbps;                   /* goodput, bytes acknowledged over elapsed_us */
+} mac_xfer_result_t;
+
+/* Receiver: a new frame of a transfer */
+typedef struct
+{
+    uint16_t        peer;
+    uint8_t         id;
+    uint16_t        index;
+    uint16_t        frames;                 /* frames in the transfer */
+    uint32_t        offset;                 /* of the payload in the transfer */
+    const uint8_t   *data;
+    uint16_t        len;
+    uint8_t         complete;               /* all the frames of the transfer are now received */
+    struct dw_frame *frame;                 /* MAC_XFER_FRAME_POOL: pool frame holding data (len, off 0), or NULL */
+} mac_xfer_rx_t;
+
+typedef void (*mac_xfer_done_cb_t)(const mac_xfer_result_t *result);
+typedef void (*mac_xfer_rx_cb_t)(const mac_xfer_rx_t *rx);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_xfer_default_config()
+ *
+ * @brief Fill a configuration with the default values: block ACK, window of 8 frames of MAC_XFER_PAYLOAD_STD bytes,
+ *        3 retries, 1500 uus ACK timeout and 3000 uus retransmission timeout (6.8 Mbps, 128 symbols preamble), single
+ *        RX buffer. The retransmission timeout should exceed the airtime of a window: raise it with longer payloads.
+ *
+ * @param cfg - configuration to fill
+ * @param addr - own short address
+ *
+ * @return none
+ */
+void mac_xfer_default_config(mac_xfer_config_t *cfg, uint16_t addr);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_xfer_init()
+ *
+ * @brief Register the engine callbacks and enable the TX/RX interrupts. The device must be configured. Both sides
+ *        use the same ack mode.
+ *
+ * @param cfg - configuration (copied)
+ * @param done_cb - sender result callback, or NULL
+ * @param rx_cb - receiver frame callback, or NULL
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters, or a transfer in progress)
+ */
+int mac_xfer_init(const mac_xfer_config_t *cfg, mac_xfer_done_cb_t done_cb, mac_xfer_rx_cb_t rx_cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_xfer_send()
+ *
+ * @brief Start a transfer. The buffer is read while the frames are sent: it must stay unchanged until the result
+ *        callback.
+ *
+ * @param peer - receiver address
+ * @param data - data
+ * @param len - data length, 1 to 65535 frames of payload_len bytes
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the engine is busy or the length is out of range
+ */
+int mac_xfer_send(uint16_t peer, const uint8_t *data, uint32_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_xfer_listen()
+ *
+ * @brief Receive transfers until mac_xfer_stop(). With MAC_XFER_ACK_AUTO, set the PAN ID, the short address, the
+ *        data frame filter and the auto-ACK. With rx_dbl_buff, enable the double buffered RX (manual mode).
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the engine is busy
+ */
+int mac_xfer_listen(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_xfer_stop()
+ *
+ * @brief Stop the transceiver and the engine. A transfer in progress ends with MAC_XFER_ERR_STOPPED.
+ *
+ * @return none
+ */
+void mac_xfer_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_xfer_get_state()
+ *
+ * @return engine state
+ */
+mac_xfer_state_e mac_xfer_get_state(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_xfer_get_stats()
+ *
+ * @return counters
+ */
+const mac_xfer_stats_t * mac_xfer_get_stats(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_xfer_clear_stats()
+ *
+ * @brief Clear the counters.
+ *
+ * @return none
+ */
+void mac_xfer_clear_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MAC_XFER_H_ */
@@ -1,7 +1,43 @@
+#include <stddef.h>
 #include <string.h>
 #include <mac_802_15_8.h>
 
 
+/* @fn      mac_frame_parse_802_15_8
+ * @brief   Fill a frame view (see shared_defines.h) for a frame in the format of mac_frame_802_15_8_format_t:
+ *          48-bit addresses and the 6 bytes of the nonce (PN) in the aux fields, then the payload and MIC.
+ *          Nothing is copied, buf can hold the header only.
+ * @param   buf-frame bytes, buf_len-bytes in buf, frame_len-frame length with FCS, mic_len-MIC size, view-filled
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the frame or buf is shorter than the header and MIC
+ * */
+int mac_frame_parse_802_15_8(const uint8_t *buf,uint16_t buf_len,uint16_t frame_len,uint8_t mic_len,mac_frame_view_t *view)
+{
+    if ((buf_len < sizeof(mac_frame_802_15_8_format_t)) ||
+        (frame_len < (sizeof(mac_frame_802_15_8_format_t) + mic_len + FCS_LEN)))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(view, 0, sizeof(*view));
+    view->frame        = buf;
+    view->frame_len    = frame_len;
+    view->type         = buf[0] & 0x7;
+    view->security     = 1;
+    view->seq          = buf[offsetof(mac_frame_802_15_8_format_t, seq)];
+    view->dst_addr_off = offsetof(mac_frame_802_15_8_format_t, dst_addr);
+    view->dst_addr_len = 6;
+    view->src_addr_off = offsetof(mac_frame_802_15_8_format_t, src_addr);
+    view->src_addr_len = 6;
+    view->aux_off      = offsetof(mac_frame_802_15_8_format_t, nonce);
+    view->aux_len      = 6;
+    view->mic_len      = mic_len;
+    view->hdr_len      = sizeof(mac_frame_802_15_8_format_t);
+    view->payload_off  = view->hdr_len;
+    view->payload_len  = frame_len - (view->hdr_len + mic_len + FCS_LEN);
+    return DWT_SUCCESS;
+}
+
 /* @fn      rx_aes_802_15_8
  * @brief   Decrypts received frame, the frame type needs to match the structure defined in deca_device_api.h - dwt_test_aes_header_s.
  *          Note, register key AES128 should be set before first usage of a function.
@@ -14,16 +50,19 @@ aes_results_e rx_aes_802_15_8(uint16_t frame_length,dwt_aes_job_t *aes_job,uint8
 {
     uint8_t    nonce[12];
     int8_t   status;
-    int16_t  payload_len;
+    mac_frame_view_t view;
 
     mac_frame_802_15_8_format_t header = {0};
 
-    payload_len = frame_length - (sizeof(header) +aes_job->mic_size +FCS_LEN); /* hard-coded MIC size of 16 bytes and 2 bytes of FCS */
-
-    if (payload_len >= 0 && payload_len < payload_load_size)
+    /* Download a max size of a plain text header which we are expecting in the frame, when the frame holds it. */
+    if (frame_length >= (sizeof(header) + aes_job->mic_size + FCS_LEN))
     {
-        /* Download a max size of a plain text header which we are expecting in the frame. */
         dwt_readrxdata((uint8_t *)&header, sizeof(header), 0);
+    }
+
+    if ((mac_frame_parse_802_15_8((uint8_t *)&header, sizeof(header), frame_length, aes_job->mic_size, &view) == DWT_SUCCESS) &&
+        (view.payload_len < payload_load_size))
+    {
 
         /* Place a breakpoint here to see an unencrypted header */
 
@@ -32,13 +71,13 @@ aes_results_e rx_aes_802_15_8(uint16_t frame_length,dwt_aes_job_t *aes_job,uint8
          * In 802.15.8 standard, the 96-bit nonce shall be constructed, using 6 bytes of Sender address and
          * 6 bytes of a unique part, called PN.
          * */
-        memcpy(&nonce[0], &header.nonce[0], 6);
-        memcpy(&nonce[6], &header.src_addr[0], 6);
+        memcpy(&nonce[0], &view.frame[view.aux_off], 6);
+        memcpy(&nonce[6], &view.frame[view.src_addr_off], 6);
 
         /* Fill AES job to decrypt the received packet */
         aes_job->nonce       = nonce;
-        aes_job->header_len  = sizeof(header);
-        aes_job->payload_len = payload_len;
+        aes_job->header_len  = view.hdr_len;
+        aes_job->payload_len = view.payload_len;
         aes_job->header=NULL;
         aes_job->payload=payload;
         //dwt_configure_aes(aes_job);
@@ -25,6 +25,7 @@ typedef struct
  *          This function assumes frame received with known Header, as per test_aes_header_s.
  *          Note, register key AES128 should be set before first usage of a function.
  * */
+int mac_frame_parse_802_15_8(const uint8_t *buf,uint16_t buf_len,uint16_t frame_len,uint8_t mic_len,mac_frame_view_t *view);
 aes_results_e rx_aes_802_15_8(uint16_t frame_length,dwt_aes_job_t *aes_job,uint8_t *payload,uint16_t payload_load_size,dwt_aes_core_type_e core_type);
 
 
@@ -15,31 +15,6 @@
 #ifndef EXAMPLES_CONFIG_OPTIONS_H_
 #define EXAMPLES_CONFIG_OPTIONS_H_
 
-/* Index values for errors in array */
-#define CRC_ERR_IDX 0
-#define RSE_ERR_IDX 1
-#define PHE_ERR_IDX 2
-#define SFDTO_ERR_IDX 3
-#define PTO_ERR_IDX 4
-#define RTO_ERR_IDX 5
-#define SPICRC_ERR_IDX 6
-#define TXTO_ERR_IDX 7
-#define ARFE_ERR_IDX 8
-#define TS_MISMATCH_ERR_IDX 9
-#define BAD_FRAME_ERR_IDX 10
-#define PREAMBLE_COUNT_ERR_IDX 11
-#define CP_QUAL_ERR_IDX 12
-#define STS_PREAMBLE_ERR 13
-#define STS_PEAK_GROWTH_RATE_ERR 14
-#define STS_ADC_COUNT_ERR 15
-#define STS_SFD_COUNT_ERR 16
-#define STS_LATE_FIRST_PATH_ERR 17
-#define STS_LATE_COARSE_EST_ERR 18
-#define STS_COARSE_EST_EMPTY_ERR 19
-#define STS_HIGH_NOISE_THREASH_ERR 20
-#define STS_NON_TRIANGLE_ERR 21
-#define STS_LOG_REG_FAILED_ERR 22
-
 /*
  * Number of ranges to attempt in test
  */
@@ -239,6 +214,77 @@
  */
 #define CONFIG_OPTION_33
 
+/* Name of the selected configuration option, to tag logs and benchmark results */
+#if defined(CONFIG_OPTION_01)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_01"
+#elif defined(CONFIG_OPTION_02)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_02"
+#elif defined(CONFIG_OPTION_03)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_03"
+#elif defined(CONFIG_OPTION_04)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_04"
+#elif defined(CONFIG_OPTION_05)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_05"
+#elif defined(CONFIG_OPTION_06)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_06"
+#elif defined(CONFIG_OPTION_07)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_07"
+#elif defined(CONFIG_OPTION_08)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_08"
+#elif defined(CONFIG_OPTION_09)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_09"
+#elif defined(CONFIG_OPTION_10)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_10"
+#elif defined(CONFIG_OPTION_11)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_11"
+#elif defined(CONFIG_OPTION_12)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_12"
+#elif defined(CONFIG_OPTION_13)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_13"
+#elif defined(CONFIG_OPTION_14)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_14"
+#elif defined(CONFIG_OPTION_15)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_15"
+#elif defined(CONFIG_OPTION_16)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_16"
+#elif defined(CONFIG_OPTION_17)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_17"
+#elif defined(CONFIG_OPTION_18)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_18"
+#elif defined(CONFIG_OPTION_19)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_19"
+#elif defined(CONFIG_OPTION_20)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_20"
+#elif defined(CONFIG_OPTION_21)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_21"
+#elif defined(CONFIG_OPTION_22)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_22"
+#elif defined(CONFIG_OPTION_23)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_23"
+#elif defined(CONFIG_OPTION_24)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_24"
+#elif defined(CONFIG_OPTION_25)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_25"
+#elif defined(CONFIG_OPTION_26)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_26"
+#elif defined(CONFIG_OPTION_27)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_27"
+#elif defined(CONFIG_OPTION_28)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_28"
+#elif defined(CONFIG_OPTION_29)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_29"
+#elif defined(CONFIG_OPTION_30)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_30"
+#elif defined(CONFIG_OPTION_31)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_31"
+#elif defined(CONFIG_OPTION_32)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_32"
+#elif defined(CONFIG_OPTION_33)
+#define CONFIG_OPTION_NAME "CONFIG_OPTION_33"
+#else
+#define CONFIG_OPTION_NAME "none"
+#endif
+
 extern char dist_str[16];
 
 #endif /* EXAMPLES_CONFIG_OPTIONS_H_ */
@@ -14,6 +14,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <zephyr/kernel.h>
 #include <zephyr/sys/printk.h>
@@ -56,7 +57,6 @@ static uint16_t get_sts_mnth(uint16_t sts, uint8_t default_threshold, uint8_t sh
 
 //DW-IC SPI CRC-8 polynomial
 #define POLYNOMIAL  0x07    /* x^8 + x^2 + x^1 + x^0 */
-#define TOPBIT      (1 << (8 - 1))
 
 // OTP addresses definitions
 #define LDOTUNELO_ADDRESS (0x04)
@@ -88,6 +88,11 @@ static uint16_t get_sts_mnth(uint16_t sts, uint8_t default_threshold, uint8_t sh
 #define B12_SIGN_EXTEND_TEST (0x2000UL)
 #define B12_SIGN_EXTEND_MASK (0xC000UL)
 
+// dwt_readrxinfo defines
+#define RXINFO_GEN_LEN  (TX_TIME_LO_ID + TX_TIME_TX_STAMP_LEN - RX_FINFO_ID)  // RX_FINFO up to the end of TX_TIME
+#define RXINFO_BUF_LEN  (BUF0_RES1 - BUF0_RX_FINFO)                           // RX_FINFO up to the end of PDOA in an RX buffer
+#define RXINFO_CIA_LEN  (CIA_DIAG_0_ID + 2 - CIA_TDOA_1_PDOA_ID)              // PDOA and the clock offset of CIA_DIAG_0
+
 // -------------------------------------------------------------------------------------------------------------------
 // Macros and Enumerations for SPI & CLock blocks
 //
@@ -113,13 +118,72 @@ static uint16_t get_sts_mnth(uint16_t sts, uint8_t default_threshold, uint8_t sh
 //
 static void dwt_force_clocks(int clocks);
 static uint32_t _dwt_otpread(uint16_t address);                     // Read non-volatile memory
+static uint32_t _dwt_otpread_shadow(uint16_t address);              // Read non-volatile memory through the OTP shadow
+static void _dwt_otpshadow_set(uint16_t address, uint32_t data);   // Update the OTP shadow
+#ifndef DWT_NO_OTP_PROG
 static void _dwt_otpprogword32(uint32_t data, uint16_t address);  // Program the non-volatile memory
+#endif
+
+// -------------------------------------------------------------------------------------------------------------------
+// Register shadow cache (see dwt_enableregcache)
+//
+// Static configuration registers only: these are changed by the host alone, so a cached copy stays valid until
+// the device is reset or goes to sleep. Volatile registers (status, timestamps, self-clearing) must not be added.
+static const uint32_t dwt_regcache_ids[] =
+{
+    SYS_CFG_ID,
+    PANADR_ID,
+    ADR_FILT_CFG_ID,
+    TX_FCTRL_ID,
+    CHAN_CTRL_ID,
+    GPIO_MODE_ID,
+    DTUNE0_ID,
+    CLK_CTRL_ID,
+    LED_CTRL_ID,
+};
+
+#define DWT_REGCACHE_ENTRIES  (sizeof(dwt_regcache_ids)/sizeof(dwt_regcache_ids[0]))
+#define DWT_REGCACHE_WORD_LEN (4)   // each entry caches the first 4 bytes of the register
+
+// -------------------------------------------------------------------------------------------------------------------
+// OTP shadow (see _dwt_otpread_shadow)
+//
+#ifndef DWT_OTP_SHADOW_WORDS
+#define DWT_OTP_SHADOW_WORDS  (0x21)  // OTP words 0x00 (EUI) to 0x20 (DGC_TUNE), the ones dwt_initialise() uses
+#endif
+
+// -------------------------------------------------------------------------------------------------------------------
+// Schedule queue (see dwt_sched_init), what the armed event waits for
+//
+#define DWT_SCHED_NONE        (0)   // no event armed
+#define DWT_SCHED_WAIT_TX     (1)   // TX frame sent
+#define DWT_SCHED_WAIT_RX     (2)   // RX frame, error or timeout
+
+// -------------------------------------------------------------------------------------------------------------------
+// Register write batching (see dwt_batch_begin)
+//
+#ifndef DWT_BATCH_BUF_LEN
+#define DWT_BATCH_BUF_LEN     (256)   // bytes of queued SPI transactions (header + data + crc)
+#endif
+#ifndef DWT_BATCH_MAX_OPS
+#define DWT_BATCH_MAX_OPS     (32)    // max number of queued SPI transactions
+#endif
+#define DWT_BATCH_MAX_OP_DATA (8)     // only register writes up to this length are queued (AND/OR 32 is 8 bytes)
+
+typedef struct
+{
+    uint8_t     depth;                        // nesting level of dwt_batch_begin()/dwt_batch_end()
+    uint8_t     count;                        // number of queued transactions
+    uint16_t    used;                         // bytes used in buf
+    uint16_t    len[DWT_BATCH_MAX_OPS];       // length of each queued transaction
+    uint8_t     buf[DWT_BATCH_BUF_LEN];       // queued transactions, back to back
+} dwt_batch_t ;
 
 // -------------------------------------------------------------------------------------------------------------------
 // Data for DW3000 Decawave Transceiver control
 //
 // Structure to hold the device data
-typedef struct
+typedef struct dwt_local_data_s
 {
     uint32_t      partID ;            // IC Part ID - read during initialisation
     uint32_t      lotID ;             // IC Lot ID - read during initialisation
@@ -127,6 +191,7 @@ typedef struct
     uint8_t       dgc_otp_set;        // Flag to check if DGC values are programmed in OTP
     uint8_t       vBatP;              // IC V bat read during production and stored in OTP (Vmeas @ 3V3)
     uint8_t       tempP;              // IC temp read during production and stored in OTP (Tmeas @ 23C)
+    uint8_t       otp_ref;            // DWT_READ_OTP_BAT/TMP: vBatP/tempP programmed in OTP (else the defaults)
     uint8_t       longFrames ;        // Flag in non-standard long frame mode
     uint8_t       otprev ;            // OTP revision number (read during initialisation)
     uint8_t       init_xtrim;         // initial XTAL trim value read from OTP (or defaulted to mid-range if OTP not programmed)
@@ -144,6 +209,46 @@ typedef struct
     dwt_cb_t    cbRxErr;              // Callback for RX error events
     dwt_cb_t    cbSPIErr;             // Callback for SPI error events
     dwt_cb_t    cbSPIRdy;             // Callback for SPI ready events
+    dwt_cb_t    cbCCAFail;            // Callback for CCA fail events (see dwt_setcbccafail)
+    dwt_rxring_desc_t *rxring;        // RX event ring descriptors (NULL when not used)
+    uint16_t    rxring_mask;          // RX event ring size - 1
+    volatile uint16_t rxring_head;    // RX event ring write index (dwt_isr only)
+    volatile uint16_t rxring_tail;    // RX event ring read index (application only)
+    uint32_t    rxring_dropped;       // frames not put in the full RX event ring
+    uint8_t     rxcont;               // Continuous double-buffered receiver running (see dwt_rxcont_start)
+    dwt_rxcont_stats_t rxcont_stats;  // Continuous receiver counters (dropped is taken from rxring_dropped)
+    dwt_sched_event_t *sched;         // Schedule queue events (NULL when not used)
+    uint16_t    sched_mask;           // Schedule queue size - 1
+    uint16_t    sched_head;           // Schedule queue write index (dwt_sched_add)
+    uint16_t    sched_tail;           // Schedule queue read index (next event to arm)
+    uint8_t     sched_armed;          // What the armed event waits for (DWT_SCHED_NONE/WAIT_TX/WAIT_RX)
+    int32_t     sched_min_slack;      // Smallest slack an event is armed with, in 256 device time units
+    uint64_t    sched_last;           // Time of the last event queued
+    dwt_sched_late_cb_t cbSchedLate;  // Callback for late events
+    dwt_sched_stats_t sched_stats;    // Schedule queue counters
+    uint8_t     regcache_en;          // Register shadow cache enabled
+    uint8_t     regcache_atx2slp;     // Register shadow cache held off by dwt_entersleepaftertx(1)
+    uint8_t     regcache_saved;       // Register shadow cache enable to restore on dwt_entersleepaftertx(0)
+    uint16_t    regcache_valid;       // Register shadow cache valid entries, bit per dwt_regcache_ids[] entry
+    uint8_t     regcache[DWT_REGCACHE_ENTRIES][DWT_REGCACHE_WORD_LEN]; // Register shadow cache
+    dwt_batch_t batch;                // Register write batch queue
+    uint8_t     ldo_tune_set;         // LDO_TUNE programmed in OTP (read during initialisation)
+    const dwt_init_cache_t *initcache;  // OTP data to use in place of OTP reads in dwt_initialise() (NULL when not used)
+    uint32_t    otp_shadow[DWT_OTP_SHADOW_WORDS];   // OTP words read since dwt_initialise()
+    uint32_t    otp_shadow_valid[(DWT_OTP_SHADOW_WORDS + 31) / 32]; // OTP shadow valid words, bit per address
+    dwt_cfgimage_t *cfgimage;         // register image being recorded by dwt_cfgimage_build() (NULL when not recording)
+    const dwt_cfgimage_t *cfgactive;  // register image the device is configured with (NULL when not known)
+    uint8_t     ptra_valid;           // Indirect pointer A set up below is what the device has (see _dwt_ptra_setup)
+    uint8_t     ptra_file;            // Indirect pointer A: INDIRECT_ADDR_A (buffer file)
+    uint16_t    ptra_offset;          // Indirect pointer A: ADDR_OFFSET_A
+#if !defined(DWT_NO_DIAG) && defined(DWT_DIAG_STATIC_BUF)
+    uint8_t     diag_buf[DB_MAX_DIAG_SIZE]; // RX diagnostics read buffer, instead of the stack of dwt_readdiagnostics()
+#endif
+#ifndef DWT_NO_AES
+    dwt_aes_job_t *aesjob;            // AES job started by dwt_do_aes_async() (NULL when none is running)
+    dwt_aes_cb_t  cbAes;              // Callback for the AES job completion
+    uint32_t      aes_read_addr;      // buffer the decrypted frame of the AES job is read back from
+#endif
 } dwt_local_data_t ;
 
 
@@ -151,8 +256,166 @@ typedef struct
 // Local variables
 //
 static dwt_local_data_t   DW3000local[DWT_NUM_DW_DEV] ; // Local device data, can be an array to support multiple DW3000 testing applications/platforms
+#ifdef DWT_THREAD_SAFE
+#ifndef CONFIG_THREAD_LOCAL_STORAGE
+#error "DWT_THREAD_SAFE requires CONFIG_THREAD_LOCAL_STORAGE=y"
+#endif
+static __thread dwt_local_data_t *pdw3000local = &DW3000local[0];   // Local data structure pointer, one per thread
+#define DWT_LOCK()      port_dw_ic_lock(dwt_getlocaldataindex())
+#define DWT_UNLOCK()    port_dw_ic_unlock(dwt_getlocaldataindex())
+#else
 static dwt_local_data_t *pdw3000local = &DW3000local[0];   // Local data structure pointer
-static uint8_t crcTable[256];
+#define DWT_LOCK()
+#define DWT_UNLOCK()
+#endif
+// The schedule queue is updated by dwt_isr() and by the application: the device lock is always taken around the
+// application side, dwt_isr() runs under it (deferred IRQ thread), or is deferred by the port while it is held
+#define DWT_SCHED_LOCK()    port_dw_ic_lock(dwt_getlocaldataindex())
+#define DWT_SCHED_UNLOCK()  port_dw_ic_unlock(dwt_getlocaldataindex())
+// CRC-8 (POLYNOMIAL) lookup table: crcTable[x] is the remainder of x followed by 8 zero bits
+static const uint8_t crcTable[256] =
+{
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+    0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65, 0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+    0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+    0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2, 0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+    0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+    0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42, 0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+    0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+    0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C, 0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+    0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+    0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B, 0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+    0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3,
+};
+
+#ifndef DWT_CRC8_SMALL
+// Slicing tables for dwt_generatecrc8() bulk data: crcTableN[x] = crcTable[] remainder of x followed by N zero bytes.
+// Define DWT_CRC8_SMALL to save the 768 bytes of flash and use crcTable[] alone.
+static const uint8_t crcTable1[256] =
+{
+    0x00, 0x15, 0x2A, 0x3F, 0x54, 0x41, 0x7E, 0x6B, 0xA8, 0xBD, 0x82, 0x97, 0xFC, 0xE9, 0xD6, 0xC3,
+    0x57, 0x42, 0x7D, 0x68, 0x03, 0x16, 0x29, 0x3C, 0xFF, 0xEA, 0xD5, 0xC0, 0xAB, 0xBE, 0x81, 0x94,
+    0xAE, 0xBB, 0x84, 0x91, 0xFA, 0xEF, 0xD0, 0xC5, 0x06, 0x13, 0x2C, 0x39, 0x52, 0x47, 0x78, 0x6D,
+    0xF9, 0xEC, 0xD3, 0xC6, 0xAD, 0xB8, 0x87, 0x92, 0x51, 0x44, 0x7B, 0x6E, 0x05, 0x10, 0x2F, 0x3A,
+    0x5B, 0x4E, 0x71, 0x64, 0x0F, 0x1A, 0x25, 0x30, 0xF3, 0xE6, 0xD9, 0xCC, 0xA7, 0xB2, 0x8D, 0x98,
+    0x0C, 0x19, 0x26, 0x33, 0x58, 0x4D, 0x72, 0x67, 0xA4, 0xB1, 0x8E, 0x9B, 0xF0, 0xE5, 0xDA, 0xCF,
+    0xF5, 0xE0, 0xDF, 0xCA, 0xA1, 0xB4, 0x8B, 0x9E, 0x5D, 0x48, 0x77, 0x62, 0x09, 0x1C, 0x23, 0x36,
+    0xA2, 0xB7, 0x88, 0x9D, 0xF6, 0xE3, 0xDC, 0xC9, 0x0A, 0x1F, 0x20, 0x35, 0x5E, 0x4B, 0x74, 0x61,
+    0xB6, 0xA3, 0x9C, 0x89, 0xE2, 0xF7, 0xC8, 0xDD, 0x1E, 0x0B, 0x34, 0x21, 0x4A, 0x5F, 0x60, 0x75,
+    0xE1, 0xF4, 0xCB, 0xDE, 0xB5, 0xA0, 0x9F, 0x8A, 0x49, 0x5C, 0x63, 0x76, 0x1D, 0x08, 0x37, 0x22,
+    0x18, 0x0D, 0x32, 0x27, 0x4C, 0x59, 0x66, 0x73, 0xB0, 0xA5, 0x9A, 0x8F, 0xE4, 0xF1, 0xCE, 0xDB,
+    0x4F, 0x5A, 0x65, 0x70, 0x1B, 0x0E, 0x31, 0x24, 0xE7, 0xF2, 0xCD, 0xD8, 0xB3, 0xA6, 0x99, 0x8C,
+    0xED, 0xF8, 0xC7, 0xD2, 0xB9, 0xAC, 0x93, 0x86, 0x45, 0x50, 0x6F, 0x7A, 0x11, 0x04, 0x3B, 0x2E,
+    0xBA, 0xAF, 0x90, 0x85, 0xEE, 0xFB, 0xC4, 0xD1, 0x12, 0x07, 0x38, 0x2D, 0x46, 0x53, 0x6C, 0x79,
+    0x43, 0x56, 0x69, 0x7C, 0x17, 0x02, 0x3D, 0x28, 0xEB, 0xFE, 0xC1, 0xD4, 0xBF, 0xAA, 0x95, 0x80,
+    0x14, 0x01, 0x3E, 0x2B, 0x40, 0x55, 0x6A, 0x7F, 0xBC, 0xA9, 0x96, 0x83, 0xE8, 0xFD, 0xC2, 0xD7,
+};
+
+static const uint8_t crcTable2[256] =
+{
+    0x00, 0x6B, 0xD6, 0xBD, 0xAB, 0xC0, 0x7D, 0x16, 0x51, 0x3A, 0x87, 0xEC, 0xFA, 0x91, 0x2C, 0x47,
+    0xA2, 0xC9, 0x74, 0x1F, 0x09, 0x62, 0xDF, 0xB4, 0xF3, 0x98, 0x25, 0x4E, 0x58, 0x33, 0x8E, 0xE5,
+    0x43, 0x28, 0x95, 0xFE, 0xE8, 0x83, 0x3E, 0x55, 0x12, 0x79, 0xC4, 0xAF, 0xB9, 0xD2, 0x6F, 0x04,
+    0xE1, 0x8A, 0x37, 0x5C, 0x4A, 0x21, 0x9C, 0xF7, 0xB0, 0xDB, 0x66, 0x0D, 0x1B, 0x70, 0xCD, 0xA6,
+    0x86, 0xED, 0x50, 0x3B, 0x2D, 0x46, 0xFB, 0x90, 0xD7, 0xBC, 0x01, 0x6A, 0x7C, 0x17, 0xAA, 0xC1,
+    0x24, 0x4F, 0xF2, 0x99, 0x8F, 0xE4, 0x59, 0x32, 0x75, 0x1E, 0xA3, 0xC8, 0xDE, 0xB5, 0x08, 0x63,
+    0xC5, 0xAE, 0x13, 0x78, 0x6E, 0x05, 0xB8, 0xD3, 0x94, 0xFF, 0x42, 0x29, 0x3F, 0x54, 0xE9, 0x82,
+    0x67, 0x0C, 0xB1, 0xDA, 0xCC, 0xA7, 0x1A, 0x71, 0x36, 0x5D, 0xE0, 0x8B, 0x9D, 0xF6, 0x4B, 0x20,
+    0x0B, 0x60, 0xDD, 0xB6, 0xA0, 0xCB, 0x76, 0x1D, 0x5A, 0x31, 0x8C, 0xE7, 0xF1, 0x9A, 0x27, 0x4C,
+    0xA9, 0xC2, 0x7F, 0x14, 0x02, 0x69, 0xD4, 0xBF, 0xF8, 0x93, 0x2E, 0x45, 0x53, 0x38, 0x85, 0xEE,
+    0x48, 0x23, 0x9E, 0xF5, 0xE3, 0x88, 0x35, 0x5E, 0x19, 0x72, 0xCF, 0xA4, 0xB2, 0xD9, 0x64, 0x0F,
+    0xEA, 0x81, 0x3C, 0x57, 0x41, 0x2A, 0x97, 0xFC, 0xBB, 0xD0, 0x6D, 0x06, 0x10, 0x7B, 0xC6, 0xAD,
+    0x8D, 0xE6, 0x5B, 0x30, 0x26, 0x4D, 0xF0, 0x9B, 0xDC, 0xB7, 0x0A, 0x61, 0x77, 0x1C, 0xA1, 0xCA,
+    0x2F, 0x44, 0xF9, 0x92, 0x84, 0xEF, 0x52, 0x39, 0x7E, 0x15, 0xA8, 0xC3, 0xD5, 0xBE, 0x03, 0x68,
+    0xCE, 0xA5, 0x18, 0x73, 0x65, 0x0E, 0xB3, 0xD8, 0x9F, 0xF4, 0x49, 0x22, 0x34, 0x5F, 0xE2, 0x89,
+    0x6C, 0x07, 0xBA, 0xD1, 0xC7, 0xAC, 0x11, 0x7A, 0x3D, 0x56, 0xEB, 0x80, 0x96, 0xFD, 0x40, 0x2B,
+};
+
+static const uint8_t crcTable3[256] =
+{
+    0x00, 0x16, 0x2C, 0x3A, 0x58, 0x4E, 0x74, 0x62, 0xB0, 0xA6, 0x9C, 0x8A, 0xE8, 0xFE, 0xC4, 0xD2,
+    0x67, 0x71, 0x4B, 0x5D, 0x3F, 0x29, 0x13, 0x05, 0xD7, 0xC1, 0xFB, 0xED, 0x8F, 0x99, 0xA3, 0xB5,
+    0xCE, 0xD8, 0xE2, 0xF4, 0x96, 0x80, 0xBA, 0xAC, 0x7E, 0x68, 0x52, 0x44, 0x26, 0x30, 0x0A, 0x1C,
+    0xA9, 0xBF, 0x85, 0x93, 0xF1, 0xE7, 0xDD, 0xCB, 0x19, 0x0F, 0x35, 0x23, 0x41, 0x57, 0x6D, 0x7B,
+    0x9B, 0x8D, 0xB7, 0xA1, 0xC3, 0xD5, 0xEF, 0xF9, 0x2B, 0x3D, 0x07, 0x11, 0x73, 0x65, 0x5F, 0x49,
+    0xFC, 0xEA, 0xD0, 0xC6, 0xA4, 0xB2, 0x88, 0x9E, 0x4C, 0x5A, 0x60, 0x76, 0x14, 0x02, 0x38, 0x2E,
+    0x55, 0x43, 0x79, 0x6F, 0x0D, 0x1B, 0x21, 0x37, 0xE5, 0xF3, 0xC9, 0xDF, 0xBD, 0xAB, 0x91, 0x87,
+    0x32, 0x24, 0x1E, 0x08, 0x6A, 0x7C, 0x46, 0x50, 0x82, 0x94, 0xAE, 0xB8, 0xDA, 0xCC, 0xF6, 0xE0,
+    0x31, 0x27, 0x1D, 0x0B, 0x69, 0x7F, 0x45, 0x53, 0x81, 0x97, 0xAD, 0xBB, 0xD9, 0xCF, 0xF5, 0xE3,
+    0x56, 0x40, 0x7A, 0x6C, 0x0E, 0x18, 0x22, 0x34, 0xE6, 0xF0, 0xCA, 0xDC, 0xBE, 0xA8, 0x92, 0x84,
+    0xFF, 0xE9, 0xD3, 0xC5, 0xA7, 0xB1, 0x8B, 0x9D, 0x4F, 0x59, 0x63, 0x75, 0x17, 0x01, 0x3B, 0x2D,
+    0x98, 0x8E, 0xB4, 0xA2, 0xC0, 0xD6, 0xEC, 0xFA, 0x28, 0x3E, 0x04, 0x12, 0x70, 0x66, 0x5C, 0x4A,
+    0xAA, 0xBC, 0x86, 0x90, 0xF2, 0xE4, 0xDE, 0xC8, 0x1A, 0x0C, 0x36, 0x20, 0x42, 0x54, 0x6E, 0x78,
+    0xCD, 0xDB, 0xE1, 0xF7, 0x95, 0x83, 0xB9, 0xAF, 0x7D, 0x6B, 0x51, 0x47, 0x25, 0x33, 0x09, 0x1F,
+    0x64, 0x72, 0x48, 0x5E, 0x3C, 0x2A, 0x10, 0x06, 0xD4, 0xC2, 0xF8, 0xEE, 0x8C, 0x9A, 0xA0, 0xB6,
+    0x03, 0x15, 0x2F, 0x39, 0x5B, 0x4D, 0x77, 0x61, 0xB3, 0xA5, 0x9F, 0x89, 0xEB, 0xFD, 0xC7, 0xD1,
+};
+#endif
+
+
+#ifdef DWT_SPI_PROFILE
+// -------------------------------------------------------------------------------------------------------------------
+// SPI traffic profiler (see dwt_spi_profile_dump)
+//
+#ifndef DWT_SPI_PROFILE_ENTRIES
+#define DWT_SPI_PROFILE_ENTRIES (64)  // number of distinct (register, access type) pairs tracked
+#endif
+
+static const char * const dwt_spi_profile_names[DWT_SPI_PROF_COUNT] =
+{
+    "FAC", "FARW-W", "FARW-R", "EAMRW-W", "EAMRW-R", "AND/OR", "BATCH"
+};
+
+static dwt_spi_profile_t dwt_spi_profile[DWT_SPI_PROFILE_ENTRIES];
+static uint32_t          dwt_spi_profile_overflow;   // transactions not recorded as the table was full
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function adds one SPI transaction to the profiler table
+*
+* input parameters:
+* @param regFileID     - ID of register file or buffer accessed
+* @param type          - access type (dwt_spi_prof_type_e)
+* @param bytes         - bytes on the bus (header, data and crc)
+* @param cycles        - bus time in hardware cycles
+*
+* no return value
+*/
+static void _dwt_spi_profile_add(uint32_t regFileID, uint8_t type, uint16_t bytes, uint32_t cycles)
+{
+    int i;
+
+    for (i = 0; i < DWT_SPI_PROFILE_ENTRIES; i++)
+    {
+        dwt_spi_profile_t *p = &dwt_spi_profile[i];
+
+        if (p->count == 0)
+        {
+            p->regFileID = regFileID;
+            p->type = type;
+        }
+        else if ((p->regFileID != regFileID) || (p->type != type))
+        {
+            continue;
+        }
+        p->count++;
+        p->bytes += bytes;
+        p->cycles += cycles;
+        return;
+    }
+    dwt_spi_profile_overflow++;
+}
+
+#define DWT_SPI_PROF_BEGIN()    uint32_t prof_t0 = k_cycle_get_32()
+#define DWT_SPI_PROF_END(id, type, bytes) _dwt_spi_profile_add((id), (type), (bytes), k_cycle_get_32() - prof_t0)
+#else
+#define DWT_SPI_PROF_BEGIN()
+#define DWT_SPI_PROF_END(id, type, bytes)
+#endif
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function returns the version of the API as defined by DW3000_DRIVER_VERSION
@@ -192,28 +455,110 @@ int dwt_setlocaldataptr(unsigned int index)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
-* @brief  this function is used to read/write to the DW3000 device registers
+ * @brief This function returns the index of the local data structure currently in use, as set by dwt_setlocaldataptr().
+ * The platform layer uses it to route SPI and GPIO accesses to the matching device.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns index of the active device, < DWT_NUM_DW_DEV
+ */
+unsigned int dwt_getlocaldataindex(void)
+{
+    return (unsigned int)(pdw3000local - DW3000local);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function returns the context handle of a device, see dwt_lock() in deca_device_api.h
+ *
+ * input parameters
+ * @param index    - device index, < DWT_NUM_DW_DEV
+ *
+ * output parameters
+ *
+ * returns the context handle, or NULL if index is out of range
+ */
+dwt_context_t *dwt_getcontext(unsigned int index)
+{
+    if (DWT_NUM_DW_DEV <= index)
+    {
+        return NULL;
+    }
+
+    return &DW3000local[index];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function selects a device for the calling thread and takes its lock, see dwt_lock() in
+ * deca_device_api.h
+ *
+ * input parameters
+ * @param ctx      - context handle from dwt_getcontext()
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+int dwt_lock(dwt_context_t *ctx)
+{
+    if (ctx == NULL)
+    {
+        return DWT_ERROR;
+    }
+
+    pdw3000local = ctx;
+    DWT_LOCK();
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function releases the lock taken by dwt_lock()
+ *
+ * input parameters
+ * @param ctx      - context handle passed to dwt_lock()
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_unlock(dwt_context_t *ctx)
+{
+    if (ctx == NULL)
+    {
+        return;
+    }
+
+#ifdef DWT_THREAD_SAFE
+    port_dw_ic_unlock((unsigned int)(ctx - DW3000local));
+#endif
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function composes the SPI transaction header for a read/write to the DW3000 device registers
 *
 * input parameters:
-* @param recordNumber  - ID of register file or buffer being accessed
-* @param index         - byte index into register file or buffer being accessed
-* @param length        - number of bytes being written
-* @param buffer        - pointer to buffer containing the 'length' bytes to be written
-* @param rw            - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT
+* @param regFileID     - ID of register file or buffer being accessed
+* @param indx          - byte index into register file or buffer being accessed
+* @param length        - number of bytes being written/read
+* @param mode          - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT/DW3000_SPI_AND_OR_x
 *
-* no return value
+* output parameters
+* @param header        - buffer (2 bytes) the header is composed in
+*
+* returns the header length in bytes (1 or 2)
 */
 static
-void dwt_xfer3000
+uint16_t dwt_xfer3000_header
 (
     const uint32_t    regFileID,  //0x0, 0x04-0x7F ; 0x10000, 0x10004, 0x10008-0x1007F; 0x20000 etc
     const uint16_t    indx,       //sub-index, calculated from regFileID 0..0x7F,
     const uint16_t    length,
-    uint8_t           *buffer,
-    const spi_modes_e mode
+    const spi_modes_e mode,
+    uint8_t           *header
 )
 {
-    uint8_t  header[2];           // Buffer to compose header in
     uint16_t cnt = 0;             // Counter for length of a header
 
     uint16_t reg_file     = 0x1F & ((regFileID + indx) >> 16);
@@ -261,246 +606,764 @@ void dwt_xfer3000
         cnt = 2;
     }
 
-    switch (mode)
-    {
-    case    DW3000_SPI_AND_OR_8:
-    case    DW3000_SPI_AND_OR_16:
-    case    DW3000_SPI_AND_OR_32:
-    case    DW3000_SPI_WR_BIT:
-    {
-        uint8_t crc8 = 0;
-        if (pdw3000local->spicrc != DWT_SPI_CRC_MODE_NO)
-        {
-            //generate 8 bit CRC
-            crc8 = dwt_generatecrc8(header, cnt, 0);
-            crc8 = dwt_generatecrc8(buffer, length, crc8);
+    return cnt;
+} // end dwt_xfer3000_header()
 
-            // Write it to the SPI
-            writetospiwithcrc(cnt, header, length, buffer, crc8);
-        }
-        else
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function marks all register shadow cache entries invalid
+*
+* no return value
+*/
+static void _dwt_regcache_invalidate(void)
+{
+    pdw3000local->regcache_valid = 0;
+    pdw3000local->ptra_valid = 0;   // the indirect pointer A set up is lost with the registers
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function sets up indirect pointer A to reach the given offset of a buffer, skipping the register writes
+*         the device already has: none when the offset is within the sub-address range (REG_DIRECT_OFFSET_MAX_LEN)
+*         of the offset programmed last in the same buffer, ADDR_OFFSET_A only when the buffer is the same, else both
+*
+* input parameters:
+* @param file_id       - buffer file ID (e.g. RX_BUFFER_0_ID, ACC_MEM_ID)
+* @param offset        - offset in the buffer, in the buffer units (bytes, or complex samples for the accumulator)
+*
+* returns the sub-address to access INDIRECT_POINTER_A_ID at
+*/
+static uint16_t _dwt_ptra_setup(uint32_t file_id, uint16_t offset)
+{
+    uint8_t file = (uint8_t)(file_id >> 16);
+
+    if (pdw3000local->ptra_valid && (pdw3000local->ptra_file == file))
+    {
+        if ((offset >= pdw3000local->ptra_offset) &&
+            ((offset - pdw3000local->ptra_offset) <= REG_DIRECT_OFFSET_MAX_LEN))
         {
-            // Write it to the SPI
-            writetospi(cnt, header, length, buffer);
+            return offset - pdw3000local->ptra_offset;
         }
-        break;
     }
-    case DW3000_SPI_RD_BIT:
-        {
-            readfromspi(cnt, header, length, buffer);
+    else
+    {
+        dwt_write32bitreg(INDIRECT_ADDR_A_ID, file);
+        pdw3000local->ptra_file = file;
+    }
 
-            //check that the SPI read has correct CRC-8 byte
-            //also don't do for SPICRC_CFG_ID register itself to prevent infinite recursion
-            if ((pdw3000local->spicrc == DWT_SPI_CRC_MODE_WRRD) && (regFileID != SPICRC_CFG_ID))
-            {
-                uint8_t crc8, dwcrc8;
-                //generate 8 bit CRC from the read data
-                crc8 = dwt_generatecrc8(header, cnt, 0);
-                crc8 = dwt_generatecrc8(buffer, length, crc8);
+    dwt_write32bitreg(ADDR_OFFSET_A_ID, offset);
+    pdw3000local->ptra_offset = offset;
+    pdw3000local->ptra_valid = 1;
 
-                //read the CRC that was generated in the DW3000 for the read transaction
-                dwcrc8 = dwt_read8bitoffsetreg(SPICRC_CFG_ID, 0);
+    return 0;
+}
 
-                //if the two CRC don't match report SPI read error
-                //potential problem in callback if it will try to read/write SPI with CRC again.
-                if (crc8 != dwcrc8)
-                {
-                    if (pdw3000local->cbSPIRDErr != NULL)
-                        pdw3000local->cbSPIRDErr();
-                }
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function serves a register access from the shadow cache where it can, and keeps the cache in step
+*         with accesses that go out over the SPI
+*
+* input parameters:
+* @param regFileID     - ID of register file or buffer being accessed
+* @param indx          - byte index into register file or buffer being accessed
+* @param length        - number of bytes being written/read
+* @param buffer        - data to write, or buffer to read into
+* @param mode          - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT/DW3000_SPI_AND_OR_x
+*
+* output parameters
+* @param fill          - set to the cache entry to fill from the read data once it has been read, else -1
+*
+* returns 1 if the access has been completed from/through the cache, 0 if it still needs to be sent as is
+*/
+static int _dwt_regcache_access(uint32_t regFileID, uint16_t indx, uint16_t length, uint8_t *buffer, spi_modes_e mode, int *fill);
 
-            }
-            break;
-        }
-    default:
-        while(1);
-        break;
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function appends the queued register writes to the register image being recorded by
+*         dwt_cfgimage_build(), or marks it overflowed if they do not fit
+*
+* no return value
+*/
+static void _dwt_cfgimage_record(void)
+{
+    dwt_cfgimage_t *img = pdw3000local->cfgimage;
+    dwt_batch_t *batch = &pdw3000local->batch;
+
+    if (((img->count + batch->count) > DWT_CFGIMAGE_MAX_OPS) || ((img->used + batch->used) > DWT_CFGIMAGE_BUF_LEN))
+    {
+        img->overflow = 1;
+        return;
     }
 
-} // end dwt_xfer3000()
+    memcpy(&img->len[img->count], batch->len, batch->count * sizeof(batch->len[0]));
+    memcpy(&img->buf[img->used], batch->buf, batch->used);
+    img->count += batch->count;
+    img->used += batch->used;
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief  this function is used to write to the DW3000 device registers
+* @brief  this function sends all queued register writes, back to back, and empties the batch queue
+*
+* no return value
+*/
+static void _dwt_batch_flush(void)
+{
+    if (pdw3000local->cfgimage != NULL)
+    {
+        _dwt_cfgimage_record();
+    }
+
+    if (pdw3000local->batch.count != 0)
+    {
+        DWT_SPI_PROF_BEGIN();
+        writetospi_batch(pdw3000local->batch.count, pdw3000local->batch.len, pdw3000local->batch.buf);
+        DWT_SPI_PROF_END(0, DWT_SPI_PROF_BATCH, pdw3000local->batch.used);
+    }
+    pdw3000local->batch.count = 0;
+    pdw3000local->batch.used = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function appends one register write (header, data and crc if enabled) to the batch queue,
+*         flushing the queue first if it is full
+*
+* input parameters:
+* @param header        - SPI header composed by dwt_xfer3000_header()
+* @param cnt           - header length
+* @param buffer        - data to write
+* @param length        - data length (<= DWT_BATCH_MAX_OP_DATA)
+*
+* no return value
+*/
+static void _dwt_batch_queue(const uint8_t *header, uint16_t cnt, const uint8_t *buffer, uint16_t length)
+{
+    uint16_t oplen = cnt + length + ((pdw3000local->spicrc != DWT_SPI_CRC_MODE_NO) ? 1 : 0);
+    uint8_t *op;
+
+    if ((pdw3000local->batch.count == DWT_BATCH_MAX_OPS) || ((pdw3000local->batch.used + oplen) > DWT_BATCH_BUF_LEN))
+    {
+        _dwt_batch_flush();
+    }
+
+    op = &pdw3000local->batch.buf[pdw3000local->batch.used];
+    memcpy(op, header, cnt);
+    memcpy(op + cnt, buffer, length);
+
+    if (pdw3000local->spicrc != DWT_SPI_CRC_MODE_NO)
+    {
+        op[cnt + length] = dwt_generatecrc8(op, cnt + length, 0);
+    }
+
+    pdw3000local->batch.len[pdw3000local->batch.count++] = oplen;
+    pdw3000local->batch.used += oplen;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function starts batching of register writes: until the matching dwt_batch_end(), short register
+ * writes (including AND/OR modifies and fast commands) are queued and sent back to back. Any read, or longer
+ * buffer write, sends the queued writes first so the order of accesses is preserved. Calls may be nested.
  *
- * input parameters:
- * @param recordNumber  - ID of register file or buffer being accessed
- * @param index         - byte index into register file or buffer being accessed
- * @param length        - number of bytes being written
- * @param buffer        - pointer to buffer containing the 'length' bytes to be written
+ * input parameters
  *
  * output parameters
  *
  * no return value
  */
-//static
-void dwt_writetodevice
-(
-    uint32_t      regFileID,
-    uint16_t      index,
-    uint16_t      length,
-    uint8_t       *buffer
-)
+void dwt_batch_begin(void)
 {
-    dwt_xfer3000(regFileID, index, length, buffer, DW3000_SPI_WR_BIT);
+    DWT_LOCK();
+    pdw3000local->batch.depth++;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief  This function wakeup device by an IO pin. DW3000 SPI_CS or WAKEUP pins can be used for this.
- *         wakeup_device_with_io() which is external to this file and is platform dependant and it should be modified to
- *         toggle the correct pin depending on the HW/MCU connections with DW3000.
+ * @brief This function ends batching of register writes started by dwt_batch_begin(), the outermost call sends
+ * any queued writes.
  *
- * @param None
+ * input parameters
  *
  * output parameters
  *
  * no return value
  */
-void dwt_wakeup_ic(void)
+void dwt_batch_end(void)
 {
-    wakeup_device_with_io();
+    if (pdw3000local->batch.depth == 0)
+    {
+        return;
+    }
+
+    if (--pdw3000local->batch.depth == 0)
+    {
+        _dwt_batch_flush();
+    }
+    DWT_UNLOCK();
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief  this function is used to read from the DW3000 device registers
- *
- * @param recordNumber  - ID of register file or buffer being accessed
- * @param index         - byte index into register file or buffer being accessed
- * @param length        - number of bytes being read
- * @param buffer        - pointer to buffer in which to return the read data.
- *
- * output parameters
- *
- * no return value
- */
-//static
-void dwt_readfromdevice
+* @brief  this function is used to read/write to the DW3000 device registers
+*
+* input parameters:
+* @param recordNumber  - ID of register file or buffer being accessed
+* @param index         - byte index into register file or buffer being accessed
+* @param length        - number of bytes being written
+* @param buffer        - pointer to buffer containing the 'length' bytes to be written
+* @param rw            - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT
+*
+* no return value
+*/
+static
+void _dwt_xfer3000
 (
-    uint32_t  regFileID,
-    uint16_t  index,
-    uint16_t  length,
-    uint8_t   *buffer
+    const uint32_t    regFileID,  //0x0, 0x04-0x7F ; 0x10000, 0x10004, 0x10008-0x1007F; 0x20000 etc
+    const uint16_t    indx,       //sub-index, calculated from regFileID 0..0x7F,
+    const uint16_t    length,
+    uint8_t           *buffer,
+    const spi_modes_e mode
 )
 {
-    dwt_xfer3000(regFileID, index, length, buffer, DW3000_SPI_RD_BIT);
-}
+    uint8_t  header[2];           // Buffer to compose header in
+    uint16_t cnt;                 // Length of the header
+    int      fill = -1;           // Register shadow cache entry to fill from the read data
+#ifdef DWT_SPI_PROFILE
+    uint8_t  prof_type;
+#endif
+
+    if (pdw3000local->regcache_en && (length != 0))
+    {
+        if (_dwt_regcache_access(regFileID, indx, length, buffer, mode, &fill))
+        {
+            return;
+        }
+    }
+
+    cnt = dwt_xfer3000_header(regFileID, indx, length, mode, header);
+
+    if (pdw3000local->batch.depth != 0)
+    {
+        // queue short register writes, anything else must see the queued writes done first
+        if ((mode != DW3000_SPI_RD_BIT) && (length <= DWT_BATCH_MAX_OP_DATA))
+        {
+            _dwt_batch_queue(header, cnt, buffer, length);
+            return;
+        }
+        _dwt_batch_flush();
+
+        if ((mode != DW3000_SPI_RD_BIT) && (pdw3000local->cfgimage != NULL))
+        {
+            pdw3000local->cfgimage->overflow = 1;   // a long write cannot be recorded
+        }
+    }
+
+#ifdef DWT_SPI_PROFILE
+    if (length == 0)
+        prof_type = DWT_SPI_PROF_FAC;
+    else if (mode == DW3000_SPI_AND_OR_8 || mode == DW3000_SPI_AND_OR_16 || mode == DW3000_SPI_AND_OR_32)
+        prof_type = DWT_SPI_PROF_AND_OR;
+    else if (cnt == 1)
+        prof_type = (mode == DW3000_SPI_RD_BIT) ? DWT_SPI_PROF_FARW_RD : DWT_SPI_PROF_FARW_WR;
+    else
+        prof_type = (mode == DW3000_SPI_RD_BIT) ? DWT_SPI_PROF_EAMRW_RD : DWT_SPI_PROF_EAMRW_WR;
+#endif
+
+    switch (mode)
+    {
+    case    DW3000_SPI_AND_OR_8:
+    case    DW3000_SPI_AND_OR_16:
+    case    DW3000_SPI_AND_OR_32:
+    case    DW3000_SPI_WR_BIT:
+    {
+        uint8_t crc8 = 0;
+        if (pdw3000local->spicrc != DWT_SPI_CRC_MODE_NO)
+        {
+            //generate 8 bit CRC
+            crc8 = dwt_generatecrc8(header, cnt, 0);
+            crc8 = dwt_generatecrc8(buffer, length, crc8);
+
+            // Write it to the SPI
+            DWT_SPI_PROF_BEGIN();
+            writetospiwithcrc(cnt, header, length, buffer, crc8);
+            DWT_SPI_PROF_END(regFileID, prof_type, cnt + length + 1);
+        }
+        else
+        {
+            // Write it to the SPI
+            DWT_SPI_PROF_BEGIN();
+            writetospi(cnt, header, length, buffer);
+            DWT_SPI_PROF_END(regFileID, prof_type, cnt + length);
+        }
+        break;
+    }
+    case DW3000_SPI_RD_BIT:
+        {
+            {
+                DWT_SPI_PROF_BEGIN();
+                readfromspi(cnt, header, length, buffer);
+                DWT_SPI_PROF_END(regFileID, prof_type, cnt + length);
+            }
+
+            //check that the SPI read has correct CRC-8 byte
+            //also don't do for SPICRC_CFG_ID register itself to prevent infinite recursion
+            if ((pdw3000local->spicrc == DWT_SPI_CRC_MODE_WRRD) && (regFileID != SPICRC_CFG_ID))
+            {
+                uint8_t crc8, dwcrc8;
+                //generate 8 bit CRC from the read data
+                crc8 = dwt_generatecrc8(header, cnt, 0);
+                crc8 = dwt_generatecrc8(buffer, length, crc8);
+
+                //read the CRC that was generated in the DW3000 for the read transaction
+                dwcrc8 = dwt_read8bitoffsetreg(SPICRC_CFG_ID, 0);
+
+                //if the two CRC don't match report SPI read error
+                //potential problem in callback if it will try to read/write SPI with CRC again.
+                if (crc8 != dwcrc8)
+                {
+                    fill = -1;  //don't cache a corrupted read
+                    if (pdw3000local->cbSPIRDErr != NULL)
+                        pdw3000local->cbSPIRDErr();
+                }
+
+            }
+
+            if (fill >= 0)
+            {
+                memcpy(pdw3000local->regcache[fill], buffer, DWT_REGCACHE_WORD_LEN);
+                pdw3000local->regcache_valid |= (uint16_t)(1 << fill);
+            }
+            break;
+        }
+    default:
+        while(1);
+        break;
+    }
+
+} // end _dwt_xfer3000()
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief  this function is used to read 32-bit value from the DW3000 device registers
- *
- * input parameters:
- * @param regFileID - ID of register file or buffer being accessed
- * @param regOffset - the index into register file or buffer being accessed
- *
- * output parameters
- *
- * returns 32 bit register value
- */
-uint32_t dwt_read32bitoffsetreg(int regFileID, int regOffset)
+* @brief  this function is used to read/write to the DW3000 device registers, see _dwt_xfer3000(). With
+*         DWT_THREAD_SAFE the whole transaction (cache lookup, SPI transfer and CRC check) holds the device lock.
+*
+* no return value
+*/
+static
+void dwt_xfer3000
+(
+    const uint32_t    regFileID,
+    const uint16_t    indx,
+    const uint16_t    length,
+    uint8_t           *buffer,
+    const spi_modes_e mode
+)
 {
-    int     j ;
-    uint32_t  regval = 0 ;
-    uint8_t   buffer[4] ;
+    DWT_LOCK();
+    _dwt_xfer3000(regFileID, indx, length, buffer, mode);
+    DWT_UNLOCK();
+}
 
-    dwt_readfromdevice(regFileID,regOffset,4,buffer); // Read 4 bytes (32-bits) register into buffer
+static int _dwt_regcache_access(uint32_t regFileID, uint16_t indx, uint16_t length, uint8_t *buffer, spi_modes_e mode, int *fill)
+{
+    uint32_t addr = regFileID + indx;
+    uint16_t width = (mode == DW3000_SPI_WR_BIT || mode == DW3000_SPI_RD_BIT) ? length : (length >> 1);
+    uint32_t i;
 
-    for (j = 3 ; j >= 0 ; j --)
+    for (i = 0; i < DWT_REGCACHE_ENTRIES; i++)
     {
-        regval = (regval << 8) + buffer[j] ;
-    }
+        uint32_t base = dwt_regcache_ids[i];
+        uint16_t bit  = (uint16_t)(1 << i);
+        uint8_t  *word = pdw3000local->regcache[i];
 
-    return (regval);
+        if ((addr + width <= base) || (addr >= base + DWT_REGCACHE_WORD_LEN))
+        {
+            continue;   // no overlap with this entry
+        }
 
-} // end dwt_read32bitoffsetreg()
+        if ((addr < base) || (addr + width > base + DWT_REGCACHE_WORD_LEN))
+        {
+            // partial overlap (e.g. wider access), only keep the cache coherent
+            if (mode != DW3000_SPI_RD_BIT)
+            {
+                pdw3000local->regcache_valid &= (uint16_t)~bit;
+            }
+            continue;
+        }
+
+        // the access is inside the cached word
+        word += (addr - base);
+
+        switch (mode)
+        {
+        case DW3000_SPI_RD_BIT:
+            if (pdw3000local->regcache_valid & bit)
+            {
+                memcpy(buffer, word, length);
+                return 1;
+            }
+            if (width == DWT_REGCACHE_WORD_LEN)
+            {
+                *fill = (int)i;  // whole word is being read, cache it
+            }
+            return 0;
+
+        case DW3000_SPI_WR_BIT:
+            if (pdw3000local->regcache_valid & bit)
+            {
+                if (memcmp(word, buffer, width) == 0)
+                {
+                    return 1;   // no change, nothing to send
+                }
+                memcpy(word, buffer, width);
+            }
+            else if (width == DWT_REGCACHE_WORD_LEN)
+            {
+                memcpy(word, buffer, width);
+                pdw3000local->regcache_valid |= bit;
+            }
+            return 0;
+
+        default:    // AND/OR modify: buffer holds the AND mask followed by the OR mask
+            if (pdw3000local->regcache_valid & bit)
+            {
+                uint8_t newval[4];
+                int     j;
+
+                for (j = 0; j < width; j++)
+                {
+                    newval[j] = (word[j] & buffer[j]) | buffer[width + j];
+                }
+                // send the resulting value as a plain write, which also updates the cache (or is skipped if unchanged)
+                dwt_xfer3000(regFileID, indx, width, newval, DW3000_SPI_WR_BIT);
+                return 1;
+            }
+            return 0;
+        }
+    }
 
+    return 0;
+}
+
+#ifdef DWT_SPI_PROFILE
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief  this function is used to read 16-bit value from the DW3000 device registers
+ * @brief This function returns the SPI traffic profiler table
  *
- * input parameters:
- * @param regFileID - ID of register file or buffer being accessed
- * @param regOffset - the index into register file or buffer being accessed
+ * input parameters
  *
  * output parameters
+ * @param count - set to the number of entries used
  *
- * returns 16 bit register value
+ * returns pointer to the first entry
  */
-uint16_t dwt_read16bitoffsetreg(int regFileID,int regOffset)
+const dwt_spi_profile_t *dwt_spi_profile_get(uint16_t *count)
 {
-    uint16_t  regval = 0 ;
-    uint8_t   buffer[2] ;
-
-    dwt_readfromdevice(regFileID,regOffset,2,buffer); // Read 2 bytes (16-bits) register into buffer
+    uint16_t n = 0;
 
-    regval = ((uint16_t)buffer[1] << 8) + buffer[0] ;
-    return regval ;
+    while ((n < DWT_SPI_PROFILE_ENTRIES) && (dwt_spi_profile[n].count != 0))
+    {
+        n++;
+    }
+    *count = n;
 
-} // end dwt_read16bitoffsetreg()
+    return dwt_spi_profile;
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief  this function is used to read an 8-bit value from the DW3000 device registers
+ * @brief This function clears the SPI traffic profiler table
  *
- * input parameters:
- * @param regFileID - ID of register file or buffer being accessed
- * @param regOffset - the index into register file or buffer being accessed
+ * input parameters
  *
  * output parameters
  *
- * returns 8-bit register value
+ * no return value
  */
-uint8_t dwt_read8bitoffsetreg(int regFileID, int regOffset)
+void dwt_spi_profile_reset(void)
 {
-    uint8_t regval;
-
-    dwt_readfromdevice(regFileID, regOffset, 1, &regval);
-
-    return regval ;
+    memset(dwt_spi_profile, 0, sizeof(dwt_spi_profile));
+    dwt_spi_profile_overflow = 0;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief  this function is used to write 32-bit value to the DW3000 device registers
+ * @brief This function logs the SPI traffic profiler table: per register file ID and access type the transaction
+ * count, bytes on the bus and cumulative bus time
  *
- * input parameters:
- * @param regFileID - ID of register file or buffer being accessed
- * @param regOffset - the index into register file or buffer being accessed
- * @param regval    - the value to write
+ * input parameters
  *
  * output parameters
  *
  * no return value
  */
-void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32_t regval)
+void dwt_spi_profile_dump(void)
 {
-    int     j ;
-    uint8_t   buffer[4] ;
+    int i;
 
-    for ( j = 0 ; j < 4 ; j++ )
+    for (i = 0; (i < DWT_SPI_PROFILE_ENTRIES) && (dwt_spi_profile[i].count != 0); i++)
     {
-        buffer[j] = (uint8_t)regval;
-        regval >>= 8 ;
-    }
+        dwt_spi_profile_t *p = &dwt_spi_profile[i];
 
-    dwt_writetodevice(regFileID,regOffset,4,buffer);
-} // end dwt_write32bitoffsetreg()
+        LOG_INF("0x%06x %-7s n=%u bytes=%u time=%u us", p->regFileID, dwt_spi_profile_names[p->type],
+                p->count, p->bytes, (uint32_t)k_cyc_to_us_floor64(p->cycles));
+    }
+    if (dwt_spi_profile_overflow != 0)
+    {
+        LOG_INF("%u transactions not recorded (table full)", dwt_spi_profile_overflow);
+    }
+}
+#endif
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief  this function is used to write 16-bit value to the DW3000 device registers
+ * @brief This function enables/disables the register shadow cache, see dwt_enableregcache() in deca_device_api.h
  *
- * input parameters:
- * @param regFileID - ID of register file or buffer being accessed
- * @param regOffset - the index into register file or buffer being accessed
- * @param regval    - the value to write
+ * input parameters
+ * @param enable - 1 to enable, 0 to disable (and invalidate) the cache
  *
  * output parameters
  *
  * no return value
  */
-void dwt_write16bitoffsetreg(int regFileID, int regOffset, uint16_t regval)
+void dwt_enableregcache(int enable)
 {
-    uint8_t   buffer[2] ;
-
-    buffer[0] = (uint8_t)regval;
-    buffer[1] = regval >> 8 ;
+    _dwt_regcache_invalidate();
+    if (pdw3000local->regcache_atx2slp)
+    {
+        // held off while auto TX to sleep is on, applied by dwt_entersleepaftertx(0)
+        pdw3000local->regcache_saved = (enable != 0) ? 1 : 0;
+        return;
+    }
+    pdw3000local->regcache_en = (enable != 0) ? 1 : 0;
+}
 
-    dwt_writetodevice(regFileID,regOffset,2,buffer);
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function starts an asynchronous read/write of the DW3000 device registers or buffers
+*
+* input parameters:
+* @param regFileID     - ID of register file or buffer being accessed
+* @param indx          - byte index into register file or buffer being accessed
+* @param length        - number of bytes being written/read
+* @param buffer        - pointer to buffer containing the 'length' bytes to be written, or to read into
+* @param mode          - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT
+* @param cb            - completion call-back
+* @param arg           - user argument passed to the call-back
+*
+* returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+*/
+static
+int dwt_xfer3000_async
+(
+    const uint32_t    regFileID,
+    const uint16_t    indx,
+    const uint16_t    length,
+    uint8_t           *buffer,
+    const spi_modes_e mode,
+    dwt_spi_done_cb_t cb,
+    void              *arg
+)
+{
+    uint8_t  header[2];           // Buffer to compose header in, copied by the platform
+    uint16_t cnt;                 // Length of the header
+    int      ret;
+
+    assert(length > 0);
+    assert(mode == DW3000_SPI_WR_BIT || mode == DW3000_SPI_RD_BIT);
+
+    cnt = dwt_xfer3000_header(regFileID, indx, length, mode, header);
+
+    if (mode == DW3000_SPI_RD_BIT)
+    {
+        ret = readfromspi_async(cnt, header, length, buffer, cb, arg);
+    }
+    else if (pdw3000local->spicrc != DWT_SPI_CRC_MODE_NO)
+    {
+        uint8_t crc8;
+        //generate 8 bit CRC
+        crc8 = dwt_generatecrc8(header, cnt, 0);
+        crc8 = dwt_generatecrc8(buffer, length, crc8);
+
+        ret = writetospiwithcrc_async(cnt, header, length, buffer, crc8, cb, arg);
+    }
+    else
+    {
+        ret = writetospi_async(cnt, header, length, buffer, cb, arg);
+    }
+
+    return (ret == 0) ? DWT_SUCCESS : DWT_ERROR;
+} // end dwt_xfer3000_async()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function is used to write to the DW3000 device registers
+ *
+ * input parameters:
+ * @param recordNumber  - ID of register file or buffer being accessed
+ * @param index         - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being written
+ * @param buffer        - pointer to buffer containing the 'length' bytes to be written
+ *
+ * output parameters
+ *
+ * no return value
+ */
+//static
+void dwt_writetodevice
+(
+    uint32_t      regFileID,
+    uint16_t      index,
+    uint16_t      length,
+    uint8_t       *buffer
+)
+{
+    dwt_xfer3000(regFileID, index, length, buffer, DW3000_SPI_WR_BIT);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  This function wakeup device by an IO pin. DW3000 SPI_CS or WAKEUP pins can be used for this.
+ *         wakeup_device_with_io() which is external to this file and is platform dependant and it should be modified to
+ *         toggle the correct pin depending on the HW/MCU connections with DW3000.
+ *
+ * @param None
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_wakeup_ic(void)
+{
+    _dwt_regcache_invalidate();
+    wakeup_device_with_io();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function is used to read from the DW3000 device registers
+ *
+ * @param recordNumber  - ID of register file or buffer being accessed
+ * @param index         - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being read
+ * @param buffer        - pointer to buffer in which to return the read data.
+ *
+ * output parameters
+ *
+ * no return value
+ */
+//static
+void dwt_readfromdevice
+(
+    uint32_t  regFileID,
+    uint16_t  index,
+    uint16_t  length,
+    uint8_t   *buffer
+)
+{
+    dwt_xfer3000(regFileID, index, length, buffer, DW3000_SPI_RD_BIT);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function is used to read 32-bit value from the DW3000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ *
+ * output parameters
+ *
+ * returns 32 bit register value
+ */
+uint32_t dwt_read32bitoffsetreg(int regFileID, int regOffset)
+{
+    int     j ;
+    uint32_t  regval = 0 ;
+    uint8_t   buffer[4] ;
+
+    dwt_readfromdevice(regFileID,regOffset,4,buffer); // Read 4 bytes (32-bits) register into buffer
+
+    for (j = 3 ; j >= 0 ; j --)
+    {
+        regval = (regval << 8) + buffer[j] ;
+    }
+
+    return (regval);
+
+} // end dwt_read32bitoffsetreg()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function is used to read 16-bit value from the DW3000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ *
+ * output parameters
+ *
+ * returns 16 bit register value
+ */
+uint16_t dwt_read16bitoffsetreg(int regFileID,int regOffset)
+{
+    uint16_t  regval = 0 ;
+    uint8_t   buffer[2] ;
+
+    dwt_readfromdevice(regFileID,regOffset,2,buffer); // Read 2 bytes (16-bits) register into buffer
+
+    regval = ((uint16_t)buffer[1] << 8) + buffer[0] ;
+    return regval ;
+
+} // end dwt_read16bitoffsetreg()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function is used to read an 8-bit value from the DW3000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ *
+ * output parameters
+ *
+ * returns 8-bit register value
+ */
+uint8_t dwt_read8bitoffsetreg(int regFileID, int regOffset)
+{
+    uint8_t regval;
+
+    dwt_readfromdevice(regFileID, regOffset, 1, &regval);
+
+    return regval ;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function is used to write 32-bit value to the DW3000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ * @param regval    - the value to write
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32_t regval)
+{
+    int     j ;
+    uint8_t   buffer[4] ;
+
+    for ( j = 0 ; j < 4 ; j++ )
+    {
+        buffer[j] = (uint8_t)regval;
+        regval >>= 8 ;
+    }
+
+    dwt_writetodevice(regFileID,regOffset,4,buffer);
+} // end dwt_write32bitoffsetreg()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function is used to write 16-bit value to the DW3000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ * @param regval    - the value to write
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_write16bitoffsetreg(int regFileID, int regOffset, uint16_t regval)
+{
+    uint8_t   buffer[2] ;
+
+    buffer[0] = (uint8_t)regval;
+    buffer[1] = regval >> 8 ;
+
+    dwt_writetodevice(regFileID,regOffset,2,buffer);
 } // end dwt_write16bitoffsetreg()
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -584,51 +1447,10 @@ void dwt_modify8bitoffsetreg(const int regFileID, const int regOffset, const uin
     dwt_xfer3000(regFileID, regOffset, sizeof(buf),buf, DW3000_SPI_AND_OR_8);
 }
 
-static
-void _dwt_crc8init(void)
-{
-    uint8_t  remainder;
-    int dividend;
-
-    /*
-    * Compute the remainder of each possible dividend.
-    */
-    for (dividend = 0; dividend < 256; ++dividend)
-    {
-        /*
-        * Start with the dividend followed by zeros.
-        */
-        remainder = dividend;
-
-        /*
-        * Perform modulo-2 division, a bit at a time.
-        */
-        for (uint8_t bit = 8; bit > 0; --bit)
-        {
-            /*
-            * Try to divide the current data bit.
-            */
-            if (remainder & TOPBIT)
-            {
-                remainder = (remainder << 1) ^ POLYNOMIAL;
-            }
-            else
-            {
-                remainder = (remainder << 1);
-            }
-        }
-
-        /*
-        * Store the result into the table.
-        */
-        crcTable[dividend] = remainder;
-    }
-
-}   /* _dwt_crc8init() */
-
 /*! ------------------------------------------------------------------------------------------------------------------
 * @brief  this function is used to calculate 8-bit CRC, it uses 100000111 polynomial (i.e. P(x) = x^8+ x^2+ x^1+ x^0)
-* this function has been optimized to use crcTable[] and calculate the CRC on byte by byte basis.
+* this function has been optimized to use the constant crcTable[] and, unless DWT_CRC8_SMALL is defined, processes
+* 4 bytes per step with the slicing tables crcTable1[]..crcTable3[] (e.g. long TX data payloads).
 *
 * input parameters:
 * @param byteArray         - data to calculate CRC for
@@ -642,12 +1464,26 @@ void _dwt_crc8init(void)
 uint8_t dwt_generatecrc8(const uint8_t* byteArray, int len, uint8_t crcRemainderInit)
 {
     uint8_t data;
-    int byte;
+    int byte = 0;
+
+#ifndef DWT_CRC8_SMALL
+    /*
+    * Divide the message by the polynomial, 4 bytes at a time: the remainder only depends on the first byte
+    * (XORed with the running remainder), shifted through 3 more zero bytes, and on the 3 following bytes.
+    */
+    for (; byte + 4 <= len; byte += 4)
+    {
+        crcRemainderInit = crcTable3[byteArray[byte] ^ crcRemainderInit]
+                         ^ crcTable2[byteArray[byte + 1]]
+                         ^ crcTable1[byteArray[byte + 2]]
+                         ^ crcTable[byteArray[byte + 3]];
+    }
+#endif
 
     /*
     * Divide the message by the polynomial, a byte at a time.
     */
-    for (byte = 0; byte < len; ++byte)
+    for (; byte < len; ++byte)
     {
         data = byteArray[byte] ^ crcRemainderInit;
         crcRemainderInit = crcTable[data];// ^ (crcRemainderInit << 8);
@@ -685,8 +1521,6 @@ void dwt_enablespicrccheck(dwt_spi_crc_mode_e crc_mode, dwt_spierrcb_t spireader
         {
             pdw3000local->cbSPIRDErr = spireaderr_cb;
         }
-        //initialise the crc calculation lookup table
-        _dwt_crc8init();
     }
     else
     {
@@ -761,6 +1595,11 @@ void _dwt_kick_dgc_on_wakeup(int8_t channel)
     }
 }
 
+static void _dwt_initialise_from_cache(const dwt_init_cache_t *cache);
+static void _dwt_configure_regs(dwt_config_t *config);
+static int _dwt_configure_finish(uint8_t chan, uint8_t rxCode);
+static void _dwt_configure_dgc(uint8_t chan, uint8_t rxCode);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function initialises the DW3000 transceiver:
  * it reads its DEV_ID register (address 0x00) to verify the IC is one supported
@@ -788,10 +1627,12 @@ int dwt_initialise(int mode)
 
     pdw3000local->dblbuffon = DBL_BUFF_OFF; // Double buffer mode off by default / clear the flag
     pdw3000local->sleep_mode = DWT_RUNSAR;  // Configure RUN_SAR on wake by default as it is needed when running PGF_CAL
+    pdw3000local->cfgactive = NULL;
     pdw3000local->spicrc = 0;
     pdw3000local->stsconfig = 0; //STS off
     pdw3000local->vBatP = 0;
     pdw3000local->tempP = 0;
+    pdw3000local->otp_ref = 0;
 
     pdw3000local->cbTxDone = NULL;
     pdw3000local->cbRxOk = NULL;
@@ -799,6 +1640,10 @@ int dwt_initialise(int mode)
     pdw3000local->cbRxErr = NULL;
     pdw3000local->cbSPIRdy = NULL;
     pdw3000local->cbSPIErr = NULL;
+    pdw3000local->cbCCAFail = NULL;
+
+    _dwt_regcache_invalidate();
+    memset(pdw3000local->otp_shadow_valid, 0, sizeof(pdw3000local->otp_shadow_valid));
 
     // Read and validate device ID return -1 if not recognised
     if (dwt_check_dev_id()!=DWT_SUCCESS)
@@ -806,18 +1651,38 @@ int dwt_initialise(int mode)
         return DWT_ERROR;
     }
 
+    // Batch the OTP access writes, each OTP read sends them
+    dwt_batch_begin();
+
+    // Use the warm boot copy of the OTP data if it is for this part (and holds the data asked for)
+    if (pdw3000local->initcache != NULL)
+    {
+        const dwt_init_cache_t *cache = pdw3000local->initcache;
+
+        if (((mode & DWT_READ_OTP_ALL & ~cache->mode) == 0) &&
+            (_dwt_otpread_shadow(PARTID_ADDRESS) == cache->partID))
+        {
+            _dwt_initialise_from_cache(cache);
+
+            dwt_batch_end();
+
+            return DWT_SUCCESS ;
+        }
+    }
+
     //Read LDO_TUNE and BIAS_TUNE from OTP
-    ldo_tune_lo = _dwt_otpread(LDOTUNELO_ADDRESS);
-    ldo_tune_hi = _dwt_otpread(LDOTUNEHI_ADDRESS);
-    pdw3000local->bias_tune = (_dwt_otpread(BIAS_TUNE_ADDRESS) >> 16) & BIAS_CTRL_BIAS_MASK;
+    ldo_tune_lo = _dwt_otpread_shadow(LDOTUNELO_ADDRESS);
+    ldo_tune_hi = _dwt_otpread_shadow(LDOTUNEHI_ADDRESS);
+    pdw3000local->bias_tune = (_dwt_otpread_shadow(BIAS_TUNE_ADDRESS) >> 16) & BIAS_CTRL_BIAS_MASK;
+    pdw3000local->ldo_tune_set = ((ldo_tune_lo != 0) && (ldo_tune_hi != 0));
 
-    if ((ldo_tune_lo != 0) && (ldo_tune_hi != 0) && (pdw3000local->bias_tune != 0))
+    if (pdw3000local->ldo_tune_set && (pdw3000local->bias_tune != 0))
     {
         _dwt_prog_ldo_and_bias_tune();
     }
 
     // Read DGC_CFG from OTP
-    if (_dwt_otpread(DGC_TUNE_ADDRESS) == DWT_DGC_CFG0)
+    if (_dwt_otpread_shadow(DGC_TUNE_ADDRESS) == DWT_DGC_CFG0)
     {
         pdw3000local->dgc_otp_set = DWT_DGC_LOAD_FROM_OTP;
     }
@@ -828,56 +1693,148 @@ int dwt_initialise(int mode)
 
     // Load Part and Lot ID from OTP
     if(mode & DWT_READ_OTP_PID)
-        pdw3000local->partID = _dwt_otpread(PARTID_ADDRESS);
+        pdw3000local->partID = _dwt_otpread_shadow(PARTID_ADDRESS);
     if (mode & DWT_READ_OTP_LID)
-        pdw3000local->lotID = _dwt_otpread(LOTID_ADDRESS);
+        pdw3000local->lotID = _dwt_otpread_shadow(LOTID_ADDRESS);
     if (mode & DWT_READ_OTP_BAT)
-        pdw3000local->vBatP = (uint8_t)_dwt_otpread(VBAT_ADDRESS);
+        pdw3000local->vBatP = (uint8_t)_dwt_otpread_shadow(VBAT_ADDRESS);
     if (mode & DWT_READ_OTP_TMP)
-        pdw3000local->tempP = (uint8_t)_dwt_otpread(VTEMP_ADDRESS);
+        pdw3000local->tempP = (uint8_t)_dwt_otpread_shadow(VTEMP_ADDRESS);
 
 
     if(pdw3000local->tempP == 0) //if the reference temperature has not been programmed in OTP (early eng samples) set to default value
     {
         pdw3000local->tempP = 0x85 ; //@temp of 20 deg
     }
+    else
+    {
+        pdw3000local->otp_ref |= DWT_READ_OTP_TMP;
+    }
 
     if(pdw3000local->vBatP == 0) //if the reference voltage has not been programmed in OTP (early eng samples) set to default value
     {
         pdw3000local->vBatP = 0x74 ;  //@Vref of 3.0V
     }
+    else
+    {
+        pdw3000local->otp_ref |= DWT_READ_OTP_BAT;
+    }
 
-    pdw3000local->otprev = (uint8_t) _dwt_otpread(OTPREV_ADDRESS);
+    pdw3000local->otprev = (uint8_t) _dwt_otpread_shadow(OTPREV_ADDRESS);
 
-    pdw3000local->init_xtrim = _dwt_otpread(XTRIM_ADDRESS) & 0x7f;
+    pdw3000local->init_xtrim = _dwt_otpread_shadow(XTRIM_ADDRESS) & 0x7f;
     if(pdw3000local->init_xtrim == 0)
     {
         pdw3000local->init_xtrim = 0x2E ; //set default value
     }
     dwt_write8bitoffsetreg(XTAL_ID, 0, pdw3000local->init_xtrim);
 
+    dwt_batch_end();
 
     return DWT_SUCCESS ;
 
 } // end dwt_initialise()
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This function can place DW3000 into IDLE/IDLE_PLL or IDLE_RC mode when it is not actively in TX or RX.
+ * @brief This function completes dwt_initialise() from a validated warm boot copy of the OTP data
  *
  * input parameters
- * @param state - DWT_DW_IDLE (1) to put DW3000 into IDLE/IDLE_PLL state; DWT_DW_INIT (0) to put DW3000 into INIT_RC state;
- *                DWT_DW_IDLE_RC (2) to put DW3000 into IDLE_RC state.
+ * @param cache - OTP data saved with dwt_getinitcache(), checked against the part ID
  *
- * output parameters none
+ * output parameters
  *
  * no return value
  */
-void dwt_setdwstate(int state)
+static void _dwt_initialise_from_cache(const dwt_init_cache_t *cache)
 {
-    if (state == DWT_DW_IDLE) // Set the auto INIT2IDLE bit so that DW3000 enters IDLE mode before switching clocks to system_PLL
-    //NOTE: PLL should be configured prior to this, and the device should be in IDLE_RC (if the PLL does not lock device will remain in IDLE_RC)
+    pdw3000local->partID = cache->partID;
+    pdw3000local->lotID = cache->lotID;
+    pdw3000local->bias_tune = cache->bias_tune;
+    pdw3000local->ldo_tune_set = cache->ldo_tune_set;
+    pdw3000local->dgc_otp_set = cache->dgc_otp_set;
+    pdw3000local->vBatP = cache->vBatP;
+    pdw3000local->tempP = cache->tempP;
+    pdw3000local->otp_ref = cache->mode & (DWT_READ_OTP_BAT | DWT_READ_OTP_TMP);
+    pdw3000local->otprev = cache->otprev;
+    pdw3000local->init_xtrim = cache->init_xtrim;
+    if (cache->mode & DWT_READ_OTP_LID)
     {
-        //switch clock to auto - if coming here from INIT_RC the clock will be FOSC/4, need to switch to auto prior to setting auto INIT2IDLE bit
+        _dwt_otpshadow_set(LOTID_ADDRESS, cache->lotID);
+    }
+
+    if (pdw3000local->ldo_tune_set && (pdw3000local->bias_tune != 0))
+    {
+        _dwt_prog_ldo_and_bias_tune();
+    }
+    dwt_write8bitoffsetreg(XTAL_ID, 0, pdw3000local->init_xtrim);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function returns the OTP data read by dwt_initialise(), to be kept over a warm boot and given back
+ * with dwt_setinitcache(), see deca_device_api.h
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param cache - filled with the OTP data
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the part ID has not been read (DWT_READ_OTP_PID)
+ */
+int dwt_getinitcache(dwt_init_cache_t *cache)
+{
+    if (pdw3000local->partID == 0)
+    {
+        return DWT_ERROR;
+    }
+
+    memset(cache, 0, sizeof(*cache));
+    cache->partID = pdw3000local->partID;
+    cache->lotID = pdw3000local->lotID;
+    cache->bias_tune = pdw3000local->bias_tune;
+    cache->ldo_tune_set = pdw3000local->ldo_tune_set;
+    cache->dgc_otp_set = pdw3000local->dgc_otp_set;
+    cache->vBatP = pdw3000local->vBatP;
+    cache->tempP = pdw3000local->tempP;
+    cache->otprev = pdw3000local->otprev;
+    cache->init_xtrim = pdw3000local->init_xtrim;
+    // The reference voltage and temperature only count as read when the OTP had them, not the defaults
+    cache->mode = DWT_READ_OTP_PID | ((pdw3000local->lotID != 0) ? DWT_READ_OTP_LID : 0) | pdw3000local->otp_ref;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function gives dwt_initialise() a warm boot copy of the OTP data, see deca_device_api.h
+ *
+ * input parameters
+ * @param cache - OTP data saved with dwt_getinitcache(), or NULL to read the OTP again
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setinitcache(const dwt_init_cache_t *cache)
+{
+    pdw3000local->initcache = cache;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function can place DW3000 into IDLE/IDLE_PLL or IDLE_RC mode when it is not actively in TX or RX.
+ *
+ * input parameters
+ * @param state - DWT_DW_IDLE (1) to put DW3000 into IDLE/IDLE_PLL state; DWT_DW_INIT (0) to put DW3000 into INIT_RC state;
+ *                DWT_DW_IDLE_RC (2) to put DW3000 into IDLE_RC state.
+ *
+ * output parameters none
+ *
+ * no return value
+ */
+void dwt_setdwstate(int state)
+{
+    if (state == DWT_DW_IDLE) // Set the auto INIT2IDLE bit so that DW3000 enters IDLE mode before switching clocks to system_PLL
+    //NOTE: PLL should be configured prior to this, and the device should be in IDLE_RC (if the PLL does not lock device will remain in IDLE_RC)
+    {
+        //switch clock to auto - if coming here from INIT_RC the clock will be FOSC/4, need to switch to auto prior to setting auto INIT2IDLE bit
         dwt_force_clocks(FORCE_CLK_AUTO);
         dwt_or8bitoffsetreg(SEQ_CTRL_ID, 0x01, SEQ_CTRL_AINIT2IDLE_BIT_MASK>>8);
     }
@@ -1192,14 +2149,15 @@ uint16_t get_sts_mnth (uint16_t cipher, uint8_t threshold, uint8_t shift_val)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This function sets the default values of the lookup tables depending on the channel selected.
+ * @brief This function writes the default values of the DGC lookup tables of a channel (the DGC configuration
+ * registers, which do not depend on the channel, are left untouched).
  *
  * input parameters
  * @param[in] channel - Channel that the device will be transmitting/receiving on.
  *
  * no return value
  */
-void dwt_configmrxlut(int channel)
+static void _dwt_dgc_lut_load(int channel)
 {
 	uint32_t lut0, lut1, lut2, lut3, lut4, lut5, lut6 = 0;
 
@@ -1230,6 +2188,19 @@ void dwt_configmrxlut(int channel)
     dwt_write32bitoffsetreg(DGC_LUT_4_CFG_ID, 0x0, lut4);
     dwt_write32bitoffsetreg(DGC_LUT_5_CFG_ID, 0x0, lut5);
     dwt_write32bitoffsetreg(DGC_LUT_6_CFG_ID, 0x0, lut6);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function sets the default values of the lookup tables depending on the channel selected.
+ *
+ * input parameters
+ * @param[in] channel - Channel that the device will be transmitting/receiving on.
+ *
+ * no return value
+ */
+void dwt_configmrxlut(int channel)
+{
+    _dwt_dgc_lut_load(channel);
     dwt_write32bitoffsetreg(DGC_CFG0_ID, 0x0, DWT_DGC_CFG0);
     dwt_write32bitoffsetreg(DGC_CFG1_ID, 0x0, DWT_DGC_CFG1);
 }
@@ -1333,12 +2304,28 @@ void dwt_configurestsmode(uint8_t stsMode)
  */
 int dwt_configure(dwt_config_t *config)
 {
-    uint8_t chan = config->chan,cnt,flag;
+    pdw3000local->cfgactive = NULL;
+    _dwt_configure_regs(config);
+
+    return _dwt_configure_finish(config->chan, config->rxCode);
+} // end dwt_configure()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function sets up the local data and the registers for dwt_configure(), up to and including the request
+ * to lock the PLL and change to IDLE_PLL. The register writes are batched.
+ *
+ * input parameters
+ * @param config    -   pointer to the configuration structure
+ *
+ * no return value
+ */
+static void _dwt_configure_regs(dwt_config_t *config)
+{
+    uint8_t chan = config->chan;
     uint32_t temp;
     uint8_t scp = ((config->rxCode > 24) || (config->txCode > 24)) ? 1 : 0;
     uint8_t mode = (config->phrMode == DWT_PHRMODE_EXT) ? SYS_CFG_PHR_MODE_BIT_MASK : 0;
     uint16_t sts_len;
-    int error = DWT_SUCCESS;
 
 
 #ifdef DWT_API_ERROR_CHECK
@@ -1399,6 +2386,9 @@ int dwt_configure(dwt_config_t *config)
     pdw3000local->ststhreshold = (int16_t)((((uint32_t)sts_len) * 8) * STSQUAL_THRESH_64);
     pdw3000local->stsconfig = config->stsMode;
 
+    // Batch the register set up, up to the PLL lock wait
+    dwt_batch_begin();
+
     /////////////////////////////////////////////////////////////////////////
     //SYS_CFG
     //clear the PHR Mode, PHR Rate, STS Protocol, SDC, PDOA Mode,
@@ -1545,22 +2535,72 @@ int dwt_configure(dwt_config_t *config)
     // auto cal the PLL and change to IDLE_PLL state
     dwt_setdwstate(DWT_DW_IDLE);
 
-    for (flag=1, cnt=0; cnt < MAX_RETRIES_FOR_PLL; cnt++)
+    dwt_batch_end();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function waits for the PLL to lock after the request to change to IDLE_PLL
+ *
+ * return DWT_SUCCESS or DWT_ERROR (the PLL did not lock)
+ */
+static int _dwt_pll_lock_wait(void)
+{
+    uint8_t cnt;
+
+    for (cnt=0; cnt < MAX_RETRIES_FOR_PLL; cnt++)
     {
         deca_usleep(DELAY_20uUSec);
         if ((dwt_read8bitoffsetreg(SYS_STATUS_ID, 0) & SYS_STATUS_CP_LOCK_BIT_MASK))
         {
             /* PLL is locked */
-            flag = 0;
-            break;
+            return DWT_SUCCESS;
         }
     }
-    if (flag)
+
+    return DWT_ERROR;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function completes dwt_configure() once the registers are set up: waits for the PLL to lock, loads the
+ * RX LUTs (DGC) and runs the PGF calibration.
+ *
+ * input parameters
+ * @param chan      -   channel number (5 or 9)
+ * @param rxCode    -   RX preamble code
+ *
+ * return DWT_SUCCESS or DWT_ERROR
+ */
+static int _dwt_configure_finish(uint8_t chan, uint8_t rxCode)
+{
+    int error;
+
+    if (_dwt_pll_lock_wait() != DWT_SUCCESS)
     {
         return  DWT_ERROR;
     }
 
-    if ((config->rxCode >= 9) && (config->rxCode <= 24)) //only enable DGC for PRF 64
+    _dwt_configure_dgc(chan, rxCode);
+
+    ///////////////////////
+    // PGF
+    error = dwt_pgf_cal(1);  //if the RX calibration routine fails the device receiver performance will be severely affected, the application should reset and try again
+
+
+    return error;
+} // end _dwt_configure_finish()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function loads the RX LUTs and enables the DGC for PRF 64, or disables the DGC for PRF 16
+ *
+ * input parameters
+ * @param chan      -   channel number (5 or 9)
+ * @param rxCode    -   RX preamble code
+ *
+ * no return value
+ */
+static void _dwt_configure_dgc(uint8_t chan, uint8_t rxCode)
+{
+    if ((rxCode >= 9) && (rxCode <= 24)) //only enable DGC for PRF 64
     {
         //load RX LUTs
         /* If the OTP has DGC info programmed into it, do a manual kick from OTP. */
@@ -1579,129 +2619,449 @@ int dwt_configure(dwt_config_t *config)
     {
         dwt_and8bitoffsetreg(DGC_CFG_ID, 0x0, (uint8_t)~DGC_CFG_RX_TUNE_EN_BIT_MASK);
     }
+}
 
-    ///////////////////////
-    // PGF
-    error = dwt_pgf_cal(1);  //if the RX calibration routine fails the device receiver performance will be severely affected, the application should reset and try again
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function configures the device as dwt_configure() does, and records the register set up as a register
+ * image for dwt_cfgimage_apply(), see deca_device_api.h
+ *
+ * input parameters
+ * @param config    -   pointer to the configuration structure
+ *
+ * output parameters
+ * @param img       -   register image
+ *
+ * return DWT_SUCCESS or DWT_ERROR (configuration failed, or the image does not fit)
+ */
+int dwt_cfgimage_build(dwt_config_t *config, dwt_cfgimage_t *img)
+{
+    int error;
+    uint8_t regcache_en = pdw3000local->regcache_en;
+
+    memset(img, 0, sizeof(*img));
+
+    // The shadow cache would skip the writes of unchanged values, leaving them out of the image: off while recording
+    pdw3000local->regcache_en = 0;
+
+    // Record every transaction sent out of the batch queue between the outer begin/end
+    dwt_batch_begin();
+    pdw3000local->cfgimage = img;
+    _dwt_configure_regs(config);
+    _dwt_batch_flush();
+    pdw3000local->cfgimage = NULL;
+    dwt_batch_end();
+
+    // The cache did not follow the writes
+    _dwt_regcache_invalidate();
+    pdw3000local->regcache_en = regcache_en;
 
+    img->chan = config->chan;
+    img->rxCode = config->rxCode;
+    img->spicrc = (uint8_t)pdw3000local->spicrc;
+    img->sleep_mode = pdw3000local->sleep_mode & (DWT_ALT_OPS | DWT_SEL_OPS3);
+    img->longFrames = pdw3000local->longFrames;
+    img->stsconfig = pdw3000local->stsconfig;
+    img->ststhreshold = pdw3000local->ststhreshold;
+
+    error = _dwt_configure_finish(config->chan, config->rxCode);
+
+    if (img->overflow)
+    {
+        img->count = 0;
+        return DWT_ERROR;
+    }
+    img->valid = (error == DWT_SUCCESS);
+    pdw3000local->cfgactive = img->valid ? img : NULL;
 
     return error;
-} // end dwt_configure()
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
- *
- * @brief This function runs the PGF calibration. This is needed prior to reception.
- * Note: If the RX calibration routine fails the device receiver performance will be severely affected, the application should reset and try again
+ * @brief This function configures the device from a register image recorded with dwt_cfgimage_build(): the register
+ * set up is sent as a single burst, then the PLL lock, RX LUTs and PGF calibration are done as in dwt_configure()
  *
  * input parameters
- * @param ldoen    -   if set to 1 the function will enable LDOs prior to calibration and disable afterwards.
- *
- * return result of PGF calibration (DWT_ERROR/-1 = error)
+ * @param img       -   register image
  *
+ * return DWT_SUCCESS or DWT_ERROR (invalid image, SPI CRC mode changed, or PLL/PGF calibration failed)
  */
-int dwt_pgf_cal(int ldoen)
+int dwt_cfgimage_apply(const dwt_cfgimage_t *img)
 {
-    int temp;
-    uint16_t val;
-
-    //PGF needs LDOs turned on - ensure PGF LDOs are enabled
-    if (ldoen == 1)
+    // The SPI CRC bytes are part of the recorded transactions
+    if (!img->valid || (img->spicrc != (uint8_t)pdw3000local->spicrc))
     {
-        val = dwt_read16bitoffsetreg(LDO_CTRL_ID, 0);
-
-        dwt_or16bitoffsetreg(LDO_CTRL_ID, 0, (
-            LDO_CTRL_LDO_VDDIF2_EN_BIT_MASK |
-            LDO_CTRL_LDO_VDDMS3_EN_BIT_MASK |
-            LDO_CTRL_LDO_VDDMS1_EN_BIT_MASK));
+        return DWT_ERROR;
     }
 
-    //Run PGF Cal
-    temp = dwt_run_pgfcal();
+    pdw3000local->sleep_mode = (pdw3000local->sleep_mode & (~(DWT_ALT_OPS | DWT_SEL_OPS3))) | img->sleep_mode;
+    pdw3000local->longFrames = img->longFrames;
+    pdw3000local->stsconfig = img->stsconfig;
+    pdw3000local->ststhreshold = img->ststhreshold;
 
-    //Turn off RX LDOs if previously off
-    if (ldoen == 1)
+    DWT_LOCK();
+    _dwt_batch_flush();
+    _dwt_regcache_invalidate(); // the registers are written behind the shadow cache
+    DWT_SPI_PROF_BEGIN();
+    writetospi_batch(img->count, img->len, img->buf);
+    DWT_SPI_PROF_END(0, DWT_SPI_PROF_BATCH, img->used);
+    DWT_UNLOCK();
+
+    pdw3000local->cfgactive = NULL;
+    if (_dwt_configure_finish(img->chan, img->rxCode) != DWT_SUCCESS)
     {
-        dwt_and16bitoffsetreg(LDO_CTRL_ID, 0, val); // restore LDO values
+        return DWT_ERROR;
     }
-    return temp;
+    pdw3000local->cfgactive = img;
+
+    return DWT_SUCCESS;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- *
- * @brief This function runs the PGF calibration. This is needed prior to reception.
+ * @brief This function returns the register file a transaction of a register image accesses, or -1 for a fast command
  *
  * input parameters
+ * @param op        -   SPI transaction (starting with the SPI header)
  *
- * return result of PGF calibration (DWT_ERROR/-1 = error)
+ * return register file (0..0x1F) or -1
+ */
+static int _dwt_cfgimage_regfile(const uint8_t *op)
+{
+    if (((op[0] & DW3000_SPI_EAMRW) == 0) && ((op[0] & DW3000_SPI_FAC) != 0))
+    {
+        return -1;
+    }
+
+    return (op[0] >> 1) & 0x1F;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function switches the device from the register image it is configured with to another one, see
+ * deca_device_api.h. Only the SPI transactions on register files that differ between the two images are sent; the
+ * AND/OR transactions are not idempotent with respect to the writes that precede them, so a register file is either
+ * left untouched or all its transactions are sent again, in the image order.
+ *
+ * input parameters
+ * @param img       -   register image
  *
+ * return DWT_SUCCESS or DWT_ERROR
  */
-int dwt_run_pgfcal(void)
+int dwt_cfgimage_switch(const dwt_cfgimage_t *img)
 {
-    int result = DWT_SUCCESS;
-    uint32_t    data;
-    uint32_t    val = 0;
-    uint8_t     cnt,flag;
+    const dwt_cfgimage_t *cur = pdw3000local->cfgactive;
+    uint32_t dirty = 0;
+    uint16_t i, off, start, start_off;
+    int file;
+    uint8_t cur_prf64, img_prf64;
 
-    //put into cal mode
-    //Turn on delay mode
-    data = (((uint32_t)0x02) << RX_CAL_CFG_COMP_DLY_BIT_OFFSET) | (RX_CAL_CFG_CAL_MODE_BIT_MASK & 0x1);
-    dwt_write32bitoffsetreg(RX_CAL_CFG_ID, 0x0, data);
-    // Trigger PGF Cal
-    dwt_or8bitoffsetreg(RX_CAL_CFG_ID, 0x0, RX_CAL_CFG_CAL_EN_BIT_MASK);
+    if (cur == img)
+    {
+        return img->valid ? DWT_SUCCESS : DWT_ERROR;
+    }
 
-    for (flag=1,cnt=0;cnt<MAX_RETRIES_FOR_PGF;cnt++)
+    // Another channel needs the PLL and PGF calibrations: configure from the full image
+    if ((cur == NULL) || (cur->chan != img->chan) || (cur->count != img->count) ||
+        (cur->spicrc != img->spicrc) || (memcmp(cur->len, img->len, img->count * sizeof(img->len[0])) != 0))
     {
-        deca_usleep(DELAY_20uUSec);
-        if(dwt_read8bitoffsetreg(RX_CAL_STS_ID, 0x0) == 1)
-        {//PGF cal is complete
-            flag=0;
-            break;
-        }
+        return dwt_cfgimage_apply(img);
     }
-    if (flag)
+
+    if (!img->valid || (img->spicrc != (uint8_t)pdw3000local->spicrc))
     {
-        result = DWT_ERROR;
+        return DWT_ERROR;
     }
 
-    // Put into normal mode
-    dwt_write8bitoffsetreg(RX_CAL_CFG_ID, 0x0, 0);
-    dwt_write8bitoffsetreg(RX_CAL_STS_ID, 0x0, 1); //clear the status
-    dwt_or8bitoffsetreg(RX_CAL_CFG_ID, 0x2, 0x1); //enable reading
-    val = dwt_read32bitoffsetreg(RX_CAL_RESI_ID, 0x0);
-    if (val == ERR_RX_CAL_FAIL)
+    // Register files with at least one differing transaction
+    for (i = 0, off = 0; i < img->count; off += img->len[i], i++)
     {
-        //PGF I Cal Fail
-        result = DWT_ERROR;
+        file = _dwt_cfgimage_regfile(&img->buf[off]);
+        if ((file >= 0) && (memcmp(&cur->buf[off], &img->buf[off], img->len[i]) != 0))
+        {
+            dirty |= 1UL << file;
+        }
     }
-    val = dwt_read32bitoffsetreg(RX_CAL_RESQ_ID, 0x0);
-    if (val == ERR_RX_CAL_FAIL)
+
+    pdw3000local->sleep_mode = (pdw3000local->sleep_mode & (~(DWT_ALT_OPS | DWT_SEL_OPS3))) | img->sleep_mode;
+    pdw3000local->longFrames = img->longFrames;
+    pdw3000local->stsconfig = img->stsconfig;
+    pdw3000local->ststhreshold = img->ststhreshold;
+
+    DWT_LOCK();
+    _dwt_batch_flush();
+    _dwt_regcache_invalidate();
+
+    // Send the transactions to be repeated, each run of consecutive ones in a single burst
+    for (i = 0, off = 0, start = 0, start_off = 0; i <= img->count; i++)
     {
-        //PGF Q Cal Fail
-        result = DWT_ERROR;
+        uint8_t send = 0;
+
+        if (i < img->count)
+        {
+            file = _dwt_cfgimage_regfile(&img->buf[off]);
+            send = (file >= 0) ? ((dirty >> file) & 1) : (memcmp(&cur->buf[off], &img->buf[off], img->len[i]) != 0);
+        }
+
+        if (!send)
+        {
+            if (i > start)
+            {
+                DWT_SPI_PROF_BEGIN();
+                writetospi_batch(i - start, &img->len[start], &img->buf[start_off]);
+                DWT_SPI_PROF_END(0, DWT_SPI_PROF_BATCH, off - start_off);
+            }
+            start = i + 1;
+            start_off = (i < img->count) ? (off + img->len[i]) : off;
+        }
+
+        if (i < img->count)
+        {
+            off += img->len[i];
+        }
     }
+    DWT_UNLOCK();
 
-    return result;
+    // The RX LUTs only depend on the channel, the DGC enable on the PRF
+    cur_prf64 = (cur->rxCode >= 9) && (cur->rxCode <= 24);
+    img_prf64 = (img->rxCode >= 9) && (img->rxCode <= 24);
+    if (cur_prf64 != img_prf64)
+    {
+        _dwt_configure_dgc(img->chan, img->rxCode);
+    }
+
+    pdw3000local->cfgactive = img;
+
+    return DWT_SUCCESS;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This API function writes the antenna delay (in time units) to RX registers
+ * @brief This function configures the device on channel 5 and on channel 9 in turn, with the full calibration of
+ * each, and records the registers that differ between the two channels for dwt_chanhop_set(), see
+ * deca_device_api.h. The device is left on the channel of config.
  *
- * input parameters:
- * @param rxDelay - this is the total (RX) antenna delay value, which
- *                          will be programmed into the RX register
+ * input parameters
+ * @param config    -   configuration, used for both channels (config->chan selects the channel to end on)
+ * @param txconfig5 -   TX spectrum configuration for channel 5
+ * @param txconfig9 -   TX spectrum configuration for channel 9
  *
  * output parameters
+ * @param hop       -   per channel registers
  *
- * no return value
+ * return DWT_SUCCESS or DWT_ERROR (the PLL did not lock or the PGF calibration failed on one of the channels)
  */
-void dwt_setrxantennadelay(uint16_t rxDelay)
+int dwt_chanhop_init(dwt_chanhop_t *hop, dwt_config_t *config, dwt_txconfig_t *txconfig5, dwt_txconfig_t *txconfig9)
 {
-    // Set the RX antenna delay for auto TX timestamp adjustment
-    dwt_write16bitoffsetreg(CIA_CONF_ID, 0, rxDelay);
+    uint8_t chan = config->chan;
+    int i;
+
+    memset(hop, 0, sizeof(*hop));
+
+    // Channel 5 first: its RX_CTRL_HI is the reset value, dwt_configure() only writes it for channel 9
+    for (i = 0; i < 2; i++)
+    {
+        config->chan = (i == 0) ? 5 : 9;
+        if (dwt_configure(config) != DWT_SUCCESS)
+        {
+            config->chan = chan;
+            return DWT_ERROR;
+        }
+        // With PGcount set, the PG delay is calibrated here and read back below
+        dwt_configuretxrf((i == 0) ? txconfig5 : txconfig9);
+
+        hop->chan_ctrl[i] = dwt_read32bitoffsetreg(CHAN_CTRL_ID, 0);
+        hop->tx_ctrl_hi[i] = dwt_read32bitoffsetreg(TX_CTRL_HI_ID, 0);
+        hop->rx_ctrl_hi[i] = dwt_read32bitoffsetreg(RX_CTRL_HI_ID, 0);
+        hop->tx_power[i] = dwt_read32bitoffsetreg(TX_POWER_ID, 0);
+        hop->pll_cfg[i] = dwt_read16bitoffsetreg(PLL_CFG_ID, 0);
+    }
+    config->chan = chan;
+
+    hop->rxCode = config->rxCode;
+    hop->chan = 9;
+    hop->valid = 1;
+
+    return dwt_chanhop_set(hop, chan);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This API function writes the antenna delay (in time units) to TX registers
+ * @brief This function retunes the device to the other channel of dwt_chanhop_init(): the channel dependent RF and
+ * TX spectrum registers and the DGC lookup tables are written in one SPI burst, then the PLL locks on the new
+ * channel. The PGF calibration, of the RX baseband filter, is kept.
+ *
+ * input parameters
+ * @param hop       -   per channel registers
+ * @param chan      -   channel, 5 or 9
+ *
+ * return DWT_SUCCESS or DWT_ERROR (not initialised, bad channel, or the PLL did not lock)
+ */
+int dwt_chanhop_set(dwt_chanhop_t *hop, uint8_t chan)
+{
+    int i = (chan == 9) ? 1 : 0;
+
+    if (!hop->valid || ((chan != 5) && (chan != 9)))
+    {
+        return DWT_ERROR;
+    }
+    if (chan == hop->chan)
+    {
+        return DWT_SUCCESS;
+    }
+
+    // The device no longer matches a register image
+    pdw3000local->cfgactive = NULL;
+
+    dwt_batch_begin();
+
+    // PLL off while it is retuned
+    dwt_setdwstate(DWT_DW_IDLE_RC);
+
+    dwt_write32bitoffsetreg(CHAN_CTRL_ID, 0, hop->chan_ctrl[i]);
+    dwt_write32bitoffsetreg(TX_CTRL_HI_ID, 0, hop->tx_ctrl_hi[i]);
+    dwt_write16bitoffsetreg(PLL_CFG_ID, 0, hop->pll_cfg[i]);
+    dwt_write32bitoffsetreg(RX_CTRL_HI_ID, 0, hop->rx_ctrl_hi[i]);
+    dwt_write32bitoffsetreg(TX_POWER_ID, 0, hop->tx_power[i]);
+
+    // The DGC enable and threshold only depend on the PRF, which does not change
+    if ((hop->rxCode >= 9) && (hop->rxCode <= 24))
+    {
+        if (pdw3000local->dgc_otp_set == DWT_DGC_LOAD_FROM_OTP)
+        {
+            _dwt_kick_dgc_on_wakeup(chan);
+        }
+        else
+        {
+            _dwt_dgc_lut_load(chan);
+        }
+    }
+
+    //Verify PLL lock bit is cleared
+    dwt_write8bitoffsetreg(SYS_STATUS_ID, 0, SYS_STATUS_CP_LOCK_BIT_MASK);
+    dwt_setdwstate(DWT_DW_IDLE);
+
+    dwt_batch_end();
+
+    if (_dwt_pll_lock_wait() != DWT_SUCCESS)
+    {
+        hop->chan = 0;      // unknown, the next call writes the registers again
+        return DWT_ERROR;
+    }
+    hop->chan = chan;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ *
+ * @brief This function runs the PGF calibration. This is needed prior to reception.
+ * Note: If the RX calibration routine fails the device receiver performance will be severely affected, the application should reset and try again
+ *
+ * input parameters
+ * @param ldoen    -   if set to 1 the function will enable LDOs prior to calibration and disable afterwards.
+ *
+ * return result of PGF calibration (DWT_ERROR/-1 = error)
+ *
+ */
+int dwt_pgf_cal(int ldoen)
+{
+    int temp;
+    uint16_t val;
+
+    //PGF needs LDOs turned on - ensure PGF LDOs are enabled
+    if (ldoen == 1)
+    {
+        val = dwt_read16bitoffsetreg(LDO_CTRL_ID, 0);
+
+        dwt_or16bitoffsetreg(LDO_CTRL_ID, 0, (
+            LDO_CTRL_LDO_VDDIF2_EN_BIT_MASK |
+            LDO_CTRL_LDO_VDDMS3_EN_BIT_MASK |
+            LDO_CTRL_LDO_VDDMS1_EN_BIT_MASK));
+    }
+
+    //Run PGF Cal
+    temp = dwt_run_pgfcal();
+
+    //Turn off RX LDOs if previously off
+    if (ldoen == 1)
+    {
+        dwt_and16bitoffsetreg(LDO_CTRL_ID, 0, val); // restore LDO values
+    }
+    return temp;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ *
+ * @brief This function runs the PGF calibration. This is needed prior to reception.
+ *
+ * input parameters
+ *
+ * return result of PGF calibration (DWT_ERROR/-1 = error)
+ *
+ */
+int dwt_run_pgfcal(void)
+{
+    int result = DWT_SUCCESS;
+    uint32_t    data;
+    uint32_t    val = 0;
+    uint8_t     cnt,flag;
+
+    //put into cal mode
+    //Turn on delay mode
+    data = (((uint32_t)0x02) << RX_CAL_CFG_COMP_DLY_BIT_OFFSET) | (RX_CAL_CFG_CAL_MODE_BIT_MASK & 0x1);
+    dwt_write32bitoffsetreg(RX_CAL_CFG_ID, 0x0, data);
+    // Trigger PGF Cal
+    dwt_or8bitoffsetreg(RX_CAL_CFG_ID, 0x0, RX_CAL_CFG_CAL_EN_BIT_MASK);
+
+    for (flag=1,cnt=0;cnt<MAX_RETRIES_FOR_PGF;cnt++)
+    {
+        deca_usleep(DELAY_20uUSec);
+        if(dwt_read8bitoffsetreg(RX_CAL_STS_ID, 0x0) == 1)
+        {//PGF cal is complete
+            flag=0;
+            break;
+        }
+    }
+    if (flag)
+    {
+        result = DWT_ERROR;
+    }
+
+    // Put into normal mode
+    dwt_write8bitoffsetreg(RX_CAL_CFG_ID, 0x0, 0);
+    dwt_write8bitoffsetreg(RX_CAL_STS_ID, 0x0, 1); //clear the status
+    dwt_or8bitoffsetreg(RX_CAL_CFG_ID, 0x2, 0x1); //enable reading
+    val = dwt_read32bitoffsetreg(RX_CAL_RESI_ID, 0x0);
+    if (val == ERR_RX_CAL_FAIL)
+    {
+        //PGF I Cal Fail
+        result = DWT_ERROR;
+    }
+    val = dwt_read32bitoffsetreg(RX_CAL_RESQ_ID, 0x0);
+    if (val == ERR_RX_CAL_FAIL)
+    {
+        //PGF Q Cal Fail
+        result = DWT_ERROR;
+    }
+
+    return result;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This API function writes the antenna delay (in time units) to RX registers
+ *
+ * input parameters:
+ * @param rxDelay - this is the total (RX) antenna delay value, which
+ *                          will be programmed into the RX register
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setrxantennadelay(uint16_t rxDelay)
+{
+    // Set the RX antenna delay for auto TX timestamp adjustment
+    dwt_write16bitoffsetreg(CIA_CONF_ID, 0, rxDelay);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This API function writes the antenna delay (in time units) to TX registers
  *
  * input parameters:
  * @param txDelay - this is the total (TX) antenna delay value, which
@@ -1738,6 +3098,8 @@ void dwt_settxantennadelay(uint16_t txDelay)
  */
 int dwt_writetxdata(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBufferOffset)
 {
+    uint16_t sub;
+
 #ifdef DWT_API_ERROR_CHECK
     assert((pdw3000local->longFrames && (txDataLength <= EXT_FRAME_LEN)) ||\
            (txDataLength <= STD_FRAME_LEN));
@@ -1753,12 +3115,11 @@ int dwt_writetxdata(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBuff
         }
         else
         {
-            /* Program the indirect offset register A for specified offset to TX buffer */
-            dwt_write32bitreg(INDIRECT_ADDR_A_ID, (TX_BUFFER_ID >> 16) );
-            dwt_write32bitreg(ADDR_OFFSET_A_ID,   txBufferOffset);
+            /* Program the indirect offset register A for specified offset to TX buffer (if not already there) */
+            sub = _dwt_ptra_setup(TX_BUFFER_ID, txBufferOffset);
 
             /* Indirectly write the data to the IC TX buffer */
-            dwt_writetodevice(INDIRECT_POINTER_A_ID, 0, txDataLength, txDataBytes);
+            dwt_writetodevice(INDIRECT_POINTER_A_ID, sub, txDataLength, txDataBytes);
         }
         return DWT_SUCCESS;
     }
@@ -1766,6 +3127,49 @@ int dwt_writetxdata(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBuff
         return DWT_ERROR;
 } // end dwt_writetxdata()
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This API function is the asynchronous version of dwt_writetxdata(), see dwt_writetxdata_async() in
+ * deca_device_api.h
+ *
+ * input parameters
+ * @param txDataLength   - This is the total length of data (in bytes) to write to the tx buffer.
+ * @param txDataBytes    - Pointer to the user's buffer containing the data to send.
+ * @param txBufferOffset - This specifies an offset in the DW IC's TX Buffer at which to start writing data.
+ * @param cb             - completion call-back, may be NULL
+ * @param arg            - user argument passed to the call-back
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+ */
+int dwt_writetxdata_async(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBufferOffset, dwt_spi_done_cb_t cb, void *arg)
+{
+    uint16_t sub;
+
+#ifdef DWT_API_ERROR_CHECK
+    assert((pdw3000local->longFrames && (txDataLength <= EXT_FRAME_LEN)) ||\
+           (txDataLength <= STD_FRAME_LEN));
+    assert((txBufferOffset + txDataLength) < TX_BUFFER_MAX_LEN);
+#endif
+
+    if ((txBufferOffset + txDataLength) >= TX_BUFFER_MAX_LEN)
+    {
+        return DWT_ERROR;
+    }
+
+    if(txBufferOffset <= REG_DIRECT_OFFSET_MAX_LEN)
+    {
+        /* Directly write the data to the IC TX buffer */
+        return dwt_xfer3000_async(TX_BUFFER_ID, txBufferOffset, txDataLength, txDataBytes, DW3000_SPI_WR_BIT, cb, arg);
+    }
+
+    /* Program the indirect offset register A for specified offset to TX buffer (if not already there) */
+    sub = _dwt_ptra_setup(TX_BUFFER_ID, txBufferOffset);
+
+    /* Indirectly write the data to the IC TX buffer */
+    return dwt_xfer3000_async(INDIRECT_POINTER_A_ID, sub, txDataLength, txDataBytes, DW3000_SPI_WR_BIT, cb, arg);
+} // end dwt_writetxdata_async()
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This API function configures the TX frame control register before the transmission of a frame
  *
@@ -1859,6 +3263,7 @@ void dwt_read_rx_scratch_data(uint8_t *buffer, uint16_t length, uint16_t rxBuffe
 void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset)
 {
     uint32_t  rx_buff_addr;
+    uint16_t  sub;
 
     if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)  //if the flag is 0x3 we are reading from RX_BUFFER_1
     {
@@ -1878,16 +3283,61 @@ void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset)
         }
         else
         {
-            /* Program the indirect offset registers B for specified offset to RX buffer */
-            dwt_write32bitreg(INDIRECT_ADDR_A_ID, (rx_buff_addr >> 16) );
-            dwt_write32bitreg(ADDR_OFFSET_A_ID,   rxBufferOffset);
+            /* Program the indirect offset registers A for specified offset to RX buffer (if not already there) */
+            sub = _dwt_ptra_setup(rx_buff_addr, rxBufferOffset);
 
             /* Indirectly read data from the IC to the buffer */
-            dwt_readfromdevice(INDIRECT_POINTER_A_ID, 0, length, buffer);
+            dwt_readfromdevice(INDIRECT_POINTER_A_ID, sub, length, buffer);
         }
     }
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is the asynchronous version of dwt_readrxdata(), see dwt_readrxdata_async() in deca_device_api.h
+ *
+ * input parameters
+ * @param buffer - the buffer into which the data will be read
+ * @param length - the length of data to read (in bytes)
+ * @param rxBufferOffset - the offset in the rx buffer from which to read the data
+ * @param cb     - completion call-back, may be NULL
+ * @param arg    - user argument passed to the call-back
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+ */
+int dwt_readrxdata_async(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset, dwt_spi_done_cb_t cb, void *arg)
+{
+    uint32_t  rx_buff_addr;
+    uint16_t  sub;
+
+    if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)  //if the flag is 0x3 we are reading from RX_BUFFER_1
+    {
+        rx_buff_addr=RX_BUFFER_1_ID;
+    }
+    else //reading from RX_BUFFER_0 - also when non-double buffer mode
+    {
+        rx_buff_addr=RX_BUFFER_0_ID;
+    }
+
+    if ((rxBufferOffset + length) > RX_BUFFER_MAX_LEN)
+    {
+        return DWT_ERROR;
+    }
+
+    if(rxBufferOffset <= REG_DIRECT_OFFSET_MAX_LEN)
+    {
+        /* Directly read data from the IC to the buffer */
+        return dwt_xfer3000_async(rx_buff_addr, rxBufferOffset, length, buffer, DW3000_SPI_RD_BIT, cb, arg);
+    }
+
+    /* Program the indirect offset registers A for specified offset to RX buffer (if not already there) */
+    sub = _dwt_ptra_setup(rx_buff_addr, rxBufferOffset);
+
+    /* Indirectly read data from the IC to the buffer */
+    return dwt_xfer3000_async(INDIRECT_POINTER_A_ID, sub, length, buffer, DW3000_SPI_RD_BIT, cb, arg);
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to read the 18 bit data from the Accumulator buffer, from an offset location give by offset parameter
  *        for 18 bit complex samples, each sample is 6 bytes (3 real and 3 imaginary)
@@ -1909,6 +3359,8 @@ void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset)
  */
 void dwt_readaccdata(uint8_t *buffer, uint16_t length, uint16_t accOffset)
 {
+    uint16_t sub;
+
     // Force on the ACC clocks if we are sequenced
     dwt_or16bitoffsetreg(CLK_CTRL_ID, 0x0, CLK_CTRL_ACC_MCLK_EN_BIT_MASK | CLK_CTRL_ACC_CLK_EN_BIT_MASK);
 
@@ -1921,12 +3373,11 @@ void dwt_readaccdata(uint8_t *buffer, uint16_t length, uint16_t accOffset)
         }
         else
         {
-            /* Program the indirect offset registers B for specified offset to ACC */
-            dwt_write32bitreg(INDIRECT_ADDR_A_ID, (ACC_MEM_ID >> 16) );
-            dwt_write32bitreg(ADDR_OFFSET_A_ID,   accOffset);
+            /* Program the indirect offset registers A for specified offset to ACC (if not already there) */
+            sub = _dwt_ptra_setup(ACC_MEM_ID, accOffset);
 
             /* Indirectly read data from the IC to the buffer */
-            dwt_readfromdevice(INDIRECT_POINTER_A_ID, 0, length, buffer);
+            dwt_readfromdevice(INDIRECT_POINTER_A_ID, sub, length, buffer);
         }
     }
     else
@@ -1939,45 +3390,215 @@ void dwt_readaccdata(uint8_t *buffer, uint16_t length, uint16_t accOffset)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is used to read the crystal offset (relating to the frequency offset of the far DW3000 device compared to this one)
- *        Note: the returned signed 16-bit number should be divided by by 2^26 to get ppm offset.
+ * @brief This is the asynchronous version of dwt_readaccdata(), see dwt_readaccdata_async() in deca_device_api.h
  *
- * input parameters - NONE
+ * input parameters
+ * @param buffer - the buffer into which the data will be read
+ * @param length - the length of data to read (in bytes)
+ * @param accOffset - the offset in the acc buffer from which to read the data, this is a complex sample index
+ * @param cb     - completion call-back, may be NULL
+ * @param arg    - user argument passed to the call-back
  *
- * return value - the (int12) signed offset value. (s[-15:-26])
- *                A positive value means the local RX clock is running faster than the remote TX device.
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
  */
-int16_t dwt_readclockoffset(void)
+int dwt_readaccdata_async(uint8_t *buffer, uint16_t length, uint16_t accOffset, dwt_spi_done_cb_t cb, void *arg)
 {
-    uint16_t  regval = 0 ;
+    uint16_t sub;
+    int ret;
 
-    switch (pdw3000local->dblbuffon)  //if the flag is non zero - we are either accessing RX_BUFFER_0 or RX_BUFFER_1
+    if ((accOffset + length) > ACC_BUFFER_MAX_LEN)
     {
-    case DBL_BUFF_ACCESS_BUFFER_1:
-        //!!! Assumes that Indirect pointer register B was already set. This is done in the dwt_setdblrxbuffmode when mode is enabled.
-        regval = dwt_read16bitoffsetreg(INDIRECT_POINTER_B_ID, (BUF1_CIA_DIAG_0-BUF1_RX_FINFO)) & CIA_DIAG_0_COE_PPM_BIT_MASK;
-        break;
-    case DBL_BUFF_ACCESS_BUFFER_0:
-        regval = dwt_read16bitoffsetreg(BUF0_CIA_DIAG_0, 0) & CIA_DIAG_0_COE_PPM_BIT_MASK;
-        break;
-    default:
-        regval = dwt_read16bitoffsetreg(CIA_DIAG_0_ID, 0) & CIA_DIAG_0_COE_PPM_BIT_MASK;
-        break;
+        return DWT_ERROR;
     }
 
-    if (regval & B11_SIGN_EXTEND_TEST)
+    // Force on the ACC clocks if we are sequenced, reverted by dwt_readaccdata_async_done()
+    dwt_or16bitoffsetreg(CLK_CTRL_ID, 0x0, CLK_CTRL_ACC_MCLK_EN_BIT_MASK | CLK_CTRL_ACC_CLK_EN_BIT_MASK);
+
+    if(accOffset <= REG_DIRECT_OFFSET_MAX_LEN)
     {
-        regval |= B11_SIGN_EXTEND_MASK;             // sign extend bit #12 to the whole short
+        /* Directly read data from the IC to the buffer */
+        ret = dwt_xfer3000_async(ACC_MEM_ID, accOffset, length, buffer, DW3000_SPI_RD_BIT, cb, arg);
+    }
+    else
+    {
+        /* Program the indirect offset registers A for specified offset to ACC (if not already there) */
+        sub = _dwt_ptra_setup(ACC_MEM_ID, accOffset);
+
+        /* Indirectly read data from the IC to the buffer */
+        ret = dwt_xfer3000_async(INDIRECT_POINTER_A_ID, sub, length, buffer, DW3000_SPI_RD_BIT, cb, arg);
     }
 
-    return (int16_t) regval ;
+    // The transfer did not start: no completion will revert the clocks
+    if (ret != DWT_SUCCESS)
+    {
+        dwt_readaccdata_async_done();
+    }
+
+    return ret;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is used to read the RX carrier integrator value (relating to the frequency offset of the TX node)
+ * @brief This reverts the ACC clocks forced on by dwt_readaccdata_async()
  *
- * NOTE: This is a 21-bit signed quantity, the function sign extends the most significant bit, which is bit #20
- *       (numbering from bit zero) to return a 32-bit signed integer value.
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_readaccdata_async_done(void)
+{
+    dwt_and16bitoffsetreg(CLK_CTRL_ID, 0x0, (uint16_t)~(CLK_CTRL_ACC_MCLK_EN_BIT_MASK | CLK_CTRL_ACC_CLK_EN_BIT_MASK));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This starts a span read, see dwt_readspan_begin() in deca_device_api.h
+ *
+ * input parameters
+ * @param span   - span read state
+ * @param mem    - DWT_SPAN_RX (the current RX buffer, bytes) or DWT_SPAN_ACC (the accumulator, complex samples)
+ * @param offset - first unit of the span
+ * @param length - number of units in the span
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the span is beyond the end of the buffer
+ */
+int dwt_readspan_begin(dwt_span_t *span, dwt_span_mem_e mem, uint16_t offset, uint16_t length)
+{
+    if (mem == DWT_SPAN_ACC)
+    {
+        if ((offset + length) > DWT_SPAN_ACC_MAX_SAMPLES)
+        {
+            return DWT_ERROR;
+        }
+        span->file_id = ACC_MEM_ID;
+
+        // Force on the ACC clocks if we are sequenced, once for the whole span, reverted by dwt_readspan_end()
+        dwt_or16bitoffsetreg(CLK_CTRL_ID, 0x0, CLK_CTRL_ACC_MCLK_EN_BIT_MASK | CLK_CTRL_ACC_CLK_EN_BIT_MASK);
+    }
+    else
+    {
+        if ((offset + length) > RX_BUFFER_MAX_LEN)
+        {
+            return DWT_ERROR;
+        }
+        span->file_id = (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1) ? RX_BUFFER_1_ID : RX_BUFFER_0_ID;
+    }
+
+    span->mem = (uint8_t)mem;
+    span->next = offset;
+    span->end = offset + length;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This reads the next part of a span, see dwt_readspan() in deca_device_api.h
+ *
+ * input parameters
+ * @param span   - span read state, from dwt_readspan_begin()
+ * @param count  - number of units to read, bytes (DWT_SPAN_RX) or complex samples (DWT_SPAN_ACC)
+ *
+ * output parameters
+ * @param buffer - the buffer into which the data will be read, count bytes (DWT_SPAN_RX), or count * 6 + 1 bytes
+ *                 with the dummy octet first (DWT_SPAN_ACC)
+ *
+ * returns the number of units read, less than count at the end of the span, 0 when the span is complete
+ */
+uint16_t dwt_readspan(dwt_span_t *span, uint8_t *buffer, uint16_t count)
+{
+    uint16_t len;
+
+    if (count > (span->end - span->next))
+    {
+        count = span->end - span->next;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    len = (span->mem == DWT_SPAN_ACC) ? (uint16_t)(count * 6 + 1) : count;
+
+    if (span->next <= REG_DIRECT_OFFSET_MAX_LEN)
+    {
+        /* Directly read data from the IC to the buffer */
+        dwt_readfromdevice(span->file_id, span->next, len, buffer);
+    }
+    else
+    {
+        /* Indirectly read data from the IC to the buffer, pointer A only moves every REG_DIRECT_OFFSET_MAX_LEN + 1 units */
+        dwt_readfromdevice(INDIRECT_POINTER_A_ID, _dwt_ptra_setup(span->file_id, span->next), len, buffer);
+    }
+
+    span->next += count;
+
+    return count;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This ends a span read, see dwt_readspan_end() in deca_device_api.h
+ *
+ * input parameters
+ * @param span   - span read state, from dwt_readspan_begin()
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_readspan_end(dwt_span_t *span)
+{
+    if (span->mem == DWT_SPAN_ACC)
+    {
+        // Revert clocks back
+        dwt_and16bitoffsetreg(CLK_CTRL_ID, 0x0, (uint16_t)~(CLK_CTRL_ACC_MCLK_EN_BIT_MASK | CLK_CTRL_ACC_CLK_EN_BIT_MASK));
+    }
+    span->next = span->end;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is used to read the crystal offset (relating to the frequency offset of the far DW3000 device compared to this one)
+ *        Note: the returned signed 16-bit number should be divided by by 2^26 to get ppm offset.
+ *
+ * input parameters - NONE
+ *
+ * return value - the (int12) signed offset value. (s[-15:-26])
+ *                A positive value means the local RX clock is running faster than the remote TX device.
+ */
+int16_t dwt_readclockoffset(void)
+{
+    uint16_t  regval = 0 ;
+
+    switch (pdw3000local->dblbuffon)  //if the flag is non zero - we are either accessing RX_BUFFER_0 or RX_BUFFER_1
+    {
+    case DBL_BUFF_ACCESS_BUFFER_1:
+        //!!! Assumes that Indirect pointer register B was already set. This is done in the dwt_setdblrxbuffmode when mode is enabled.
+        regval = dwt_read16bitoffsetreg(INDIRECT_POINTER_B_ID, (BUF1_CIA_DIAG_0-BUF1_RX_FINFO)) & CIA_DIAG_0_COE_PPM_BIT_MASK;
+        break;
+    case DBL_BUFF_ACCESS_BUFFER_0:
+        regval = dwt_read16bitoffsetreg(BUF0_CIA_DIAG_0, 0) & CIA_DIAG_0_COE_PPM_BIT_MASK;
+        break;
+    default:
+        regval = dwt_read16bitoffsetreg(CIA_DIAG_0_ID, 0) & CIA_DIAG_0_COE_PPM_BIT_MASK;
+        break;
+    }
+
+    if (regval & B11_SIGN_EXTEND_TEST)
+    {
+        regval |= B11_SIGN_EXTEND_MASK;             // sign extend bit #12 to the whole short
+    }
+
+    return (int16_t) regval ;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is used to read the RX carrier integrator value (relating to the frequency offset of the TX node)
+ *
+ * NOTE: This is a 21-bit signed quantity, the function sign extends the most significant bit, which is bit #20
+ *       (numbering from bit zero) to return a 32-bit signed integer value.
  *
  * input parameters - NONE
  *
@@ -2073,6 +3694,7 @@ int dwt_readstsstatus(uint16_t* stsStatus, int sts_num)
     return ret;
 }
 
+#ifndef DWT_NO_DIAG
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief this function reads the RX signal quality diagnostic data
  *
@@ -2088,7 +3710,11 @@ void dwt_readdiagnostics(dwt_rxdiag_t *diagnostics)
     int i;
     int offset_0xd;
     int offset_buff = BUF0_RX_FINFO;
+#ifdef DWT_DIAG_STATIC_BUF
+    uint8_t *temp = pdw3000local->diag_buf;
+#else
     uint8_t temp[DB_MAX_DIAG_SIZE];  //address from 0xC0000 to 0xD0068 (108*2 bytes) - when using normal mode, or 232 length for max logging when in Double Buffer mode
+#endif
 
     //minimal diagnostics - 40 bytes
 
@@ -2301,6 +3927,284 @@ void dwt_readdiagnostics(dwt_rxdiag_t *diagnostics)
     }
 }
 
+// Diagnostic fields for dwt_readdiagnostics_sel(): offsets in the single buffer image (0xC0000 block, then the
+// 0xD0000 block from DIAG_SB_D_OFFSET, as in dwt_readdiagnostics()) and in the double buffer swinging set
+#define DIAG_SB_D_OFFSET    0x6C    // bytes of the 0xC0000 block before the 0xD0000 block
+#define DIAG_SB_MIN_SIZE    40      // bytes logged without DW_CIA_DIAG_LOG_ALL
+#define DIAG_SB_SIZE        (2 * DIAG_SB_D_OFFSET)
+#define DIAG_MERGE_GAP      6       // unused bytes read through rather than starting another transaction
+#define DIAG_SB(id)         ((uint8_t)((((id) >> 16) == (IP_TOA_LO_ID >> 16)) ? ((id) - IP_TOA_LO_ID) : ((id) - STS_DIAG_4_ID + DIAG_SB_D_OFFSET)))
+#define DIAG_DB(id)         ((uint8_t)((id) - BUF0_RX_FINFO))
+
+typedef struct
+{
+    uint32_t field;
+    uint8_t  sb;        // single buffer image offset
+    uint8_t  db;        // double buffer image offset
+    uint8_t  len;
+} dwt_diag_field_t;
+
+static const dwt_diag_field_t dwt_diag_fields[] =
+{
+    { DWT_DIAG_IP_TS,       DIAG_SB(IP_TOA_LO_ID),      DIAG_DB(BUF0_IP_TS),        8  },
+    { DWT_DIAG_STS_TS,      DIAG_SB(STS_TOA_LO_ID),     DIAG_DB(BUF0_STS_TS),       8  },
+    { DWT_DIAG_STS2_TS,     DIAG_SB(STS1_TOA_LO_ID),    DIAG_DB(BUF0_STS1_TS),      8  },
+    { DWT_DIAG_TDOA,        DIAG_SB(CIA_TDOA_0_ID),     DIAG_DB(BUF0_TDOA),         6  },
+    { DWT_DIAG_PDOA,        DIAG_SB(CIA_TDOA_1_PDOA_ID), DIAG_DB(BUF0_PDOA),        4  },
+    { DWT_DIAG_XTAL,        DIAG_SB(CIA_DIAG_0_ID),     DIAG_DB(BUF0_CIA_DIAG_0),   2  },
+    { DWT_DIAG_CIA1,        DIAG_SB(CIA_DIAG_1_ID),     DIAG_DB(BUF0_CIA_DIAG_1),   4  },
+    { DWT_DIAG_IP_PEAK,     DIAG_SB(IP_DIAG_0_ID),      DIAG_DB(BUF0_IP_DIAG_0),    4  },
+    { DWT_DIAG_IP_POWER,    DIAG_SB(IP_DIAG_1_ID),      DIAG_DB(BUF0_IP_DIAG_1),    4  },
+    { DWT_DIAG_IP_F,        DIAG_SB(IP_DIAG_2_ID),      DIAG_DB(BUF0_IP_DIAG_2),    12 },
+    { DWT_DIAG_IP_FP,       DIAG_SB(IP_DIAG_8_ID),      DIAG_DB(BUF0_IP_DIAG_8),    2  },
+    { DWT_DIAG_IP_ACCUM,    DIAG_SB(IP_DIAG_12_ID),     DIAG_DB(BUF0_IP_DIAG_12),   2  },
+    { DWT_DIAG_STS_PEAK,    DIAG_SB(STS_DIAG_0_ID),     DIAG_DB(BUF0_STS_DIAG_0),   4  },
+    { DWT_DIAG_STS_POWER,   DIAG_SB(STS_DIAG_1_ID),     DIAG_DB(BUF0_STS_DIAG_1),   2  },
+    { DWT_DIAG_STS_F,       DIAG_SB(STS_DIAG_2_ID),     DIAG_DB(BUF0_STS_DIAG_2),   12 },
+    { DWT_DIAG_STS_FP,      DIAG_SB(STS_DIAG_8_ID),     DIAG_DB(BUF0_STS_DIAG_8),   2  },
+    { DWT_DIAG_STS_ACCUM,   DIAG_SB(STS_DIAG_12_ID),    DIAG_DB(BUF0_STS_DIAG_12),  2  },
+    { DWT_DIAG_STS2_PEAK,   DIAG_SB(STS1_DIAG_0_ID),    DIAG_DB(BUF0_STS1_DIAG_0),  4  },
+    { DWT_DIAG_STS2_POWER,  DIAG_SB(STS1_DIAG_1_ID),    DIAG_DB(BUF0_STS1_DIAG_1),  2  },
+    { DWT_DIAG_STS2_F,      DIAG_SB(STS1_DIAG_2_ID),    DIAG_DB(BUF0_STS1_DIAG_2),  12 },
+    { DWT_DIAG_STS2_FP,     DIAG_SB(STS1_DIAG_8_ID),    DIAG_DB(BUF0_STS1_DIAG_8),  2  },
+    { DWT_DIAG_STS2_ACCUM,  DIAG_SB(STS1_DIAG_12_ID),   DIAG_DB(BUF0_STS1_DIAG_12), 2  },
+};
+
+#define DIAG_FIELDS (sizeof(dwt_diag_fields) / sizeof(dwt_diag_fields[0]))
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function reads a span of the diagnostic image into the same place of the image buffer
+ *
+ * input parameters
+ * @param start - image offset
+ * @param len - number of bytes
+ *
+ * output parameters
+ * @param temp - image buffer
+ *
+ * no return value
+ */
+static void _dwt_diag_read_span(uint8_t start, uint8_t len, uint8_t *temp)
+{
+    uint32_t buf;
+
+    switch (pdw3000local->dblbuffon)
+    {
+    case DBL_BUFF_ACCESS_BUFFER_1:
+    case DBL_BUFF_ACCESS_BUFFER_0:
+        buf = (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1) ? BUF1_RX_FINFO : BUF0_RX_FINFO;
+        if (start > REG_DIRECT_OFFSET_MAX_LEN)
+        {
+            // Beyond the sub-address range, go through indirect pointer A
+            dwt_readfromdevice(INDIRECT_POINTER_A_ID, _dwt_ptra_setup(buf, (buf & 0xffff) + start), len, &temp[start]);
+        }
+        else if (buf == BUF1_RX_FINFO)
+        {
+            //!!! Assumes that Indirect pointer register B was already set. This is done in the dwt_setdblrxbuffmode when mode is enabled.
+            dwt_readfromdevice(INDIRECT_POINTER_B_ID, start, len, &temp[start]);
+        }
+        else
+        {
+            dwt_readfromdevice(BUF0_RX_FINFO, start, len, &temp[start]);
+        }
+        break;
+    default:
+        if (start < DIAG_SB_D_OFFSET)
+        {
+            dwt_readfromdevice(IP_TOA_LO_ID, start, len, &temp[start]);
+        }
+        else
+        {
+            dwt_readfromdevice(STS_DIAG_4_ID, start - DIAG_SB_D_OFFSET, len, &temp[start]);
+        }
+        break;
+    }
+}
+
+static uint32_t _dwt_diag_u32(const uint8_t *p)
+{
+    return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | (uint32_t)p[0];
+}
+
+static uint16_t _dwt_diag_u16(const uint8_t *p)
+{
+    return (uint16_t)((uint16_t)p[1] << 8 | p[0]);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function reads only the selected fields of the RX signal quality diagnostic data,
+ * see dwt_readdiagnostics_sel() in deca_device_api.h
+ *
+ * input parameters
+ * @param diagnostics - diagnostic structure pointer, only the fields selected are written
+ * @param fields - DWT_DIAG_xxx fields to read
+ *
+ * output parameters
+ *
+ * returns the DWT_DIAG_xxx fields read
+ */
+uint32_t dwt_readdiagnostics_sel(dwt_rxdiag_t *diagnostics, uint32_t fields)
+{
+#ifdef DWT_DIAG_STATIC_BUF
+    uint8_t *temp = pdw3000local->diag_buf;
+#else
+    uint8_t temp[DB_MAX_DIAG_SIZE];
+#endif
+    uint32_t need[(DB_MAX_DIAG_SIZE + 31) / 32] = { 0 };
+    uint32_t done = 0;
+    uint16_t size, split, i, start, end;
+    uint8_t db = (pdw3000local->dblbuffon != DBL_BUFF_OFF);
+    const uint8_t *p;
+    int f;
+
+    // Bytes the CIA logs with the current setting
+    if (db)
+    {
+        size = (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_MAX) ? DB_MAX_DIAG_SIZE :
+               (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_MID) ? DB_MID_DIAG_SIZE : DB_MIN_DIAG_SIZE;
+        split = DB_MAX_DIAG_SIZE;
+    }
+    else
+    {
+        size = (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_ALL) ? DIAG_SB_SIZE : DIAG_SB_MIN_SIZE;
+        split = DIAG_SB_D_OFFSET;   // the two blocks are read separately
+    }
+
+    for (f = 0; f < (int)DIAG_FIELDS; f++)
+    {
+        const dwt_diag_field_t *d = &dwt_diag_fields[f];
+        uint8_t off = db ? d->db : d->sb;
+
+        if ((fields & d->field) && (off + d->len <= size))
+        {
+            done |= d->field;
+            for (i = off; i < off + d->len; i++)
+            {
+                need[i >> 5] |= 1UL << (i & 31);
+            }
+        }
+    }
+
+    // Read the needed bytes in spans, through gaps of up to DIAG_MERGE_GAP bytes
+    i = 0;
+    while (i < size)
+    {
+        if (!(need[i >> 5] & (1UL << (i & 31))))
+        {
+            i++;
+            continue;
+        }
+        start = i;
+        end = i + 1;
+        for (i = end; (i < size) && (i < end + DIAG_MERGE_GAP + 1) && ((start >= split) || (i < split)); i++)
+        {
+            if (need[i >> 5] & (1UL << (i & 31)))
+            {
+                end = i + 1;
+            }
+        }
+        _dwt_diag_read_span((uint8_t)start, (uint8_t)(end - start), temp);
+        i = end;
+    }
+
+    for (f = 0; f < (int)DIAG_FIELDS; f++)
+    {
+        const dwt_diag_field_t *d = &dwt_diag_fields[f];
+
+        if (!(done & d->field))
+        {
+            continue;
+        }
+        p = &temp[db ? d->db : d->sb];
+
+        switch (d->field)
+        {
+        case DWT_DIAG_IP_TS:
+            memcpy(diagnostics->ipatovRxTime, p, CIA_I_RX_TIME_LEN);
+            diagnostics->ipatovRxStatus = db ? p[CIA_C_STAT_OFFSET] : p[4 + CIA_I_STAT_OFFSET];
+            diagnostics->ipatovPOA = db ? _dwt_diag_u16(&p[1]) : _dwt_diag_u16(&p[5]);
+            break;
+        case DWT_DIAG_STS_TS:
+            memcpy(diagnostics->stsRxTime, p, CIA_I_RX_TIME_LEN);
+            diagnostics->stsRxStatus = db ? p[CIA_C_STAT_OFFSET] : ((uint16_t)p[4 + CIA_C_STAT_OFFSET + 1] | p[4 + CIA_C_STAT_OFFSET]) >> 7;
+            diagnostics->stsPOA = db ? _dwt_diag_u16(&p[1]) : _dwt_diag_u16(&p[5]);
+            break;
+        case DWT_DIAG_STS2_TS:
+            memcpy(diagnostics->sts2RxTime, p, CIA_I_RX_TIME_LEN);
+            diagnostics->sts2RxStatus = db ? p[CIA_C_STAT_OFFSET] : ((uint16_t)p[4 + CIA_C_STAT_OFFSET + 1] | p[4 + CIA_C_STAT_OFFSET]) >> 7;
+            diagnostics->sts2POA = db ? _dwt_diag_u16(&p[1]) : _dwt_diag_u16(&p[5]);
+            break;
+        case DWT_DIAG_TDOA:
+            memcpy(diagnostics->tdoa, p, CIA_I_RX_TIME_LEN + 1);
+            break;
+        case DWT_DIAG_PDOA:
+            diagnostics->pdoa = (int16_t)(_dwt_diag_u16(&p[2]) & 0x3FFF);
+            if (diagnostics->pdoa & 0x2000) diagnostics->pdoa |= 0xC000; //sign extend
+            break;
+        case DWT_DIAG_XTAL:
+            diagnostics->xtalOffset = (int16_t)(_dwt_diag_u16(p) & 0x1FFF);
+            break;
+        case DWT_DIAG_CIA1:
+            diagnostics->ciaDiag1 = _dwt_diag_u32(p) & 0x1FFFFFFF;
+            break;
+        case DWT_DIAG_IP_PEAK:
+            diagnostics->ipatovPeak = _dwt_diag_u32(p) & 0x7FFFFFFF;
+            break;
+        case DWT_DIAG_IP_POWER:
+            diagnostics->ipatovPower = _dwt_diag_u32(p) & 0x1FFFF;
+            break;
+        case DWT_DIAG_IP_F:
+            diagnostics->ipatovF1 = _dwt_diag_u32(p) & 0x3FFFFF;
+            diagnostics->ipatovF2 = _dwt_diag_u32(&p[4]) & 0x3FFFFF;
+            diagnostics->ipatovF3 = _dwt_diag_u32(&p[8]) & 0x3FFFFF;
+            break;
+        case DWT_DIAG_IP_FP:
+            diagnostics->ipatovFpIndex = _dwt_diag_u16(p);
+            break;
+        case DWT_DIAG_IP_ACCUM:
+            diagnostics->ipatovAccumCount = _dwt_diag_u16(p) & 0xFFF;
+            break;
+        case DWT_DIAG_STS_PEAK:
+            diagnostics->stsPeak = _dwt_diag_u32(p) & 0x3FFFFFFF;
+            break;
+        case DWT_DIAG_STS_POWER:
+            diagnostics->stsPower = _dwt_diag_u16(p);
+            break;
+        case DWT_DIAG_STS_F:
+            diagnostics->stsF1 = _dwt_diag_u32(p) & 0x3FFFFF;
+            diagnostics->stsF2 = _dwt_diag_u32(&p[4]) & 0x3FFFFF;
+            diagnostics->stsF3 = _dwt_diag_u32(&p[8]) & 0x3FFFFF;
+            break;
+        case DWT_DIAG_STS_FP:
+            diagnostics->stsFpIndex = _dwt_diag_u16(p) & 0x7FFF;
+            break;
+        case DWT_DIAG_STS_ACCUM:
+            diagnostics->stsAccumCount = _dwt_diag_u16(p) & 0xFFF;
+            break;
+        case DWT_DIAG_STS2_PEAK:
+            diagnostics->sts2Peak = _dwt_diag_u32(p) & 0x3FFFFFFF;
+            break;
+        case DWT_DIAG_STS2_POWER:
+            diagnostics->sts2Power = _dwt_diag_u16(p);
+            break;
+        case DWT_DIAG_STS2_F:
+            diagnostics->sts2F1 = _dwt_diag_u32(p) & 0x3FFFFF;
+            diagnostics->sts2F2 = _dwt_diag_u32(&p[4]) & 0x3FFFFF;
+            diagnostics->sts2F3 = _dwt_diag_u32(&p[8]) & 0x3FFFFF;
+            break;
+        case DWT_DIAG_STS2_FP:
+            diagnostics->sts2FpIndex = _dwt_diag_u16(p) & 0x7FFF;
+            break;
+        case DWT_DIAG_STS2_ACCUM:
+            diagnostics->sts2AccumCount = _dwt_diag_u16(p) & 0xFFF;
+            break;
+        }
+    }
+
+    return done;
+}
+#endif
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to read the TX timestamp (adjusted with the programmed antenna delay)
  *
@@ -2399,51 +4303,150 @@ void dwt_readtdoa(uint8_t * tdoa)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is used to read the RX timestamp (adjusted time of arrival)
+ * @brief This is used to read the RX and TX timestamps, the frame info and (optionally) the other results of a reception
+ *        needed for ranging, with as few SPI transactions as possible.
  *
  * input parameters
- * @param timestamp - a pointer to a 5-byte buffer which will store the read RX timestamp time
+ * @param info - pointer to the structure to fill
+ * @param mask - DWT_RXINFO_xxx groups to read on top of the timestamps and frame info
  *
- * output parameters - the timestamp buffer will contain the value after the function call
+ * output parameters - the info structure will contain the values after the function call
  *
  * no return value
  */
-void dwt_readrxtimestamp(uint8_t * timestamp)
+void dwt_readrxinfo(dwt_rxinfo_t *info, uint8_t mask)
 {
+    uint8_t buf[RXINFO_GEN_LEN];
+    uint8_t cia[RXINFO_CIA_LEN];
+    const uint8_t *rx_time;
+    const uint8_t *pdoa;
+    const uint8_t *coe;
+    uint16_t regval;
+
     switch (pdw3000local->dblbuffon)    //check if in double buffer mode and if so which buffer host is currently accessing
     {
     case DBL_BUFF_ACCESS_BUFFER_1:
         //!!! Assumes that Indirect pointer register B was already set. This is done in the dwt_setdblrxbuffmode when mode is enabled.
-        dwt_readfromdevice(INDIRECT_POINTER_B_ID, BUF1_RX_TIME -BUF1_RX_FINFO, RX_TIME_RX_STAMP_LEN, timestamp);
+        dwt_readfromdevice(INDIRECT_POINTER_B_ID, 0, RXINFO_BUF_LEN, buf);
         break;
     case DBL_BUFF_ACCESS_BUFFER_0:
-        dwt_readfromdevice(BUF0_RX_TIME, 0, RX_TIME_RX_STAMP_LEN, timestamp);
+        dwt_readfromdevice(BUF0_RX_FINFO, 0, RXINFO_BUF_LEN, buf);
         break;
     default:
-        dwt_readfromdevice(RX_TIME_0_ID, 0, RX_TIME_RX_STAMP_LEN, timestamp); // Get the adjusted time of arrival
+        // RX_FINFO, RX_TIME and TX_TIME are in the same register file, a single read gets all three
+        dwt_readfromdevice(RX_FINFO_ID, 0, RXINFO_GEN_LEN, buf);
         break;
     }
-}
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is used to read the raw RX timestamp (RMARKER time) before any CIA first path analysis adjustments
- *
- * input parameters
- * @param timestamp - a pointer to a 4-byte buffer which will store the read RX timestamp time
- *
- * output parameters - the timestamp buffer will contain the value after the function call
- *
- * no return value
- */
-void dwt_readrxtimestampunadj(uint8_t * timestamp)
-{
-    timestamp[0] = 0;
-    dwt_readfromdevice(RX_TIME_RAW_ID, 0, RX_TIME_RX_STAMP_LEN-1, &timestamp[1]);
-}
+    if (pdw3000local->dblbuffon)
+    {
+        // The RX buffer also holds the CIA results, only the TX timestamp needs a read of its own
+        rx_time = &buf[BUF0_RX_TIME - BUF0_RX_FINFO];
+        pdoa = &buf[BUF0_PDOA - BUF0_RX_FINFO + 2];
+        coe = &buf[BUF0_CIA_DIAG_0 - BUF0_RX_FINFO];
+        dwt_readtxtimestamp(info->txStamp);
+    }
+    else
+    {
+        rx_time = &buf[RX_TIME_0_ID - RX_FINFO_ID];
+        pdoa = &cia[2];
+        coe = &cia[CIA_DIAG_0_ID - CIA_TDOA_1_PDOA_ID];
+        memcpy(info->txStamp, &buf[TX_TIME_LO_ID - RX_FINFO_ID], TX_TIME_TX_STAMP_LEN);
+        if (mask & DWT_RXINFO_CIA)
+        {
+            dwt_readfromdevice(CIA_TDOA_1_PDOA_ID, 0, RXINFO_CIA_LEN, cia);
+        }
+    }
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is used to read the RX timestamp (adjusted time of arrival) w.r.t. Ipatov CIR
- *
+    memcpy(info->rxStamp, rx_time, RX_TIME_RX_STAMP_LEN);
+    info->finfo = (uint32_t)buf[3] << 24 | (uint32_t)buf[2] << 16 | (uint32_t)buf[1] << 8 | buf[0];
+
+    // Report frame length - Standard frame length up to 127, extended frame length up to 1023 bytes
+    if (pdw3000local->longFrames == 0)
+    {
+        info->datalength = (uint16_t)(info->finfo & RX_FINFO_STD_RXFLEN_MASK);
+    }
+    else
+    {
+        info->datalength = (uint16_t)(info->finfo & RX_FINFO_RXFLEN_BIT_MASK);
+    }
+
+    info->valid = mask & DWT_RXINFO_ALL;
+
+    if (mask & DWT_RXINFO_CIA)
+    {
+        regval = ((uint16_t)coe[1] << 8 | coe[0]) & CIA_DIAG_0_COE_PPM_BIT_MASK;
+        if (regval & B11_SIGN_EXTEND_TEST)
+        {
+            regval |= B11_SIGN_EXTEND_MASK;             // sign extend bit #12 to the whole short
+        }
+        info->clockOffset = (int16_t)regval;
+
+        regval = ((uint16_t)pdoa[1] << 8 | pdoa[0]) & (CIA_TDOA_1_PDOA_PDOA_BIT_MASK >> 16);
+        if (regval & B12_SIGN_EXTEND_TEST)
+        {
+            regval |= B12_SIGN_EXTEND_MASK;             //sign extend
+        }
+        info->pdoa = (int16_t)regval;
+    }
+
+    if (mask & DWT_RXINFO_CI)
+    {
+        info->carrierInt = dwt_readcarrierintegrator();
+    }
+
+    if ((mask & DWT_RXINFO_STS) && (dwt_readstsquality(&info->stsQuality) >= 0))
+    {
+        info->valid |= DWT_RXINFO_STS_GOOD;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is used to read the RX timestamp (adjusted time of arrival)
+ *
+ * input parameters
+ * @param timestamp - a pointer to a 5-byte buffer which will store the read RX timestamp time
+ *
+ * output parameters - the timestamp buffer will contain the value after the function call
+ *
+ * no return value
+ */
+void dwt_readrxtimestamp(uint8_t * timestamp)
+{
+    switch (pdw3000local->dblbuffon)    //check if in double buffer mode and if so which buffer host is currently accessing
+    {
+    case DBL_BUFF_ACCESS_BUFFER_1:
+        //!!! Assumes that Indirect pointer register B was already set. This is done in the dwt_setdblrxbuffmode when mode is enabled.
+        dwt_readfromdevice(INDIRECT_POINTER_B_ID, BUF1_RX_TIME -BUF1_RX_FINFO, RX_TIME_RX_STAMP_LEN, timestamp);
+        break;
+    case DBL_BUFF_ACCESS_BUFFER_0:
+        dwt_readfromdevice(BUF0_RX_TIME, 0, RX_TIME_RX_STAMP_LEN, timestamp);
+        break;
+    default:
+        dwt_readfromdevice(RX_TIME_0_ID, 0, RX_TIME_RX_STAMP_LEN, timestamp); // Get the adjusted time of arrival
+        break;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is used to read the raw RX timestamp (RMARKER time) before any CIA first path analysis adjustments
+ *
+ * input parameters
+ * @param timestamp - a pointer to a 4-byte buffer which will store the read RX timestamp time
+ *
+ * output parameters - the timestamp buffer will contain the value after the function call
+ *
+ * no return value
+ */
+void dwt_readrxtimestampunadj(uint8_t * timestamp)
+{
+    timestamp[0] = 0;
+    dwt_readfromdevice(RX_TIME_RAW_ID, 0, RX_TIME_RX_STAMP_LEN-1, &timestamp[1]);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is used to read the RX timestamp (adjusted time of arrival) w.r.t. Ipatov CIR
+ *
  * input parameters
  * @param timestamp - a pointer to a 5-byte buffer which will store the read RX timestamp time
  *
@@ -2700,7 +4703,8 @@ void dwt_aon_write(uint16_t aon_address, uint8_t aon_write_data)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is used to read the OTP data from given address into provided array
+ * @brief This is used to read the OTP data from given address into provided array. The words of the OTP shadow
+ * (addresses below DWT_OTP_SHADOW_WORDS) are read from the OTP once after dwt_initialise(), then from RAM.
  *
  * input parameters
  * @param address - this is the OTP address to read from
@@ -2717,7 +4721,7 @@ void dwt_otpread(uint16_t address, uint32_t *array, uint8_t length)
 
     for(i=0; i<length; i++)
     {
-        array[i] = _dwt_otpread(address + i);
+        array[i] = _dwt_otpread_shadow(address + i);
     }
 
     return ;
@@ -2750,6 +4754,58 @@ uint32_t _dwt_otpread(uint16_t address)
     return ret_data;
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief function to read the OTP memory through the OTP shadow: a word of the shadow is read from the OTP the first
+ * time after dwt_initialise() and from RAM afterwards (the OTP only changes through dwt_otpwriteandverify(), which
+ * updates the shadow). The other addresses are read from the OTP each time.
+ *
+ * input parameters
+ * @param address - address to read at
+ *
+ * output parameters
+ *
+ * returns the 32bit of read data
+ */
+static uint32_t _dwt_otpread_shadow(uint16_t address)
+{
+    uint32_t data;
+
+    if (address >= DWT_OTP_SHADOW_WORDS)
+    {
+        return _dwt_otpread(address);
+    }
+
+    if (pdw3000local->otp_shadow_valid[address >> 5] & (1UL << (address & 31)))
+    {
+        return pdw3000local->otp_shadow[address];
+    }
+
+    data = _dwt_otpread(address);
+    _dwt_otpshadow_set(address, data);
+    return data;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief function to set a word of the OTP shadow (no effect outside of it).
+ *
+ * input parameters
+ * @param address - OTP address
+ * @param data - OTP word
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_otpshadow_set(uint16_t address, uint32_t data)
+{
+    if (address < DWT_OTP_SHADOW_WORDS)
+    {
+        pdw3000local->otp_shadow[address] = data;
+        pdw3000local->otp_shadow_valid[address >> 5] |= (1UL << (address & 31));
+    }
+}
+
+#ifndef DWT_NO_OTP_PROG
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief For each value to send to OTP bloc, following two register writes are required as shown below
  *
@@ -2894,11 +4950,15 @@ void _dwt_otpprogword32(uint32_t data, uint16_t address)
  */
 int dwt_otpwriteandverify(uint32_t value, uint16_t address)
 {
+    uint32_t data;
+
     //program the word
     _dwt_otpprogword32(value, address);
 
-    //check it is programmed correctly
-    if(_dwt_otpread(address) == value)
+    //check it is programmed correctly, from the OTP itself, and keep the shadow up to date
+    data = _dwt_otpread(address);
+    _dwt_otpshadow_set(address, data);
+    if(data == value)
     {
         return DWT_SUCCESS;
     }
@@ -2907,6 +4967,7 @@ int dwt_otpwriteandverify(uint32_t value, uint16_t address)
         return DWT_ERROR;
     }
 }
+#endif
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function puts the device into deep sleep or sleep. dwt_configuresleep() should be called first
@@ -2928,632 +4989,1386 @@ void dwt_entersleep(int idle_rc)
         dwt_and8bitoffsetreg(SEQ_CTRL_ID, 0x1, (uint8_t) ~(SEQ_CTRL_AINIT2IDLE_BIT_MASK>>8));
     }
 
-    // Copy config to AON - upload the new configuration
-    dwt_write8bitoffsetreg(AON_CTRL_ID, 0, 0);
-    dwt_write8bitoffsetreg(AON_CTRL_ID, 0, AON_CTRL_ARRAY_SAVE_BIT_MASK);
+    // Copy config to AON - upload the new configuration
+    dwt_write8bitoffsetreg(AON_CTRL_ID, 0, 0);
+    dwt_write8bitoffsetreg(AON_CTRL_ID, 0, AON_CTRL_ARRAY_SAVE_BIT_MASK);
+
+    // Registers are restored (or reset) on wake up
+    _dwt_regcache_invalidate();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief sets the sleep counter to new value, this function programs the sleep counter top 16-bits [27:12]
+ *
+ * NOTE: this function needs to be run before dwt_configuresleep
+ *
+ * input parameters
+ * @param sleepcnt - this it value of the sleep counter to program
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_configuresleepcnt(uint16_t sleepcnt)
+{
+
+    dwt_aon_write(AON_SLPCNT_LO, (uint8_t)(sleepcnt));
+    dwt_aon_write(AON_SLPCNT_HI, (uint8_t)(sleepcnt>>8));
+
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief calibrates the local oscillator as its frequency can vary between 15 and 34kHz depending on temp and voltage
+ *
+ * NOTE: this function needs to be run before dwt_configuresleepcnt, so that we know what the counter units are
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the number of XTAL cycles per low-power oscillator cycle. LP OSC frequency = 38.4 MHz/return value
+ */
+uint16_t dwt_calibratesleepcnt(void)
+{
+    uint16_t temp = 0;
+
+    // Enable VDDPLL for reference clock
+    dwt_or8bitoffsetreg(LDO_CTRL_ID, 0, LDO_CTRL_LDO_VDDPLL_EN_BIT_MASK);
+    // Clear any previous cal settings
+    dwt_aon_write(AON_SLPCNT_CAL_CTRL, 0x00);
+    // Run cal
+    dwt_aon_write(AON_SLPCNT_CAL_CTRL, 0x04);
+    deca_sleep(2); //need to wait for at least 1 LP OSC period at slowest frequency of 15kHz =~ 66 us
+    // Read the Cal value from AON
+    temp = dwt_aon_read(AON_SLPCNT_CAL_LO);
+    temp = (temp) | (dwt_aon_read(AON_SLPCNT_CAL_HI) << 8);
+    // Clear cal
+    dwt_aon_write(AON_SLPCNT_CAL_CTRL, 0x00);
+    // Disable VDDPLL for reference clock
+    dwt_and8bitoffsetreg(LDO_CTRL_ID, 0, (uint8_t)~LDO_CTRL_LDO_VDDPLL_EN_BIT_MASK);
+    return (temp);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief configures the device for both DEEP_SLEEP and SLEEP modes, and on-wake mode
+ * i.e. before entering the sleep, the device should be programmed for TX or RX, then upon "waking up" the TX/RX settings
+ * will be preserved and the device can immediately perform the desired action TX/RX
+ *
+ * NOTE: e.g. Tag operation - after deep sleep, the device needs to just load the TX buffer and send the frame
+ *
+ *
+ *      mode:
+ *      DWT_PGFCAL       0x0800
+ *      DWT_GOTORX       0x0200
+ *      DWT_GOTOIDLE     0x0100
+ *      DWT_SEL_OPS      0x0040 | 0x0080
+ *      DWT_LOADOPS      0x0020
+ *      DWT_LOADLDO      0x0010
+ *      DWT_LOADDGC      0x0008
+ *      DWT_LOADBIAS     0x0004
+ *      DWT_RUNSAR       0x0002
+ *      DWT_CONFIG       0x0001 - download the AON array into the HIF (configuration download)
+ *
+ *      wake: wake up parameters
+ *      DWT_SLP_CNT_RPT  0x40 - sleep counter loop after expiration
+ *      DWT_PRESRVE_SLP  0x20 - allows for SLEEP_EN bit to be "preserved", although it will self-clear on wake up
+ *      DWT_WAKE_WK      0x10 - wake up on WAKEUP PIN
+ *      DWT_WAKE_CS      0x8 - wake up on chip select
+ *      DWT_BR_DET       0x4 - enable brownout detector during sleep/deep sleep
+ *      DWT_SLEEP        0x2 - enable sleep
+ *      DWT_SLP_EN       0x1 - enable sleep/deep sleep functionality
+ *
+ * input parameters
+ * @param mode - config on-wake parameters
+ * @param wake - config wake up parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_configuresleep(uint16_t mode, uint8_t wake)
+{
+    // Add predefined sleep settings before writing the mode
+    pdw3000local->sleep_mode |= mode;
+    dwt_write16bitoffsetreg(AON_DIG_CFG_ID, 0,  pdw3000local->sleep_mode);
+
+    dwt_write8bitoffsetreg(ANA_CFG_ID, 0, wake); //bit 0 - SLEEP_EN, bit 1 - DEEP_SLEEP=0/SLEEP=1, bit 3 wake on CS
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief this function clears the AON configuration in DW3000
+*
+* input parameters:
+*
+* output parameters
+*
+* no return value
+*/
+void dwt_clearaonconfig(void)
+{
+    // Clear any AON auto download bits (as reset will trigger AON download)
+    dwt_write16bitoffsetreg(AON_DIG_CFG_ID, 0, 0x00);
+    // Clear the wake-up configuration
+    dwt_write8bitoffsetreg(ANA_CFG_ID, 0, 0x00);
+    // Upload the new configuration
+    // Copy config to AON - upload the new configuration
+    dwt_write8bitoffsetreg(AON_CTRL_ID, 0, 0);
+    dwt_write8bitoffsetreg(AON_CTRL_ID, 0, AON_CTRL_ARRAY_SAVE_BIT_MASK);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief sets the auto TX to sleep bit. This means that after a frame
+ * transmission the device will enter deep sleep mode. The dwt_configuresleep() function
+ * needs to be called before this to configure the on-wake settings
+ *
+ * NOTE: the IRQ line has to be low/inactive (i.e. no pending events)
+ *
+ * input parameters
+ * @param enable - 1 to configure the device to enter deep sleep after TX, 0 - disables the configuration
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_entersleepaftertx(int enable)
+{
+    // Set the auto TX -> sleep bit
+    if(enable)
+    {
+        dwt_or16bitoffsetreg(SEQ_CTRL_ID, 0, SEQ_CTRL_ATX2SLP_BIT_MASK);
+
+        // The device may go to sleep on its own from now on, so the cached values cannot be relied on
+        if (!pdw3000local->regcache_atx2slp)
+        {
+            pdw3000local->regcache_saved = pdw3000local->regcache_en;
+            pdw3000local->regcache_atx2slp = 1;
+        }
+        pdw3000local->regcache_en = 0;
+        _dwt_regcache_invalidate();
+    }
+    else
+    {
+        dwt_and16bitoffsetreg(SEQ_CTRL_ID, 0, (uint16_t)~SEQ_CTRL_ATX2SLP_BIT_MASK);
+
+        // Back to the cache state from before, starting empty as the device may have slept meanwhile
+        if (pdw3000local->regcache_atx2slp)
+        {
+            pdw3000local->regcache_atx2slp = 0;
+            _dwt_regcache_invalidate();
+            pdw3000local->regcache_en = pdw3000local->regcache_saved;
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this reads the device ID and checks if it is the right one
+ *
+ * input parameters
+ * None
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+int dwt_check_dev_id(void)
+{
+    uint32_t  dev_id;
+
+    dev_id = dwt_readdevid();
+
+    LOG_INF("dev_id \"%08x\"", dev_id);
+
+    if (!((DWT_C0_PDOA_DEV_ID == dev_id) || (DWT_C0_DEV_ID == dev_id)))
+    {
+        return DWT_ERROR;
+    }
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function enables CIA diagnostic data. When turned on the following registers will be logged:
+ * IP_TOA_LO, IP_TOA_HI, STS_TOA_LO, STS_TOA_HI, STS1_TOA_LO, STS1_TOA_HI, CIA_TDOA_0, CIA_TDOA_1_PDOA, CIA_DIAG_0, CIA_DIAG_1
+ *
+ * input parameters
+ * @param enable_mask :     DW_CIA_DIAG_LOG_MAX (0x8)   //CIA to copy to swinging set a maximum set of diagnostic registers in Double Buffer mode
+ *                          DW_CIA_DIAG_LOG_MID (0x4)   //CIA to copy to swinging set a medium set of diagnostic registers in Double Buffer mode
+ *                          DW_CIA_DIAG_LOG_MIN (0x2)   //CIA to copy to swinging set a minimal set of diagnostic registers in Double Buffer mode
+ *                          DW_CIA_DIAG_LOG_ALL (0x1)   //CIA to log all diagnostic registers
+ *                          DW_CIA_DIAG_LOG_MIN (0x0)   //CIA to log reduced set of diagnostic registers
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_configciadiag(uint8_t enable_mask)
+{
+    if(enable_mask & DW_CIA_DIAG_LOG_ALL)
+    {
+        dwt_and8bitoffsetreg(CIA_CONF_ID, 2, ~(CIA_DIAGNOSTIC_OFF));
+    }
+    else
+    {
+        dwt_or8bitoffsetreg(CIA_CONF_ID, 2, CIA_DIAGNOSTIC_OFF);
+    }
+
+    dwt_write8bitoffsetreg(RDB_DIAG_MODE_ID, 0, enable_mask >> 1);
+
+    pdw3000local->cia_diagnostic = enable_mask;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This call enables the auto-ACK feature. If the responseDelayTime (parameter) is 0, the ACK will be sent a.s.a.p.
+ * otherwise it will be sent with a programmed delay (in symbols), max is 255.
+ * NOTE: needs to have frame filtering enabled as well
+ *
+ * input parameters
+ * @param responseDelayTime - if non-zero the ACK is sent after this delay, max is 255.
+ * @param enable - enables or disables the auto-ACK feature
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_enableautoack(uint8_t responseDelayTime, int enable)
+{
+    // Set auto ACK reply delay
+    dwt_write8bitoffsetreg(ACK_RESP_ID, 3, responseDelayTime); // In symbols
+
+    // Enable AUTO ACK
+    if (enable)
+    {
+        dwt_or32bitoffsetreg(SYS_CFG_ID, 0, SYS_CFG_AUTO_ACK_BIT_MASK | SYS_CFG_FAST_AAT_EN_BIT_MASK); //set the AUTO_ACK bit
+    }
+    else
+    {
+        dwt_and16bitoffsetreg(SYS_CFG_ID, 0, (uint16_t)(~SYS_CFG_AUTO_ACK_BIT_MASK)); //clear the AUTO_ACK bit
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This API sends issues a command to the device that the specific RX buff is free for frame reception,
+ * it will also update the dblbuffon flag/status to the next buffer
+ *
+ * input parameters
+ * @param None
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_signal_rx_buff_free(void)
+{
+    dwt_writefastCMD(CMD_DB_TOGGLE);
+
+    //update the status
+    if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)
+    {
+        pdw3000local->dblbuffon = DBL_BUFF_ACCESS_BUFFER_0;  //next buffer is RX_BUFFER_0
+    }
+    else
+    {
+        pdw3000local->dblbuffon = DBL_BUFF_ACCESS_BUFFER_1;  //next buffer is RX_BUFFER_1
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This call enables the double receive buffer mode
+ *
+ * input parameters
+ * @param dbl_buff_state - enum variable for enabling/disabling double buffering mode
+ * @param dbl_buff_mode - enum variable for Receiver Auto-Re-enable
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setdblrxbuffmode(dwt_dbl_buff_state_e dbl_buff_state, dwt_dbl_buff_mode_e dbl_buff_mode)
+{
+    uint32_t  or_val=0,and_val=-1;
+
+    if (dbl_buff_state==DBL_BUF_STATE_EN)
+    {
+        and_val= ~(SYS_CFG_DIS_DRXB_BIT_MASK);
+        pdw3000local->dblbuffon = DBL_BUFF_ACCESS_BUFFER_0;    //the host will access RX_BUFFER_0 initially (on 1st reception after enable)
+        //Updating indirect address here to save time setting it inside the interrupt(in order to read BUF1_RX_FINFO)..
+        //Pay attention that after sleep, this register needs to be set again.
+        dwt_write32bitreg(INDIRECT_ADDR_B_ID, (BUF1_RX_FINFO >> 16));
+        dwt_write32bitreg(ADDR_OFFSET_B_ID, BUF1_RX_FINFO & 0xffff);
+    }
+    else
+    {
+        or_val = SYS_CFG_DIS_DRXB_BIT_MASK;
+        pdw3000local->dblbuffon = DBL_BUFF_OFF;
+    }
+
+    if (dbl_buff_mode == DBL_BUF_MODE_AUTO)
+    {
+        or_val |= SYS_CFG_RXAUTR_BIT_MASK;
+    }
+    else
+    {
+        and_val &= (~SYS_CFG_RXAUTR_BIT_MASK); //Clear the needed bit
+    }
+
+    dwt_and_or32bitoffsetreg(SYS_CFG_ID,0, and_val, or_val);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This sets the receiver turn on delay time after a transmission of a frame
+ *
+ * input parameters
+ * @param rxDelayTime - (20 bits) - the delay is in UWB microseconds
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setrxaftertxdelay(uint32_t rxDelayTime)
+{
+    uint32_t val = dwt_read32bitreg(ACK_RESP_ID); // Read ACK_RESP_T_ID register
+
+    val &= (~ACK_RESP_W4R_TIM_BIT_MASK); // Clear the timer (19:0)
+
+    val |= (rxDelayTime & ACK_RESP_W4R_TIM_BIT_MASK); // In UWB microseconds (e.g. turn the receiver on 20uus after TX)
+
+    dwt_write32bitoffsetreg(ACK_RESP_ID, 0, val);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function is used to register the different callbacks called when one of the corresponding event occurs.
+ *
+ * NOTE: Callbacks can be undefined (set to NULL). In this case, dwt_isr() will process the event as usual but the 'null'
+ * callback will not be called.
+ *
+ * input parameters
+ * @param cbTxDone - the pointer to the TX confirmation event callback function
+ * @param cbRxOk - the pointer to the RX good frame event callback function
+ * @param cbRxTo - the pointer to the RX timeout events callback function
+ * @param cbRxErr - the pointer to the RX error events callback function
+ * @param cbSPIErr - the pointer to the SPI error events callback function
+ * @param cbSPIRdy - the pointer to the SPI ready events callback function
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr, dwt_cb_t cbSPIErr, dwt_cb_t cbSPIRdy)
+{
+    pdw3000local->cbTxDone = cbTxDone;
+    pdw3000local->cbRxOk = cbRxOk;
+    pdw3000local->cbRxTo = cbRxTo;
+    pdw3000local->cbRxErr = cbRxErr;
+    pdw3000local->cbSPIErr = cbSPIErr;
+    pdw3000local->cbSPIRdy = cbSPIRdy;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function registers the callback called by dwt_isr() when a DWT_START_TX_CCA transmission is cancelled
+ *        because a preamble was detected within the preamble detection timeout (CCA_FAIL event). The device is then
+ *        back in IDLE. The CCA_FAIL interrupt must also be enabled (SYS_ENABLE_HI_CCA_FAIL_ENABLE_BIT_MASK in
+ *        dwt_setinterrupt()).
+ *
+ * NOTE: the CCA_FAIL event shares its fast status bit with the auto-ACK (AAT) event, the status is only read and the
+ * event cleared when a callback is registered.
+ *
+ * input parameters
+ * @param cbCCAFail - the pointer to the CCA fail event callback function, or NULL
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setcbccafail(dwt_cb_t cbCCAFail)
+{
+    pdw3000local->cbCCAFail = cbCCAFail;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function checks if the IRQ line is active - this is used instead of interrupt handler
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * return value is 1 if the IRQS bit is set and 0 otherwise
+ */
+uint8_t dwt_checkirq(void)
+{
+    /* Reading the lower byte only is enough for this operation */
+    return (dwt_read8bitoffsetreg(SYS_STATUS_ID, 0) & SYS_STATUS_IRQS_BIT_MASK);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function checks if the DW3000 is in IDLE_RC state
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * return value is 1 if the IDLE_RC bit is set and 0 otherwise
+ */
+uint8_t dwt_checkidlerc(void)
+{
+    /* Wait 2 ms for DW IC to get into IDLE_RC state */
+    //deca_sleep(2);
+
+    /* Poll DW IC until IDLE_RC event set.
+     * This means that DW IC is in IDLE_RC state and ready */
+    uint32_t reg = ((uint32_t)dwt_read16bitoffsetreg(SYS_STATUS_ID, 2) << 16);
+
+    return ( (reg & (SYS_STATUS_RCINIT_BIT_MASK)) == (SYS_STATUS_RCINIT_BIT_MASK));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is the DW3000's general Interrupt Service Routine. It will process/report the following events:
+ *          - RXFR + no data mode (through cbRxOk callback, but set datalength to 0)
+ *          - RXFCG (through cbRxOk callback)
+ *          - TXFRS (through cbTxDone callback)
+ *          - RXRFTO/RXPTO (through cbRxTo callback)
+ *          - RXPHE/RXFCE/RXRFSL/RXSFDTO/AFFREJ/LDEERR/LCSSERR (through cbRxTo cbRxErr)
+ *          -
+ *        For all events, corresponding interrupts are cleared and necessary resets are performed. In addition, in the RXFCG case,
+ *        received frame information and frame control are read before calling the callback. If double buffering is activated, it
+ *        will also toggle between reception buffers once the reception callback processing has ended.
+ *
+ *        /!\ This version of the ISR supports double buffering but does not support automatic RX re-enabling!
+ *
+ * NOTE:  In PC based system using (Cheetah or ARM) USB to SPI converter there can be no interrupts, however we still need something
+ *        to take the place of it and operate in a polled way. In an embedded system this function should be configured to be triggered
+ *        on any of the interrupts described above.
+
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+
+
+static void _dwt_rxring_put(void);
+static void _dwt_rxcont_drain(void);
+static void _dwt_rxcont_restart(void);
+static void _dwt_sched_done(uint8_t wait);
+#ifndef DWT_NO_AES
+static void _dwt_aes_complete(void);
+#endif
+
+void dwt_isr(void)
+{
+    DWT_PROBE_START(DWT_PROBE_ISR);
+
+    //Read Fast Status register
+    uint8_t fstat = dwt_read8bitoffsetreg(FINT_STAT_ID, 0);
+    uint32_t status = dwt_read32bitreg(SYS_STATUS_ID); // Read status register low 32bits
+    uint8_t aes_event = 0;
+
+    pdw3000local->cbData.status = status;
+    if ((pdw3000local->stsconfig & DWT_STS_MODE_ND) == DWT_STS_MODE_ND) //cannot use FSTAT when in no data mode...
+    {
+        if (status & SYS_STATUS_RXFR_BIT_MASK)
+        {
+            fstat |= FINT_STAT_RXOK_BIT_MASK;
+        }
+    }
+    // Handle System panic confirmation event
+    // AES_ERR|SPICRCERR|BRNOUT|SPI_UNF|SPI_OVR|CMD_ERR|SPI_COLLISION|PLLHILO
+    if (fstat & FINT_STAT_SYS_PANIC_BIT_MASK)
+    {
+        pdw3000local->cbData.status_hi = dwt_read16bitoffsetreg(SYS_STATUS_HI_ID, 0);
+
+        // Handle SPI CRC error event, which was due to an SPI write CRC error
+        // Handle SPI error events (if this has happened, the last SPI transaction has not completed correctly, the device should be reset)
+        if ((pdw3000local->spicrc && (pdw3000local->cbData.status & SYS_STATUS_SPICRCE_BIT_MASK)) ||
+                (pdw3000local->cbData.status_hi & (SYS_STATUS_HI_SPIERR_BIT_MASK | SYS_STATUS_HI_SPI_UNF_BIT_MASK | SYS_STATUS_HI_SPI_OVF_BIT_MASK)))
+        {
+            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_SPICRCE_BIT_MASK);
+            dwt_write16bitoffsetreg(SYS_STATUS_HI_ID, 0, (SYS_STATUS_HI_SPIERR_BIT_MASK | SYS_STATUS_HI_SPI_UNF_BIT_MASK | SYS_STATUS_HI_SPI_OVF_BIT_MASK)); // Clear SPI error event bits
+            // Call the corresponding callback if present
+            if (pdw3000local->cbSPIErr != NULL)
+            {
+                pdw3000local->cbSPIErr(&pdw3000local->cbData);
+            }
+        }
+
+        // Handle Fast CMD errors event, the means the last CMD did not execute (e.g. it was given while device was already executing previous)
+        if (pdw3000local->cbData.status_hi & SYS_STATUS_HI_CMD_ERR_BIT_MASK)
+        {
+            dwt_write16bitoffsetreg(SYS_STATUS_HI_ID, 0, SYS_STATUS_HI_CMD_ERR_BIT_MASK); // Clear CMD error event bit
+            // Call the corresponding callback if present
+            /*if(pdw3000local->cbCMDErr != NULL)
+            {
+                pdw3000local->cbCMDErr(&pdw3000local->cbData);
+            }*/
+        }
+
+        //BRNOUT, PLLHILO not handled here ...
+    }
+
+#ifndef DWT_NO_AES
+    // Handle AES job completion (see dwt_do_aes_async), AES_DONE/AES_ERR are reported through SYS_EVENT/SYS_PANIC
+    if ((pdw3000local->aesjob != NULL) && (fstat & (FINT_STAT_SYS_EVENT_BIT_MASK | FINT_STAT_SYS_PANIC_BIT_MASK)))
+    {
+        if (!(fstat & FINT_STAT_SYS_PANIC_BIT_MASK))
+        {
+            pdw3000local->cbData.status_hi = dwt_read16bitoffsetreg(SYS_STATUS_HI_ID, 0);
+        }
+        if (pdw3000local->cbData.status_hi & (SYS_STATUS_HI_AES_DONE_BIT_MASK | SYS_STATUS_HI_AES_ERR_BIT_MASK))
+        {
+            aes_event = 1;
+            _dwt_aes_complete();
+        }
+    }
+#endif
+
+    // Handle TX frme sent confirmation event
+    if (fstat & FINT_STAT_TXOK_BIT_MASK)
+    {
+        // Clear TX events after the callback - this lets the host schedule another TX/RX inside the callback
+        dwt_write8bitoffsetreg(SYS_STATUS_ID, 0, (uint8_t)SYS_STATUS_ALL_TX); // Clear TX event bits to clear the interrupt
+
+        // Schedule queue: arm the next event
+        _dwt_sched_done(DWT_SCHED_WAIT_TX);
+
+        // Call the corresponding callback if present
+        if (pdw3000local->cbTxDone != NULL)
+        {
+            DWT_PROBE_START(DWT_PROBE_CB);
+            pdw3000local->cbTxDone(&pdw3000local->cbData);
+            DWT_PROBE_STOP(DWT_PROBE_CB);
+        }
+    }
+
+    // Handle CCA fail event (preamble detected, TX cancelled), see dwt_setcbccafail
+    if ((fstat & FINT_STAT_CCA_FAIL_AAT_BIT_MASK) && (pdw3000local->cbCCAFail != NULL))
+    {
+        pdw3000local->cbData.status_hi = dwt_read16bitoffsetreg(SYS_STATUS_HI_ID, 0);
+        if (pdw3000local->cbData.status_hi & SYS_STATUS_HI_CCA_FAIL_BIT_MASK)
+        {
+            dwt_write16bitoffsetreg(SYS_STATUS_HI_ID, 0, SYS_STATUS_HI_CCA_FAIL_BIT_MASK); // Clear the bit to clear the interrupt
+            pdw3000local->cbCCAFail(&pdw3000local->cbData);
+        }
+    }
+
+    // SPI ready and IDLE_RC bit gets set when device powers on, or on wake up
+    // (not when the event was only the AES job completion)
+    if ((fstat & FINT_STAT_SYS_EVENT_BIT_MASK) &&
+            (!aes_event || (status & (SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK))))
+    {
+        //pdw3000local->cbData.status_hi = dwt_read16bitreg(SYS_STATUS_HI_ID);
+
+        // The device has powered on or woken up
+        _dwt_regcache_invalidate();
+
+        // Call the corresponding callback if present
+        if (pdw3000local->cbSPIRdy != NULL)
+        {
+            pdw3000local->cbSPIRdy(&pdw3000local->cbData);
+        }
+        // Clear SPI RDY events after the callback - this lets the host read the SYS_STATUS register inside the callback
+        dwt_write16bitoffsetreg(SYS_STATUS_ID, 2, (uint16_t)((SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK) >> 16)); // Clear the bit to clear the interrupt
+
+        //VTDET, GPIO, not handled here ...
+    }
+
+    // Handle RX ok events
+    if (fstat & FINT_STAT_RXOK_BIT_MASK)
+    {
+        uint32_t cia_err = 0;
+
+        pdw3000local->cbData.rx_flags = 0;
+
+        if (pdw3000local->dblbuffon) // if in double buffer mode
+        {
+            uint8_t statusDB = dwt_read8bitoffsetreg(RDB_STATUS_ID,0);
+
+            if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1) //If accessing the second buffer (RX_BUFFER_B then read second nibble of the DB status reg)
+            {
+                statusDB >>= 4;
+            }
+            //setting the relevant bits in the main status register according to DB status register
+            if (statusDB & RDB_STATUS_RXFCG0_BIT_MASK)
+                status |= SYS_STATUS_RXFCG_BIT_MASK;
+            if (statusDB & RDB_STATUS_RXFR0_BIT_MASK)
+                status |= SYS_STATUS_RXFR_BIT_MASK;
+            if (statusDB & RDB_STATUS_CIADONE0_BIT_MASK)
+                status |= SYS_STATUS_CIADONE_BIT_MASK;
+        }
+
+        //update the status based on the DB RX events
+        pdw3000local->cbData.status = status;
+        //clear LDE error (as we do not want to go back into cbRxErr)
+        if (status & SYS_STATUS_CIAERR_BIT_MASK)
+        {
+            pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_CER;
+            cia_err = SYS_STATUS_CIAERR_BIT_MASK;
+        }
+        else
+        {
+            if (status & SYS_STATUS_CIADONE_BIT_MASK)
+            {
+                pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_CIA;
+            }
+        }
+
+        if (status & SYS_STATUS_CPERR_BIT_MASK)
+        {
+            pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_CPER;
+            cia_err |= SYS_STATUS_CPERR_BIT_MASK;
+        }
+
+        // When using No Data STS mode we do not get RXFCG but RXFR
+        if ((status & SYS_STATUS_RXFR_BIT_MASK) && ((pdw3000local->stsconfig & DWT_STS_MODE_ND) == DWT_STS_MODE_ND))
+        {
+            pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_ND;
+            pdw3000local->cbData.datalength = 0;
+
+            cia_err |= SYS_STATUS_RXFCE_BIT_MASK; // Clear FCE
+        }
+        else
+        // Handle RX good frame event
+        if (status & SYS_STATUS_RXFCG_BIT_MASK)
+        {
+            uint16_t finfo16;
+
+            // Read frame info - Only the first two bytes of the register are used here.
+            switch (pdw3000local->dblbuffon)  //check if in double buffer mode and if so which buffer host is currently accessing
+            {
+            case DBL_BUFF_ACCESS_BUFFER_1: //accessing frame info relating to the second buffer (RX_BUFFER_1)
+                dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF1_EVENTS);  //clear DB status register bits corresponding to RX_BUFFER_1
+                finfo16 = dwt_read16bitoffsetreg(INDIRECT_POINTER_B_ID, 0);
+                break;
+            case DBL_BUFF_ACCESS_BUFFER_0: //accessing frame info relating to the first buffer (RX_BUFFER_0)
+                dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF0_EVENTS);  //clear DB status register bits corresponding to RX_BUFFER_0
+                finfo16 = dwt_read16bitoffsetreg(BUF0_RX_FINFO, 0);
+                break;
+            default: //accessing frame info relating to the second buffer (RX_BUFFER_0) (single buffer mode)
+                finfo16 = dwt_read16bitoffsetreg(RX_FINFO_ID, 0);
+                break;
+            }
+
+            // Report frame length - Standard frame length up to 127, extended frame length up to 1023 bytes
+            if (pdw3000local->longFrames == 0)
+            {
+                pdw3000local->cbData.datalength = finfo16 & RX_FINFO_STD_RXFLEN_MASK;
+            }
+            else
+            {
+                pdw3000local->cbData.datalength = finfo16 & RX_FINFO_RXFLEN_BIT_MASK;
+            }
+
+            // Report ranging bit
+            if (finfo16 & RX_FINFO_RNG_BIT_MASK)
+            {
+                pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_RNG;
+            }
+        }
+
+        dwt_write32bitreg(SYS_STATUS_ID, cia_err | SYS_STATUS_ALL_RX_GOOD); // Clear all status bits relating to good reception
+
+        // Copy the frame to the RX event ring if used
+        if (pdw3000local->rxring != NULL)
+        {
+            _dwt_rxring_put();
+        }
+
+        // Continuous receiver: the frame is in the ring, give the buffer back before the callback
+        if (pdw3000local->rxcont)
+        {
+            pdw3000local->rxcont_stats.frames++;
+            dwt_signal_rx_buff_free();
+        }
+
+        // Call the corresponding callback if present
+        if (pdw3000local->cbRxOk != NULL)
+        {
+            DWT_PROBE_START(DWT_PROBE_CB);
+            pdw3000local->cbRxOk(&pdw3000local->cbData);
+            DWT_PROBE_STOP(DWT_PROBE_CB);
+        }
+
+        if (pdw3000local->rxcont)
+        {
+            // The other buffer may have filled meanwhile
+            _dwt_rxcont_drain();
+        }
+        else if (pdw3000local->dblbuffon)   //check if in double buffer mode and if so which buffer host is currently accessing
+        {
+            // Free up the current buffer - let the device know that it can receive into this buffer again
+            dwt_signal_rx_buff_free();
+        }
+
+        // Schedule queue: arm the next event, once the callback has read the frame
+        _dwt_sched_done(DWT_SCHED_WAIT_RX);
+    }
+
+    // RXFCE&~DISFCE|RXPHE|RXFSL|ARFE|RXSTO|RXOVRR. Real errored frame received, so ignore FCE if disabled
+    // Handle RX errors events
+    if (fstat & FINT_STAT_RXERR_BIT_MASK)
+    {
+        // Clear RX error events before the callback - this lets the host renable the receiver inside the callback
+        // (RXOVRR is not part of SYS_STATUS_ALL_RX_ERR but also raises RXERR, so clear it too when set)
+        dwt_write32bitoffsetreg(SYS_STATUS_ID, 0, SYS_STATUS_ALL_RX_ERR | (status & SYS_STATUS_RXOVRR_BIT_MASK)); // Clear RX error event bits
+
+        if (pdw3000local->rxcont)
+        {
+            if (status & SYS_STATUS_RXOVRR_BIT_MASK)
+            {
+                // Both buffers were full: the receiver stopped, restart it from buffer 0
+                pdw3000local->rxcont_stats.overruns++;
+                _dwt_rxcont_restart();
+            }
+            else
+            {
+                pdw3000local->rxcont_stats.errors++;
+            }
+        }
+
+        // Call the corresponding callback if present
+        if (pdw3000local->cbRxErr != NULL)
+        {
+            DWT_PROBE_START(DWT_PROBE_CB);
+            pdw3000local->cbRxErr(&pdw3000local->cbData);
+            DWT_PROBE_STOP(DWT_PROBE_CB);
+        }
+
+        _dwt_sched_done(DWT_SCHED_WAIT_RX);
+    }
+
+    // Handle RX Timeout event (PTO and FWTO)
+    if (fstat & FINT_STAT_RXTO_BIT_MASK)
+    {
+        // Clear RX TO events before the callback - this lets the host renable the receiver inside the callback
+        dwt_write8bitoffsetreg(SYS_STATUS_ID, 2, (uint8_t)(SYS_STATUS_ALL_RX_TO >> 16)); // Clear RX timeout event bits (PTO, RFTO)
+
+        if (pdw3000local->rxcont)
+        {
+            // Timeouts are off in continuous mode, but keep listening if the application set one
+            dwt_rxenable(DWT_START_RX_IMMEDIATE);
+        }
+
+        // Call the corresponding callback if present
+        if (pdw3000local->cbRxTo != NULL)
+        {
+            DWT_PROBE_START(DWT_PROBE_CB);
+            pdw3000local->cbRxTo(&pdw3000local->cbData);
+            DWT_PROBE_STOP(DWT_PROBE_CB);
+        }
+
+        _dwt_sched_done(DWT_SCHED_WAIT_RX);
+    }
+
+    DWT_PROBE_STOP(DWT_PROBE_ISR);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief sets the sleep counter to new value, this function programs the sleep counter top 16-bits [27:12]
- *
- * NOTE: this function needs to be run before dwt_configuresleep
+ * @brief This function copies the frame just reported by dwt_isr() into the next free RX event ring descriptor
  *
  * input parameters
- * @param sleepcnt - this it value of the sleep counter to program
  *
  * output parameters
  *
  * no return value
  */
-void dwt_configuresleepcnt(uint16_t sleepcnt)
+static void _dwt_rxring_put(void)
 {
+    uint16_t head = pdw3000local->rxring_head;
+    dwt_rxring_desc_t *desc;
+    uint16_t len;
 
-    dwt_aon_write(AON_SLPCNT_LO, (uint8_t)(sleepcnt));
-    dwt_aon_write(AON_SLPCNT_HI, (uint8_t)(sleepcnt>>8));
+    if ((uint16_t)(head - pdw3000local->rxring_tail) > pdw3000local->rxring_mask)
+    {
+        pdw3000local->rxring_dropped++;
+        return;
+    }
 
-}
+    desc = &pdw3000local->rxring[head & pdw3000local->rxring_mask];
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @brief calibrates the local oscillator as its frequency can vary between 15 and 34kHz depending on temp and voltage
- *
- * NOTE: this function needs to be run before dwt_configuresleepcnt, so that we know what the counter units are
- *
- * input parameters
- *
- * output parameters
- *
- * returns the number of XTAL cycles per low-power oscillator cycle. LP OSC frequency = 38.4 MHz/return value
- */
-uint16_t dwt_calibratesleepcnt(void)
-{
-    uint16_t temp = 0;
+    desc->status     = pdw3000local->cbData.status;
+    desc->datalength = pdw3000local->cbData.datalength;
+    desc->rx_flags   = pdw3000local->cbData.rx_flags;
 
-    // Enable VDDPLL for reference clock
-    dwt_or8bitoffsetreg(LDO_CTRL_ID, 0, LDO_CTRL_LDO_VDDPLL_EN_BIT_MASK);
-    // Clear any previous cal settings
-    dwt_aon_write(AON_SLPCNT_CAL_CTRL, 0x00);
-    // Run cal
-    dwt_aon_write(AON_SLPCNT_CAL_CTRL, 0x04);
-    deca_sleep(2); //need to wait for at least 1 LP OSC period at slowest frequency of 15kHz =~ 66 us
-    // Read the Cal value from AON
-    temp = dwt_aon_read(AON_SLPCNT_CAL_LO);
-    temp = (temp) | (dwt_aon_read(AON_SLPCNT_CAL_HI) << 8);
-    // Clear cal
-    dwt_aon_write(AON_SLPCNT_CAL_CTRL, 0x00);
-    // Disable VDDPLL for reference clock
-    dwt_and8bitoffsetreg(LDO_CTRL_ID, 0, (uint8_t)~LDO_CTRL_LDO_VDDPLL_EN_BIT_MASK);
-    return (temp);
+    dwt_readrxtimestamp(desc->rx_stamp);
+
+    len = (desc->datalength < DWT_RXRING_DATA_LEN) ? desc->datalength : DWT_RXRING_DATA_LEN;
+    if (len != 0)
+    {
+        dwt_readrxdata(desc->data, len, 0);
+    }
+
+    // Make the descriptor contents visible before publishing it
+    __sync_synchronize();
+    pdw3000local->rxring_head = head + 1;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief configures the device for both DEEP_SLEEP and SLEEP modes, and on-wake mode
- * i.e. before entering the sleep, the device should be programmed for TX or RX, then upon "waking up" the TX/RX settings
- * will be preserved and the device can immediately perform the desired action TX/RX
- *
- * NOTE: e.g. Tag operation - after deep sleep, the device needs to just load the TX buffer and send the frame
- *
- *
- *      mode:
- *      DWT_PGFCAL       0x0800
- *      DWT_GOTORX       0x0200
- *      DWT_GOTOIDLE     0x0100
- *      DWT_SEL_OPS      0x0040 | 0x0080
- *      DWT_LOADOPS      0x0020
- *      DWT_LOADLDO      0x0010
- *      DWT_LOADDGC      0x0008
- *      DWT_LOADBIAS     0x0004
- *      DWT_RUNSAR       0x0002
- *      DWT_CONFIG       0x0001 - download the AON array into the HIF (configuration download)
- *
- *      wake: wake up parameters
- *      DWT_SLP_CNT_RPT  0x40 - sleep counter loop after expiration
- *      DWT_PRESRVE_SLP  0x20 - allows for SLEEP_EN bit to be "preserved", although it will self-clear on wake up
- *      DWT_WAKE_WK      0x10 - wake up on WAKEUP PIN
- *      DWT_WAKE_CS      0x8 - wake up on chip select
- *      DWT_BR_DET       0x4 - enable brownout detector during sleep/deep sleep
- *      DWT_SLEEP        0x2 - enable sleep
- *      DWT_SLP_EN       0x1 - enable sleep/deep sleep functionality
+ * @brief This function takes the frame in the buffer the host accesses next, if the device has already filled it,
+ * while the continuous receiver runs: it is put in the RX event ring, the buffer is handed back and cbRxOk called
  *
  * input parameters
- * @param mode - config on-wake parameters
- * @param wake - config wake up parameters
  *
  * output parameters
  *
  * no return value
  */
-void dwt_configuresleep(uint16_t mode, uint8_t wake)
+static void _dwt_rxcont_drain(void)
 {
-    // Add predefined sleep settings before writing the mode
-    pdw3000local->sleep_mode |= mode;
-    dwt_write16bitoffsetreg(AON_DIG_CFG_ID, 0,  pdw3000local->sleep_mode);
+    uint8_t statusDB = dwt_read8bitoffsetreg(RDB_STATUS_ID, 0);
+    uint16_t finfo16;
 
-    dwt_write8bitoffsetreg(ANA_CFG_ID, 0, wake); //bit 0 - SLEEP_EN, bit 1 - DEEP_SLEEP=0/SLEEP=1, bit 3 wake on CS
-}
+    if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)
+    {
+        statusDB >>= 4;
+    }
+    if (!(statusDB & RDB_STATUS_RXFCG0_BIT_MASK))
+    {
+        return;
+    }
 
-/*! ------------------------------------------------------------------------------------------------------------------
-* @brief this function clears the AON configuration in DW3000
-*
-* input parameters:
-*
-* output parameters
-*
-* no return value
-*/
-void dwt_clearaonconfig(void)
-{
-    // Clear any AON auto download bits (as reset will trigger AON download)
-    dwt_write16bitoffsetreg(AON_DIG_CFG_ID, 0, 0x00);
-    // Clear the wake-up configuration
-    dwt_write8bitoffsetreg(ANA_CFG_ID, 0, 0x00);
-    // Upload the new configuration
-    // Copy config to AON - upload the new configuration
-    dwt_write8bitoffsetreg(AON_CTRL_ID, 0, 0);
-    dwt_write8bitoffsetreg(AON_CTRL_ID, 0, AON_CTRL_ARRAY_SAVE_BIT_MASK);
-}
+    pdw3000local->cbData.status = SYS_STATUS_RXFR_BIT_MASK | SYS_STATUS_RXFCG_BIT_MASK;
+    pdw3000local->cbData.rx_flags = 0;
+    if (statusDB & RDB_STATUS_CIADONE0_BIT_MASK)
+    {
+        pdw3000local->cbData.status |= SYS_STATUS_CIADONE_BIT_MASK;
+        pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_CIA;
+    }
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @brief sets the auto TX to sleep bit. This means that after a frame
- * transmission the device will enter deep sleep mode. The dwt_configuresleep() function
- * needs to be called before this to configure the on-wake settings
- *
- * NOTE: the IRQ line has to be low/inactive (i.e. no pending events)
- *
- * input parameters
- * @param enable - 1 to configure the device to enter deep sleep after TX, 0 - disables the configuration
- *
- * output parameters
- *
- * no return value
- */
-void dwt_entersleepaftertx(int enable)
-{
-    // Set the auto TX -> sleep bit
-    if(enable)
+    if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)
     {
-        dwt_or16bitoffsetreg(SEQ_CTRL_ID, 0, SEQ_CTRL_ATX2SLP_BIT_MASK);
+        dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF1_EVENTS);
+        finfo16 = dwt_read16bitoffsetreg(INDIRECT_POINTER_B_ID, 0);
     }
     else
     {
-        dwt_and16bitoffsetreg(SEQ_CTRL_ID, 0, (uint16_t)~SEQ_CTRL_ATX2SLP_BIT_MASK);
+        dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF0_EVENTS);
+        finfo16 = dwt_read16bitoffsetreg(BUF0_RX_FINFO, 0);
     }
-}
-
-/*! ------------------------------------------------------------------------------------------------------------------
- * @brief this reads the device ID and checks if it is the right one
- *
- * input parameters
- * None
- *
- * output parameters
- *
- * returns DWT_SUCCESS for success, or DWT_ERROR for error
- */
-int dwt_check_dev_id(void)
-{
-    uint32_t  dev_id;
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_GOOD);
 
-    dev_id = dwt_readdevid();
+    pdw3000local->cbData.datalength = finfo16 & ((pdw3000local->longFrames == 0) ? RX_FINFO_STD_RXFLEN_MASK : RX_FINFO_RXFLEN_BIT_MASK);
+    if (finfo16 & RX_FINFO_RNG_BIT_MASK)
+    {
+        pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_RNG;
+    }
 
-    LOG_INF("dev_id \"%08x\"", dev_id);
+    if (pdw3000local->rxring != NULL)
+    {
+        _dwt_rxring_put();
+    }
+    pdw3000local->rxcont_stats.frames++;
+    dwt_signal_rx_buff_free();
 
-    if (!((DWT_C0_PDOA_DEV_ID == dev_id) || (DWT_C0_DEV_ID == dev_id)))
+    if (pdw3000local->cbRxOk != NULL)
     {
-        return DWT_ERROR;
+        DWT_PROBE_START(DWT_PROBE_CB);
+        pdw3000local->cbRxOk(&pdw3000local->cbData);
+        DWT_PROBE_STOP(DWT_PROBE_CB);
     }
-    return DWT_SUCCESS;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief this function enables CIA diagnostic data. When turned on the following registers will be logged:
- * IP_TOA_LO, IP_TOA_HI, STS_TOA_LO, STS_TOA_HI, STS1_TOA_LO, STS1_TOA_HI, CIA_TDOA_0, CIA_TDOA_1_PDOA, CIA_DIAG_0, CIA_DIAG_1
+ * @brief This function restarts the continuous receiver after an overrun: the receiver is turned off, the double
+ * buffer state is reset so the device and the host both start again from RX_BUFFER_0, and the receiver re-enabled
  *
  * input parameters
- * @param enable_mask :     DW_CIA_DIAG_LOG_MAX (0x8)   //CIA to copy to swinging set a maximum set of diagnostic registers in Double Buffer mode
- *                          DW_CIA_DIAG_LOG_MID (0x4)   //CIA to copy to swinging set a medium set of diagnostic registers in Double Buffer mode
- *                          DW_CIA_DIAG_LOG_MIN (0x2)   //CIA to copy to swinging set a minimal set of diagnostic registers in Double Buffer mode
- *                          DW_CIA_DIAG_LOG_ALL (0x1)   //CIA to log all diagnostic registers
- *                          DW_CIA_DIAG_LOG_MIN (0x0)   //CIA to log reduced set of diagnostic registers
  *
  * output parameters
  *
  * no return value
  */
-void dwt_configciadiag(uint8_t enable_mask)
-{
-    if(enable_mask & DW_CIA_DIAG_LOG_ALL)
-    {
-        dwt_and8bitoffsetreg(CIA_CONF_ID, 2, ~(CIA_DIAGNOSTIC_OFF));
-    }
-    else
-    {
-        dwt_or8bitoffsetreg(CIA_CONF_ID, 2, CIA_DIAGNOSTIC_OFF);
-    }
-
-    dwt_write8bitoffsetreg(RDB_DIAG_MODE_ID, 0, enable_mask >> 1);
-
-    pdw3000local->cia_diagnostic = enable_mask;
+static void _dwt_rxcont_restart(void)
+{
+    dwt_forcetrxoff();
+    dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF0_EVENTS | RDB_STATUS_CLEAR_BUFF1_EVENTS);
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_RXOVRR_BIT_MASK);
+    dwt_setdblrxbuffmode(DBL_BUF_STATE_DIS, DBL_BUF_MODE_AUTO);
+    dwt_setdblrxbuffmode(DBL_BUF_STATE_EN, DBL_BUF_MODE_AUTO);
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This call enables the auto-ACK feature. If the responseDelayTime (parameter) is 0, the ACK will be sent a.s.a.p.
- * otherwise it will be sent with a programmed delay (in symbols), max is 255.
- * NOTE: needs to have frame filtering enabled as well
+ * @brief This function starts the continuous double-buffered receiver, see dwt_rxcont_start() in deca_device_api.h
  *
  * input parameters
- * @param responseDelayTime - if non-zero the ACK is sent after this delay, max is 255.
- * @param enable - enables or disables the auto-ACK feature
+ * @param descs - RX event ring descriptors
+ * @param count - number of descriptors, must be a power of 2
  *
  * output parameters
  *
- * no return value
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
  */
-void dwt_enableautoack(uint8_t responseDelayTime, int enable)
+int dwt_rxcont_start(dwt_rxring_desc_t *descs, uint16_t count)
 {
-    // Set auto ACK reply delay
-    dwt_write8bitoffsetreg(ACK_RESP_ID, 3, responseDelayTime); // In symbols
+    if (descs == NULL)
+    {
+        return DWT_ERROR;
+    }
 
-    // Enable AUTO ACK
-    if (enable)
+    pdw3000local->rxcont = 0;
+    dwt_forcetrxoff();
+
+    if (dwt_rxring_init(descs, count) != DWT_SUCCESS)
     {
-        dwt_or32bitoffsetreg(SYS_CFG_ID, 0, SYS_CFG_AUTO_ACK_BIT_MASK | SYS_CFG_FAST_AAT_EN_BIT_MASK); //set the AUTO_ACK bit
+        return DWT_ERROR;
     }
-    else
+    memset(&pdw3000local->rxcont_stats, 0, sizeof(pdw3000local->rxcont_stats));
+
+    dwt_setrxtimeout(0);
+    dwt_setpreambledetecttimeout(0);
+
+    dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF0_EVENTS | RDB_STATUS_CLEAR_BUFF1_EVENTS);
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_ALL_RX_TO | SYS_STATUS_RXOVRR_BIT_MASK);
+    dwt_setdblrxbuffmode(DBL_BUF_STATE_EN, DBL_BUF_MODE_AUTO);
+    dwt_setinterrupt(DWT_INT_RFCG | DWT_INT_RPHE | DWT_INT_RFCE | DWT_INT_RFSL | DWT_INT_SFDT | DWT_INT_ARFE | DWT_INT_RXOVRR, 0, DWT_ENABLE_INT);
+
+    pdw3000local->rxcont = 1;
+
+    if (dwt_rxenable(DWT_START_RX_IMMEDIATE) != DWT_SUCCESS)
     {
-        dwt_and16bitoffsetreg(SYS_CFG_ID, 0, (uint16_t)(~SYS_CFG_AUTO_ACK_BIT_MASK)); //clear the AUTO_ACK bit
+        dwt_rxcont_stop();
+        return DWT_ERROR;
     }
+
+    return DWT_SUCCESS;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This API sends issues a command to the device that the specific RX buff is free for frame reception,
- * it will also update the dblbuffon flag/status to the next buffer
+ * @brief This function stops the continuous double-buffered receiver
  *
  * input parameters
- * @param None
  *
  * output parameters
  *
  * no return value
  */
-void dwt_signal_rx_buff_free(void)
+void dwt_rxcont_stop(void)
 {
-    dwt_writefastCMD(CMD_DB_TOGGLE);
-
-    //update the status
-    if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)
-    {
-        pdw3000local->dblbuffon = DBL_BUFF_ACCESS_BUFFER_0;  //next buffer is RX_BUFFER_0
-    }
-    else
-    {
-        pdw3000local->dblbuffon = DBL_BUFF_ACCESS_BUFFER_1;  //next buffer is RX_BUFFER_1
-    }
+    pdw3000local->rxcont = 0;
+    dwt_forcetrxoff();
+    dwt_setdblrxbuffmode(DBL_BUF_STATE_DIS, DBL_BUF_MODE_MAN);
+    dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF0_EVENTS | RDB_STATUS_CLEAR_BUFF1_EVENTS);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This call enables the double receive buffer mode
+ * @brief This function reads the continuous receiver counters
  *
  * input parameters
- * @param dbl_buff_state - enum variable for enabling/disabling double buffering mode
- * @param dbl_buff_mode - enum variable for Receiver Auto-Re-enable
  *
  * output parameters
+ * @param stats - counters
  *
  * no return value
  */
-void dwt_setdblrxbuffmode(dwt_dbl_buff_state_e dbl_buff_state, dwt_dbl_buff_mode_e dbl_buff_mode)
+void dwt_rxcont_get_stats(dwt_rxcont_stats_t *stats)
 {
-    uint32_t  or_val=0,and_val=-1;
-
-    if (dbl_buff_state==DBL_BUF_STATE_EN)
-    {
-        and_val= ~(SYS_CFG_DIS_DRXB_BIT_MASK);
-        pdw3000local->dblbuffon = DBL_BUFF_ACCESS_BUFFER_0;    //the host will access RX_BUFFER_0 initially (on 1st reception after enable)
-        //Updating indirect address here to save time setting it inside the interrupt(in order to read BUF1_RX_FINFO)..
-        //Pay attention that after sleep, this register needs to be set again.
-        dwt_write32bitreg(INDIRECT_ADDR_B_ID, (BUF1_RX_FINFO >> 16));
-        dwt_write32bitreg(ADDR_OFFSET_B_ID, BUF1_RX_FINFO & 0xffff);
-    }
-    else
-    {
-        or_val = SYS_CFG_DIS_DRXB_BIT_MASK;
-        pdw3000local->dblbuffon = DBL_BUFF_OFF;
-    }
+    *stats = pdw3000local->rxcont_stats;
+    stats->dropped = pdw3000local->rxring_dropped;
+}
 
-    if (dbl_buff_mode == DBL_BUF_MODE_AUTO)
-    {
-        or_val |= SYS_CFG_RXAUTR_BIT_MASK;
-    }
-    else
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function sets up the RX event ring, see dwt_rxring_init() in deca_device_api.h
+ *
+ * input parameters
+ * @param descs - descriptor storage provided by the application, or NULL to disable the ring
+ * @param count - number of descriptors, must be a power of 2
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+int dwt_rxring_init(dwt_rxring_desc_t *descs, uint16_t count)
+{
+    if ((descs != NULL) && ((count == 0) || ((count & (count - 1)) != 0)))
     {
-        and_val &= (~SYS_CFG_RXAUTR_BIT_MASK); //Clear the needed bit
+        return DWT_ERROR;
     }
 
-    dwt_and_or32bitoffsetreg(SYS_CFG_ID,0, and_val, or_val);
+    pdw3000local->rxring = NULL;
+    __sync_synchronize();
+
+    pdw3000local->rxring_mask = count - 1;
+    pdw3000local->rxring_head = 0;
+    pdw3000local->rxring_tail = 0;
+    pdw3000local->rxring_dropped = 0;
+
+    __sync_synchronize();
+    pdw3000local->rxring = descs;
+
+    return DWT_SUCCESS;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This sets the receiver turn on delay time after a transmission of a frame
+ * @brief This function returns the filled descriptors at the head of the RX event ring without removing them
  *
  * input parameters
- * @param rxDelayTime - (20 bits) - the delay is in UWB microseconds
  *
  * output parameters
+ * @param desc - set to the oldest filled descriptor
  *
- * no return value
+ * returns the number of filled descriptors contiguous from *desc (0 if the ring is empty)
  */
-void dwt_setrxaftertxdelay(uint32_t rxDelayTime)
+uint16_t dwt_rxring_peek(dwt_rxring_desc_t **desc)
 {
-    uint32_t val = dwt_read32bitreg(ACK_RESP_ID); // Read ACK_RESP_T_ID register
+    uint16_t tail = pdw3000local->rxring_tail;
+    uint16_t avail;
+    uint16_t to_end;
 
-    val &= (~ACK_RESP_W4R_TIM_BIT_MASK); // Clear the timer (19:0)
+    if (pdw3000local->rxring == NULL)
+    {
+        return 0;
+    }
 
-    val |= (rxDelayTime & ACK_RESP_W4R_TIM_BIT_MASK); // In UWB microseconds (e.g. turn the receiver on 20uus after TX)
+    avail = (uint16_t)(pdw3000local->rxring_head - tail);
+    // Read the descriptors only after seeing the head
+    __sync_synchronize();
 
-    dwt_write32bitoffsetreg(ACK_RESP_ID, 0, val);
+    to_end = (pdw3000local->rxring_mask + 1) - (tail & pdw3000local->rxring_mask);
+
+    *desc = &pdw3000local->rxring[tail & pdw3000local->rxring_mask];
+
+    return (avail < to_end) ? avail : to_end;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This function is used to register the different callbacks called when one of the corresponding event occurs.
- *
- * NOTE: Callbacks can be undefined (set to NULL). In this case, dwt_isr() will process the event as usual but the 'null'
- * callback will not be called.
+ * @brief This function releases descriptors returned by dwt_rxring_peek() back to dwt_isr()
  *
  * input parameters
- * @param cbTxDone - the pointer to the TX confirmation event callback function
- * @param cbRxOk - the pointer to the RX good frame event callback function
- * @param cbRxTo - the pointer to the RX timeout events callback function
- * @param cbRxErr - the pointer to the RX error events callback function
- * @param cbSPIErr - the pointer to the SPI error events callback function
- * @param cbSPIRdy - the pointer to the SPI ready events callback function
+ * @param n - number of descriptors to release
  *
  * output parameters
  *
  * no return value
  */
-void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr, dwt_cb_t cbSPIErr, dwt_cb_t cbSPIRdy)
+void dwt_rxring_consume(uint16_t n)
 {
-    pdw3000local->cbTxDone = cbTxDone;
-    pdw3000local->cbRxOk = cbRxOk;
-    pdw3000local->cbRxTo = cbRxTo;
-    pdw3000local->cbRxErr = cbRxErr;
-    pdw3000local->cbSPIErr = cbSPIErr;
-    pdw3000local->cbSPIRdy = cbSPIRdy;
+    // Finish with the descriptors before handing them back
+    __sync_synchronize();
+    pdw3000local->rxring_tail += n;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This function checks if the IRQ line is active - this is used instead of interrupt handler
+ * @brief This function returns the number of good frames not put in the RX event ring as it was full
  *
  * input parameters
  *
  * output parameters
  *
- * return value is 1 if the IRQS bit is set and 0 otherwise
+ * returns the dropped frame count
  */
-uint8_t dwt_checkirq(void)
+uint32_t dwt_rxring_dropped(void)
 {
-    /* Reading the lower byte only is enough for this operation */
-    return (dwt_read8bitoffsetreg(SYS_STATUS_ID, 0) & SYS_STATUS_IRQS_BIT_MASK);
+    return pdw3000local->rxring_dropped;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This function checks if the DW3000 is in IDLE_RC state
+ * @brief This function sets up the schedule queue, see dwt_sched_init() in deca_device_api.h
  *
  * input parameters
+ * @param events - event storage provided by the application, or NULL to disable the queue
+ * @param count - number of events, must be a power of 2
+ * @param min_slack_uus - an event armed less than this ahead of its time is skipped as late
+ * @param cbLate - late event call-back, may be NULL
  *
  * output parameters
  *
- * return value is 1 if the IDLE_RC bit is set and 0 otherwise
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
  */
-uint8_t dwt_checkidlerc(void)
+int dwt_sched_init(dwt_sched_event_t *events, uint16_t count, uint16_t min_slack_uus, dwt_sched_late_cb_t cbLate)
 {
-    /* Wait 2 ms for DW IC to get into IDLE_RC state */
-    //deca_sleep(2);
+    if ((events != NULL) && ((count == 0) || ((count & (count - 1)) != 0)))
+    {
+        return DWT_ERROR;
+    }
 
-    /* Poll DW IC until IDLE_RC event set.
-     * This means that DW IC is in IDLE_RC state and ready */
-    uint32_t reg = ((uint32_t)dwt_read16bitoffsetreg(SYS_STATUS_ID, 2) << 16);
+    DWT_SCHED_LOCK();
+    pdw3000local->sched = NULL;
+    pdw3000local->sched_mask = count - 1;
+    pdw3000local->sched_head = 0;
+    pdw3000local->sched_tail = 0;
+    pdw3000local->sched_armed = DWT_SCHED_NONE;
+    pdw3000local->sched_min_slack = (int32_t)(((uint64_t)min_slack_uus * DWT_UUS_TO_TIME) >> 8);
+    pdw3000local->cbSchedLate = cbLate;
+    memset(&pdw3000local->sched_stats, 0, sizeof(pdw3000local->sched_stats));
+    pdw3000local->sched_stats.min_slack_uus = UINT32_MAX;
+    pdw3000local->sched = events;
+    DWT_SCHED_UNLOCK();
 
-    return ( (reg & (SYS_STATUS_RCINIT_BIT_MASK)) == (SYS_STATUS_RCINIT_BIT_MASK));
+    return DWT_SUCCESS;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is the DW3000's general Interrupt Service Routine. It will process/report the following events:
- *          - RXFR + no data mode (through cbRxOk callback, but set datalength to 0)
- *          - RXFCG (through cbRxOk callback)
- *          - TXFRS (through cbTxDone callback)
- *          - RXRFTO/RXPTO (through cbRxTo callback)
- *          - RXPHE/RXFCE/RXRFSL/RXSFDTO/AFFREJ/LDEERR/LCSSERR (through cbRxTo cbRxErr)
- *          -
- *        For all events, corresponding interrupts are cleared and necessary resets are performed. In addition, in the RXFCG case,
- *        received frame information and frame control are read before calling the callback. If double buffering is activated, it
- *        will also toggle between reception buffers once the reception callback processing has ended.
+ * @brief This function counts an event armed with the given slack
  *
- *        /!\ This version of the ISR supports double buffering but does not support automatic RX re-enabling!
- *
- * NOTE:  In PC based system using (Cheetah or ARM) USB to SPI converter there can be no interrupts, however we still need something
- *        to take the place of it and operate in a polled way. In an embedded system this function should be configured to be triggered
- *        on any of the interrupts described above.
-
  * input parameters
+ * @param slack - time from arming to the event, in units of 256 device time units (high 32 bits of the system time)
  *
  * output parameters
  *
  * no return value
  */
-
-
-void dwt_isr(void)
+static void _dwt_sched_count(int32_t slack)
 {
-    //Read Fast Status register
-    uint8_t fstat = dwt_read8bitoffsetreg(FINT_STAT_ID, 0);
-    uint32_t status = dwt_read32bitreg(SYS_STATUS_ID); // Read status register low 32bits
+    dwt_sched_stats_t *stats = &pdw3000local->sched_stats;
+    uint32_t slack_uus = (uint32_t)(((uint64_t)slack << 8) / DWT_UUS_TO_TIME);
+    uint32_t edge = DWT_SCHED_HIST_BASE_UUS;
+    uint8_t bin = 0;
 
-    pdw3000local->cbData.status = status;
-    if ((pdw3000local->stsconfig & DWT_STS_MODE_ND) == DWT_STS_MODE_ND) //cannot use FSTAT when in no data mode...
-    {
-        if (status & SYS_STATUS_RXFR_BIT_MASK)
-        {
-            fstat |= FINT_STAT_RXOK_BIT_MASK;
-        }
-    }
-    // Handle System panic confirmation event
-    // AES_ERR|SPICRCERR|BRNOUT|SPI_UNF|SPI_OVR|CMD_ERR|SPI_COLLISION|PLLHILO
-    if (fstat & FINT_STAT_SYS_PANIC_BIT_MASK)
+    while ((bin < (DWT_SCHED_HIST_BINS - 1)) && (slack_uus >= edge))
     {
-        pdw3000local->cbData.status_hi = dwt_read16bitoffsetreg(SYS_STATUS_HI_ID, 0);
-
-        // Handle SPI CRC error event, which was due to an SPI write CRC error
-        // Handle SPI error events (if this has happened, the last SPI transaction has not completed correctly, the device should be reset)
-        if ((pdw3000local->spicrc && (pdw3000local->cbData.status & SYS_STATUS_SPICRCE_BIT_MASK)) ||
-                (pdw3000local->cbData.status_hi & (SYS_STATUS_HI_SPIERR_BIT_MASK | SYS_STATUS_HI_SPI_UNF_BIT_MASK | SYS_STATUS_HI_SPI_OVF_BIT_MASK)))
-        {
-            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_SPICRCE_BIT_MASK);
-            dwt_write16bitoffsetreg(SYS_STATUS_HI_ID, 0, (SYS_STATUS_HI_SPIERR_BIT_MASK | SYS_STATUS_HI_SPI_UNF_BIT_MASK | SYS_STATUS_HI_SPI_OVF_BIT_MASK)); // Clear SPI error event bits
-            // Call the corresponding callback if present
-            if (pdw3000local->cbSPIErr != NULL)
-            {
-                pdw3000local->cbSPIErr(&pdw3000local->cbData);
-            }
-        }
-
-        // Handle Fast CMD errors event, the means the last CMD did not execute (e.g. it was given while device was already executing previous)
-        if (pdw3000local->cbData.status_hi & SYS_STATUS_HI_CMD_ERR_BIT_MASK)
-        {
-            dwt_write16bitoffsetreg(SYS_STATUS_HI_ID, 0, SYS_STATUS_HI_CMD_ERR_BIT_MASK); // Clear CMD error event bit
-            // Call the corresponding callback if present
-            /*if(pdw3000local->cbCMDErr != NULL)
-            {
-                pdw3000local->cbCMDErr(&pdw3000local->cbData);
-            }*/
-        }
-
-        //AES_ERR, BRNOUT, PLLHILO not handled here ...
+        bin++;
+        edge <<= 1;
     }
 
-    // Handle TX frme sent confirmation event
-    if (fstat & FINT_STAT_TXOK_BIT_MASK)
+    stats->armed++;
+    stats->hist[bin]++;
+    if (slack_uus < stats->min_slack_uus)
     {
-        // Clear TX events after the callback - this lets the host schedule another TX/RX inside the callback
-        dwt_write8bitoffsetreg(SYS_STATUS_ID, 0, (uint8_t)SYS_STATUS_ALL_TX); // Clear TX event bits to clear the interrupt
-
-        // Call the corresponding callback if present
-        if (pdw3000local->cbTxDone != NULL)
-        {
-            pdw3000local->cbTxDone(&pdw3000local->cbData);
-        }
+        stats->min_slack_uus = slack_uus;
     }
+}
 
-    // SPI ready and IDLE_RC bit gets set when device powers on, or on wake up
-    if (fstat & FINT_STAT_SYS_EVENT_BIT_MASK)
-    {
-        //pdw3000local->cbData.status_hi = dwt_read16bitreg(SYS_STATUS_HI_ID);
-
-        // Call the corresponding callback if present
-        if (pdw3000local->cbSPIRdy != NULL)
-        {
-            pdw3000local->cbSPIRdy(&pdw3000local->cbData);
-        }
-        // Clear SPI RDY events after the callback - this lets the host read the SYS_STATUS register inside the callback
-        dwt_write16bitoffsetreg(SYS_STATUS_ID, 2, (uint16_t)((SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK) >> 16)); // Clear the bit to clear the interrupt
-
-        //VTDET, GPIO, not handled here ...
-    }
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function arms the next event of the schedule queue in time, skipping (and reporting) the late ones,
+ *        when no event is armed
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_sched_arm(void)
+{
+    dwt_sched_event_t *ev;
+    uint32_t dx_time;
+    int32_t slack;
+    int ret;
 
-    // Handle RX ok events
-    if (fstat & FINT_STAT_RXOK_BIT_MASK)
+    while ((pdw3000local->sched_armed == DWT_SCHED_NONE) && (pdw3000local->sched_tail != pdw3000local->sched_head))
     {
-        uint32_t cia_err = 0;
+        ev = &pdw3000local->sched[pdw3000local->sched_tail & pdw3000local->sched_mask];
+        pdw3000local->sched_tail++;
 
-        pdw3000local->cbData.rx_flags = 0;
+        // Wrap-safe on the 32 bit high part of the 40 bit device time
+        dx_time = (uint32_t)(ev->time >> 8);
+        slack = (int32_t)(dx_time - dwt_readsystimestamphi32());
 
-        if (pdw3000local->dblbuffon) // if in double buffer mode
+        ret = DWT_ERROR;
+        if (slack >= pdw3000local->sched_min_slack)
         {
-            uint8_t statusDB = dwt_read8bitoffsetreg(RDB_STATUS_ID,0);
-
-            if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1) //If accessing the second buffer (RX_BUFFER_B then read second nibble of the DB status reg)
+            dwt_setdelayedtrxtime(dx_time);
+            if ((ev->type == DWT_SCHED_RX) || (ev->mode & DWT_RESPONSE_EXPECTED))
             {
-                statusDB >>= 4;
+                dwt_setrxtimeout(ev->rx_timeout);
+            }
+            if (ev->type == DWT_SCHED_RX)
+            {
+                ret = dwt_rxenable(DWT_START_RX_DELAYED | DWT_IDLE_ON_DLY_ERR);
+            }
+            else
+            {
+                dwt_writetxfctrl(ev->tx_len, ev->tx_offset, ev->ranging);
+                ret = dwt_starttx(DWT_START_TX_DELAYED | (ev->mode & DWT_RESPONSE_EXPECTED));
             }
-            //setting the relevant bits in the main status register according to DB status register
-            if (statusDB & RDB_STATUS_RXFCG0_BIT_MASK)
-                status |= SYS_STATUS_RXFCG_BIT_MASK;
-            if (statusDB & RDB_STATUS_RXFR0_BIT_MASK)
-                status |= SYS_STATUS_RXFR_BIT_MASK;
-            if (statusDB & RDB_STATUS_CIADONE0_BIT_MASK)
-                status |= SYS_STATUS_CIADONE_BIT_MASK;
         }
 
-        //update the status based on the DB RX events
-        pdw3000local->cbData.status = status;
-        //clear LDE error (as we do not want to go back into cbRxErr)
-        if (status & SYS_STATUS_CIAERR_BIT_MASK)
+        if (ret == DWT_SUCCESS)
         {
-            pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_CER;
-            cia_err = SYS_STATUS_CIAERR_BIT_MASK;
+            _dwt_sched_count(slack);
+            pdw3000local->sched_armed = ((ev->type == DWT_SCHED_RX) || (ev->mode & DWT_RESPONSE_EXPECTED)) ?
+                    DWT_SCHED_WAIT_RX : DWT_SCHED_WAIT_TX;
         }
         else
         {
-            if (status & SYS_STATUS_CIADONE_BIT_MASK)
+            pdw3000local->sched_stats.late++;
+            if (pdw3000local->cbSchedLate != NULL)
             {
-                pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_CIA;
+                pdw3000local->cbSchedLate(ev);
             }
         }
+    }
+}
 
-        if (status & SYS_STATUS_CPERR_BIT_MASK)
-        {
-            pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_CPER;
-            cia_err |= SYS_STATUS_CPERR_BIT_MASK;
-        }
-
-        // When using No Data STS mode we do not get RXFCG but RXFR
-        if ((status & SYS_STATUS_RXFR_BIT_MASK) && ((pdw3000local->stsconfig & DWT_STS_MODE_ND) == DWT_STS_MODE_ND))
-        {
-            pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_ND;
-            pdw3000local->cbData.datalength = 0;
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function is called by dwt_isr() when the device is done with an event: the next one is armed
+ *
+ * input parameters
+ * @param wait - DWT_SCHED_WAIT_TX (TX frame sent) or DWT_SCHED_WAIT_RX (RX frame, error or timeout)
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_sched_done(uint8_t wait)
+{
+    if ((pdw3000local->sched != NULL) && (pdw3000local->sched_armed == wait))
+    {
+        pdw3000local->sched_armed = DWT_SCHED_NONE;
+        _dwt_sched_arm();
+    }
+}
 
-            cia_err |= SYS_STATUS_RXFCE_BIT_MASK; // Clear FCE
-        }
-        else
-        // Handle RX good frame event
-        if (status & SYS_STATUS_RXFCG_BIT_MASK)
-        {
-            uint16_t finfo16;
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function adds an event to the schedule queue, see dwt_sched_add() in deca_device_api.h
+ *
+ * input parameters
+ * @param event - event, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the queue is not set up, full, or the event is before the last one
+ */
+int dwt_sched_add(const dwt_sched_event_t *event)
+{
+    uint16_t head;
+    int ret = DWT_ERROR;
 
-            // Read frame info - Only the first two bytes of the register are used here.
-            switch (pdw3000local->dblbuffon)  //check if in double buffer mode and if so which buffer host is currently accessing
-            {
-            case DBL_BUFF_ACCESS_BUFFER_1: //accessing frame info relating to the second buffer (RX_BUFFER_1)
-                dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF1_EVENTS);  //clear DB status register bits corresponding to RX_BUFFER_1
-                finfo16 = dwt_read16bitoffsetreg(INDIRECT_POINTER_B_ID, 0);
-                break;
-            case DBL_BUFF_ACCESS_BUFFER_0: //accessing frame info relating to the first buffer (RX_BUFFER_0)
-                dwt_write8bitoffsetreg(RDB_STATUS_ID, 0, RDB_STATUS_CLEAR_BUFF0_EVENTS);  //clear DB status register bits corresponding to RX_BUFFER_0
-                finfo16 = dwt_read16bitoffsetreg(BUF0_RX_FINFO, 0);
-                break;
-            default: //accessing frame info relating to the second buffer (RX_BUFFER_0) (single buffer mode)
-                finfo16 = dwt_read16bitoffsetreg(RX_FINFO_ID, 0);
-                break;
-            }
+    // dwt_isr() moves the tail and arms the next event: not while the queue is updated and armed here
+    DWT_SCHED_LOCK();
+    head = pdw3000local->sched_head;
 
-            // Report frame length - Standard frame length up to 127, extended frame length up to 1023 bytes
-            if (pdw3000local->longFrames == 0)
-            {
-                pdw3000local->cbData.datalength = finfo16 & RX_FINFO_STD_RXFLEN_MASK;
-            }
-            else
-            {
-                pdw3000local->cbData.datalength = finfo16 & RX_FINFO_RXFLEN_BIT_MASK;
-            }
+    if (pdw3000local->sched == NULL)
+    {
+        // not set up
+    }
+    else if ((uint16_t)(head - pdw3000local->sched_tail) > pdw3000local->sched_mask)
+    {
+        pdw3000local->sched_stats.dropped++;
+    }
+    else if (((head != pdw3000local->sched_tail) || (pdw3000local->sched_armed != DWT_SCHED_NONE)) &&
+            (DWT_TIME_DIFF(event->time, pdw3000local->sched_last) < 0))
+    {
+        // before the last event
+    }
+    else
+    {
+        pdw3000local->sched[head & pdw3000local->sched_mask] = *event;
+        pdw3000local->sched_last = event->time;
+        pdw3000local->sched_head = head + 1;
 
-            // Report ranging bit
-            if (finfo16 & RX_FINFO_RNG_BIT_MASK)
-            {
-                pdw3000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_RNG;
-            }
-        }
+        _dwt_sched_arm();
+        ret = DWT_SUCCESS;
+    }
 
-        dwt_write32bitreg(SYS_STATUS_ID, cia_err | SYS_STATUS_ALL_RX_GOOD); // Clear all status bits relating to good reception
+    DWT_SCHED_UNLOCK();
 
-        // Call the corresponding callback if present
-        if (pdw3000local->cbRxOk != NULL)
-        {
-            pdw3000local->cbRxOk(&pdw3000local->cbData);
-        }
+    return ret;
+}
 
-        if (pdw3000local->dblbuffon)   //check if in double buffer mode and if so which buffer host is currently accessing
-        {
-            // Free up the current buffer - let the device know that it can receive into this buffer again
-            dwt_signal_rx_buff_free();
-        }
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function empties the schedule queue, see dwt_sched_flush() in deca_device_api.h
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_sched_flush(void)
+{
+    DWT_SCHED_LOCK();
+    if (pdw3000local->sched_armed != DWT_SCHED_NONE)
+    {
+        dwt_forcetrxoff();
+        pdw3000local->sched_armed = DWT_SCHED_NONE;
     }
+    pdw3000local->sched_tail = pdw3000local->sched_head;
+    DWT_SCHED_UNLOCK();
+}
 
-    // RXFCE&~DISFCE|RXPHE|RXFSL|ARFE|RXSTO|RXOVRR. Real errored frame received, so ignore FCE if disabled
-    // Handle RX errors events
-    if (fstat & FINT_STAT_RXERR_BIT_MASK)
-    {
-        // Clear RX error events before the callback - this lets the host renable the receiver inside the callback
-        dwt_write32bitoffsetreg(SYS_STATUS_ID, 0, SYS_STATUS_ALL_RX_ERR); // Clear RX error event bits
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function returns the number of events queued, the armed one included
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the number of events
+ */
+uint16_t dwt_sched_pending(void)
+{
+    return (uint16_t)(pdw3000local->sched_head - pdw3000local->sched_tail) + (pdw3000local->sched_armed != DWT_SCHED_NONE);
+}
 
-        // Call the corresponding callback if present
-        if (pdw3000local->cbRxErr != NULL)
-        {
-            pdw3000local->cbRxErr(&pdw3000local->cbData);
-        }
-    }
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function reads the schedule queue counters, cleared by dwt_sched_init()
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters
+ *
+ * no return value
+ */
+void dwt_sched_get_stats(dwt_sched_stats_t *stats)
+{
+    *stats = pdw3000local->sched_stats;
+}
 
-    // Handle RX Timeout event (PTO and FWTO)
-    if (fstat & FINT_STAT_RXTO_BIT_MASK)
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function arms the one shot timebase reset (OSTR): GPIO7 is set to its SYNC input function and the
+ * next rising edge on it restarts the system time counter from 0, wait 38.4 MHz cycles after the edge.
+ *
+ * input parameters
+ * @param wait - cycles of the 38.4 MHz clock between the SYNC edge and the reset, up to DWT_OSTR_WAIT_MAX
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the schedule queue has events pending (see dwt_sched_init)
+ */
+int dwt_ostr_arm(uint8_t wait)
+{
+    if (dwt_sched_pending() != 0)
     {
-        // Clear RX TO events before the callback - this lets the host renable the receiver inside the callback
-        dwt_write8bitoffsetreg(SYS_STATUS_ID, 2, (uint8_t)(SYS_STATUS_ALL_RX_TO >> 16)); // Clear RX timeout event bits (PTO, RFTO)
+        return DWT_ERROR;
+    }
 
-        // Call the corresponding callback if present
-        if (pdw3000local->cbRxTo != NULL)
-        {
-            pdw3000local->cbRxTo(&pdw3000local->cbData);
-        }
+    // GPIO7 mode 0 is the SYNC input, sampled on the GPIO clocks
+    dwt_and32bitoffsetreg(GPIO_MODE_ID, 0, (uint32_t)~GPIO_MODE_MSGP7_MODE_BIT_MASK);
+    dwt_or16bitoffsetreg(GPIO_DIR_ID, 0, GPIO_DIR_GDP7_BIT_MASK);
+    dwt_enablegpioclocks();
+
+    dwt_modify32bitoffsetreg(EC_CTRL_ID, 0, ~(EC_CTRL_OSTS_WAIT_BIT_MASK | EC_CTRL_OSTR_MODE_BIT_MASK),
+        (((uint32_t)wait << EC_CTRL_OSTS_WAIT_BIT_OFFSET) & EC_CTRL_OSTS_WAIT_BIT_MASK) | EC_CTRL_OSTR_MODE_BIT_MASK);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function disarms the one shot timebase reset: SYNC edges no longer reset the system time counter.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_ostr_disarm(void)
+{
+    dwt_and32bitoffsetreg(EC_CTRL_ID, 0, ~EC_CTRL_OSTR_MODE_BIT_MASK);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function checks that the system time counter restarted on the SYNC edge: read right after the edge,
+ * the system time is no more than the time since the edge.
+ *
+ * input parameters
+ * @param max_us - longest time since the SYNC edge, in microseconds
+ *
+ * output parameters
+ * @param systime - SYS_TIME read, may be NULL
+ *
+ * returns DWT_SUCCESS if the counter restarted, or DWT_ERROR if not
+ */
+int dwt_ostr_check(uint32_t max_us, uint32_t *systime)
+{
+    uint32_t now = dwt_readsystimestamphi32();
+
+    if (systime != NULL)
+    {
+        *systime = now;
     }
+
+    return (now <= (uint32_t)((uint64_t)max_us * 2496 / 10)) ? DWT_SUCCESS : DWT_ERROR;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -3705,6 +6520,7 @@ int dwt_starttx(uint8_t mode)
     if ((mode & DWT_START_TX_DELAYED) || (mode & DWT_START_TX_DLY_REF)
             || (mode & DWT_START_TX_DLY_RS) || (mode & DWT_START_TX_DLY_TS))
     {
+        DWT_PROBE_START(DWT_PROBE_DLY_TX);
         if(mode & DWT_START_TX_DELAYED) //delayed TX
         {
             if(mode & DWT_RESPONSE_EXPECTED)
@@ -3772,6 +6588,8 @@ int dwt_starttx(uint8_t mode)
             //optionally could return error, and still send the frame at indicated time
             //then if the application want to cancel the sending this can be done in a separate command.
         }
+
+        DWT_PROBE_STOP(DWT_PROBE_DLY_TX);
     }
     else if(mode & DWT_START_TX_CCA)
     {
@@ -4070,6 +6888,8 @@ void dwt_readeventcounters(dwt_deviceentcnts_t *counters)
  */
 void dwt_softreset(void)
 {
+    pdw3000local->cfgactive = NULL;
+
     //clear any AON configurations (this will leave the device at FOSC/4, thus we need low SPI rate)
     dwt_clearaonconfig();
 
@@ -4089,6 +6909,8 @@ void dwt_softreset(void)
     //reset buffer to process RX_BUFFER_0 next - if in double buffer mode (clear bit 1 if set)
     pdw3000local->dblbuffon = DBL_BUFF_ACCESS_BUFFER_0;
     pdw3000local->sleep_mode = 0;
+
+    _dwt_regcache_invalidate();
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -4193,6 +7015,7 @@ void dwt_enable_rf_tx(uint32_t channel, uint8_t switch_control)
 
 }
 
+#ifndef DWT_NO_TEST_MODES
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function will enable a repeated continuous waveform on the device
  *
@@ -4241,6 +7064,7 @@ void dwt_repeated_frames(uint32_t framerepetitionrate)
     }
     dwt_write32bitreg(DX_TIME_ID, framerepetitionrate);
 }
+#endif
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function disables the automatic sequencing of the tx-blocks for a specific channel.
@@ -4287,6 +7111,7 @@ void dwt_disable_rftx_blocks(void)
     dwt_write32bitoffsetreg(RF_CTRL_MASK_ID, 0, 0x00000000);
 }
 
+#ifndef DWT_NO_TEST_MODES
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief this function sets the DW3000 to transmit cw signal at specific channel frequency
  *
@@ -4326,6 +7151,35 @@ void dwt_configcontinuousframemode(uint32_t framerepetitionrate, uint8_t channel
     dwt_repeated_frames(framerepetitionrate);
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function takes the DW3000 out of the continuous wave or continuous frame mode without a reset:
+ *  the transmission is stopped, the test registers cleared, and the TX blocks, the TX/RX switch, the clocks and the
+ *  TX fine grain sequencing given back to the automatic control. The configuration (dwt_configure, dwt_configuretxrf)
+ *  is kept, so another test mode or a normal transmission can follow at once.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_disablecontinuousmode(void)
+{
+    dwt_forcetrxoff();
+
+    //Disable repeated frames and CW
+    dwt_and8bitoffsetreg(TEST_CTRL0_ID, 0x0, (uint8_t)~TEST_CTRL0_TX_PSTM_BIT_MASK);
+    dwt_write32bitoffsetreg(TX_TEST_ID, 0x0, 0);
+    dwt_write32bitoffsetreg(PG_TEST_ID, 0x0, 0);
+
+    //Restore clocks to AUTO, turn off TX blocks and restore the TX sequencing
+    dwt_disable_rftx_blocks();
+    dwt_disable_rf_tx(1);
+    dwt_force_clocks(FORCE_CLK_AUTO);
+    dwt_setfinegraintxseq(1);
+}
+#endif
+
 /*! ------------------------------------------------------------------------------------------------------------------
 * @brief this function reads the raw battery voltage and temperature values of the DW IC.
 * The values read here will be the current values sampled by DW IC AtoD converters.
@@ -4532,6 +7386,7 @@ uint16_t dwt_calcpgcount(uint8_t pgdly, int channel)
 
 /* AES block */
 
+#ifndef DWT_NO_AES
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief   This function provides the API for the configuration of the AES block before first usage.
  * @param   pCfg    - pointer to the configuration structure, which contains the AES configuration data.
@@ -4677,26 +7532,19 @@ void dwt_update_nonce_GCM(uint8_t *nonce)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief   This function provides the API for the job of encrypt/decrypt the data block
- *
- *          128 bit key shall be pre-loaded with dwt_set_aes_key()
- *          dwt_configure_aes
+ * @brief   Program the nonce, the frame (for encryption) and the DMA configuration of an AES job, up to AES_START
  *
- *          supports AES_KEY_Src_Register mode only
- *          packet sizes < 127
- *          note, the "nonce" shall be unique for every transaction
  * @param job - pointer to AES job, contains data info and encryption info.
  * @param core_type - Core type
+ * @param read_addr - set to the buffer the decrypted frame will be read back from
  *
- * @return  AES_STS_ID status bits
- *
- *
+ * @return  DWT_SUCCESS or the dwt_do_aes() errors
  */
-int8_t dwt_do_aes(dwt_aes_job_t *job, dwt_aes_core_type_e core_type)
+static
+int8_t _dwt_aes_setup(dwt_aes_job_t *job, dwt_aes_core_type_e core_type, uint32_t *read_addr)
 {
     uint32_t      tmp,dest_reg;
     uint16_t    allow_size;
-    uint8_t     ret;
     dwt_aes_src_port_e src_port;
     dwt_aes_dst_port_e dst_port;
 
@@ -4812,59 +7660,187 @@ int8_t dwt_do_aes(dwt_aes_job_t *job, dwt_aes_core_type_e core_type)
 
     dwt_write32bitreg(DMA_CFG1_ID, tmp);
 
-    /* start AES action encrypt/decrypt */
-    dwt_write8bitoffsetreg(AES_START_ID, 0, AES_START_AES_START_BIT_MASK);
-    ret = dwt_wait_aes_poll();
-
-    /* Read plain header and decrypted payload on correct AES decryption
-     * and if instructed to do so, i.e. if job->mode == AES_Decrypt and
-     * job->header or job->payload addresses are exist
+    /* The buffer the decrypted frame is read back from, resolved now as the double buffer may swap
+     * before an asynchronous job completes
      * */
-
-    if(((ret & ~(AES_STS_RAM_EMPTY_BIT_MASK|AES_STS_RAM_FULL_BIT_MASK)) == AES_STS_AES_DONE_BIT_MASK)
-            && (job->mode == AES_Decrypt))
+    if ((job->dst_port == AES_Dst_Rx_buf_0) || (job->dst_port == AES_Dst_Rx_buf_1))
     {
-        uint32_t    read_addr;
-
-        if ((job->dst_port == AES_Dst_Rx_buf_0) || (job->dst_port == AES_Dst_Rx_buf_1))
-        {
-            if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)  //if the flag is 0x3 we are reading from RX_BUFFER_1
-            {
-                read_addr = RX_BUFFER_1_ID;
-            }
-            else
-            {
-                read_addr = RX_BUFFER_0_ID;
-            }
-        }
-        else if (job->dst_port == AES_Dst_Tx_buf)
+        if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)  //if the flag is 0x3 we are reading from RX_BUFFER_1
         {
-            read_addr = TX_BUFFER_ID;
+            *read_addr = RX_BUFFER_1_ID;
         }
         else
         {
-            read_addr = SCRATCH_RAM_ID;
+            *read_addr = RX_BUFFER_0_ID;
         }
+    }
+    else if (job->dst_port == AES_Dst_Tx_buf)
+    {
+        *read_addr = TX_BUFFER_ID;
+    }
+    else
+    {
+        *read_addr = SCRATCH_RAM_ID;
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief   Read the plain header and the decrypted payload of a completed AES job, on a correct decryption and
+ *          if instructed to do so, i.e. if job->mode == AES_Decrypt and job->header or job->payload addresses exist
+ *
+ * @param job - AES job
+ * @param ret - AES_STS_ID status bits of the job
+ * @param read_addr - buffer the decrypted frame is in
+ *
+ * no return value
+ */
+static
+void _dwt_aes_readback(dwt_aes_job_t *job, uint8_t ret, uint32_t read_addr)
+{
+    if(((ret & ~(AES_STS_RAM_EMPTY_BIT_MASK|AES_STS_RAM_FULL_BIT_MASK)) != AES_STS_AES_DONE_BIT_MASK)
+            || (job->mode != AES_Decrypt))
+    {
+        return;
+    }
 
-        if(job->header != NULL)
+    if(job->header != NULL)
+    {
+        if (job->header_len)
         {
-            if (job->header_len)
-            {
-                dwt_readfromdevice(read_addr, 0, job->header_len, job->header);
-            }
+            dwt_readfromdevice(read_addr, 0, job->header_len, job->header);
         }
+    }
 
-        if(job->payload != NULL)
+    if(job->payload != NULL)
+    {
+        if (job->payload_len)
         {
-            if (job->payload_len)
-            {
-                dwt_readfromdevice(read_addr, job->header_len, job->payload_len, job->payload);
-            }
+            dwt_readfromdevice(read_addr, job->header_len, job->payload_len, job->payload);
         }
     }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief   This function provides the API for the job of encrypt/decrypt the data block
+ *
+ *          128 bit key shall be pre-loaded with dwt_set_aes_key()
+ *          dwt_configure_aes
+ *
+ *          supports AES_KEY_Src_Register mode only
+ *          packet sizes < 127
+ *          note, the "nonce" shall be unique for every transaction
+ * @param job - pointer to AES job, contains data info and encryption info.
+ * @param core_type - Core type
+ *
+ * @return  AES_STS_ID status bits
+ *
+ *
+ */
+int8_t dwt_do_aes(dwt_aes_job_t *job, dwt_aes_core_type_e core_type)
+{
+    uint32_t    read_addr;
+    int8_t      err;
+    uint8_t     ret;
+
+    err = _dwt_aes_setup(job, core_type, &read_addr);
+    if (err != DWT_SUCCESS)
+    {
+        return err;
+    }
+
+    /* start AES action encrypt/decrypt */
+    dwt_write8bitoffsetreg(AES_START_ID, 0, AES_START_AES_START_BIT_MASK);
+    ret = dwt_wait_aes_poll();
+
+    _dwt_aes_readback(job, ret, read_addr);
+
     return (ret);
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief   This function starts an encrypt/decrypt job as dwt_do_aes() does, but returns as soon as the AES block is
+ *          started. The job completes in dwt_isr(), on the AES_DONE (or AES_ERR) event: the decrypted frame is read
+ *          back as described in dwt_do_aes() and the callback is called with the AES_STS_ID status bits.
+ *
+ *          The job (and, for a decryption, the buffers it points to) must stay valid until the callback. Another job
+ *          can be started from the callback.
+ *
+ * @param job - pointer to AES job, contains data info and encryption info.
+ * @param core_type - Core type
+ * @param cb - completion callback, called from dwt_isr() (can be NULL)
+ *
+ * @return  DWT_SUCCESS when started, ERROR_AES_BUSY if a job is already running, or the dwt_do_aes() errors
+ */
+int8_t dwt_do_aes_async(dwt_aes_job_t *job, dwt_aes_core_type_e core_type, dwt_aes_cb_t cb)
+{
+    int8_t      err;
+
+    if (pdw3000local->aesjob != NULL)
+    {
+        return ERROR_AES_BUSY;
+    }
+
+    err = _dwt_aes_setup(job, core_type, &pdw3000local->aes_read_addr);
+    if (err != DWT_SUCCESS)
+    {
+        return err;
+    }
+
+    pdw3000local->aesjob = job;
+    pdw3000local->cbAes = cb;
+
+    /* dwt_do_aes() leaves AES_DONE set in SYS_STATUS, clear it before the event is enabled */
+    dwt_write16bitoffsetreg(SYS_STATUS_HI_ID, 0, (SYS_STATUS_HI_AES_DONE_BIT_MASK | SYS_STATUS_HI_AES_ERR_BIT_MASK));
+    dwt_or16bitoffsetreg(SYS_ENABLE_HI_ID, 0, (SYS_ENABLE_HI_AES_DONE_ENABLE_BIT_MASK | SYS_ENABLE_HI_AES_ERR_ENABLE_BIT_MASK));
+
+    /* start AES action encrypt/decrypt */
+    dwt_write8bitoffsetreg(AES_START_ID, 0, AES_START_AES_START_BIT_MASK);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief   This function returns whether a job started by dwt_do_aes_async() is still running
+ *
+ * @return  1 if running, 0 otherwise
+ */
+uint8_t dwt_aes_busy(void)
+{
+    return (pdw3000local->aesjob != NULL);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief   Complete the job started by dwt_do_aes_async(), called from dwt_isr() on AES_DONE/AES_ERR
+ *
+ * no return value
+ */
+static
+void _dwt_aes_complete(void)
+{
+    dwt_aes_job_t *job = pdw3000local->aesjob;
+    dwt_aes_cb_t cb = pdw3000local->cbAes;
+    uint8_t ret;
+
+    ret = dwt_read8bitoffsetreg(AES_STS_ID, 0);
+    dwt_write8bitoffsetreg(AES_STS_ID, 0, ret); //clear all bits which were set as a result of AES operation
+    ret &= 0x3F;
+
+    dwt_and16bitoffsetreg(SYS_ENABLE_HI_ID, 0, (uint16_t)~(SYS_ENABLE_HI_AES_DONE_ENABLE_BIT_MASK | SYS_ENABLE_HI_AES_ERR_ENABLE_BIT_MASK));
+    dwt_write16bitoffsetreg(SYS_STATUS_HI_ID, 0, (SYS_STATUS_HI_AES_DONE_BIT_MASK | SYS_STATUS_HI_AES_ERR_BIT_MASK));
+
+    _dwt_aes_readback(job, ret, pdw3000local->aes_read_addr);
+
+    // The job is done before the callback, so the callback can start the next one
+    pdw3000local->aesjob = NULL;
+    if (cb != NULL)
+    {
+        cb((int8_t)ret, job);
+    }
+}
+#endif
+
 /*! ------------------------------------------------------------------------------------------------------------------
 *
 * @brief   This function is used to write a 16 bit address to a desired Low-Energy device (LE) address. For frame pending to function when
@@ -19,6 +19,9 @@ extern "C" {
 
 #include "deca_types.h"
 
+/* Build options (set by zephyr/Kconfig when the driver is built as a Zephyr module):
+ * DWT_NUM_DW_DEV - number of devices, DWT_NO_AES, DWT_NO_OTP_PROG, DWT_NO_TEST_MODES, DWT_NO_DIAG - compile out
+ * the AES block, OTP programming, CW/continuous frame test modes and RX diagnostics functions */
 #ifndef DWT_NUM_DW_DEV
 #define DWT_NUM_DW_DEV (1)
 #endif
@@ -55,6 +58,12 @@ extern "C" {
 #define DWT_ERROR   (-1)
 
 #define DWT_TIME_UNITS      (1.0/499.2e6/128.0) //!< = 15.65e-12 s
+#define DWT_UUS_TO_TIME     (63898)             //!< device time units in a UWB microsecond (512/499.2 us)
+
+// 40 bit device time arithmetic, wrap-safe
+#define DWT_TIME_MASK       (0xFFFFFFFFFFULL)
+#define DWT_TIME_ADD(t, d)  (((uint64_t)(t) + (uint64_t)(d)) & DWT_TIME_MASK)
+#define DWT_TIME_DIFF(a, b) ((int64_t)(((((uint64_t)(a) - (uint64_t)(b)) & DWT_TIME_MASK) ^ 0x8000000000ULL)) - 0x8000000000LL)
 
 #define DWT_A0_DEV_ID       (0xDECA0300)        //!< DW3000 MPW A0 (non PDOA) silicon device ID
 #define DWT_A0_PDOA_DEV_ID  (0xDECA0310)        //!< DW3000 MPW A0 (with PDOA) silicon device ID
@@ -298,6 +307,7 @@ typedef enum
 #define DWT_READ_OTP_LID  0x20    //read lot ID from OTP
 #define DWT_READ_OTP_BAT  0x40    //read ref voltage from OTP
 #define DWT_READ_OTP_TMP  0x80    //read ref temperature from OTP
+#define DWT_READ_OTP_ALL  (DWT_READ_OTP_PID | DWT_READ_OTP_LID | DWT_READ_OTP_BAT | DWT_READ_OTP_TMP)
 
 //DW3000 OTP operating parameter set selection
 #define DWT_OPSET_LONG   (0x0<<11)
@@ -355,9 +365,72 @@ typedef struct
 // Call-back type for SPI read error event (if the DW3000 generated CRC does not match the one calculated by the dwt_generatecrc8 function)
 typedef void(*dwt_spierrcb_t)(void);
 
+// Call-back type for asynchronous SPI transfer completion (result is DWT_SUCCESS or DWT_ERROR)
+typedef void (*dwt_spi_done_cb_t)(int result, void *arg);
+
 // Call-back type for all interrupt events
 typedef void (*dwt_cb_t)(const dwt_cb_data_t *);
 
+// RX event ring (see dwt_rxring_init)
+#ifndef DWT_RXRING_DATA_LEN
+#define DWT_RXRING_DATA_LEN  (127)  // payload bytes kept per received frame (longer frames are truncated)
+#endif
+
+typedef struct
+{
+    uint32_t status;                        // SYS_STATUS as seen by dwt_isr()
+    uint16_t datalength;                    // length of frame (including 2 byte CRC), may be > DWT_RXRING_DATA_LEN
+    uint8_t  rx_flags;                      // RX frame flags, as in dwt_cb_data_t
+    uint8_t  rx_stamp[5];                   // adjusted RX timestamp
+    uint8_t  data[DWT_RXRING_DATA_LEN];     // first min(datalength, DWT_RXRING_DATA_LEN) bytes of the frame
+} dwt_rxring_desc_t;
+
+// Continuous double-buffered receiver counters (see dwt_rxcont_start)
+typedef struct
+{
+    uint32_t frames;                        // good frames received
+    uint32_t errors;                        // RX errors (PHR, CRC, sync loss, SFD timeout, rejected frames)
+    uint32_t overruns;                      // RXOVRR events (frames lost as both buffers were full)
+    uint32_t dropped;                       // good frames not put in the full RX event ring
+} dwt_rxcont_stats_t;
+
+// Schedule queue (see dwt_sched_init)
+#define DWT_SCHED_TX            0           // delayed TX of a frame already in the TX buffer
+#define DWT_SCHED_RX            1           // delayed receiver on
+
+#define DWT_SCHED_HIST_BINS     8           // slack histogram bins
+#define DWT_SCHED_HIST_BASE_UUS 50          // first bin edge, the edges double from one bin to the next
+
+typedef struct
+{
+    uint64_t time;                          // 40 bit device time of the TX or of the receiver on, low 9 bits ignored
+                                            // (the TX timestamp is this time plus the TX antenna delay)
+    uint32_t rx_timeout;                    // DWT_SCHED_RX or response expected: RX timeout in 1.0256 us units, 0 for none
+    uint16_t tx_len;                        // DWT_SCHED_TX: frame length, FCS included (as dwt_writetxfctrl())
+    uint16_t tx_offset;                     // DWT_SCHED_TX: offset of the frame in the TX buffer
+    uint8_t  type;                          // DWT_SCHED_TX or DWT_SCHED_RX
+    uint8_t  mode;                          // DWT_SCHED_TX: DWT_RESPONSE_EXPECTED or 0
+    uint8_t  ranging;                       // DWT_SCHED_TX: ranging bit of the frame
+    void     *arg;                          // application tag, not used by the driver
+} dwt_sched_event_t;
+
+// Schedule queue counters (see dwt_sched_get_stats)
+typedef struct
+{
+    uint32_t armed;                         // events armed in time
+    uint32_t late;                          // events skipped: less than min_slack_uus ahead, or refused by the device
+    uint32_t dropped;                       // events not queued, queue full
+    uint32_t min_slack_uus;                 // smallest slack of an armed event (UINT32_MAX before the first one)
+    uint32_t hist[DWT_SCHED_HIST_BINS];     // armed events by slack: bin n < DWT_SCHED_HIST_BASE_UUS << n, last bin the rest
+} dwt_sched_stats_t;
+
+// Call-back type for the events skipped as late
+typedef void (*dwt_sched_late_cb_t)(const dwt_sched_event_t *event);
+
+// One shot timebase reset (see dwt_ostr_arm)
+#define DWT_OSTR_WAIT_MAX       0xFF        // longest wait from the SYNC edge to the reset, in 38.4 MHz cycles
+#define DWT_SYSTIME_PER_US      249.6       // SYS_TIME (high 32 bits of the device time) counts per microsecond
+
 
 #define SQRT_FACTOR             181 /*Factor of sqrt(2) for calculation*/
 #define STS_LEN_SUPPORTED       7   /*The supported STS length options*/
@@ -485,6 +558,52 @@ typedef struct
 
 } dwt_rxdiag_t ;
 
+// dwt_readdiagnostics_sel() fields of dwt_rxdiag_t
+#define DWT_DIAG_IP_TS          0x00000001  // ipatovRxTime, ipatovRxStatus, ipatovPOA
+#define DWT_DIAG_STS_TS         0x00000002  // stsRxTime, stsRxStatus, stsPOA
+#define DWT_DIAG_STS2_TS        0x00000004  // sts2RxTime, sts2RxStatus, sts2POA
+#define DWT_DIAG_TDOA           0x00000008  // tdoa
+#define DWT_DIAG_PDOA           0x00000010  // pdoa
+#define DWT_DIAG_XTAL           0x00000020  // xtalOffset
+#define DWT_DIAG_CIA1           0x00000040  // ciaDiag1
+#define DWT_DIAG_IP_PEAK        0x00000080  // ipatovPeak
+#define DWT_DIAG_IP_POWER       0x00000100  // ipatovPower
+#define DWT_DIAG_IP_F           0x00000200  // ipatovF1, ipatovF2, ipatovF3
+#define DWT_DIAG_IP_FP          0x00000400  // ipatovFpIndex
+#define DWT_DIAG_IP_ACCUM       0x00000800  // ipatovAccumCount
+#define DWT_DIAG_STS_PEAK       0x00001000  // stsPeak
+#define DWT_DIAG_STS_POWER      0x00002000  // stsPower
+#define DWT_DIAG_STS_F          0x00004000  // stsF1, stsF2, stsF3
+#define DWT_DIAG_STS_FP         0x00008000  // stsFpIndex
+#define DWT_DIAG_STS_ACCUM      0x00010000  // stsAccumCount
+#define DWT_DIAG_STS2_PEAK      0x00020000  // sts2Peak
+#define DWT_DIAG_STS2_POWER     0x00040000  // sts2Power
+#define DWT_DIAG_STS2_F         0x00080000  // sts2F1, sts2F2, sts2F3
+#define DWT_DIAG_STS2_FP        0x00100000  // sts2FpIndex
+#define DWT_DIAG_STS2_ACCUM     0x00200000  // sts2AccumCount
+#define DWT_DIAG_ALL            0x003FFFFF
+
+
+// Post-RX ranging state groups for dwt_readrxinfo() (the timestamps and frame info are always read)
+#define DWT_RXINFO_CIA      0x01    // clock offset and PDOA (CIA results)
+#define DWT_RXINFO_CI       0x02    // carrier integrator
+#define DWT_RXINFO_STS      0x04    // STS quality index
+#define DWT_RXINFO_ALL      (DWT_RXINFO_CIA | DWT_RXINFO_CI | DWT_RXINFO_STS)
+#define DWT_RXINFO_STS_GOOD 0x80    // set in dwt_rxinfo_t.valid when the STS quality index is above the threshold
+
+typedef struct
+{
+    uint32_t      finfo ;             // RX_FINFO register (frame length, ranging bit, preamble accumulation count ...)
+    int32_t       carrierInt ;        // carrier integrator, as dwt_readcarrierintegrator()
+    int16_t       clockOffset ;       // clock offset, as dwt_readclockoffset()
+    int16_t       pdoa ;              // PDOA, as dwt_readpdoa()
+    int16_t       stsQuality ;        // STS quality index, as dwt_readstsquality()
+    uint16_t      datalength ;        // frame length (including the 2 byte CRC)
+    uint8_t       rxStamp[5] ;        // adjusted RX timestamp
+    uint8_t       txStamp[5] ;        // TX timestamp of the last frame sent
+    uint8_t       valid ;             // DWT_RXINFO_xxx groups read into this structure
+} dwt_rxinfo_t ;
+
 
 typedef struct
 {
@@ -608,6 +727,9 @@ typedef struct {
     uint8_t             mic_size;    //!< tag_size;
 }dwt_aes_job_t;
 
+// Call-back type for the completion of an asynchronous AES job (status is the AES_STS_ID status bits, see dwt_do_aes_async)
+typedef void (*dwt_aes_cb_t)(int8_t status, dwt_aes_job_t *job);
+
 /* storage for 128-bit STS CP key */
 typedef struct {
     uint32_t key0;
@@ -629,6 +751,7 @@ typedef struct {
 #define ERROR_WRONG_MODE     (-2)
 #define ERROR_WRONG_MIC_SIZE (-3)
 #define ERROR_PAYLOAD_SIZE   (-4)
+#define ERROR_AES_BUSY       (-5)
 #define MIC_ERROR            (0xff)
 #define STS_LEN_128BIT       (16)
 
@@ -703,6 +826,94 @@ int32_t dwt_apiversion(void);
  */
 int dwt_setlocaldataptr(unsigned int index);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function returns the index of the local data structure currently in use, as set by dwt_setlocaldataptr().
+ * The platform layer uses it to route SPI and GPIO accesses to the matching device.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns index of the active device, < DWT_NUM_DW_DEV
+ */
+unsigned int dwt_getlocaldataindex(void);
+
+// Device context handle, one per local data structure (see dwt_getcontext())
+typedef struct dwt_local_data_s dwt_context_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function returns the context handle of a device.
+ *
+ * input parameters
+ * @param index    - device index, < DWT_NUM_DW_DEV
+ *
+ * output parameters
+ *
+ * returns the context handle, or NULL if index is out of range
+ */
+dwt_context_t *dwt_getcontext(unsigned int index);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function selects a device for the calling thread and takes its lock. All following API calls from
+ * this thread act on that device, until dwt_unlock().
+ *
+ * With DWT_THREAD_SAFE defined (needs CONFIG_THREAD_LOCAL_STORAGE=y), the selected device is kept per thread, so
+ * threads driving different devices do not disturb each other. Each register access, and each
+ * dwt_batch_begin()/dwt_batch_end() section, holds the device lock (port_dw_ic_lock()). dwt_lock() holds it across
+ * a sequence of calls, e.g. a configure or a read-modify-write spanning several registers. The lock is recursive.
+ * As an ISR cannot wait for the lock, the IRQ handler must run in a thread (DWM_IRQ_DEFERRED in port.c, enforced).
+ * Without DWT_THREAD_SAFE, dwt_lock() is dwt_setlocaldataptr() and takes no lock.
+ *
+ * The asynchronous transfers (dwt_writetxdata_async() etc.) do not wait for the lock: they fail (DWT_ERROR) while
+ * another thread holds it or a transfer is on the bus, and the caller tries again later.
+ *
+ * input parameters
+ * @param ctx      - context handle from dwt_getcontext()
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+int dwt_lock(dwt_context_t *ctx);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function releases the lock taken by dwt_lock(). The device stays selected for the calling thread.
+ *
+ * input parameters
+ * @param ctx      - context handle passed to dwt_lock()
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_unlock(dwt_context_t *ctx);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function starts batching of register writes: until the matching dwt_batch_end(), short register
+ * writes (including AND/OR modifies and fast commands) are queued and sent back to back with writetospi_batch().
+ * Any read, or longer buffer write, sends the queued writes first so the order of accesses is preserved.
+ * Calls may be nested. NOTE: a delay (e.g. deca_usleep) between batched writes must be preceded by dwt_batch_end().
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_batch_begin(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function ends batching of register writes started by dwt_batch_begin(), the outermost call sends
+ * any queued writes.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_batch_end(void);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief Returns the PG delay value of the TX
  *
@@ -840,6 +1051,42 @@ void dwt_setlnapamode(int lna_pa);
  */
 int dwt_initialise(int mode);
 
+// OTP data read by dwt_initialise(), kept over a warm boot (see dwt_getinitcache())
+typedef struct
+{
+    uint32_t partID;            // part ID, checked against the OTP before the rest is used
+    uint32_t lotID;             // lot ID (valid with DWT_READ_OTP_LID in mode)
+    uint8_t  bias_tune;         // BIAS_TUNE
+    uint8_t  ldo_tune_set;      // LDO_TUNE programmed in OTP
+    uint8_t  dgc_otp_set;       // DGC values programmed in OTP (DWT_DGC_LOAD_FROM_OTP/SW)
+    uint8_t  vBatP;             // reference voltage
+    uint8_t  tempP;             // reference temperature
+    uint8_t  otprev;            // OTP revision
+    uint8_t  init_xtrim;        // crystal trim
+    uint8_t  mode;              // DWT_READ_OTP_xxx data held
+} dwt_init_cache_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief These functions let dwt_initialise() skip the OTP reads on a warm boot. After a full dwt_initialise() (with at
+ * least DWT_READ_OTP_PID), dwt_getinitcache() returns the OTP derived data, for the host to keep e.g. in retention RAM
+ * (see port_warm_cache_save()). On the next boot dwt_setinitcache() hands it back: dwt_initialise() then reads only the
+ * part ID from OTP and, if it matches and the data holds all the DWT_READ_OTP_xxx fields asked for, programs the
+ * LDO/bias tune and crystal trim from the copy. Else it reads the OTP as usual. DWT_READ_OTP_BAT/TMP are only held
+ * when the OTP had the reference voltage/temperature: the defaults used in their place are not kept as calibration.
+ *
+ * The PLL and PGF (RX) calibrations in dwt_configure() always run: their results are measured into read-only
+ * registers and cannot be written back.
+ *
+ * input parameters
+ * @param cache - OTP data; for dwt_setinitcache() the data must stay valid while used, NULL to read the OTP again
+ *
+ * output parameters
+ *
+ * dwt_getinitcache() returns DWT_SUCCESS for success, or DWT_ERROR if the part ID has not been read
+ */
+int  dwt_getinitcache(dwt_init_cache_t *cache);
+void dwt_setinitcache(const dwt_init_cache_t *cache);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function can place DW3000 into IDLE/IDLE_PLL or IDLE_RC mode when it is not actively in TX or RX.
  *
@@ -903,6 +1150,136 @@ void dwt_configurestsmode(uint8_t stsMode);
  */
 int dwt_configure(dwt_config_t *config);
 
+#define DWT_CFGIMAGE_MAX_OPS    (48)    // max number of SPI transactions in a register image
+#define DWT_CFGIMAGE_BUF_LEN    (320)   // bytes of SPI transactions in a register image (header + data + crc)
+
+// Register image of a dwt_configure() configuration, recorded by dwt_cfgimage_build()
+typedef struct
+{
+    uint16_t    count;                          // number of SPI transactions
+    uint16_t    used;                           // bytes used in buf
+    uint16_t    len[DWT_CFGIMAGE_MAX_OPS];      // length of each SPI transaction
+    uint8_t     buf[DWT_CFGIMAGE_BUF_LEN];      // SPI transactions, back to back, as sent by writetospi_batch()
+    uint16_t    sleep_mode;                     // OPS table selection kicked on wakeup (DWT_ALT_OPS/DWT_SEL_OPSx)
+    int16_t     ststhreshold;                   // STS quality threshold
+    uint8_t     longFrames;                     // PHR mode
+    uint8_t     stsconfig;                      // STS mode
+    uint8_t     chan;                           // channel, for the PLL lock and PGF calibration
+    uint8_t     rxCode;                         // RX preamble code, for the DGC LUTs
+    uint8_t     spicrc;                         // SPI CRC mode the image was recorded with
+    uint8_t     valid;                          // image can be applied
+    uint8_t     overflow;                       // image did not fit (or needed writes that are not batched)
+} dwt_cfgimage_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function configures the device exactly as dwt_configure() does, and records the register set up
+ * (every register write up to the PLL lock) as a register image. The image can be kept, e.g. one per profile in
+ * config_options.c, and later given to dwt_cfgimage_apply() to configure the device again without going through the
+ * dwt_configure() decision logic, with a single SPI burst.
+ *
+ * The image depends on the device (some values are read-modify-write) and on the SPI CRC mode, so it must be built
+ * on the device it is applied to, after dwt_initialise() and after any dwt_enablespicrc() call.
+ *
+ * input parameters
+ * @param config    -   pointer to the configuration structure, which contains the device configuration data.
+ *
+ * output parameters
+ * @param img       -   register image
+ *
+ * return DWT_SUCCESS or DWT_ERROR (PLL CAL fails / PLL fails to lock, or the image does not fit: the device is
+ * configured anyway but the image is not valid)
+ */
+int dwt_cfgimage_build(dwt_config_t *config, dwt_cfgimage_t *img);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function configures the device from a register image built with dwt_cfgimage_build(). The register
+ * set up is sent in one SPI burst, then the PLL lock, RX LUT (DGC) load and PGF calibration are done as in
+ * dwt_configure().
+ *
+ * input parameters
+ * @param img       -   register image
+ *
+ * output parameters
+ *
+ * return DWT_SUCCESS or DWT_ERROR (image not valid, SPI CRC mode has changed, PLL fails to lock or PGF CAL fails)
+ */
+int dwt_cfgimage_apply(const dwt_cfgimage_t *img);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function switches the device between pre-validated PHY profiles, i.e. register images built once with
+ * dwt_cfgimage_build() (which does the full calibration for each profile), e.g. a long range discovery profile and a
+ * short range high data rate tracking profile.
+ *
+ * When the device is configured with another image on the same channel, only the registers that differ between the
+ * two images are written, in a single SPI burst, and the PLL lock and PGF calibration results are kept; the DGC is
+ * set up again only when the PRF changes. Otherwise (no image applied since dwt_configure()/dwt_initialise(), or a
+ * channel change) this is the same as dwt_cfgimage_apply().
+ *
+ * The device should be in IDLE (e.g. after dwt_forcetrxoff()), and the images must stay valid (not be moved or
+ * changed) while in use.
+ *
+ * input parameters
+ * @param img       -   register image of the profile to switch to
+ *
+ * output parameters
+ *
+ * return DWT_SUCCESS or DWT_ERROR (image not valid, SPI CRC mode has changed, or calibration failed)
+ */
+int dwt_cfgimage_switch(const dwt_cfgimage_t *img);
+
+// Channel 5 / channel 9 registers for dwt_chanhop_set(), recorded by dwt_chanhop_init(), [0] channel 5, [1] channel 9
+typedef struct
+{
+    uint32_t    chan_ctrl[2];                   // CHAN_CTRL (channel, preamble codes, SFD type)
+    uint32_t    tx_ctrl_hi[2];                  // TX_CTRL_HI, PG delay included
+    uint32_t    rx_ctrl_hi[2];                  // RX_CTRL_HI
+    uint32_t    tx_power[2];                    // TX_POWER
+    uint16_t    pll_cfg[2];                     // PLL_CFG
+    uint8_t     rxCode;                         // RX preamble code, for the DGC LUTs
+    uint8_t     chan;                           // channel the device is tuned to (0 after a failed retune)
+    uint8_t     valid;                          // recorded by dwt_chanhop_init()
+} dwt_chanhop_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function prepares channel hopping between channel 5 and channel 9: the device is configured with
+ * dwt_configure() and dwt_configuretxrf() on channel 5, then on channel 9 (checking the PLL lock and PGF calibration
+ * on each, and running the PG delay calibration when the dwt_txconfig_t PGcount is set), and the registers that
+ * differ between the two channels are recorded for dwt_chanhop_set(). The device is left on config->chan.
+ *
+ * Call it after dwt_initialise() and before any dwt_configure() on channel 9 (the channel 5 RX_CTRL_HI value is the
+ * reset value), and again after dwt_softreset() or a change of the other configuration parameters.
+ *
+ * input parameters
+ * @param config    -   configuration shared by both channels (preamble codes valid on both, e.g. 9 to 12)
+ * @param txconfig5 -   TX spectrum configuration for channel 5 (e.g. txconfig_options)
+ * @param txconfig9 -   TX spectrum configuration for channel 9 (e.g. txconfig_options_ch9)
+ *
+ * output parameters
+ * @param hop       -   per channel registers
+ *
+ * return DWT_SUCCESS or DWT_ERROR (PLL CAL fails / PLL fails to lock or PGF CAL fails on one of the channels)
+ */
+int dwt_chanhop_init(dwt_chanhop_t *hop, dwt_config_t *config, dwt_txconfig_t *txconfig5, dwt_txconfig_t *txconfig9);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function retunes the device between channel 5 and channel 9 without dwt_configure(): CHAN_CTRL, the
+ * TX/RX analog and PLL configuration, TX power and PG delay and the DGC lookup tables are written in one SPI burst,
+ * and only the PLL lock is waited for. The PGF calibration, of the RX baseband filter, does not depend on the channel
+ * and is kept. Nothing is written when the device is already on chan.
+ *
+ * The device should be in IDLE (e.g. after dwt_forcetrxoff()). The register image of dwt_cfgimage_switch() is
+ * forgotten: the next switch applies a full image.
+ *
+ * input parameters
+ * @param hop       -   per channel registers, from dwt_chanhop_init()
+ * @param chan      -   channel, 5 or 9
+ *
+ * output parameters
+ *
+ * return DWT_SUCCESS or DWT_ERROR (hop not initialised, bad channel, or PLL fails to lock)
+ */
+int dwt_chanhop_set(dwt_chanhop_t *hop, uint8_t chan);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function provides the API for the configuration of the TX spectrum
  * including the power and pulse generator delay. The input is a pointer to the data structure
@@ -1013,6 +1390,28 @@ void dwt_settxantennadelay(uint16_t antennaDly);
  */
 int dwt_writetxdata(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBufferOffset);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This API function is the asynchronous version of dwt_writetxdata(). It starts the transfer of the TX data
+ * and returns as soon as the SPI transfer is queued; the completion call-back is called (typically from interrupt
+ * context) when the data is in the DW3000's TX buffer. The txDataBytes buffer must stay valid until then.
+ * If dwt_writetxdata_async() is called with an offset above 127, the indirect pointer set up is done synchronously
+ * before the data transfer is started.
+ *
+ * NOTE: requires CONFIG_SPI_ASYNC=y in the platform; only one asynchronous transfer may be in progress at a time.
+ *
+ * input parameters
+ * @param txDataLength   - This is the total length of data (in bytes) to write to the tx buffer.
+ * @param txDataBytes    - Pointer to the user's buffer containing the data to send.
+ * @param txBufferOffset - This specifies an offset in the DW IC's TX Buffer at which to start writing data.
+ * @param cb             - completion call-back, may be NULL
+ * @param arg            - user argument passed to the call-back
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+ */
+int dwt_writetxdata_async(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBufferOffset, dwt_spi_done_cb_t cb, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This API function configures the TX frame control register before the transmission of a frame
  *
@@ -1153,6 +1552,26 @@ int16_t dwt_readpdoa(void);
  */
 void dwt_readtdoa(uint8_t * tdoa);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is used to read the RX and TX timestamps, the frame info and (optionally) the other results of a reception
+ *        needed for ranging, with as few SPI transactions as possible. This is meant to be called in the RX callback,
+ *        between the reception and the programming of a delayed response, in place of the individual read functions.
+ *        The timestamps and RX_FINFO come in one read, the CIA results in another, the carrier integrator and the STS
+ *        quality index cost one more read each. The RX double buffer mode is handled as in the individual functions.
+ *
+ * NOTE: In double buffer mode the carrier integrator and the STS quality index are not buffered and relate to the last
+ *       frame received.
+ *
+ * input parameters
+ * @param info - pointer to the structure to fill
+ * @param mask - DWT_RXINFO_xxx groups to read on top of the timestamps and frame info
+ *
+ * output parameters - the info structure will contain the values after the function call
+ *
+ * no return value
+ */
+void dwt_readrxinfo(dwt_rxinfo_t *info, uint8_t mask);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to read the RX timestamp (adjusted time of arrival)
  *
@@ -1457,6 +1876,21 @@ void dwt_entersleepaftertx(int enable);
  */
 void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr, dwt_cb_t cbSPIErr, dwt_cb_t cbSPIRdy);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function registers the callback called by dwt_isr() when a DWT_START_TX_CCA transmission is cancelled
+ *        because a preamble was detected within the preamble detection timeout (CCA_FAIL event). The device is then
+ *        back in IDLE. The CCA_FAIL interrupt must also be enabled (SYS_ENABLE_HI_CCA_FAIL_ENABLE_BIT_MASK in
+ *        dwt_setinterrupt()).
+ *
+ * input parameters
+ * @param cbCCAFail - the pointer to the CCA fail event callback function, or NULL
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setcbccafail(dwt_cb_t cbCCAFail);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function checks if the IRQ line is active - this is used instead of interrupt handler
  *
@@ -1503,6 +1937,228 @@ uint8_t dwt_checkidlerc(void);
  */
 void dwt_isr(void);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function sets up the RX event ring: a single producer (dwt_isr) single consumer (application) lock-free
+ * ring of RX descriptors. When set up, every good frame reported by dwt_isr() is also copied (status, length, flags,
+ * RX timestamp and payload) into the next free descriptor before cbRxOk is called, so the application can drain the
+ * frames in batches after the fact. If the ring is full the frame is counted as dropped (see dwt_rxring_dropped).
+ *
+ * input parameters
+ * @param descs - descriptor storage provided by the application, or NULL to disable the ring
+ * @param count - number of descriptors, must be a power of 2
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+int dwt_rxring_init(dwt_rxring_desc_t *descs, uint16_t count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function returns the filled descriptors at the head of the RX event ring without removing them
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param desc - set to the oldest filled descriptor
+ *
+ * returns the number of filled descriptors contiguous from *desc (0 if the ring is empty)
+ */
+uint16_t dwt_rxring_peek(dwt_rxring_desc_t **desc);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function releases descriptors returned by dwt_rxring_peek() back to dwt_isr()
+ *
+ * input parameters
+ * @param n - number of descriptors to release
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_rxring_consume(uint16_t n);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function returns the number of good frames not put in the RX event ring as it was full
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the dropped frame count
+ */
+uint32_t dwt_rxring_dropped(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function starts the continuous double-buffered receiver: the receiver is kept listening with both RX
+ * buffers in use (double buffer mode with automatic re-enable, no RX timeouts), and dwt_isr() copies each good frame
+ * into the RX event ring (see dwt_rxring_init) and hands its buffer back to the device before calling cbRxOk. The
+ * next frame is therefore received while the callback and the application process the previous one, and a frame is
+ * only lost when both buffers fill before dwt_isr() gets to them. Such receiver overruns (RXOVRR) are counted, and the
+ * receiver is reset to buffer 0 and re-enabled.
+ *
+ * In this mode cbRxOk is a notification only: the frame is in the ring, and dwt_readrxdata() and the other RX buffer
+ * reads already access the other buffer. The RX interrupts needed are enabled, the other callbacks are unchanged.
+ *
+ * input parameters
+ * @param descs - RX event ring descriptors
+ * @param count - number of descriptors, must be a power of 2
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error (bad ring, or the receiver could not be enabled)
+ */
+int dwt_rxcont_start(dwt_rxring_desc_t *descs, uint16_t count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function stops the continuous receiver: the receiver is turned off and double buffer mode disabled.
+ * The frames already in the RX event ring stay there.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_rxcont_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function reads the continuous receiver counters, cleared by dwt_rxcont_start()
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters
+ *
+ * no return value
+ */
+void dwt_rxcont_get_stats(dwt_rxcont_stats_t *stats);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function sets up the schedule queue: future TX and RX events in device time, armed one after the other
+ * by the driver. The next event is armed (dwt_setdelayedtrxtime() then dwt_starttx(DWT_START_TX_DELAYED) or
+ * dwt_rxenable(DWT_START_RX_DELAYED | DWT_IDLE_ON_DLY_ERR)) as soon as the device is done with the previous one:
+ * from dwt_isr() on the TX frame sent event, before cbTxDone, or on the RX frame, error or timeout event of an RX
+ * event (or of a TX event with DWT_RESPONSE_EXPECTED), after the RX callback so it can read the frame first.
+ *
+ * An event is late when, at the time it is armed, it is less than min_slack_uus ahead of the system time, or the
+ * device refuses it (delayed time passed). A late event is skipped, counted and reported to cbLate, and the next one
+ * is armed instead. Armed events are counted in a histogram of their slack (time left when armed), which shows how
+ * much margin the schedule really has. The queue and its counters belong to the selected device.
+ *
+ * TX frames are written beforehand (e.g. tx_slots_stage()), each in its own part of the TX buffer. While the queue
+ * runs, the application does not start TX or RX itself. The queue is not kept across sleep or reset
+ * (dwt_sched_flush() before).
+ *
+ * dwt_sched_init(), dwt_sched_add() and dwt_sched_flush() hold the device lock (port_dw_ic_lock()), with or without
+ * DWT_THREAD_SAFE, so dwt_isr() does not update the queue in the middle of them: they are called from a thread, not
+ * from an ISR, and the port runs dwt_isr() under the same lock or defers it while the lock is held.
+ *
+ * input parameters
+ * @param events - event storage provided by the application, or NULL to disable the queue
+ * @param count - number of events, must be a power of 2
+ * @param min_slack_uus - smallest time ahead of its time an event is armed, in UWB microseconds (SPI and set up time)
+ * @param cbLate - late event call-back (called from dwt_isr() or dwt_sched_add()), may be NULL
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+int dwt_sched_init(dwt_sched_event_t *events, uint16_t count, uint16_t min_slack_uus, dwt_sched_late_cb_t cbLate);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function adds an event at the end of the schedule queue, and arms it if the queue was idle. Events are
+ * queued in time order, compared with 40 bit wrap-around (see DWT_TIME_DIFF), e.g. the next beacon at
+ * DWT_TIME_ADD(last time, period).
+ *
+ * input parameters
+ * @param event - event, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the queue is not set up, full, or the event is before the last one
+ */
+int dwt_sched_add(const dwt_sched_event_t *event);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function empties the schedule queue, the armed event is cancelled (dwt_forcetrxoff())
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_sched_flush(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function returns the number of events queued, the armed one included
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the number of events
+ */
+uint16_t dwt_sched_pending(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function reads the schedule queue counters, cleared by dwt_sched_init()
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters
+ *
+ * no return value
+ */
+void dwt_sched_get_stats(dwt_sched_stats_t *stats);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function arms the one shot timebase reset (OSTR): GPIO7 is set to its SYNC input function and the
+ * next rising edge on it restarts the system time counter from 0, wait 38.4 MHz cycles after the edge. Devices with
+ * the same SYNC line and reference clock then share one time base, to within a 38.4 MHz cycle (e.g. the radios of an
+ * AoA board, or cabled anchors), without any frame exchanged.
+ *
+ * The device must be in IDLE_PLL, with nothing delayed pending: all device times taken before the reset (delayed TX
+ * or RX, timestamps kept by the application) are meaningless after it. After the edge, dwt_ostr_check() tells that
+ * the counter restarted, and dwt_ostr_disarm() stops further edges from resetting it again.
+ *
+ * input parameters
+ * @param wait - cycles of the 38.4 MHz clock between the SYNC edge and the reset, up to DWT_OSTR_WAIT_MAX
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the schedule queue has events pending (see dwt_sched_init)
+ */
+int dwt_ostr_arm(uint8_t wait);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function disarms the one shot timebase reset: SYNC edges no longer reset the system time counter.
+ * GPIO7 is left in its SYNC function.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_ostr_disarm(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function checks that the system time counter restarted on the SYNC edge: read right after the edge,
+ * the system time is no more than the time since the edge. A counter that did not restart is anywhere in its
+ * ~17.2 s range, so it passes with a probability of max_us in 17.2 s.
+ *
+ * input parameters
+ * @param max_us - longest time since the SYNC edge, in microseconds (read latency and host timer resolution included)
+ *
+ * output parameters
+ * @param systime - SYS_TIME read (high 32 bits of the device time, DWT_SYSTIME_PER_US per microsecond), may be NULL
+ *
+ * returns DWT_SUCCESS if the counter restarted, or DWT_ERROR if not
+ */
+int dwt_ostr_check(uint32_t max_us, uint32_t *systime);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function enables the specified events to trigger an interrupt.
  * The following events can be found in SYS_ENABLE_LO and SYS_ENABLE_HI registers.
@@ -1595,7 +2251,9 @@ uint8_t dwt_aon_read(uint16_t aon_address);
 void dwt_aon_write(uint16_t aon_address, uint8_t aon_write_data);
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is used to read the OTP data from given address into provided array
+ * @brief This is used to read the OTP data from given address into provided array. The OTP words dwt_initialise()
+ * uses (addresses below DWT_OTP_SHADOW_WORDS, 0x21 by default) are kept in a RAM shadow: each is read from the OTP
+ * once after dwt_initialise(), and dwt_otpwriteandverify() updates it.
  *
  * input parameters
  * @param address - this is the OTP address to read from
@@ -1666,6 +2324,61 @@ uint8_t dwt_generatecrc8(const uint8_t* byteArray, int flen, uint8_t crcInit);
  */
 void dwt_enablespicrccheck(dwt_spi_crc_mode_e crc_mode, dwt_spierrcb_t spireaderr_cb);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This function enables/disables the register shadow cache. When enabled, reads of the static configuration
+ * registers (SYS_CFG, PANADR, ADR_FILT_CFG, TX_FCTRL, CHAN_CTRL, GPIO_MODE, DTUNE0, CLK_CTRL, LED_CTRL) are served
+ * from RAM once known, writes are written through (and skipped if the value is unchanged), and AND/OR modifies
+ * become a single write of the new value. The cache is invalidated by dwt_softreset(), dwt_entersleep(),
+ * dwt_wakeup_ic() and the SPI ready event; it is held off by dwt_entersleepaftertx(1) as the device may then go to
+ * sleep without the host knowing, and dwt_entersleepaftertx(0) restores it (empty) as it was, or as set meanwhile.
+ * NOTE: when waking the device by other means (e.g. CS), call dwt_enableregcache() again to invalidate the cache.
+ *
+ * input parameters
+ * @param enable - 1 to enable, 0 to disable (and invalidate) the cache
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_enableregcache(int enable);
+
+#ifdef DWT_SPI_PROFILE
+// SPI traffic profiler access types
+typedef enum
+{
+    DWT_SPI_PROF_FAC = 0,       // fast command
+    DWT_SPI_PROF_FARW_WR,       // fast access write (register offset 0)
+    DWT_SPI_PROF_FARW_RD,       // fast access read (register offset 0)
+    DWT_SPI_PROF_EAMRW_WR,      // extended address write
+    DWT_SPI_PROF_EAMRW_RD,      // extended address read
+    DWT_SPI_PROF_AND_OR,        // AND/OR modify
+    DWT_SPI_PROF_BATCH,         // dwt_batch_begin()/dwt_batch_end() queue flush (regFileID 0)
+    DWT_SPI_PROF_COUNT
+} dwt_spi_prof_type_e;
+
+// SPI traffic profiler entry, one per register file ID and access type
+typedef struct
+{
+    uint32_t regFileID;         // register file ID as passed to the driver (e.g. SYS_STATUS_ID)
+    uint8_t  type;              // dwt_spi_prof_type_e
+    uint32_t count;             // number of transactions
+    uint32_t bytes;             // bytes on the bus (header, data and crc)
+    uint64_t cycles;            // cumulative bus time in hardware cycles
+} dwt_spi_profile_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief SPI traffic profiler, compiled in when DWT_SPI_PROFILE is defined. Every SPI transaction issued by the
+ * driver is counted per register file ID and access type (FAC, FARW, EAMRW, AND/OR, batch), with the bytes on the
+ * bus and the time spent in the platform SPI call. Accesses served from the register shadow cache are not counted.
+ *
+ * dwt_spi_profile_get() returns the table and sets count to the number of entries used,
+ * dwt_spi_profile_reset() clears it, dwt_spi_profile_dump() logs it.
+ */
+const dwt_spi_profile_t *dwt_spi_profile_get(uint16_t *count);
+void dwt_spi_profile_reset(void);
+void dwt_spi_profile_dump(void);
+#endif
+
 /*! ------------------------------------------------------------------------------------------------------------------
 * @brief This call enables the auto-ACK feature. If the responseDelayTime (parameter) is 0, the ACK will be sent a.s.a.p.
 * otherwise it will be sent with a programmed delay (in symbols), max is 255.
@@ -1720,6 +2433,27 @@ void dwt_softreset(void);
  */
 void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is the asynchronous version of dwt_readrxdata(). It starts the read of the RX buffer and returns as soon
+ * as the SPI transfer is queued; the completion call-back is called (typically from interrupt context) when the data
+ * has been received into the buffer. The buffer must stay valid until then.
+ *
+ * NOTE: the SPI read CRC check (DWT_SPI_CRC_MODE_WRRD) is not performed for asynchronous reads.
+ *       requires CONFIG_SPI_ASYNC=y in the platform; only one asynchronous transfer may be in progress at a time.
+ *
+ * input parameters
+ * @param buffer - the buffer into which the data will be read
+ * @param length - the length of data to read (in bytes)
+ * @param rxBufferOffset - the offset in the rx buffer from which to read the data
+ * @param cb     - completion call-back, may be NULL
+ * @param arg    - user argument passed to the call-back
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+ */
+int dwt_readrxdata_async(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset, dwt_spi_done_cb_t cb, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to read the data from the RX scratch buffer, from an offset location given by offset parameter.
  *
@@ -1755,6 +2489,106 @@ void dwt_read_rx_scratch_data(uint8_t *buffer, uint16_t length, uint16_t rxBuffe
  */
 void dwt_readaccdata(uint8_t *buffer, uint16_t len, uint16_t accOffset);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is the asynchronous version of dwt_readaccdata(). The ACC clocks are forced on and the read of the
+ * accumulator is started; the completion call-back is called (typically from interrupt context) when the data has been
+ * received into the buffer. Once complete, dwt_readaccdata_async_done() must be called from thread context to revert
+ * the ACC clocks.
+ *
+ * NOTE: requires CONFIG_SPI_ASYNC=y in the platform; only one asynchronous transfer may be in progress at a time.
+ *
+ * input parameters
+ * @param buffer - the buffer into which the data will be read (first octet is a dummy octet, see dwt_readaccdata)
+ * @param len    - the length of data to read (in bytes)
+ * @param accOffset - the offset in the acc buffer from which to read the data, this is a complex sample index
+ * @param cb     - completion call-back, may be NULL
+ * @param arg    - user argument passed to the call-back
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+ */
+int dwt_readaccdata_async(uint8_t *buffer, uint16_t len, uint16_t accOffset, dwt_spi_done_cb_t cb, void *arg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This reverts the ACC clocks forced on by dwt_readaccdata_async(), call it once the transfer has completed
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_readaccdata_async_done(void);
+
+// Span read memories (see dwt_readspan_begin)
+typedef enum
+{
+    DWT_SPAN_RX = 0,            // current RX buffer, the unit is the byte
+    DWT_SPAN_ACC                // accumulator, the unit is the complex sample (6 bytes)
+} dwt_span_mem_e;
+
+#define DWT_SPAN_ACC_MAX_SAMPLES    2048    // accumulator size in complex samples
+
+// Span read state, one per span being read
+typedef struct
+{
+    uint32_t file_id;           // buffer file ID
+    uint16_t next;              // next unit to read
+    uint16_t end;               // end of the span
+    uint8_t  mem;               // dwt_span_mem_e
+} dwt_span_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This starts a span read: a large region of the RX buffer or of the accumulator read in sequential chunks
+ * with dwt_readspan(), e.g. a long frame or a CIR streamed out piece by piece. Beyond the sub-address range
+ * (offset 127) the chunks are read through indirect pointer A, which the driver only moves when a chunk starts more
+ * than 127 units past the offset it was last programmed with: one ADDR_OFFSET_A write per 128 units instead of two
+ * register writes per chunk. For the accumulator the ACC clocks are forced on once for the whole span.
+ *
+ * NOTE: the RX buffer is the one current at dwt_readspan_begin() (double buffer mode). dwt_readrxdata(),
+ * dwt_readaccdata() and their asynchronous versions share the indirect pointer A set up and can be mixed with a span.
+ *
+ * input parameters
+ * @param span   - span read state
+ * @param mem    - DWT_SPAN_RX or DWT_SPAN_ACC
+ * @param offset - first unit of the span, byte (DWT_SPAN_RX) or complex sample index (DWT_SPAN_ACC)
+ * @param length - number of units in the span
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the span is beyond the end of the buffer
+ */
+int dwt_readspan_begin(dwt_span_t *span, dwt_span_mem_e mem, uint16_t offset, uint16_t length);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This reads the next chunk of a span started with dwt_readspan_begin()
+ *
+ * input parameters
+ * @param span   - span read state
+ * @param count  - number of units to read, bytes (DWT_SPAN_RX) or complex samples (DWT_SPAN_ACC)
+ *
+ * output parameters
+ * @param buffer - the buffer into which the data will be read: count bytes (DWT_SPAN_RX), or count * 6 + 1 bytes, the
+ *                 first octet being the dummy octet (DWT_SPAN_ACC, see dwt_readaccdata)
+ *
+ * returns the number of units read, fewer than count at the end of the span, 0 once the span has been read
+ */
+uint16_t dwt_readspan(dwt_span_t *span, uint8_t *buffer, uint16_t count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This ends a span read, reverting the ACC clocks of a DWT_SPAN_ACC span. Call it also when the span is
+ * abandoned before its end.
+ *
+ * input parameters
+ * @param span   - span read state
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_readspan_end(dwt_span_t *span);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to read the crystal offset (relating to the frequency offset of the far DW3000 device compared to this one)
  *        Note: the returned signed 16-bit number shoudl be divided by 16 to get ppm offset.
@@ -1819,6 +2653,7 @@ int dwt_readstsquality(int16_t* rxStsQualityIndex);
  */
 int dwt_readstsstatus(uint16_t* stsStatus, int sts_num);
 
+#ifndef DWT_NO_DIAG
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief this function reads the RX signal quality diagnostic data
  *
@@ -1831,6 +2666,25 @@ int dwt_readstsstatus(uint16_t* stsStatus, int sts_num);
  */
 void dwt_readdiagnostics(dwt_rxdiag_t * diagnostics);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function reads only the selected fields of the RX signal quality diagnostic data: the registers of the
+ * fields asked for are read in as few SPI transactions as possible (short gaps between them are read through), instead
+ * of the whole diagnostic block. E.g. first path index and channel power (DWT_DIAG_IP_FP | DWT_DIAG_IP_POWER) are 6
+ * bytes in two short reads, instead of the 216 byte block. Fields that the CIA does not log with the current
+ * dwt_configciadiag() setting are not read.
+ * Like dwt_readdiagnostics(), it reads the buffer the host accesses in double buffer mode.
+ *
+ * input parameters
+ * @param diagnostics - diagnostic structure pointer, only the fields selected are written
+ * @param fields - DWT_DIAG_xxx fields to read
+ *
+ * output parameters
+ *
+ * returns the DWT_DIAG_xxx fields read
+ */
+uint32_t dwt_readdiagnostics_sel(dwt_rxdiag_t * diagnostics, uint32_t fields);
+#endif
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to enable/disable the event counter in the IC
  *
@@ -1854,8 +2708,10 @@ void dwt_configeventcounters(int enable);
  */
 void dwt_readeventcounters(dwt_deviceentcnts_t *counters);
 
+#ifndef DWT_NO_OTP_PROG
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief This is used to program 32-bit value into the DW3000 OTP memory.
+ * @brief This is used to program 32-bit value into the DW3000 OTP memory. The word is read back from the OTP, and
+ * the OTP shadow (see dwt_otpread) updated with it.
  *
  * input parameters
  * @param value - this is the 32-bit value to be programmed into OTP
@@ -1866,6 +2722,7 @@ void dwt_readeventcounters(dwt_deviceentcnts_t *counters);
  * returns DWT_SUCCESS for success, or DWT_ERROR for error
  */
 int dwt_otpwriteandverify(uint32_t value, uint16_t address);
+#endif
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to set up Tx/Rx GPIOs which could be used to control LEDs
@@ -1910,6 +2767,7 @@ void dwt_setxtaltrim(uint8_t value);
  */
 uint8_t dwt_getxtaltrim(void);
 
+#ifndef DWT_NO_TEST_MODES
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This function enables repeated frames to be generated given a frame repetition rate.
  *
@@ -1962,6 +2820,20 @@ void dwt_configcwmode(uint8_t channel);
  */
 void dwt_configcontinuousframemode(uint32_t framerepetitionrate, uint8_t channel);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function takes the DW3000 out of the continuous wave (dwt_configcwmode) or continuous frame
+ * (dwt_configcontinuousframemode) mode without a reset. The configuration is kept: the device is ready for another
+ * test mode, a new TX configuration (dwt_configuretxrf) or a normal transmission.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_disablecontinuousmode(void);
+#endif
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief this function reads the raw battery voltage and temperature values of the DW IC.
  * The values read here will be the current values sampled by DW IC AtoD converters.
@@ -2256,6 +3128,7 @@ void dwt_modify8bitoffsetreg(const int regFileID, const int regOffset, const uin
 /*                                                AES BLOCK                                                         */
 /********************************************************************************************************************/
 
+#ifndef DWT_NO_AES
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief   This function provides the API for the configuration of the AES key before first usage.
  * @param   key - pointer to the key which will be programmed to the Key register
@@ -2308,6 +3181,33 @@ dwt_mic_size_e dwt_mic_size_from_bytes(uint8_t mic_size_in_bytes);
  */
 int8_t dwt_do_aes(dwt_aes_job_t *job, dwt_aes_core_type_e core_type);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief   This function starts an encrypt/decrypt job as dwt_do_aes() does, but returns as soon as the AES block is
+ *          started, so the host can prepare the next frame (e.g. write it to another TX buffer offset) while the
+ *          current one is encrypted/decrypted in the IC buffers. The job completes in dwt_isr() on the AES_DONE (or
+ *          AES_ERR) event: the decrypted frame is read back as in dwt_do_aes() and cb is called with the AES_STS_ID
+ *          status bits. SYS_STATUS AES_DONE/AES_ERR are enabled as interrupts for the duration of the job.
+ *
+ *          One job at a time. An encryption frame is written to the IC before dwt_do_aes_async() returns, the header
+ *          and payload of a decryption are read back on completion: the job (and, for a decryption, the buffers it
+ *          points to) must stay valid until the callback. The next job can be started from the callback. dwt_configure_aes() must not be called while a job runs.
+ *
+ * @param job - pointer to AES job, contains data info and encryption info.
+ * @param core_type - Core type
+ * @param cb - completion callback, called from dwt_isr() (can be NULL, then poll dwt_aes_busy())
+ *
+ * @return  DWT_SUCCESS when started, ERROR_AES_BUSY if a job is already running, or the dwt_do_aes() errors
+ */
+int8_t dwt_do_aes_async(dwt_aes_job_t *job, dwt_aes_core_type_e core_type, dwt_aes_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief   This function returns whether a job started by dwt_do_aes_async() is still running
+ *
+ * @return  1 if running, 0 otherwise
+ */
+uint8_t dwt_aes_busy(void);
+#endif
+
 /****************************************************************************************************************************************************
  *
  * Declaration of platform-dependent lower level functions.
@@ -2316,6 +3216,33 @@ int8_t dwt_do_aes(dwt_aes_job_t *job, dwt_aes_core_type_e core_type);
 
 extern void wakeup_device_with_io(void);
 
+/* Timing probes, see port_probe_start() in port.h. Enabled with DWM_PROBES defined, else compiled out. */
+typedef enum
+{
+    DWT_PROBE_SPI = 0,      // SPI transfer (platform)
+    DWT_PROBE_ISR,          // dwt_isr() entry to exit
+    DWT_PROBE_CB,           // dwt_isr() callback dispatch (cbTxDone/cbRxOk/cbRxTo/cbRxErr)
+    DWT_PROBE_DLY_TX,       // delayed dwt_starttx(): command to late check done
+    DWT_PROBE_USER0,        // free for application use
+    DWT_PROBE_USER1,
+    DWT_PROBE_COUNT
+} dwt_probe_e;
+
+#if defined(DWM_PROBES)
+extern void port_probe_start(int probe);
+extern void port_probe_stop(int probe);
+#define DWT_PROBE_START(p)  port_probe_start(p)
+#define DWT_PROBE_STOP(p)   port_probe_stop(p)
+#else
+#define DWT_PROBE_START(p)
+#define DWT_PROBE_STOP(p)
+#endif
+
+/* Per device lock, used with DWT_THREAD_SAFE defined (see dwt_lock()). The platform must allow the
+ * same thread to take the lock again (e.g. a k_mutex), and must not block when called from an ISR. */
+extern void port_dw_ic_lock(unsigned int index);
+extern void port_dw_ic_unlock(unsigned int index);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief  This function wakeup device by an IO pin
  *
@@ -2372,6 +3299,52 @@ extern int writetospiwithcrc(uint16_t headerLength, const uint8_t *headerBuffer,
  */
 extern int writetospi(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodylength, const uint8_t *bodyBuffer);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief
+ * Low level abstract functions to start an asynchronous write to / read from the SPI.
+ * These return as soon as the transfer is started, the call-back 'cb' is called with DWT_SUCCESS or DWT_ERROR when
+ * the transfer completes (typically from interrupt context). The header (and crc8) are copied by the platform, the body
+ * and read buffers must remain valid until the call-back is called. Only one asynchronous transfer may be in progress.
+ *
+ * Note: The body of these functions is defined in deca_spi.c and is platform specific
+ *
+ * input parameters:
+ * @param headerLength  - number of bytes header being written
+ * @param headerBuffer  - pointer to buffer containing the 'headerLength' bytes of header to be written
+ * @param bodylength    - number of bytes data being written
+ * @param bodyBuffer    - pointer to buffer containing the 'bodylength' bytes od data to be written
+ * @param crc8          - 8-bit crc, calculated on the header and data bytes
+ * @param readlength    - number of bytes data being read
+ * @param readBuffer    - pointer to buffer to return the data in
+ * @param cb            - completion call-back, may be NULL
+ * @param arg           - user argument passed to the call-back
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+ */
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief
+ * Low level abstract function to send a batch of complete SPI write transactions back to back, each transaction
+ * (header, data and crc8 if used) with its own chip select.
+ *
+ * Note: The body of this function is defined in deca_spi.c and is platform specific
+ *
+ * input parameters:
+ * @param count         - number of transactions
+ * @param lengths       - length of each transaction
+ * @param buffer        - the transactions, back to back
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+extern int writetospi_batch(uint16_t count, const uint16_t *lengths, const uint8_t *buffer);
+
+extern int writetospi_async(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodylength, const uint8_t *bodyBuffer, dwt_spi_done_cb_t cb, void *arg);
+extern int writetospiwithcrc_async(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodylength, const uint8_t *bodyBuffer, uint8_t crc8, dwt_spi_done_cb_t cb, void *arg);
+extern int readfromspi_async(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t readlength, uint8_t *readBuffer, dwt_spi_done_cb_t cb, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief
  * NB: In porting this to a particular microprocessor, the implementer needs to define the two low
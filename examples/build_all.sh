@@ -32,10 +32,12 @@ rm -rf ex_03b_rx_send_resp/build
 rm -rf ex_03d_tx_wait_resp_interrupts/build
 rm -rf ex_04a_cont_wave/build
 rm -rf ex_04b_cont_frame/build
+rm -rf ex_04c_rf_test/build
 rm -rf ex_05a_ds_twr_init/build
 rm -rf ex_05b_ds_twr_resp/build
 rm -rf ex_05c_ds_twr_init_sts_sdc/build
 rm -rf ex_05d_ds_twr_resp_sts_sdc/build
+rm -rf ex_05e_twr_engine/build
 rm -rf ex_06a_ss_twr_initiator/build
 rm -rf ex_06b_ss_twr_responder/build
 rm -rf ex_06e_AES_ss_twr_initiator/build
@@ -43,11 +45,19 @@ rm -rf ex_06f_AES_ss_twr_responder/build
 rm -rf ex_07a_ack_data_tx/build
 rm -rf ex_07b_ack_data_rx/build
 rm -rf ex_07c_ack_data_rx_dbl_buff/build
+rm -rf ex_07d_data_xfer/build
+rm -rf ex_08a_tdoa_gateway/build
 rm -rf ex_11a_spi_crc/build
 rm -rf ex_13a_gpio/build
 rm -rf ex_14a_otp_write/build
 rm -rf ex_15a_le_pend_tx/build
 rm -rf ex_15b_le_pend_rx/build
+rm -rf ex_20a_spi_bench/build
+rm -rf ex_20b_twr_bench_init/build
+rm -rf ex_20c_twr_bench_resp/build
+rm -rf ex_20d_spi_budget/build
+rm -rf ex_20e_xfer_dbl_buff/build
+rm -rf ex_20f_frame_parse/build
 
 pushd .; cd ex_00a_reading_dev_id           ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_01a_simple_tx                ; ./configure.sh; cd build; make -j4; popd
@@ -70,10 +80,12 @@ pushd .; cd ex_03b_rx_send_resp             ; ./configure.sh; cd build; make -j4
 pushd .; cd ex_03d_tx_wait_resp_interrupts  ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_04a_cont_wave                ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_04b_cont_frame               ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_04c_rf_test                  ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_05a_ds_twr_init              ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_05b_ds_twr_resp              ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_05c_ds_twr_init_sts_sdc      ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_05d_ds_twr_resp_sts_sdc      ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_05e_twr_engine               ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_06a_ss_twr_initiator         ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_06b_ss_twr_responder         ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_06e_aes_ss_twr_initiator     ; ./configure.sh; cd build; make -j4; popd
@@ -81,11 +93,19 @@ pushd .; cd ex_06f_aes_ss_twr_responder     ; ./configure.sh; cd build; make -j4
 pushd .; cd ex_07a_ack_data_tx              ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_07b_ack_data_rx              ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_07c_ack_data_rx_dbl_buff     ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_07d_data_xfer                ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_08a_tdoa_gateway             ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_11a_spi_crc                  ; ./configure.sh; cd build; make -j4; popd;
 pushd .; cd ex_13a_gpio                     ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_14a_otp_write                ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_15a_le_pend_tx               ; ./configure.sh; cd build; make -j4; popd
 pushd .; cd ex_15b_le_pend_rx               ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_20a_spi_bench                ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_20b_twr_bench_init           ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_20c_twr_bench_resp           ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_20d_spi_budget               ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_20e_xfer_dbl_buff            ; ./configure.sh; cd build; make -j4; popd
+pushd .; cd ex_20f_frame_parse              ; ./configure.sh; cd build; make -j4; popd
 
 cp ./ex_00a_reading_dev_id/build/zephyr/zephyr.hex           ./bin/ex_00a_reading_dev_id.hex
 cp ./ex_01a_simple_tx/build/zephyr/zephyr.hex                ./bin/ex_01a_simple_tx.hex
@@ -108,10 +128,12 @@ cp ./ex_03b_rx_send_resp/build/zephyr/zephyr.hex             ./bin/ex_03b_rx_sen
 cp ./ex_03d_tx_wait_resp_interrupts/build/zephyr/zephyr.hex  ./bin/ex_03d_tx_wait_resp_interrupts.hex
 cp ./ex_04a_cont_wave/build/zephyr/zephyr.hex                ./bin/ex_04a_cont_wave.hex
 cp ./ex_04b_cont_frame/build/zephyr/zephyr.hex               ./bin/ex_04b_cont_frame.hex
+cp ./ex_04c_rf_test/build/zephyr/zephyr.hex                  ./bin/ex_04c_rf_test.hex
 cp ./ex_05a_ds_twr_init/build/zephyr/zephyr.hex              ./bin/ex_05a_ds_twr_init.hex
 cp ./ex_05b_ds_twr_resp/build/zephyr/zephyr.hex              ./bin/ex_05b_ds_twr_resp.hex
 cp ./ex_05c_ds_twr_init_sts_sdc/build/zephyr/zephyr.hex      ./bin/ex_05c_ds_twr_init_sts_sdc.hex
 cp ./ex_05d_ds_twr_resp_sts_sdc/build/zephyr/zephyr.hex      ./bin/ex_05d_ds_twr_resp_sts_sdc.hex
+cp ./ex_05e_twr_engine/build/zephyr/zephyr.hex               ./bin/ex_05e_twr_engine.hex
 cp ./ex_06a_ss_twr_initiator/build/zephyr/zephyr.hex         ./bin/ex_06a_ss_twr_initiator.hex
 cp ./ex_06b_ss_twr_responder/build/zephyr/zephyr.hex         ./bin/ex_06b_ss_twr_responder.hex
 cp ./ex_06e_aes_ss_twr_initiator/build/zephyr/zephyr.hex     ./bin/ex_06e_aes_ss_twr_initiator.hex
@@ -119,11 +141,19 @@ cp ./ex_06f_aes_ss_twr_responder/build/zephyr/zephyr.hex     ./bin/ex_06f_aes_ss
 cp ./ex_07a_ack_data_tx/build/zephyr/zephyr.hex              ./bin/ex_07a_ack_data_tx.hex
 cp ./ex_07b_ack_data_rx/build/zephyr/zephyr.hex              ./bin/ex_07b_ack_data_rx.hex
 cp ./ex_07c_ack_data_rx_dbl_buff/build/zephyr/zephyr.hex     ./bin/ex_07c_ack_data_rx_dbl_buff.hex
+cp ./ex_07d_data_xfer/build/zephyr/zephyr.hex                ./bin/ex_07d_data_xfer.hex
+cp ./ex_08a_tdoa_gateway/build/zephyr/zephyr.hex             ./bin/ex_08a_tdoa_gateway.hex
 cp ./ex_11a_spi_crc/build/zephyr/zephyr.hex                  ./bin/ex_11a_spi_crc.hex
 cp ./ex_13a_gpio/build/zephyr/zephyr.hex                     ./bin/ex_13a_gpio.hex
 cp ./ex_14a_otp_write/build/zephyr/zephyr.hex                ./bin/ex_14a_otp_write.hex
 cp ./ex_15a_le_pend_tx/build/zephyr/zephyr.hex               ./bin/ex_15a_le_pend_tx.hex
 cp ./ex_15b_le_pend_rx/build/zephyr/zephyr.hex               ./bin/ex_15b_le_pend_rx.hex
+cp ./ex_20a_spi_bench/build/zephyr/zephyr.hex                ./bin/ex_20a_spi_bench.hex
+cp ./ex_20b_twr_bench_init/build/zephyr/zephyr.hex           ./bin/ex_20b_twr_bench_init.hex
+cp ./ex_20c_twr_bench_resp/build/zephyr/zephyr.hex           ./bin/ex_20c_twr_bench_resp.hex
+cp ./ex_20d_spi_budget/build/zephyr/zephyr.exe               ./bin/ex_20d_spi_budget.exe
+cp ./ex_20e_xfer_dbl_buff/build/zephyr/zephyr.exe            ./bin/ex_20e_xfer_dbl_buff.exe
+cp ./ex_20f_frame_parse/build/zephyr/zephyr.exe              ./bin/ex_20f_frame_parse.exe
 
 rm -rf ex_00a_reading_dev_id/build
 rm -rf ex_01a_simple_tx/build
@@ -146,10 +176,12 @@ rm -rf ex_03b_rx_send_resp/build
 rm -rf ex_03d_tx_wait_resp_interrupts/build
 rm -rf ex_04a_cont_wave/build
 rm -rf ex_04b_cont_frame/build
+rm -rf ex_04c_rf_test/build
 rm -rf ex_05a_ds_twr_init/build
 rm -rf ex_05b_ds_twr_resp/build
 rm -rf ex_05c_ds_twr_init_sts_sdc/build
 rm -rf ex_05d_ds_twr_resp_sts_sdc/build
+rm -rf ex_05e_twr_engine/build
 rm -rf ex_06a_ss_twr_initiator/build
 rm -rf ex_06b_ss_twr_responder/build
 rm -rf ex_06e_aes_ss_twr_initiator/build
@@ -157,8 +189,16 @@ rm -rf ex_06f_aes_ss_twr_responder/build
 rm -rf ex_07a_ack_data_tx/build
 rm -rf ex_07b_ack_data_rx/build
 rm -rf ex_07c_ack_data_rx_dbl_buff/build
+rm -rf ex_07d_data_xfer/build
+rm -rf ex_08a_tdoa_gateway/build
 rm -rf ex_11a_spi_crc/build
 rm -rf ex_13a_gpio/build
 rm -rf ex_14a_otp_write/build
 rm -rf ex_15a_le_pend_tx/build
 rm -rf ex_15b_le_pend_rx/build
+rm -rf ex_20a_spi_bench/build
+rm -rf ex_20b_twr_bench_init/build
+rm -rf ex_20c_twr_bench_resp/build
+rm -rf ex_20d_spi_budget/build
+rm -rf ex_20e_xfer_dbl_buff/build
+rm -rf ex_20f_frame_parse/build
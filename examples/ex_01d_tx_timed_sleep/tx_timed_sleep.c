@@ -17,6 +17,7 @@
 #include <deca_spi.h>
 #include <port.h>
 #include <shared_defines.h>
+#include <tdma_sleep.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -71,6 +72,11 @@ static uint8_t tx_msg[] = {0xC5, 0, 'D', 'E', 'C', 'A', 'W', 'A', 'V', 'E', 0, 0
  * to wake up and prepare the next frame. */
 #define SLEEP_TIME_MS (TX_DELAY_MS - 10)
 
+#ifdef TX_TIMED_SLEEP_TDMA
+/* Slot scheduler statistics period, in frames */
+#define TDMA_STATS_FRAMES 16
+#endif
+
 /* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth 
  * and power of the spectrum at the current
  * temperature. These values can be calibrated prior to taking reference
@@ -88,7 +94,12 @@ static void spi_ready_cb(const dwt_cb_data_t *cb_data);
  */
 int app_main(void)
 {
+#ifdef TX_TIMED_SLEEP_TDMA
+    tdma_sleep_config_t tdma_cfg;
+    tdma_sleep_wake_t wake;
+#else
     uint16_t lp_osc_freq, sleep_cnt;
+#endif
 
     /* Display application name on LCD. */
     LOG_INF(APP_NAME);
@@ -117,12 +128,23 @@ int app_main(void)
      * else it may trigger incorrectly when the device is sleeping */
     port_set_dwic_isr(dwt_isr);
 
+#ifdef TX_TIMED_SLEEP_TDMA
+    /* Calibrate the LP oscillator, the sleep count is programmed before each sleep. See NOTE 8 below. */
+    tdma_sleep_default_config(&tdma_cfg);
+    tdma_cfg.superframe_uus = TX_DELAY_MS * 1000;
+    if (tdma_sleep_init(&tdma_cfg) != DWT_SUCCESS)
+    {
+        LOG_ERR("SLEEP CALIBRATION FAILED");
+        while (1) { /* spin */ };
+    }
+#else
     /* Calibrate and configure sleep count. */
     lp_osc_freq = XTAL_FREQ_HZ / dwt_calibratesleepcnt();
     sleep_cnt = ((SLEEP_TIME_MS * ((uint32_t) lp_osc_freq)) / 1000) >> 12;
 
     // sleep_cnt = 0x06; // 1 step is ~ 175ms, 6 ~= 1s
     dwt_configuresleepcnt(sleep_cnt);
+#endif
 
     /* Configure DW IC. See NOTE 6 below. */
     /* If the dwt_configure returns DWT_ERROR either the PLL or RX calibration 
@@ -171,6 +193,30 @@ int app_main(void)
         /* Clear TX frame sent event. */
         dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS_BIT_MASK);
 
+#ifdef TX_TIMED_SLEEP_TDMA
+        /* The frame TX time is the slot reference: wake up for the next slot one superframe later */
+        uint32_t since_tx = dwt_readsystimestamphi32() - dwt_readtxtimestamphi32();
+
+        if (tdma_sleep_next((uint32_t)(((uint64_t)since_tx << 8) / UUS_TO_DWT_TIME), &wake) != DWT_SUCCESS)
+        {
+            LOG_ERR("slot missed");
+            continue;
+        }
+
+        if (wake.count != 0)
+        {
+            /* Stay in IDLE_RC after the wake-up, for the residual */
+            dwt_entersleep(DWT_DW_IDLE_RC);
+
+            sleeping = 1;
+            while (sleeping) { /* spin */ }; /* Wait for device to wake up */
+        }
+
+        /* Wait the part of the interval below one sleep count, lock the PLL, then wait the slot start */
+        k_usleep(wake.residual_uus);
+        dwt_setdwstate(DWT_DW_IDLE);
+        k_usleep(wake.guard_uus);
+#else
         /* Put DW IC to sleep. Go to IDLE state after wakeup*/
         dwt_entersleep(DWT_DW_IDLE);
 
@@ -179,6 +225,7 @@ int app_main(void)
         /* In this example, there is nothing to do to wake the DW IC up as it 
          * is handled by the sleep timer. */
         while (sleeping) { /* spin */ }; /* Wait for device to wake up */
+#endif
 
 
         /* Increment the blink frame sequence number (modulo 256). */
@@ -186,6 +233,16 @@ int app_main(void)
         
         /* Reflect frame number */
         LOG_INF("frame: %d", (int) tx_msg[BLINK_FRAME_SN_IDX]);
+
+#ifdef TX_TIMED_SLEEP_TDMA
+        if ((tx_msg[BLINK_FRAME_SN_IDX] % TDMA_STATS_FRAMES) == 0)
+        {
+            const tdma_sleep_stats_t *st = tdma_sleep_get_stats();
+
+            LOG_INF("sleep unit %u ns (cal %u, trim %d), %u cals", st->unit_ns, st->cal_unit_ns, st->trim_ns,
+                    st->cals);
+        }
+#endif
     }
 }
 
@@ -233,4 +290,9 @@ static void spi_ready_cb(const dwt_cb_data_t *cb_data)
  *    configuration.
  * 7. We use polled mode of operation here to keep the example as simple as possible, but the TXFRS status event can be used to generate an interrupt.
  *    Please refer to DW IC User Manual for more details on "interrupts".
+ * 8. With TX_TIMED_SLEEP_TDMA the frames go out in a TX_DELAY_MS slot period instead of "sleep time plus processing time": ranging/tdma_sleep.c
+ *    programs the sleep count for each interval from the time already spent since the last frame, recalibrates the LP oscillator every 16
+ *    wake-ups (averaging 4 calibrations), and the host waits the residual below one sleep count (NOTE 2) after the wake-up. The frame TX time is
+ *    the slot reference, so the period is held open loop, on the calibrations. A tag synchronised to an anchor frame opening its slot would also
+ *    call tdma_sleep_ref() with the time of that frame in its receive window, which trims the sleep count unit against the UWB clock.
  ****************************************************************************************************************************************************/
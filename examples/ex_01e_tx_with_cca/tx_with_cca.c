@@ -35,6 +35,7 @@
 #include <deca_spi.h>
 #include <port.h>
 #include <shared_defines.h>
+#include <mac_csma.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -87,18 +88,15 @@ static uint8_t tx_msg[] = {0xC5, 0, 'D', 'E', 'C', 'A', 'W', 'A', 'V', 'E'};
  * this example will try to transmit a frame every 100 ms*/
 #define TX_DELAY_MS 100
 
-/* Initial backoff period when failed to transmit a frame due to preamble detection. */
-#define INITIAL_BACKOFF_PERIOD 400 /* This constant would normally smaller (e.g. 1ms),
-                                    * however here it is set to 400 ms so that
-                                    * user can see (on Zephyr RTT console) the report 
-                                    * that the CCA detects a preamble on the air occasionally,
-                                    * and is doing a TX back-off.
-                                    */
+/* Channel access: random binary exponential backoff on busy CCAs, see mac_csma.h.
+ * The backoff unit would normally be smaller (e.g. 1 ms), however here it is set
+ * to 50 ms so that the user can see (on Zephyr RTT console) the report that the
+ * CCA detects a preamble on the air occasionally, and is doing a TX back-off. */
+#define CSMA_UNIT_US 50000
 
-int tx_sleep_period; /* Sleep period until the next TX attempt */
+static mac_csma_t csma;
 
-/* Next backoff in the event of busy channel detection by this pseudo CCA algorithm */
-int next_backoff_interval = INITIAL_BACKOFF_PERIOD;
+int tx_sleep_period; /* Sleep period until the next frame */
 
 /* holds copy of status register */
 uint32_t status_reg = 0;
@@ -154,9 +152,17 @@ int app_main(void)
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
 
-    /* Configure preamble timeout to 3 PACs; if no preamble detected in this 
+    /* CCA window of 3 PACs (preamble timeout); if no preamble detected in this
      * time we assume channel is clear. See NOTE 4*/
-    dwt_setpreambledetecttimeout(3);
+    {
+        mac_csma_config_t csma_cfg;
+
+        mac_csma_default_config(&csma_cfg);
+        csma_cfg.unit_uus = CSMA_UNIT_US;
+        mac_csma_init(&csma, &csma_cfg);
+    }
+
+    mac_csma_begin(&csma);
 
     /* Loop forever sending frames periodically. */
     while(1)
@@ -169,7 +175,7 @@ int app_main(void)
          * there is no preamble detected within 3 PACs as defined above
          * e.g. once we get the preamble timeout or TX will be canceled if a 
          * preamble is detected. */
-        dwt_starttx(DWT_START_TX_CCA);
+        mac_csma_tx(&csma, DWT_START_TX_IMMEDIATE);
 
         /* Poll DW3000 until either TX complete or CCA_FAIL. See NOTE 6 below. */
         while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & SYS_STATUS_TXFRS_BIT_MASK))
@@ -181,34 +187,52 @@ int app_main(void)
 
         if (status_reg & SYS_STATUS_TXFRS_BIT_MASK)
         {
+            uint8_t busy = mac_csma_sent(&csma);
+
             tx_sleep_period = TX_DELAY_MS; /* sent a frame - set interframe period */
-            next_backoff_interval = INITIAL_BACKOFF_PERIOD; /* set initial backoff period */
+            mac_csma_begin(&csma); /* next frame */
 
             /* Increment the blink frame sequence number (modulo 256). */
             tx_msg[BLINK_FRAME_SN_IDX]++;
 
             /* Reflect frame number */
-            LOG_INF("frame: %d", (int) tx_msg[BLINK_FRAME_SN_IDX]);
+            LOG_INF("frame: %d (%u busy CCA)", (int) tx_msg[BLINK_FRAME_SN_IDX], busy);
         }
         else
         {
-            /* If DW IC detected the preamble, device will be in IDLE */
-            tx_sleep_period = next_backoff_interval; /* set the TX sleep period */
-
-            next_backoff_interval++; /* If failed to transmit, increase backoff 
-                                      * and try again.
-                                      * In a real implementation the back-off 
-                                      * is typically a randomised period
-                                      * whose range is an exponentially related 
-                                      * to the number of successive failures.
-                                      * See https://en.wikipedia.org/wiki/Exponential_backoff */
+            /* If DW IC detected the preamble, device will be in IDLE.
+             * Back off for a random number of unit periods, whose range
+             * doubles with each busy CCA of the frame (see NOTE 8). */
+            int32_t backoff = mac_csma_busy(&csma);
+
+            dwt_write32bitreg(SYS_STATUS_HI_ID, SYS_STATUS_HI_CCA_FAIL_BIT_MASK);
+
+            if (backoff == MAC_CSMA_FAILURE)
+            {
+                const mac_csma_stats_t *stats = mac_csma_get_stats(&csma);
+
+                /* Channel access failure: drop the frame */
+                tx_msg[BLINK_FRAME_SN_IDX]++;
+                LOG_INF("frame: %d dropped (%u of %u frames)", (int) tx_msg[BLINK_FRAME_SN_IDX],
+                        stats->failures, stats->frames);
+                mac_csma_begin(&csma);
+                tx_sleep_period = TX_DELAY_MS;
+            }
+            else
+            {
+                tx_sleep_period = 0;
+                k_usleep(backoff);
+            }
         }
 
         /* Clear TX frame sent event. */
         dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS_BIT_MASK);
 
         /* Execute a delay between transmissions. */
-        Sleep(tx_sleep_period);
+        if (tx_sleep_period)
+        {
+            Sleep(tx_sleep_period);
+        }
     }
 }
 
@@ -242,4 +266,7 @@ int app_main(void)
  *    Please refer to DW3000 User Manual for more details on "interrupts".
  * 7. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *    configuration.
+ * 8. The back-off follows the IEEE 802.15.4 unslotted CSMA/CA (MAC_802_15_4/mac_csma.c): after the n-th busy CCA of a frame the device waits
+ *    a random number of unit periods in [0, 2^BE - 1], BE growing from 3 to 5, and drops the frame after 4 backoffs. The random draw is seeded from
+ *    the part ID, so that devices which collided once do not retry in step, as a fixed retry delay would make them do.
  ****************************************************************************************************************************************************/
@@ -7,7 +7,8 @@
  *               - Diagnostics data (e.g. first path index, first path amplitude,
  *                 channel impulse response, etc.). See dwt_rxdiag_t structure
  *                 for more details on the data read.
- *               - Accumulator values around the first path.
+ *               - Accumulator values around the first path, packed and
+ *                 streamed on RTT up channel 1 (see cir_stream.h).
  *           It also reads event counters (e.g. CRC good, CRC error, PHY header
  *           error, etc.) after any event, be it a good frame or an RX error.
  *           See dwt_deviceentcnts_t structure for more details on the counters
@@ -28,10 +29,12 @@
 #include <deca_spi.h>
 #include <port.h>
 #include <shared_defines.h>
+#include <cir_stream.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
 #include <zephyr/sys/printk.h>
+#include <SEGGER_RTT.h>
 
 #define LOG_LEVEL 3
 #include <zephyr/logging/log.h>
@@ -75,9 +78,30 @@ static dwt_deviceentcnts_t event_cnt;
 /* Hold copy of diagnostics data so that it can be examined at a debug breakpoint. */
 static dwt_rxdiag_t rx_diag;
 
-/* Hold copy of accumulator data so that it can be examined at a debug breakpoint. See NOTE 2. */
-#define ACCUM_DATA_LEN (3 * 2 * (3 + 3) + 1)
-static uint8_t accum_data[ACCUM_DATA_LEN];
+/* CIR records are written to RTT up channel 1, the log uses channel 0. See NOTES 2 and 6. */
+#define CIR_RTT_CHANNEL 1
+#define CIR_RTT_BUF_LEN 2048
+static uint8_t cir_rtt_buf[CIR_RTT_BUF_LEN];
+
+/* Number of the CIR record */
+static uint16_t cir_seq = 0;
+
+/* Hold copy of the CIR streaming counters so that it can be examined at a debug breakpoint. */
+static const cir_stream_stats_t *cir_stats;
+
+static int cir_rtt_write(const uint8_t *data, uint16_t len)
+{
+    return (int)SEGGER_RTT_Write(CIR_RTT_CHANNEL, data, len);
+}
+
+static const cir_stream_config_t cir_cfg = {
+    cir_rtt_write,          /* RTT up channel 1 */
+    0,                      /* Ipatov CIR from the start of the accumulator */
+    CIR_IPATOV_LEN_PRF64,   /* 1016 samples */
+    16,                     /* 16 samples before the first path */
+    112,                    /* and 112 from it on */
+    0                       /* blocking SPI reads */
+};
 
 /**
  * Application entry point.
@@ -120,6 +144,11 @@ int app_main(void)
     /* Enable IC diagnostic calculation and logging */
     dwt_configciadiag(1);
 
+    /* CIR streaming channel, the host reads it with e.g. JLinkRTTLogger */
+    SEGGER_RTT_ConfigUpBuffer(CIR_RTT_CHANNEL, "CIR", cir_rtt_buf, CIR_RTT_BUF_LEN, SEGGER_RTT_MODE_NO_BLOCK_TRIM);
+    cir_stream_init(&cir_cfg);
+    cir_stats = cir_stream_get_stats();
+
     LOG_INF("Diagnostics ready");
 
     /* Loop forever receiving frames. */
@@ -138,12 +167,14 @@ int app_main(void)
         for (int i = 0; i < FRAME_LEN_MAX; i++ ) {
             rx_buffer[i] = 0;
         }
-        for (int i = 0; i < ACCUM_DATA_LEN; i++ ) {
-           accum_data[i] = 0;
-        }
 
         memset(&rx_diag, 0, sizeof(rx_diag));
 
+        /* The next frame overwrites the accumulator: finish reading the CIR first. See NOTE 6. */
+        while (!cir_stream_acc_free()) {
+            cir_stream_poll();
+        }
+
         /* Activate reception immediately. See NOTE 4 below. */
         dwt_rxenable(DWT_START_RX_IMMEDIATE);
 
@@ -153,7 +184,10 @@ int app_main(void)
          * at is in the first byte of the register, we can use this simplest API
          * function to access it. */
         while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_ALL_RX_ERR)))
-        { /* spin */ };
+        {
+            /* Send the rest of the previous CIR meanwhile */
+            cir_stream_poll();
+        }
 
         if (status_reg & SYS_STATUS_RXFCG_BIT_MASK) {
             /* Clear good RX frame event in the DW IC status register. */
@@ -168,9 +202,8 @@ int app_main(void)
             /* Read diagnostics data. */
             dwt_readdiagnostics(&rx_diag);
 
-            /* Read accumulator. See NOTES 2 and 6. */
-            uint16_t fp_int = rx_diag.ipatovFpIndex >> 6;
-            dwt_readaccdata(accum_data, ACCUM_DATA_LEN, (fp_int - 2));
+            /* Stream the accumulator around the first path. See NOTES 2 and 6. */
+            cir_stream_start(cir_seq++, rx_diag.ipatovFpIndex);
         }
         else {
             /* Clear RX error events in the DW IC status register. */
@@ -187,19 +220,22 @@ int app_main(void)
  *
  * 1. In this example, maximum frame length is set to 127 bytes which is 802.15.4 UWB standard maximum frame length. DW IC supports an extended
  *    frame length (up to 1023 bytes long) mode which is not used in this example.
- * 2. Accumulator values are complex numbers: one 24-bit integer for real part and one 24-bit value for imaginary part, for each sample. In this
- *    example, we chose to read 3 values below the first path index and 3 values above. It must be noted that the first byte read when accessing the
- *    accumulator memory is always garbage and must be discarded, that is why the data length to read is increased by one byte here.
+ * 2. Accumulator values are complex numbers: one 24-bit integer for real part and one 24-bit value for imaginary part, for each sample, of
+ *    which 18 bits are significant. It must be noted that the first byte read when accessing the accumulator memory is always garbage and must
+ *    be discarded. cir_stream reads the accumulator in chunks of CIR_STREAM_CHUNK samples, drops the dummy byte and the unused bits and writes
+ *    records of 4.5 bytes per sample (see cir_stream.h for the format) to RTT up channel 1. When the RTT buffer is full the rest is kept and
+ *    sent by the next cir_stream_poll() calls, no data is lost (the RTT channel is in NO_BLOCK_TRIM mode).
  * 3. In this example, the DW IC is put into IDLE state after calling dwt_initialise(). This means that a fast SPI rate of up to 20 MHz can be used
  *    thereafter.
  * 4. Manual reception activation is performed here but DW IC offers several features that can be used to handle more complex scenarios or to
  *    optimise system's overall performance (e.g. timeout after a given time, automatic re-enabling of reception in case of errors, etc.).
  * 5. We use polled mode of operation here to keep the example as simple as possible, but RXFCG and error/timeout status events can be used to generate
  *    interrupts. Please refer to DW IC User Manual for more details on "interrupts".
- * 6. Here we chose to read only a few values around the first path index but it is possible and can be useful to get all accumulator values, using
- *    the relevant offset and length parameters. Reading the whole accumulator will require 4064 bytes of memory. First path value gotten from
- *    dwt_readdiagnostics is a 10.6 bits fixed point value calculated by the DW IC. By dividing this value by 64, we end up with the integer part of
- *    it. This value can be used to access the accumulator samples around the calculated first path index as it is done here.
+ * 6. Here we chose to stream 128 samples around the first path index, setting pre and post of cir_cfg to 0 streams the whole CIR (1016
+ *    samples, 4584 bytes per record, where reading it in one go would need 6097 bytes of memory). First path value gotten from
+ *    dwt_readdiagnostics is a 10.6 bits fixed point value calculated by the DW IC. By dividing this value by 64, we end up with the integer part
+ *    of it, which is used to place the window; the record keeps the full value. The receiver is only enabled again once the window has been
+ *    read, the end of the record is sent while waiting for the next frame. With CONFIG_SPI_ASYNC the reads can use DMA (async set in cir_cfg).
  * 7. Event counters are never reset in this example but this can be done by re-enabling them (i.e. calling again dwt_configeventcounters with
  *    "enable" parameter set).
  * 8. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
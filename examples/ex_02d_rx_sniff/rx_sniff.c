@@ -17,6 +17,7 @@
 #include <deca_spi.h>
 #include <port.h>
 #include <shared_defines.h>
+#include <sniff_sched.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -54,9 +55,26 @@ static dwt_config_t config = {
  * ON time is expressed in multiples of PAC size (with the IC adding 1 PAC automatically). So the ON time of 1 here gives 2 PAC times and, since the
  * configuration (above) specifies DWT_PAC8, we get an ON time of 2x8 symbols, or around 16 s.
  * OFF time is expressed in multiples of 128/125 s (~1 s).
- * These values will lead to a roughly 50% duty-cycle, each ON and OFF phase lasting for about 16 s. */
+ * The OFF time is not fixed, see NOTE 6 below. */
 #define SNIFF_ON_TIME 2
-#define SNIFF_OFF_TIME 16
+
+/* Adaptive SNIFF duty cycle: from the longest OFF time a 128 symbol preamble still overlaps up to full RX, within a 50% budget.
+ * See NOTE 6 below. */
+static sniff_sched_config_t sniff_cfg = {
+    8,               /* PAC size (DWT_PAC8). */
+    128,             /* Preamble length of the transmitter. */
+    SNIFF_ON_TIME,   /* ON time. */
+    4,               /* Levels: 3 SNIFF settings and full RX. */
+    500,             /* RX duty budget, per mille. */
+    4,               /* Go up above 4 frames per second... */
+    1,               /* ...go down below 1 frame per second... */
+    100,             /* ...go up with 10% of late preamble detections... */
+    10               /* ...and go down after 10 quiet windows in a row. */
+};
+
+/* Frame wait timeout, so the loop updates the duty cycle when no frame arrives, and duty cycle update period, in ms. */
+#define RX_TIMEOUT_UUS 97500
+#define SNIFF_UPDATE_MS 100
 
 /* Buffer to store received frame. See NOTE 1 below. */
 static uint8_t rx_buffer[FRAME_LEN_MAX];
@@ -67,6 +85,9 @@ static uint32_t status_reg = 0;
 /* Hold copy of frame length of frame received (if good) so that it can be examined at a debug breakpoint. */
 static uint16_t frame_len = 0;
 
+/* Time of the last duty cycle update. */
+static uint32_t sniff_time = 0;
+
 /**
  * Application entry point.
  */
@@ -106,8 +127,13 @@ int app_main(void)
         while (1) { /* spin */ };
     }
 
-    /* Configure SNIFF mode. */
-    dwt_setsniffmode(1, SNIFF_ON_TIME, SNIFF_OFF_TIME);
+    /* Configure SNIFF mode, its OFF time then follows the traffic. See NOTE 6 below. */
+    if (sniff_sched_init(&sniff_cfg) == DWT_ERROR) {
+        LOG_INF("SNIFF CONFIG FAILED");
+        while (1) { /* spin */ };
+    }
+    dwt_setrxtimeout(RX_TIMEOUT_UUS);
+    sniff_time = k_uptime_get_32();
 
     /* Loop forever receiving frames. */
     while (1)
@@ -134,7 +160,7 @@ int app_main(void)
          * STATUS register is 5 bytes long but we are not interested in the
          * high byte here, so we read a more manageable 32-bits with this
          * API call. */
-        while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_ALL_RX_ERR)))
+        while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR)))
         { /* spin */ };
 
         if (status_reg & SYS_STATUS_RXFCG_BIT_MASK) {
@@ -150,8 +176,19 @@ int app_main(void)
             }
         }
         else {
-            /* Clear RX error events in the DW IC status register. */
-            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_ERR);
+            /* Clear RX error/timeout events in the DW IC status register. */
+            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR);
+        }
+
+        /* Follow the traffic. The new setting is used from the next RX enable. */
+        if ((uint32_t)(k_uptime_get_32() - sniff_time) >= SNIFF_UPDATE_MS) {
+            uint32_t now = k_uptime_get_32();
+
+            if (sniff_sched_update(now - sniff_time)) {
+                LOG_INF("SNIFF level %d duty %d/1000 (average %d)", sniff_sched_get_stats()->level,
+                        sniff_sched_get_stats()->duty[sniff_sched_get_stats()->level], sniff_sched_avg_duty());
+            }
+            sniff_time = now;
         }
     }
 }
@@ -169,4 +206,9 @@ int app_main(void)
  *    interrupts. Please refer to DW IC User Manual for more details on "interrupts".
  * 5. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *    DW IC API Guide for more details on the DW IC driver functions.
+ * 6. Rather than a fixed OFF time (16, a roughly 50% duty cycle, in earlier versions of this example), sniff_sched (shared_data/sniff_sched.h)
+ *    picks the SNIFF setting from the event counters every SNIFF_UPDATE_MS: it starts at the lowest duty cycle the 128 symbol preamble of the
+ *    transmitter allows (OFF time ~79 s), goes up when frames come in faster or when preambles are detected too late to find the SFD, and comes
+ *    back down after a quiet second. With the 50% budget, full RX is never used; a budget of 1000 allows it. The listening current therefore
+ *    follows the actual load, and sniff_sched_avg_duty() gives the average duty cycle since start.
  ****************************************************************************************************************************************************/
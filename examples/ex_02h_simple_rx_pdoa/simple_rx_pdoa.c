@@ -1,6 +1,7 @@
 /*! ----------------------------------------------------------------------------
  *  @file    simple_rx_pdoa.c
- *  @brief   This examples prints the PDOA value to the virtual COM.
+ *  @brief   This examples prints the PDOA value, and the angle of arrival
+ *           averaged over AOA_WINDOW frames (aoa.h), to the virtual COM.
  *           The transmitter should be simple_tx_pdoa.c
  *           See note 3 regarding calibration and offset
  *
@@ -21,6 +22,7 @@
 #include <deca_vals.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <aoa.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -32,6 +34,7 @@ LOG_MODULE_REGISTER(simple_rx_pdoa);
 
 static void rx_ok_cb(const dwt_cb_data_t *cb_data);
 static void rx_err_cb(const dwt_cb_data_t *cb_data);
+static void aoa_cb(const aoa_out_t *out);
 
 /* Example application name and version to display. */
 #define APP_NAME "PDOA example"
@@ -56,6 +59,18 @@ static dwt_config_t config = {
     DWT_PDOA_M3      /* PDOA mode 3 */
 };
 
+/* Frames averaged per angle of arrival result */
+#define AOA_WINDOW 8
+
+/* Calibration of this board, see note 3. The ideal model of half a wavelength antenna spacing is used. */
+static const aoa_cal_t board_cal[] = {
+    { 5, 0, 0, NULL, 0 },
+    { 9, 0, 0, NULL, 0 },
+};
+
+static volatile uint32_t aoa_results = 0;
+static aoa_out_t aoa_last;
+
 int16_t   pdoa_val = 0;
 
 /* Will hold the data to send to the virtual COM */
@@ -67,6 +82,14 @@ uint8_t   pdoa_message_data[40];
 int app_main(void)
 {
     int16_t last_pdoa_val = 0;
+    uint32_t last_results = 0;
+    aoa_config_t aoa_cfg = {
+        .cal = board_cal,
+        .cal_count = sizeof(board_cal) / sizeof(board_cal[0]),
+        .chan = config.chan,
+        .window = AOA_WINDOW,
+        .min_sts_quality = 0,   /* see note 4 */
+    };
 
     /* Sends application name to test_run_info function. */
     LOG_INF(APP_NAME);
@@ -96,6 +119,11 @@ int app_main(void)
         while (1) { /* spin */ };
     }
 
+    if (aoa_init(&aoa_cfg, aoa_cb) != DWT_SUCCESS) {
+        LOG_ERR("AOA INIT FAILED");
+        while (1) { /* spin */ };
+    }
+
     /* Register RX callback. */
     dwt_setcallbacks(NULL, rx_ok_cb, rx_err_cb, rx_err_cb, NULL, NULL);
 
@@ -117,6 +145,17 @@ int app_main(void)
             last_pdoa_val = pdoa_val;
             LOG_INF("PDOA val = %d", last_pdoa_val);
         }
+        if (last_results != aoa_results) {
+            aoa_out_t out;
+            int angle;
+
+            last_results = aoa_results;
+            out = aoa_last;
+            angle = (out.angle_cdeg < 0) ? -out.angle_cdeg : out.angle_cdeg;
+            LOG_INF("AOA %c%d.%02d deg spread %u.%02u deg (%u frames)",
+                    (out.angle_cdeg < 0) ? '-' : '+', angle / 100, angle % 100,
+                    out.spread_cdeg / 100, out.spread_cdeg % 100, out.samples);
+        }
     }
     return DWT_SUCCESS;
 }
@@ -133,16 +172,32 @@ int app_main(void)
  */
 static void rx_ok_cb(const dwt_cb_data_t *cb_data)
 {
-    int16_t cpqual;
+    aoa_sample_t sample;
     (void) cb_data;
 
-    /* Checking STS quality see note 4 */
-    if (dwt_readstsquality(&cpqual)) {
-        pdoa_val = dwt_readpdoa();
+    /* PDOA and STS quality of the frame, the sample is dropped if the STS quality is poor, see note 4 */
+    aoa_sample(0, 0, AOA_DIST_NONE, &sample);
+    if (aoa_push(&sample)) {
+        pdoa_val = sample.pdoa;
     }
     dwt_rxenable(DWT_START_RX_IMMEDIATE);
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_cb()
+ *
+ * @brief Callback to process angle of arrival results, called from rx_ok_cb() once per AOA_WINDOW frames
+ *
+ * @param  out  result
+ *
+ * @return  none
+ */
+static void aoa_cb(const aoa_out_t *out)
+{
+    aoa_last = *out;
+    aoa_results++;
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn rx_err_cb()
  *
@@ -168,6 +223,8 @@ static void rx_err_cb(const dwt_cb_data_t *cb_data)
  *    occur. The DW3000 can tolerate a difference of +/- 20ppm. For optimum performance an offset of +/- 5ppm is recommended.
  * 3. A natural offset will always occur between any two boards. To combat this offset the transmitter and receiver should be placed
  *    with a real PDOA of 0 degrees. When the PDOA is calculated this will return a non-zero value. This value should be subtracted from all
- *    PDOA values obtained by the receiver in order to obtain a calibrated PDOA.
+ *    PDOA values obtained by the receiver in order to obtain a calibrated PDOA: set it as the pdoa_offset of the channel in board_cal[].
+ *    For a better angle accuracy than the ideal half wavelength model, the PDOA can be measured at a few known angles and entered as a table
+ *    of points of the calibration (see aoa.h).
  * 4. If the STS quality is poor the returned PDoA value will not be accurate and as such will not be recorded
  ****************************************************************************************************************************************************/
@@ -23,6 +23,7 @@
 #include <deca_spi.h>
 #include <port.h>
 #include <shared_defines.h>
+#include <tx_slots.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -78,6 +79,10 @@ static uint8_t tx_msg[] = {0x41, 0x8C, 0, 0x9A, 0x60, 0, 0, 0, 0, 0, 0, 0, 0, 'D
 #define DATA_FRAME_SN_IDX 2
 #define DATA_FRAME_DEST_IDX 5
 
+/* The response is staged once in a slot of the TX buffer. See NOTE 9 below. */
+static tx_slots_t tx_slots;
+static int resp_slot;
+
 /* Inter-frame delay period, in milliseconds. */
 #define TX_DELAY_MS 1000
 
@@ -143,6 +148,11 @@ int app_main(void)
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
 
+    /* Stage the response in the TX buffer, the FCS is not part of the staged frame. See NOTE 9 below. */
+    tx_slots_init(&tx_slots, 0, TX_BUFFER_MAX_LEN);
+    resp_slot = tx_slots_add(&tx_slots, tx_msg, sizeof(tx_msg) - FCS_LEN, 0);
+    tx_slots_stage(&tx_slots);
+
     /* Loop forever sending and receiving frames periodically. */
     while (1) {
 
@@ -181,18 +191,16 @@ int app_main(void)
                 (rx_buffer[10] == 0x43) && 
                 (rx_buffer[11] == 0x2)) {
 
-                /* Copy source address of blink in response destination address. */
+                /* Copy source address of blink in response destination address,
+                 * only the bytes that change are written to the staged response. */
                 for (int i = 0; i < 8; i++) {
-                    tx_msg[DATA_FRAME_DEST_IDX + i] = rx_buffer[BLINK_FRAME_SRC_IDX + i];
+                    tx_frame_set_u8(tx_slots_frame(&tx_slots, resp_slot), DATA_FRAME_DEST_IDX + i,
+                                    rx_buffer[BLINK_FRAME_SRC_IDX + i]);
                 }
 
-                /* Write response frame data to DW IC and prepare transmission. 
-                 * See NOTE 6 below.*/
-                dwt_writetxdata(sizeof(tx_msg), tx_msg, 0); /* Zero offset in TX buffer. */
-                dwt_writetxfctrl(sizeof(tx_msg), 0, 0); /* Zero offset in TX buffer, no ranging. */
-
-                /* Send the response. */
-                dwt_starttx(DWT_START_TX_IMMEDIATE);
+                /* Send the response: its changed bytes are written, then the frame control
+                 * (slot offset, no ranging). See NOTE 6 and 9 below.*/
+                tx_slots_send(&tx_slots, resp_slot, DWT_START_TX_IMMEDIATE);
 
                 /* Poll DW IC until TX frame sent event set. */
                 while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS_BIT_MASK))
@@ -206,7 +214,8 @@ int app_main(void)
                 LOG_HEXDUMP_INF((char*)&tx_msg, sizeof(tx_msg), (char*) &len2);
 #endif
                 /* Increment the data frame sequence number (modulo 256). */
-                tx_msg[DATA_FRAME_SN_IDX]++;
+                tx_frame_set_u8(tx_slots_frame(&tx_slots, resp_slot), DATA_FRAME_SN_IDX,
+                                (uint8_t)(tx_msg[DATA_FRAME_SN_IDX] + 1));
             }
         }
         else {
@@ -236,4 +245,7 @@ int app_main(void)
  *    DW IC API Guide for more details on the DW IC driver functions.
  * 8. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *    configuration.
+ * 9. The response is written to the TX buffer once, before the loop (see tx_slots.h). Before each response only the bytes that changed are
+ *    written (the sequence number, and the destination address when the blink comes from another tag), then dwt_writetxfctrl() and
+ *    dwt_starttx(). More slots can be added the same way, e.g. alternative replies, each sent without a buffer write.
  ****************************************************************************************************************************************************/
@@ -0,0 +1,193 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    rf_test_seq.c
+ *  @brief   RF production test sequencer driven from the host
+ *
+ *           Runs the command lines of a host script (RTT down channel 0, or
+ *           the console UART with RF_TEST_UART) through the test sequencer of
+ *           shared_data/rf_test.c: continuous wave and continuous frame modes
+ *           on channels 5 and 9 with swept TX power and PG delay, without
+ *           reflashing or resetting between configurations.
+ *           See rf_test.h for the commands and ex_04a/ex_04b for the modes.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include <rf_test.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#ifdef RF_TEST_UART
+#include <zephyr/drivers/uart.h>
+#else
+#include <SEGGER_RTT.h>
+#endif
+
+#define LOG_LEVEL 3
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(rf_test_seq);
+
+/* Example application name and version to display on console. */
+#define APP_NAME "RF TEST v1.0"
+
+/* Command polling period, the dwell time resolution */
+#define POLL_PERIOD_MS  1
+
+/* Default communication configuration: the one of ex_04b_cont_frame, the channel follows the steps. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard 8 symbol SFD,
+                      *   1 to use non-standard 8 symbol,
+                      *   2 for non-standard 16 symbol SFD and
+                      *   3 for 4z 8 symbol SDF type */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    DWT_PHRRATE_STD, /* PHY header rate. */
+    (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+    DWT_STS_MODE_OFF,/* STS disabled */
+    DWT_STS_LEN_64,  /* STS length see allowed values in Enum dwt_sts_lengths_e */
+    DWT_PDOA_M0      /* PDOA mode off */
+};
+
+/* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and power
+ * of the spectrum at the current temperature.
+ * These values can be calibrated prior to taking reference measurements. */
+extern dwt_txconfig_t txconfig_options;
+
+static rf_test_t rf_test;
+
+/* Command line being received */
+static char cmd_line[RF_TEST_LINE_MAX];
+static uint8_t cmd_len;
+
+#ifdef RF_TEST_UART
+static const struct device *const uart_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+#endif
+
+/*! ---------------------------------------------------------------------------
+ * @fn reply_write()
+ *
+ * @brief Sequencer reply transport: one line to the console.
+ *
+ * @param  line - reply
+ *
+ * @return none
+ */
+static void reply_write(const char *line)
+{
+    printk("%s\n", line);
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn cmd_getc()
+ *
+ * @brief Read one character of the host commands, if any.
+ *
+ * @param  c - character read
+ *
+ * @return 1 if a character was read, 0 otherwise
+ */
+static int cmd_getc(char *c)
+{
+#ifdef RF_TEST_UART
+    return (uart_poll_in(uart_dev, (unsigned char *)c) == 0);
+#else
+    return (SEGGER_RTT_Read(0, c, 1) == 1);
+#endif
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn app_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int app_main(void)
+{
+    /* Display application name. */
+    LOG_INF(APP_NAME);
+
+    /* Configure SPI rate, DW3000 supports up to 38 MHz */
+    port_set_dw_ic_spi_fastrate();
+
+    /* Reset DW IC */
+    /* Target specific drive of RSTn line into DW IC low for a period. */
+    reset_DWIC();
+
+    /* Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC */
+    Sleep(2);
+
+    /* Need to make sure DW IC is in IDLE_RC before proceeding */
+    while (!dwt_checkidlerc()) { /* spin */ };
+
+    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR) {
+        LOG_ERR("INIT FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration
+     * has failed the host should reset the device */
+    if (dwt_configure(&config)) {
+        LOG_ERR("CONFIG FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* Configure the TX spectrum parameters (power, PG delay and PG count) */
+    dwt_configuretxrf(&txconfig_options);
+
+    rf_test_init(&rf_test, &config, &txconfig_options, reply_write);
+
+    LOG_INF("Ready for commands");
+    reply_write("READY");
+
+    while (1) {
+        char c;
+
+        /* Assemble the command lines, run each one when complete. */
+        while (cmd_getc(&c)) {
+            if ((c == '\n') || (c == '\r')) {
+                if (cmd_len != 0) {
+                    cmd_line[cmd_len] = '\0';
+                    rf_test_command(&rf_test, cmd_line, k_uptime_get_32());
+                    cmd_len = 0;
+                }
+            }
+            else if (cmd_len < (sizeof(cmd_line) - 1)) {
+                cmd_line[cmd_len++] = c;
+            }
+        }
+
+        /* Step to the next configuration when the dwell time is over. */
+        rf_test_poll(&rf_test, k_uptime_get_32());
+
+        k_msleep(POLL_PERIOD_MS);
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. A typical end-of-line script first sweeps the CW steps while the spectrum analyser measures the carrier, then the continuous frame steps for
+ *    the power spectral density:
+ *        clear
+ *        sweep cw 5 0x20 0xfe 0x20 0x30 0x34 4 500
+ *        sweep frame 9 0x20 0xfe 0x20 0x30 0x34 4 500 124800
+ *        run
+ *    and waits for "DONE". With a dwell time of 0, each step lasts until the script sends "next", after its measurement.
+ * 2. Continuous frame mode is typically used to tune transmit power for regulatory purposes, see the notes of ex_04b_cont_frame. The TX power and
+ *    PG delay values swept here are raw register values: the user is referred to DW IC User Manual for the values applicable to each channel.
+ ****************************************************************************************************************************************************/
@@ -31,6 +31,8 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <tx_frame.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -85,6 +87,14 @@ static uint8_t tx_final_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E',
 #define FINAL_MSG_RESP_RX_TS_IDX 14
 #define FINAL_MSG_FINAL_TX_TS_IDX 18
 
+/* Offsets of the frames in the TX buffer, each frame keeps its own place. See NOTE 15 below. */
+#define POLL_MSG_TX_BUF_OFFSET 0
+#define FINAL_MSG_TX_BUF_OFFSET 16
+
+/* The poll and final frames composed in place in the TX buffer */
+static tx_frame_t poll_frame;
+static tx_frame_t final_frame;
+
 /* Frame sequence number, incremented after each transmission. */
 static uint8_t frame_seq_nb = 0;
 
@@ -162,6 +172,7 @@ int app_main(void)
         LOG_INF("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
@@ -172,9 +183,12 @@ int app_main(void)
 
     /* Set expected response's delay and timeout. See NOTE 4, 5 and 7 below.
      * As this example only handles one incoming frame with always the same 
-     * delay and timeout, those values can be set here once for all. */
+     * delay and timeout, those values can be set here once for all.
+     * The receiver delay is counted from the end of the poll, not from its
+     * RMARKER as phy_timing_rx_dly_uus() expects, so it stays as tuned; the
+     * timeout is lengthened for the profile (phy_timing.h). */
     dwt_setrxaftertxdelay(POLL_TX_TO_RESP_RX_DLY_UUS);
-    dwt_setrxtimeout(RESP_RX_TIMEOUT_UUS);
+    dwt_setrxtimeout(phy_timing_rx_timeout_uus(RESP_RX_TIMEOUT_UUS, sizeof(rx_resp_msg) + FCS_LEN));
     dwt_setpreambledetecttimeout(PRE_TIMEOUT);
 
     /* Next can enable TX/RX states output on GPIOs 5 and 6 to help debug, 
@@ -184,15 +198,18 @@ int app_main(void)
 
     dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
 
+    tx_frame_init(&poll_frame, tx_poll_msg, sizeof(tx_poll_msg), POLL_MSG_TX_BUF_OFFSET);
+    tx_frame_init(&final_frame, tx_final_msg, sizeof(tx_final_msg), FINAL_MSG_TX_BUF_OFFSET);
+
     LOG_INF("Initiator ready");
 
     /* Loop forever initiating ranging exchanges. */
     while (1) {
 
-        /* Write frame data to DW IC and prepare transmission. See NOTE 9 below. */
-        tx_poll_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-        dwt_writetxdata(sizeof(tx_poll_msg), tx_poll_msg, 0); /* Zero offset in TX buffer. */
-        dwt_writetxfctrl(sizeof(tx_poll_msg)+FCS_LEN, 0, 1); /* Zero offset in TX buffer, ranging. */
+        /* Write frame data to DW IC and prepare transmission. See NOTE 9 and 15 below. */
+        tx_frame_set_u8(&poll_frame, ALL_MSG_SN_IDX, frame_seq_nb);
+        tx_frame_commit(&poll_frame); /* Only the sequence number after the first poll. */
+        dwt_writetxfctrl(sizeof(tx_poll_msg)+FCS_LEN, POLL_MSG_TX_BUF_OFFSET, 1); /* Ranging. */
 
         /* Start transmission, indicating that a response is expected so that
          * reception is enabled automatically after the frame is sent and the 
@@ -236,7 +253,8 @@ int app_main(void)
                 resp_rx_ts = get_rx_timestamp_u64();
 
                 /* Compute final message transmission time. See NOTE 11 below. */
-                final_tx_time = (resp_rx_ts + (RESP_RX_TO_FINAL_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                final_tx_time = (resp_rx_ts + ((RESP_RX_TO_FINAL_TX_DLY_UUS
+                        + phy_timing_extra_uus(sizeof(tx_final_msg) + FCS_LEN)) * UUS_TO_DWT_TIME)) >> 8;
                 dwt_setdelayedtrxtime(final_tx_time);
 
                 /* Final TX timestamp is the transmission time we programmed 
@@ -247,11 +265,12 @@ int app_main(void)
                 final_msg_set_ts(&tx_final_msg[FINAL_MSG_POLL_TX_TS_IDX], poll_tx_ts);
                 final_msg_set_ts(&tx_final_msg[FINAL_MSG_RESP_RX_TS_IDX], resp_rx_ts);
                 final_msg_set_ts(&tx_final_msg[FINAL_MSG_FINAL_TX_TS_IDX], final_tx_ts);
+                tx_frame_mark(&final_frame, FINAL_MSG_POLL_TX_TS_IDX, FINAL_MSG_FINAL_TX_TS_IDX + FINAL_MSG_TS_LEN - FINAL_MSG_POLL_TX_TS_IDX);
 
-                /* Write and send final message. See NOTE 9 below. */
-                tx_final_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-                dwt_writetxdata(sizeof(tx_final_msg), tx_final_msg, 0); /* Zero offset in TX buffer. */
-                dwt_writetxfctrl(sizeof(tx_final_msg)+FCS_LEN, 0, 1); /* Zero offset in TX buffer, ranging bit set. */
+                /* Write and send final message. See NOTE 9 and 15 below. */
+                tx_frame_set_u8(&final_frame, ALL_MSG_SN_IDX, frame_seq_nb);
+                tx_frame_commit(&final_frame); /* Sequence number and timestamps, 13 bytes. */
+                dwt_writetxfctrl(sizeof(tx_final_msg)+FCS_LEN, FINAL_MSG_TX_BUF_OFFSET, 1); /* Ranging bit set. */
 
                 /* If dwt_starttx() returns an error, abandon this ranging exchange and
                  * proceed to the next one. See NOTE 13 below. */
@@ -374,4 +393,7 @@ int app_main(void)
  *     awaiting the "final" and proceed to have its receiver on ready to poll of the following exchange.
  * 14. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *     DW IC API Guide for more details on the DW IC driver functions.
+ * 15. The poll and the final are kept at their own offsets in the TX buffer (see tx_frame.h): after the first exchange, only the bytes that change
+ *     are written, the poll sequence number (1 byte) and the final sequence number and timestamps (13 bytes instead of 22 before the delayed
+ *     final). dwt_writetxfctrl() gives the offset of the frame to send.
  ****************************************************************************************************************************************************/
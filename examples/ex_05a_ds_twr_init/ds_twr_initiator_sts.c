@@ -47,7 +47,10 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <rx_errors.h>
+#include <sts_session.h>
 #include <config_options.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -106,9 +109,6 @@ static uint32_t status_reg = 0;
 /* Receive response timeout. See NOTE 5 below. */
 #define RESP_RX_TIMEOUT_UUS 300
 
-/* Hold the amount of errors that have occurred */
-static uint32_t errors[23] = {0};
-
 extern dwt_config_t config_options;
 extern dwt_txconfig_t txconfig_options;
 extern dwt_txconfig_t txconfig_options_ch9;
@@ -145,6 +145,14 @@ static dwt_sts_cp_iv_t cp_iv = {
     0x1F9A3DE4,0xD37EC3CA,0xC44FA8FB,0x362EEB34
 };
 
+/*
+ * IV step from one ranging exchange to the next (see sts_session.h and NOTE 16 below). It must be the same at both units.
+ * 0 reloads the same IV for every exchange.
+ */
+#define STS_IV_STRIDE 0
+
+static sts_session_config_t sts_cfg;
+
 /*
  * The 'poll' message initiating the ranging exchange includes 
  * a 32-bit counter which is part of the IV used to generate the 
@@ -183,8 +191,6 @@ int app_main(void)
 {
     int16_t stsQual; /* This will contain STS quality index and status */
     int goodSts = 0; /* Used for checking STS quality in received signal */
-    uint8_t firstLoopFlag = 0; /* Used for checking if the program has gone 
-                                * through the main loop for the first time */
 
     /* Display application name on UART. */
     LOG_INF(APP_NAME);
@@ -225,6 +231,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { };
     }
+    phy_timing_apply(0, &config_options);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     if (config_options.chan == 5) {
@@ -247,7 +254,7 @@ int app_main(void)
     /* Set expected response's timeout. See NOTE 1 and 5 below.
      * As this example only handles one incoming frame with always the same
      * delay, this value can be set here once for all. */
-    set_resp_rx_timeout(RESP_RX_TIMEOUT_UUS, &config_options);
+    dwt_setrxtimeout(phy_timing_rx_timeout_uus(RESP_RX_TIMEOUT_UUS, sizeof(rx_resp_msg)));
 
     /* Next can enable TX/RX states output on GPIOs 5 and 6 to help 
      * diagnostics, and also TX/RX LEDs */
@@ -255,28 +262,21 @@ int app_main(void)
 
     LOG_INF("Initiator ready");
 
+    /* Program the STS key and IV once, the IV of each ranging exchange
+     * is then kept on the host side. See NOTE 16 below. */
+    sts_cfg.key = cp_key;
+    sts_cfg.iv = cp_iv;
+    sts_cfg.stride = STS_IV_STRIDE;
+    sts_session_init(&sts_cfg);
+
+    /* Count the RX errors by kind, see rx_errors.h. */
+    rx_err_init(NULL);
+
     /* Loop for user defined number of ranges. */
     while (1) {
-        /*
-         * Set STS encryption key and IV (nonce).
-         * See NOTE 16 below.
-         */
-        if (!firstLoopFlag) {
-            /*
-             * On first loop, configure the STS key & IV, then load them.
-             */
-            dwt_configurestskey(&cp_key);
-            dwt_configurestsiv(&cp_iv);
-            dwt_configurestsloadiv();
-            firstLoopFlag = 1;
-        }
-        else {
-            /*
-             * On subsequent loops, we only need to reload the lower 32 bits of STS IV.
-             */
-            dwt_writetodevice(STS_IV0_ID, 0, 4, (uint8_t *)&cp_iv);
-            dwt_configurestsloadiv();
-        }
+        /* Load the STS IV of this exchange, written ahead of time by
+         * sts_session_prime(). See NOTE 16 below. */
+        sts_session_begin();
 
         /*
          * Send the poll message to the responder.
@@ -292,7 +292,7 @@ int app_main(void)
         { };
 
         /* Need to check the STS has been received and is good. */
-        goodSts = dwt_readstsquality(&stsQual);
+        goodSts = sts_session_check(&stsQual);
 
         /* Increment frame sequence number after transmission of the 
          * poll message (modulo 256). */
@@ -303,6 +303,9 @@ int app_main(void)
          */
         if ((status_reg & SYS_STATUS_RXFCG_BIT_MASK) && (goodSts >= 0)) {
 
+            /* Count the good frame, see rx_errors.h. */
+            rx_err_status(status_reg);
+
             /* Clear good RX frame event in the DW IC status register. */
             dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_GOOD);
 
@@ -349,6 +352,10 @@ int app_main(void)
                      * exchange and proceed to the next one. 
                      * See NOTE 13 below. */
                     if (ret == DWT_SUCCESS) {
+                       /* Write the IV of the next exchange while the final
+                        * is sent. See NOTE 16 below. */
+                       sts_session_prime();
+
                        /* Poll DW IC until TX frame sent event set. See NOTE 8 below. */
                        while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS_BIT_MASK))
                        { };
@@ -362,24 +369,20 @@ int app_main(void)
                     }
                 }
                 else {
-                    errors[BAD_FRAME_ERR_IDX] += 1;
+                    rx_err_record(RX_ERR_BAD_FRAME);
                 }
             }
             else {
-                errors[RTO_ERR_IDX] += 1;
+                rx_err_record(RX_ERR_BAD_FRAME);
             }
         }
         else {
-            check_for_status_errors(status_reg, errors);
-
-            if (!(status_reg & SYS_STATUS_RXFCG_BIT_MASK)) {
-                errors[BAD_FRAME_ERR_IDX] += 1;
+            if (status_reg & SYS_STATUS_RXFCG_BIT_MASK) {
+                /* Frame received, STS quality too low */
+                rx_err_record(RX_ERR_STS_QUAL);
             }
-            if (goodSts < 0) {
-                errors[PREAMBLE_COUNT_ERR_IDX] += 1;
-            }
-            if (stsQual <= 0) {
-                errors[CP_QUAL_ERR_IDX] += 1;
+            else {
+                rx_err_status(status_reg);
             }
         }
 
@@ -485,10 +488,13 @@ int app_main(void)
  *                                                                                                                       can turn around and reply)
  * 15. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *     configuration.
- * 16. This example will set the STS key and IV upon each iteration of the main while loop. While this has the benefit of keeping the STS count in
- *     sync with the responder device (which does the same), it should be noted that this is not a 'secure' implementation as the count is reset upon
- *     each iteration of the loop. An attacker could potentially recognise this pattern if the signal was being monitored. While it serves it's
- *     purpose in this simple example, it should not be utilised in any final solution.
+ * 16. The STS key and IV are programmed once, before the main loop. At the start of each ranging exchange the IV is reloaded by
+ *     sts_session_begin(), a single short SPI write: the IV of the next exchange has already been written by sts_session_prime() while the last
+ *     frame of the current one was in the air, and only the IV words that change are written. With STS_IV_STRIDE at 0 the same IV is used for
+ *     every exchange. While this has the benefit of keeping the STS count in sync with the responder device (which does the same), it should be
+ *     noted that this is not a 'secure' implementation as the count is reset upon each exchange. An attacker could potentially recognise this
+ *     pattern if the signal was being monitored. Setting STS_IV_STRIDE to e.g. STS_SESSION_STRIDE(DWT_STS_LEN_64, 3, 1) at both units gives each
+ *     exchange its own counter values, the two units then have to agree on the exchange number (see sts_session_sync()).
  * 17. Delays between frames have been chosen here to ensure proper synchronisation of transmission and reception of the frames between the initiator
  *     and the responder and to ensure a correct accuracy of the computed distance. The user is referred to DecaRanging ARM Source Code Guide for more
  *     details about the timings involved in the ranging process.
@@ -31,7 +31,10 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <tx_frame.h>
+#include <ranging_math.h>
 #include <config_options.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -89,6 +92,9 @@ static uint8_t rx_final_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E',
 /* Frame sequence number, incremented after each transmission. */
 static uint8_t frame_seq_nb = 0;
 
+/* The response frame composed in place in the TX buffer. See NOTE 16 below. */
+static tx_frame_t resp_frame;
+
 /* Buffer to store received messages.
  * Its size is adjusted to longest frame that this example code is
  * supposed to handle. */
@@ -122,8 +128,8 @@ static uint64_t final_rx_ts;
 
 /* Hold copies of computed time of flight and distance here for reference
  * so that it can be examined at a debug breakpoint. */
-static double tof;
-static double distance;
+static int32_t tof;         /* 1/16 dtu, see ranging_math.h */
+static int32_t distance;    /* mm */
 
 /* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and
  * power of the spectrum at the current temperature. These values can be
@@ -166,6 +172,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
@@ -182,6 +189,8 @@ int app_main(void)
 
     dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
 
+    tx_frame_init(&resp_frame, tx_resp_msg, sizeof(tx_resp_msg) - FCS_LEN, 0);
+
     /* Loop forever responding to ranging requests. */
     while (1) {
 
@@ -223,19 +232,20 @@ int app_main(void)
                 poll_rx_ts = get_rx_timestamp_u64();
 
                 /* Set send time for response. See NOTE 9 below. */
-                resp_tx_time = (poll_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                resp_tx_time = (poll_rx_ts + ((POLL_RX_TO_RESP_TX_DLY_UUS
+                        + phy_timing_extra_uus(sizeof(tx_resp_msg))) * UUS_TO_DWT_TIME)) >> 8;
                 dwt_setdelayedtrxtime(resp_tx_time);
 
                 /* Set expected delay and timeout for final message reception. See NOTE 4 and 5 below. */
                 dwt_setrxaftertxdelay(RESP_TX_TO_FINAL_RX_DLY_UUS);
-                dwt_setrxtimeout(FINAL_RX_TIMEOUT_UUS);
+                dwt_setrxtimeout(phy_timing_rx_timeout_uus(FINAL_RX_TIMEOUT_UUS, sizeof(rx_final_msg)));
 
                 /* Set preamble timeout for expected frames. See NOTE 6 below. */
                 dwt_setpreambledetecttimeout(PRE_TIMEOUT);
 
-                /* Write and send the response message. See NOTE 10 below.*/
-                tx_resp_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-                dwt_writetxdata(sizeof(tx_resp_msg), tx_resp_msg, 0); /* Zero offset in TX buffer. */
+                /* Write and send the response message. See NOTE 10 and 16 below.*/
+                tx_frame_set_u8(&resp_frame, ALL_MSG_SN_IDX, frame_seq_nb);
+                tx_frame_commit(&resp_frame); /* Zero offset in TX buffer, only the sequence number after the first response. */
                 dwt_writetxfctrl(sizeof(tx_resp_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
                 int ret = dwt_starttx(DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED);
 
@@ -281,8 +291,7 @@ int app_main(void)
 
                         uint32_t poll_tx_ts, resp_rx_ts, final_tx_ts;
                         uint32_t poll_rx_ts_32, resp_tx_ts_32, final_rx_ts_32;
-                        double Ra, Rb, Da, Db;
-                        int64_t tof_dtu;
+                        uint32_t Ra, Rb, Da, Db;
 
                         /* Retrieve response transmission and final
                          * reception timestamps. */
@@ -300,18 +309,18 @@ int app_main(void)
                         poll_rx_ts_32 = (uint32_t)poll_rx_ts;
                         resp_tx_ts_32 = (uint32_t)resp_tx_ts;
                         final_rx_ts_32 = (uint32_t)final_rx_ts;
-                        Ra = (double)(resp_rx_ts - poll_tx_ts);
-                        Rb = (double)(final_rx_ts_32 - resp_tx_ts_32);
-                        Da = (double)(final_tx_ts - resp_rx_ts);
-                        Db = (double)(resp_tx_ts_32 - poll_rx_ts_32);
-                        tof_dtu = (int64_t)((Ra * Rb - Da * Db) / (Ra + Rb + Da + Db));
+                        Ra = resp_rx_ts - poll_tx_ts;
+                        Rb = final_rx_ts_32 - resp_tx_ts_32;
+                        Da = final_tx_ts - resp_rx_ts;
+                        Db = resp_tx_ts_32 - poll_rx_ts_32;
+                        tof = ranging_ds_tof(Ra, Rb, Da, Db);
 
-                        tof = tof_dtu * DWT_TIME_UNITS;
-                        distance = tof * SPEED_OF_LIGHT;
+                        distance = ranging_tof_to_mm(tof);
 
                         /* Display computed distance. */
+                        char mm[RANGING_MM_STR_LEN];
                         static char dist[20] = {0};
-                        sprintf(dist, "dist %3.2f m", distance);
+                        sprintf(dist, "dist %s m", ranging_mm_to_str(distance, mm));
                         //LOG_INF("%s", log_strdup(dist));
                         LOG_INF("%s", dist);
 
@@ -430,4 +439,6 @@ int app_main(void)
  *     thereafter.
  * 15. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *     configuration.
+ * 16. The response stays in the TX buffer from one exchange to the next (see tx_frame.h), so after the first response only its sequence number is
+ *     written before the delayed transmission.
  ****************************************************************************************************************************************************/
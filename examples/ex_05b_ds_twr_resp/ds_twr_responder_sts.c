@@ -49,7 +49,11 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <rx_errors.h>
+#include <sts_session.h>
+#include <ranging_math.h>
 #include <config_options.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -106,12 +110,9 @@ static uint64_t resp_tx_ts;
 /*
  * Array to keep distance values when running tests
  */
-static double distance_array[RANGE_COUNT] = {0};
+static int32_t distance_array[RANGE_COUNT] = {0};    /* mm */
 static int distance_array_index = 0;
 
-/* Hold the amount of errors that have occurred */
-static uint32_t errors[23] = {0};
-
 extern dwt_config_t config_options;
 extern dwt_txconfig_t txconfig_options;
 extern dwt_txconfig_t txconfig_options_ch9;
@@ -143,19 +144,24 @@ static dwt_sts_cp_iv_t cp_iv = {
     0x1F9A3DE4,0xD37EC3CA,0xC44FA8FB,0x362EEB34
 };
 
+/*
+ * IV step from one ranging exchange to the next (see sts_session.h and NOTE 16 below). It must be the same at both units.
+ * 0 reloads the same IV for every exchange.
+ */
+#define STS_IV_STRIDE 0
+
+static sts_session_config_t sts_cfg;
+
 /*
  * Compute the required delay needed before transmitting the RESP message
  */
 void compute_resp_tx_frame_times(void)
 {
     /*
-     * Different sized frames require different time delays.
+     * Longer preambles, an STS or a lower data rate lengthen the frames,
+     * and the delay with them.
      */
-    uint32_t delay_time = POLL_RX_TO_RESP_TX_DLY_UUS + get_rx_delay_time_data_rate() + get_rx_delay_time_txpreamble();
-
-    /* Length of the STS effects the size of the frame also.
-     * This means the delay required is greater for larger STS lengths. */
-    delay_time += ((1<<(config_options.stsLength+2))*8);
+    uint32_t delay_time = POLL_RX_TO_RESP_TX_DLY_UUS + phy_timing_extra_uus(sizeof(tx_resp_msg));
 
     dwt_setdelayedtrxtime((uint32_t)((delay_time * UUS_TO_DWT_TIME) >> 8));
 }
@@ -211,6 +217,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config_options);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     if (config_options.chan == 5) {
@@ -231,28 +238,24 @@ int app_main(void)
     /* Delay between the response frame and final frame */
     dwt_setrxaftertxdelay(RESP_TX_TO_FINAL_RX_DLY_UUS);
 
+    /* Program the STS key and IV once, the IV of each ranging exchange
+     * is then kept on the host side. See NOTE 16 below. */
+    sts_cfg.key = cp_key;
+    sts_cfg.iv = cp_iv;
+    sts_cfg.stride = STS_IV_STRIDE;
+    sts_session_init(&sts_cfg);
+
+    /* Count the RX errors by kind, see rx_errors.h. */
+    rx_err_init(NULL);
+
     /* Loop responding to ranging requests, for RANGE_COUNT number of times */
     while (loopCount < RANGE_COUNT) {
         /*
-         * Set CP encryption key and IV (nonce).
-         * See Note 16 below.
+         * Load the STS IV of this exchange, written ahead of time by
+         * sts_session_prime(). See Note 16 below.
          */
         if (!messageFlag) {
-            if (!loopCount) {
-                /*
-                 * On first loop, configure the STS key & IV, then load them.
-                 */
-                dwt_configurestskey(&cp_key);
-                dwt_configurestsiv(&cp_iv);
-                dwt_configurestsloadiv();
-            }
-            else {
-                /*
-                 * On subsequent loops, we only need to reload the lower 32 bits of STS IV.
-                 */
-                dwt_writetodevice(STS_IV0_ID, 0, 4, (uint8_t *)&cp_iv);
-                dwt_configurestsloadiv();
-            }
+            sts_session_begin();
         }
 
         /* Responder will enable the receive when waiting for Poll message,
@@ -273,13 +276,16 @@ int app_main(void)
         /*
          * Need to check the STS has been received and is good.
          */
-        goodSts = dwt_readstsquality(&stsQual);
+        goodSts = sts_session_check(&stsQual);
 
         /*
          * Check for a good frame and STS count.
          */
         if ((status_reg & SYS_STATUS_RXFCG_BIT_MASK) && (goodSts >= 0)) {
 
+            /* Count the good frame, see rx_errors.h. */
+            rx_err_status(status_reg);
+
             /* Clear good RX frame event in the DW IC status register. */
             dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG_BIT_MASK);
 
@@ -302,9 +308,7 @@ int app_main(void)
 
                     resp_tx_time = (poll_rx_ts                               /* Received timestamp value */
                             + ((POLL_RX_TO_RESP_TX_DLY_UUS                   /* Set delay time */
-                                    + get_rx_delay_time_data_rate()          /* Added delay time for data rate set */
-                                    + get_rx_delay_time_txpreamble()         /* Added delay for TX preamble length */
-                                    + ((1<<(config_options.stsLength+2))*8)) /* Added delay for STS length */
+                                    + phy_timing_extra_uus(sizeof(tx_resp_msg))) /* Added delay for the profile (preamble, STS, data rate) */
                                     * UUS_TO_DWT_TIME)) >> 8;                /* Converted to time units for chip */
 
                     dwt_setdelayedtrxtime(resp_tx_time);
@@ -332,6 +336,10 @@ int app_main(void)
                     /* If dwt_starttx() returns an error, abandon this ranging
                      * exchange and proceed to the next one. See NOTE 10 below. */
                     if (ret == DWT_SUCCESS) {
+                        /* Write the IV of the next exchange while the
+                         * response is sent. See NOTE 16 below. */
+                        sts_session_prime();
+
                         /* Poll DW IC until TX frame sent event set. See NOTE 6 below. */
                         while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS_BIT_MASK))
                         { /* spin */ };
@@ -357,8 +365,8 @@ int app_main(void)
                     uint64_t final_rx_ts;
                     uint32_t poll_tx_ts, resp_rx_ts, final_tx_ts;
                     uint32_t poll_rx_ts_32, resp_tx_ts_32, final_rx_ts_32;
-                    double Ra, Rb, Da, Db, tof, distance;
-                    int64_t tof_dtu;
+                    uint32_t Ra, Rb, Da, Db;
+                    int32_t tof, distance;
 
                     /* Retrieve response transmission and final reception timestamps. */
                     resp_tx_ts = get_tx_timestamp_u64();
@@ -374,22 +382,22 @@ int app_main(void)
                     poll_rx_ts_32 = (uint32_t)poll_rx_ts;
                     resp_tx_ts_32 = (uint32_t)resp_tx_ts;
                     final_rx_ts_32 = (uint32_t)final_rx_ts;
-                    Ra = (double)(resp_rx_ts - poll_tx_ts);
-                    Rb = (double)(final_rx_ts_32 - resp_tx_ts_32);
-                    Da = (double)(final_tx_ts - resp_rx_ts);
-                    Db = (double)(resp_tx_ts_32 - poll_rx_ts_32);
-                    tof_dtu = (int64_t)((Ra * Rb - Da * Db) / (Ra + Rb + Da + Db));
+                    Ra = resp_rx_ts - poll_tx_ts;
+                    Rb = final_rx_ts_32 - resp_tx_ts_32;
+                    Da = final_tx_ts - resp_rx_ts;
+                    Db = resp_tx_ts_32 - poll_rx_ts_32;
+                    tof = ranging_ds_tof(Ra, Rb, Da, Db);
 
-                    tof = tof_dtu * DWT_TIME_UNITS;
-                    distance = tof * SPEED_OF_LIGHT;
+                    distance = ranging_tof_to_mm(tof);
 
                     distance_array[distance_array_index] = distance;
 
                     distance_array_index++;
 
                     /* Display computed distance. */
+                    char mm[RANGING_MM_STR_LEN];
                     static char dist[20] = {0};
-                    sprintf(dist, "dist %3.2f m", distance);
+                    sprintf(dist, "dist %s m", ranging_mm_to_str(distance, mm));
                     //LOG_INF("%s", log_strdup(dist));
                     LOG_INF("%s", dist);
 
@@ -407,7 +415,7 @@ int app_main(void)
                     messageFlag = 0;
                 }
                 else {
-                    errors[BAD_FRAME_ERR_IDX] += 1;
+                    rx_err_record(RX_ERR_BAD_FRAME);
                     /*
                      * If any error occurs, we can reset the STS count back
                      * to default value.
@@ -416,7 +424,7 @@ int app_main(void)
                 }
             }
             else {
-                errors[RTO_ERR_IDX] += 1;
+                rx_err_record(RX_ERR_BAD_FRAME);
                 /*
                  * If any error occurs, we can reset the STS count back
                  * to default value.
@@ -425,16 +433,12 @@ int app_main(void)
             }
         }
         else {
-            check_for_status_errors(status_reg, errors);
-
-            if (!(status_reg & SYS_STATUS_RXFCG_BIT_MASK)) {
-                errors[BAD_FRAME_ERR_IDX] += 1;
+            if (status_reg & SYS_STATUS_RXFCG_BIT_MASK) {
+                /* Frame received, STS quality too low */
+                rx_err_record(RX_ERR_STS_QUAL);
             }
-            if (goodSts < 0) {
-                errors[PREAMBLE_COUNT_ERR_IDX] += 1;
-            }
-            if (stsQual <= 0) {
-                errors[CP_QUAL_ERR_IDX] += 1;
+            else {
+                rx_err_status(status_reg);
             }
 
             /* Clear RX error events in the DW IC status register. */
@@ -544,8 +548,11 @@ int app_main(void)
  * 15. In this operation, the high order byte of each 40-bit timestamps is discarded. This is acceptable as those time-stamps are not separated by
  *     more than 2**32 device time units (which is around 67 ms) which means that the calculation of the round-trip delays (needed in the
  *     time-of-flight computation) can be handled by a 32-bit subtraction.
- * 16. This example will set the STS key and IV upon each iteration of the main while loop. While this has the benefit of keeping the STS count in
- *     sync with the responder device (which does the same), it should be noted that this is not a 'secure' implementation as the count is reset upon
- *     each iteration of the loop. An attacker could potentially recognise this pattern if the signal was being monitored. While it serves it's
- *     purpose in this simple example, it should not be utilised in any final solution.
+ * 16. The STS key and IV are programmed once, before the main loop. At the start of each ranging exchange the IV is reloaded by
+ *     sts_session_begin(), a single short SPI write: the IV of the next exchange has already been written by sts_session_prime() while the last
+ *     frame of the current one was in the air, and only the IV words that change are written. With STS_IV_STRIDE at 0 the same IV is used for
+ *     every exchange. While this has the benefit of keeping the STS count in sync with the initiator device (which does the same), it should be
+ *     noted that this is not a 'secure' implementation as the count is reset upon each exchange. An attacker could potentially recognise this
+ *     pattern if the signal was being monitored. Setting STS_IV_STRIDE to e.g. STS_SESSION_STRIDE(DWT_STS_LEN_64, 3, 1) at both units gives each
+ *     exchange its own counter values, the two units then have to agree on the exchange number (see sts_session_sync()).
  ****************************************************************************************************************************************************/
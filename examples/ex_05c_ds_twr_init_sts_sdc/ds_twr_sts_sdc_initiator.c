@@ -37,6 +37,7 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -165,6 +166,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
@@ -175,9 +177,12 @@ int app_main(void)
 
     /* Set expected response's delay and timeout. See NOTE 4, 5 and 6 below.
      * As this example only handles one incoming frame with always the same 
-     * delay and timeout, those values can be set here once for all. */
+     * delay and timeout, those values can be set here once for all.
+     * The receiver delay is counted from the end of the poll, not from its
+     * RMARKER as phy_timing_rx_dly_uus() expects, so it stays as tuned; the
+     * timeout is lengthened for the profile (phy_timing.h). */
     dwt_setrxaftertxdelay(POLL_TX_TO_RESP_RX_DLY_UUS);
-    dwt_setrxtimeout(RESP_RX_TIMEOUT_UUS);
+    dwt_setrxtimeout(phy_timing_rx_timeout_uus(RESP_RX_TIMEOUT_UUS, sizeof(rx_resp_msg) + FCS_LEN));
     dwt_setpreambledetecttimeout(PRE_TIMEOUT);
 
     /* Next can enable TX/RX states output on GPIOs 5 and 6 to help debug */
@@ -246,7 +251,8 @@ int app_main(void)
 
                     /* Compute final message transmission time. 
                      * See NOTE 10 below. */
-                    final_tx_time = (resp_rx_ts + (RESP_RX_TO_FINAL_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                    final_tx_time = (resp_rx_ts + ((RESP_RX_TO_FINAL_TX_DLY_UUS
+                            + phy_timing_extra_uus(sizeof(tx_final_msg) + FCS_LEN)) * UUS_TO_DWT_TIME)) >> 8;
                     dwt_setdelayedtrxtime(final_tx_time);
 
                     /* Final TX timestamp is the transmission time we 
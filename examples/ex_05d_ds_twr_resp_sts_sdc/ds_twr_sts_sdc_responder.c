@@ -37,6 +37,8 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <ranging_math.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -129,8 +131,8 @@ static uint64_t final_rx_ts;
 
 /* Hold copies of computed time of flight and distance here for reference 
  * so that it can be examined at a debug breakpoint. */
-static double tof;
-static double distance;
+static int32_t tof;         /* 1/16 dtu, see ranging_math.h */
+static int32_t distance;    /* mm */
 
 /* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and 
  * power of the spectrum at the current temperature. These values can be 
@@ -175,6 +177,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
@@ -240,13 +243,14 @@ int app_main(void)
                     poll_rx_ts = get_rx_timestamp_u64();
 
                     /* Set send time for response. See NOTE 9 below. */
-                    resp_tx_time = (poll_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                    resp_tx_time = (poll_rx_ts + ((POLL_RX_TO_RESP_TX_DLY_UUS
+                            + phy_timing_extra_uus(sizeof(tx_resp_msg) + FCS_LEN)) * UUS_TO_DWT_TIME)) >> 8;
                     dwt_setdelayedtrxtime(resp_tx_time);
 
                     /* Set expected delay and timeout for final message reception. 
                      * See NOTE 4 and 5 below. */
                     dwt_setrxaftertxdelay(RESP_TX_TO_FINAL_RX_DLY_UUS);
-                    dwt_setrxtimeout(FINAL_RX_TIMEOUT_UUS);
+                    dwt_setrxtimeout(phy_timing_rx_timeout_uus(FINAL_RX_TIMEOUT_UUS, sizeof(rx_final_msg) + FCS_LEN));
 
                     /* Write and send the response message. See NOTE 10 below.*/
                     tx_resp_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
@@ -305,8 +309,7 @@ int app_main(void)
 
                                 uint32_t poll_tx_ts, resp_rx_ts, final_tx_ts;
                                 uint32_t poll_rx_ts_32, resp_tx_ts_32, final_rx_ts_32;
-                                double Ra, Rb, Da, Db;
-                                int64_t tof_dtu;
+                                uint32_t Ra, Rb, Da, Db;
 
                                 /* Retrieve response transmission and final
                                  * reception timestamps. */
@@ -325,15 +328,14 @@ int app_main(void)
                                 resp_tx_ts_32 = (uint32_t)resp_tx_ts;
                                 final_rx_ts_32 = (uint32_t)final_rx_ts;
                                 
-                                Ra = (double)(resp_rx_ts - poll_tx_ts);
-                                Rb = (double)(final_rx_ts_32 - resp_tx_ts_32);
-                                Da = (double)(final_tx_ts - resp_rx_ts);
-                                Db = (double)(resp_tx_ts_32 - poll_rx_ts_32);
+                                Ra = resp_rx_ts - poll_tx_ts;
+                                Rb = final_rx_ts_32 - resp_tx_ts_32;
+                                Da = final_tx_ts - resp_rx_ts;
+                                Db = resp_tx_ts_32 - poll_rx_ts_32;
                                 
-                                tof_dtu = (int64_t)((Ra * Rb - Da * Db) / (Ra + Rb + Da + Db));
+                                tof = ranging_ds_tof(Ra, Rb, Da, Db);
 
-                                tof = tof_dtu * DWT_TIME_UNITS;
-                                distance = tof * SPEED_OF_LIGHT;
+                                distance = ranging_tof_to_mm(tof);
 
                                 /* Display computed distance on LCD. */
                                 //LOG_INF(("DIST: %3.2f m", distance);
@@ -0,0 +1,872 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    twr_engine.c
+ *  @brief   Two-way ranging with the event driven TWR engine
+ *
+ *           Initiator (default) or responder (TWR_ENGINE_RESPONDER) side of a
+ *           TWR exchange, run by ranging/twr.c from the DW IC interrupt
+ *           callbacks. The application thread only waits for the results.
+ *           See twr.h for the engine and the ex_05a/ex_05b examples for the
+ *           frames and timings.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include <ranging_math.h>
+#include <twr.h>
+#include <phy_timing.h>
+#include <twr_sched.h>
+#include <multilat.h>
+#include <range_filter.h>
+#include <ant_cal.h>
+#include <twr_energy.h>
+#include <dw_telemetry.h>
+#include <dw_tempcomp.h>
+#include <xtal_track.h>
+#include <mac_csma.h>
+#include <dw_shell.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#ifdef TWR_ENGINE_SHELL
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+#endif
+
+#define LOG_LEVEL 3
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(twr_engine);
+
+/* Example application name and version to display on console. */
+#define APP_NAME "TWR ENGINE v1.0"
+
+/* Default communication configuration. We use default non-STS DW mode. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard 8 symbol SFD,
+                      *   1 to use non-standard 8 symbol,
+                      *   2 for non-standard 16 symbol SFD and
+                      *   3 for 4z 8 symbol SDF type */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    DWT_PHRRATE_STD, /* PHY header rate. */
+    (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+    DWT_STS_MODE_OFF, /* STS disabled */
+    DWT_STS_LEN_64,/* STS length see allowed values in Enum dwt_sts_lengths_e */
+    DWT_PDOA_M0      /* PDOA mode off */
+};
+
+/* Inter-ranging delay period, in milliseconds. */
+#define RNG_DELAY_MS 1000
+
+/* Default antenna delay values for 64 MHz PRF, used until a calibrated one is stored (see ant_cal.h). */
+#define TX_ANT_DLY 16385
+#define RX_ANT_DLY 16385
+
+#ifdef TWR_ENGINE_ANT_CAL
+/* Calibration reference (a calibrated responder) and its surveyed distance */
+#ifndef TWR_ENGINE_CAL_DISTANCE_MM
+#define TWR_ENGINE_CAL_DISTANCE_MM 2000
+#endif
+#define TWR_ENGINE_CAL_SAMPLES 20
+#endif
+
+#ifdef TWR_ENGINE_TELEMETRY
+/* Event counter snapshot period, in milliseconds */
+#define TELEMETRY_PERIOD_MS 10000
+#endif
+
+#ifdef TWR_ENGINE_TEMPCOMP
+/* Temperature and voltage sampling period, in milliseconds */
+#define TEMPCOMP_PERIOD_MS 10000
+#endif
+
+#if defined(TWR_ENGINE_SS) || defined(TWR_ENGINE_SCHED)
+#define TWR_ENGINE_MODE TWR_MODE_SS
+#else
+#define TWR_ENGINE_MODE TWR_MODE_DS
+#endif
+
+/* Margin added to the measured turnaround by the reply delay tuning */
+#ifndef TWR_ENGINE_AUTOTUNE_MARGIN_UUS
+#define TWR_ENGINE_AUTOTUNE_MARGIN_UUS 50
+#endif
+
+/* Responder address: give each anchor its own when ranging with the scheduler */
+#ifndef TWR_ENGINE_ADDR
+#define TWR_ENGINE_ADDR TWR_DEFAULT_RESP_ADDR
+#endif
+
+#if defined(TWR_ENGINE_SCHED) || defined(TWR_ENGINE_BCAST)
+/* Anchors ranged by the scheduler (or the broadcast poll), and the round period */
+static const uint16_t anchors[] = {
+    TWR_DEFAULT_RESP_ADDR, TWR_DEFAULT_RESP_ADDR + 1, TWR_DEFAULT_RESP_ADDR + 2, TWR_DEFAULT_RESP_ADDR + 3
+};
+#define ROUND_PERIOD_MS 100
+#endif
+
+#ifdef TWR_ENGINE_SCHED
+static twr_sched_round_t last_round;
+#endif
+
+#ifdef TWR_ENGINE_POSITION
+/* Anchor coordinates (in anchors[] order), in mm: a 6 m x 4 m room with the anchors in the corners, 2.5 m high.
+ * The tag is solved in 2D, 1 m above the floor: set the surveyed coordinates and the tag height of the site. */
+static const multilat_anchor_t anchor_pos[] = {
+    { TWR_DEFAULT_RESP_ADDR,     {    0,    0, 2500 } },
+    { TWR_DEFAULT_RESP_ADDR + 1, { 6000,    0, 2500 } },
+    { TWR_DEFAULT_RESP_ADDR + 2, { 6000, 4000, 2500 } },
+    { TWR_DEFAULT_RESP_ADDR + 3, {    0, 4000, 2500 } }
+};
+static const multilat_config_t multilat_cfg = {
+    2,          /* dims */
+    1000,       /* z_mm */
+    10,         /* max_iter */
+    5,          /* tol_mm */
+    150         /* max_rms_mm */
+};
+static multilat_t multilat;
+#endif
+
+/* Last result, handed from the DW IC interrupt context to the application thread */
+static twr_result_t last_result;
+static K_SEM_DEFINE(result_sem, 0, 1);
+
+#ifdef TWR_ENGINE_FILTER
+/* Reception quality of the last result, read in the interrupt context */
+static range_sample_t last_sample;
+#endif
+
+#ifdef TWR_ENGINE_CSMA
+/* Channel access of the polls */
+static mac_csma_t csma;
+#endif
+
+#ifdef TWR_ENGINE_SHELL
+/* Engine configuration, changed by "dw reply" */
+static twr_config_t *shell_twr_cfg;
+#endif
+
+/* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and power
+ * of the spectrum at the current temperature.
+ * These values can be calibrated prior to taking reference measurements. */
+extern dwt_txconfig_t txconfig_options;
+
+/*! ---------------------------------------------------------------------------
+ * @fn twr_result_cb()
+ *
+ * @brief Result callback, called by the TWR engine from the DW IC interrupt context.
+ *
+ * @param  result - exchange result
+ *
+ * @return none
+ */
+static void twr_result_cb(const twr_result_t *result)
+{
+    last_result = *result;
+#ifdef TWR_ENGINE_FILTER
+    if (result->has_tof) {
+        range_filter_sample(result, &last_sample);
+    }
+#endif
+    k_sem_give(&result_sem);
+}
+
+#ifdef TWR_ENGINE_SHELL
+/*! ---------------------------------------------------------------------------
+ * @fn cmd_reply()
+ *
+ * @brief "dw reply [<uus>]": show or set the own reply delay (responder: poll RX
+ *        to response TX, DS initiator: response RX to final TX) and restart the
+ *        engine with it. The peer RX delays are not changed.
+ *
+ * @return 0 or a negative error
+ */
+static int cmd_reply(const struct shell *sh, size_t argc, char **argv)
+{
+#ifdef TWR_ENGINE_RESPONDER
+    uint32_t *dly = &shell_twr_cfg->poll_rx_to_resp_tx_dly_uus;
+#else
+    uint32_t *dly = &shell_twr_cfg->resp_rx_to_final_tx_dly_uus;
+#endif
+
+    if (argc > 1) {
+        char *end;
+        uint32_t uus = strtoul(argv[1], &end, 0);
+
+        if ((end == argv[1]) || (*end != '\0')) {
+            shell_error(sh, "bad delay %s", argv[1]);
+            return -EINVAL;
+        }
+        *dly = uus;
+        twr_stop();
+        twr_init(shell_twr_cfg, twr_result_cb);
+#ifdef TWR_ENGINE_RESPONDER
+        twr_listen();
+#endif
+    }
+
+    shell_print(sh, "reply delay %u uus", *dly);
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((dw), reply, NULL, "TWR reply delay: [<uus>]", cmd_reply, 1, 1);
+#endif
+
+#ifdef TWR_ENGINE_FILTER
+/*! ---------------------------------------------------------------------------
+ * @fn range_batch_cb()
+ *
+ * @brief Filtered results, called by the range filter from the application thread.
+ *
+ * @param  out - results
+ * @param  count - number of results
+ *
+ * @return none
+ */
+static void range_batch_cb(const range_filter_out_t *out, uint8_t count)
+{
+    const range_filter_stats_t *stats = range_filter_get_stats();
+
+    for (int i = 0; i < count; i++) {
+        char dist[RANGING_MM_STR_LEN];
+        ranging_mm_to_str(out[i].distance_mm, dist);
+        LOG_INF("filtered peer %04x seq %u: %s m (%u samples, quality %u)",
+                out[i].peer, out[i].seq, dist, out[i].samples, out[i].quality);
+    }
+    LOG_INF("filter: %u accepted, rejected %u sts %u fp %u quality %u gate",
+            stats->accepted, stats->rej_sts, stats->rej_fp, stats->rej_quality, stats->rej_gate);
+}
+#endif
+
+#ifdef TWR_ENGINE_SCHED
+/*! ---------------------------------------------------------------------------
+ * @fn twr_round_cb()
+ *
+ * @brief Round callback, called by the TWR scheduler from the DW IC interrupt context.
+ *
+ * @param  round - round results
+ *
+ * @return none
+ */
+static void twr_round_cb(const twr_sched_round_t *round)
+{
+    last_round = *round;
+    k_sem_give(&result_sem);
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn twr_sched_loop()
+ *
+ * @brief Range against the anchors list in rounds of back to back slots.
+ *
+ * @param  twr_cfg - TWR engine configuration
+ *
+ * @return none
+ */
+static void twr_sched_loop(const twr_config_t *twr_cfg)
+{
+    uint8_t n = sizeof(anchors) / sizeof(anchors[0]);
+
+    twr_sched_init(twr_cfg, &config, TWR_ENGINE_MODE, anchors, n, twr_round_cb);
+
+    LOG_INF("Scheduler ready: %u anchors, %u uus slots", n, twr_sched_get_slot_uus());
+
+#ifdef TWR_ENGINE_POSITION
+    multilat_init(&multilat, &multilat_cfg, anchor_pos, sizeof(anchor_pos) / sizeof(anchor_pos[0]));
+#endif
+
+    while (1) {
+
+        uint32_t start = k_uptime_get_32();
+
+        twr_sched_start_round();
+        k_sem_take(&result_sem, K_FOREVER);
+
+#ifdef TWR_ENGINE_POSITION
+        /* One position per round instead of the distances */
+        multilat_fix_t fix;
+        char x[RANGING_MM_STR_LEN], y[RANGING_MM_STR_LEN];
+
+        if (multilat_solve_round(&multilat, &last_round, &fix) == DWT_SUCCESS) {
+            ranging_mm_to_str(fix.pos.x_mm, x);
+            ranging_mm_to_str(fix.pos.y_mm, y);
+            LOG_INF("position %s %s m, rms %u mm, %u ranges, %u iterations", x, y, fix.rms_mm, fix.used,
+                    fix.iterations);
+        }
+        else {
+            LOG_INF("no position: status %d, %u ranges, rms %u mm", fix.status, fix.used, fix.rms_mm);
+        }
+#else
+        for (int i = 0; i < last_round.count; i++) {
+            const twr_result_t *r = &last_round.result[i];
+            if (r->status == TWR_OK && r->has_tof) {
+                char dist[RANGING_MM_STR_LEN];
+                ranging_mm_to_str(r->distance_mm, dist);
+                LOG_INF("anchor %04x: %s m", r->peer, dist);
+            }
+            else {
+                LOG_INF("anchor %04x: error %d", r->peer, r->status);
+            }
+        }
+#endif
+
+        uint32_t elapsed = k_uptime_get_32() - start;
+        if (elapsed < ROUND_PERIOD_MS) {
+            Sleep(ROUND_PERIOD_MS - elapsed);
+        }
+    }
+}
+#endif
+
+#ifdef TWR_ENGINE_BCAST
+/*! ---------------------------------------------------------------------------
+ * @fn twr_bcast_result_cb()
+ *
+ * @brief Broadcast DS-TWR result callback, called once per anchor from the DW IC
+ *        interrupt context (the distances are computed by the anchors).
+ *
+ * @param  result - exchange result for one anchor
+ *
+ * @return none
+ */
+static void twr_bcast_result_cb(const twr_result_t *result)
+{
+    LOG_INF("anchor %04x: status %d", result->peer, result->status);
+
+    if (result->peer == anchors[sizeof(anchors) / sizeof(anchors[0]) - 1]) {
+        k_sem_give(&result_sem);
+    }
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn twr_bcast_loop()
+ *
+ * @brief Range against the anchors list with one broadcast poll, one response
+ *        per anchor slot and one final (N + 2 frames).
+ *
+ * @param  twr_cfg - TWR engine configuration
+ *
+ * @return none
+ */
+static void twr_bcast_loop(const twr_config_t *twr_cfg)
+{
+    uint8_t n = sizeof(anchors) / sizeof(anchors[0]);
+    uint16_t slot = twr_bcast_slot_uus(&config);
+
+    twr_init(twr_cfg, twr_bcast_result_cb);
+
+    LOG_INF("Broadcast ready: %u anchors, %u uus slots", n, slot);
+
+    while (1) {
+
+        uint32_t start = k_uptime_get_32();
+
+        if (twr_start_bcast(anchors, n, slot) == DWT_SUCCESS) {
+            k_sem_take(&result_sem, K_FOREVER);
+        }
+
+        uint32_t elapsed = k_uptime_get_32() - start;
+        if (elapsed < ROUND_PERIOD_MS) {
+            Sleep(ROUND_PERIOD_MS - elapsed);
+        }
+    }
+}
+#endif
+
+#ifdef TWR_ENGINE_ANT_CAL
+/*! ---------------------------------------------------------------------------
+ * @fn twr_ant_cal()
+ *
+ * @brief Range (SS-TWR) against the reference at a known distance, compute the antenna delay, store it in the
+ *        settings and program it.
+ *
+ * @param  twr_cfg - engine configuration, its TX antenna delay is updated
+ *
+ * @return none
+ */
+static void twr_ant_cal(twr_config_t *twr_cfg)
+{
+    static const ant_cal_ref_t ref = { TWR_DEFAULT_RESP_ADDR, TWR_ENGINE_CAL_DISTANCE_MM };
+    ant_cal_result_t res;
+    char spread[RANGING_MM_STR_LEN];
+
+    LOG_INF("Antenna delay calibration: %u ranges at %d mm", TWR_ENGINE_CAL_SAMPLES, TWR_ENGINE_CAL_DISTANCE_MM);
+    ant_cal_start(&ref, 1, TWR_ENGINE_CAL_SAMPLES, twr_cfg->tx_ant_dly);
+
+    do {
+        if (twr_start(TWR_MODE_SS, ref.addr) != DWT_SUCCESS) {
+            LOG_ERR("start failed");
+        }
+        k_sem_take(&result_sem, K_FOREVER);
+        Sleep(RNG_DELAY_MS / 10);
+    } while (!ant_cal_push(&last_result));
+
+    if (ant_cal_solve(&res) != DWT_SUCCESS) {
+        LOG_ERR("calibration failed, error %d/16 dtu", res.error[0]);
+        return;
+    }
+    if (ant_cal_store(config.chan, res.ant_dly, ANT_CAL_STORE_SETTINGS) != DWT_SUCCESS) {
+        LOG_WRN("antenna delay not stored (CONFIG_SETTINGS)");
+    }
+
+    LOG_INF("antenna delay %u (was %u, spread %s m)", res.ant_dly, twr_cfg->tx_ant_dly,
+            ranging_mm_to_str(res.spread_mm, spread));
+
+    dwt_setrxantennadelay(res.ant_dly);
+    dwt_settxantennadelay(res.ant_dly);
+    twr_cfg->tx_ant_dly = res.ant_dly;
+    twr_init(twr_cfg, twr_result_cb);
+}
+#endif
+
+#ifdef TWR_ENGINE_LOWPOWER
+/*! ---------------------------------------------------------------------------
+ * @fn twr_lowpower_wake()
+ *
+ * @brief Wake the DW IC up and restore its configuration: the AON memory keeps
+ *        it over the sleep (DWT_CONFIG), dwt_restoreconfig() redoes the parts it
+ *        does not keep. The engine state and callbacks are on the host side.
+ *
+ * @return none
+ */
+static void twr_lowpower_wake(void)
+{
+    dwt_wakeup_ic();
+
+    /* Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC */
+    Sleep(2);
+
+    while (!dwt_checkidlerc()) { /* spin */ };
+
+    dwt_restoreconfig();
+
+    /* Clearing the SPI ready interrupt */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn twr_lowpower_loop()
+ *
+ * @brief Range every RNG_DELAY_MS with the DW IC asleep in between: wake up,
+ *        range, and sleep again right after the final TX (DS-TWR, see
+ *        sleep_after_final in twr.h) or after the result (SS-TWR, errors).
+ *        The sleep and wake-up times are measured with the cycle counter and
+ *        the exchange is split by the energy model, see twr_energy.h.
+ *
+ * @param  twr_cfg - TWR engine configuration
+ *
+ * @return none
+ */
+static void twr_lowpower_loop(const twr_config_t *twr_cfg)
+{
+    twr_energy_model_t model;
+    uint32_t sleep_start;
+    uint32_t overlap_us = 0;
+
+    twr_energy_default_model(&model);
+    twr_energy_init(&model, &config, twr_cfg);
+
+    /* Keep the configuration in the AON memory, wake up on the chip select or the WAKEUP pin (dwt_wakeup_ic()) */
+    dwt_configuresleep(DWT_CONFIG, DWT_PRES_SLEEP | DWT_WAKE_CSN | DWT_WAKE_WUP | DWT_SLP_EN);
+
+    LOG_INF("Low power initiator ready");
+
+    dwt_entersleep(DWT_DW_IDLE);
+    sleep_start = k_cycle_get_32();
+
+    while (1) {
+
+        const twr_energy_range_t *r;
+        uint32_t start, sleep_us, active_us;
+
+        Sleep(RNG_DELAY_MS);
+
+        /* One record per range: the sleep before it, the wake-up and the exchange */
+        twr_energy_begin();
+        start = k_cycle_get_32();
+        sleep_us = k_cyc_to_us_floor32(start - sleep_start);
+        twr_energy_add(TWR_ENERGY_SLEEP, (sleep_us > overlap_us) ? (sleep_us - overlap_us) : 0);
+
+        twr_lowpower_wake();
+        twr_energy_add(TWR_ENERGY_WAKE, k_cyc_to_us_floor32(k_cycle_get_32() - start));
+
+        start = k_cycle_get_32();
+        if (twr_start(TWR_ENGINE_MODE, TWR_DEFAULT_RESP_ADDR) != DWT_SUCCESS) {
+            LOG_ERR("start failed");
+            dwt_entersleep(DWT_DW_IDLE);
+            sleep_start = k_cycle_get_32();
+            overlap_us = 0;
+            continue;
+        }
+        k_sem_take(&result_sem, K_FOREVER);
+
+        if ((last_result.status != TWR_OK) || (last_result.mode == TWR_MODE_SS)) {
+            /* No final armed to sleep after its TX */
+            dwt_entersleep(DWT_DW_IDLE);
+        }
+        sleep_start = k_cycle_get_32();
+        active_us = k_cyc_to_us_floor32(sleep_start - start);
+
+        /* The DS final goes out after the result: that time is counted in the exchange, not in the next sleep */
+        overlap_us = twr_energy_exchange(&last_result, active_us) - active_us;
+
+        /* The DW IC is asleep from here: no register access until the next wake-up */
+        r = twr_energy_end(last_result.status);
+
+        if ((last_result.status == TWR_OK) && last_result.has_tof) {
+            char mm[RANGING_MM_STR_LEN];
+            LOG_INF("seq %u: dist %s m, %u nC in %u ms", last_result.seq,
+                    ranging_mm_to_str(last_result.distance_mm, mm), r->total_nc, r->total_us / 1000);
+        }
+        else {
+            LOG_INF("seq %u: status %d, %u nC in %u ms", last_result.seq, last_result.status,
+                    r->total_nc, r->total_us / 1000);
+        }
+        LOG_INF("  sleep %u wake %u idle %u tx %u rx %u nC", r->nc[TWR_ENERGY_SLEEP], r->nc[TWR_ENERGY_WAKE],
+                r->nc[TWR_ENERGY_IDLE], r->nc[TWR_ENERGY_TX], r->nc[TWR_ENERGY_RX]);
+        if ((twr_energy_get_totals()->ranges % 10) == 0) {
+            LOG_INF("  %u ranges (%u ok), average %u nA", twr_energy_get_totals()->ranges,
+                    twr_energy_get_totals()->ok, twr_energy_avg_na());
+        }
+    }
+}
+#endif
+
+#ifdef TWR_ENGINE_TEMPCOMP
+/*! ---------------------------------------------------------------------------
+ * @fn twr_tempcomp()
+ *
+ * @brief Sample the temperature and the voltage when due and compensate the PG
+ *        delay and the crystal trim, see dw_tempcomp.h. The responder stops
+ *        listening for it (the PG calibration needs the transceiver off).
+ *
+ * @return none
+ */
+static void twr_tempcomp(void)
+{
+    uint32_t now = k_uptime_get_32();
+
+    if (!dw_tempcomp_due(now)) {
+        return;
+    }
+
+#ifdef TWR_ENGINE_RESPONDER
+    twr_stop();
+#endif
+    if (dw_tempcomp_poll(now)) {
+        const dw_tempcomp_state_t *st = dw_tempcomp_get_state();
+        LOG_INF("temp %d.%02u C, vbat %u mV: PG delay 0x%02x, xtal trim %u", st->temp_cc / 100,
+                (unsigned)((st->temp_cc < 0) ? -st->temp_cc : st->temp_cc) % 100, st->vbat_mv,
+                st->pg_delay, st->xtal_trim);
+    }
+#ifdef TWR_ENGINE_RESPONDER
+    twr_listen();
+#endif
+}
+#endif
+
+#ifdef TWR_ENGINE_CSMA
+/*! ---------------------------------------------------------------------------
+ * @fn twr_csma_retry()
+ *
+ * @brief Initiator: while the poll of the exchange is cancelled by a busy CCA
+ *        (TWR_ERR_BUSY), back off and start it again, see mac_csma.h. Returns
+ *        with the result of the last attempt in last_result.
+ *
+ * @return none
+ */
+static void twr_csma_retry(void)
+{
+    while (last_result.status == TWR_ERR_BUSY) {
+        int32_t backoff = mac_csma_busy(&csma);
+
+        if (backoff == MAC_CSMA_FAILURE) {
+            const mac_csma_stats_t *stats = mac_csma_get_stats(&csma);
+            LOG_INF("channel access failure (%u of %u polls, %u busy CCA)", stats->failures,
+                    stats->frames, stats->busy);
+            return;
+        }
+
+        k_usleep(backoff);
+
+        if (twr_start(TWR_ENGINE_MODE, TWR_DEFAULT_RESP_ADDR) != DWT_SUCCESS) {
+            LOG_ERR("start failed");
+            return;
+        }
+        k_sem_take(&result_sem, K_FOREVER);
+    }
+
+    if (mac_csma_sent(&csma) != 0) {
+        LOG_DBG("poll sent after %u busy CCA", csma.nb);
+    }
+}
+#endif
+
+/*! ---------------------------------------------------------------------------
+ * @fn twr_engine()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int app_main(void)
+{
+    twr_config_t twr_cfg;
+    uint16_t ant_dly;
+
+    /* Display application name. */
+    LOG_INF(APP_NAME);
+
+    /* Configure SPI rate, DW3000 supports up to 38 MHz */
+    port_set_dw_ic_spi_fastrate();
+
+    /* Reset DW IC */
+    /* Target specific drive of RSTn line into DW IC low for a period. */
+    reset_DWIC();
+
+    /* Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC */
+    Sleep(2);
+
+    /* Need to make sure DW IC is in IDLE_RC before proceeding */
+    while (!dwt_checkidlerc()) { /* spin */ };
+
+#ifdef TWR_ENGINE_LOWPOWER
+    /* Skip the OTP reads after a warm reboot, see dwt_setinitcache() */
+    port_warm_cache_load();
+#endif
+
+    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR) {
+        LOG_ERR("INIT FAILED");
+        while (1) { /* spin */ };
+    }
+
+#ifdef TWR_ENGINE_LOWPOWER
+    port_warm_cache_save();
+#endif
+
+    /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration
+     * has failed the host should reset the device */
+    if (dwt_configure(&config)) {
+        LOG_ERR("CONFIG FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* Frame airtimes of the profile for the engine, see phy_timing.h */
+    phy_timing_apply(0, &config);
+
+    /* Configure the TX spectrum parameters (power, PG delay and PG count) */
+    dwt_configuretxrf(&txconfig_options);
+
+    /* Apply the stored antenna delay of the channel, or the default value. */
+    ant_dly = ant_cal_apply(config.chan, TX_ANT_DLY);
+    LOG_INF("antenna delay %u", ant_dly);
+
+#ifdef TWR_ENGINE_XTALTRACK
+    {
+        xtal_track_config_t track_cfg;
+
+        /* Follow the peer crystal, from the trim saved at the last convergence if any */
+        xtal_track_default_config(&track_cfg);
+        xtal_track_init(&track_cfg);
+        LOG_INF("xtal trim %u%s", xtal_track_get_state()->trim,
+                xtal_track_get_state()->has_saved ? " (saved)" : "");
+    }
+#endif
+
+    dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
+
+    dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
+
+#ifdef TWR_ENGINE_RESPONDER
+    twr_default_config(&twr_cfg, TWR_ROLE_RESPONDER);
+    twr_cfg.addr = TWR_ENGINE_ADDR;
+#else
+    twr_default_config(&twr_cfg, TWR_ROLE_INITIATOR);
+#ifdef TWR_ENGINE_LOWPOWER
+    twr_cfg.sleep_after_final = 1;
+#endif
+#ifdef TWR_ENGINE_CSMA
+    {
+        mac_csma_config_t csma_cfg;
+
+        /* The polls are sent after a clear CCA of pre_timeout PACs */
+        twr_cfg.cca = 1;
+        mac_csma_default_config(&csma_cfg);
+        csma_cfg.cca_pacs = twr_cfg.pre_timeout;
+        mac_csma_init(&csma, &csma_cfg);
+    }
+#endif
+#endif
+    twr_cfg.tx_ant_dly = ant_dly;
+
+    /* Register the engine call-backs and enable the TX/RX interrupts. */
+    twr_init(&twr_cfg, twr_result_cb);
+
+#ifdef TWR_ENGINE_SHELL
+    /* "dw" shell commands on the configurations in use */
+    dw_shell_init(&config, &txconfig_options);
+    shell_twr_cfg = &twr_cfg;
+#endif
+
+#ifdef TWR_ENGINE_FILTER
+    {
+        range_filter_config_t filter_cfg;
+
+        range_filter_default_config(&filter_cfg);
+        range_filter_init(&filter_cfg, range_batch_cb);
+    }
+#endif
+
+#ifdef TWR_ENGINE_AUTOTUNE
+    /* Shrink the reply delays to the measured turnaround, see twr_autotune(). */
+    twr_autotune(&config, TWR_ENGINE_AUTOTUNE_MARGIN_UUS);
+#endif
+
+#if defined(TWR_ENGINE_MULTI) && defined(TWR_ENGINE_RESPONDER)
+    /* Interleave the exchanges of several tags, see twr_multi(). */
+    twr_multi(&config);
+#endif
+
+    /* Clearing the SPI ready interrupt */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+
+    /* Install DW IC IRQ handler. */
+    port_set_dwic_isr(dwt_isr);
+
+#if defined(TWR_ENGINE_ANT_CAL) && !defined(TWR_ENGINE_RESPONDER)
+    twr_ant_cal(&twr_cfg);
+#endif
+#if defined(TWR_ENGINE_SCHED) && !defined(TWR_ENGINE_RESPONDER)
+    twr_sched_loop(&twr_cfg);
+#endif
+#if defined(TWR_ENGINE_BCAST) && !defined(TWR_ENGINE_RESPONDER)
+    twr_bcast_loop(&twr_cfg);
+#endif
+#if defined(TWR_ENGINE_LOWPOWER) && !defined(TWR_ENGINE_RESPONDER)
+    twr_lowpower_loop(&twr_cfg);
+#endif
+
+#ifdef TWR_ENGINE_RESPONDER
+    LOG_INF("Responder ready");
+    twr_listen();
+#else
+    LOG_INF("Initiator ready");
+#endif
+
+#if defined(TWR_ENGINE_TELEMETRY) && !defined(TWR_ENGINE_RESPONDER)
+    dw_telemetry_init(TELEMETRY_PERIOD_MS, k_uptime_get_32());
+#endif
+#ifdef TWR_ENGINE_TEMPCOMP
+    {
+        dw_tempcomp_config_t comp_cfg;
+
+        /* References: the TX configuration and the crystal trim set above */
+        dw_tempcomp_default_config(&comp_cfg);
+        comp_cfg.period_ms = TEMPCOMP_PERIOD_MS;
+#ifdef TWR_ENGINE_RESPONDER
+        twr_stop();
+        dw_tempcomp_init(&comp_cfg, config.chan, k_uptime_get_32());
+        twr_listen();
+#else
+        dw_tempcomp_init(&comp_cfg, config.chan, k_uptime_get_32());
+#endif
+    }
+#endif
+
+    while (1) {
+
+#ifndef TWR_ENGINE_RESPONDER
+#ifdef TWR_ENGINE_CSMA
+        mac_csma_begin(&csma);
+#endif
+        if (twr_start(TWR_ENGINE_MODE, TWR_DEFAULT_RESP_ADDR) != DWT_SUCCESS) {
+            LOG_ERR("start failed");
+        }
+#endif
+
+        /* The engine runs the exchange from the interrupt callbacks. */
+#if defined(TWR_ENGINE_TEMPCOMP) && defined(TWR_ENGINE_RESPONDER)
+        /* Without polls, wake up for the compensation anyway */
+        if (k_sem_take(&result_sem, K_MSEC(TEMPCOMP_PERIOD_MS)) != 0) {
+            twr_tempcomp();
+            continue;
+        }
+#else
+        k_sem_take(&result_sem, K_FOREVER);
+#endif
+#if defined(TWR_ENGINE_CSMA) && !defined(TWR_ENGINE_RESPONDER)
+        twr_csma_retry();
+#endif
+
+#ifdef TWR_ENGINE_AUTOTUNE
+        {
+            const twr_tune_t *tune = twr_get_tune();
+#ifdef TWR_ENGINE_RESPONDER
+            twr_tune_e idx = TWR_TUNE_RESP;
+#else
+            twr_tune_e idx = TWR_TUNE_FINAL;
+#endif
+
+            LOG_DBG("reply %u uus (turnaround %u uus, %u late)", tune->reply_dly_uus[idx],
+                    tune->latency_uus[idx], tune->late_tx[idx]);
+        }
+#endif
+        if (last_result.status != TWR_OK) {
+            LOG_INF("%s seq %u peer %04x: error %d",
+                    (last_result.mode == TWR_MODE_SS) ? "SS" : "DS",
+                    last_result.seq, last_result.peer, last_result.status);
+        }
+        else if (last_result.has_tof) {
+            char mm[RANGING_MM_STR_LEN];
+            static char dist[20] = {0};
+            sprintf(dist, "dist %s m", ranging_mm_to_str(last_result.distance_mm, mm));
+            LOG_INF("%s seq %u peer %04x: %s",
+                    (last_result.mode == TWR_MODE_SS) ? "SS" : "DS",
+                    last_result.seq, last_result.peer, dist);
+#ifdef TWR_ENGINE_FILTER
+            range_filter_push(&last_sample);
+#endif
+        }
+
+#ifdef TWR_ENGINE_XTALTRACK
+        if ((last_result.status == TWR_OK) && (last_result.mode != TWR_MODE_DS_BCAST) &&
+            xtal_track_push(last_result.peer, last_result.clock_offset)) {
+            LOG_INF("xtal trim %u (offset %d ppb)", xtal_track_get_state()->trim,
+                    xtal_track_get_state()->mean_ppb);
+        }
+#endif
+
+#ifdef TWR_ENGINE_TEMPCOMP
+        twr_tempcomp();
+#endif
+
+#ifndef TWR_ENGINE_RESPONDER
+#ifdef TWR_ENGINE_TELEMETRY
+        /* The exchange is over: the counters are read without delaying the ranging. */
+        if (dw_telemetry_poll(k_uptime_get_32())) {
+            const dw_telemetry_rates_t *rates = dw_telemetry_get_rates();
+            LOG_INF("rx %u tx %u err %u frames/1000 s, PER %u/1000",
+                    rates->rx_mfps, rates->tx_mfps, rates->err_mfps, rates->per_permille);
+        }
+#endif
+        /* Execute a delay between ranging exchanges. */
+        Sleep(RNG_DELAY_MS);
+#endif
+    }
+}
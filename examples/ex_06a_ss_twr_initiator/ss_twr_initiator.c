@@ -30,7 +30,13 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <ranging_math.h>
 #include <config_options.h>
+#include <phy_timing.h>
+#ifdef SS_TWR_BIN_LOG
+#include <dw_binlog.h>
+#include <SEGGER_RTT.h>
+#endif
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -99,8 +105,21 @@ static uint32_t status_reg = 0;
 
 /* Hold copies of computed time of flight and distance here for reference
  * so that it can be examined at a debug breakpoint. */
-static double tof;
-static double distance;
+static int32_t tof;         /* 1/16 dtu, see ranging_math.h */
+static int32_t distance;    /* mm */
+
+#ifdef SS_TWR_BIN_LOG
+/* Binary range and timing records on RTT up channel 1, the text log uses channel 0. See NOTE 14 below. */
+#define BINLOG_RTT_CHANNEL  1
+#define BINLOG_RTT_BUF_LEN  1024
+#define BINLOG_EXCHANGE     1       /* timing record id: poll TX to distance computed */
+static uint8_t binlog_rtt_buf[BINLOG_RTT_BUF_LEN];
+
+static int binlog_rtt_write(const uint8_t *data, uint16_t len)
+{
+    return (int)SEGGER_RTT_Write(BINLOG_RTT_CHANNEL, data, len);
+}
+#endif
 
 /* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and power of the spectrum at the current
  * temperature. These values can be calibrated prior to taking reference measurements. See NOTE 2 below. */
@@ -145,6 +164,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
@@ -155,18 +175,30 @@ int app_main(void)
 
     /* Set expected response's delay and timeout. See NOTE 1 and 5 below.
      * As this example only handles one incoming frame with always the same
-     * delay and timeout, those values can be set here once for all. */
+     * delay and timeout, those values can be set here once for all.
+     * The receiver delay is counted from the end of the poll, not from its
+     * RMARKER as phy_timing_rx_dly_uus() expects, so it stays as tuned; the
+     * timeout is lengthened for the profile (phy_timing.h). */
     dwt_setrxaftertxdelay(POLL_TX_TO_RESP_RX_DLY_UUS);
-    dwt_setrxtimeout(RESP_RX_TIMEOUT_UUS);
+    dwt_setrxtimeout(phy_timing_rx_timeout_uus(RESP_RX_TIMEOUT_UUS, sizeof(rx_resp_msg)));
 
     /* Next can enable TX/RX states output on GPIOs 5 and 6 to help debug, and also TX/RX LEDs
      * Note, in real low power applications the LEDs should not be used. */
     dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
 
+#ifdef SS_TWR_BIN_LOG
+    SEGGER_RTT_ConfigUpBuffer(BINLOG_RTT_CHANNEL, "BINLOG", binlog_rtt_buf, BINLOG_RTT_BUF_LEN,
+                              SEGGER_RTT_MODE_NO_BLOCK_TRIM);
+    dw_binlog_init(binlog_rtt_write);
+#endif
+
     LOG_INF("Initiator ready");
 
     /* Loop forever initiating ranging exchanges. */
     while (1) {
+#ifdef SS_TWR_BIN_LOG
+        uint32_t start_cyc = k_cycle_get_32();
+#endif
 
         /* Write frame data to DW IC and prepare transmission. See NOTE 7 below. */
         tx_poll_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
@@ -210,14 +242,16 @@ int app_main(void)
 
                     uint32_t poll_tx_ts, resp_rx_ts, poll_rx_ts, resp_tx_ts;
                     int32_t rtd_init, rtd_resp;
-                    float clockOffsetRatio ;
+                    int32_t clockOffsetRatio;
+                    int16_t clockOffset;
 
                     /* Retrieve poll transmission and response reception timestamps. See NOTE 9 below. */
                     poll_tx_ts = dwt_readtxtimestamplo32();
                     resp_rx_ts = dwt_readrxtimestamplo32();
 
                     /* Read carrier integrator value and calculate clock offset ratio. See NOTE 11 below. */
-                    clockOffsetRatio = ((float)dwt_readclockoffset()) / (uint32_t)(1<<26);
+                    clockOffset = dwt_readclockoffset();
+                    clockOffsetRatio = ranging_clock_offset_q32(clockOffset);
 
                     /* Get timestamps embedded in response message. */
                     resp_msg_get_ts(&rx_buffer[RESP_MSG_POLL_RX_TS_IDX], &poll_rx_ts);
@@ -229,13 +263,20 @@ int app_main(void)
                     rtd_init = resp_rx_ts - poll_tx_ts;
                     rtd_resp = resp_tx_ts - poll_rx_ts;
 
-                    tof = ((rtd_init - rtd_resp * (1 - clockOffsetRatio)) / (float)2.0) * (float)DWT_TIME_UNITS;
-                    distance = tof * SPEED_OF_LIGHT;
+                    tof = ranging_ss_tof(rtd_init, rtd_resp, clockOffsetRatio);
+                    distance = ranging_tof_to_mm(tof);
 
+#ifdef SS_TWR_BIN_LOG
+                    /* Log computed distance and exchange time as binary records. */
+                    dw_binlog_range((uint16_t)(rx_buffer[7] | (rx_buffer[8] << 8)), clockOffset, distance, tof);
+                    dw_binlog_timing(BINLOG_EXCHANGE, frame_seq_nb, k_cyc_to_us_floor32(k_cycle_get_32() - start_cyc));
+#else
                     /* Display computed distance. */
+                    char mm[RANGING_MM_STR_LEN];
                     static char dist[20] = {0};
-                    sprintf(dist, "dist %3.2f m", distance);
+                    sprintf(dist, "dist %s m", ranging_mm_to_str(distance, mm));
                     LOG_INF("%s", dist);
+#endif
                 }
             }
         }
@@ -317,4 +358,8 @@ int app_main(void)
  *     thereafter.
  * 13. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *     configuration.
+ * 14. With SS_TWR_BIN_LOG, each result is written as a fixed-size binary record (platform/dw_binlog.h) instead of a formatted LOG_INF(): the
+ *    ranging loop only copies about 20 bytes into a RAM ring, a low priority thread sends them on RTT up channel 1 in non-blocking mode when the
+ *    loop sleeps. Capture the channel with e.g. "JLinkRTTLogger -Device NRF52840_XXAA -If SWD -Speed 4000 -RTTChannel 1 ranges.bin" and decode
+ *    it with "tools/binlog_decode.py ranges.bin". Records lost on a full ring show as gaps in the sequence numbers.
  ****************************************************************************************************************************************************/
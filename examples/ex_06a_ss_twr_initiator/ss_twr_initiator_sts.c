@@ -46,7 +46,11 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <rx_errors.h>
+#include <sts_session.h>
+#include <ranging_math.h>
 #include <config_options.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -94,11 +98,8 @@ static uint32_t status_reg = 0;
 #define RESP_RX_TIMEOUT_UUS 700
 
 /* Hold copies of computed time of flight and distance here for reference so that it can be examined at a debug breakpoint. */
-static double tof;
-static double distance;
-
-/* Hold the amount of errors that have occurred */
-static uint32_t errors[23] = {0};
+static int32_t tof;         /* 1/16 dtu, see ranging_math.h */
+static int32_t distance;    /* mm */
 
 extern dwt_config_t config_options;
 extern dwt_txconfig_t txconfig_options;
@@ -131,6 +132,14 @@ static dwt_sts_cp_iv_t cp_iv = {
     0x1F9A3DE4,0xD37EC3CA,0xC44FA8FB,0x362EEB34
 };
 
+/*
+ * IV step from one ranging exchange to the next (see sts_session.h and NOTE 16 below). It must be the same at both units.
+ * 0 reloads the same IV for every exchange.
+ */
+#define STS_IV_STRIDE 0
+
+static sts_session_config_t sts_cfg;
+
 /*
  * The 'poll' message initiating the ranging exchange includes a 32-bit counter which is part
  * of the IV used to generate the scrambled timestamp sequence (STS) in the transmitted packet.
@@ -167,7 +176,6 @@ int app_main(void)
 {
     int16_t stsQual; /* This will contain STS quality index and status */
     int goodSts = 0; /* Used for checking STS quality in received signal */
-    uint8_t firstLoopFlag = 0; /* Used to track if the program has gone through the first loop or not. */
 
     /* Display application name on UART. */
     LOG_INF(APP_NAME);
@@ -203,6 +211,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config_options);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     if (config_options.chan == 5) {
@@ -219,34 +228,27 @@ int app_main(void)
     /* Set expected response's timeout. See NOTE 1 and 5 below.
      * As this example only handles one incoming frame with always the same
      * delay, this value can be set here once for all. */
-    set_resp_rx_timeout(RESP_RX_TIMEOUT_UUS, &config_options);
+    dwt_setrxtimeout(phy_timing_rx_timeout_uus(RESP_RX_TIMEOUT_UUS, sizeof(rx_resp_msg)));
 
     /* Next can enable TX/RX states output on GPIOs 5 and 6 to help diagnostics,
      * and also TX/RX LEDs */
     dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
 
+    /* Program the STS key and IV once, the IV of each ranging exchange
+     * is then kept on the host side. See NOTE 16 below. */
+    sts_cfg.key = cp_key;
+    sts_cfg.iv = cp_iv;
+    sts_cfg.stride = STS_IV_STRIDE;
+    sts_session_init(&sts_cfg);
+
+    /* Count the RX errors by kind, see rx_errors.h. */
+    rx_err_init(NULL);
+
     /* Loop for user defined number of ranges. */
     while (1) {
-        /*
-         * Set STS encryption key and IV (nonce).
-         * See NOTE 16 below.
-         */
-        if (!firstLoopFlag) {
-            /*
-             * On first loop, configure the STS key & IV, then load them.
-             */
-            dwt_configurestskey(&cp_key);
-            dwt_configurestsiv(&cp_iv);
-            dwt_configurestsloadiv();
-            firstLoopFlag = 1;
-        }
-        else {
-            /*
-             * On subsequent loops, we only need to reload the lower 32 bits of STS IV.
-             */
-            dwt_writetodevice(STS_IV0_ID, 0, 4, (uint8_t *)&cp_iv);
-            dwt_configurestsloadiv();
-        }
+        /* Load the STS IV of this exchange, written ahead of time by
+         * sts_session_prime(). See NOTE 16 below. */
+        sts_session_begin();
 
         /*
          * Send the poll message to the responder.
@@ -257,11 +259,15 @@ int app_main(void)
          * Set a reference time for the RX to start after TX timestamp.
          * See NOTE 14 below.
          */
-        set_delayed_rx_time(POLL_TX_TO_RESP_RX_DLY_UUS, &config_options);
+        dwt_setdelayedtrxtime((uint32_t)((phy_timing_rx_dly_uus(POLL_TX_TO_RESP_RX_DLY_UUS) * UUS_TO_DWT_TIME) >> 8));
 
         /* Activate reception a set time period after the TX timestamp for the POLL message. */
         dwt_rxenable(DWT_START_RX_DLY_TS);
 
+        /* Write the IV of the next exchange while the response is
+         * received. See NOTE 16 below. */
+        sts_session_prime();
+
         /* We assume that the transmission is achieved correctly, poll for
          * reception of a frame or error/timeout. See NOTE 8 below. */
         while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG_BIT_MASK |
@@ -272,7 +278,7 @@ int app_main(void)
         /*
          * Need to check the STS has been received and is good.
          */
-        goodSts = dwt_readstsquality(&stsQual);
+        goodSts = sts_session_check(&stsQual);
 
         /* Increment frame sequence number after transmission of the poll message (modulo 256). */
         frame_seq_nb++;
@@ -284,6 +290,9 @@ int app_main(void)
 
             uint32_t frame_len;
 
+            /* Count the good frame, see rx_errors.h. */
+            rx_err_status(status_reg);
+
             /* Clear the RX events. */
             dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_GOOD);
 
@@ -302,7 +311,7 @@ int app_main(void)
 
                     uint32_t poll_tx_ts, resp_rx_ts, poll_rx_ts, resp_tx_ts;
                     int32_t rtd_init, rtd_resp;
-                    float clockOffsetRatio ;
+                    int32_t clockOffsetRatio;
 
                     /* Retrieve poll transmission and response reception timestamps.
                      * See NOTE 9 below. */
@@ -311,7 +320,7 @@ int app_main(void)
 
                     /* Read carrier integrator value and calculate clock offset ratio.
                      * See NOTE 11 below. */
-                    clockOffsetRatio = ((float)dwt_readclockoffset()) / (uint32_t)(1<<26);
+                    clockOffsetRatio = ranging_clock_offset_q32(dwt_readclockoffset());
 
                     /* Get timestamps embedded in response message. */
                     resp_msg_get_ts(&rx_buffer[RESP_MSG_POLL_RX_TS_IDX], &poll_rx_ts);
@@ -322,34 +331,30 @@ int app_main(void)
                     rtd_init = resp_rx_ts - poll_tx_ts;
                     rtd_resp = resp_tx_ts - poll_rx_ts;
 
-                    tof = ((rtd_init - rtd_resp * (1 - clockOffsetRatio)) / 2.0) * DWT_TIME_UNITS;
-                    distance = tof * SPEED_OF_LIGHT;
+                    tof = ranging_ss_tof(rtd_init, rtd_resp, clockOffsetRatio);
+                    distance = ranging_tof_to_mm(tof);
 
                     /* Display computed distance. */
+                    char mm[RANGING_MM_STR_LEN];
                     static char dist[20] = {0};
-                    sprintf(dist, "dist %3.2f m", distance);
+                    sprintf(dist, "dist %s m", ranging_mm_to_str(distance, mm));
                     LOG_INF("%s", dist);
                 }
                 else {
-                    errors[BAD_FRAME_ERR_IDX] += 1;
+                    rx_err_record(RX_ERR_BAD_FRAME);
                 }
             }
             else {
-                errors[RTO_ERR_IDX] += 1;
+                rx_err_record(RX_ERR_BAD_FRAME);
             }
         }
         else {
-            check_for_status_errors(status_reg, errors);
-
-            if (!(status_reg & SYS_STATUS_RXFCG_BIT_MASK)) {
-                errors[BAD_FRAME_ERR_IDX] += 1;
+            if (status_reg & SYS_STATUS_RXFCG_BIT_MASK) {
+                /* Frame received, STS quality too low */
+                rx_err_record(RX_ERR_STS_QUAL);
             }
-            if (goodSts < 0) {
-                errors[PREAMBLE_COUNT_ERR_IDX] += 1;
-            }
-            if (stsQual <= 0)
-            {
-                errors[CP_QUAL_ERR_IDX] += 1;
+            else {
+                rx_err_status(status_reg);
             }
         }
 
@@ -456,8 +461,11 @@ int app_main(void)
  *                    <-------------->               - POLL_RX_TO_RESP_TX_DLY_UUS (depends on how quickly responder can turn around and reply)
  * 15. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *     configuration.
- * 16. This example will set the STS key and IV upon each iteration of the main while loop. While this has the benefit of keeping the STS count in
- *     sync with the responder device (which does the same), it should be noted that this is not a 'secure' implementation as the count is reset upon
- *     each iteration of the loop. An attacker could potentially recognise this pattern if the signal was being monitored. While it serves it's
- *     purpose in this simple example, it should not be utilised in any final solution.
+ * 16. The STS key and IV are programmed once, before the main loop. At the start of each ranging exchange the IV is reloaded by
+ *     sts_session_begin(), a single short SPI write: the IV of the next exchange has already been written by sts_session_prime() while the last
+ *     frame of the current one was in the air, and only the IV words that change are written. With STS_IV_STRIDE at 0 the same IV is used for
+ *     every exchange. While this has the benefit of keeping the STS count in sync with the responder device (which does the same), it should be
+ *     noted that this is not a 'secure' implementation as the count is reset upon each exchange. An attacker could potentially recognise this
+ *     pattern if the signal was being monitored. Setting STS_IV_STRIDE to e.g. STS_SESSION_STRIDE(DWT_STS_LEN_64, 3, 1) at both units gives each
+ *     exchange its own counter values, the two units then have to agree on the exchange number (see sts_session_sync()).
  ****************************************************************************************************************************************************/
@@ -53,7 +53,10 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <rx_errors.h>
+#include <ranging_math.h>
 #include <config_options.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -99,11 +102,8 @@ static uint32_t status_reg = 0;
 #define RESP_RX_TIMEOUT_UUS 1000
 
 /* Hold copies of computed time of flight and distance here for reference so that it can be examined at a debug breakpoint. */
-static double tof;
-static double distance;
-
-/* Hold the amount of errors that have occurred */
-static uint32_t errors[23] = {0};
+static int32_t tof;         /* 1/16 dtu, see ranging_math.h */
+static int32_t distance;    /* mm */
 
 extern dwt_config_t config_option_sp3;
 extern dwt_config_t config_option_sp0;
@@ -173,7 +173,7 @@ int app_main(void)
     int goodSts = 0; /* Used for checking STS quality in received signal */
     uint32_t poll_tx_ts, resp_rx_ts, poll_rx_ts, resp_tx_ts;
     int32_t rtd_init, rtd_resp;
-    float clockOffsetRatio;
+    int32_t clockOffsetRatio;
     uint8_t firstLoopFlag = 0;
 
     /* Display application name on UART. */
@@ -218,6 +218,9 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    /* PHY timing tables of the two modes: 0 SP3 (the current one), 1 SP0. */
+    phy_timing_apply(1, &config_option_sp0);
+    phy_timing_apply(0, &config_option_sp3);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     if (config_option_sp3.chan == 5) {
@@ -227,10 +230,14 @@ int app_main(void)
         dwt_configuretxrf(&txconfig_options_ch9);
     }
 
+    /* Count the RX errors by kind, see rx_errors.h. */
+    rx_err_init(NULL);
+
     /* Loop forever. */
     while (1) {
 
         dwt_configurestsmode(DWT_STS_MODE_ND);
+        phy_timing_select(0);
 
         /*
          * Set STS encryption key and IV (nonce).
@@ -259,13 +266,13 @@ int app_main(void)
         send_tx_poll_msg();
 
         /* Set expected response's timeout. See NOTE 1 and 5 below. */
-        set_resp_rx_timeout(RESP_RX_TIMEOUT_UUS, &config_option_sp3);
+        dwt_setrxtimeout(phy_timing_rx_timeout_uus(RESP_RX_TIMEOUT_UUS, 0));
 
         /*
          * Set a reference time for the RX to start after TX timestamp.
          * See NOTE 10 below.
          */
-        set_delayed_rx_time(POLL_TX_TO_RESP_RX_DLY_UUS, &config_option_sp3);
+        dwt_setdelayedtrxtime((uint32_t)((phy_timing_rx_dly_uus(POLL_TX_TO_RESP_RX_DLY_UUS) * UUS_TO_DWT_TIME) >> 8));
 
         /* Activate reception a set time period after the TX timestamp
          * for the POLL packet. */
@@ -299,6 +306,7 @@ int app_main(void)
 
                 /* Configure DW IC. See NOTE 2 below. */
                 dwt_configurestsmode(DWT_STS_MODE_OFF);
+                phy_timing_select(1);
 
                 /*
                  * Set a reference time for the RX to start after TX timestamp.
@@ -309,7 +317,7 @@ int app_main(void)
                  * turning on the receiver for the RESP message and
                  * reconfiguring the device before receiving the STS Mode 3 packet.
                  */
-                set_delayed_rx_time(POLL_TX_TO_RESP_RX_DLY_UUS + POLL_TX_TO_REPORT_RX_DLY_UUS, &config_option_sp0);
+                dwt_setdelayedtrxtime((uint32_t)((phy_timing_rx_dly_uus(POLL_TX_TO_RESP_RX_DLY_UUS + POLL_TX_TO_REPORT_RX_DLY_UUS) * UUS_TO_DWT_TIME) >> 8));
 
                 dwt_rxenable(DWT_START_RX_DLY_TS);
 
@@ -326,6 +334,9 @@ int app_main(void)
 
                     uint32_t frame_len;
 
+                    /* Count the good frame, see rx_errors.h. */
+                    rx_err_status(status_reg);
+
                     /* Clear the RX events. */
                     dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_GOOD);
 
@@ -344,7 +355,7 @@ int app_main(void)
 
                             /* Read carrier integrator value and calculate clock offset ratio.
                              * See NOTE 9 below. */
-                            clockOffsetRatio = ((float)dwt_readclockoffset()) / (uint32_t)(1<<26);
+                            clockOffsetRatio = ranging_clock_offset_q32(dwt_readclockoffset());
 
                             /* Get timestamps embedded in response frame. */
                             resp_msg_get_ts(&rx_buffer[REPORT_MSG_POLL_RX_TS_IDX], &poll_rx_ts);
@@ -355,38 +366,38 @@ int app_main(void)
                             rtd_init = resp_rx_ts - poll_tx_ts;
                             rtd_resp = resp_tx_ts - poll_rx_ts;
 
-                            tof = ((rtd_init - rtd_resp * (1 - clockOffsetRatio)) / 2.0) * DWT_TIME_UNITS;
-                            distance = tof * SPEED_OF_LIGHT;
+                            tof = ranging_ss_tof(rtd_init, rtd_resp, clockOffsetRatio);
+                            distance = ranging_tof_to_mm(tof);
 
                             /* Display computed distance. */
+                            char mm[RANGING_MM_STR_LEN];
                             static char dist[20] = {0};
-                            sprintf(dist, "dist %3.2f m", distance);
+                            sprintf(dist, "dist %s m", ranging_mm_to_str(distance, mm));
                             LOG_INF("%s", dist);
                         }
                         else {
-                            errors[BAD_FRAME_ERR_IDX] += 1;
+                            rx_err_record(RX_ERR_BAD_FRAME);
                         }
                     }
                     else {
-                        errors[RTO_ERR_IDX] += 1;
+                        rx_err_record(RX_ERR_BAD_FRAME);
                     }
                 }
                 else {
-                    check_for_status_errors(status_reg, errors);
+                    rx_err_status(status_reg);
                 }
             }
             else {
-                errors[PREAMBLE_COUNT_ERR_IDX] += 1;
+                rx_err_record(RX_ERR_STS_QUAL);
             }
         }
         else {
-            check_for_status_errors(status_reg, errors);
-
-            if (goodSts < 0) {
-                errors[PREAMBLE_COUNT_ERR_IDX] += 1;
+            if (status_reg & SYS_STATUS_RXFCG_BIT_MASK) {
+                /* Frame received, STS quality too low */
+                rx_err_record(RX_ERR_STS_QUAL);
             }
-            if (stsQual <= 0) {
-                errors[CP_QUAL_ERR_IDX] += 1;
+            else {
+                rx_err_status(status_reg);
             }
         }
 
@@ -22,6 +22,7 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -136,6 +137,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
@@ -184,7 +186,8 @@ int app_main(void)
                     poll_rx_ts = get_rx_timestamp_u64();
 
                     /* Compute response message transmission time. See NOTE 7 below. */
-                    resp_tx_time = (poll_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                    resp_tx_time = (poll_rx_ts + ((POLL_RX_TO_RESP_TX_DLY_UUS
+                            + phy_timing_extra_uus(sizeof(tx_resp_msg))) * UUS_TO_DWT_TIME)) >> 8;
                     dwt_setdelayedtrxtime(resp_tx_time);
 
                     /* Response TX timestamp is the transmission time we programmed plus the antenna delay. */
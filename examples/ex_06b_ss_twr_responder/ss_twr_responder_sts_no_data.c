@@ -65,7 +65,9 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <rx_errors.h>
 #include <config_options.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -111,9 +113,6 @@ static uint32_t status_reg = 0;
 static uint64_t poll_rx_ts;
 static uint64_t resp_tx_ts;
 
-/* Hold the amount of errors that have occurred */
-static uint32_t errors[23] = {0};
-
 extern dwt_config_t config_option_sp3;
 extern dwt_config_t config_option_sp0;
 
@@ -205,6 +204,9 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    /* PHY timing tables of the two modes: 0 SP3 (the current one), 1 SP0. */
+    phy_timing_apply(1, &config_option_sp0);
+    phy_timing_apply(0, &config_option_sp3);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     if(config_option_sp3.chan == 5) {
@@ -214,10 +216,14 @@ int app_main(void)
         dwt_configuretxrf(&txconfig_options_ch9);
     }
 
+    /* Count the RX errors by kind, see rx_errors.h. */
+    rx_err_init(NULL);
+
     /* Loop forever responding to ranging requests. */
     while (1) {
 
         dwt_configurestsmode(DWT_STS_MODE_ND);
+        phy_timing_select(0);
 
         /*
          * Set CP encryption key and IV (nonce).
@@ -268,6 +274,7 @@ int app_main(void)
             if (goodSts >= 0) {
 
                 uint32_t resp_tx_time, report_tx_time;
+                uint32_t resp_extra = phy_timing_extra_uus(0); /* SP3 RESP, no data */
                 int ret;
 
                 /* Retrieve poll reception timestamp. */
@@ -276,9 +283,7 @@ int app_main(void)
                 /* Calculate the required delay time before sending the RESP packet. */
                 resp_tx_time = (poll_rx_ts                               /* Received timestamp value */
                         + ((POLL_RX_TO_RESP_TX_DLY_UUS                   /* Set delay time */
-                                + get_rx_delay_time_data_rate()          /* Added delay time for data rate set */
-                                + get_rx_delay_time_txpreamble()         /* Added delay for TX preamble length */
-                                + ((1<<(config_option_sp3.stsLength+2))*8)) /* Added delay for STS length */
+                                + resp_extra)                            /* Added delay for the SP3 profile (preamble, STS) */
                                 * UUS_TO_DWT_TIME)) >> 8;                /* Converted to time units for chip */
                 dwt_setdelayedtrxtime(resp_tx_time);
 
@@ -308,14 +313,13 @@ int app_main(void)
                      */
                     /* Configure DW IC. See NOTE 12 below. */
                     dwt_configurestsmode(DWT_STS_MODE_OFF);
+                    phy_timing_select(1);
 
                     /* Set the delay to be twice the previous time period with 
                      * respect to the RX timestamp of the POLL packet. */
                     report_tx_time = (poll_rx_ts                             /* Received timestamp value */
                             + ((((POLL_RX_TO_RESP_TX_DLY_UUS) * 2)           /* Set delay time */
-                                    + (get_rx_delay_time_data_rate() * 2)    /* Added delay time for data rate set */
-                                    + (get_rx_delay_time_txpreamble() * 2)   /* Added delay for TX preamble length */
-                                    + (((1<<(config_option_sp3.stsLength+2))*8)) * 2) /* Added delay for STS length */
+                                    + (resp_extra * 2))                      /* Added delay for the SP3 profile */
                                     * UUS_TO_DWT_TIME)) >> 8;                /* Converted to time units for chip */
                     dwt_setdelayedtrxtime(report_tx_time);
 
@@ -348,24 +352,18 @@ int app_main(void)
                 }
                 else {
                     // Delayed TX has failed - too "late"
+                    rx_err_record(RX_ERR_LATE_TX);
                 }
             }
             else {
-                errors[PREAMBLE_COUNT_ERR_IDX] += 1;
+                rx_err_record(RX_ERR_STS_QUAL);
                 
                 /* Clear RX error events in the DW IC status register. */
                 dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_ERR);
             }
         }
         else {
-            check_for_status_errors(status_reg, errors);
-
-            if (goodSts < 0) {
-                errors[PREAMBLE_COUNT_ERR_IDX] += 1;
-            }
-            if (stsQual <= 0) {
-                errors[CP_QUAL_ERR_IDX] += 1;
-            }
+            rx_err_status(status_reg);
 
             /* Clear RX error events in the DW IC status register. */
             dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_ERR);
@@ -34,7 +34,9 @@
 #include <port.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
+#include <ranging_math.h>
 #include <mac_802_15_4.h>
+#include <phy_timing.h>
 #include <deca_vals.h>
 
 //zephyr includes
@@ -78,6 +80,9 @@ mac_frame_802_15_4_format_t     mac_frame = {
 
 };
 
+/* Header template of the poll messages, see NOTE 17 below */
+static mac_frame_template_802_15_4_t poll_tpl;
+
 static dwt_aes_config_t aes_config = {
     .key_load           = AES_KEY_Load,         // load the key into AES engine see Note 15 below
     .key_size           = AES_KEY_128bit,       // use 128bit key
@@ -158,14 +163,33 @@ static uint8_t rx_buffer[RX_BUF_LEN];
 #define RESP_RX_TIMEOUT_UUS 250
 
 /* Hold copies of computed time of flight and distance here for reference so that it can be examined at a debug breakpoint. */
-static double tof;
-static double distance;
+static int32_t tof;         /* 1/16 dtu, see ranging_math.h */
+static int32_t distance;    /* mm */
+
+/* AES_STS status of the poll encryption, set by aes_tx_done(). See NOTE 16 below. */
+static int8_t aes_tx_status;
 
 /* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and power of the spectrum at the current
  * temperature. These values can be calibrated prior to taking reference measurements. See NOTE 2 below. */
 extern dwt_txconfig_t txconfig_options;
 
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aes_tx_done()
+ *
+ * @brief Completion callback of the poll encryption, called from dwt_isr().
+ *
+ * @param  status - AES_STS status bits
+ * @param  job - the job
+ *
+ * @return none
+ */
+static void aes_tx_done(int8_t status, dwt_aes_job_t *job)
+{
+    (void)job;
+    aes_tx_status = status;
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn ss_aes_twr_initiator()
  *
@@ -180,7 +204,6 @@ int app_main(void)
     static uint32_t frame_cnt=0;  /* See Note 13 */
     static uint8_t  seq_cnt=0x0A; /* Frame sequence number, incremented after each transmission. */
     uint32_t        status_reg;
-    uint8_t         nonce[13];    /* 13-byte nonce used in this example as per IEEE802.15.4 */
     dwt_aes_job_t   aes_job_tx,aes_job_rx;
     int8_t          status;
 
@@ -212,6 +235,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
@@ -222,69 +246,76 @@ int app_main(void)
 
     /* Set expected response's delay and timeout. See NOTE 1 and 5 below.
      * This example is paired with the SS-TWR responder and if delays/timings need to be changed
-     * they must be changed in both to match. */
+     * they must be changed in both to match.
+     * The receiver delay is counted from the end of the poll, not from its
+     * RMARKER as phy_timing_rx_dly_uus() expects, so it stays as tuned; the
+     * timeout is lengthened for the profile (phy_timing.h), see below once
+     * the response length is known. */
     dwt_setrxaftertxdelay(POLL_TX_TO_RESP_RX_DLY_UUS);
-    dwt_setrxtimeout(RESP_RX_TIMEOUT_UUS);
 
     /* Next can enable TX/RX states output on GPIOs 5 and 6 to help debug */
     dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
 
+    /* Build the poll header once: frame control, addresses, security control (MIC 16) and key index. See NOTE 17 below. */
+    mac_frame_template_init(&poll_tpl, DEST_PAN_ID, DEST_ADDR, SRC_ADDR, AUX_SEC_LEVEL_DATA_CONF_ON_MIC_16, INITIATOR_KEY_INDEX);
+
     /* Configure the TX and RX AES jobs, the TX job is used to encrypt the Poll message,
      * the RX job is used to decrypt the Response message */
     aes_job_tx.mode        = AES_Encrypt;     /* this is encryption job */
     aes_job_tx.src_port    = AES_Src_Tx_buf;  /* dwt_do_aes will take plain text to the TX buffer */
     aes_job_tx.dst_port    = AES_Dst_Tx_buf;  /* dwt_do_aes will replace the original plain text TX buffer with encrypted one */
-    aes_job_tx.nonce       = nonce;          /* pointer to the nonce structure*/
-    aes_job_tx.header      = (uint8_t *)MHR_802_15_4_PTR(&mac_frame);/* plain-text header which will not be encrypted */
-    aes_job_tx.header_len  = MAC_FRAME_HEADER_SIZE(&mac_frame);
+    mac_frame_template_aes_job(&poll_tpl, &aes_job_tx); /* plain-text header which will not be encrypted, nonce and MIC size */
     aes_job_tx.payload     = tx_poll_msg;    /* payload to be encrypted */
     aes_job_tx.payload_len = sizeof(tx_poll_msg); /* size of payload to be encrypted */
 
     aes_job_rx.mode        = AES_Decrypt;      /* this is decryption job */
     aes_job_rx.src_port    = AES_Src_Rx_buf_0; /* The source of the data to be decrypted is the IC RX buffer */
     aes_job_rx.dst_port    = AES_Dst_Rx_buf_0; /* Decrypt the encrypted data to the IC RX buffer : this will destroy original RX frame */
-    aes_job_rx.header_len  = aes_job_tx.header_len;
-    aes_job_rx.header      = aes_job_tx.header;/* plain-text header which will not be encrypted */
+    aes_job_rx.header_len  = MAC_FRAME_HEADER_SIZE(&mac_frame);
+    aes_job_rx.header      = (uint8_t *)MHR_802_15_4_PTR(&mac_frame);/* plain-text header which will not be encrypted */
     aes_job_rx.payload     = rx_buffer;        /* pointer to where the decrypted data will be copied to when read from the IC*/
 
+    /* The response has the header and the MIC of the poll around its own payload */
+    dwt_setrxtimeout(phy_timing_rx_timeout_uus(RESP_RX_TIMEOUT_UUS,
+            aes_job_tx.header_len + sizeof(rx_resp_msg) + aes_job_tx.mic_size + FCS_LEN));
+
     /* Loop forever initiating ranging exchanges. */
     while (1) {
 
         /* Program the correct key to be used */
         dwt_set_keyreg_128(&keys_options[INITIATOR_KEY_INDEX-1]);
 
-        /* Set the key index for the frame */
-        MAC_FRAME_AUX_KEY_IDENTIFY_802_15_4(&mac_frame)=INITIATOR_KEY_INDEX;
-
-        /* Update MHR to the correct SRC and DEST addresses and construct the 13-byte nonce
-         * (same MAC frame structure is used to store both received data and transmitted data - thus SRC and DEST addresses
-         * need to be updated before each transmission */
-        mac_frame_set_pan_ids_and_addresses_802_15_4(&mac_frame,DEST_PAN_ID,DEST_ADDR,SRC_ADDR);
-        mac_frame_get_nonce(&mac_frame,nonce);
+        /* Patch the sequence number and the frame counter into the poll header and the 13-byte nonce */
+        mac_frame_template_update(&poll_tpl, seq_cnt, frame_cnt);
 
-        aes_job_tx.mic_size = mac_frame_get_aux_mic_size(&mac_frame);
         aes_config.mode = AES_Encrypt;
         aes_config.mic  = dwt_mic_size_from_bytes(aes_job_tx.mic_size);
         dwt_configure_aes(&aes_config);
 
         /* The AES job will take the TX frame data and and copy it to 
-         * DW IC TX buffer before transmission. See NOTE 7 below. */
-        status = dwt_do_aes(&aes_job_tx,aes_config.aes_core_type);
+         * DW IC TX buffer before transmission. See NOTE 7 below.
+         * The encryption runs while the frame control is written. See NOTE 16 below. */
+        status = dwt_do_aes_async(&aes_job_tx, aes_config.aes_core_type, aes_tx_done);
 
         /* Check for errors */
         if (status < 0) {
             LOG_ERR("AES length error");
             while (1) { /* spin */ };
         }
-        else if (status & AES_ERRORS) {
-            LOG_ERR("ERROR AES");
-            while (1) { /* spin */ };
-        }
 
         /* configure the frame control and start transmission */
         /* Zero offset in TX buffer, ranging. */
         dwt_writetxfctrl(aes_job_tx.header_len + aes_job_tx.payload_len + aes_job_tx.mic_size + FCS_LEN, 0, 1); 
 
+        /* Polled mode: dwt_isr() completes the job when AES_DONE is set */
+        while (dwt_aes_busy()) {
+            dwt_isr();
+        }
+        if (aes_tx_status & AES_ERRORS) {
+            LOG_ERR("ERROR AES");
+            while (1) { /* spin */ };
+        }
+
         /* Start transmission, indicating that a response is expected so that reception 
          * is enabled automatically after the frame is sent and the delay
          * set by dwt_setrxaftertxdelay() has elapsed. */
@@ -298,8 +329,8 @@ int app_main(void)
         /* Increment frame sequence number (modulo 256) and frame counter, 
          * after transmission of the poll message . */
 
-        MAC_FRAME_SEQ_NUM_802_15_4(&mac_frame) = ++seq_cnt;
-        mac_frame_update_aux_frame_cnt(&mac_frame, ++frame_cnt);
+        ++seq_cnt;
+        ++frame_cnt;
 
         if (status_reg & SYS_STATUS_RXFCG_BIT_MASK) {  /* Got response */
 
@@ -346,14 +377,14 @@ int app_main(void)
 
                 uint32_t poll_tx_ts, resp_rx_ts, poll_rx_ts, resp_tx_ts;
                 int32_t rtd_init, rtd_resp;
-                float clockOffsetRatio ;
+                int32_t clockOffsetRatio;
 
                 /* Retrieve poll transmission and response reception timestamps. See NOTE 9 below. */
                 poll_tx_ts = dwt_readtxtimestamplo32();
                 resp_rx_ts = dwt_readrxtimestamplo32();
 
                 /* Read carrier integrator value and calculate clock offset ratio. See NOTE 11 below. */
-                clockOffsetRatio = ((float)dwt_readclockoffset()) / (uint32_t)(1<<26);
+                clockOffsetRatio = ranging_clock_offset_q32(dwt_readclockoffset());
 
                 /* Get timestamps embedded in response message. */
                 resp_msg_get_ts(&rx_buffer[RESP_MSG_POLL_RX_TS_IDX], &poll_rx_ts);
@@ -364,8 +395,8 @@ int app_main(void)
                 rtd_init = resp_rx_ts - poll_tx_ts;
                 rtd_resp = resp_tx_ts - poll_rx_ts;
 
-                tof = ((rtd_init - rtd_resp * (1 - clockOffsetRatio)) / (float)2.0) * (float)DWT_TIME_UNITS;
-                distance = tof * SPEED_OF_LIGHT;
+                tof = ranging_ss_tof(rtd_init, rtd_resp, clockOffsetRatio);
+                distance = ranging_tof_to_mm(tof);
             }
 
         }
@@ -450,4 +481,11 @@ int app_main(void)
  * 14. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *     configuration.
  * 15. When CCM core type is used, AES_KEY_Load needs to be set prior to each encryption/decryption operation, even if the AES KEY used has not changed.
+ * 16. dwt_do_aes_async() writes the frame to the TX buffer and starts the AES block, then returns without waiting for it: the host can write to
+ *     other registers or buffers (here the frame control) while the frame is encrypted in place. The job completes in dwt_isr() on the AES_DONE
+ *     event, which dwt_do_aes_async() enables for the duration of the job. This example is polled, so dwt_isr() is called until dwt_aes_busy()
+ *     clears; with the DW IC interrupt connected to dwt_isr() (see port_set_dwic_isr()) the callback would start the transmission instead.
+ * 17. The poll header only differs from one poll to the next in its sequence number and frame counter. It is built once by
+ *     mac_frame_template_init(), with the 13-byte nonce (source address, frame counter, security level), and mac_frame_template_update() patches
+ *     those two fields in the header and in the nonce before each poll. The received response is read into the separate mac_frame.
  ****************************************************************************************************************************************************/
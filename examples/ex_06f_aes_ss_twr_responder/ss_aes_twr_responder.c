@@ -34,6 +34,7 @@
 #include <shared_defines.h>
 #include <shared_functions.h>
 #include <mac_802_15_4.h>
+#include <phy_timing.h>
 
 //zephyr includes
 #include <zephyr/kernel.h>
@@ -50,6 +51,9 @@ LOG_MODULE_REGISTER(ss_twr_resp);
  * by mac_frame_802_15_4_format_t structure */
 mac_frame_802_15_4_format_t     mac_frame;
 
+/* Header template of the response messages, see NOTE 15 below */
+static mac_frame_template_802_15_4_t resp_tpl;
+
 static dwt_aes_config_t aes_config = {
     .key_load           = AES_KEY_Load,         // load the key into the AES engine see Note 14 below
     .key_size           = AES_KEY_128bit,       // use 128bit key
@@ -174,6 +178,7 @@ int app_main(void)
         LOG_ERR("CONFIG FAILED");
         while (1) { /* spin */ };
     }
+    phy_timing_apply(0, &config);
 
     /* Configure the TX spectrum parameters (power, PG delay and PG count) */
     dwt_configuretxrf(&txconfig_options);
@@ -187,6 +192,9 @@ int app_main(void)
     dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
 
 
+    /* Build the response header once: frame control, addresses, security control (MIC 16) and key index. See NOTE 15 below. */
+    mac_frame_template_init(&resp_tpl, DEST_PAN_ID, DEST_ADDR, SRC_ADDR, AUX_SEC_LEVEL_DATA_CONF_ON_MIC_16, RESPONDER_KEY_INDEX);
+
     /*Configure the TX and RX AES jobs, the TX job is used to encrypt the Response message,
      * the RX job is used to decrypt the Poll message */
     aes_job_rx.mode        = AES_Decrypt;           /* Mode is set to decryption */
@@ -199,8 +207,7 @@ int app_main(void)
     aes_job_tx.mode        = AES_Encrypt;     /* this is encyption job */
     aes_job_tx.src_port    = AES_Src_Tx_buf;  /* dwt_do_aes will take plain text to the TX buffer */
     aes_job_tx.dst_port    = AES_Dst_Tx_buf;  /* dwt_do_aes will replace the original plain text TX buffer with encrypted one */
-    aes_job_tx.header_len  = aes_job_rx.header_len;
-    aes_job_tx.header      = aes_job_rx.header;/* plain-text header which will not be encrypted */
+    mac_frame_template_aes_job(&resp_tpl, &aes_job_tx); /* plain-text header which will not be encrypted, nonce and MIC size */
     aes_job_tx.payload     = tx_resp_msg;      /* payload to be sent */
     aes_job_tx.payload_len = sizeof(tx_resp_msg); /* payload length */
 
@@ -261,13 +268,14 @@ int app_main(void)
 
                 uint32_t          resp_tx_time;
                 int             ret;
-                uint8_t         nonce[13];
 
                 /* Retrieve poll reception timestamp. */
                 poll_rx_ts = get_rx_timestamp_u64();
 
                 /* Compute response message transmission time. See NOTE 7 below. */
-                resp_tx_time = (poll_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                resp_tx_time = (poll_rx_ts + ((POLL_RX_TO_RESP_TX_DLY_UUS
+                        + phy_timing_extra_uus(aes_job_tx.header_len + aes_job_tx.payload_len
+                                               + aes_job_tx.mic_size + FCS_LEN)) * UUS_TO_DWT_TIME)) >> 8;
                 dwt_setdelayedtrxtime(resp_tx_time);
 
                 /* Response TX timestamp is the transmission time we programmed plus the antenna delay. */
@@ -281,28 +289,15 @@ int app_main(void)
 
                 /* Program the correct key to be used */
                 dwt_set_keyreg_128(&keys_options[RESPONDER_KEY_INDEX-1]);
-                /* Set the key index for the frame */
-                MAC_FRAME_AUX_KEY_IDENTIFY_802_15_4(&mac_frame)=RESPONDER_KEY_INDEX;
-
-                /* Increment the sequence number */
-                MAC_FRAME_SEQ_NUM_802_15_4(&mac_frame)++;
-
-                /* Update the frame count */
-                mac_frame_update_aux_frame_cnt(&mac_frame,mac_frame_get_aux_frame_cnt(&mac_frame)+1);
+                /* Patch the poll sequence number and frame count, incremented, into the response header and nonce */
+                mac_frame_template_update(&resp_tpl, MAC_FRAME_SEQ_NUM_802_15_4(&mac_frame) + 1,
+                                          mac_frame_get_aux_frame_cnt(&mac_frame) + 1);
 
                 /* Configure the AES job */
-                aes_job_tx.mic_size = mac_frame_get_aux_mic_size(&mac_frame);
-                aes_job_tx.nonce    = nonce; /* set below once MHR is set*/
                 aes_config.mode = AES_Encrypt;
                 aes_config.mic  = dwt_mic_size_from_bytes(aes_job_tx.mic_size);
                 dwt_configure_aes(&aes_config);
 
-                /* Update the MHR (reusing the received MHR, thus need to swap SRC/DEST addresses */
-                mac_frame_set_pan_ids_and_addresses_802_15_4(&mac_frame, DEST_PAN_ID, DEST_ADDR, SRC_ADDR);
-
-                /* construct the nonce from the MHR */
-                mac_frame_get_nonce(&mac_frame,nonce);
-
                 /* perform the encryption, the TX buffer will contain a 
                  * full MAC frame with encrypted payload */
                 status = dwt_do_aes(&aes_job_tx, aes_config.aes_core_type);
@@ -415,4 +410,7 @@ int app_main(void)
  * 13. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *     configuration.
  * 14. When CCM core type is used, AES_KEY_Load needs to be set prior to each encryption/decryption operation, even if the AES KEY used has not changed.
+ * 15. The response header only differs from one response to the next in its sequence number and frame counter (those of the poll plus one). It
+ *     is built once by mac_frame_template_init(), with the 13-byte nonce, and mac_frame_template_update() patches the two fields in the header and
+ *     in the nonce, rather than rebuilding the addresses, key index and nonce from the received header between the poll and the delayed response.
  ****************************************************************************************************************************************************/
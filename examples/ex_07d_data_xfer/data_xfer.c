@@ -0,0 +1,282 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    data_xfer.c
+ *  @brief   Reliable data transfer with the event driven transfer engine
+ *
+ *           Sender (default) or receiver (DATA_XFER_RECEIVER) side of a
+ *           transfer run by MAC_802_15_4/mac_xfer.c from the DW IC interrupt
+ *           callbacks. The sender pushes a 4 KB block every TRANSFER_PERIOD_MS
+ *           and logs the goodput, the receiver rebuilds each block in a
+ *           reassembly slot (mac_frag.h) and checks it.
+ *           With DATA_XFER_LONG_FRAMES, frames of up to 512 bytes (extended PHR)
+ *           carry 16 KB blocks, the receiver uses the double buffered RX.
+ *           See mac_xfer.h for the engine and ex_07a/ex_07b for the auto-ACK.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include <mac_xfer.h>
+#include <mac_frag.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#define LOG_LEVEL 3
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(data_xfer);
+
+/* Example application name and version to display on console. */
+#define APP_NAME "DATA XFER v1.0"
+
+/* Default communication configuration. We use default non-STS DW mode. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard 8 symbol SFD,
+                      *   1 to use non-standard 8 symbol,
+                      *   2 for non-standard 16 symbol SFD and
+                      *   3 for 4z 8 symbol SDF type */
+    DWT_BR_6M8,      /* Data rate. */
+#ifdef DATA_XFER_LONG_FRAMES
+    DWT_PHRMODE_EXT, /* PHY header mode: frames longer than 127 bytes. */
+#else
+    DWT_PHRMODE_STD, /* PHY header mode. */
+#endif
+    DWT_PHRRATE_STD, /* PHY header rate. */
+    (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+    DWT_STS_MODE_OFF, /* STS disabled */
+    DWT_STS_LEN_64,/* STS length see allowed values in Enum dwt_sts_lengths_e */
+    DWT_PDOA_M0      /* PDOA mode off */
+};
+
+/* Transfer size and period */
+#ifdef DATA_XFER_LONG_FRAMES
+#define TRANSFER_LEN        16384
+#else
+#define TRANSFER_LEN        4096
+#endif
+#define TRANSFER_PERIOD_MS  2000
+
+/* Test pattern: byte i of transfer id */
+#define PATTERN(id, i)      ((uint8_t)((i) * 7 + ((i) >> 8) + (id)))
+
+#ifndef DATA_XFER_RECEIVER
+static uint8_t tx_data[TRANSFER_LEN];
+
+/* Last result, handed from the DW IC interrupt context to the application thread */
+static mac_xfer_result_t last_result;
+static K_SEM_DEFINE(result_sem, 0, 1);
+#else
+/* Reassembly pool: one block in progress, dropped after 1 s without new frame */
+#define REASSEMBLY_TIMEOUT_MS   1000
+static mac_frag_pool_t frag_pool;
+static mac_frag_slot_t frag_slot;
+static uint8_t frag_buf[TRANSFER_LEN];
+
+/* Blocks received with a wrong pattern */
+static uint32_t bad_blocks;
+static K_SEM_DEFINE(complete_sem, 0, 1);
+#endif
+
+/* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and power
+ * of the spectrum at the current temperature.
+ * These values can be calibrated prior to taking reference measurements. */
+extern dwt_txconfig_t txconfig_options;
+
+#ifndef DATA_XFER_RECEIVER
+/*! ---------------------------------------------------------------------------
+ * @fn xfer_done_cb()
+ *
+ * @brief Result callback, called by the engine from the DW IC interrupt context.
+ *
+ * @param  result - transfer result
+ *
+ * @return none
+ */
+static void xfer_done_cb(const mac_xfer_result_t *result)
+{
+    last_result = *result;
+    k_sem_give(&result_sem);
+}
+#else
+/*! ---------------------------------------------------------------------------
+ * @fn block_cb()
+ *
+ * @brief Reassembly callback: a whole block is in.
+ *
+ * @param  src - sender address
+ * @param  tag - transfer ID
+ * @param  data - block
+ * @param  len - block length
+ *
+ * @return none
+ */
+static void block_cb(uint16_t src, uint8_t tag, const uint8_t *data, uint16_t len)
+{
+    uint16_t i;
+
+    for (i = 0; i < len; i++) {
+        if (data[i] != PATTERN(tag, i)) {
+            bad_blocks++;
+            break;
+        }
+    }
+    k_sem_give(&complete_sem);
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn xfer_rx_cb()
+ *
+ * @brief Frame callback, called by the engine from the DW IC interrupt context
+ *        for each new frame (copies are dropped by the engine).
+ *
+ * @param  rx - frame
+ *
+ * @return none
+ */
+static void xfer_rx_cb(const mac_xfer_rx_t *rx)
+{
+    mac_frag_xfer_rx(&frag_pool, rx, k_uptime_get_32());
+}
+#endif
+
+/*! ---------------------------------------------------------------------------
+ * @fn data_xfer()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int app_main(void)
+{
+    mac_xfer_config_t xfer_cfg;
+
+    /* Display application name. */
+    LOG_INF(APP_NAME);
+
+    /* Configure SPI rate, DW3000 supports up to 38 MHz */
+    port_set_dw_ic_spi_fastrate();
+
+    /* Reset DW IC */
+    /* Target specific drive of RSTn line into DW IC low for a period. */
+    reset_DWIC();
+
+    /* Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC */
+    Sleep(2);
+
+    /* Need to make sure DW IC is in IDLE_RC before proceeding */
+    while (!dwt_checkidlerc()) { /* spin */ };
+
+    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR) {
+        LOG_ERR("INIT FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration
+     * has failed the host should reset the device */
+    if (dwt_configure(&config)) {
+        LOG_ERR("CONFIG FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* Configure the TX spectrum parameters (power, PG delay and PG count) */
+    dwt_configuretxrf(&txconfig_options);
+
+    dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
+
+    dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
+
+#ifdef DATA_XFER_RECEIVER
+    mac_xfer_default_config(&xfer_cfg, MAC_XFER_DEFAULT_RX_ADDR);
+#else
+    mac_xfer_default_config(&xfer_cfg, MAC_XFER_DEFAULT_TX_ADDR);
+#endif
+#ifdef DATA_XFER_AUTO_ACK
+    xfer_cfg.ack = MAC_XFER_ACK_AUTO;
+#endif
+#ifdef DATA_XFER_LONG_FRAMES
+    /* Two frames in the TX buffer, a window takes about 5 ms on the air */
+    xfer_cfg.payload_len = MAC_XFER_PAYLOAD_HALF;
+    xfer_cfg.rto_uus = 10000;
+    xfer_cfg.rx_dbl_buff = 1;
+#endif
+
+    /* Register the engine call-backs and enable the TX/RX interrupts. */
+#ifdef DATA_XFER_RECEIVER
+    mac_frag_pool_init(&frag_pool, &frag_slot, 1, frag_buf, sizeof(frag_buf), REASSEMBLY_TIMEOUT_MS, block_cb);
+    mac_xfer_init(&xfer_cfg, NULL, xfer_rx_cb);
+#else
+    mac_xfer_init(&xfer_cfg, xfer_done_cb, NULL);
+#endif
+
+    /* Clearing the SPI ready interrupt */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+
+    /* Install DW IC IRQ handler. */
+    port_set_dwic_isr(dwt_isr);
+
+#ifdef DATA_XFER_RECEIVER
+    LOG_INF("Receiver ready");
+    mac_xfer_listen();
+
+    while (1) {
+        const mac_xfer_stats_t *stats;
+        const mac_frag_stats_t *frag_stats;
+
+        /* The engine receives and acknowledges the frames from the interrupt callbacks. */
+        k_sem_take(&complete_sem, K_FOREVER);
+
+        stats = mac_xfer_get_stats();
+        frag_stats = mac_frag_get_stats(&frag_pool);
+        LOG_INF("block complete: %u frames, %u copies, %u block ACKs, %u blocks (%u bad, %u timed out)",
+                stats->frames_rx, stats->dup_rx, stats->back_tx, frag_stats->datagrams, bad_blocks,
+                frag_stats->timeouts);
+    }
+#else
+    LOG_INF("Sender ready (%s)", (xfer_cfg.ack == MAC_XFER_ACK_AUTO) ? "auto-ACK" : "block ACK");
+
+    while (1) {
+        uint32_t i;
+
+        /* Transfer IDs start at 1, the pattern changes with each transfer. */
+        for (i = 0; i < TRANSFER_LEN; i++) {
+            tx_data[i] = PATTERN(last_result.id + 1, i);
+        }
+
+        if (mac_xfer_send(MAC_XFER_DEFAULT_RX_ADDR, tx_data, TRANSFER_LEN) != DWT_SUCCESS) {
+            LOG_ERR("send failed");
+        }
+        else {
+            /* The engine runs the transfer from the interrupt callbacks. */
+            k_sem_take(&result_sem, K_FOREVER);
+
+            if (last_result.status != MAC_XFER_OK) {
+                LOG_INF("transfer %u: error %d, %u/%u frames acknowledged", last_result.id,
+                        last_result.status, last_result.acked, last_result.frames);
+            }
+            else {
+                LOG_INF("transfer %u: %u bytes in %u us, %u kbps, %u frames sent for %u", last_result.id,
+                        last_result.bytes, last_result.elapsed_us, last_result.kbps, last_result.tx,
+                        last_result.frames);
+            }
+        }
+
+        /* Execute a delay between transfers. */
+        Sleep(TRANSFER_PERIOD_MS);
+    }
+#endif
+}
@@ -0,0 +1,232 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    tdoa_gateway.c
+ *  @brief   TDoA anchor with a batched host uplink
+ *
+ *           The anchor receives the tag blinks (ex_01a_simple_tx) and the
+ *           sync beacons of the reference anchor (ranging/tdoa.h), and sends
+ *           the time difference records to the host in batches over UART0 or
+ *           USB CDC ACM (platform/dw_uplink.h), decoded on the host by
+ *           tools/uplink_decode.py. With TDOA_REFERENCE the anchor is also the
+ *           reference and sends a beacon every BEACON_PERIOD_MS, on a fixed
+ *           grid of its clock.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include <tdoa.h>
+#include <dw_uplink.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/sys/printk.h>
+
+#define LOG_LEVEL 3
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(tdoa_gateway);
+
+/* Example application name and version to display on console. */
+#define APP_NAME "TDOA GATEWAY v1.0"
+
+/* Default communication configuration. We use default non-STS DW mode. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard 8 symbol SFD,
+                      *   1 to use non-standard 8 symbol,
+                      *   2 for non-standard 16 symbol SFD and
+                      *   3 for 4z 8 symbol SDF type */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    DWT_PHRRATE_STD, /* PHY header rate. */
+    (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+    DWT_STS_MODE_OFF, /* STS disabled */
+    DWT_STS_LEN_64,  /* STS length see allowed values in Enum dwt_sts_lengths_e */
+    DWT_PDOA_M0      /* PDOA mode off */
+};
+
+/* Addresses: each anchor has its own, the reference anchor is REF_ANCHOR_ADDR. */
+#define PAN_ID              0xDECA
+#define REF_ANCHOR_ADDR     0x0A00
+#ifdef TDOA_REFERENCE
+#define ANCHOR_ADDR         REF_ANCHOR_ADDR
+#else
+#define ANCHOR_ADDR         0x0A01
+#endif
+
+/* Default antenna delay values for 64 MHz PRF. */
+#define TX_ANT_DLY          16385
+#define RX_ANT_DLY          16385
+
+/* Reference anchor beacon period, and statistics period */
+#define BEACON_PERIOD_MS    200
+#define STATS_PERIOD_MS     10000
+
+/* A record waits at most UPLINK_LATENCY_MS in a batch. See NOTE 1 below. */
+#define UPLINK_LATENCY_MS   20
+#define UPLINK_TX_TIMEOUT_US 50000
+
+/* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and power
+ * of the spectrum at the current temperature.
+ * These values can be calibrated prior to taking reference measurements. */
+extern dwt_txconfig_t txconfig_options;
+
+/*! ---------------------------------------------------------------------------
+ * @fn tdoa_record_cb()
+ *
+ * @brief Record callback, called from the DW IC interrupt context: the record is
+ *        appended to the uplink batch.
+ *
+ * @param  record - time difference record
+ *
+ * @return none
+ */
+static void tdoa_record_cb(const tdoa_record_t *record)
+{
+    uint8_t buf[TDOA_RECORD_LEN];
+
+    tdoa_record_pack(record, buf);
+    dw_uplink_put(DW_UPLINK_TDOA, buf, TDOA_RECORD_LEN);
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn tdoa_gateway()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int app_main(void)
+{
+    const struct device *uplink_dev = DEVICE_DT_GET(DT_CHOSEN(dw_uplink));
+    const dw_uplink_stats_t *up_stats;
+    const tdoa_sync_t *sync;
+    dw_uplink_config_t up_cfg;
+    tdoa_config_t tdoa_cfg;
+    uint32_t stats_ms;
+
+    /* Display application name. */
+    LOG_INF(APP_NAME);
+
+    /* Configure SPI rate, DW3000 supports up to 38 MHz */
+    port_set_dw_ic_spi_fastrate();
+
+    /* Reset DW IC */
+    /* Target specific drive of RSTn line into DW IC low for a period. */
+    reset_DWIC();
+
+    /* Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC */
+    Sleep(2);
+
+    /* Need to make sure DW IC is in IDLE_RC before proceeding */
+    while (!dwt_checkidlerc()) { /* spin */ };
+
+    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR) {
+        LOG_ERR("INIT FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration
+     * has failed the host should reset the device */
+    if (dwt_configure(&config)) {
+        LOG_ERR("CONFIG FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* Configure the TX spectrum parameters (power, PG delay and PG count) */
+    dwt_configuretxrf(&txconfig_options);
+
+    /* Apply default antenna delay value. */
+    dwt_setrxantennadelay(RX_ANT_DLY);
+    dwt_settxantennadelay(TX_ANT_DLY);
+
+    dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
+
+    dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
+
+    /* Host uplink, see NOTE 1 and 2 below. */
+    up_cfg.src = ANCHOR_ADDR;
+    up_cfg.latency_ms = UPLINK_LATENCY_MS;
+    up_cfg.tx_timeout_us = UPLINK_TX_TIMEOUT_US;
+    if (dw_uplink_init(uplink_dev, &up_cfg) != DWT_SUCCESS) {
+        LOG_ERR("UPLINK FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* Register the TDoA call-backs and enable the TX/RX interrupts. */
+    tdoa_cfg.pan_id = PAN_ID;
+    tdoa_cfg.addr = ANCHOR_ADDR;
+    tdoa_cfg.ref_addr = REF_ANCHOR_ADDR;
+    tdoa_cfg.chan = config.chan;
+    tdoa_cfg.tx_ant_dly = TX_ANT_DLY;
+    tdoa_cfg.ref_tof_dtu = 0;           /* from the anchor survey, see NOTE 3 below */
+    tdoa_cfg.beacon_period_uus = BEACON_PERIOD_MS * 1000;
+    tdoa_cfg.holdover_uus = 0;          /* default, 25 beacon periods */
+    tdoa_init(&tdoa_cfg, tdoa_record_cb);
+
+    /* Clearing the SPI ready interrupt */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+
+    /* Install DW IC IRQ handler. */
+    port_set_dwic_isr(dwt_isr);
+
+    LOG_INF("Anchor 0x%04X ready%s", ANCHOR_ADDR, (ANCHOR_ADDR == REF_ANCHOR_ADDR) ? " (reference)" : "");
+    tdoa_start();
+
+    up_stats = dw_uplink_get_stats();
+    sync = tdoa_get_sync();
+    stats_ms = k_uptime_get_32();
+
+    while (1) {
+#ifdef TDOA_REFERENCE
+        /* Wake up just before the next grid slot, see NOTE 4 below. */
+        Sleep(tdoa_beacon_wait_ms());
+        if (tdoa_send_beacon() != DWT_SUCCESS) {
+            LOG_ERR("beacon TX failed");
+        }
+#else
+        Sleep(STATS_PERIOD_MS);
+#endif
+
+        /* The records go to the host from the interrupt callbacks, the log only has the counters. */
+        if (k_uptime_get_32() - stats_ms >= STATS_PERIOD_MS) {
+            stats_ms = k_uptime_get_32();
+            LOG_INF("%u beacons (%u rejected, %u relocks, %u skipped), fit rms %u ps, %u blinks (%u unsynced)",
+                    sync->beacons, sync->rejected, sync->relocks, sync->skipped, (uint32_t)(sync->rms_dtu * 15.65f),
+                    sync->blinks, sync->unsynced);
+            LOG_INF("%u batches, %u records (%u dropped), %u aborted, %u no host",
+                    up_stats->batches, up_stats->records, up_stats->dropped, up_stats->aborted, up_stats->no_host);
+        }
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The records are sent in batches (platform/dw_uplink.h): a batch goes when it is full (DW_UPLINK_BATCH_LEN, 512 bytes, about 25 TDoA
+ *    records) or UPLINK_LATENCY_MS after its first record, whichever comes first. At high blink rates, the UART carries few large frames
+ *    instead of one line per record, and the host gets each record within UPLINK_LATENCY_MS plus the frame time (about 5 ms at 1 Mbps).
+ * 2. The UART0 of the nRF52840 DK goes to the VCOM port of the interface MCU, at 1 Mbps with RTS/CTS (see the overlay). A frame held by CTS for
+ *    more than UPLINK_TX_TIMEOUT_US is aborted, the host skips it (bad CRC) and sees the gap in the batch sequence numbers. With usb.conf and
+ *    usb.overlay (see CMakeLists.txt), the uplink is the USB CDC ACM port of the nRF52840 instead, and nothing is sent until the host opens it.
+ *    Read the records on the host with "tools/uplink_decode.py --port /dev/ttyACM0".
+ * 3. The reference anchor time base is offset by the propagation time from the reference anchor, ref_tof_dtu in tdoa_config_t, to be set from
+ *    the surveyed anchor positions. It is left at 0 here.
+ * 4. The beacons are sent on a grid of the reference anchor clock (beacon_period_uus), not BEACON_PERIOD_MS after the host wakes up: the
+ *    anchors fit their clock model on evenly spaced beacons whatever the host scheduling jitter, and the reference receiver is off for
+ *    about TDOA_BEACON_LEAD_UUS plus a ms only. A slot the host misses is skipped (skipped count), the next one is used.
+ ****************************************************************************************************************************************************/
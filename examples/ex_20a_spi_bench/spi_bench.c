@@ -0,0 +1,399 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    spi_bench.c
+ *  @brief   SPI and driver micro-benchmark
+ *
+ *           Times the driver calls that dominate the host side of a ranging
+ *           exchange: 8/16/32-bit register reads and writes, RX/TX buffer
+ *           transfers up to 1023 bytes, the diagnostics and accumulator reads
+ *           and dwt_configure(), at each SPI rate with the SPI CRC off and on,
+ *           then the wake-up from sleep. Every result is one CSV line
+ *           (see NOTE 1), so runs on different boards or builds can be
+ *           compared with a diff or a spreadsheet.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include <shared_defines.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/timing/timing.h>
+
+#define LOG_LEVEL 3
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(spi_bench);
+
+/* Example application name and version. */
+#define APP_NAME "SPI BENCH v1.0"
+
+/* Default communication configuration. We use default non-STS mode. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard 8 symbol SFD, 1 to use non-standard 8 symbol, 2 for non-standard 16 symbol SFD and 3 for 4z 8 symbol SDF type */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_EXT, /* PHY header mode, extended for the 1023 byte buffer transfers. */
+    DWT_PHRRATE_STD, /* PHY header rate. */
+    (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+    DWT_STS_MODE_OFF, /* STS disabled */
+    DWT_STS_LEN_64,  /* STS length see allowed values in Enum dwt_sts_lengths_e */
+    DWT_PDOA_M0      /* PDOA mode off */
+};
+
+/* SPI rates under test, the controller rounds each down to the nearest rate it supports. See NOTE 2. */
+static const uint32_t bench_rates[] = {
+    8000000, 16000000, 20000000, 24000000, 32000000, 36000000, 38000000
+};
+
+/* Highest SPI rate with the SPI CRC enabled */
+#define BENCH_CRC_MAX_HZ    20000000
+
+/* Rate of set_spi_speed_slow(), used for the wake-up */
+#define BENCH_SLOW_HZ       2000000
+
+/* Iterations of each measurement, the slow calls use fewer */
+#define BENCH_ITERS         64
+#define BENCH_ITERS_SLOW    8
+
+/* Largest transfer: one 1023 byte frame, or 256 accumulator samples plus the dummy byte */
+#define BENCH_BUF_LEN       (1 + 6 * 256)
+
+/* Scratch register for the register accesses, see NOTE 3 */
+#define BENCH_REG           AES_IV0_ID
+
+static uint8_t bench_buf[BENCH_BUF_LEN];
+static dwt_rxdiag_t bench_diag;
+
+static volatile uint32_t bench_rd_errors;
+static uint32_t bench_errors;
+
+static const char *bench_board = CONFIG_BOARD;
+
+/* One operation: run once on len bytes */
+typedef void (*bench_fn_t)(uint16_t len);
+
+typedef struct
+{
+    const char     *name;
+    bench_fn_t      fn;
+    const uint16_t *lens;
+    uint8_t         nlens;
+    uint8_t         iters;
+} bench_op_t;
+
+static void bench_rd8(uint16_t len)
+{
+    (void)dwt_read8bitoffsetreg(BENCH_REG, 0);
+}
+
+static void bench_rd16(uint16_t len)
+{
+    (void)dwt_read16bitoffsetreg(BENCH_REG, 0);
+}
+
+static void bench_rd32(uint16_t len)
+{
+    (void)dwt_read32bitoffsetreg(BENCH_REG, 0);
+}
+
+static void bench_wr8(uint16_t len)
+{
+    dwt_write8bitoffsetreg(BENCH_REG, 0, 0x5A);
+}
+
+static void bench_wr16(uint16_t len)
+{
+    dwt_write16bitoffsetreg(BENCH_REG, 0, 0x5AA5);
+}
+
+static void bench_wr32(uint16_t len)
+{
+    dwt_write32bitoffsetreg(BENCH_REG, 0, 0x5AA5C33C);
+}
+
+static void bench_rxdata(uint16_t len)
+{
+    dwt_readrxdata(bench_buf, len, 0);
+}
+
+static void bench_txdata(uint16_t len)
+{
+    dwt_writetxdata(len, bench_buf, 0);
+}
+
+static void bench_diagnostics(uint16_t len)
+{
+    dwt_readdiagnostics(&bench_diag);
+}
+
+static void bench_accdata(uint16_t len)
+{
+    dwt_readaccdata(bench_buf, len, 0);
+}
+
+static void bench_configure(uint16_t len)
+{
+    if (dwt_configure(&config) != DWT_SUCCESS) {
+        bench_errors++;
+    }
+}
+
+static const uint16_t len_reg8[]  = { 1 };
+static const uint16_t len_reg16[] = { 2 };
+static const uint16_t len_reg32[] = { 4 };
+static const uint16_t len_frame[] = { 16, 64, 127, 256, 512, 1023 };
+static const uint16_t len_diag[]  = { sizeof(dwt_rxdiag_t) };
+static const uint16_t len_acc[]   = { 1 + 6 * 16, 1 + 6 * 64, 1 + 6 * 256 };
+static const uint16_t len_none[]  = { 0 };
+
+#define BENCH_LENS(l)   (l), ARRAY_SIZE(l)
+
+static const bench_op_t bench_ops[] = {
+    { "rd8",       bench_rd8,         BENCH_LENS(len_reg8),  BENCH_ITERS },
+    { "rd16",      bench_rd16,        BENCH_LENS(len_reg16), BENCH_ITERS },
+    { "rd32",      bench_rd32,        BENCH_LENS(len_reg32), BENCH_ITERS },
+    { "wr8",       bench_wr8,         BENCH_LENS(len_reg8),  BENCH_ITERS },
+    { "wr16",      bench_wr16,        BENCH_LENS(len_reg16), BENCH_ITERS },
+    { "wr32",      bench_wr32,        BENCH_LENS(len_reg32), BENCH_ITERS },
+    { "rxdata",    bench_rxdata,      BENCH_LENS(len_frame), BENCH_ITERS },
+    { "txdata",    bench_txdata,      BENCH_LENS(len_frame), BENCH_ITERS },
+    { "diag",      bench_diagnostics, BENCH_LENS(len_diag),  BENCH_ITERS },
+    { "acc",       bench_accdata,     BENCH_LENS(len_acc),   BENCH_ITERS },
+    { "configure", bench_configure,   BENCH_LENS(len_none),  BENCH_ITERS_SLOW },
+};
+
+/*! ---------------------------------------------------------------------------
+ * @fn spi_rd_err_cb()
+ *
+ * @brief Callback of the SPI CRC read errors, counted in the errors column
+ *
+ * @return  none
+ */
+static void spi_rd_err_cb(void)
+{
+    bench_rd_errors++;
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_crc_errors()
+ *
+ * @brief Collect and clear the SPI CRC read and write errors since the last call
+ *
+ * @param crc - 1 if the SPI CRC is enabled
+ *
+ * @return number of errors
+ */
+static uint32_t bench_crc_errors(int crc)
+{
+    uint32_t errors = bench_rd_errors;
+
+    bench_rd_errors = 0;
+
+    if (crc && (dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_SPICRCE_BIT_MASK)) {
+        dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_SPICRCE_BIT_MASK);
+        errors++;
+    }
+
+    return errors;
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_print()
+ *
+ * @brief Print one CSV result line, see NOTE 1
+ *
+ * @return  none
+ */
+static void bench_print(uint32_t rate, int crc, const char *op, uint16_t len, uint32_t iters,
+                        uint64_t min_ns, uint64_t total_ns, uint64_t max_ns, uint32_t errors)
+{
+    printk("bench,%s,%u,%d,%s,%u,%u,%u,%u,%u,%u\n", bench_board, rate, crc, op, len, iters,
+           (uint32_t)min_ns, (uint32_t)(total_ns / iters), (uint32_t)max_ns, errors);
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_run()
+ *
+ * @brief Time every length of one operation at the current SPI rate
+ *
+ * @return  none
+ */
+static void bench_run(const bench_op_t *op, uint32_t rate, int crc)
+{
+    for (int l = 0; l < op->nlens; l++) {
+        uint64_t min_ns = UINT64_MAX;
+        uint64_t max_ns = 0;
+        uint64_t total_ns = 0;
+
+        bench_errors = 0;
+        (void)bench_crc_errors(crc);
+
+        for (int i = 0; i < op->iters; i++) {
+            timing_t start, end;
+            uint64_t ns;
+
+            start = timing_counter_get();
+            op->fn(op->lens[l]);
+            end = timing_counter_get();
+
+            ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+            total_ns += ns;
+            if (ns < min_ns) {
+                min_ns = ns;
+            }
+            if (ns > max_ns) {
+                max_ns = ns;
+            }
+        }
+
+        bench_print(rate, crc, op->name, op->lens[l], op->iters,
+                    min_ns, total_ns, max_ns, bench_errors + bench_crc_errors(crc));
+    }
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_wakeup()
+ *
+ * @brief Time the wake-up from sleep (WAKEUP pin) to the restored configuration, see NOTE 4
+ *
+ * @return  none
+ */
+static void bench_wakeup(void)
+{
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+    uint64_t total_ns = 0;
+
+    port_set_dw_ic_spi_slowrate();
+
+    dwt_configuresleep(DWT_CONFIG, DWT_PRES_SLEEP | DWT_WAKE_CSN | DWT_WAKE_WUP | DWT_SLP_EN);
+
+    for (int i = 0; i < BENCH_ITERS_SLOW; i++) {
+        timing_t start, end;
+        uint64_t ns;
+
+        dwt_entersleep(DWT_DW_IDLE);
+        Sleep(10);
+
+        start = timing_counter_get();
+        dwt_wakeup_ic();
+        while (!dwt_checkidlerc()) { /* spin */ };
+        dwt_restoreconfig();
+        end = timing_counter_get();
+
+        ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+        total_ns += ns;
+        if (ns < min_ns) {
+            min_ns = ns;
+        }
+        if (ns > max_ns) {
+            max_ns = ns;
+        }
+    }
+
+    bench_print(BENCH_SLOW_HZ, 0, "wakeup", 0, BENCH_ITERS_SLOW, min_ns, total_ns, max_ns, 0);
+}
+
+/**
+ * Application entry point.
+ */
+int app_main(void)
+{
+    /* Display application name. */
+    LOG_INF(APP_NAME);
+
+    timing_init();
+    timing_start();
+
+    /* Configure SPI rate, DW3000 supports up to 38 MHz */
+    port_set_dw_ic_spi_fastrate();
+
+    /* Reset DW IC */
+    reset_DWIC(); /* Target specific drive of RSTn line into DW IC low for a period. */
+
+    Sleep(2); // Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC, or could wait for SPIRDY event)
+
+    while (!dwt_checkidlerc()) /* Need to make sure DW IC is in IDLE_RC before proceeding */
+    { /* spin */ };
+
+    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR) {
+        LOG_ERR("INIT FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration has failed the host should reset the device */
+    if (dwt_configure(&config)) {
+        LOG_ERR("CONFIG FAILED");
+        while (1) { /* spin */ };
+    }
+
+    printk("bench,board,spi_hz,crc,op,len,iters,min_ns,avg_ns,max_ns,errors\n");
+
+    for (int crc = 0; crc <= 1; crc++) {
+
+        for (int r = 0; r < ARRAY_SIZE(bench_rates); r++) {
+
+            if (crc && (bench_rates[r] > BENCH_CRC_MAX_HZ)) {
+                break;
+            }
+
+            set_spi_speed_fast_freq(bench_rates[r]);
+            port_set_dw_ic_spi_fastrate();
+
+            /* Enable the SPI CRC, then clear the error set while it was off (see ex_11a_spi_crc) */
+            if (crc) {
+                dwt_enablespicrccheck(DWT_SPI_CRC_MODE_WRRD, &spi_rd_err_cb);
+                dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_SPICRCE_BIT_MASK);
+            }
+
+            for (int o = 0; o < ARRAY_SIZE(bench_ops); o++) {
+                bench_run(&bench_ops[o], bench_rates[r], crc);
+            }
+
+            if (crc) {
+                dwt_enablespicrccheck(DWT_SPI_CRC_MODE_NO, NULL);
+            }
+
+            /* Let the log thread drain the lines of this rate */
+            Sleep(100);
+        }
+    }
+
+    /* Back to the default fast rate, then the wake-up at the slow rate */
+    set_spi_speed_fast_freq(bench_rates[0]);
+    port_set_dw_ic_spi_fastrate();
+
+    bench_wakeup();
+
+    LOG_INF("done");
+
+    while (1) {
+        Sleep(1000);
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. Each line is "bench,board,spi_hz,crc,op,len,iters,min_ns,avg_ns,max_ns,errors", preceded by the same header line. Keep only the lines
+ *    starting with "bench," of the RTT output to get a CSV file. The times are those of the complete driver call, taken with the Zephyr timing
+ *    functions (CONFIG_TIMING_FUNCTIONS, the CPU cycle counter on Cortex-M), so they include the SPI driver and chip select overhead that
+ *    dominates the short transfers. The errors column counts the SPI CRC errors (crc = 1) and the dwt_configure() failures.
+ * 2. spi_hz is the requested rate. A rate above what the board or the wiring supports shows up as SPI CRC errors in the crc = 1 lines, see
+ *    port_calibrate_dw_ic_spi_fastrate() for picking the fast rate at run time. The SPI CRC is only specified up to 20 MHz.
+ * 3. AES_IV0 is a plain read/write register that is not used in this example. The RX buffer is read without a frame received and the
+ *    diagnostics and accumulator reads return stale data: only their transfer time matters here.
+ * 4. The wake-up is timed from the WAKEUP pin assertion to the end of dwt_restoreconfig(), at the slow SPI rate as the DW IC is back in
+ *    IDLE_RC. It includes the WAKEUP pin pulse of the platform port.
+ ****************************************************************************************************************************************************/
@@ -0,0 +1,397 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    twr_bench_init.c
+ *  @brief   Ranging throughput and latency benchmark, initiator side
+ *
+ *           Runs SS-TWR and DS-TWR exchanges with the TWR engine against the
+ *           ex_20c_twr_bench_resp responder, at a decreasing exchange period
+ *           down to back to back exchanges (no RNG_DELAY_MS), and reports for
+ *           each step the sustained ranges per second, the timeout and late
+ *           TX rates and the histograms of the exchange phases. Each line is
+ *           tagged with the CONFIG_OPTION profile in use (config_options.h),
+ *           see NOTE 1 for the format.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include <config_options.h>
+#include <twr.h>
+#include <phy_timing.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#define LOG_LEVEL 3
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(twr_bench_init);
+
+/* Example application name and version to display on console. */
+#define APP_NAME "TWR BENCH INIT v1.0"
+
+/* Exchange periods of the sweep, in milliseconds, 0 for back to back exchanges */
+static const uint16_t bench_periods[] = { 20, 10, 5, 2, 1, 0 };
+
+/* Exchanges per step */
+#define BENCH_EXCHANGES         500
+
+/* Result wait, after which the exchange is aborted and counted as a stall */
+#define BENCH_RESULT_TIMEOUT_MS 50
+
+/* Highest error rate (all failures, per 1000 exchanges) of a sustained step */
+#define BENCH_MAX_ERR_PERMILLE  10
+
+/* Phase histograms: BENCH_HIST_BINS bins of BENCH_HIST_BIN_UUS, the last one collects the longer phases */
+#define BENCH_HIST_BINS         32
+#define BENCH_HIST_BIN_UUS      64
+
+/* Default antenna delay values for 64 MHz PRF. */
+#define TX_ANT_DLY 16385
+#define RX_ANT_DLY 16385
+
+/* PHY configuration of the selected CONFIG_OPTION profile, and the TX spectrum configurations */
+extern dwt_config_t config_options;
+extern dwt_txconfig_t txconfig_options;
+extern dwt_txconfig_t txconfig_options_ch9;
+
+/* Counters of one step */
+typedef struct
+{
+    uint32_t ok;
+    uint32_t timeout;
+    uint32_t late;
+    uint32_t rx_err;
+    uint32_t frame;
+    uint32_t stall;
+    uint32_t phase_min[TWR_PHASE_NUM];
+    uint32_t phase_max[TWR_PHASE_NUM];
+    uint64_t phase_total[TWR_PHASE_NUM];
+    uint32_t phase_count[TWR_PHASE_NUM];
+    uint16_t hist[TWR_PHASE_NUM][BENCH_HIST_BINS];
+} bench_step_t;
+
+static bench_step_t step;
+
+/* Last result, handed from the DW IC interrupt context to the application thread */
+static twr_result_t last_result;
+static K_SEM_DEFINE(result_sem, 0, 1);
+
+static const char * const mode_names[] = { "ss", "ds" };
+static const char * const phase_names[TWR_PHASE_NUM] = { "poll_resp", "resp_final" };
+
+/*! ---------------------------------------------------------------------------
+ * @fn twr_result_cb()
+ *
+ * @brief Result callback, called by the TWR engine from the DW IC interrupt context.
+ *
+ * @param  result - exchange result
+ *
+ * @return none
+ */
+static void twr_result_cb(const twr_result_t *result)
+{
+    last_result = *result;
+    k_sem_give(&result_sem);
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_phy_delays()
+ *
+ * @brief The default engine delays are those of 6.8 Mb/s and a 128 symbol preamble:
+ *        lengthen the reply delays and the RX timeouts by the extra airtime of the
+ *        profile (phy_timing_extra_uus()). The responder does the same, see NOTE 2.
+ *
+ * @param  cfg - engine configuration
+ *
+ * @return none
+ */
+static void bench_phy_delays(twr_config_t *cfg)
+{
+    uint32_t extra = phy_timing_extra_uus(TWR_DS_FINAL_FINAL_TX_TS_IDX + FINAL_MSG_TS_LEN + FCS_LEN);
+
+    cfg->resp_rx_to_final_tx_dly_uus += extra;
+    cfg->poll_rx_to_resp_tx_dly_uus += extra;
+    cfg->resp_rx_timeout_uus += extra;
+    cfg->final_rx_timeout_uus += extra;
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_count()
+ *
+ * @brief Add one result to the step counters and histograms.
+ *
+ * @param  result - exchange result
+ *
+ * @return none
+ */
+static void bench_count(const twr_result_t *result)
+{
+    switch (result->status) {
+    case TWR_OK:          step.ok++;      break;
+    case TWR_ERR_TIMEOUT: step.timeout++; break;
+    case TWR_ERR_LATE_TX: step.late++;    break;
+    case TWR_ERR_RX:      step.rx_err++;  break;
+    default:              step.frame++;   break;
+    }
+
+    for (int p = 0; p < TWR_PHASE_NUM; p++) {
+        uint32_t uus = result->phase_uus[p];
+        uint32_t bin = uus / BENCH_HIST_BIN_UUS;
+
+        if (uus == 0) {
+            continue;
+        }
+        if (bin >= BENCH_HIST_BINS) {
+            bin = BENCH_HIST_BINS - 1;
+        }
+        step.hist[p][bin]++;
+        step.phase_total[p] += uus;
+        step.phase_count[p]++;
+        if (uus < step.phase_min[p]) {
+            step.phase_min[p] = uus;
+        }
+        if (uus > step.phase_max[p]) {
+            step.phase_max[p] = uus;
+        }
+    }
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_permille()
+ *
+ * @brief Return n per 1000 exchanges of the step.
+ *
+ * @return rate
+ */
+static uint32_t bench_permille(uint32_t n)
+{
+    return n * 1000 / BENCH_EXCHANGES;
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_print_step()
+ *
+ * @brief Print the result and histogram lines of one step, see NOTE 1.
+ *
+ * @param  mode - TWR_MODE_SS or TWR_MODE_DS
+ * @param  period - exchange period, in ms
+ * @param  elapsed_ms - duration of the step
+ *
+ * @return ranges per 10 s
+ */
+static uint32_t bench_print_step(twr_mode_e mode, uint16_t period, uint32_t elapsed_ms)
+{
+    uint32_t rate10 = (elapsed_ms != 0) ? (step.ok * 10000 / elapsed_ms) : 0;
+
+    printk("twrbench,rate,%s,%s,%u,%u,%u,%u.%u,%u,%u,%u,%u,%u,%u\n",
+           CONFIG_OPTION_NAME, mode_names[mode], period, BENCH_EXCHANGES, elapsed_ms,
+           rate10 / 10, rate10 % 10, step.ok, bench_permille(step.timeout), bench_permille(step.late),
+           step.rx_err, step.frame, step.stall);
+
+    for (int p = 0; p < TWR_PHASE_NUM; p++) {
+        if (step.phase_count[p] == 0) {
+            continue;
+        }
+        printk("twrbench,phase,%s,%s,%u,%s,%u,%u,%u,%u\n",
+               CONFIG_OPTION_NAME, mode_names[mode], period, phase_names[p], step.phase_count[p],
+               step.phase_min[p], (uint32_t)(step.phase_total[p] / step.phase_count[p]), step.phase_max[p]);
+
+        printk("twrbench,hist,%s,%s,%u,%s,%u", CONFIG_OPTION_NAME, mode_names[mode], period,
+               phase_names[p], BENCH_HIST_BIN_UUS);
+        for (int b = 0; b < BENCH_HIST_BINS; b++) {
+            printk(",%u", step.hist[p][b]);
+        }
+        printk("\n");
+    }
+
+    return rate10;
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_step()
+ *
+ * @brief Run BENCH_EXCHANGES exchanges at one period and print the results.
+ *
+ * @param  mode - TWR_MODE_SS or TWR_MODE_DS
+ * @param  period - exchange period, in ms, 0 for back to back exchanges
+ *
+ * @return ranges per 10 s, 0 if the step is not sustained (too many failures)
+ */
+static uint32_t bench_step(twr_mode_e mode, uint16_t period)
+{
+    uint32_t start, next, rate10;
+
+    memset(&step, 0, sizeof(step));
+    for (int p = 0; p < TWR_PHASE_NUM; p++) {
+        step.phase_min[p] = UINT32_MAX;
+    }
+
+    start = k_uptime_get_32();
+    next = start;
+
+    for (int i = 0; i < BENCH_EXCHANGES; i++) {
+
+        if (period != 0) {
+            int32_t wait = (int32_t)(next - k_uptime_get_32());
+            if (wait > 0) {
+                Sleep(wait);
+            }
+            next += period;
+        }
+
+        k_sem_reset(&result_sem);
+        if (twr_start(mode, TWR_DEFAULT_RESP_ADDR) != DWT_SUCCESS) {
+            step.stall++;
+            continue;
+        }
+
+        if (k_sem_take(&result_sem, K_MSEC(BENCH_RESULT_TIMEOUT_MS)) != 0) {
+            step.stall++;
+            twr_stop();
+            continue;
+        }
+
+        bench_count(&last_result);
+    }
+
+    rate10 = bench_print_step(mode, period, k_uptime_get_32() - start);
+
+    if (bench_permille(BENCH_EXCHANGES - step.ok) > BENCH_MAX_ERR_PERMILLE) {
+        return 0;
+    }
+
+    return rate10;
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn app_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int app_main(void)
+{
+    twr_config_t twr_cfg;
+
+    /* Display application name. */
+    LOG_INF(APP_NAME);
+
+    /* Configure SPI rate, DW3000 supports up to 38 MHz */
+    port_set_dw_ic_spi_fastrate();
+
+    /* Reset DW IC */
+    /* Target specific drive of RSTn line into DW IC low for a period. */
+    reset_DWIC();
+
+    /* Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC */
+    Sleep(2);
+
+    /* Need to make sure DW IC is in IDLE_RC before proceeding */
+    while (!dwt_checkidlerc()) { /* spin */ };
+
+    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR) {
+        LOG_ERR("INIT FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration
+     * has failed the host should reset the device */
+    if (dwt_configure(&config_options)) {
+        LOG_ERR("CONFIG FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* Frame airtimes and delays of the profile, see phy_timing.h */
+    phy_timing_apply(0, &config_options);
+
+    /* Configure the TX spectrum parameters (power, PG delay and PG count) */
+    dwt_configuretxrf((config_options.chan == 9) ? &txconfig_options_ch9 : &txconfig_options);
+
+    /* Apply default antenna delay value. */
+    dwt_setrxantennadelay(RX_ANT_DLY);
+    dwt_settxantennadelay(TX_ANT_DLY);
+
+    dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
+
+    twr_default_config(&twr_cfg, TWR_ROLE_INITIATOR);
+    twr_cfg.tx_ant_dly = TX_ANT_DLY;
+    bench_phy_delays(&twr_cfg);
+
+    /* Register the engine call-backs and enable the TX/RX interrupts. */
+    twr_init(&twr_cfg, twr_result_cb);
+
+#ifdef TWR_BENCH_AUTOTUNE
+    /* Shrink the reply delays to the measured turnaround, see twr_autotune(). */
+    twr_autotune(&config_options, 50);
+#endif
+
+    /* Clearing the SPI ready interrupt */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+
+    /* Install DW IC IRQ handler. */
+    port_set_dwic_isr(dwt_isr);
+
+    LOG_INF("profile %s, reply delay %u uus", CONFIG_OPTION_NAME, twr_cfg.resp_rx_to_final_tx_dly_uus);
+
+    /* Give the responder time to start */
+    Sleep(1000);
+
+    while (1) {
+
+        for (twr_mode_e mode = TWR_MODE_SS; mode <= TWR_MODE_DS; mode++) {
+
+            uint32_t best10 = 0;
+            uint16_t best_period = 0;
+
+            for (int i = 0; i < ARRAY_SIZE(bench_periods); i++) {
+
+                uint32_t rate10 = bench_step(mode, bench_periods[i]);
+
+                if (rate10 > best10) {
+                    best10 = rate10;
+                    best_period = bench_periods[i];
+                }
+
+                /* Let the log thread drain the lines of the step */
+                Sleep(200);
+            }
+
+            printk("twrbench,max,%s,%s,%u.%u,%u\n", CONFIG_OPTION_NAME, mode_names[mode],
+                   best10 / 10, best10 % 10, best_period);
+        }
+
+        Sleep(5000);
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. Every line starts with "twrbench," and the CONFIG_OPTION profile, followed by the mode (ss, ds) and the exchange period in ms (0 for back to
+ *    back exchanges). Keep the lines of one kind to get a CSV file:
+ *      twrbench,rate,profile,mode,period_ms,exchanges,elapsed_ms,ranges_per_s,ok,timeout_permille,late_permille,rx_err,frame_err,stalls
+ *      twrbench,phase,profile,mode,period_ms,phase,count,min_uus,avg_uus,max_uus
+ *      twrbench,hist,profile,mode,period_ms,phase,bin_uus,bin0,...,bin31
+ *      twrbench,max,profile,mode,ranges_per_s,period_ms
+ *    The phases are timed between the RMARKERs of the initiator: poll_resp from the poll TX to the response RX (responder reply delay and time of
+ *    flight), resp_final from the response RX to the final TX (initiator reply delay, DS only). They only move with the reply delays, e.g. with
+ *    TWR_BENCH_AUTOTUNE, the host turnaround shows in the late TX and timeout rates. The last histogram bin collects the longer phases.
+ *    The max line gives the highest rate of the steps with at most 1% failed exchanges (BENCH_MAX_ERR_PERMILLE).
+ * 2. Select the same CONFIG_OPTION in config_options.h for both sides. The delays of twr_default_config() suit 6.8 Mb/s with a 128 symbol
+ *    preamble, the reply delays and the RX timeouts are lengthened by the extra airtime of slower or longer profiles. With the STS profiles
+ *    the frames carry an STS, whose quality is not checked here: the benchmark measures the exchange capacity, not the distance.
+ * 3. The responder logs its own counters (replies, late TX, timeouts) every 10 s, a responder late TX shows here as a timeout.
+ ****************************************************************************************************************************************************/
@@ -0,0 +1,215 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    twr_bench_resp.c
+ *  @brief   Ranging throughput and latency benchmark, responder side
+ *
+ *           Answers the SS-TWR and DS-TWR polls of ex_20b_twr_bench_init with
+ *           the TWR engine, with the same CONFIG_OPTION profile and delays,
+ *           and reports its own counters (replies, late TX, timeouts) every
+ *           BENCH_REPORT_MS, tagged with the profile (see NOTE 1).
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include <config_options.h>
+#include <twr.h>
+#include <phy_timing.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#define LOG_LEVEL 3
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(twr_bench_resp);
+
+/* Example application name and version to display on console. */
+#define APP_NAME "TWR BENCH RESP v1.0"
+
+/* Counter report period, in milliseconds */
+#define BENCH_REPORT_MS 10000
+
+/* Default antenna delay values for 64 MHz PRF. */
+#define TX_ANT_DLY 16385
+#define RX_ANT_DLY 16385
+
+/* PHY configuration of the selected CONFIG_OPTION profile, and the TX spectrum configurations */
+extern dwt_config_t config_options;
+extern dwt_txconfig_t txconfig_options;
+extern dwt_txconfig_t txconfig_options_ch9;
+
+/* Counters since the last report, updated from the DW IC interrupt context */
+static struct
+{
+    uint32_t ss;
+    uint32_t ds;
+    uint32_t timeout;
+    uint32_t late;
+    uint32_t rx_err;
+    uint32_t frame;
+} cnt;
+
+/*! ---------------------------------------------------------------------------
+ * @fn twr_result_cb()
+ *
+ * @brief Result callback, called by the TWR engine from the DW IC interrupt context
+ *        after each exchange.
+ *
+ * @param  result - exchange result
+ *
+ * @return none
+ */
+static void twr_result_cb(const twr_result_t *result)
+{
+    switch (result->status) {
+    case TWR_OK:
+        if (result->mode == TWR_MODE_SS) {
+            cnt.ss++;
+        }
+        else {
+            cnt.ds++;
+        }
+        break;
+    case TWR_ERR_TIMEOUT: cnt.timeout++; break;
+    case TWR_ERR_LATE_TX: cnt.late++;    break;
+    case TWR_ERR_RX:      cnt.rx_err++;  break;
+    default:              cnt.frame++;   break;
+    }
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn bench_phy_delays()
+ *
+ * @brief As the initiator (ex_20b_twr_bench_init): lengthen the reply delays and the
+ *        RX timeouts by the extra airtime of the profile over 6.8 Mb/s and a 128
+ *        symbol preamble (phy_timing_extra_uus()).
+ *
+ * @param  cfg - engine configuration
+ *
+ * @return none
+ */
+static void bench_phy_delays(twr_config_t *cfg)
+{
+    uint32_t extra = phy_timing_extra_uus(TWR_DS_FINAL_FINAL_TX_TS_IDX + FINAL_MSG_TS_LEN + FCS_LEN);
+
+    cfg->resp_rx_to_final_tx_dly_uus += extra;
+    cfg->poll_rx_to_resp_tx_dly_uus += extra;
+    cfg->resp_rx_timeout_uus += extra;
+    cfg->final_rx_timeout_uus += extra;
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn app_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int app_main(void)
+{
+    twr_config_t twr_cfg;
+
+    /* Display application name. */
+    LOG_INF(APP_NAME);
+
+    /* Configure SPI rate, DW3000 supports up to 38 MHz */
+    port_set_dw_ic_spi_fastrate();
+
+    /* Reset DW IC */
+    /* Target specific drive of RSTn line into DW IC low for a period. */
+    reset_DWIC();
+
+    /* Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC */
+    Sleep(2);
+
+    /* Need to make sure DW IC is in IDLE_RC before proceeding */
+    while (!dwt_checkidlerc()) { /* spin */ };
+
+    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR) {
+        LOG_ERR("INIT FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration
+     * has failed the host should reset the device */
+    if (dwt_configure(&config_options)) {
+        LOG_ERR("CONFIG FAILED");
+        while (1) { /* spin */ };
+    }
+
+    /* Frame airtimes and delays of the profile, see phy_timing.h */
+    phy_timing_apply(0, &config_options);
+
+    /* Configure the TX spectrum parameters (power, PG delay and PG count) */
+    dwt_configuretxrf((config_options.chan == 9) ? &txconfig_options_ch9 : &txconfig_options);
+
+    /* Apply default antenna delay value. */
+    dwt_setrxantennadelay(RX_ANT_DLY);
+    dwt_settxantennadelay(TX_ANT_DLY);
+
+    dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
+
+    twr_default_config(&twr_cfg, TWR_ROLE_RESPONDER);
+    twr_cfg.tx_ant_dly = TX_ANT_DLY;
+    bench_phy_delays(&twr_cfg);
+
+    /* Register the engine call-backs and enable the TX/RX interrupts. */
+    twr_init(&twr_cfg, twr_result_cb);
+
+#ifdef TWR_BENCH_AUTOTUNE
+    /* Shrink the reply delays to the measured turnaround, see twr_autotune(). */
+    twr_autotune(&config_options, 50);
+#endif
+
+    /* Clearing the SPI ready interrupt */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+
+    /* Install DW IC IRQ handler. */
+    port_set_dwic_isr(dwt_isr);
+
+    LOG_INF("profile %s, reply delay %u uus", CONFIG_OPTION_NAME, twr_cfg.poll_rx_to_resp_tx_dly_uus);
+
+    twr_listen();
+
+    while (1) {
+
+        uint32_t ss, ds, timeout, late, rx_err, frame;
+        unsigned int key;
+
+        Sleep(BENCH_REPORT_MS);
+
+        /* Take and clear the counters without racing the interrupt context */
+        key = irq_lock();
+        ss = cnt.ss;
+        ds = cnt.ds;
+        timeout = cnt.timeout;
+        late = cnt.late;
+        rx_err = cnt.rx_err;
+        frame = cnt.frame;
+        memset(&cnt, 0, sizeof(cnt));
+        irq_unlock(key);
+
+        printk("twrbench,resp,%s,%u,%u,%u,%u,%u,%u,%u\n", CONFIG_OPTION_NAME, BENCH_REPORT_MS,
+               ss, ds, timeout, late, rx_err, frame);
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The report line is "twrbench,resp,profile,period_ms,ss_ok,ds_ok,timeout,late_tx,rx_err,frame_err". The timeouts are DS finals that did not
+ *    come, e.g. after an initiator late TX. A responder late TX shows on the initiator as a response timeout.
+ * 2. Select the same CONFIG_OPTION in config_options.h as on the initiator side, see ex_20b_twr_bench_init NOTE 2.
+ ****************************************************************************************************************************************************/
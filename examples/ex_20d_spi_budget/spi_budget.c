@@ -0,0 +1,315 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    spi_budget.c
+ *  @brief   SPI transaction budgets of the driver calls, on native_sim
+ *
+ *           Runs the driver against the DW3000 register model of
+ *           platform/dw_model.c instead of a board, and counts the SPI
+ *           transactions (chip selects) and bytes of each driver call of a
+ *           TX and an RX exchange, from dwt_initialise() to the interrupt
+ *           handling. Each count is checked against its budget, one CSV line
+ *           per call (see NOTE 1), and the process exits with status 1 if any
+ *           call is over budget, so a CI host catches driver changes that add
+ *           SPI traffic.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <dw_model.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#if defined(CONFIG_ARCH_POSIX)
+#include <posix_board_if.h>
+#endif
+
+/* Example application name and version. */
+#define APP_NAME "SPI BUDGET v1.0"
+
+/* Default communication configuration. We use default non-STS mode. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard 8 symbol SFD, 1 to use non-standard 8 symbol, 2 for non-standard 16 symbol SFD and 3 for 4z 8 symbol SDF type */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_EXT, /* PHY header mode, extended for the 1023 byte buffer transfers. */
+    DWT_PHRRATE_STD, /* PHY header rate. */
+    (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+    DWT_STS_MODE_OFF, /* STS disabled */
+    DWT_STS_LEN_64,  /* STS length see allowed values in Enum dwt_sts_lengths_e */
+    DWT_PDOA_M0      /* PDOA mode off */
+};
+
+/* TX spectrum configuration of channel 5 */
+static dwt_txconfig_t txconfig = {
+    0x34,            /* PG delay. */
+    0xfdfdfdfd,      /* TX power. */
+    0x0              /* PG count. */
+};
+
+/* Frame of the TX and RX calls: a data frame with the sequence number and addresses of the examples */
+static uint8_t frame[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'D', 'E', 'C', 'A', 0xE0, 0, 0};
+#define FRAME_LEN (sizeof(frame))
+
+/* Delayed TX start time, and RX timeout (UWB microseconds), of the delayed and timeout calls */
+#define BUDGET_DLY_TIME     0x10000000UL
+#define BUDGET_RX_TIMEOUT   1000
+
+/* Largest transfer: one 1023 byte frame */
+#define BUDGET_BUF_LEN      1023
+
+static uint8_t budget_buf[BUDGET_BUF_LEN];
+static uint8_t budget_ts[5];
+static dwt_rxdiag_t budget_diag;
+
+/* Events seen by the call-backs, checked after each interrupt call */
+static volatile uint32_t cb_events;
+#define CB_TX_DONE  0x1
+#define CB_RX_OK    0x2
+#define CB_RX_TO    0x4
+#define CB_RX_ERR   0x8
+
+/* SPI read CRC errors reported by the driver */
+static volatile uint32_t spi_rd_errors;
+
+/* A measured call: optional setup (not counted), the call, and its budget */
+typedef struct
+{
+    const char    * name;
+    void         (* prep)(void);
+    int          (* run)(void);
+    uint16_t        max_xfers;
+    uint16_t        max_bytes;
+} budget_t;
+
+static void tx_done_cb(const dwt_cb_data_t *cb_data) { cb_events |= CB_TX_DONE; }
+static void rx_ok_cb(const dwt_cb_data_t *cb_data)   { cb_events |= CB_RX_OK;   }
+static void rx_to_cb(const dwt_cb_data_t *cb_data)   { cb_events |= CB_RX_TO;   }
+static void rx_err_cb(const dwt_cb_data_t *cb_data)  { cb_events |= CB_RX_ERR;  }
+
+/*! ---------------------------------------------------------------------------
+ * @fn model_isr()
+ *
+ * @brief Stands for the IRQ line: call dwt_isr() while the model has an enabled event set.
+ *
+ * @param  none
+ *
+ * @return the call-back events
+ */
+static uint32_t model_isr(void)
+{
+    /* Bounded, an event the ISR does not clear must not hang the run */
+    for (int i = 0; (i < 4) && dw_model_irq(); i++) {
+        dwt_isr();
+    }
+    return cb_events;
+}
+
+/* The calls under test, each returns 0 when its result is as expected */
+
+static int  run_checkidlerc(void)  { return dwt_checkidlerc() ? 0 : -1; }
+static void prep_initialise(void)  { dw_model_reset(); }
+static int  run_initialise(void)   { return (dwt_initialise(DWT_DW_INIT) == DWT_SUCCESS) ? 0 : -1; }
+static int  run_configure(void)    { return (dwt_configure(&config) == DWT_SUCCESS) ? 0 : -1; }
+static int  run_configuretxrf(void) { dwt_configuretxrf(&txconfig); return 0; }
+
+static int run_setinterrupt(void)
+{
+    dwt_setcallbacks(&tx_done_cb, &rx_ok_cb, &rx_to_cb, &rx_err_cb, NULL, NULL);
+    dwt_setinterrupt(SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFTO_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXPTO_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXPHE_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFCE_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFSL_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXSTO_ENABLE_BIT_MASK,
+                     0,
+                     DWT_ENABLE_INT);
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+    return 0;
+}
+
+static int run_read32(void)         { return (dwt_read32bitreg(DEV_ID_ID) == (uint32_t)DWT_C0_DEV_ID) ? 0 : -1; }
+static int run_writetxdata12(void)  { return dwt_writetxdata(FRAME_LEN, frame, 0); }
+static int run_writetxdata127(void) { return dwt_writetxdata(127, budget_buf, 0); }
+static int run_writetxdata1023(void) { return dwt_writetxdata(BUDGET_BUF_LEN, budget_buf, 0); }
+static int run_writetxfctrl(void)   { dwt_writetxfctrl(FRAME_LEN, 0, 1); return 0; }
+static void prep_tx(void)           { dwt_writetxdata(FRAME_LEN, frame, 0); dwt_writetxfctrl(FRAME_LEN, 0, 1); cb_events = 0; }
+static int run_starttx(void)        { return dwt_starttx(DWT_START_TX_IMMEDIATE); }
+
+static int run_starttx_dly(void)
+{
+    dwt_setdelayedtrxtime(BUDGET_DLY_TIME);
+    return dwt_starttx(DWT_START_TX_DELAYED);
+}
+
+static int run_isr_txdone(void)     { return (model_isr() == CB_TX_DONE) ? 0 : -1; }
+static int run_readtxtimestamp(void) { dwt_readtxtimestamp(budget_ts); return 0; }
+
+static void prep_rx(void)
+{
+    frame[2]++;
+    dw_model_rx_inject(frame, FRAME_LEN - FCS_LEN);
+    dwt_setrxtimeout(0);
+    cb_events = 0;
+}
+
+static int run_rxenable(void)       { return dwt_rxenable(DWT_START_RX_IMMEDIATE); }
+static int run_isr_rxok(void)       { return (model_isr() == CB_RX_OK) ? 0 : -1; }
+static int run_readrxdata12(void)   { dwt_readrxdata(budget_buf, FRAME_LEN - FCS_LEN, 0); return memcmp(budget_buf, frame, FRAME_LEN - FCS_LEN); }
+static int run_readrxdata1023(void) { dwt_readrxdata(budget_buf, BUDGET_BUF_LEN, 0); return 0; }
+static int run_readrxtimestamp(void) { dwt_readrxtimestamp(budget_ts); return 0; }
+static int run_readdiagnostics(void) { dwt_readdiagnostics(&budget_diag); return 0; }
+
+static void prep_rxto(void)
+{
+    dwt_setrxtimeout(BUDGET_RX_TIMEOUT);
+    cb_events = 0;
+}
+
+static int run_isr_rxto(void)       { return (model_isr() == CB_RX_TO) ? 0 : -1; }
+
+static void prep_w4r(void)
+{
+    prep_tx();
+    prep_rx();
+}
+
+static int run_starttx_w4r(void)    { return dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED); }
+static int run_isr_w4r(void)        { return (model_isr() == (CB_TX_DONE | CB_RX_OK)) ? 0 : -1; }
+
+static void spi_rd_err_cb(void)      { spi_rd_errors++; }
+static int run_spicrc_on(void)      { dwt_enablespicrccheck(DWT_SPI_CRC_MODE_WRRD, &spi_rd_err_cb); return 0; }
+static int run_spicrc_off(void)     { dwt_enablespicrccheck(DWT_SPI_CRC_MODE_NO, NULL); return 0; }
+static int run_write32_crc(void)    { dwt_write32bitreg(AES_IV0_ID, 0x12345678); return (dw_model_get_stats()->crc_errors == 0) ? 0 : -1; }
+static int run_read32_crc(void)     { return ((dwt_read32bitreg(AES_IV0_ID) == 0x12345678) && (spi_rd_errors == 0)) ? 0 : -1; }
+
+/* Budgets: the counts of the current driver, see NOTE 2 */
+static const budget_t budgets[] = {
+    /* name             prep             run                  xfers  bytes */
+    { "checkidlerc",     prep_initialise, run_checkidlerc,         1,     4 },
+    { "initialise",      NULL,            run_initialise,         26,   116 },
+    { "configure",       NULL,            run_configure,          40,   204 },
+    { "configuretxrf",   NULL,            run_configuretxrf,       2,     9 },
+    { "setinterrupt",    NULL,            run_setinterrupt,        3,    26 },
+    { "read32",          NULL,            run_read32,              1,     5 },
+    { "writetxdata12",   NULL,            run_writetxdata12,       1,    13 },
+    { "writetxdata127",  NULL,            run_writetxdata127,      1,   128 },
+    { "writetxdata1023", NULL,            run_writetxdata1023,     1,  1024 },
+    { "writetxfctrl",    NULL,            run_writetxfctrl,        1,    10 },
+    { "starttx",         prep_tx,         run_starttx,             1,     1 },
+    { "isr_txdone",      NULL,            run_isr_txdone,          3,    11 },
+    { "readtxtimestamp", NULL,            run_readtxtimestamp,     1,     7 },
+    { "starttx_dly",     prep_tx,         run_starttx_dly,         4,    16 },
+    { "isr_txdone_dly",  NULL,            run_isr_txdone,          3,    11 },
+    { "rxenable",        prep_rx,         run_rxenable,            1,     1 },
+    { "isr_rxok",        NULL,            run_isr_rxok,            4,    18 },
+    { "readrxdata12",    NULL,            run_readrxdata12,        1,    11 },
+    { "readrxdata1023",  NULL,            run_readrxdata1023,      1,  1024 },
+    { "readrxtimestamp", NULL,            run_readrxtimestamp,     1,     7 },
+    { "readdiagnostics", NULL,            run_readdiagnostics,     1,    41 },
+    { "rxenable_to",     prep_rxto,       run_rxenable,            1,     1 },
+    { "isr_rxto",        NULL,            run_isr_rxto,            3,    11 },
+    { "starttx_w4r",     prep_w4r,        run_starttx_w4r,         1,     1 },
+    { "isr_w4r",         NULL,            run_isr_w4r,             5,    21 },
+    { "spicrc_on",       NULL,            run_spicrc_on,           1,     4 },
+    { "write32_crc",     NULL,            run_write32_crc,         1,     7 },
+    { "read32_crc",      NULL,            run_read32_crc,          2,     9 },
+    { "spicrc_off",      NULL,            run_spicrc_off,          1,     5 },
+};
+
+/*! ---------------------------------------------------------------------------
+ * @fn budget_dump()
+ *
+ * @brief Print the transactions of a call over budget (the last DW_MODEL_LOG_LEN of them).
+ *
+ * @param  none
+ *
+ * @return none
+ */
+static void budget_dump(void)
+{
+    static const char * const type[DW_MODEL_XFER_NUM] = { "rd", "wr", "andor", "fast" };
+    const dw_model_stats_t * stats = dw_model_get_stats();
+    dw_model_xfer_t x;
+
+    for (uint32_t i = 0; i < stats->xfers; i++) {
+        if (dw_model_get_xfer(i, &x) == 0) {
+            printk("spibudget,xfer,%u,%s,0x%02x,0x%02x,%u,%u\n", i, type[x.type], x.file, x.offset, x.len, x.bytes);
+        }
+    }
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn main()
+ *
+ * @brief Application entry point, run once: there is no main.c (peripheral init) on native_sim.
+ *
+ * @param  none
+ *
+ * @return 0 if every call is within its budget
+ */
+int main(void)
+{
+    int failed = 0;
+
+    printk("%s\n", APP_NAME);
+    printk("spibudget,op,xfers,bytes,max_xfers,max_bytes,result\n");
+
+    for (int i = 0; i < (int)(sizeof(budgets) / sizeof(budgets[0])); i++) {
+
+        const budget_t * b = &budgets[i];
+        const dw_model_stats_t * stats;
+        int err;
+
+        if (b->prep != NULL) {
+            b->prep();
+        }
+
+        dw_model_clear_stats();
+        err = b->run();
+        stats = dw_model_get_stats();
+
+        if ((err != 0) || (stats->xfers > b->max_xfers) || (stats->bytes > b->max_bytes)) {
+            printk("spibudget,%s,%u,%u,%u,%u,%s\n", b->name, stats->xfers, stats->bytes,
+                   b->max_xfers, b->max_bytes, (err != 0) ? "ERROR" : "FAIL");
+            budget_dump();
+            failed++;
+        }
+        else {
+            printk("spibudget,%s,%u,%u,%u,%u,PASS\n", b->name, stats->xfers, stats->bytes,
+                   b->max_xfers, b->max_bytes);
+        }
+    }
+
+    printk("spibudget,summary,%d,%d\n", (int)(sizeof(budgets) / sizeof(budgets[0])), failed);
+
+#if defined(CONFIG_ARCH_POSIX)
+    posix_exit(failed ? 1 : 0);
+#endif
+    return failed ? 1 : 0;
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. Each line is "spibudget,op,xfers,bytes,max_xfers,max_bytes,result": the SPI transactions (chip selects) and bytes (headers, data and CRC)
+ *    of the call, its budget, and PASS, FAIL (over budget) or ERROR (unexpected result, e.g. no call-back from the interrupt handler). A
+ *    FAIL or ERROR line is followed by the transactions of the call: "spibudget,xfer,index,type,file,offset,data_len,bytes".
+ * 2. The budgets are the counts of the driver as it is. A change that saves transactions should lower its budgets in the same commit, one
+ *    that adds some must raise them on purpose. The counts depend on the driver build options (e.g. the register cache) but not on the SPI
+ *    rate, and DWT_SPI_PROFILE does not change them. The model has no radio timing, see dw_model.h.
+ * 3. The calls run in order on one model instance: each starts from the state the previous ones left (e.g. the RX calls read the frame
+ *    received by "rxenable").
+ ****************************************************************************************************************************************************/
@@ -0,0 +1,248 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    xfer_dbl_buff.c
+ *  @brief   Double buffered RX of the transfer engine, on native_sim
+ *
+ *           Runs the receiver of MAC_802_15_4/mac_xfer.c with rx_dbl_buff
+ *           against the DW3000 register model of platform/dw_model.c, feeds
+ *           it transfer frames one or two at a time, and checks that each
+ *           frame received gives its RX buffer back to the DW IC exactly once
+ *           (one CMD_DB_TOGGLE per frame, see NOTE 1) and that the payloads
+ *           delivered are the ones sent. One CSV line per step, and the
+ *           process exits with status 1 if any step fails.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <dw_model.h>
+#include <mac_xfer.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#if defined(CONFIG_ARCH_POSIX)
+#include <posix_board_if.h>
+#endif
+
+/* Example application name and version. */
+#define APP_NAME "XFER DBL BUFF v1.0"
+
+/* Default communication configuration. We use default non-STS mode. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard 8 symbol SFD, 1 to use non-standard 8 symbol, 2 for non-standard 16 symbol SFD and 3 for 4z 8 symbol SDF type */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    DWT_PHRRATE_STD, /* PHY header rate. */
+    (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+    DWT_STS_MODE_OFF, /* STS disabled */
+    DWT_STS_LEN_64,  /* STS length see allowed values in Enum dwt_sts_lengths_e */
+    DWT_PDOA_M0      /* PDOA mode off */
+};
+
+/* Transfer fed to the receiver: frames of CHECK_UNIT payload bytes */
+#define CHECK_ID        0x21
+#define CHECK_FRAMES    6
+#define CHECK_UNIT      32
+
+/* A step: frames injected together, then the interrupt handling */
+typedef struct
+{
+    const char    * name;
+    uint16_t        index;          /* first frame */
+    uint8_t         count;          /* frames, 1 or 2 */
+    uint8_t         flags;          /* of the last frame: MAC_XFER_FLAG_ACK_REQ */
+    uint16_t        pan_id;         /* another PAN: the engine drops the frame */
+    uint8_t         delivered;      /* new frames expected by the receiver callback */
+} step_t;
+
+static const step_t steps[] = {
+    /* name         index count flags                  pan_id                  delivered */
+    { "single",         0,  1,  0,                     MAC_XFER_DEFAULT_PAN_ID,  1 },
+    { "pair",           1,  2,  0,                     MAC_XFER_DEFAULT_PAN_ID,  2 },
+    { "duplicate",      2,  1,  0,                     MAC_XFER_DEFAULT_PAN_ID,  0 },
+    { "other_pan",      3,  1,  0,                     0x1234,                   0 },
+    { "pair_ack_req",   3,  2,  MAC_XFER_FLAG_ACK_REQ, MAC_XFER_DEFAULT_PAN_ID,  2 },
+    { "last",           5,  1,  MAC_XFER_FLAG_ACK_REQ, MAC_XFER_DEFAULT_PAN_ID,  1 },
+};
+
+static uint8_t frame[MAC_XFER_DATA_HDR_LEN + CHECK_UNIT];
+static uint8_t seq;
+
+/* Receiver callback results, checked after each step */
+static uint32_t delivered;
+static uint32_t bad_payloads;
+
+/*! ---------------------------------------------------------------------------
+ * @fn payload_byte()
+ *
+ * @brief Payload pattern: each frame and offset has its own byte.
+ */
+static uint8_t payload_byte(uint16_t index, uint16_t i)
+{
+    return (uint8_t)(index * 0x35 + i);
+}
+
+static void rx_cb(const mac_xfer_rx_t *rx)
+{
+    delivered++;
+
+    if ((rx->len != CHECK_UNIT) || (rx->id != CHECK_ID)) {
+        bad_payloads++;
+        return;
+    }
+    for (uint16_t i = 0; i < rx->len; i++) {
+        if (rx->data[i] != payload_byte(rx->index, i)) {
+            bad_payloads++;
+            return;
+        }
+    }
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn frame_inject()
+ *
+ * @brief Build a data frame of the transfer, from MAC_XFER_DEFAULT_TX_ADDR to MAC_XFER_DEFAULT_RX_ADDR, and queue it
+ *        on the model.
+ *
+ * @param  index - frame index
+ * @param  flags - data frame flags
+ * @param  pan_id - destination PAN
+ *
+ * @return none
+ */
+static void frame_inject(uint16_t index, uint8_t flags, uint16_t pan_id)
+{
+    frame[0] = 0x41;                                /* data frame, PAN ID compression */
+    frame[1] = 0x88;                                /* 16-bit addresses */
+    frame[MAC_XFER_MSG_SN_IDX] = seq++;
+    frame[MAC_XFER_MSG_PAN_IDX] = (uint8_t)pan_id;
+    frame[MAC_XFER_MSG_PAN_IDX + 1] = (uint8_t)(pan_id >> 8);
+    frame[MAC_XFER_MSG_DST_IDX] = (uint8_t)MAC_XFER_DEFAULT_RX_ADDR;
+    frame[MAC_XFER_MSG_DST_IDX + 1] = (uint8_t)(MAC_XFER_DEFAULT_RX_ADDR >> 8);
+    frame[MAC_XFER_MSG_SRC_IDX] = (uint8_t)MAC_XFER_DEFAULT_TX_ADDR;
+    frame[MAC_XFER_MSG_SRC_IDX + 1] = (uint8_t)(MAC_XFER_DEFAULT_TX_ADDR >> 8);
+    frame[MAC_XFER_MSG_FUNC_IDX] = MAC_XFER_FUNC_DATA;
+    frame[MAC_XFER_MSG_ID_IDX] = CHECK_ID;
+    frame[MAC_XFER_DATA_FLAGS_IDX] = flags;
+    frame[MAC_XFER_DATA_INDEX_IDX] = (uint8_t)index;
+    frame[MAC_XFER_DATA_INDEX_IDX + 1] = (uint8_t)(index >> 8);
+    frame[MAC_XFER_DATA_TOTAL_IDX] = CHECK_FRAMES;
+    frame[MAC_XFER_DATA_TOTAL_IDX + 1] = 0;
+    frame[MAC_XFER_DATA_UNIT_IDX] = CHECK_UNIT;
+    frame[MAC_XFER_DATA_UNIT_IDX + 1] = 0;
+
+    for (uint16_t i = 0; i < CHECK_UNIT; i++) {
+        frame[MAC_XFER_DATA_HDR_LEN + i] = payload_byte(index, i);
+    }
+
+    dw_model_rx_inject(frame, sizeof(frame));
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn model_isr()
+ *
+ * @brief Stands for the IRQ line: call dwt_isr() while the model has an enabled event set.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+static void model_isr(void)
+{
+    /* Bounded, an event the ISR does not clear must not hang the run */
+    for (int i = 0; (i < 8) && dw_model_irq(); i++) {
+        dwt_isr();
+    }
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn main()
+ *
+ * @brief Application entry point, run once: there is no main.c (peripheral init) on native_sim.
+ *
+ * @param  none
+ *
+ * @return 0 if every step passes
+ */
+int main(void)
+{
+    mac_xfer_config_t xfer_cfg;
+    int failed = 0;
+
+    printk("%s\n", APP_NAME);
+
+    dw_model_reset();
+    if ((dwt_initialise(DWT_DW_INIT) != DWT_SUCCESS) || (dwt_configure(&config) != DWT_SUCCESS)) {
+        printk("dblbuff,init,ERROR\n");
+#if defined(CONFIG_ARCH_POSIX)
+        posix_exit(1);
+#endif
+        return 1;
+    }
+
+    mac_xfer_default_config(&xfer_cfg, MAC_XFER_DEFAULT_RX_ADDR);
+    xfer_cfg.rx_dbl_buff = 1;
+    mac_xfer_init(&xfer_cfg, NULL, &rx_cb);
+    mac_xfer_listen();
+
+    printk("dblbuff,step,frames,toggles,delivered,bad_payloads,result\n");
+
+    for (int i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])); i++) {
+
+        const step_t * s = &steps[i];
+        const dw_model_stats_t * stats;
+        int ok;
+
+        dw_model_clear_stats();
+        delivered = 0;
+        bad_payloads = 0;
+
+        for (int f = 0; f < s->count; f++) {
+            frame_inject(s->index + f, (f == (s->count - 1)) ? s->flags : 0, s->pan_id);
+        }
+        model_isr();
+
+        stats = dw_model_get_stats();
+        ok = (stats->rx_frames == s->count) && (stats->db_toggles == stats->rx_frames) &&
+             (delivered == s->delivered) && (bad_payloads == 0);
+
+        printk("dblbuff,%s,%u,%u,%u,%u,%s\n", s->name, stats->rx_frames, stats->db_toggles,
+               delivered, bad_payloads, ok ? "PASS" : "FAIL");
+        if (!ok) {
+            failed++;
+        }
+    }
+
+    mac_xfer_stop();
+
+    printk("dblbuff,summary,%d,%d\n", (int)(sizeof(steps) / sizeof(steps[0])), failed);
+
+#if defined(CONFIG_ARCH_POSIX)
+    posix_exit(failed ? 1 : 0);
+#endif
+    return failed ? 1 : 0;
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. In the manual double buffer mode, the host gives each RX buffer back with one CMD_DB_TOGGLE (dwt_signal_rx_buff_free()), which also moves
+ *    the driver to the other buffer. dwt_isr() does it after the RX callback, so the callback must not: a second toggle per frame sends the host
+ *    and the DW IC to different buffers, and the next frames are read from the wrong one. The model counts the toggles (db_toggles) and
+ *    receives into a buffer only once it is given back.
+ * 2. Each line is "dblbuff,step,frames,toggles,delivered,bad_payloads,result": the frames received by the model in the step, the CMD_DB_TOGGLE
+ *    commands, the new frames given to the receiver callback and those with an unexpected payload, and PASS or FAIL. The steps run in order on
+ *    one transfer: "pair" receives the second frame into the other buffer while the first one is read, "duplicate" and "other_pan" are dropped
+ *    by the engine, and the ACK requests are answered with a block ACK (the receiver is enabled after its TX).
+ ****************************************************************************************************************************************************/
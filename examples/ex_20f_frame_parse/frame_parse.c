@@ -0,0 +1,185 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    frame_parse.c
+ *  @brief   802.15.4 header parser checks, on native_sim
+ *
+ *           Parses a frame of each PAN ID / address combination of
+ *           802.15.4-2015 table 7-2 (frame version 2), of the 802.15.4-2006
+ *           rules (frame versions 0 and 1), and of a few other header forms,
+ *           with mac_frame_parse_802_15_4(), and checks the offsets found
+ *           against the standard, one CSV line per frame (see NOTE 1). The
+ *           process exits with status 1 if any frame is parsed wrong.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include <deca_device_api.h>
+#include <mac_802_15_4.h>
+
+//zephyr includes
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#if defined(CONFIG_ARCH_POSIX)
+#include <posix_board_if.h>
+#endif
+
+/* Example application name and version. */
+#define APP_NAME "FRAME PARSE v1.0"
+
+/* Frame control, second byte: addressing modes and frame version */
+#define FC1(dst, ver, src)  (uint8_t)(((dst) << MAC_FRAME_DEST_ADDR_MODE_SHIFT_VALUE) | ((ver) << MAC_FRAME_FRAME_VER_SHIFT_VALUE) \
+                                      | ((src) << MAC_FRAME_SRC_ADDR_MODE_SHIFT_VALUE))
+#define FC0_DATA            0x01    /* data frame */
+#define FC0_DATA_COMP       0x41    /* ... PAN ID compression */
+#define FC1_SEQ_SUPP        (1 << MAC_FRAME_SEQ_NUM_SUPPRESS_SHIFT_VALUE)
+#define FC1_IE              (1 << MAC_FRAME_IE_PRESET_SHIFT_VALUE)
+
+#define NONE                0
+#define SHORT               2
+#define EXT                 3
+
+/* Payload bytes of each frame, after the header */
+#define PARSE_PAYLOAD_LEN   10
+
+/* Header IEs of the "long_ies" frame: two of the longest, then a header termination (HT2) */
+#define PARSE_IE_LEN        MAC_HEADER_IE_LEN_MASK
+#define PARSE_IES_LEN       (2 * (2 + PARSE_IE_LEN) + 2)
+
+/* A frame and its expected view: offset 0 is an absent PAN ID */
+typedef struct
+{
+    const char    * name;
+    uint8_t         fc0;
+    uint8_t         fc1;
+    uint16_t        dst_pan_off;
+    uint16_t        dst_addr_off;
+    uint16_t        src_pan_off;
+    uint16_t        src_addr_off;
+    uint16_t        payload_off;
+} parse_t;
+
+static const parse_t frames[] = {
+    /* name                fc0            fc1                                      dst_pan dst src_pan src payload */
+    /* 802.15.4-2015 table 7-2, frame version 2, rows 1 to 14 */
+    { "v2_none_none",      FC0_DATA,      FC1(NONE,  2, NONE),                          0,  3,  0,  3,  3 },
+    { "v2_none_none_c",    FC0_DATA_COMP, FC1(NONE,  2, NONE),                          3,  5,  0,  5,  5 },
+    { "v2_short_none",     FC0_DATA,      FC1(SHORT, 2, NONE),                          3,  5,  0,  7,  7 },
+    { "v2_short_none_c",   FC0_DATA_COMP, FC1(SHORT, 2, NONE),                          0,  3,  0,  5,  5 },
+    { "v2_none_short",     FC0_DATA,      FC1(NONE,  2, SHORT),                         0,  3,  3,  5,  7 },
+    { "v2_none_short_c",   FC0_DATA_COMP, FC1(NONE,  2, SHORT),                         0,  3,  0,  3,  5 },
+    { "v2_ext_ext",        FC0_DATA,      FC1(EXT,   2, EXT),                           3,  5,  0, 13, 21 },
+    { "v2_ext_ext_c",      FC0_DATA_COMP, FC1(EXT,   2, EXT),                           0,  3,  0, 11, 19 },
+    { "v2_short_short",    FC0_DATA,      FC1(SHORT, 2, SHORT),                         3,  5,  7,  9, 11 },
+    { "v2_short_ext",      FC0_DATA,      FC1(SHORT, 2, EXT),                           3,  5,  7,  9, 17 },
+    { "v2_ext_short",      FC0_DATA,      FC1(EXT,   2, SHORT),                         3,  5, 13, 15, 17 },
+    { "v2_short_ext_c",    FC0_DATA_COMP, FC1(SHORT, 2, EXT),                           3,  5,  0,  7, 15 },
+    { "v2_ext_short_c",    FC0_DATA_COMP, FC1(EXT,   2, SHORT),                         3,  5,  0, 13, 15 },
+    { "v2_short_short_c",  FC0_DATA_COMP, FC1(SHORT, 2, SHORT),                         3,  5,  0,  7,  9 },
+    /* 802.15.4-2006, frame versions 0 and 1: compression drops the source PAN ID when both addresses are present */
+    { "v0_short_short",    FC0_DATA,      FC1(SHORT, 0, SHORT),                         3,  5,  7,  9, 11 },
+    { "v0_short_short_c",  FC0_DATA_COMP, FC1(SHORT, 0, SHORT),                         3,  5,  0,  7,  9 },
+    { "v1_ext_ext",        FC0_DATA,      FC1(EXT,   1, EXT),                           3,  5, 13, 15, 23 },
+    { "v1_ext_ext_c",      FC0_DATA_COMP, FC1(EXT,   1, EXT),                           3,  5,  0, 13, 21 },
+    { "v0_none_short",     FC0_DATA,      FC1(NONE,  0, SHORT),                         0,  3,  3,  5,  7 },
+    /* frame version 2: sequence number suppressed, and header IEs longer than 255 bytes */
+    { "v2_seq_supp_c",     FC0_DATA_COMP, FC1(SHORT, 2, SHORT) | FC1_SEQ_SUPP,          2,  4,  0,  6,  8 },
+    { "long_ies",          FC0_DATA_COMP, FC1(SHORT, 2, SHORT) | FC1_IE,                3,  5,  0,  7,  9 + PARSE_IES_LEN },
+};
+
+static uint8_t frame[2 + MAC_FRAME_MHR_MAX_LEN + PARSE_IES_LEN + PARSE_PAYLOAD_LEN + FCS_LEN];
+
+/*! ---------------------------------------------------------------------------
+ * @fn frame_build()
+ *
+ * @brief Build the frame of a check: the frame control, then counting bytes up to the header IEs, if any, at the
+ *        addresses end, and PARSE_PAYLOAD_LEN bytes of payload.
+ *
+ * @param  p - check
+ *
+ * @return frame length, FCS included
+ */
+static uint16_t frame_build(const parse_t * p)
+{
+    uint16_t len = p->payload_off + PARSE_PAYLOAD_LEN + FCS_LEN;
+
+    for (uint16_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = (uint8_t)i;
+    }
+    frame[0] = p->fc0;
+    frame[1] = p->fc1;
+
+    if (p->fc1 & FC1_IE) {
+
+        uint8_t * ie = &frame[p->payload_off - PARSE_IES_LEN];
+        uint16_t desc = PARSE_IE_LEN;
+
+        for (int i = 0; i < 2; i++) {
+            ie[0] = (uint8_t)desc;
+            ie[1] = (uint8_t)(desc >> 8);
+            ie += 2 + PARSE_IE_LEN;
+        }
+        desc = MAC_HEADER_IE_ID_HT2 << MAC_HEADER_IE_ID_SHIFT_VALUE;
+        ie[0] = (uint8_t)desc;
+        ie[1] = (uint8_t)(desc >> 8);
+    }
+
+    return len;
+}
+
+/*! ---------------------------------------------------------------------------
+ * @fn main()
+ *
+ * @brief Application entry point, run once: there is no main.c (peripheral init) on native_sim.
+ *
+ * @param  none
+ *
+ * @return 0 if every frame is parsed as expected
+ */
+int main(void)
+{
+    int failed = 0;
+
+    printk("%s\n", APP_NAME);
+    printk("parse,frame,fc,dst_pan_off,dst_addr_off,src_pan_off,src_addr_off,payload_off,result\n");
+
+    for (int i = 0; i < (int)(sizeof(frames) / sizeof(frames[0])); i++) {
+
+        const parse_t * p = &frames[i];
+        uint16_t frame_len = frame_build(p);
+        mac_frame_view_t view;
+        int ok;
+
+        ok = (mac_frame_parse_802_15_4(frame, frame_len - FCS_LEN, frame_len, &view) == DWT_SUCCESS) &&
+             (view.dst_pan_off == p->dst_pan_off) && (view.dst_addr_off == p->dst_addr_off) &&
+             (view.src_pan_off == p->src_pan_off) && (view.src_addr_off == p->src_addr_off) &&
+             (view.payload_off == p->payload_off) && (view.payload_len == PARSE_PAYLOAD_LEN);
+
+        printk("parse,%s,%02x%02x,%u,%u,%u,%u,%u,%s\n", p->name, p->fc0, p->fc1, view.dst_pan_off, view.dst_addr_off,
+               view.src_pan_off, view.src_addr_off, view.payload_off, ok ? "PASS" : "FAIL");
+        if (!ok) {
+            failed++;
+        }
+    }
+
+    printk("parse,summary,%d,%d\n", (int)(sizeof(frames) / sizeof(frames[0])), failed);
+
+#if defined(CONFIG_ARCH_POSIX)
+    posix_exit(failed ? 1 : 0);
+#endif
+    return failed ? 1 : 0;
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. Each line is "parse,frame,fc,dst_pan_off,dst_addr_off,src_pan_off,src_addr_off,payload_off,result": the frame control bytes, the offsets
+ *    found by the parser (0 for an absent PAN ID) and PASS or FAIL. The expected offsets follow the PAN ID Compression field rules: in frame
+ *    version 2 (802.15.4-2015 table 7-2) with both addresses present, the frame carries the destination PAN ID unless both addresses are
+ *    extended and the compression is set, and the source PAN ID only without the compression and extended addresses on both sides. E.g.
+ *    "41a8" (short addresses, compression) has the destination PAN ID at 3, the destination address at 5, the source address at 7 and the
+ *    payload at 9.
+ ****************************************************************************************************************************************************/
@@ -21,6 +21,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/device.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/drivers/spi.h>
 #include <zephyr/drivers/gpio.h>
 
@@ -28,21 +29,81 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(deca_spi);
 
-const struct device * spi;
-struct spi_config * spi_cfg;
-struct spi_config   spi_cfgs [4] = {0};
+/* spi_cfgs[] slots */
+#define SPI_CFG_SLOW   0
+#define SPI_CFG_FAST   1
+#define SPI_CFG_TRIAL  2
+#define SPI_CFGS_COUNT 4
 
-#define SPI_CFGS_COUNT ((sizeof(spi_cfgs)/sizeof(spi_cfgs[0])))
+#define SPI_SPEED_SLOW          2000000
+#define SPI_SPEED_FAST_DEFAULT  8000000
 
-uint8_t tx_buf [255];
-uint8_t rx_buf [255];
+/*
+ * One instance per "qorvo,dwm3000" devicetree node: own bus, chip select,
+ * speed slots, descriptors and async state, so two radios on separate
+ * buses never share transfer state.
+ */
+struct dw_spi_inst {
+    const struct device * spi;
+    struct spi_config   * spi_cfg;
+    struct spi_config     spi_cfgs [SPI_CFGS_COUNT];
+    struct spi_cs_control cs_ctrl;
+
+    /* Serialises transfers from several threads, see dw_spi_lock() */
+    struct k_mutex        lock;
+    struct k_thread     * holder;       /* thread holding the lock, NULL when free */
+    uint32_t              depth;        /* holder's lock nesting */
+
+    /* A transfer (synchronous or asynchronous) is on the bus, see dw_spi_busy() */
+    atomic_t              bus_busy;
+
+    /* Fast rate, raised by port_calibrate_dw_ic_spi_fastrate() */
+    uint32_t              spi_speed_fast;
 
-struct spi_buf bufs [2];
+    /*
+     * Scatter-gather descriptors: the header, body and CRC of each transfer
+     * are referenced in place, so no staging copy and no 255-byte limit.
+     * A NULL tx entry clocks out dummy bytes; a NULL rx entry discards the
+     * bytes clocked in while the header is being sent.
+     */
+    struct spi_buf        tx_bufs [3];
+    struct spi_buf        rx_bufs [2];
+    struct spi_buf_set    tx;
+    struct spi_buf_set    rx;
 
-struct spi_buf_set tx;
-struct spi_buf_set rx;
+#if defined(CONFIG_SPI_ASYNC)
+    /*
+     * Asynchronous transfers use their own descriptors; the header and
+     * CRC are copied here as the caller's copies live on its stack.
+     */
+    struct spi_buf        async_tx_bufs [3];
+    struct spi_buf        async_rx_bufs [2];
+    struct spi_buf_set    async_tx;
+    struct spi_buf_set    async_rx;
 
-static struct spi_cs_control cs_ctrl;
+    uint8_t               async_header [DECA_MAX_SPI_HEADER_LENGTH];
+    uint8_t               async_crc8;
+
+    dwt_spi_done_cb_t     async_cb;
+    void                * async_arg;
+#endif
+};
+
+/*
+ * With DWT_THREAD_SAFE each transfer holds the instance lock, as the
+ * descriptors and speed slot are shared by all callers of the instance.
+ */
+#if defined(DWT_THREAD_SAFE)
+#define DW_SPI_LOCK(dev)    dw_spi_lock(dev)
+#define DW_SPI_UNLOCK(dev)  dw_spi_unlock(dev)
+#else
+#define DW_SPI_LOCK(dev)
+#define DW_SPI_UNLOCK(dev)
+#endif
+
+/* Wait, from a thread, for the bus to be free: the transfer on it ends in
+ * the SPI ISR, or in a thread that must get to run */
+#define DW_SPI_BUS_WAIT_US      10
 
 /*
  *****************************************************************************
@@ -52,10 +113,79 @@ static struct spi_cs_control cs_ctrl;
  *****************************************************************************
  */
 
-#define DWM_SPI      DT_PARENT(DT_INST(0, qorvo_dwm3000))
-#define DWM_CS_GPIO  DT_PHANDLE_BY_IDX(DT_PARENT(DT_INST(0, qorvo_dwm3000)), cs_gpios, 0)
-#define DWM_CS_PIN   DT_PHA(DWM_SPI, cs_gpios, pin)
-#define DWM_CS_FLAGS DT_PHA(DWM_SPI, cs_gpios, flags)
+#define DT_DRV_COMPAT   qorvo_dwm3000
+
+#define DWM_INST_COUNT  DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT)
+
+BUILD_ASSERT(DWM_INST_COUNT <= DWT_NUM_DW_DEV,
+             "define DWT_NUM_DW_DEV to at least the number of qorvo,dwm3000 nodes");
+
+#if defined(CONFIG_SPI_ASYNC)
+#define DWM_SPI_ASYNC_INIT(n)                                   \
+    .async_tx = { .buffers = dw_spi_insts[n].async_tx_bufs },   \
+    .async_rx = { .buffers = dw_spi_insts[n].async_rx_bufs },
+#else
+#define DWM_SPI_ASYNC_INIT(n)
+#endif
+
+/* The CS is the parent bus cs-gpios entry selected by the node's reg */
+#define DWM_SPI_INST_INIT(n)                                    \
+    [n] = {                                                     \
+        .spi            = DEVICE_DT_GET(DT_INST_BUS(n)),        \
+        .cs_ctrl        = SPI_CS_CONTROL_INIT(DT_DRV_INST(n), 0), \
+        .spi_speed_fast = SPI_SPEED_FAST_DEFAULT,               \
+        .tx             = { .buffers = dw_spi_insts[n].tx_bufs }, \
+        .rx             = { .buffers = dw_spi_insts[n].rx_bufs }, \
+        DWM_SPI_ASYNC_INIT(n)                                   \
+    },
+
+static dw_spi_t dw_spi_insts [DWM_INST_COUNT] = {
+    DT_INST_FOREACH_STATUS_OKAY(DWM_SPI_INST_INIT)
+};
+
+/*
+ *****************************************************************************
+ *
+ *                              DW3000 instance section
+ *
+ *****************************************************************************
+ */
+
+/*
+ * Function: dw_spi_count()
+ *
+ * Number of DW3000 instances found in the devicetree.
+ */
+int dw_spi_count(void)
+{
+    return DWM_INST_COUNT;
+}
+
+/*
+ * Function: dw_spi_get()
+ *
+ * Handle of DW3000 instance inst, or NULL if out of range.
+ */
+dw_spi_t * dw_spi_get(int inst)
+{
+    if (inst < 0 || inst >= DWM_INST_COUNT)
+        return NULL;
+
+    return &dw_spi_insts[inst];
+}
+
+/*
+ * Function: dw_spi_cur()
+ *
+ * Handle used by the driver-facing functions below: the instance
+ * matching the driver's active local data (dwt_setlocaldataptr()).
+ */
+static dw_spi_t * dw_spi_cur(void)
+{
+    unsigned int inst = dwt_getlocaldataindex();
+
+    return &dw_spi_insts[(inst < DWM_INST_COUNT) ? inst : 0];
+}
 
 /*
  *****************************************************************************
@@ -65,71 +195,214 @@ static struct spi_cs_control cs_ctrl;
  *****************************************************************************
  */
 
+/*
+ * Function: dw_spi_open()
+ *
+ * Low level abstract function to open and initialise access to one SPI device.
+ * returns 0 for success, or -1 for error
+ */
+int dw_spi_open(dw_spi_t * dev)
+{
+    LOG_INF("%s bus %s", __func__, dev->spi->name);
+
+    if (!device_is_ready(dev->cs_ctrl.gpio.port)) {
+        LOG_ERR("%s: CS GPIO not ready.", __func__);
+        return -1;
+    }
+
+    if (!device_is_ready(dev->spi)) {
+        LOG_ERR("%s: SPI device not ready.", __func__);
+        return -1;
+    }
+
+    k_mutex_init(&dev->lock);
+
+    /* Propagate CS config into all spi_cfgs[] elements */
+    for (int i=0; i < SPI_CFGS_COUNT; i++) {
+        dev->spi_cfgs[i].cs = dev->cs_ctrl;
+    }
+
+    dw_spi_set_speed_slow(dev);
+
+    return 0;
+}
+
 /*
  * Function: openspi()
  *
  * Low level abstract function to open and initialise access to the SPI device.
+ * Opens every DW3000 instance in the devicetree.
  * returns 0 for success, or -1 for error
  */
 int openspi(void)
 {
-    LOG_INF("%s bus %s", __func__, DT_NODE_FULL_NAME(DWM_SPI));
+    for (int i=0; i < DWM_INST_COUNT; i++) {
+        if (dw_spi_open(&dw_spi_insts[i]) != 0) {
+            return -1;
+        }
+    }
 
-    /* Propagate CS config into all spi_cfgs[] elements */
-    cs_ctrl.gpio.port = device_get_binding(DT_NODE_FULL_NAME(DWM_CS_GPIO));
-    if (!cs_ctrl.gpio.port) {
-        LOG_ERR("%s: GPIO binding failed.", __func__);
-        return -1;
+    return 0;
+}
+
+/*
+ * Function: dw_spi_lock() / dw_spi_unlock()
+ *
+ * Take/release the instance lock. The lock is recursive (k_mutex), so a
+ * thread holding it may issue transfers. From an ISR these do nothing: an
+ * ISR cannot wait, it checks dw_spi_busy() instead.
+ */
+void dw_spi_lock(dw_spi_t * dev)
+{
+    if (!k_is_in_isr()) {
+        k_mutex_lock(&dev->lock, K_FOREVER);
+        dev->holder = k_current_get();
+        dev->depth++;
     }
-    cs_ctrl.gpio.pin = DWM_CS_PIN;
-    cs_ctrl.delay = 0U;
-    cs_ctrl.gpio.dt_flags = DWM_CS_FLAGS;
-    for (int i=0; i < SPI_CFGS_COUNT; i++) {
-        spi_cfgs[i].cs = cs_ctrl;
+}
+
+void dw_spi_unlock(dw_spi_t * dev)
+{
+    if (!k_is_in_isr()) {
+        if (--dev->depth == 0) {
+            dev->holder = NULL;
+        }
+        k_mutex_unlock(&dev->lock);
+    }
+}
+
+/*
+ * Function: dw_spi_busy()
+ *
+ * True while a thread holds the instance lock or a transfer is on the bus:
+ * a transfer started now from an ISR would interleave with it.
+ */
+bool dw_spi_busy(dw_spi_t * dev)
+{
+    return (dev->holder != NULL) || (atomic_get(&dev->bus_busy) != 0);
+}
+
+/*
+ * Function: dw_spi_bus_claim() / dw_spi_bus_release()
+ *
+ * Hold the bus for one synchronous transfer. A thread waits for the
+ * transfer in progress (an asynchronous one, or one of a thread this one
+ * preempted); an ISR cannot, and fails.
+ * returns 0 for success, or -1 if the bus is busy (ISR)
+ */
+static int dw_spi_bus_claim(dw_spi_t * dev)
+{
+    while (!atomic_cas(&dev->bus_busy, 0, 1)) {
+        if (k_is_in_isr()) {
+            return -1;
+        }
+        k_usleep(DW_SPI_BUS_WAIT_US);
     }
 
-    gpio_pin_set(cs_ctrl.gpio.port, DWM_CS_PIN, 1);
+    return 0;
+}
 
-    spi_cfg = &spi_cfgs[0];
+static void dw_spi_bus_release(dw_spi_t * dev)
+{
+    atomic_clear(&dev->bus_busy);
+}
 
-    spi = device_get_binding(DT_NODE_FULL_NAME(DWM_SPI));
-    if (!spi) {
-        LOG_ERR("%s: SPI binding failed.", __func__);
+/*
+ * Function: dw_spi_cs_assert() / dw_spi_cs_release()
+ *
+ * Hold CS asserted, without clocks, e.g. to wake the DW3000 from sleep: the
+ * instance lock and the bus are held from one to the other. From a thread.
+ * returns 0 for success, or -1 for error
+ */
+int dw_spi_cs_assert(dw_spi_t * dev)
+{
+    dw_spi_lock(dev);
+    if (dw_spi_bus_claim(dev) != 0) {
+        dw_spi_unlock(dev);
+        return -1;
+    }
+    if (gpio_pin_set_dt(&dev->cs_ctrl.gpio, 1) != 0) {
+        dw_spi_bus_release(dev);
+        dw_spi_unlock(dev);
         return -1;
     }
-    spi_cfg->operation = SPI_WORD_SET(8);
-    spi_cfg->frequency = 2000000;
-
-    memset(&tx_buf[0], 0, 255);
-    memset(&rx_buf[0], 0, 255);
-    bufs[0].buf = &tx_buf[0];
-    bufs[1].buf = &rx_buf[0];
-    tx.buffers = &bufs[0];
-    rx.buffers = &bufs[1];
-    tx.count = 1;
-    rx.count = 1;
 
     return 0;
 }
 
-void set_spi_speed_slow(void)
+void dw_spi_cs_release(dw_spi_t * dev)
 {
-    spi_cfg = &spi_cfgs[0];
-    spi_cfg->operation = SPI_WORD_SET(8);  // SPI mode(0,0)
-    spi_cfg->frequency = 2000000;
+    gpio_pin_set_dt(&dev->cs_ctrl.gpio, 0);
+    dw_spi_bus_release(dev);
+    dw_spi_unlock(dev);
+}
 
-    memset(&tx_buf[0], 0, 255);
-    memset(&rx_buf[0], 0, 255);
+void dw_spi_set_speed_slow(dw_spi_t * dev)
+{
+    dev->spi_cfg = &dev->spi_cfgs[SPI_CFG_SLOW];
+    dev->spi_cfg->operation = SPI_WORD_SET(8);  // SPI mode(0,0)
+    dev->spi_cfg->frequency = SPI_SPEED_SLOW;
+}
+
+void dw_spi_set_speed_fast(dw_spi_t * dev)
+{
+    dev->spi_cfg = &dev->spi_cfgs[SPI_CFG_FAST];
+    dev->spi_cfg->operation = SPI_WORD_SET(8);  // SPI mode(0,0)
+    dev->spi_cfg->frequency = dev->spi_speed_fast;
+}
+
+/*
+ * Function: dw_spi_set_speed_trial()
+ *
+ * Select an arbitrary SPI frequency, in the spare trial slot of spi_cfgs[],
+ * without changing the cached slow/fast rates.
+ */
+void dw_spi_set_speed_trial(dw_spi_t * dev, uint32_t frequency)
+{
+    dev->spi_cfg = &dev->spi_cfgs[SPI_CFG_TRIAL];
+    dev->spi_cfg->operation = SPI_WORD_SET(8);  // SPI mode(0,0)
+    dev->spi_cfg->frequency = frequency;
+}
+
+/*
+ * Function: dw_spi_set_speed_fast_freq()
+ *
+ * Cache the frequency used by dw_spi_set_speed_fast().
+ */
+void dw_spi_set_speed_fast_freq(dw_spi_t * dev, uint32_t frequency)
+{
+    dev->spi_speed_fast = frequency;
+    dev->spi_cfgs[SPI_CFG_FAST].frequency = frequency;
+}
+
+uint32_t dw_spi_get_speed_fast_freq(dw_spi_t * dev)
+{
+    return dev->spi_speed_fast;
+}
+
+void set_spi_speed_slow(void)
+{
+    dw_spi_set_speed_slow(dw_spi_cur());
 }
 
 void set_spi_speed_fast(void)
 {
-    spi_cfg = &spi_cfgs[1];
-    spi_cfg->operation = SPI_WORD_SET(8);  // SPI mode(0,0)
-    spi_cfg->frequency = 8000000;
+    dw_spi_set_speed_fast(dw_spi_cur());
+}
+
+void set_spi_speed_trial(uint32_t frequency)
+{
+    dw_spi_set_speed_trial(dw_spi_cur(), frequency);
+}
 
-    memset(&tx_buf[0], 0, 255);
-    memset(&rx_buf[0], 0, 255);
+void set_spi_speed_fast_freq(uint32_t frequency)
+{
+    dw_spi_set_speed_fast_freq(dw_spi_cur(), frequency);
+}
+
+uint32_t get_spi_speed_fast_freq(void)
+{
+    return dw_spi_get_speed_fast_freq(dw_spi_cur());
 }
 
 /*
@@ -145,84 +418,165 @@ int closespi(void)
 }
 
 /*
- * Function: writetospiwithcrc()
+ * Function: dw_spi_write_crc()
  *
  * Low level abstract function to write to the SPI
  * Takes two separate byte buffers for write header and write data
- * returns 0 for success
+ * returns 0 for success, or -1 for error
  */
-int writetospiwithcrc(uint16_t           headerLength,
-                      const    uint8_t * headerBuffer,
-                      uint16_t           bodyLength,
-                      const    uint8_t * bodyBuffer,
-                      uint8_t            crc8)
+int dw_spi_write_crc(dw_spi_t         * dev,
+                     uint16_t           headerLength,
+                     const    uint8_t * headerBuffer,
+                     uint16_t           bodyLength,
+                     const    uint8_t * bodyBuffer,
+                     uint8_t            crc8)
 {
-    uint16_t len =  headerLength + bodyLength + sizeof(crc8);
+    int ret;
 
-    if (len > sizeof(tx_buf))
+    DW_SPI_LOCK(dev);
+    if (dw_spi_bus_claim(dev) != 0) {
+        DW_SPI_UNLOCK(dev);
         return -1;
+    }
 
-    memcpy(&tx_buf[0],            headerBuffer, headerLength);
-    memcpy(&tx_buf[headerLength], bodyBuffer,   bodyLength);
-
-    tx_buf[headerLength + bodyLength] = crc8;
+    dev->tx_bufs[0].buf = (void *) headerBuffer;
+    dev->tx_bufs[0].len = headerLength;
+    dev->tx_bufs[1].buf = (void *) bodyBuffer;
+    dev->tx_bufs[1].len = bodyLength;
+    dev->tx_bufs[2].buf = &crc8;
+    dev->tx_bufs[2].len = sizeof(crc8);
+    dev->tx.count = 3;
 
-    bufs[0].len = len;
-    bufs[1].len = len;
+    DWT_PROBE_START(DWT_PROBE_SPI);
+    ret = spi_write(dev->spi, dev->spi_cfg, &dev->tx);
+    DWT_PROBE_STOP(DWT_PROBE_SPI);
 
-    spi_transceive(spi, spi_cfg, &tx, &rx);
+    dw_spi_bus_release(dev);
+    DW_SPI_UNLOCK(dev);
 
-    return 0;
+    return (ret != 0) ? -1 : 0;
 }
 
 /*
- * Function: writetospi()
+ * Function: dw_spi_write()
  *
  * Low level abstract function to write to the SPI
  * Takes two separate byte buffers for write header and write data
- * returns 0 for success
+ * returns 0 for success, or -1 for error
  */
-int writetospi(uint16_t           headerLength,
-               const    uint8_t * headerBuffer,
-               uint16_t           bodyLength,
-               const    uint8_t * bodyBuffer)
+int dw_spi_write(dw_spi_t         * dev,
+                 uint16_t           headerLength,
+                 const    uint8_t * headerBuffer,
+                 uint16_t           bodyLength,
+                 const    uint8_t * bodyBuffer)
 {
+    int ret;
+
 #if 0
     LOG_HEXDUMP_INF(headerBuffer, headerLength, "writetospi: Header");
     LOG_HEXDUMP_INF(bodyBuffer, bodyLength, "writetospi: Body");
 #endif
 
-    memcpy(&tx_buf[0], headerBuffer, headerLength);
-    memcpy(&tx_buf[headerLength], bodyBuffer, bodyLength);
+    DW_SPI_LOCK(dev);
+    if (dw_spi_bus_claim(dev) != 0) {
+        DW_SPI_UNLOCK(dev);
+        return -1;
+    }
 
-    bufs[0].len = headerLength + bodyLength;
-    bufs[1].len = headerLength + bodyLength;
+    dev->tx_bufs[0].buf = (void *) headerBuffer;
+    dev->tx_bufs[0].len = headerLength;
+    dev->tx_bufs[1].buf = (void *) bodyBuffer;
+    dev->tx_bufs[1].len = bodyLength;
+    dev->tx.count = 2;
 
-    spi_transceive(spi, spi_cfg, &tx, &rx);
+    DWT_PROBE_START(DWT_PROBE_SPI);
+    ret = spi_write(dev->spi, dev->spi_cfg, &dev->tx);
+    DWT_PROBE_STOP(DWT_PROBE_SPI);
 
-    return 0;
+    dw_spi_bus_release(dev);
+    DW_SPI_UNLOCK(dev);
+
+    return (ret != 0) ? -1 : 0;
+}
+
+/*
+ * Function: dw_spi_write_batch()
+ *
+ * Low level abstract function to write a batch of complete transactions
+ * to the SPI, back to back: one chip select per transaction.
+ * returns 0 for success, or -1 for error
+ */
+int dw_spi_write_batch(dw_spi_t        * dev,
+                       uint16_t          count,
+                       const uint16_t  * lengths,
+                       const    uint8_t * buffer)
+{
+    int ret = 0;
+
+    DW_SPI_LOCK(dev);
+    if (dw_spi_bus_claim(dev) != 0) {
+        DW_SPI_UNLOCK(dev);
+        return -1;
+    }
+
+    dev->tx.count = 1;
+
+    for (int i = 0; i < count; i++) {
+
+        dev->tx_bufs[0].buf = (void *) buffer;
+        dev->tx_bufs[0].len = lengths[i];
+
+        if (spi_write(dev->spi, dev->spi_cfg, &dev->tx) != 0) {
+            ret = -1;
+        }
+        buffer += lengths[i];
+    }
+
+    dw_spi_bus_release(dev);
+    DW_SPI_UNLOCK(dev);
+
+    return ret;
 }
 
 /*
- * Function: readfromspi()
+ * Function: dw_spi_read()
  *
  * Low level abstract function to read from the SPI
  * Takes two separate byte buffers for write header and read data
- * returns the offset into read buffer where first byte of read data
- * may be found, or returns 0
+ * The read data is received directly into readBuffer.
+ * returns 0 for success, or -1 for error
  */
-int readfromspi(uint16_t        headerLength,
+int dw_spi_read(dw_spi_t      * dev,
+                uint16_t        headerLength,
                 const uint8_t * headerBuffer,
                 uint16_t        readLength,
                 uint8_t       * readBuffer)
 {
-    memset(&tx_buf[0], 0, headerLength + readLength);
-    memcpy(&tx_buf[0], headerBuffer, headerLength);
+    int ret;
 
-    bufs[0].len = headerLength + readLength;
-    bufs[1].len = headerLength + readLength;
+    DW_SPI_LOCK(dev);
+    if (dw_spi_bus_claim(dev) != 0) {
+        DW_SPI_UNLOCK(dev);
+        return -1;
+    }
+
+    /* TX: header, then dummy bytes while the data is clocked in */
+    dev->tx_bufs[0].buf = (void *) headerBuffer;
+    dev->tx_bufs[0].len = headerLength;
+    dev->tx_bufs[1].buf = NULL;
+    dev->tx_bufs[1].len = readLength;
+    dev->tx.count = 2;
 
-    spi_transceive(spi, spi_cfg, &tx, &rx);
+    /* RX: discard the bytes received during the header */
+    dev->rx_bufs[0].buf = NULL;
+    dev->rx_bufs[0].len = headerLength;
+    dev->rx_bufs[1].buf = readBuffer;
+    dev->rx_bufs[1].len = readLength;
+    dev->rx.count = 2;
+
+    DWT_PROBE_START(DWT_PROBE_SPI);
+    ret = spi_transceive(dev->spi, dev->spi_cfg, &dev->tx, &dev->rx);
+    DWT_PROBE_STOP(DWT_PROBE_SPI);
 
 #if (CONFIG_SOC_NRF52840_QIAA)
     /*
@@ -234,12 +588,243 @@ int readfromspi(uint16_t        headerLength,
     for (volatile int i=0; i < TX_WAIT_RESP_NRF52840_DELAY; i++) { /* spin */ }
 #endif
 
-    memcpy(readBuffer, rx_buf + headerLength, readLength);
-
 #if 0
     LOG_HEXDUMP_INF(headerBuffer, headerLength, "readfromspi: Header");
     LOG_HEXDUMP_INF(readBuffer, readLength, "readfromspi: Body");
 #endif
 
+    dw_spi_bus_release(dev);
+    DW_SPI_UNLOCK(dev);
+
+    return (ret != 0) ? -1 : 0;
+}
+
+/*
+ * Functions: writetospiwithcrc(), writetospi(), writetospi_batch(), readfromspi()
+ *
+ * The driver's platform interface: as above, on the instance selected by
+ * dwt_setlocaldataptr().
+ */
+int writetospiwithcrc(uint16_t           headerLength,
+                      const    uint8_t * headerBuffer,
+                      uint16_t           bodyLength,
+                      const    uint8_t * bodyBuffer,
+                      uint8_t            crc8)
+{
+    return dw_spi_write_crc(dw_spi_cur(), headerLength, headerBuffer,
+                            bodyLength, bodyBuffer, crc8);
+}
+
+int writetospi(uint16_t           headerLength,
+               const    uint8_t * headerBuffer,
+               uint16_t           bodyLength,
+               const    uint8_t * bodyBuffer)
+{
+    return dw_spi_write(dw_spi_cur(), headerLength, headerBuffer,
+                        bodyLength, bodyBuffer);
+}
+
+int writetospi_batch(uint16_t          count,
+                     const uint16_t  * lengths,
+                     const    uint8_t * buffer)
+{
+    return dw_spi_write_batch(dw_spi_cur(), count, lengths, buffer);
+}
+
+int readfromspi(uint16_t        headerLength,
+                const uint8_t * headerBuffer,
+                uint16_t        readLength,
+                uint8_t       * readBuffer)
+{
+    return dw_spi_read(dw_spi_cur(), headerLength, headerBuffer,
+                       readLength, readBuffer);
+}
+
+/*
+ *****************************************************************************
+ *
+ *                              DW3000 async SPI section
+ *
+ *****************************************************************************
+ */
+
+#if defined(CONFIG_SPI_ASYNC)
+
+/*
+ * Function: spi_async_done()
+ *
+ * SPI driver completion callback, called from interrupt context.
+ */
+static void spi_async_done(const struct device * spi, int result, void * data)
+{
+    dw_spi_t          * dev = data;
+    dwt_spi_done_cb_t   cb  = dev->async_cb;
+    void              * arg = dev->async_arg;
+
+    ARG_UNUSED(spi);
+
+    dw_spi_bus_release(dev);
+
+    if (cb) {
+        cb((result == 0) ? 0 : -1, arg);
+    }
+}
+
+/*
+ * Function: spi_async_claim()
+ *
+ * Claim the bus and the async descriptors before they are filled in. An
+ * asynchronous transfer does not wait: it backs off while another thread
+ * holds the instance lock (or any thread, from an ISR) or a transfer is
+ * on the bus, and the caller tries again later.
+ * returns 0 for success, or -1 if the instance or the bus is busy
+ */
+static int spi_async_claim(dw_spi_t * dev, uint16_t headerLength)
+{
+    struct k_thread * holder = dev->holder;
+
+    if (headerLength > sizeof(dev->async_header))
+        return -1;
+
+    if ((holder != NULL) && (k_is_in_isr() || (holder != k_current_get())))
+        return -1;
+
+    if (!atomic_cas(&dev->bus_busy, 0, 1))
+        return -1;
+
     return 0;
 }
+
+/*
+ * Function: spi_async_start()
+ *
+ * Start the transfer described by the (claimed) async descriptors.
+ * returns 0 for success, or -1 for error
+ */
+static int spi_async_start(dw_spi_t        * dev,
+                           uint16_t          headerLength,
+                           const uint8_t   * headerBuffer,
+                           bool              read,
+                           dwt_spi_done_cb_t cb,
+                           void            * arg)
+{
+    memcpy(dev->async_header, headerBuffer, headerLength);
+    dev->async_tx_bufs[0].buf = dev->async_header;
+    dev->async_tx_bufs[0].len = headerLength;
+
+    dev->async_cb  = cb;
+    dev->async_arg = arg;
+
+    if (spi_transceive_cb(dev->spi, dev->spi_cfg, &dev->async_tx,
+                          read ? &dev->async_rx : NULL,
+                          spi_async_done, dev) != 0) {
+        dw_spi_bus_release(dev);
+        return -1;
+    }
+
+    return 0;
+}
+
+#endif
+
+/*
+ * Function: writetospiwithcrc_async()
+ *
+ * Low level abstract function to start an asynchronous write to the SPI
+ * Takes two separate byte buffers for write header and write data
+ * returns 0 for success, or -1 for error
+ */
+int writetospiwithcrc_async(uint16_t           headerLength,
+                            const    uint8_t * headerBuffer,
+                            uint16_t           bodyLength,
+                            const    uint8_t * bodyBuffer,
+                            uint8_t            crc8,
+                            dwt_spi_done_cb_t  cb,
+                            void             * arg)
+{
+#if defined(CONFIG_SPI_ASYNC)
+    dw_spi_t * dev = dw_spi_cur();
+
+    if (spi_async_claim(dev, headerLength) != 0)
+        return -1;
+
+    dev->async_crc8 = crc8;
+
+    dev->async_tx_bufs[1].buf = (void *) bodyBuffer;
+    dev->async_tx_bufs[1].len = bodyLength;
+    dev->async_tx_bufs[2].buf = &dev->async_crc8;
+    dev->async_tx_bufs[2].len = sizeof(dev->async_crc8);
+    dev->async_tx.count = 3;
+
+    return spi_async_start(dev, headerLength, headerBuffer, false, cb, arg);
+#else
+    return -1;
+#endif
+}
+
+/*
+ * Function: writetospi_async()
+ *
+ * Low level abstract function to start an asynchronous write to the SPI
+ * Takes two separate byte buffers for write header and write data
+ * returns 0 for success, or -1 for error
+ */
+int writetospi_async(uint16_t           headerLength,
+                     const    uint8_t * headerBuffer,
+                     uint16_t           bodyLength,
+                     const    uint8_t * bodyBuffer,
+                     dwt_spi_done_cb_t  cb,
+                     void             * arg)
+{
+#if defined(CONFIG_SPI_ASYNC)
+    dw_spi_t * dev = dw_spi_cur();
+
+    if (spi_async_claim(dev, headerLength) != 0)
+        return -1;
+
+    dev->async_tx_bufs[1].buf = (void *) bodyBuffer;
+    dev->async_tx_bufs[1].len = bodyLength;
+    dev->async_tx.count = 2;
+
+    return spi_async_start(dev, headerLength, headerBuffer, false, cb, arg);
+#else
+    return -1;
+#endif
+}
+
+/*
+ * Function: readfromspi_async()
+ *
+ * Low level abstract function to start an asynchronous read from the SPI
+ * Takes two separate byte buffers for write header and read data
+ * The read data is received directly into readBuffer.
+ * returns 0 for success, or -1 for error
+ */
+int readfromspi_async(uint16_t          headerLength,
+                      const uint8_t   * headerBuffer,
+                      uint16_t          readLength,
+                      uint8_t         * readBuffer,
+                      dwt_spi_done_cb_t cb,
+                      void            * arg)
+{
+#if defined(CONFIG_SPI_ASYNC)
+    dw_spi_t * dev = dw_spi_cur();
+
+    if (spi_async_claim(dev, headerLength) != 0)
+        return -1;
+
+    dev->async_tx_bufs[1].buf = NULL;
+    dev->async_tx_bufs[1].len = readLength;
+    dev->async_tx.count = 2;
+
+    dev->async_rx_bufs[0].buf = NULL;
+    dev->async_rx_bufs[0].len = headerLength;
+    dev->async_rx_bufs[1].buf = readBuffer;
+    dev->async_rx_bufs[1].len = readLength;
+    dev->async_rx.count = 2;
+
+    return spi_async_start(dev, headerLength, headerBuffer, true, cb, arg);
+#else
+    return -1;
+#endif
+}
@@ -18,6 +18,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include "deca_types.h"
 
 #define DECA_MAX_SPI_HEADER_LENGTH      (3)                     // max number of bytes in header (for formating & sizing)
@@ -41,6 +42,63 @@ int closespi(void) ;
 void set_spi_speed_slow();
 void set_spi_speed_fast();
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: set_spi_speed_trial()
+ *
+ * Select an arbitrary SPI frequency (Hz), used while calibrating the fast rate.
+ */
+void set_spi_speed_trial(uint32_t frequency);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: set_spi_speed_fast_freq() / get_spi_speed_fast_freq()
+ *
+ * Set/get the frequency (Hz) cached for set_spi_speed_fast(), 8MHz by default.
+ */
+void set_spi_speed_fast_freq(uint32_t frequency);
+uint32_t get_spi_speed_fast_freq(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * DW3000 instance handles
+ *
+ * One handle per "qorvo,dwm3000" devicetree node, in instance order, each with its own
+ * SPI bus, chip select (the parent's cs-gpios entry given by reg) and speed settings.
+ * The functions above act on the instance selected with dwt_setlocaldataptr(), see
+ * port_select_dw_ic(); the dw_spi_*() functions below act on an explicit handle.
+ * Build with DWT_NUM_DW_DEV set to at least the number of instances.
+ */
+typedef struct dw_spi_inst dw_spi_t;
+
+int        dw_spi_count(void);
+dw_spi_t * dw_spi_get(int inst);
+int        dw_spi_open(dw_spi_t * dev);
+
+/* Recursive instance lock. With DWT_THREAD_SAFE each dw_spi_*() transfer takes it. */
+void       dw_spi_lock(dw_spi_t * dev);
+void       dw_spi_unlock(dw_spi_t * dev);
+
+/* True while a thread holds the instance lock or a transfer is on the bus. A transfer
+ * from an ISR then fails, as do asynchronous transfers (*_async()), which never wait. */
+bool       dw_spi_busy(dw_spi_t * dev);
+
+/* CS held asserted without clocks (wake up from sleep), instance lock and bus held in between */
+int        dw_spi_cs_assert(dw_spi_t * dev);
+void       dw_spi_cs_release(dw_spi_t * dev);
+
+void     dw_spi_set_speed_slow(dw_spi_t * dev);
+void     dw_spi_set_speed_fast(dw_spi_t * dev);
+void     dw_spi_set_speed_trial(dw_spi_t * dev, uint32_t frequency);
+void     dw_spi_set_speed_fast_freq(dw_spi_t * dev, uint32_t frequency);
+uint32_t dw_spi_get_speed_fast_freq(dw_spi_t * dev);
+
+int dw_spi_write(dw_spi_t * dev, uint16_t headerLength, const uint8_t * headerBuffer,
+                 uint16_t bodyLength, const uint8_t * bodyBuffer);
+int dw_spi_write_crc(dw_spi_t * dev, uint16_t headerLength, const uint8_t * headerBuffer,
+                     uint16_t bodyLength, const uint8_t * bodyBuffer, uint8_t crc8);
+int dw_spi_write_batch(dw_spi_t * dev, uint16_t count, const uint16_t * lengths,
+                       const uint8_t * buffer);
+int dw_spi_read(dw_spi_t * dev, uint16_t headerLength, const uint8_t * headerBuffer,
+                uint16_t readLength, uint8_t * readBuffer);
+
 #ifdef __cplusplus
 }
 #endif
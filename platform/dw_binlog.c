@@ -0,0 +1,251 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_binlog.c
+ * @brief   Binary result log: fixed-size records in a ring, drained by a thread
+ *
+ *          See dw_binlog.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "dw_binlog.h"
+
+#include <zephyr/kernel.h>
+
+#ifndef DW_BINLOG_THREAD_PRIO
+#define DW_BINLOG_THREAD_PRIO       K_LOWEST_APPLICATION_THREAD_PRIO
+#endif
+#ifndef DW_BINLOG_THREAD_STACK_SIZE
+#define DW_BINLOG_THREAD_STACK_SIZE 512
+#endif
+
+#define BINLOG_RING_MASK    (DW_BINLOG_RING_LEN - 1)
+
+#if (DW_BINLOG_RING_LEN & BINLOG_RING_MASK) != 0
+#error "DW_BINLOG_RING_LEN must be a power of 2"
+#endif
+
+static K_THREAD_STACK_DEFINE(binlog_stack, DW_BINLOG_THREAD_STACK_SIZE);
+
+static struct
+{
+    dw_binlog_write_t   write;
+    uint8_t             started;
+    uint16_t            seq;
+    volatile uint32_t   head;           /* write index, free running (dw_binlog_put() under irq_lock) */
+    volatile uint32_t   tail;           /* read index, free running (drain thread only) */
+    uint8_t             ring[DW_BINLOG_RING_LEN];
+    dw_binlog_stats_t   stats;
+    struct k_sem        sem;
+    struct k_thread     thread;
+} binlog;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn binlog_copy()
+ *
+ * @brief Copy bytes into the ring at a free running index, wrapping at the end.
+ *
+ * @param idx - ring index
+ * @param data - bytes
+ * @param len - number of bytes
+ *
+ * @return none
+ */
+static void binlog_copy(uint32_t idx, const uint8_t *data, uint16_t len)
+{
+    uint16_t off = (uint16_t)(idx & BINLOG_RING_MASK);
+    uint16_t first = (len < DW_BINLOG_RING_LEN - off) ? len : (uint16_t)(DW_BINLOG_RING_LEN - off);
+
+    memcpy(&binlog.ring[off], data, first);
+    memcpy(&binlog.ring[0], data + first, len - first);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn binlog_drain()
+ *
+ * @brief Hand the ring content to the transport until it is empty or the transport is full.
+ *
+ * @return none
+ */
+static void binlog_drain(void)
+{
+    uint32_t head;
+    uint32_t tail;
+    uint16_t off;
+    uint16_t len;
+    int n;
+
+    while ((tail = binlog.tail) != (head = binlog.head))
+    {
+        off = (uint16_t)(tail & BINLOG_RING_MASK);
+        len = (uint16_t)(head - tail);
+        if (len > DW_BINLOG_RING_LEN - off)
+        {
+            len = (uint16_t)(DW_BINLOG_RING_LEN - off);
+        }
+
+        n = binlog.write(&binlog.ring[off], len);
+        if (n < 0)
+        {
+            /* What is pending is lost, the host sees the gap in the sequence numbers */
+            binlog.stats.errors++;
+            binlog.tail = head;
+            return;
+        }
+
+        binlog.tail = tail + (uint32_t)n;
+        binlog.stats.bytes += (uint32_t)n;
+        if (n < len)
+        {
+            /* Transport full, retried at the next period */
+            binlog.stats.stalls++;
+            return;
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn binlog_thread()
+ *
+ * @brief Drain thread: drains when the ring goes from empty to non-empty, and every DW_BINLOG_FLUSH_MS.
+ *
+ * @return none
+ */
+static void binlog_thread(void *p1, void *p2, void *p3)
+{
+    (void)p1;
+    (void)p2;
+    (void)p3;
+
+    while (1)
+    {
+        k_sem_take(&binlog.sem, K_MSEC(DW_BINLOG_FLUSH_MS));
+        binlog_drain();
+    }
+}
+
+int dw_binlog_init(dw_binlog_write_t write)
+{
+    unsigned int key;
+
+    if (write == NULL)
+    {
+        return DWT_ERROR;
+    }
+
+    key = irq_lock();
+    binlog.write = write;
+    binlog.seq = 0;
+    binlog.head = 0;
+    binlog.tail = 0;
+    memset(&binlog.stats, 0, sizeof(binlog.stats));
+    irq_unlock(key);
+
+    if (!binlog.started)
+    {
+        binlog.started = 1;
+        k_sem_init(&binlog.sem, 0, 1);
+        k_thread_create(&binlog.thread, binlog_stack, K_THREAD_STACK_SIZEOF(binlog_stack),
+                        binlog_thread, NULL, NULL, NULL, DW_BINLOG_THREAD_PRIO, 0, K_NO_WAIT);
+    }
+
+    return DWT_SUCCESS;
+}
+
+int dw_binlog_put(uint8_t type, const void *payload, uint8_t len)
+{
+    uint8_t hdr[DW_BINLOG_HDR_LEN];
+    uint32_t now = k_uptime_get_32();
+    uint32_t fill;
+    uint32_t head;
+    unsigned int key;
+
+    hdr[0] = DW_BINLOG_SYNC;
+    hdr[1] = type;
+    hdr[4] = (uint8_t)now;
+    hdr[5] = (uint8_t)(now >> 8);
+    hdr[6] = (uint8_t)(now >> 16);
+    hdr[7] = (uint8_t)(now >> 24);
+
+    key = irq_lock();
+    hdr[2] = (uint8_t)binlog.seq;
+    hdr[3] = (uint8_t)(binlog.seq >> 8);
+    binlog.seq++;
+
+    head = binlog.head;
+    fill = head - binlog.tail;
+    if ((binlog.write == NULL) || (fill + DW_BINLOG_HDR_LEN + len > DW_BINLOG_RING_LEN))
+    {
+        binlog.stats.dropped++;
+        irq_unlock(key);
+        return DWT_ERROR;
+    }
+
+    binlog_copy(head, hdr, DW_BINLOG_HDR_LEN);
+    binlog_copy(head + DW_BINLOG_HDR_LEN, (const uint8_t *)payload, len);
+    binlog.head = head + DW_BINLOG_HDR_LEN + len;
+
+    fill += DW_BINLOG_HDR_LEN + len;
+    if (fill > binlog.stats.max_fill)
+    {
+        binlog.stats.max_fill = (uint16_t)fill;
+    }
+    binlog.stats.records++;
+    irq_unlock(key);
+
+    /* The thread drains the ring to the end: wake it only when there was nothing to drain */
+    if (fill == DW_BINLOG_HDR_LEN + len)
+    {
+        k_sem_give(&binlog.sem);
+    }
+
+    return DWT_SUCCESS;
+}
+
+int dw_binlog_range(uint16_t peer, int16_t clock_offset, int32_t dist_mm, int32_t tof)
+{
+    dw_binlog_range_t rec;
+
+    rec.peer = peer;
+    rec.clock_offset = clock_offset;
+    rec.dist_mm = dist_mm;
+    rec.tof = tof;
+
+    return dw_binlog_put(DW_BINLOG_RANGE, &rec, DW_BINLOG_RANGE_LEN);
+}
+
+int dw_binlog_diag(const dwt_rxdiag_t *diag)
+{
+    dw_binlog_diag_t rec;
+
+    rec.fp_index = diag->ipatovFpIndex;
+    rec.accum_count = diag->ipatovAccumCount;
+    rec.peak = diag->ipatovPeak;
+    rec.power = diag->ipatovPower;
+    rec.f1 = diag->ipatovF1;
+    rec.f2 = diag->ipatovF2;
+    rec.f3 = diag->ipatovF3;
+
+    return dw_binlog_put(DW_BINLOG_DIAG, &rec, DW_BINLOG_DIAG_LEN);
+}
+
+int dw_binlog_timing(uint16_t id, uint16_t arg, uint32_t us)
+{
+    dw_binlog_timing_t rec;
+
+    rec.id = id;
+    rec.arg = arg;
+    rec.us = us;
+
+    return dw_binlog_put(DW_BINLOG_TIMING, &rec, DW_BINLOG_TIMING_LEN);
+}
+
+const dw_binlog_stats_t * dw_binlog_get_stats(void)
+{
+    return &binlog.stats;
+}
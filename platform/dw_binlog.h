@@ -0,0 +1,178 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_binlog.h
+ * @brief   Binary result log: fixed-size records in a ring, drained by a thread
+ *
+ *          Range, RX diagnostic and timing results are written as fixed-size
+ *          little endian records instead of formatted LOG_INF()/printk()
+ *          strings. Writing a record copies it into a RAM ring (a few tens of
+ *          bytes, under irq_lock(), callable from the DW IC callbacks) and
+ *          never blocks: when the ring is full the record is dropped. A low
+ *          priority thread drains the ring through a transport callback (RTT
+ *          up channel in NO_BLOCK mode, UART), so the transport only runs
+ *          when the ranging code sleeps or waits.
+ *
+ *          record  0xA5 type seq(2) time_ms(4) payload
+ *
+ *          seq counts every record written, dropped ones included: a gap in
+ *          the sequence numbers at the host is the number of records lost.
+ *          The payload length is fixed by the type (DW_BINLOG_*_LEN). The
+ *          values are raw (time of flight in 1/16 DTU, clock offset as read,
+ *          diagnostic registers): the host converts them, see
+ *          tools/binlog_decode.py.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef DW_BINLOG_H_
+#define DW_BINLOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "deca_device_api.h"
+
+#ifndef DW_BINLOG_RING_LEN
+#define DW_BINLOG_RING_LEN      2048        /* bytes, power of 2 */
+#endif
+#ifndef DW_BINLOG_FLUSH_MS
+#define DW_BINLOG_FLUSH_MS      100         /* drain period when the ring does not go from empty to non-empty */
+#endif
+
+#define DW_BINLOG_SYNC          0xA5
+#define DW_BINLOG_HDR_LEN       8
+
+/* Record types */
+#define DW_BINLOG_RANGE         1
+#define DW_BINLOG_DIAG          2
+#define DW_BINLOG_TIMING        3
+#define DW_BINLOG_POSITION      6           /* multilat_fix_pack(), MULTILAT_RECORD_LEN (same type as the uplink) */
+
+/* Range result */
+typedef struct __attribute__((packed))
+{
+    uint16_t    peer;           /* responder or initiator address */
+    int16_t     clock_offset;   /* dwt_readclockoffset() of the exchange (2^-26 units), 0 if not used */
+    int32_t     dist_mm;
+    int32_t     tof;            /* 1/16 DTU, see ranging_math.h */
+} dw_binlog_range_t;
+
+/* RX diagnostics of a frame, dwt_readdiagnostics_sel() DW_BINLOG_DIAG_FIELDS */
+typedef struct __attribute__((packed))
+{
+    uint16_t    fp_index;       /* ipatovFpIndex, 10.6 fixed point */
+    uint16_t    accum_count;    /* ipatovAccumCount */
+    uint32_t    peak;           /* ipatovPeak */
+    uint32_t    power;          /* ipatovPower */
+    uint32_t    f1;             /* ipatovF1 */
+    uint32_t    f2;             /* ipatovF2 */
+    uint32_t    f3;             /* ipatovF3 */
+} dw_binlog_diag_t;
+
+#define DW_BINLOG_DIAG_FIELDS   (DWT_DIAG_IP_FP | DWT_DIAG_IP_ACCUM | DWT_DIAG_IP_PEAK | DWT_DIAG_IP_POWER | DWT_DIAG_IP_F)
+
+/* Timing of a section of the application (ids are the application's) */
+typedef struct __attribute__((packed))
+{
+    uint16_t    id;
+    uint16_t    arg;
+    uint32_t    us;
+} dw_binlog_timing_t;
+
+#define DW_BINLOG_RANGE_LEN     sizeof(dw_binlog_range_t)
+#define DW_BINLOG_DIAG_LEN      sizeof(dw_binlog_diag_t)
+#define DW_BINLOG_TIMING_LEN    sizeof(dw_binlog_timing_t)
+
+/* Transport: take up to len bytes, return the number taken (0 if none fits now), negative on error */
+typedef int (*dw_binlog_write_t)(const uint8_t *data, uint16_t len);
+
+typedef struct
+{
+    uint32_t    records;        /* records put in the ring */
+    uint32_t    dropped;        /* records dropped, ring full */
+    uint32_t    bytes;          /* bytes taken by the transport */
+    uint32_t    stalls;         /* drains where the transport took less than offered */
+    uint32_t    errors;         /* transport errors */
+    uint16_t    max_fill;       /* highest ring fill, bytes */
+} dw_binlog_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_binlog_init()
+ *
+ * @brief Set the transport, clear the ring and the counters, and start the drain thread (first call only).
+ *
+ * @param write - transport
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR without transport
+ */
+int dw_binlog_init(dw_binlog_write_t write);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_binlog_put()
+ *
+ * @brief Put a record in the ring. Does not block, can be called from interrupt context.
+ *
+ * @param type - record type
+ * @param payload - payload
+ * @param len - payload length, the one of the type
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the record was dropped
+ */
+int dw_binlog_put(uint8_t type, const void *payload, uint8_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_binlog_range()
+ *
+ * @brief Put a range record.
+ *
+ * @param peer - peer address
+ * @param clock_offset - dwt_readclockoffset() value, or 0
+ * @param dist_mm - distance
+ * @param tof - time of flight, 1/16 DTU
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the record was dropped
+ */
+int dw_binlog_range(uint16_t peer, int16_t clock_offset, int32_t dist_mm, int32_t tof);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_binlog_diag()
+ *
+ * @brief Put a diagnostic record from dwt_readdiagnostics_sel() DW_BINLOG_DIAG_FIELDS (or dwt_readdiagnostics()).
+ *
+ * @param diag - diagnostics
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the record was dropped
+ */
+int dw_binlog_diag(const dwt_rxdiag_t *diag);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_binlog_timing()
+ *
+ * @brief Put a timing record.
+ *
+ * @param id - section id
+ * @param arg - free, e.g. a slot or a retry count
+ * @param us - duration
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the record was dropped
+ */
+int dw_binlog_timing(uint16_t id, uint16_t arg, uint32_t us);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_binlog_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @return counters
+ */
+const dw_binlog_stats_t * dw_binlog_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DW_BINLOG_H_ */
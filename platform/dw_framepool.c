@@ -0,0 +1,106 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_framepool.c
+ * @brief   Frame buffer pool: fixed-size, reference counted frames handed between stages without copies
+ *
+ *          See dw_framepool.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include "deca_device_api.h"
+#include "deca_vals.h"
+#include "dw_framepool.h"
+
+#include <zephyr/kernel.h>
+
+K_MEM_SLAB_DEFINE_STATIC(framepool_slab, sizeof(dw_frame_t), DW_FRAMEPOOL_COUNT, sizeof(void *));
+
+static dw_framepool_stats_t framepool_stats;
+
+dw_frame_t * dw_frame_alloc(void)
+{
+    dw_frame_t *frame;
+    unsigned int key;
+
+    if (k_mem_slab_alloc(&framepool_slab, (void **)&frame, K_NO_WAIT) != 0)
+    {
+        key = irq_lock();
+        framepool_stats.no_buf++;
+        irq_unlock(key);
+        return NULL;
+    }
+
+    frame->fifo_link = NULL;
+    atomic_set(&frame->ref, 1);
+    frame->len = 0;
+    frame->off = 0;
+    frame->rx_flags = 0;
+
+    key = irq_lock();
+    framepool_stats.allocs++;
+    framepool_stats.in_use++;
+    if (framepool_stats.in_use > framepool_stats.max_used)
+    {
+        framepool_stats.max_used = framepool_stats.in_use;
+    }
+    irq_unlock(key);
+
+    return frame;
+}
+
+dw_frame_t * dw_frame_ref(dw_frame_t *frame)
+{
+    atomic_inc(&frame->ref);
+    return frame;
+}
+
+void dw_frame_unref(dw_frame_t *frame)
+{
+    unsigned int key;
+
+    /* atomic_dec() returns the count before the decrement */
+    if ((frame == NULL) || (atomic_dec(&frame->ref) != 1))
+    {
+        return;
+    }
+
+    k_mem_slab_free(&framepool_slab, (void *)frame);
+
+    key = irq_lock();
+    framepool_stats.in_use--;
+    irq_unlock(key);
+}
+
+dw_frame_t * dw_frame_rx(const dwt_cb_data_t *cb_data)
+{
+    dw_frame_t *frame;
+    uint16_t len;
+
+    if ((cb_data->datalength < FCS_LEN) || (cb_data->datalength > DW_FRAMEPOOL_BUF_LEN))
+    {
+        framepool_stats.too_long++;
+        return NULL;
+    }
+
+    frame = dw_frame_alloc();
+    if (frame == NULL)
+    {
+        return NULL;
+    }
+
+    len = cb_data->datalength - FCS_LEN;
+    dwt_readrxdata(frame->data, len, 0);
+    dwt_readrxtimestamp(frame->rx_stamp);
+    frame->len = len;
+    frame->rx_flags = cb_data->rx_flags;
+
+    return frame;
+}
+
+const dw_framepool_stats_t * dw_framepool_get_stats(void)
+{
+    return &framepool_stats;
+}
@@ -0,0 +1,133 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_framepool.h
+ * @brief   Frame buffer pool: fixed-size, reference counted frames handed between stages without copies
+ *
+ *          The pool is a Zephyr memory slab of DW_FRAMEPOOL_COUNT frames of
+ *          DW_FRAMEPOOL_BUF_LEN bytes, defined at build time: its RAM is
+ *          DW_FRAMEPOOL_RAM bytes, and there is no other frame storage on the
+ *          RX path. A frame is read from the DW IC once, into a pool buffer
+ *          (dw_frame_rx() from the RX callback, or the reliable transfer
+ *          engine with MAC_XFER_FRAME_POOL), then handed from stage to stage
+ *          by pointer:
+ *
+ *          - queue: a frame goes from the DW IC callbacks to a thread in a
+ *            k_fifo (k_fifo_put()/k_fifo_get(), the first word of the frame
+ *            is the fifo link), one fifo at a time;
+ *          - parser: mac_frame_parse_802_15_4() on data/len, the view points
+ *            into the frame, off can keep the start of the payload;
+ *          - fragmentation: mac_frag_rx() on the payload, the reassembly
+ *            slot is the only copy (the datagram is contiguous);
+ *          - uplink: dw_uplink_frame() sends it to the host as a raw frame
+ *            record.
+ *
+ *          A stage keeping the frame after it returns takes a reference
+ *          (dw_frame_ref()), every reference is given back with
+ *          dw_frame_unref(), and the frame goes back to the pool with the
+ *          last one. All the functions can be called from interrupt context
+ *          and never block: when the pool is empty the frame is dropped and
+ *          counted.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef DW_FRAMEPOOL_H_
+#define DW_FRAMEPOOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <zephyr/sys/atomic.h>
+#include "deca_device_api.h"
+
+#ifndef DW_FRAMEPOOL_COUNT
+#define DW_FRAMEPOOL_COUNT      8           /* frames */
+#endif
+#ifndef DW_FRAMEPOOL_BUF_LEN
+#define DW_FRAMEPOOL_BUF_LEN    127         /* longest frame, FCS included */
+#endif
+
+typedef struct dw_frame
+{
+    void        *fifo_link;         /* k_fifo link, first word */
+    atomic_t    ref;                /* references, the frame is free at 0 */
+    uint16_t    len;                /* bytes in data, FCS excluded */
+    uint16_t    off;                /* start of the payload of the current layer, free for the stages */
+    uint8_t     rx_flags;           /* dw_frame_rx(): RX frame flags, as in dwt_cb_data_t */
+    uint8_t     rx_stamp[5];        /* dw_frame_rx(): adjusted RX timestamp */
+    uint8_t     data[DW_FRAMEPOOL_BUF_LEN];
+} dw_frame_t;
+
+/* Pool RAM, known at build time */
+#define DW_FRAMEPOOL_RAM        (DW_FRAMEPOOL_COUNT * sizeof(dw_frame_t))
+
+typedef struct
+{
+    uint32_t    allocs;             /* frames taken from the pool */
+    uint32_t    no_buf;             /* frames dropped, pool empty */
+    uint32_t    too_long;           /* dw_frame_rx(): frames dropped, longer than DW_FRAMEPOOL_BUF_LEN */
+    uint16_t    in_use;             /* frames out of the pool */
+    uint16_t    max_used;           /* highest in_use */
+} dw_framepool_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_frame_alloc()
+ *
+ * @brief Take a frame from the pool, with one reference, len and off at 0.
+ *
+ * @return frame, or NULL if the pool is empty
+ */
+dw_frame_t * dw_frame_alloc(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_frame_ref()
+ *
+ * @brief Take a reference to a frame, to keep it after handing it on.
+ *
+ * @param frame - frame
+ *
+ * @return frame
+ */
+dw_frame_t * dw_frame_ref(dw_frame_t *frame);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_frame_unref()
+ *
+ * @brief Give back a reference, the frame goes back to the pool with the last one.
+ *
+ * @param frame - frame, or NULL
+ *
+ * @return none
+ */
+void dw_frame_unref(dw_frame_t *frame);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_frame_rx()
+ *
+ * @brief RX callback: read the frame just received, its RX timestamp and flags into a frame of the pool. In the
+ *        continuous receiver mode (dwt_rxcont_start()) the frame is already in the RX event ring, do not use.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return frame, with one reference, or NULL if dropped (pool empty or frame too long)
+ */
+dw_frame_t * dw_frame_rx(const dwt_cb_data_t *cb_data);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_framepool_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @return counters
+ */
+const dw_framepool_stats_t * dw_framepool_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DW_FRAMEPOOL_H_ */
@@ -0,0 +1,632 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_model.c
+ * @brief   DW3000 register model, SPI platform backend for native_sim
+ *
+ *          See dw_model.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "dw_model.h"
+
+#define MODEL_FILES         32
+#define MODEL_FILE_LEN      1024                    /* TX/RX buffers, and the double buffer diagnostics of 0x18 */
+#define MODEL_ACC_LEN       (ACC_BUFFER_MAX_LEN + 16)
+#define MODEL_ACC_FILE      (ACC_MEM_ID >> 16)
+#define MODEL_PTR_A_FILE    (INDIRECT_POINTER_A_ID >> 16)
+#define MODEL_PTR_B_FILE    (INDIRECT_POINTER_B_ID >> 16)
+
+/* Header bits, as composed by dwt_xfer3000_header() */
+#define HDR_LONG            0x40
+#define HDR_FAST            0x81
+
+/* Device time step per transaction: 1 us */
+#define MODEL_XFER_TICKS    63898ULL
+#define MODEL_TIME_MASK     0xFFFFFFFFFFULL
+
+/* SYS_STATUS events of each FINT_STAT bit */
+#define FINT_RXOK_EVENTS    (SYS_STATUS_RXFCG_BIT_MASK)
+#define FINT_EVENT_EVENTS   (SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK | SYS_STATUS_VWARN_BIT_MASK)
+#define FINT_EVENT_EVENTS_HI (SYS_STATUS_HI_AES_DONE_BIT_MASK | SYS_STATUS_HI_GPIO_IRQ_BIT_MASK | SYS_STATUS_HI_VT_DET_BIT_MASK)
+#define FINT_PANIC_EVENTS_HI (SYS_STATUS_HI_SPIERR_BIT_MASK | SYS_STATUS_HI_SPI_UNF_BIT_MASK | SYS_STATUS_HI_SPI_OVF_BIT_MASK \
+                              | SYS_STATUS_HI_CMD_ERR_BIT_MASK | SYS_STATUS_HI_AES_ERR_BIT_MASK)
+
+static struct
+{
+    uint8_t             regs[MODEL_FILES][MODEL_FILE_LEN];
+    uint8_t             acc[MODEL_ACC_LEN];
+    uint64_t            time;                       /* device time, 40 bits */
+    uint8_t             rx_armed;
+    uint8_t             rx_db_next;                 /* double buffered RX: buffer of the next frame */
+    uint8_t             rx_db_held;                 /* ... buffers holding a frame, until CMD_DB_TOGGLE */
+    uint8_t             rx_head;
+    uint8_t             rx_count;
+    uint16_t            rx_len[DW_MODEL_RX_QUEUE_LEN];
+    uint8_t             rx_frame[DW_MODEL_RX_QUEUE_LEN][RX_BUFFER_MAX_LEN];
+    uint16_t            tx_len;
+    uint8_t             tx_frame[TX_BUFFER_MAX_LEN];
+    dw_model_stats_t    stats;
+    dw_model_xfer_t     log[DW_MODEL_LOG_LEN];
+} dw;
+
+/*
+ * Register helpers: IDs as in deca_regs.h, file in bits 16..20, offset below
+ */
+static uint8_t * reg_ptr(uint32_t id)
+{
+    return &dw.regs[(id >> 16) & 0x1F][id & 0xFFFF];
+}
+
+static uint32_t reg_get32(uint32_t id)
+{
+    uint8_t * p = reg_ptr(id);
+
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void reg_put32(uint32_t id, uint32_t val)
+{
+    uint8_t * p = reg_ptr(id);
+
+    p[0] = val;
+    p[1] = val >> 8;
+    p[2] = val >> 16;
+    p[3] = val >> 24;
+}
+
+static void reg_put40(uint32_t id, uint64_t val)
+{
+    reg_put32(id, (uint32_t)val);
+    reg_ptr(id)[4] = (uint8_t)(val >> 32);
+}
+
+static void status_set(uint32_t events)
+{
+    reg_put32(SYS_STATUS_ID, reg_get32(SYS_STATUS_ID) | events);
+}
+
+static uint8_t model_crc8(const uint8_t * data, uint16_t len, uint8_t crc)
+{
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint8_t model_fint(void)
+{
+    uint32_t status = reg_get32(SYS_STATUS_ID) & reg_get32(SYS_ENABLE_LO_ID);
+    uint32_t status_hi = reg_get32(SYS_STATUS_HI_ID) & reg_get32(SYS_ENABLE_HI_ID);
+    uint8_t fint = 0;
+
+    if (status & SYS_STATUS_TXFRS_BIT_MASK)
+        fint |= FINT_STAT_TXOK_BIT_MASK;
+    if (status & FINT_RXOK_EVENTS)
+        fint |= FINT_STAT_RXOK_BIT_MASK;
+    if (status & SYS_STATUS_ALL_RX_ERR)
+        fint |= FINT_STAT_RXERR_BIT_MASK;
+    if (status & SYS_STATUS_ALL_RX_TO)
+        fint |= FINT_STAT_RXTO_BIT_MASK;
+    if ((status & FINT_EVENT_EVENTS) || (status_hi & FINT_EVENT_EVENTS_HI))
+        fint |= FINT_STAT_SYS_EVENT_BIT_MASK;
+    if ((status & SYS_STATUS_SPICRCE_BIT_MASK) || (status_hi & FINT_PANIC_EVENTS_HI))
+        fint |= FINT_STAT_SYS_PANIC_BIT_MASK;
+
+    return fint;
+}
+
+/*
+ * Function: model_refresh()
+ *
+ * Update the registers the device drives itself before a read: the time,
+ * FINT_STAT, and the status of the operations that complete at once.
+ */
+static void model_refresh(void)
+{
+    reg_put32(SYS_TIME_ID, (uint32_t)(dw.time >> 8));
+    *reg_ptr(FINT_STAT_ID) = model_fint();
+
+    status_set(SYS_STATUS_CP_LOCK_BIT_MASK);                    /* the PLL stays locked */
+    *reg_ptr(RX_CAL_STS_ID) = 1;                                /* PGF calibration done */
+    *reg_ptr(SAR_STATUS_ID) |= SAR_STATUS_SAR_DONE_BIT_MASK;
+    *reg_ptr(AES_STS_ID) |= AES_STS_AES_DONE_BIT_MASK;
+}
+
+/*
+ * Function: model_mem()
+ *
+ * Resolve a register file and offset (through the indirect pointers) to
+ * the model memory. Returns the number of bytes available there.
+ */
+static uint16_t model_mem(uint8_t file, uint32_t offset, uint8_t ** mem)
+{
+    uint32_t size = MODEL_FILE_LEN;
+
+    if (file == MODEL_PTR_A_FILE) {
+        offset += reg_get32(ADDR_OFFSET_A_ID);
+        file = reg_get32(INDIRECT_ADDR_A_ID) & 0x1F;
+    }
+    else if (file == MODEL_PTR_B_FILE) {
+        offset += reg_get32(ADDR_OFFSET_B_ID);
+        file = reg_get32(INDIRECT_ADDR_B_ID) & 0x1F;
+    }
+
+    if (file == MODEL_ACC_FILE) {
+        *mem = dw.acc;
+        size = MODEL_ACC_LEN;
+    }
+    else {
+        *mem = dw.regs[file];
+    }
+
+    if (offset >= size) {
+        return 0;
+    }
+    *mem += offset;
+    return (uint16_t)(size - offset);
+}
+
+static void model_read(uint8_t file, uint16_t offset, uint16_t len, uint8_t * buf)
+{
+    uint8_t * mem;
+    uint16_t avail;
+
+    model_refresh();
+
+    avail = model_mem(file, offset, &mem);
+    if (avail > len) {
+        avail = len;
+    }
+    memcpy(buf, mem, avail);
+    memset(buf + avail, 0, len - avail);
+}
+
+static void model_write(uint8_t file, uint16_t offset, uint16_t len, const uint8_t * data)
+{
+    uint8_t * mem;
+    uint16_t avail = model_mem(file, offset, &mem);
+
+    if (avail > len) {
+        avail = len;
+    }
+
+    for (uint16_t i = 0; i < avail; i++) {
+
+        uint8_t * p = mem + i;
+
+        /* Write 1 to clear event registers */
+        if (((p >= reg_ptr(SYS_STATUS_ID)) && (p < reg_ptr(SYS_STATUS_HI_ID) + 4))
+            || ((p >= reg_ptr(RDB_STATUS_ID)) && (p < reg_ptr(RDB_STATUS_ID) + 4))
+            || (p == reg_ptr(AES_STS_ID))) {
+            *p &= ~data[i];
+        }
+        else {
+            *p = data[i];
+        }
+    }
+
+    /* The PGC calibration completes at once */
+    *reg_ptr(PGC_CTRL_ID) &= ~PGC_CTRL_PGC_START_BIT_MASK;
+}
+
+static void model_and_or(uint8_t file, uint16_t offset, uint8_t width, const uint8_t * body)
+{
+    uint8_t val[4];
+
+    model_read(file, offset, width, val);
+    for (int i = 0; i < width; i++) {
+        val[i] = (val[i] & body[i]) | body[width + i];
+    }
+    model_write(file, offset, width, val);
+}
+
+/*
+ * Function: model_rx()
+ *
+ * Receiver enabled: take the next injected frame, or time out if the
+ * frame wait timeout is enabled, else stay armed for dw_model_rx_inject().
+ * With the double buffered RX (SYS_CFG DIS_DRXB clear), the frames go to
+ * RX_BUFFER_0 and RX_BUFFER_1 in turn, with their BUF0/BUF1 frame info and
+ * RDB_STATUS events, and the receiver waits while both buffers are held.
+ */
+static void model_rx(void)
+{
+    uint8_t db = !(reg_get32(SYS_CFG_ID) & SYS_CFG_DIS_DRXB_BIT_MASK);
+
+    dw.rx_armed = 1;
+
+    if ((dw.rx_count != 0) && db && (dw.rx_db_held == 2)) {
+        return;
+    }
+
+    if (dw.rx_count != 0) {
+
+        uint16_t len = dw.rx_len[dw.rx_head];
+        uint32_t buf_id = RX_BUFFER_0_ID;
+        uint32_t finfo_id = RX_FINFO_ID;
+        uint32_t time_id = RX_TIME_0_ID;
+        uint32_t finfo;
+
+        if (db) {
+            buf_id = dw.rx_db_next ? RX_BUFFER_1_ID : RX_BUFFER_0_ID;
+            finfo_id = dw.rx_db_next ? BUF1_RX_FINFO : BUF0_RX_FINFO;
+            time_id = dw.rx_db_next ? BUF1_RX_TIME : BUF0_RX_TIME;
+            *reg_ptr(RDB_STATUS_ID) |= (RDB_STATUS_RXFCG0_BIT_MASK | RDB_STATUS_RXFR0_BIT_MASK
+                                        | RDB_STATUS_CIADONE0_BIT_MASK) << (4 * dw.rx_db_next);
+            dw.rx_db_next ^= 1;
+            dw.rx_db_held++;
+        }
+
+        finfo = reg_get32(finfo_id) & ~RX_FINFO_RXFLEN_BIT_MASK;
+        memcpy(reg_ptr(buf_id), dw.rx_frame[dw.rx_head], len);
+        memset(reg_ptr(buf_id) + len, 0, FCS_LEN);
+        reg_put32(finfo_id, finfo | (len + FCS_LEN));
+        reg_put40(time_id, dw.time);
+
+        dw.rx_head = (dw.rx_head + 1) % DW_MODEL_RX_QUEUE_LEN;
+        dw.rx_count--;
+        dw.rx_armed = 0;
+        dw.stats.rx_frames++;
+
+        status_set(SYS_STATUS_RXPRD_BIT_MASK | SYS_STATUS_RXSFDD_BIT_MASK | SYS_STATUS_RXPHD_BIT_MASK
+                   | SYS_STATUS_RXFR_BIT_MASK | SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_CIADONE_BIT_MASK);
+    }
+    else if ((reg_get32(SYS_CFG_ID) & SYS_CFG_RXWTOE_BIT_MASK) && (reg_get32(RX_FWTO_ID) != 0)) {
+
+        dw.rx_armed = 0;
+        dw.stats.rx_timeouts++;
+        status_set(SYS_STATUS_RXFTO_BIT_MASK);
+    }
+}
+
+static void model_tx(int delayed)
+{
+    uint16_t len = reg_get32(TX_FCTRL_ID) & TX_FCTRL_TXFLEN_BIT_MASK;
+
+    dw.tx_len = (len > FCS_LEN) ? (len - FCS_LEN) : 0;
+    memcpy(dw.tx_frame, reg_ptr(TX_BUFFER_ID), dw.tx_len);
+
+    /* A delayed transmission is on time, at DX_TIME (bits 39..8 of the device time) */
+    reg_put40(TX_TIME_LO_ID, delayed ? ((uint64_t)reg_get32(DX_TIME_ID) << 8) : dw.time);
+
+    dw.rx_armed = 0;
+    dw.stats.tx_frames++;
+    status_set(SYS_STATUS_TXFRB_BIT_MASK | SYS_STATUS_TXPRS_BIT_MASK | SYS_STATUS_TXPHS_BIT_MASK | SYS_STATUS_TXFRS_BIT_MASK);
+}
+
+static void model_fast(uint8_t cmd)
+{
+    switch (cmd) {
+    case CMD_TXRXOFF:
+        dw.rx_armed = 0;
+        break;
+    case CMD_TX:
+    case CMD_CCA_TX:
+        model_tx(0);
+        break;
+    case CMD_DTX:
+    case CMD_DTX_TS:
+    case CMD_DTX_RS:
+    case CMD_DTX_REF:
+        model_tx(1);
+        break;
+    case CMD_TX_W4R:
+    case CMD_CCA_TX_W4R:
+        model_tx(0);
+        model_rx();
+        break;
+    case CMD_DTX_W4R:
+    case CMD_DTX_TS_W4R:
+    case CMD_DTX_RS_W4R:
+    case CMD_DTX_REF_W4R:
+        model_tx(1);
+        model_rx();
+        break;
+    case CMD_RX:
+    case CMD_DRX:
+    case CMD_DRX_TS:
+    case CMD_DRX_RS:
+    case CMD_DRX_REF:
+        model_rx();
+        break;
+    case CMD_CLR_IRQS:
+        reg_put32(SYS_STATUS_ID, 0);
+        reg_put32(SYS_STATUS_HI_ID, 0);
+        break;
+    case CMD_DB_TOGGLE:
+        /* The host gives a buffer back: a frame waiting for it is received now */
+        dw.stats.db_toggles++;
+        if (dw.rx_db_held != 0) {
+            dw.rx_db_held--;
+            if (dw.rx_armed) {
+                model_rx();
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void model_log(uint8_t type, uint8_t file, uint16_t offset, uint16_t len, uint16_t bytes)
+{
+    dw_model_xfer_t * x = &dw.log[dw.stats.xfers % DW_MODEL_LOG_LEN];
+
+    x->type = type;
+    x->file = file;
+    x->offset = offset;
+    x->len = len;
+    x->bytes = bytes;
+
+    dw.stats.xfers++;
+    dw.stats.bytes += bytes;
+    dw.stats.type_xfers[type]++;
+    dw.stats.type_bytes[type] += bytes;
+    dw.time = (dw.time + MODEL_XFER_TICKS) & MODEL_TIME_MASK;
+}
+
+/*
+ * Function: model_xfer()
+ *
+ * Decode and execute one transaction (one chip select). crc is the CRC
+ * byte sent after a write, or -1 for none. Returns 0, or -1 on a bad CRC.
+ */
+static int model_xfer(uint16_t headerLength, const uint8_t * headerBuffer,
+                      uint16_t bodyLength, const uint8_t * bodyBuffer,
+                      uint8_t * readBuffer, int crc)
+{
+    uint8_t  h0 = headerBuffer[0];
+    uint8_t  file = (h0 >> 1) & 0x1F;
+    uint16_t offset = 0;
+    uint8_t  width = 0;
+    uint16_t bytes = headerLength + bodyLength + ((crc >= 0) ? 1 : 0);
+
+    if ((headerLength == 1) && ((h0 & HDR_FAST) == HDR_FAST)) {
+
+        uint8_t cmd = (h0 >> 1) & 0x1F;
+
+        model_log(DW_MODEL_XFER_FAST, cmd, 0, 0, bytes);
+        if ((crc >= 0) && (model_crc8(headerBuffer, headerLength, 0) != crc)) {
+            dw.stats.crc_errors++;
+            status_set(SYS_STATUS_SPICRCE_BIT_MASK);
+            return -1;
+        }
+        model_fast(cmd);
+        return 0;
+    }
+
+    if (headerLength >= 2) {
+        offset = ((h0 & 0x01) << 6) | (headerBuffer[1] >> 2);
+        width = headerBuffer[1] & 0x03;                         /* AND/OR 8, 16, 32-bit */
+    }
+
+    if (readBuffer != NULL) {
+
+        model_log(DW_MODEL_XFER_RD, file, offset, bodyLength, bytes);
+        model_read(file, offset, bodyLength, readBuffer);
+
+        /* CRC of the read transaction, for DWT_SPI_CRC_MODE_WRRD */
+        if ((reg_get32(SYS_CFG_ID) & SYS_CFG_SPI_CRC_BIT_MASK) && ((file != 0) || (offset != SPICRC_CFG_ID))) {
+            *reg_ptr(SPICRC_CFG_ID) = model_crc8(readBuffer, bodyLength, model_crc8(headerBuffer, headerLength, 0));
+        }
+        return 0;
+    }
+
+    model_log((width != 0) ? DW_MODEL_XFER_AND_OR : DW_MODEL_XFER_WR, file, offset, bodyLength, bytes);
+
+    if ((crc >= 0) && (model_crc8(bodyBuffer, bodyLength, model_crc8(headerBuffer, headerLength, 0)) != crc)) {
+        dw.stats.crc_errors++;
+        status_set(SYS_STATUS_SPICRCE_BIT_MASK);
+        return -1;
+    }
+
+    if (width != 0) {
+        width = (width == 3) ? 4 : width;
+        if (bodyLength >= 2 * width) {
+            model_and_or(file, offset, width, bodyBuffer);
+        }
+    }
+    else {
+        model_write(file, offset, bodyLength, bodyBuffer);
+    }
+    return 0;
+}
+
+void dw_model_reset(void)
+{
+    dw_model_stats_t stats = dw.stats;
+
+    memset(&dw, 0, sizeof(dw));
+    dw.stats = stats;
+
+    reg_put32(DEV_ID_ID, (uint32_t)DWT_C0_DEV_ID);
+    reg_put32(SYS_CFG_ID, SYS_CFG_DIS_DRXB_BIT_MASK);           /* single RX buffer */
+    status_set(SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK | SYS_STATUS_CP_LOCK_BIT_MASK);
+}
+
+void dw_model_clear_stats(void)
+{
+    memset(&dw.stats, 0, sizeof(dw.stats));
+}
+
+const dw_model_stats_t * dw_model_get_stats(void)
+{
+    return &dw.stats;
+}
+
+int dw_model_get_xfer(uint32_t idx, dw_model_xfer_t *xfer)
+{
+    if ((idx >= dw.stats.xfers) || ((dw.stats.xfers - idx) > DW_MODEL_LOG_LEN)) {
+        return -1;
+    }
+    *xfer = dw.log[idx % DW_MODEL_LOG_LEN];
+    return 0;
+}
+
+int dw_model_rx_inject(const uint8_t *frame, uint16_t len)
+{
+    uint8_t tail;
+
+    if ((dw.rx_count == DW_MODEL_RX_QUEUE_LEN) || (len > (RX_BUFFER_MAX_LEN - FCS_LEN))) {
+        return -1;
+    }
+
+    tail = (dw.rx_head + dw.rx_count) % DW_MODEL_RX_QUEUE_LEN;
+    memcpy(dw.rx_frame[tail], frame, len);
+    dw.rx_len[tail] = len;
+    dw.rx_count++;
+
+    /* Receiver already waiting: the frame arrives now */
+    if (dw.rx_armed) {
+        model_rx();
+    }
+    return 0;
+}
+
+uint16_t dw_model_get_tx(uint8_t *buf, uint16_t maxlen)
+{
+    memcpy(buf, dw.tx_frame, (dw.tx_len < maxlen) ? dw.tx_len : maxlen);
+    return dw.tx_len;
+}
+
+int dw_model_irq(void)
+{
+    return model_fint() != 0;
+}
+
+/*
+ *****************************************************************************
+ *
+ *                     Driver platform interface
+ *
+ *****************************************************************************
+ */
+
+int writetospiwithcrc(uint16_t           headerLength,
+                      const    uint8_t * headerBuffer,
+                      uint16_t           bodyLength,
+                      const    uint8_t * bodyBuffer,
+                      uint8_t            crc8)
+{
+    return model_xfer(headerLength, headerBuffer, bodyLength, bodyBuffer, NULL, crc8);
+}
+
+int writetospi(uint16_t           headerLength,
+               const    uint8_t * headerBuffer,
+               uint16_t           bodyLength,
+               const    uint8_t * bodyBuffer)
+{
+    return model_xfer(headerLength, headerBuffer, bodyLength, bodyBuffer, NULL, -1);
+}
+
+int writetospi_batch(uint16_t          count,
+                     const uint16_t  * lengths,
+                     const    uint8_t * buffer)
+{
+    int ret = 0;
+
+    dw.stats.batches++;
+
+    for (int i = 0; i < count; i++) {
+
+        /* Each transaction is the header, the data and (SPI CRC enabled) the CRC byte */
+        uint16_t hlen = (buffer[0] & HDR_LONG) ? 2 : 1;
+        int crc = (reg_get32(SYS_CFG_ID) & SYS_CFG_SPI_CRC_BIT_MASK) ? buffer[lengths[i] - 1] : -1;
+        uint16_t blen = lengths[i] - hlen - ((crc >= 0) ? 1 : 0);
+
+        if (model_xfer(hlen, buffer, blen, buffer + hlen, NULL, crc) != 0) {
+            ret = -1;
+        }
+        buffer += lengths[i];
+    }
+
+    return ret;
+}
+
+int readfromspi(uint16_t        headerLength,
+                const uint8_t * headerBuffer,
+                uint16_t        readLength,
+                uint8_t       * readBuffer)
+{
+    return model_xfer(headerLength, headerBuffer, readLength, NULL, readBuffer, -1);
+}
+
+/* The async transfers complete before returning, the callback included */
+int writetospiwithcrc_async(uint16_t           headerLength,
+                            const    uint8_t * headerBuffer,
+                            uint16_t           bodyLength,
+                            const    uint8_t * bodyBuffer,
+                            uint8_t            crc8,
+                            dwt_spi_done_cb_t  cb,
+                            void             * arg)
+{
+    int ret = writetospiwithcrc(headerLength, headerBuffer, bodyLength, bodyBuffer, crc8);
+
+    cb(ret, arg);
+    return 0;
+}
+
+int writetospi_async(uint16_t           headerLength,
+                     const    uint8_t * headerBuffer,
+                     uint16_t           bodyLength,
+                     const    uint8_t * bodyBuffer,
+                     dwt_spi_done_cb_t  cb,
+                     void             * arg)
+{
+    int ret = writetospi(headerLength, headerBuffer, bodyLength, bodyBuffer);
+
+    cb(ret, arg);
+    return 0;
+}
+
+int readfromspi_async(uint16_t          headerLength,
+                      const uint8_t   * headerBuffer,
+                      uint16_t          readLength,
+                      uint8_t         * readBuffer,
+                      dwt_spi_done_cb_t cb,
+                      void            * arg)
+{
+    int ret = readfromspi(headerLength, headerBuffer, readLength, readBuffer);
+
+    cb(ret, arg);
+    return 0;
+}
+
+/* The sleeps only advance the device time: the model has nothing to wait for */
+void deca_sleep(unsigned int time_ms)
+{
+    deca_usleep(time_ms * 1000UL);
+}
+
+void deca_usleep(unsigned long time_us)
+{
+    dw.stats.sleep_us += time_us;
+    dw.time = (dw.time + time_us * MODEL_XFER_TICKS) & MODEL_TIME_MASK;
+}
+
+void wakeup_device_with_io(void)
+{
+    dw.stats.wakeups++;
+    status_set(SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+}
+
+/* Single thread: the device lock (schedule queue, DWT_THREAD_SAFE) has nothing to exclude */
+void port_dw_ic_lock(unsigned int index)
+{
+    (void)index;
+}
+
+void port_dw_ic_unlock(unsigned int index)
+{
+    (void)index;
+}
@@ -0,0 +1,180 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_model.h
+ * @brief   DW3000 register model, SPI platform backend for native_sim
+ *
+ *          Replaces deca_spi.c (and deca_sleep.c, port.c) in host builds:
+ *          implements the driver's platform interface (writetospi(),
+ *          readfromspi(), writetospiwithcrc(), writetospi_batch(), the
+ *          async variants, deca_sleep()/deca_usleep(),
+ *          wakeup_device_with_io() and the device lock) on a model of
+ *          the DW3000 instead of a SPI bus.
+ *
+ *          The model decodes each transaction header as the DW3000 does
+ *          (fast commands, short and long addressing, AND/OR modifies,
+ *          SPI CRC) and keeps:
+ *           - the register files and the RX/TX/accumulator buffers, with
+ *             the indirect pointers A and B,
+ *           - SYS_STATUS (write 1 to clear) and FINT_STAT, SYS_ENABLE,
+ *           - basic event sequencing: a TX fast command sends the TX
+ *             buffer (TX_FCTRL length) and sets the TX events, an RX
+ *             command receives the next injected frame or times out
+ *             (RX_FWTO with SYS_CFG RXWTOE), the W4R commands do both,
+ *           - the double buffered RX (SYS_CFG DIS_DRXB clear): the frames
+ *             alternate between the two RX buffers, with RDB_STATUS, and a
+ *             buffer is free again after a CMD_DB_TOGGLE,
+ *           - the power-on state (RCINIT|SPIRDY, the PLL locked and the RX
+ *             calibration done), so dwt_initialise() and dwt_configure()
+ *             complete,
+ *           - a count of every transaction and SPI byte, by type, and a
+ *             log of the last DW_MODEL_LOG_LEN transactions.
+ *
+ *          There is no radio timing: the system time advances by a fixed
+ *          step per transaction, delayed transmissions are never late,
+ *          and the OTP reads as zeros (the driver uses its defaults).
+ *          There is no interrupt line either: poll dw_model_irq() and
+ *          call dwt_isr() while it is set.
+ *
+ *          Single instance, not thread safe: call from one thread.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef DW_MODEL_H_
+#define DW_MODEL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "deca_device_api.h"
+
+/* Number of transactions kept in the log */
+#ifndef DW_MODEL_LOG_LEN
+#define DW_MODEL_LOG_LEN        256
+#endif
+
+/* Number of injected frames waiting for an RX command */
+#ifndef DW_MODEL_RX_QUEUE_LEN
+#define DW_MODEL_RX_QUEUE_LEN   4
+#endif
+
+/* Transaction types */
+typedef enum
+{
+    DW_MODEL_XFER_RD,       /* register or buffer read */
+    DW_MODEL_XFER_WR,       /* register or buffer write */
+    DW_MODEL_XFER_AND_OR,   /* AND/OR modify (8, 16 or 32-bit) */
+    DW_MODEL_XFER_FAST,     /* fast command */
+    DW_MODEL_XFER_NUM
+} dw_model_xfer_e;
+
+/* One logged transaction */
+typedef struct
+{
+    uint8_t     type;       /* dw_model_xfer_e */
+    uint8_t     file;       /* register file, or the fast command */
+    uint16_t    offset;     /* offset in the register file */
+    uint16_t    len;        /* data bytes */
+    uint16_t    bytes;      /* SPI bytes: header, data and CRC */
+} dw_model_xfer_t;
+
+/* Counters since the last dw_model_clear_stats() */
+typedef struct
+{
+    uint32_t    xfers;                      /* transactions (chip selects) */
+    uint32_t    bytes;                      /* SPI bytes */
+    uint32_t    type_xfers[DW_MODEL_XFER_NUM];
+    uint32_t    type_bytes[DW_MODEL_XFER_NUM];
+    uint32_t    batches;                    /* writetospi_batch() calls */
+    uint32_t    crc_errors;                 /* writes with a bad CRC (SPICRCE set) */
+    uint32_t    tx_frames;
+    uint32_t    rx_frames;
+    uint32_t    rx_timeouts;
+    uint32_t    db_toggles;                 /* CMD_DB_TOGGLE commands, one per frame of the double buffered RX */
+    uint32_t    wakeups;                    /* wakeup_device_with_io() calls */
+    uint32_t    sleep_us;                   /* time asked for with deca_sleep()/deca_usleep() */
+} dw_model_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_reset()
+ *
+ * @brief Power-on reset of the model: clear the registers, the buffers, the injected frames and the log, and set
+ *        the power-on events (RCINIT, SPIRDY), as after a hardware reset. The counters are kept.
+ *
+ * @return none
+ */
+void dw_model_reset(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_clear_stats()
+ *
+ * @brief Clear the counters and the log.
+ *
+ * @return none
+ */
+void dw_model_clear_stats(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @return counters
+ */
+const dw_model_stats_t * dw_model_get_stats(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_get_xfer()
+ *
+ * @brief Get a logged transaction: index 0 is the first since dw_model_clear_stats(). Only the last
+ *        DW_MODEL_LOG_LEN transactions are kept.
+ *
+ * @param idx - transaction index, below dw_model_get_stats()->xfers
+ * @param xfer - returned transaction
+ *
+ * @return 0 on success, -1 if the transaction is not (or no longer) in the log
+ */
+int dw_model_get_xfer(uint32_t idx, dw_model_xfer_t *xfer);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_rx_inject()
+ *
+ * @brief Queue a frame for the next RX commands. The model appends the FCS, i.e. RX_FINFO reports len + 2.
+ *
+ * @param frame - frame, without FCS
+ * @param len - frame length, up to 1021 bytes
+ *
+ * @return 0 on success, -1 if the queue is full or the frame too long
+ */
+int dw_model_rx_inject(const uint8_t *frame, uint16_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_get_tx()
+ *
+ * @brief Copy the last frame sent, without FCS.
+ *
+ * @param buf - destination
+ * @param maxlen - size of buf
+ *
+ * @return frame length (before truncation to maxlen), 0 if nothing was sent since the reset
+ */
+uint16_t dw_model_get_tx(uint8_t *buf, uint16_t maxlen);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_irq()
+ *
+ * @brief Level of the model's IRQ line: an enabled (SYS_ENABLE) event is set in SYS_STATUS.
+ *
+ * @return 1 if dwt_isr() should be called, 0 if not
+ */
+int dw_model_irq(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DW_MODEL_H_ */
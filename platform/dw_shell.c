@@ -0,0 +1,373 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_shell.c
+ * @brief   Zephyr shell commands for the DW3000 (CONFIG_SHELL)
+ *
+ *          See dw_shell.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "deca_spi.h"
+#include "port.h"
+#include "dw_shell.h"
+
+#include <zephyr/kernel.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+#define CIR_SAMPLE_LEN      6       /* 3 bytes real, 3 bytes imaginary */
+#define CIR_CHUNK           16      /* samples per accumulator read */
+#define CIR_PRE             4       /* samples shown before the first path */
+#define CIR_DEFAULT_COUNT   16
+#define CIR_MAX_COUNT       1016
+
+static dwt_config_t   * shell_config;
+static dwt_txconfig_t * shell_txconfig;
+
+void dw_shell_init(dwt_config_t * config, dwt_txconfig_t * txconfig)
+{
+    shell_config = config;
+    shell_txconfig = txconfig;
+}
+
+#if defined(CONFIG_SHELL)
+
+/* PHY parameters of "dw phy", by offset in dwt_config_t */
+typedef struct {
+    const char * name;
+    uint8_t      offset;
+    uint8_t      size;
+} phy_param_t;
+
+#define PHY_PARAM(n, f) { n, offsetof(dwt_config_t, f), sizeof(((dwt_config_t *)0)->f) }
+
+static const phy_param_t phy_params[] = {
+    PHY_PARAM("chan", chan),
+    PHY_PARAM("plen", txPreambLength),
+    PHY_PARAM("pac", rxPAC),
+    PHY_PARAM("txcode", txCode),
+    PHY_PARAM("rxcode", rxCode),
+    PHY_PARAM("sfd", sfdType),
+    PHY_PARAM("br", dataRate),
+    PHY_PARAM("phrmode", phrMode),
+    PHY_PARAM("phrrate", phrRate),
+    PHY_PARAM("sfdto", sfdTO),
+    PHY_PARAM("sts", stsMode),
+    PHY_PARAM("stslen", stsLength),
+    PHY_PARAM("pdoa", pdoaMode),
+};
+
+#define PHY_PARAM_COUNT (sizeof(phy_params) / sizeof(phy_params[0]))
+
+/* @fn    parse_u32
+ * @brief parse a decimal or 0x prefixed number
+ *        returns 0, or -1 if it is not one
+ * */
+static int parse_u32(const char * s, uint32_t * v)
+{
+    char * end;
+
+    *v = strtoul(s, &end, 0);
+    return ((end == s) || (*end != '\0')) ? -1 : 0;
+}
+
+static uint32_t phy_get(const phy_param_t * p)
+{
+    const uint8_t * f = (const uint8_t *)shell_config + p->offset;
+
+    switch (p->size) {
+    case 1:
+        return *f;
+    case 2:
+        return *(const uint16_t *)f;
+    default:
+        return *(const uint32_t *)f;
+    }
+}
+
+static void phy_set(const phy_param_t * p, uint32_t v)
+{
+    uint8_t * f = (uint8_t *)shell_config + p->offset;
+
+    switch (p->size) {
+    case 1:
+        *f = (uint8_t)v;
+        break;
+    case 2:
+        *(uint16_t *)f = (uint16_t)v;
+        break;
+    default:
+        *(uint32_t *)f = v;
+        break;
+    }
+}
+
+static int cmd_info(const struct shell * sh, size_t argc, char ** argv)
+{
+    shell_print(sh, "dev id %08x, SPI %u Hz", dwt_readdevid(), get_spi_speed_fast_freq());
+    return 0;
+}
+
+static int cmd_phy(const struct shell * sh, size_t argc, char ** argv)
+{
+    uint32_t v;
+
+    if (shell_config == NULL) {
+        shell_error(sh, "no configuration, see dw_shell_init()");
+        return -ENOEXEC;
+    }
+
+    if (argc == 1) {
+        for (int i = 0; i < PHY_PARAM_COUNT; i++) {
+            shell_print(sh, "%-8s %u", phy_params[i].name, phy_get(&phy_params[i]));
+        }
+        return 0;
+    }
+
+    if ((argc == 2) && (strcmp(argv[1], "apply") == 0)) {
+        dwt_forcetrxoff();
+        if (dwt_configure(shell_config) != DWT_SUCCESS) {
+            shell_error(sh, "configure failed (PLL or RX calibration), reset the device");
+            return -EIO;
+        }
+        if (shell_txconfig != NULL) {
+            dwt_configuretxrf(shell_txconfig);
+        }
+        shell_print(sh, "applied");
+        return 0;
+    }
+
+    if (argc != 3) {
+        shell_help(sh);
+        return -EINVAL;
+    }
+
+    for (int i = 0; i < PHY_PARAM_COUNT; i++) {
+        if (strcmp(argv[1], phy_params[i].name) == 0) {
+            if (parse_u32(argv[2], &v) != 0) {
+                shell_error(sh, "bad value %s", argv[2]);
+                return -EINVAL;
+            }
+            phy_set(&phy_params[i], v);
+            shell_print(sh, "%s %u, use \"dw phy apply\"", phy_params[i].name, v);
+            return 0;
+        }
+    }
+
+    shell_error(sh, "unknown parameter %s", argv[1]);
+    return -EINVAL;
+}
+
+static int cmd_txrf(const struct shell * sh, size_t argc, char ** argv)
+{
+    uint32_t power, pgdly;
+
+    if (shell_txconfig == NULL) {
+        shell_error(sh, "no TX configuration, see dw_shell_init()");
+        return -ENOEXEC;
+    }
+
+    if (argc > 1) {
+        if ((parse_u32(argv[1], &power) != 0) || ((argc > 2) && (parse_u32(argv[2], &pgdly) != 0))) {
+            shell_error(sh, "bad value");
+            return -EINVAL;
+        }
+        shell_txconfig->power = power;
+        if (argc > 2) {
+            shell_txconfig->PGdly = (uint8_t)pgdly;
+        }
+        dwt_configuretxrf(shell_txconfig);
+    }
+
+    shell_print(sh, "power %08x, PG delay %02x", shell_txconfig->power, shell_txconfig->PGdly);
+    return 0;
+}
+
+static int cmd_spi(const struct shell * sh, size_t argc, char ** argv)
+{
+    uint32_t hz;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "cal") == 0) {
+            hz = port_calibrate_dw_ic_spi_fastrate();
+        }
+        else if (parse_u32(argv[1], &hz) == 0) {
+            set_spi_speed_fast_freq(hz);
+            port_set_dw_ic_spi_fastrate();
+        }
+        else {
+            shell_error(sh, "bad rate %s", argv[1]);
+            return -EINVAL;
+        }
+    }
+
+    shell_print(sh, "SPI %u Hz", get_spi_speed_fast_freq());
+    return 0;
+}
+
+static int cmd_antdly(const struct shell * sh, size_t argc, char ** argv)
+{
+    uint32_t tx, rx;
+
+    if (argc > 1) {
+        if ((parse_u32(argv[1], &tx) != 0) || ((argc > 2) && (parse_u32(argv[2], &rx) != 0))) {
+            shell_error(sh, "bad value");
+            return -EINVAL;
+        }
+        dwt_settxantennadelay((uint16_t)tx);
+        dwt_setrxantennadelay((argc > 2) ? (uint16_t)rx : (uint16_t)tx);
+    }
+
+    shell_print(sh, "tx %u rx %u", dwt_read16bitoffsetreg(TX_ANTD_ID, 0),
+                dwt_read16bitoffsetreg(CIA_CONF_ID, 0) & CIA_CONF_RXANTD_BIT_MASK);
+    return 0;
+}
+
+static int cmd_evc(const struct shell * sh, size_t argc, char ** argv)
+{
+    dwt_deviceentcnts_t c;
+
+    if ((argc > 1) && (strcmp(argv[1], "clear") == 0)) {
+        dwt_configeventcounters(1);
+    }
+
+    dwt_readeventcounters(&c);
+    shell_print(sh, "rx: crcg %u crcb %u phe %u rsl %u arfe %u over %u", c.CRCG, c.CRCB, c.PHE, c.RSL, c.ARFE, c.OVER);
+    shell_print(sh, "to: sfdto %u pto %u rto %u prej %u", c.SFDTO, c.PTO, c.RTO, c.PREJ);
+    shell_print(sh, "tx: txf %u hpw %u, spi crce %u", c.TXF, c.HPW, c.CRCE);
+    return 0;
+}
+
+static int cmd_probe(const struct shell * sh, size_t argc, char ** argv)
+{
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        port_probe_reset();
+        return 0;
+    }
+
+    for (int i = 0; i < DWT_PROBE_COUNT; i++) {
+        const port_probe_t * p = port_probe_get(i);
+
+        if ((p == NULL) || (p->count == 0)) {
+            continue;
+        }
+        shell_print(sh, "%-6s n=%u last=%u min=%u max=%u avg=%u us", p->name, p->count,
+                    port_tick_to_us(p->last), port_tick_to_us(p->min),
+                    port_tick_to_us(p->max), port_tick_to_us((uint32_t)(p->total / p->count)));
+    }
+    return 0;
+}
+
+static int cmd_irq(const struct shell * sh, size_t argc, char ** argv)
+{
+    port_irq_latency_t lat;
+
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        port_reset_irq_latency();
+        return 0;
+    }
+
+    port_get_irq_latency(&lat);
+    shell_print(sh, "n=%u last=%u min=%u max=%u avg=%u us", lat.count, lat.last_us, lat.min_us, lat.max_us,
+                (lat.count != 0) ? (uint32_t)(lat.total_us / lat.count) : 0);
+    return 0;
+}
+
+#ifdef DWT_SPI_PROFILE
+static int cmd_prof(const struct shell * sh, size_t argc, char ** argv)
+{
+    const dwt_spi_profile_t * prof;
+    uint16_t count;
+
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        dwt_spi_profile_reset();
+        return 0;
+    }
+
+    prof = dwt_spi_profile_get(&count);
+    for (int i = 0; i < count; i++) {
+        shell_print(sh, "%06x type %u n=%u bytes=%u us=%u", prof[i].regFileID, prof[i].type, prof[i].count,
+                    prof[i].bytes, port_tick_to_us((uint32_t)prof[i].cycles));
+    }
+    return 0;
+}
+#endif
+
+/* @fn    cir_value
+ * @brief sign extend an 18-bit accumulator value
+ * */
+static int32_t cir_value(const uint8_t * p)
+{
+    int32_t v = (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16) & 0x3FFFF;
+
+    return (v & 0x20000) ? (v - 0x40000) : v;
+}
+
+static int cmd_cir(const struct shell * sh, size_t argc, char ** argv)
+{
+    static uint8_t buf[CIR_CHUNK * CIR_SAMPLE_LEN + 1];
+    dwt_rxdiag_t diag;
+    dwt_span_t span;
+    uint32_t count = CIR_DEFAULT_COUNT;
+    uint16_t first;
+    uint16_t n;
+
+    if ((argc > 1) && ((parse_u32(argv[1], &count) != 0) || (count == 0) || (count > CIR_MAX_COUNT))) {
+        shell_error(sh, "bad count");
+        return -EINVAL;
+    }
+
+    if (dwt_readdiagnostics_sel(&diag, DWT_DIAG_IP_FP) != DWT_DIAG_IP_FP) {
+        shell_error(sh, "no diagnostics, see dwt_configciadiag()");
+        return -EIO;
+    }
+
+    first = diag.ipatovFpIndex >> 6;
+    first = (first > CIR_PRE) ? (first - CIR_PRE) : 0;
+    if (first + count > CIR_MAX_COUNT) {
+        count = CIR_MAX_COUNT - first;
+    }
+    shell_print(sh, "first path %u.%02u, samples %u to %u", diag.ipatovFpIndex >> 6,
+                ((diag.ipatovFpIndex & 0x3F) * 100) >> 6, first, first + count - 1);
+
+    if (dwt_readspan_begin(&span, DWT_SPAN_ACC, first, count) != DWT_SUCCESS) {
+        return -EINVAL;
+    }
+    while ((n = dwt_readspan(&span, buf, CIR_CHUNK)) != 0) {
+        for (int i = 0; i < n; i++) {
+            const uint8_t * p = &buf[1 + i * CIR_SAMPLE_LEN];
+            shell_print(sh, "%4u %7d %7d", first + i, cir_value(p), cir_value(p + 3));
+        }
+        first += n;
+    }
+    dwt_readspan_end(&span);
+    return 0;
+}
+
+SHELL_SUBCMD_SET_CREATE(dw_cmds, (dw));
+
+SHELL_SUBCMD_ADD((dw), info, NULL, "Device ID and SPI rate", cmd_info, 1, 0);
+SHELL_SUBCMD_ADD((dw), phy, NULL, "PHY configuration: [<param> <value> | apply]", cmd_phy, 1, 2);
+SHELL_SUBCMD_ADD((dw), txrf, NULL, "TX power and PG delay: [<power> [<pgdly>]]", cmd_txrf, 1, 2);
+SHELL_SUBCMD_ADD((dw), spi, NULL, "Fast SPI rate: [<hz> | cal]", cmd_spi, 1, 1);
+SHELL_SUBCMD_ADD((dw), antdly, NULL, "Antenna delays: [<tx> [<rx>]]", cmd_antdly, 1, 2);
+SHELL_SUBCMD_ADD((dw), evc, NULL, "Event counters: [clear]", cmd_evc, 1, 1);
+SHELL_SUBCMD_ADD((dw), probe, NULL, "Timing probes: [reset]", cmd_probe, 1, 1);
+SHELL_SUBCMD_ADD((dw), irq, NULL, "IRQ latency: [reset]", cmd_irq, 1, 1);
+#ifdef DWT_SPI_PROFILE
+SHELL_SUBCMD_ADD((dw), prof, NULL, "SPI traffic profile: [reset]", cmd_prof, 1, 1);
+#endif
+SHELL_SUBCMD_ADD((dw), cir, NULL, "CIR around the first path of the last frame: [<count>]", cmd_cir, 1, 1);
+
+SHELL_CMD_REGISTER(dw, &dw_cmds, "DW3000 commands", NULL);
+#endif /* CONFIG_SHELL */
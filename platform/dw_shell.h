@@ -0,0 +1,65 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_shell.h
+ * @brief   Zephyr shell commands for the DW3000 (CONFIG_SHELL)
+ *
+ *          The "dw" command gives field access to the radio settings and the
+ *          profiling data without rebuilding:
+ *
+ *          dw info                     device ID, SPI rate
+ *          dw phy                      show the PHY configuration
+ *          dw phy <param> <value>      change one parameter (chan, plen, pac,
+ *                                      txcode, rxcode, sfd, br, phrmode,
+ *                                      phrrate, sfdto, sts, stslen, pdoa)
+ *          dw phy apply                dwt_configure() with the changes
+ *          dw txrf [<power> [<pgdly>]] show or set the TX power and PG delay
+ *          dw spi [<hz> | cal]         show or set the fast SPI rate, or
+ *                                      calibrate it
+ *          dw antdly [<tx> [<rx>]]     show or set the antenna delays
+ *          dw evc [clear]              event counters
+ *          dw probe [reset]            timing probes (DWM_PROBES)
+ *          dw irq [reset]              IRQ latency (DWM_IRQ_DEFERRED)
+ *          dw prof [reset]             SPI traffic profiler (DWT_SPI_PROFILE)
+ *          dw cir [<count>]            CIR samples around the first path of
+ *                                      the last frame received
+ *
+ *          Applications add their own subcommands to the "dw" set with
+ *          SHELL_SUBCMD_ADD((dw), ...), e.g. the reply delays of the TWR
+ *          engine in ex_05e_twr_engine.
+ *
+ *          The commands run in the shell thread and cost nothing while no
+ *          command is entered. They access the DW3000 like any other thread:
+ *          build with DWT_THREAD_SAFE when the application uses it at the same
+ *          time, and prefer changing the PHY while the radio is idle.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef DW_SHELL_H_
+#define DW_SHELL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_device_api.h"
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_shell_init()
+ *
+ * @brief Give the shell the configurations in use, "dw phy" and "dw txrf" edit them in place.
+ *
+ * @param config    PHY configuration given to dwt_configure()
+ * @param txconfig  TX spectrum configuration given to dwt_configuretxrf(), may be NULL
+ *
+ * @return none
+ */
+void dw_shell_init(dwt_config_t * config, dwt_txconfig_t * txconfig);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DW_SHELL_H_ */
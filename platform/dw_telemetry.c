@@ -0,0 +1,194 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_telemetry.c
+ * @brief   Periodic DW IC event counter telemetry
+ *
+ *          See dw_telemetry.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "dw_telemetry.h"
+
+#include <zephyr/kernel.h>
+#if defined(CONFIG_STATS)
+#include <zephyr/stats/stats.h>
+#endif
+
+#define EVC_12BIT_MASK  0xFFF
+#define EVC_8BIT_MASK   0xFF
+
+#if defined(CONFIG_STATS)
+STATS_SECT_START(dw_evc)
+    STATS_SECT_ENTRY32(phe)
+    STATS_SECT_ENTRY32(rsl)
+    STATS_SECT_ENTRY32(crcg)
+    STATS_SECT_ENTRY32(crcb)
+    STATS_SECT_ENTRY32(arfe)
+    STATS_SECT_ENTRY32(over)
+    STATS_SECT_ENTRY32(sfdto)
+    STATS_SECT_ENTRY32(pto)
+    STATS_SECT_ENTRY32(rto)
+    STATS_SECT_ENTRY32(txf)
+    STATS_SECT_ENTRY32(hpw)
+    STATS_SECT_ENTRY32(crce)
+    STATS_SECT_ENTRY32(prej)
+    STATS_SECT_ENTRY32(rx_mfps)
+    STATS_SECT_ENTRY32(tx_mfps)
+    STATS_SECT_ENTRY32(err_mfps)
+    STATS_SECT_ENTRY32(per_permille)
+STATS_SECT_END;
+
+STATS_NAME_START(dw_evc)
+    STATS_NAME(dw_evc, phe)
+    STATS_NAME(dw_evc, rsl)
+    STATS_NAME(dw_evc, crcg)
+    STATS_NAME(dw_evc, crcb)
+    STATS_NAME(dw_evc, arfe)
+    STATS_NAME(dw_evc, over)
+    STATS_NAME(dw_evc, sfdto)
+    STATS_NAME(dw_evc, pto)
+    STATS_NAME(dw_evc, rto)
+    STATS_NAME(dw_evc, txf)
+    STATS_NAME(dw_evc, hpw)
+    STATS_NAME(dw_evc, crce)
+    STATS_NAME(dw_evc, prej)
+    STATS_NAME(dw_evc, rx_mfps)
+    STATS_NAME(dw_evc, tx_mfps)
+    STATS_NAME(dw_evc, err_mfps)
+    STATS_NAME(dw_evc, per_permille)
+STATS_NAME_END(dw_evc);
+
+static STATS_SECT_DECL(dw_evc) dw_evc_stats;
+#endif
+
+static struct
+{
+    uint32_t                period_ms;
+    uint32_t                last_ms;
+    dwt_deviceentcnts_t     prev;
+    dw_telemetry_totals_t   totals;
+    dw_telemetry_rates_t    rates;
+#if defined(CONFIG_STATS)
+    uint8_t                 registered;
+#endif
+} tel;
+
+/* Difference of two reads of a wrapping counter */
+#define EVC_DELTA(cnt, field, mask) (((uint32_t)(cnt).field - (uint32_t)tel.prev.field) & (mask))
+
+int dw_telemetry_init(uint32_t period_ms, uint32_t now_ms)
+{
+    memset(&tel.totals, 0, sizeof(tel.totals));
+    memset(&tel.rates, 0, sizeof(tel.rates));
+    tel.period_ms = period_ms;
+    tel.last_ms = now_ms;
+
+    dwt_configeventcounters(1);
+    dwt_readeventcounters(&tel.prev);
+
+#if defined(CONFIG_STATS)
+    if (!tel.registered) {
+        if (stats_init_and_reg(STATS_HDR(dw_evc_stats), STATS_SIZE_INIT_PARMS(dw_evc_stats, STATS_SIZE_32),
+                               STATS_NAME_INIT_PARMS(dw_evc), "dw_evc") != 0) {
+            return -1;
+        }
+        tel.registered = 1;
+    }
+    else {
+        stats_reset(STATS_HDR(dw_evc_stats));
+    }
+#endif
+
+    return 0;
+}
+
+int dw_telemetry_poll(uint32_t now_ms)
+{
+    dwt_deviceentcnts_t cnt;
+    uint32_t elapsed = now_ms - tel.last_ms;
+    uint32_t phe, rsl, crcg, crcb, arfe, over, sfdto, pto, rto, txf, hpw, crce, prej;
+    uint32_t bad;
+
+    if ((elapsed < tel.period_ms) || (elapsed == 0)) {
+        return 0;
+    }
+
+    dwt_readeventcounters(&cnt);
+
+    phe   = EVC_DELTA(cnt, PHE, EVC_12BIT_MASK);
+    rsl   = EVC_DELTA(cnt, RSL, EVC_12BIT_MASK);
+    crcg  = EVC_DELTA(cnt, CRCG, EVC_12BIT_MASK);
+    crcb  = EVC_DELTA(cnt, CRCB, EVC_12BIT_MASK);
+    arfe  = EVC_DELTA(cnt, ARFE, EVC_8BIT_MASK);
+    over  = EVC_DELTA(cnt, OVER, EVC_8BIT_MASK);
+    sfdto = EVC_DELTA(cnt, SFDTO, EVC_12BIT_MASK);
+    pto   = EVC_DELTA(cnt, PTO, EVC_12BIT_MASK);
+    rto   = EVC_DELTA(cnt, RTO, EVC_8BIT_MASK);
+    txf   = EVC_DELTA(cnt, TXF, EVC_12BIT_MASK);
+    hpw   = EVC_DELTA(cnt, HPW, EVC_8BIT_MASK);
+    crce  = EVC_DELTA(cnt, CRCE, EVC_8BIT_MASK);
+    prej  = EVC_DELTA(cnt, PREJ, EVC_12BIT_MASK);
+    tel.prev = cnt;
+    tel.last_ms = now_ms;
+
+    tel.totals.phe += phe;
+    tel.totals.rsl += rsl;
+    tel.totals.crcg += crcg;
+    tel.totals.crcb += crcb;
+    tel.totals.arfe += arfe;
+    tel.totals.over += over;
+    tel.totals.sfdto += sfdto;
+    tel.totals.pto += pto;
+    tel.totals.rto += rto;
+    tel.totals.txf += txf;
+    tel.totals.hpw += hpw;
+    tel.totals.crce += crce;
+    tel.totals.prej += prej;
+    tel.totals.snapshots++;
+
+    /* Rates in events per 1000 s, so low rates keep some resolution */
+    bad = phe + rsl + crcb;
+    tel.rates.period_ms = elapsed;
+    tel.rates.rx_mfps = (uint32_t)((uint64_t)(crcg + crcb) * 1000000 / elapsed);
+    tel.rates.tx_mfps = (uint32_t)((uint64_t)txf * 1000000 / elapsed);
+    tel.rates.err_mfps = (uint32_t)((uint64_t)(bad + sfdto) * 1000000 / elapsed);
+    tel.rates.per_permille = (bad + crcg != 0) ? (uint16_t)(bad * 1000 / (bad + crcg)) : 0;
+
+#if defined(CONFIG_STATS)
+    STATS_INCN(dw_evc_stats, phe, phe);
+    STATS_INCN(dw_evc_stats, rsl, rsl);
+    STATS_INCN(dw_evc_stats, crcg, crcg);
+    STATS_INCN(dw_evc_stats, crcb, crcb);
+    STATS_INCN(dw_evc_stats, arfe, arfe);
+    STATS_INCN(dw_evc_stats, over, over);
+    STATS_INCN(dw_evc_stats, sfdto, sfdto);
+    STATS_INCN(dw_evc_stats, pto, pto);
+    STATS_INCN(dw_evc_stats, rto, rto);
+    STATS_INCN(dw_evc_stats, txf, txf);
+    STATS_INCN(dw_evc_stats, hpw, hpw);
+    STATS_INCN(dw_evc_stats, crce, crce);
+    STATS_INCN(dw_evc_stats, prej, prej);
+    STATS_SET(dw_evc_stats, rx_mfps, tel.rates.rx_mfps);
+    STATS_SET(dw_evc_stats, tx_mfps, tel.rates.tx_mfps);
+    STATS_SET(dw_evc_stats, err_mfps, tel.rates.err_mfps);
+    STATS_SET(dw_evc_stats, per_permille, tel.rates.per_permille);
+#endif
+
+    return 1;
+}
+
+const dw_telemetry_totals_t * dw_telemetry_get_totals(void)
+{
+    return &tel.totals;
+}
+
+const dw_telemetry_rates_t * dw_telemetry_get_rates(void)
+{
+    return &tel.rates;
+}
@@ -0,0 +1,114 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_telemetry.h
+ * @brief   Periodic DW IC event counter telemetry
+ *
+ *          Snapshots the DW IC event counters (dwt_readeventcounters(), 7 SPI
+ *          reads) once per period, turns the differences to the previous
+ *          snapshot into 32-bit totals and rates, and publishes them in
+ *          the Zephyr stats group "dw_evc"
+ *          (CONFIG_STATS, names with CONFIG_STATS_NAMES), where they can be
+ *          read like any other stats group (e.g. the mcumgr stats commands).
+ *
+ *          The counters are not cleared by the telemetry after its init: the
+ *          hardware counters (12 or 8 bits) wrap, only their differences are
+ *          used, so the period must be short enough for no counter to wrap
+ *          twice (255 events of the 8-bit ones: about 25 s at 10 frames/s).
+ *          Other readers (e.g. sniff_sched.c) can share the counters as long
+ *          as nobody clears them once the telemetry runs.
+ *
+ *          There is no timer or work item: the application calls
+ *          dw_telemetry_poll() from its own loop where the SPI is idle (e.g.
+ *          between two ranging exchanges), and the counters are only read
+ *          when a period has elapsed, never on the ranging path.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef DW_TELEMETRY_H_
+#define DW_TELEMETRY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "deca_device_api.h"
+
+/* Totals since dw_telemetry_init() */
+typedef struct
+{
+    uint32_t phe;           /* PHY header errors */
+    uint32_t rsl;           /* RX frame sync losses */
+    uint32_t crcg;          /* frames received with a good CRC */
+    uint32_t crcb;          /* frames received with a bad CRC */
+    uint32_t arfe;          /* frames rejected by the frame filter */
+    uint32_t over;          /* RX overruns (double buffer) */
+    uint32_t sfdto;         /* SFD timeouts */
+    uint32_t pto;           /* preamble timeouts */
+    uint32_t rto;           /* RX frame wait timeouts */
+    uint32_t txf;           /* frames sent */
+    uint32_t hpw;           /* half period warnings (delayed TX/RX too late) */
+    uint32_t crce;          /* SPI CRC errors */
+    uint32_t prej;          /* preamble rejections */
+    uint32_t snapshots;
+} dw_telemetry_totals_t;
+
+/* Rates of the last period */
+typedef struct
+{
+    uint32_t rx_mfps;       /* frames received (good and bad CRC) per 1000 s */
+    uint32_t tx_mfps;       /* frames sent per 1000 s */
+    uint32_t err_mfps;      /* RX errors (PHE, RSL, CRCB, SFDTO) per 1000 s */
+    uint16_t per_permille;  /* frame error rate: (PHE + RSL + CRCB) / (those + CRCG) */
+    uint32_t period_ms;     /* length of the period */
+} dw_telemetry_rates_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_telemetry_init()
+ *
+ * @brief Enable (and clear) the event counters, clear the totals and register the stats group.
+ *
+ * @param period_ms - snapshot period
+ * @param now_ms - current time (e.g. k_uptime_get_32())
+ *
+ * @return 0 on success, -1 if the stats group could not be registered
+ */
+int dw_telemetry_init(uint32_t period_ms, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_telemetry_poll()
+ *
+ * @brief Snapshot the counters if the period has elapsed. Call where the SPI is idle.
+ *
+ * @param now_ms - current time
+ *
+ * @return 1 if a snapshot was taken, 0 if not
+ */
+int dw_telemetry_poll(uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_telemetry_get_totals()
+ *
+ * @brief Return the totals.
+ *
+ * @return totals
+ */
+const dw_telemetry_totals_t * dw_telemetry_get_totals(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_telemetry_get_rates()
+ *
+ * @brief Return the rates of the last period.
+ *
+ * @return rates
+ */
+const dw_telemetry_rates_t * dw_telemetry_get_rates(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DW_TELEMETRY_H_ */
@@ -0,0 +1,158 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_tempcomp.c
+ * @brief   Background temperature and voltage compensation of the DW IC
+ *
+ *          See dw_tempcomp.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "deca_vals.h"
+#include "dw_tempcomp.h"
+
+static struct
+{
+    dw_tempcomp_config_t    cfg;
+    int                     channel;
+    uint32_t                last_ms;
+    int64_t                 ref_ppt;        /* crystal model at the init temperature */
+    uint8_t                 ref_trim;       /* crystal trim at init */
+    dw_tempcomp_state_t     st;
+} comp;
+
+/* @fn      tempcomp_sample
+ * @brief   read the temperature and the supply voltage
+ * */
+static void tempcomp_sample(void)
+{
+    uint16_t raw = dwt_readtempvbat();
+
+    comp.st.temp_cc = (int16_t)(dwt_convertrawtemperature((uint8_t)(raw >> 8)) * 100.0f);
+    comp.st.vbat_mv = (uint16_t)(dwt_convertrawvoltage((uint8_t)raw) * 1000.0f);
+    comp.st.samples++;
+}
+
+/* @fn      tempcomp_xtal_ppt
+ * @brief   crystal frequency offset of the model at a temperature, in ppt
+ * */
+static int64_t tempcomp_xtal_ppt(int16_t temp_cc)
+{
+    int64_t dt = (int64_t)temp_cc - comp.cfg.xtal_t0_cc;
+
+    return (comp.cfg.xtal_c1_ppt * dt) / 100 +
+           (comp.cfg.xtal_c2_ppt * dt * dt) / 10000 +
+           (comp.cfg.xtal_c3_ppt * dt * dt * dt) / 1000000;
+}
+
+void dw_tempcomp_default_config(dw_tempcomp_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->period_ms = 10000;
+    cfg->temp_step_cc = 300;
+    cfg->vbat_step_mv = 100;
+    cfg->pg_comp = 1;
+    cfg->xtal_comp = 0;
+    cfg->xtal_t0_cc = 2500;
+    cfg->trim_step_ppt = 1200000;
+}
+
+int dw_tempcomp_init(const dw_tempcomp_config_t *cfg, int channel, uint32_t now_ms)
+{
+    if ((cfg == NULL) || ((channel != 5) && (channel != 9)) || (cfg->trim_step_ppt == 0)) {
+        return -1;
+    }
+
+    memset(&comp.st, 0, sizeof(comp.st));
+    comp.cfg = *cfg;
+    comp.channel = channel;
+    comp.last_ms = now_ms;
+
+    tempcomp_sample();
+    comp.st.ref_temp_cc = comp.st.temp_cc;
+    comp.st.ref_vbat_mv = comp.st.vbat_mv;
+
+    /* The PG count of the delay in use is the bandwidth to keep */
+    comp.st.pg_delay = dwt_readpgdelay();
+    if (cfg->pg_comp) {
+        comp.st.pg_count = dwt_calcpgcount(comp.st.pg_delay, channel);
+    }
+
+    comp.ref_trim = comp.st.xtal_trim = dwt_getxtaltrim();
+    comp.ref_ppt = tempcomp_xtal_ppt(comp.st.temp_cc);
+
+    return 0;
+}
+
+int dw_tempcomp_due(uint32_t now_ms)
+{
+    return (now_ms - comp.last_ms) >= comp.cfg.period_ms;
+}
+
+int dw_tempcomp_poll(uint32_t now_ms)
+{
+    int dtemp, dvbat;
+    int changed = 0;
+
+    if (!dw_tempcomp_due(now_ms)) {
+        return 0;
+    }
+    comp.last_ms = now_ms;
+
+    tempcomp_sample();
+
+    dtemp = comp.st.temp_cc - comp.st.ref_temp_cc;
+    dvbat = (int)comp.st.vbat_mv - (int)comp.st.ref_vbat_mv;
+    if ((dtemp < comp.cfg.temp_step_cc) && (dtemp > -(int)comp.cfg.temp_step_cc) &&
+        (dvbat < comp.cfg.vbat_step_mv) && (dvbat > -(int)comp.cfg.vbat_step_mv)) {
+        return 0;
+    }
+
+    comp.st.ref_temp_cc = comp.st.temp_cc;
+    comp.st.ref_vbat_mv = comp.st.vbat_mv;
+    comp.st.updates++;
+
+    if (comp.cfg.pg_comp) {
+        /* The auto calibration writes the PG delay it finds */
+        uint8_t pg_delay = dwt_calcbandwidthadj(comp.st.pg_count, comp.channel);
+
+        if (pg_delay != comp.st.pg_delay) {
+            comp.st.pg_delay = pg_delay;
+            comp.st.pg_writes++;
+            changed = 1;
+        }
+    }
+
+    if (comp.cfg.xtal_comp) {
+        /* A fast crystal needs a higher trim code (more load capacitance) */
+        int64_t ppt = tempcomp_xtal_ppt(comp.st.temp_cc) - comp.ref_ppt;
+        int64_t step = (int64_t)comp.cfg.trim_step_ppt;
+        int32_t trim = comp.ref_trim + (int32_t)((ppt >= 0) ? (ppt + step / 2) / step : (ppt - step / 2) / step);
+
+        if (trim < 0) {
+            trim = 0;
+        }
+        else if (trim > XTAL_TRIM_BIT_MASK) {
+            trim = XTAL_TRIM_BIT_MASK;
+        }
+
+        if ((uint8_t)trim != comp.st.xtal_trim) {
+            dwt_setxtaltrim((uint8_t)trim);
+            comp.st.xtal_trim = (uint8_t)trim;
+            comp.st.trim_writes++;
+            changed = 1;
+        }
+    }
+
+    return changed;
+}
+
+const dw_tempcomp_state_t * dw_tempcomp_get_state(void)
+{
+    return &comp.st;
+}
@@ -0,0 +1,138 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_tempcomp.h
+ * @brief   Background temperature and voltage compensation of the DW IC
+ *
+ *          Samples the DW IC temperature and supply voltage
+ *          (dwt_readtempvbat()) once per period and, when either has moved
+ *          by more than a threshold since the last compensation:
+ *           - re-runs the PG delay auto calibration (dwt_calcbandwidthadj())
+ *             on the PG count measured at init, which keeps the TX bandwidth,
+ *           - sets the crystal trim given by a model of the crystal frequency
+ *             against the temperature (a third order polynomial around t0,
+ *             e.g. from the crystal datasheet), written only if the code
+ *             changes.
+ *          Below the thresholds a sample costs the SAR read only (about 10
+ *          SPI transactions) and nothing is written.
+ *
+ *          The compensation is relative to the init: the TX configuration
+ *          and the crystal trim in use then are the references (calibrated
+ *          or OTP values), so call dw_tempcomp_init() once they are set.
+ *
+ *          As dw_telemetry.h, there is no timer or work item: the
+ *          application calls dw_tempcomp_poll() from its own loop, with the
+ *          transceiver off (the PG calibration forces the TX clocks), e.g.
+ *          between two exchanges or after twr_stop() on a listening anchor.
+ *          dw_tempcomp_due() tells when a sample is due, so the receiver is
+ *          only stopped then.
+ *
+ *          Temperatures in 0.01 degC, frequencies in ppt (1e-12, 1000 = 1 ppb).
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef DW_TEMPCOMP_H_
+#define DW_TEMPCOMP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "deca_device_api.h"
+
+/* Compensation configuration */
+typedef struct
+{
+    uint32_t period_ms;         /* sampling period */
+    uint16_t temp_step_cc;      /* compensation threshold on the temperature */
+    uint16_t vbat_step_mv;      /* compensation threshold on the supply voltage */
+    uint8_t  pg_comp;           /* keep the PG count (TX bandwidth) */
+    uint8_t  xtal_comp;         /* follow the crystal model with the trim */
+    int16_t  xtal_t0_cc;        /* crystal model: f(T) = c1 dT + c2 dT^2 + c3 dT^3, dT = T - t0 in degC */
+    int32_t  xtal_c1_ppt;       /* ppt/degC */
+    int32_t  xtal_c2_ppt;       /* ppt/degC^2 */
+    int32_t  xtal_c3_ppt;       /* ppt/degC^3 */
+    uint32_t trim_step_ppt;     /* frequency decrease per trim code step */
+} dw_tempcomp_config_t;
+
+/* Compensation state */
+typedef struct
+{
+    int16_t  temp_cc;           /* last sample */
+    uint16_t vbat_mv;
+    int16_t  ref_temp_cc;       /* sample of the last compensation */
+    uint16_t ref_vbat_mv;
+    uint16_t pg_count;          /* PG count target, measured at init */
+    uint8_t  pg_delay;          /* PG delay in use */
+    uint8_t  xtal_trim;         /* crystal trim in use */
+    uint32_t samples;
+    uint32_t updates;           /* compensations (thresholds passed) */
+    uint32_t pg_writes;         /* PG delay changes */
+    uint32_t trim_writes;       /* crystal trim changes */
+} dw_tempcomp_state_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_tempcomp_default_config()
+ *
+ * @brief Fill a configuration: 10 s period, 3 degC or 100 mV thresholds, PG count compensation on, crystal
+ *        compensation off (it needs the crystal curve), 1.2 ppm per trim step (about 77 ppm over the 64 codes).
+ *
+ * @param cfg - configuration to fill
+ *
+ * @return none
+ */
+void dw_tempcomp_default_config(dw_tempcomp_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_tempcomp_init()
+ *
+ * @brief Take the reference sample, measure the PG count of the PG delay in use and read the crystal trim. Device
+ *        configured (dwt_configure(), dwt_configuretxrf()), transceiver off.
+ *
+ * @param cfg - configuration (copied)
+ * @param channel - channel in use (5 or 9), for the PG calibration
+ * @param now_ms - current time (e.g. k_uptime_get_32())
+ *
+ * @return 0 on success, -1 on bad parameters
+ */
+int dw_tempcomp_init(const dw_tempcomp_config_t *cfg, int channel, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_tempcomp_due()
+ *
+ * @brief Tell if the period has elapsed, i.e. if the next dw_tempcomp_poll() samples.
+ *
+ * @param now_ms - current time
+ *
+ * @return 1 if a sample is due, 0 if not
+ */
+int dw_tempcomp_due(uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_tempcomp_poll()
+ *
+ * @brief Sample and compensate if the period has elapsed. Call with the transceiver off.
+ *
+ * @param now_ms - current time
+ *
+ * @return 1 if the PG delay or the crystal trim changed, 0 if not
+ */
+int dw_tempcomp_poll(uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_tempcomp_get_state()
+ *
+ * @brief Return the compensation state.
+ *
+ * @return state
+ */
+const dw_tempcomp_state_t * dw_tempcomp_get_state(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DW_TEMPCOMP_H_ */
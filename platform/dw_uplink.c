@@ -0,0 +1,469 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_uplink.c
+ * @brief   Gateway uplink: batches of result records to a host over UART or USB CDC ACM
+ *
+ *          See dw_uplink.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "dw_uplink.h"
+#include "dw_framepool.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/uart.h>
+
+/* COBS adds a byte per 254 and the delimiter */
+#define UPLINK_FRAME_LEN    (DW_UPLINK_BATCH_LEN + DW_UPLINK_BATCH_LEN / 254 + 2)
+
+typedef enum
+{
+    UPLINK_NONE,
+    UPLINK_ASYNC,           /* uart_tx(), DMA */
+    UPLINK_IRQ              /* uart_fifo_fill() from the TX ready interrupt */
+} uplink_mode_e;
+
+static struct
+{
+    const struct device *dev;
+    dw_uplink_config_t  cfg;
+    uplink_mode_e       mode;
+    uint8_t             batch[2][DW_UPLINK_BATCH_LEN];
+    uint8_t             fill;           /* batch being filled */
+    uint16_t            fill_len;       /* bytes in it, header included (0: empty, the header is not written yet) */
+    uint8_t             fill_count;     /* records in it */
+    uint16_t            dropped;        /* records dropped since the last batch */
+    uint16_t            seq;
+    volatile uint8_t    tx_busy;
+    volatile uint8_t    due;            /* the batch must go as soon as the frame being sent is out */
+    uint8_t             frame[UPLINK_FRAME_LEN];
+    uint16_t            frame_len;
+    uint16_t            frame_pos;      /* interrupt driven mode */
+    struct k_work_delayable flush_work;
+    dw_uplink_stats_t   stats;
+} uplink;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uplink_crc16()
+ *
+ * @brief CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+ *
+ * @param data - bytes
+ * @param len - number of bytes
+ *
+ * @return CRC
+ */
+static uint16_t uplink_crc16(const uint8_t *data, uint16_t len)
+{
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    while (len--)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uplink_cobs()
+ *
+ * @brief COBS encode and append the 0x00 delimiter.
+ *
+ * @param in - bytes
+ * @param len - number of bytes
+ * @param out - output, len + len / 254 + 2 bytes
+ *
+ * @return output length
+ */
+static uint16_t uplink_cobs(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+    uint16_t code_pos = 0;
+    uint16_t o = 1;
+    uint8_t code = 1;
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        if (in[i] == 0)
+        {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+            continue;
+        }
+        out[o++] = in[i];
+        if (++code == 0xFF)
+        {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        }
+    }
+    out[code_pos] = code;
+    out[o++] = 0;
+
+    return o;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uplink_tx_done()
+ *
+ * @brief The frame is out (or aborted): send the next batch if it is due.
+ *
+ * @return none
+ */
+static void uplink_tx_done(void)
+{
+    uplink.tx_busy = 0;
+    if (uplink.due)
+    {
+        k_work_reschedule(&uplink.flush_work, K_NO_WAIT);
+    }
+}
+
+#if defined(CONFIG_UART_ASYNC_API)
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uplink_async_cb()
+ *
+ * @brief UART asynchronous API events (interrupt context).
+ *
+ * @return none
+ */
+static void uplink_async_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+    (void)dev;
+    (void)user_data;
+
+    switch (evt->type)
+    {
+    case UART_TX_DONE:
+        uplink.stats.bytes += evt->data.tx.len;
+        uplink_tx_done();
+        break;
+
+    case UART_TX_ABORTED:
+        uplink.stats.bytes += evt->data.tx.len;
+        uplink.stats.aborted++;
+        uplink_tx_done();
+        break;
+
+    default:
+        break;
+    }
+}
+#endif
+
+#if defined(CONFIG_UART_INTERRUPT_DRIVEN)
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uplink_irq_cb()
+ *
+ * @brief UART interrupt: fill the TX FIFO with the rest of the frame (interrupt context).
+ *
+ * @return none
+ */
+static void uplink_irq_cb(const struct device *dev, void *user_data)
+{
+    int n;
+
+    (void)user_data;
+
+    while (uart_irq_update(dev) && uart_irq_is_pending(dev))
+    {
+        if (!uart_irq_tx_ready(dev))
+        {
+            continue;
+        }
+        if (uplink.frame_pos < uplink.frame_len)
+        {
+            n = uart_fifo_fill(dev, &uplink.frame[uplink.frame_pos], uplink.frame_len - uplink.frame_pos);
+            if (n > 0)
+            {
+                uplink.frame_pos += (uint16_t)n;
+                uplink.stats.bytes += (uint32_t)n;
+            }
+        }
+        else
+        {
+            uart_irq_tx_disable(dev);
+            uplink_tx_done();
+        }
+    }
+}
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uplink_host_ready()
+ *
+ * @brief USB CDC ACM: the host has opened the port (DTR). Always true on a device without line control.
+ *
+ * @return 1 if ready
+ */
+static int uplink_host_ready(void)
+{
+#if defined(CONFIG_UART_LINE_CTRL)
+    uint32_t dtr = 0;
+
+    if (uart_line_ctrl_get(uplink.dev, UART_LINE_CTRL_DTR, &dtr) == 0)
+    {
+        return dtr != 0;
+    }
+#endif
+    return 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uplink_flush_handler()
+ *
+ * @brief Work item: close the batch being filled, encode it and start sending it.
+ *
+ * @return none
+ */
+static void uplink_flush_handler(struct k_work *work)
+{
+    uint8_t *batch;
+    uint16_t len;
+    uint16_t crc;
+    unsigned int key;
+    int ret = -ENOTSUP;
+
+    (void)work;
+
+    key = irq_lock();
+    if (uplink.fill_len == 0)
+    {
+        uplink.due = 0;
+        irq_unlock(key);
+        return;
+    }
+    if (uplink.tx_busy)
+    {
+        /* uplink_tx_done() resubmits */
+        uplink.due = 1;
+        irq_unlock(key);
+        return;
+    }
+
+    /* Close the batch, the other one takes the next records */
+    batch = uplink.batch[uplink.fill];
+    len = uplink.fill_len;
+    batch[1] = uplink.fill_count;
+    batch[6] = (uint8_t)uplink.dropped;
+    batch[7] = (uint8_t)(uplink.dropped >> 8);
+    uplink.fill ^= 1;
+    uplink.fill_len = 0;
+    uplink.fill_count = 0;
+    uplink.dropped = 0;
+    uplink.due = 0;
+    uplink.tx_busy = 1;
+    irq_unlock(key);
+
+    crc = uplink_crc16(batch, len);
+    batch[len++] = (uint8_t)crc;
+    batch[len++] = (uint8_t)(crc >> 8);
+
+    if (!uplink_host_ready())
+    {
+        uplink.stats.no_host++;
+        uplink_tx_done();
+        return;
+    }
+
+    uplink.frame_len = uplink_cobs(batch, len, uplink.frame);
+    uplink.frame_pos = 0;
+    uplink.stats.batches++;
+
+#if defined(CONFIG_UART_ASYNC_API)
+    if (uplink.mode == UPLINK_ASYNC)
+    {
+        ret = uart_tx(uplink.dev, uplink.frame, uplink.frame_len, uplink.cfg.tx_timeout_us);
+    }
+#endif
+#if defined(CONFIG_UART_INTERRUPT_DRIVEN)
+    if (uplink.mode == UPLINK_IRQ)
+    {
+        uart_irq_tx_enable(uplink.dev);
+        ret = 0;
+    }
+#endif
+    if (ret != 0)
+    {
+        uplink.stats.aborted++;
+        uplink_tx_done();
+    }
+}
+
+int dw_uplink_init(const struct device *dev, const dw_uplink_config_t *cfg)
+{
+    if ((dev == NULL) || (cfg == NULL) || !device_is_ready(dev))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&uplink, 0, sizeof(uplink));
+    uplink.dev = dev;
+    uplink.cfg = *cfg;
+    k_work_init_delayable(&uplink.flush_work, uplink_flush_handler);
+
+#if defined(CONFIG_UART_ASYNC_API)
+    if (uart_callback_set(dev, uplink_async_cb, NULL) == 0)
+    {
+        uplink.mode = UPLINK_ASYNC;
+    }
+#endif
+#if defined(CONFIG_UART_INTERRUPT_DRIVEN)
+    if (uplink.mode == UPLINK_NONE)
+    {
+        uart_irq_callback_user_data_set(dev, uplink_irq_cb, NULL);
+        uart_irq_rx_disable(dev);
+        uart_irq_tx_disable(dev);
+        uplink.mode = UPLINK_IRQ;
+    }
+#endif
+
+    return (uplink.mode == UPLINK_NONE) ? DWT_ERROR : DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uplink_put()
+ *
+ * @brief Append a record made of two pieces to the batch, see dw_uplink_put().
+ *
+ * @param type - record type
+ * @param head - first piece
+ * @param head_len - first piece length
+ * @param payload - second piece
+ * @param len - second piece length, head_len + len up to DW_UPLINK_REC_MAX
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the record was dropped
+ */
+static int uplink_put(uint8_t type, const void *head, uint8_t head_len, const void *payload, uint8_t len)
+{
+    uint8_t *batch;
+    uint32_t now;
+    unsigned int key;
+
+    if (uplink.mode == UPLINK_NONE)
+    {
+        /* Not initialised */
+        return DWT_ERROR;
+    }
+
+    key = irq_lock();
+    batch = uplink.batch[uplink.fill];
+
+    if (uplink.fill_len == 0)
+    {
+        /* Open the batch: count and dropped are written when it is closed */
+        now = k_uptime_get_32();
+        batch[0] = DW_UPLINK_VERSION;
+        batch[2] = (uint8_t)uplink.cfg.src;
+        batch[3] = (uint8_t)(uplink.cfg.src >> 8);
+        batch[4] = (uint8_t)uplink.seq;
+        batch[5] = (uint8_t)(uplink.seq >> 8);
+        batch[8] = (uint8_t)now;
+        batch[9] = (uint8_t)(now >> 8);
+        batch[10] = (uint8_t)(now >> 16);
+        batch[11] = (uint8_t)(now >> 24);
+        uplink.seq++;
+        uplink.fill_len = DW_UPLINK_HDR_LEN;
+        k_work_schedule(&uplink.flush_work, K_MSEC(uplink.cfg.latency_ms));
+    }
+
+    if ((uplink.fill_count == UINT8_MAX) ||
+        (uplink.fill_len + DW_UPLINK_REC_HDR_LEN + head_len + len + DW_UPLINK_CRC_LEN > DW_UPLINK_BATCH_LEN))
+    {
+        /* Full: send it now, the record is lost */
+        uplink.dropped++;
+        uplink.stats.dropped++;
+        irq_unlock(key);
+        k_work_reschedule(&uplink.flush_work, K_NO_WAIT);
+        return DWT_ERROR;
+    }
+
+    batch[uplink.fill_len] = type;
+    batch[uplink.fill_len + 1] = head_len + len;
+    if (head_len != 0)
+    {
+        memcpy(&batch[uplink.fill_len + DW_UPLINK_REC_HDR_LEN], head, head_len);
+    }
+    memcpy(&batch[uplink.fill_len + DW_UPLINK_REC_HDR_LEN + head_len], payload, len);
+    uplink.fill_len += DW_UPLINK_REC_HDR_LEN + head_len + len;
+    uplink.fill_count++;
+    uplink.stats.records++;
+    irq_unlock(key);
+
+    return DWT_SUCCESS;
+}
+
+int dw_uplink_put(uint8_t type, const void *payload, uint8_t len)
+{
+    return uplink_put(type, NULL, 0, payload, len);
+}
+
+int dw_uplink_frame(const dw_frame_t *frame)
+{
+    uint8_t head[DW_UPLINK_FRAME_HDR_LEN];
+
+    if (frame->len > DW_UPLINK_REC_MAX - DW_UPLINK_FRAME_HDR_LEN)
+    {
+        return DWT_ERROR;
+    }
+
+    memcpy(head, frame->rx_stamp, sizeof(frame->rx_stamp));
+    head[5] = frame->rx_flags;
+
+    return uplink_put(DW_UPLINK_FRAME, head, DW_UPLINK_FRAME_HDR_LEN, frame->data, (uint8_t)frame->len);
+}
+
+int dw_uplink_cir_write(const uint8_t *data, uint16_t len)
+{
+    uint16_t room;
+    unsigned int key;
+
+    /* Take what fits in the batch: cir_stream keeps the rest for its next poll */
+    key = irq_lock();
+    room = (uplink.fill_len == 0) ? (DW_UPLINK_BATCH_LEN - DW_UPLINK_HDR_LEN) : (DW_UPLINK_BATCH_LEN - uplink.fill_len);
+    irq_unlock(key);
+
+    if (room <= DW_UPLINK_REC_HDR_LEN + DW_UPLINK_CRC_LEN)
+    {
+        dw_uplink_flush();
+        return 0;
+    }
+    room -= DW_UPLINK_REC_HDR_LEN + DW_UPLINK_CRC_LEN;
+    if (len > room)
+    {
+        len = room;
+    }
+    if (len > DW_UPLINK_REC_MAX)
+    {
+        len = DW_UPLINK_REC_MAX;
+    }
+
+    if (dw_uplink_put(DW_UPLINK_CIR, data, (uint8_t)len) != DWT_SUCCESS)
+    {
+        return 0;
+    }
+    return len;
+}
+
+void dw_uplink_flush(void)
+{
+    k_work_reschedule(&uplink.flush_work, K_NO_WAIT);
+}
+
+const dw_uplink_stats_t * dw_uplink_get_stats(void)
+{
+    return &uplink.stats;
+}
@@ -0,0 +1,163 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw_uplink.h
+ * @brief   Gateway uplink: batches of result records to a host over UART or USB CDC ACM
+ *
+ *          Records (range, TDoA, CIR, ...) are appended to a batch as type,
+ *          length, payload. A batch is sent when it is full, when its first
+ *          record has waited latency_ms, or on dw_uplink_flush(), as one
+ *          frame:
+ *
+ *          batch   version count src(2) seq(2) dropped(2) time_ms(4) records crc(2)
+ *          record  type len payload(len)
+ *          frame   COBS(batch) 0x00
+ *
+ *          little endian, crc is CRC-16/CCITT-FALSE of the batch, src the
+ *          anchor address, seq the batch sequence number, dropped the records
+ *          dropped (full batch) since the previous batch and time_ms the
+ *          uptime when the batch was opened. COBS removes every 0x00 from the
+ *          batch, so the host finds the frames by the 0x00 delimiter and
+ *          resynchronises on the next one after an error. The host decoder is
+ *          tools/uplink_decode.py.
+ *
+ *          dw_uplink_put() only copies the record into the batch (under
+ *          irq_lock(), callable from the DW IC callbacks) and never blocks:
+ *          a record that does not fit in the batch being filled is dropped and
+ *          counted. The frame is encoded on the system work queue and sent
+ *          with the UART asynchronous API (DMA, CONFIG_UART_ASYNC_API) when
+ *          the device has it, else interrupt driven (USB CDC ACM). A batch
+ *          fills while the previous frame is sent.
+ *
+ *          Flow control: on a UART with hw-flow-control the DMA follows CTS,
+ *          and a frame held longer than tx_timeout_us is aborted. On USB CDC
+ *          ACM, nothing is sent while the host has not set DTR (port not
+ *          opened): the batches are dropped (no_host).
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef DW_UPLINK_H_
+#define DW_UPLINK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <zephyr/device.h>
+
+#ifndef DW_UPLINK_BATCH_LEN
+#define DW_UPLINK_BATCH_LEN     512         /* bytes of a batch, header and CRC included */
+#endif
+
+#define DW_UPLINK_VERSION       1
+#define DW_UPLINK_HDR_LEN       12
+#define DW_UPLINK_CRC_LEN       2
+#define DW_UPLINK_REC_HDR_LEN   2
+#define DW_UPLINK_REC_MAX       255         /* longest record payload */
+
+/* Record types, range/diag/timing as the binary log (dw_binlog.h) */
+#define DW_UPLINK_RANGE         1           /* dw_binlog_range_t */
+#define DW_UPLINK_DIAG          2           /* dw_binlog_diag_t */
+#define DW_UPLINK_TIMING        3           /* dw_binlog_timing_t */
+#define DW_UPLINK_TDOA          4           /* tdoa_record_pack(), TDOA_RECORD_LEN */
+#define DW_UPLINK_CIR           5           /* piece of a cir_stream record, in order */
+#define DW_UPLINK_POSITION      6           /* multilat_fix_pack(), MULTILAT_RECORD_LEN */
+#define DW_UPLINK_FRAME         7           /* dw_uplink_frame(): rx_stamp(5) rx_flags frame */
+
+#define DW_UPLINK_FRAME_HDR_LEN 6
+
+struct dw_frame;     /* dw_framepool.h */
+
+typedef struct
+{
+    uint16_t    src;                /* anchor address, in each batch */
+    uint16_t    latency_ms;         /* longest a record waits before its batch is sent */
+    int32_t     tx_timeout_us;      /* UART DMA: abort a frame held (CTS) longer than this, SYS_FOREVER_US never */
+} dw_uplink_config_t;
+
+typedef struct
+{
+    uint32_t    records;            /* records put in a batch */
+    uint32_t    dropped;            /* records dropped, batch full */
+    uint32_t    batches;            /* frames sent */
+    uint32_t    bytes;              /* frame bytes sent, COBS and delimiter included */
+    uint32_t    aborted;            /* frames aborted (CTS timeout) or refused by the driver */
+    uint32_t    no_host;            /* batches dropped, USB host not connected (DTR off) */
+} dw_uplink_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_uplink_init()
+ *
+ * @brief Set the device and configuration, and clear the batches and counters.
+ *
+ * @param dev - UART or CDC ACM device (e.g. DEVICE_DT_GET(DT_CHOSEN(dw_uplink)))
+ * @param cfg - configuration, copied
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the device is not ready or supports neither API
+ */
+int dw_uplink_init(const struct device *dev, const dw_uplink_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_uplink_put()
+ *
+ * @brief Append a record to the batch. Does not block, can be called from interrupt context.
+ *
+ * @param type - record type
+ * @param payload - payload
+ * @param len - payload length, up to DW_UPLINK_REC_MAX
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the record was dropped
+ */
+int dw_uplink_put(uint8_t type, const void *payload, uint8_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_uplink_frame()
+ *
+ * @brief Append a received frame of the frame pool (dw_frame_rx()) as a DW_UPLINK_FRAME record, e.g. for a sniffer.
+ *        The frame is copied into the batch: the caller keeps its reference. Does not block, can be called from
+ *        interrupt context.
+ *
+ * @param frame - frame, up to DW_UPLINK_REC_MAX - DW_UPLINK_FRAME_HDR_LEN bytes
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the record was dropped (or the frame is too long)
+ */
+int dw_uplink_frame(const struct dw_frame *frame);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_uplink_cir_write()
+ *
+ * @brief cir_stream transport (cir_stream_write_t): the bytes are appended as DW_UPLINK_CIR records.
+ *
+ * @param data - bytes
+ * @param len - number of bytes
+ *
+ * @return number of bytes taken, 0 while the batch is full
+ */
+int dw_uplink_cir_write(const uint8_t *data, uint16_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_uplink_flush()
+ *
+ * @brief Send the batch now (as soon as the previous frame is out).
+ *
+ * @return none
+ */
+void dw_uplink_flush(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_uplink_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @return counters
+ */
+const dw_uplink_stats_t * dw_uplink_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DW_UPLINK_H_ */
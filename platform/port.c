@@ -15,6 +15,7 @@
 
 #include "port.h"
 #include "deca_device_api.h"
+#include "deca_regs.h"
 #include "deca_spi.h"
 
 // zephyr includes
@@ -25,6 +26,10 @@
 #include <soc.h>
 
 #include <zephyr/drivers/gpio.h>
+#if defined(CONFIG_SETTINGS)
+#include <stdio.h>
+#include <zephyr/settings/settings.h>
+#endif
 
 #define LOG_LEVEL 3
 #include <zephyr/logging/log.h>
@@ -37,51 +42,137 @@ LOG_MODULE_REGISTER(port);
  *
  *******************************************************************************/
 
-#define IRQ_GPIO_PORT      DT_NODE_FULL_NAME(DT_PHANDLE_BY_IDX(DT_INST(0, qorvo_dwm3000), dwm_irq_gpios, 0))
-#define IRQ_GPIO_PIN       DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_irq_gpios, pin)
-#define IRQ_GPIO_FLAGS     DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_irq_gpios, flags)
-
-#define WAKEUP_GPIO_PORT   DT_NODE_FULL_NAME(DT_PHANDLE_BY_IDX(DT_INST(0, qorvo_dwm3000), dwm_wakeup_gpios, 0))
-#define WAKEUP_GPIO_PIN    DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_wakeup_gpios, pin)
-#define WAKEUP_GPIO_FLAGS  DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_wakeup_gpios, flags)
+#define DT_DRV_COMPAT   qorvo_dwm3000
 
-#define RESET_GPIO_PORT    DT_NODE_FULL_NAME(DT_PHANDLE_BY_IDX(DT_INST(0, qorvo_dwm3000), dwm_reset_gpios, 0))
-#define RESET_GPIO_PIN     DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_reset_gpios, pin)
-#define RESET_GPIO_FLAGS   DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_reset_gpios, flags)
+#define DWM_INST_COUNT  DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT)
 
-#define RX_LED_GPIO_PORT   DT_NODE_FULL_NAME(DT_PHANDLE_BY_IDX(DT_INST(0, qorvo_dwm3000), dwm_rx_led_gpios, 0))
-#define RX_LED_GPIO_PIN    DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_rx_led_gpios, pin)
-#define RX_LED_GPIO_FLAGS  DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_rx_led_gpios, flags)
+/* Longest wait for SPIRDY in port_wakeup_dw3000() and port_wakeup_dw3000_fast() */
+#ifndef PORT_WAKEUP_TIMEOUT_MS
+#define PORT_WAKEUP_TIMEOUT_MS  5
+#endif
 
-#define TX_LED_GPIO_PORT   DT_NODE_FULL_NAME(DT_PHANDLE_BY_IDX(DT_INST(0, qorvo_dwm3000), dwm_tx_led_gpios, 0))
-#define TX_LED_GPIO_PIN    DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_tx_led_gpios, pin)
-#define TX_LED_GPIO_FLAGS  DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_tx_led_gpios, flags)
+/* port_wakeup_dw3000() without the IRQ handler: CS low time that wakes the
+ * DW3000 (at least 500us) */
+#ifndef PORT_WAKEUP_CS_US
+#define PORT_WAKEUP_CS_US       500
+#endif
 
-#define IRQ_GPIO_PORT      DT_NODE_FULL_NAME(DT_PHANDLE_BY_IDX(DT_INST(0, qorvo_dwm3000), dwm_irq_gpios, 0))
-#define IRQ_GPIO_PIN       DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_irq_gpios, pin)
-#define IRQ_GPIO_FLAGS     DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_irq_gpios, flags)
+/* Longest wait for the RSTn release and for SPIRDY in port_reset_dw3000() */
+#ifndef PORT_RESET_TIMEOUT_MS
+#define PORT_RESET_TIMEOUT_MS   5
+#endif
 
-#define POL_GPIO_PORT      DT_NODE_FULL_NAME(DT_PHANDLE_BY_IDX(DT_INST(0, qorvo_dwm3000), dwm_spi_pol_gpios, 0))
-#define POL_GPIO_PIN       DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_spi_pol_gpios, pin)
-#define POL_GPIO_FLAGS     DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_spi_pol_gpios, flags)
+/* Strategy of reset_DWIC(), see port_reset_dw3000() */
+#ifndef PORT_RESET_MODE
+#define PORT_RESET_MODE         PORT_RESET_SOFT
+#endif
 
-#define PHA_GPIO_PORT      DT_NODE_FULL_NAME(DT_PHANDLE_BY_IDX(DT_INST(0, qorvo_dwm3000), dwm_spi_pha_gpios, 0))
-#define PHA_GPIO_PIN       DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_spi_pha_gpios, pin)
-#define PHA_GPIO_FLAGS     DT_PHA(DT_INST(0, qorvo_dwm3000), dwm_spi_pha_gpios, flags)
+/* port_sync_dw_ics(): slack on the time from the SYNC pulse to the read back,
+ * for the host timer resolution */
+#ifndef PORT_SYNC_MARGIN_US
+#define PORT_SYNC_MARGIN_US     100
+#endif
 
 /****************************************************************************//**
  *
  *******************************************************************************/
 
-static struct gpio_callback gpio_cb;
+#if defined(DWM_IRQ_DEFERRED)
+/*
+ * Deferred IRQ handling: the GPIO ISR only timestamps the edge and wakes
+ * a cooperative thread, which runs the DW3000 handler (dwt_isr) and so
+ * all its SPI traffic and the driver callbacks in thread context.
+ * Enable with add_definitions(-DDWM_IRQ_DEFERRED) in the CMakeLists.txt.
+ * There is one thread per DW3000 instance.
+ */
+#ifndef DWM_IRQ_THREAD_PRIO
+#define DWM_IRQ_THREAD_PRIO        K_PRIO_COOP(2)
+#endif
+#ifndef DWM_IRQ_THREAD_STACK_SIZE
+#define DWM_IRQ_THREAD_STACK_SIZE  1024
+#endif
+
+static K_THREAD_STACK_ARRAY_DEFINE(dwm_irq_stacks, DWM_INST_COUNT, DWM_IRQ_THREAD_STACK_SIZE);
+#elif defined(DWT_THREAD_SAFE)
+/* An ISR cannot wait for the device lock, so with several threads on a
+ * device the handler must run in the IRQ thread */
+#error "DWT_THREAD_SAFE requires DWM_IRQ_DEFERRED"
+#endif
+
+/* Per DW3000 instance pins and IRQ state, one per "qorvo,dwm3000" node */
+struct dwm_port_inst {
+    struct gpio_dt_spec  wakeup;
+    struct gpio_dt_spec  reset;
+    struct gpio_dt_spec  rx_led;
+    struct gpio_dt_spec  tx_led;
+    struct gpio_dt_spec  irq;
+    struct gpio_dt_spec  pol;
+    struct gpio_dt_spec  pha;
+    struct gpio_dt_spec  sync;      /* optional, port == NULL without */
+
+    struct gpio_callback gpio_cb;
+    port_deca_isr_t      irq_handler;
+
+    /* port_wakeup_dw3000(), port_wakeup_dw3000_fast(), port_reset_dw3000():
+     * the next IRQ edge is the SPIRDY event */
+    struct k_sem         wake_sem;
+    volatile bool        waking;
+
+    /* port_reset_dw3000(): RSTn released by the DW3000 */
+    struct gpio_callback rst_cb;
+    struct k_sem         rst_sem;
+
+#if defined(DWM_IRQ_DEFERRED)
+    struct k_thread      irq_thread;
+    struct k_sem         irq_sem;
+    volatile uint32_t    irq_cycles;
+    port_irq_latency_t   irq_latency;
+#else
+    /* handler run from the system work queue when the bus was busy */
+    struct k_work        irq_work;
+#endif
 
-static const struct device * wakeup_dev = NULL;
-static const struct device * reset_dev  = NULL;
-static const struct device * rx_led_dev = NULL;
-static const struct device * tx_led_dev = NULL;
-static const struct device * irq_dev    = NULL;
-static const struct device * pha_dev    = NULL;
-static const struct device * pol_dev    = NULL;
+    /* timing probes of the instance, see port_probe_start() */
+    port_probe_t         probes[DWT_PROBE_COUNT];
+};
+
+#define DWM_PROBES_INIT                                         \
+    {                                                           \
+        [DWT_PROBE_SPI]    = { .name = "spi"    },              \
+        [DWT_PROBE_ISR]    = { .name = "isr"    },              \
+        [DWT_PROBE_CB]     = { .name = "cb"     },              \
+        [DWT_PROBE_DLY_TX] = { .name = "dly_tx" },              \
+        [DWT_PROBE_USER0]  = { .name = "user0"  },              \
+        [DWT_PROBE_USER1]  = { .name = "user1"  },              \
+    }
+
+#define DWM_PORT_INST_INIT(n)                                   \
+    [n] = {                                                     \
+        .wakeup = GPIO_DT_SPEC_INST_GET(n, dwm_wakeup_gpios),   \
+        .reset  = GPIO_DT_SPEC_INST_GET(n, dwm_reset_gpios),    \
+        .rx_led = GPIO_DT_SPEC_INST_GET(n, dwm_rx_led_gpios),   \
+        .tx_led = GPIO_DT_SPEC_INST_GET(n, dwm_tx_led_gpios),   \
+        .irq    = GPIO_DT_SPEC_INST_GET(n, dwm_irq_gpios),      \
+        .pol    = GPIO_DT_SPEC_INST_GET(n, dwm_spi_pol_gpios),  \
+        .pha    = GPIO_DT_SPEC_INST_GET(n, dwm_spi_pha_gpios),  \
+        .sync   = GPIO_DT_SPEC_INST_GET_OR(n, dwm_sync_gpios, {0}), \
+        .probes = DWM_PROBES_INIT,                              \
+    },
+
+static struct dwm_port_inst dwm_insts[DWM_INST_COUNT] = {
+    DT_INST_FOREACH_STATUS_OKAY(DWM_PORT_INST_INIT)
+};
+
+/* @fn    dwm_cur
+ * @brief the instance matching the driver's active local data,
+ *        see port_select_dw_ic()
+ * */
+static struct dwm_port_inst * dwm_cur(void)
+{
+    unsigned int inst = dwt_getlocaldataindex();
+
+    return &dwm_insts[(inst < DWM_INST_COUNT) ? inst : 0];
+}
 
 /****************************************************************************//**
  *
@@ -96,6 +187,9 @@ static const struct device * pol_dev    = NULL;
  *******************************************************************************/
 static volatile uint32_t signalResetDone;
 
+/* SYNC line shared by the instances, the first "dwm-sync-gpios" found */
+static const struct gpio_dt_spec * sync_pin;
+
 /****************************************************************************//**
  *
  *                              Time section
@@ -103,15 +197,99 @@ static volatile uint32_t signalResetDone;
  *******************************************************************************/
 
 /* @fn    portGetTickCnt
- * @brief wrapper for to read a SysTickTimer, which is incremented with
- *        CLOCKS_PER_SEC frequency.
- *        The resolution of time32_incr is usually 1/1000 sec.
+ * @brief read the free running hardware cycle counter
+ *        (sys_clock_hw_cycles_per_sec() ticks per second, wraps at 32 bits).
+ *        Use port_tick_to_us() to convert a difference of two reads.
  * */
 unsigned long
 portGetTickCnt(void)
 {
-    //TODO
-    return 0;
+    return k_cycle_get_32();
+}
+
+/* @fn    port_tick_to_us
+ * @brief convert a portGetTickCnt() difference to microseconds
+ * */
+uint32_t port_tick_to_us(uint32_t ticks)
+{
+    return k_cyc_to_us_floor32(ticks);
+}
+
+/****************************************************************************//**
+ *
+ *                              Probe section
+ *
+ *******************************************************************************/
+
+/* @fn    port_probe_start
+ * @brief timestamp the start of a probed section of the selected instance
+ * */
+void port_probe_start(int probe)
+{
+    dwm_cur()->probes[probe].start = k_cycle_get_32();
+}
+
+/* @fn    port_probe_stop
+ * @brief accumulate the time since port_probe_start() for the probe
+ * */
+void port_probe_stop(int probe)
+{
+    port_probe_t * p = &dwm_cur()->probes[probe];
+    uint32_t cycles = k_cycle_get_32() - p->start;
+
+    p->last = cycles;
+    if (p->count == 0 || cycles < p->min) {
+        p->min = cycles;
+    }
+    if (cycles > p->max) {
+        p->max = cycles;
+    }
+    p->total += cycles;
+    p->count++;
+}
+
+/* @fn    port_probe_get
+ * @brief return the accumulators of a probe (times in cycles)
+ * */
+const port_probe_t * port_probe_get(int probe)
+{
+    return &dwm_cur()->probes[probe];
+}
+
+/* @fn    port_probe_reset
+ * @brief clear all probe accumulators of the selected instance
+ * */
+void port_probe_reset(void)
+{
+    port_probe_t * probes = dwm_cur()->probes;
+
+    for (int i = 0; i < DWT_PROBE_COUNT; i++) {
+        probes[i].count = 0;
+        probes[i].last  = 0;
+        probes[i].min   = 0;
+        probes[i].max   = 0;
+        probes[i].total = 0;
+    }
+}
+
+/* @fn    port_probe_dump
+ * @brief log count/last/min/max/avg (us) of all probes of the selected
+ *        instance that have fired
+ * */
+void port_probe_dump(void)
+{
+    port_probe_t * probes = dwm_cur()->probes;
+
+    for (int i = 0; i < DWT_PROBE_COUNT; i++) {
+        port_probe_t * p = &probes[i];
+
+        if (p->count == 0) {
+            continue;
+        }
+        LOG_INF("%-6s n=%u last=%u min=%u max=%u avg=%u us", p->name, p->count,
+                port_tick_to_us(p->last), port_tick_to_us(p->min),
+                port_tick_to_us(p->max), port_tick_to_us((uint32_t)(p->total / p->count)));
+    }
 }
 
 /* @fn    Sleep
@@ -134,69 +312,134 @@ void Sleep(uint32_t x)
  *
  *******************************************************************************/
 
-/* @fn    peripherals_init
+/* @fn    dwm_gpio_init
+ * @brief configure one DW3000 control pin
+ *        returns 0 for success, or -1 for error
  * */
-int peripherals_init (void)
+static int dwm_gpio_init(const struct gpio_dt_spec * spec, const char * name, gpio_flags_t flags)
 {
-    /* Wakeup */
-    LOG_INF("Configure WAKEUP pin on port \"%s\" pin %d", WAKEUP_GPIO_PORT, WAKEUP_GPIO_PIN);
-    wakeup_dev = device_get_binding(WAKEUP_GPIO_PORT);
-    if (!wakeup_dev) {
-        LOG_ERR("error: \"%s\" not found", WAKEUP_GPIO_PORT);
+    LOG_INF("Configure %s pin on port \"%s\" pin %d", name, spec->port->name, spec->pin);
+    if (!device_is_ready(spec->port)) {
+        LOG_ERR("error: \"%s\" not ready", spec->port->name);
         return -1;
     }
-    gpio_pin_configure(wakeup_dev, WAKEUP_GPIO_PIN, GPIO_OUTPUT);
-    gpio_pin_set(wakeup_dev, WAKEUP_GPIO_PIN, 1);
+    gpio_pin_configure(spec->port, spec->pin, flags);
 
-    /* Reset */
-    LOG_INF("Configure RESET pin on port \"%s\" pin %d", RESET_GPIO_PORT, RESET_GPIO_PIN);
-    reset_dev = device_get_binding(RESET_GPIO_PORT);
-    if (!reset_dev) {
-        LOG_ERR("error: \"%s\" not found", RESET_GPIO_PORT);
-        return -1;
-    }
-    gpio_pin_configure(reset_dev, RESET_GPIO_PIN, GPIO_OUTPUT);
-    gpio_pin_set(reset_dev, RESET_GPIO_PIN, 1);
+    return 0;
+}
 
-    /* RX LED */
-    LOG_INF("Configure RX LED pin on port \"%s\" pin %d", RX_LED_GPIO_PORT, RX_LED_GPIO_PIN);
-    rx_led_dev = device_get_binding(RX_LED_GPIO_PORT);
-    if (!rx_led_dev) {
-        LOG_ERR("error: \"%s\" not found", RX_LED_GPIO_PORT);
-        return -1;
+/* @fn    dwm_rst_gpio_cb
+ * @brief RSTn rising edge: the DW3000 is out of reset, see setup_DW3000RSTnIRQ()
+ * */
+static void dwm_rst_gpio_cb(const struct device * dev, struct gpio_callback * cb, gpio_port_pins_t pins)
+{
+    struct dwm_port_inst * dwm = CONTAINER_OF(cb, struct dwm_port_inst, rst_cb);
+
+    ARG_UNUSED(dev);
+    ARG_UNUSED(pins);
+
+    k_sem_give(&dwm->rst_sem);
+}
+
+/* @fn    peripherals_init
+ * @brief configure the control pins of every DW3000 instance
+ * */
+int peripherals_init (void)
+{
+    for (int i = 0; i < DWM_INST_COUNT; i++) {
+        struct dwm_port_inst * dwm = &dwm_insts[i];
+
+        /* Wakeup */
+        if (dwm_gpio_init(&dwm->wakeup, "WAKEUP", GPIO_OUTPUT) != 0) {
+            return -1;
+        }
+        gpio_pin_set(dwm->wakeup.port, dwm->wakeup.pin, 1);
+
+        /* Reset */
+        if (dwm_gpio_init(&dwm->reset, "RESET", GPIO_OUTPUT) != 0) {
+            return -1;
+        }
+        gpio_pin_set(dwm->reset.port, dwm->reset.pin, 1);
+
+        /* RX LED */
+        if (dwm_gpio_init(&dwm->rx_led, "RX LED", GPIO_OUTPUT) != 0) {
+            return -1;
+        }
+        gpio_pin_set(dwm->rx_led.port, dwm->rx_led.pin, 1);
+
+        /* TX LED */
+        if (dwm_gpio_init(&dwm->tx_led, "TX LED", GPIO_OUTPUT) != 0) {
+            return -1;
+        }
+        gpio_pin_set(dwm->tx_led.port, dwm->tx_led.pin, 1);
+
+        /* SPI POLARITY */
+        if (dwm_gpio_init(&dwm->pol, "SPI Polarity", GPIO_OUTPUT_INACTIVE) != 0) {
+            return -1;
+        }
+
+        /* SPI PHASE */
+        if (dwm_gpio_init(&dwm->pha, "SPI Phase", GPIO_OUTPUT_INACTIVE) != 0) {
+            return -1;
+        }
+
+        /* SYNC, idle low */
+        if (dwm->sync.port != NULL) {
+            if (dwm_gpio_init(&dwm->sync, "SYNC", GPIO_OUTPUT_INACTIVE) != 0) {
+                return -1;
+            }
+            if (sync_pin == NULL) {
+                sync_pin = &dwm->sync;
+            }
+        }
+
+        k_sem_init(&dwm->wake_sem, 0, 1);
+        k_sem_init(&dwm->rst_sem, 0, 1);
+        gpio_init_callback(&dwm->rst_cb, dwm_rst_gpio_cb, BIT(dwm->reset.pin));
+        gpio_add_callback(dwm->reset.port, &dwm->rst_cb);
     }
-    gpio_pin_configure(rx_led_dev, RX_LED_GPIO_PIN, GPIO_OUTPUT);
-    gpio_pin_set(rx_led_dev, RX_LED_GPIO_PIN, 1);
 
-    /* TX LED */
-    LOG_INF("Configure TX LED pin on port \"%s\" pin %d", TX_LED_GPIO_PORT, TX_LED_GPIO_PIN);
-    tx_led_dev = device_get_binding(RX_LED_GPIO_PORT);
-    if (!tx_led_dev) {
-        LOG_ERR("error: \"%s\" not found", TX_LED_GPIO_PORT);
-        return -1;
+    return 0;
+}
+
+/* @fn    port_get_dw_ic_count
+ * @brief number of DW3000 instances in the devicetree
+ * */
+int port_get_dw_ic_count(void)
+{
+    return DWM_INST_COUNT;
+}
+
+/* @fn    port_dw_ic_lock / port_dw_ic_unlock
+ * @brief take/release the lock of a DW3000 instance (recursive, no-op
+ *        from an ISR), see dwt_lock()
+ * */
+void port_dw_ic_lock(unsigned int index)
+{
+    if (index < DWM_INST_COUNT) {
+        dw_spi_lock(dw_spi_get(index));
     }
-    gpio_pin_configure(tx_led_dev, TX_LED_GPIO_PIN, GPIO_OUTPUT);
-    gpio_pin_set(tx_led_dev, TX_LED_GPIO_PIN, 1);
+}
 
-    /* SPI POLARITY */
-    LOG_INF("Configure SPI Polarity pin on port \"%s\" pin %d", POL_GPIO_PORT, POL_GPIO_PIN);
-    pol_dev = device_get_binding(POL_GPIO_PORT);
-    if (!pol_dev) {
-        LOG_ERR("error: \"%s\" not found", POL_GPIO_PORT);
-        return -1;
+void port_dw_ic_unlock(unsigned int index)
+{
+    if (index < DWM_INST_COUNT) {
+        dw_spi_unlock(dw_spi_get(index));
     }
-    gpio_pin_configure(pol_dev, POL_GPIO_PIN, GPIO_OUTPUT_INACTIVE);
+}
 
-    /* SPI PHASE */
-    LOG_INF("Configure SPI Phase pin on port \"%s\" pin %d", PHA_GPIO_PORT, PHA_GPIO_PIN);
-    pha_dev = device_get_binding(PHA_GPIO_PORT);
-    if (!pha_dev) {
-        LOG_ERR("error: \"%s\" not found", PHA_GPIO_PORT);
+/* @fn    port_select_dw_ic
+ * @brief select the DW3000 instance used by the driver and by the port
+ *        functions below (pins, LEDs, SPI rate), see dwt_setlocaldataptr()
+ *        returns 0 for success, or -1 for error
+ * */
+int port_select_dw_ic(int inst)
+{
+    if (inst < 0 || inst >= DWM_INST_COUNT) {
         return -1;
     }
-    gpio_pin_configure(pha_dev, PHA_GPIO_PIN, GPIO_OUTPUT_INACTIVE);
 
-    return 0;
+    return (dwt_setlocaldataptr(inst) == DWT_SUCCESS) ? 0 : -1;
 }
 
 /* @fn    spi_peripheral_init
@@ -218,65 +461,166 @@ void spi_peripheral_init()
  *
  *******************************************************************************/
 
-/* @fn      reset_DWIC
- * @brief   DW_RESET pin on DW3000 has 2 functions
- *          In general it is output, but it also can be used to reset the digital
- *          part of DW3000 by driving this pin low.
- *          Note, the DW_RESET pin should not be driven high externally.
+/* @fn      dwm_reset_wait_idle
+ * @brief   after the RSTn release, wait for the DW3000 to reach IDLE_RC:
+ *          on the SPIRDY IRQ edge when the IRQ handler is installed, else
+ *          by reading the status. The SPI is at the slow rate.
+ *          returns 0 for success, or -1 on timeout
  * */
-void reset_DWIC(void)
+static int dwm_reset_wait_idle(struct dwm_port_inst * dwm)
+{
+    int64_t end = k_uptime_get() + PORT_RESET_TIMEOUT_MS;
+
+    if (dwm->waking) {
+        k_sem_take(&dwm->wake_sem, K_MSEC(PORT_RESET_TIMEOUT_MS));
+        dwm->waking = false;
+    }
+
+    while (!dwt_checkidlerc()) {
+        if (k_uptime_get() > end) {
+            return -1;
+        }
+        k_busy_wait(10);
+    }
+
+    return 0;
+}
+
+/* @fn      port_reset_dw3000
+ * @brief   reset the selected DW3000, see port.h for the modes.
+ *          The pin modes drive RSTn low for 10us then release it (the pin is
+ *          open-drain, the DW3000 has it low while in reset). With
+ *          PORT_RESET_PIN_IRQ the RSTn rising edge, then the SPIRDY IRQ edge
+ *          end the waits, so the device is in IDLE_RC on return, ~1ms after
+ *          the pulse instead of 2ms plus polling. The SPI is at the fast rate
+ *          on return, as with the soft reset.
+ *          returns 0 for success, or -1 if the device did not come out of
+ *          reset in time
+ * */
+int port_reset_dw3000(int mode)
 {
-    LOG_INF("%s", __func__);
+    struct dwm_port_inst * dwm = dwm_cur();
+    const struct gpio_dt_spec * reset = &dwm->reset;
+    int ret = 0;
+
+    LOG_INF("%s %d", __func__, mode);
 
-#if 0
-    /*
-     * Use RSTn gpio pin to reset DWM3000.
-     */
+    /* SPI bus must be <= 7MHz until the PLL is locked */
+    port_set_dw_ic_spi_slowrate();
+
+    if (mode == PORT_RESET_SOFT) {
+        dwt_softreset();
+        port_set_dw_ic_spi_fastrate();
+        return 0;
+    }
+
+    k_sem_reset(&dwm->rst_sem);
+    k_sem_reset(&dwm->wake_sem);
+    dwm->waking = (mode == PORT_RESET_PIN_IRQ) && (dwm->irq_handler != NULL);
 
     /* Enable GPIO used for DW3000 reset as open collector output */
-    gpio_pin_configure(reset_dev, RESET_GPIO_PIN, (GPIO_OUTPUT | GPIO_OPEN_DRAIN));
+    gpio_pin_configure(reset->port, reset->pin, (GPIO_OUTPUT | GPIO_OPEN_DRAIN));
 
     /* Drive the RSTn pin low */
-    gpio_pin_set(reset_dev, RESET_GPIO_PIN, 0);
+    gpio_pin_set(reset->port, reset->pin, 0);
 
     deca_usleep(10);
 
-    /* Drive the RSTn pin high */
-    gpio_pin_set(reset_dev, RESET_GPIO_PIN, 1);
+    if (mode == PORT_RESET_PIN_IRQ) {
+        /* Catch the release by the DW3000, then let the pin go */
+        setup_DW3000RSTnIRQ(1);
+        gpio_pin_set(reset->port, reset->pin, 1);
 
-    /* Put the pin back to output open-drain (not active) */
-    setup_DW3000RSTnIRQ(0);
+        if (k_sem_take(&dwm->rst_sem, K_MSEC(PORT_RESET_TIMEOUT_MS)) != 0) {
+            LOG_ERR("%s: RSTn still low", __func__);
+            ret = -1;
+        }
+        setup_DW3000RSTnIRQ(0);
 
-    Sleep(2);
-#else
-    /*
-     *  Use Soft Reset api to reset DWM3000
-     *  SPI bus must be <= 7MHz, e.g. slowrate
-     */
-    port_set_dw_ic_spi_slowrate();
+        if (ret == 0 && dwm_reset_wait_idle(dwm) != 0) {
+            LOG_ERR("%s: no SPIRDY", __func__);
+            ret = -1;
+        }
+        dwm->waking = false;
+    }
+    else {
+        /* Release the RSTn pin */
+        gpio_pin_set(reset->port, reset->pin, 1);
 
-    dwt_softreset();
+        /* Put the pin back to output open-drain (not active) */
+        setup_DW3000RSTnIRQ(0);
+
+        Sleep(2);
+    }
 
-    /* Set SPI bus to working rate: fastrate. */
     port_set_dw_ic_spi_fastrate();
-#endif
 
+    return ret;
+}
+
+/* @fn      reset_DWIC
+ * @brief   DW_RESET pin on DW3000 has 2 functions
+ *          In general it is output, but it also can be used to reset the digital
+ *          part of DW3000 by driving this pin low.
+ *          Note, the DW_RESET pin should not be driven high externally.
+ *          Resets with PORT_RESET_MODE, the soft reset unless defined.
+ * */
+void reset_DWIC(void)
+{
+    port_reset_dw3000(PORT_RESET_MODE);
+}
+
+/* @fn      port_recover_dw3000
+ * @brief   bring the selected DW3000 back after an SPI error or a brownout:
+ *          PORT_RESET_PIN_IRQ reset, dwt_initialise() from the warm boot copy
+ *          of the OTP data (read from the OTP and kept the first time), then
+ *          the configuration from a register image if given
+ *          (dwt_cfgimage_apply()). The TX power, antenna delays, interrupts
+ *          and callbacks are the application's to set again.
+ *          returns 0 for success, or -1 for error
+ * */
+int port_recover_dw3000(const dwt_cfgimage_t * img)
+{
+    if (port_reset_dw3000(PORT_RESET_PIN_IRQ) != 0) {
+        return -1;
+    }
+
+    if (port_warm_cache_load() != 0) {
+        if (dwt_initialise(DWT_DW_INIT) != DWT_SUCCESS) {
+            return -1;
+        }
+        port_warm_cache_save();
+    }
+    else if (dwt_initialise(DWT_DW_INIT) != DWT_SUCCESS) {
+        port_warm_cache_clear();
+        return -1;
+    }
+
+    if (img != NULL && dwt_cfgimage_apply(img) != DWT_SUCCESS) {
+        return -1;
+    }
+
+    return 0;
 }
 
 /* @fn      setup_DW3000RSTnIRQ
  * @brief   setup the DW_RESET pin mode
  *          0 - output Open collector mode
- *          !0 - input mode with connected EXTI0 IRQ
+ *          !0 - input mode with the rising edge IRQ (out of reset)
  * */
 void setup_DW3000RSTnIRQ(int enable)
 {
+    const struct gpio_dt_spec * reset = &dwm_cur()->reset;
+
     if (enable) {
         /* Enable GPIO used as DECA RESET for interrupt */
-        gpio_pin_configure(reset_dev, RESET_GPIO_PIN, (GPIO_OUTPUT | GPIO_OPEN_DRAIN | GPIO_INT_EDGE_RISING));
+        gpio_pin_configure(reset->port, reset->pin, (GPIO_INPUT | GPIO_OUTPUT | GPIO_OPEN_DRAIN));
+        gpio_pin_interrupt_configure(reset->port, reset->pin, GPIO_INT_EDGE_RISING);
     }
     else {
         /* Put the pin back to tri-state, as output open-drain (not active) */
-        gpio_pin_configure(reset_dev, RESET_GPIO_PIN, (GPIO_OUTPUT | GPIO_OPEN_DRAIN));
+        gpio_pin_interrupt_configure(reset->port, reset->pin, GPIO_INT_DISABLE);
+        gpio_pin_configure(reset->port, reset->pin, (GPIO_OUTPUT | GPIO_OPEN_DRAIN));
     }
 }
 
@@ -292,9 +636,11 @@ void setup_DW3000RSTnIRQ(int enable)
  */
  void wakeup_device_with_io(void)
 {
-    gpio_pin_set(wakeup_dev, WAKEUP_GPIO_PIN, 1);
+    const struct gpio_dt_spec * wakeup = &dwm_cur()->wakeup;
+
+    gpio_pin_set(wakeup->port, wakeup->pin, 1);
     deca_usleep(500);
-    gpio_pin_set(wakeup_dev, WAKEUP_GPIO_PIN, 0);
+    gpio_pin_set(wakeup->port, wakeup->pin, 0);
 }
 
 /*
@@ -309,11 +655,12 @@ void setup_DW3000RSTnIRQ(int enable)
  */
 void make_very_short_wakeup_io(void)
 {
+    const struct gpio_dt_spec * wakeup = &dwm_cur()->wakeup;
     uint8_t   cnt;
 
-    gpio_pin_set(wakeup_dev, WAKEUP_GPIO_PIN, 1);
+    gpio_pin_set(wakeup->port, wakeup->pin, 1);
     for (cnt=0; cnt<10; cnt++)  __NOP();
-    gpio_pin_set(wakeup_dev, WAKEUP_GPIO_PIN, 0);
+    gpio_pin_set(wakeup->port, wakeup->pin, 0);
 }
 
 /* @fn      led_off
@@ -321,12 +668,14 @@ void make_very_short_wakeup_io(void)
  * */
 void led_off (uint32_t led)
 {
+    struct dwm_port_inst * dwm = dwm_cur();
+
     switch (led) {
         case 0:
-            gpio_pin_set(rx_led_dev, RX_LED_GPIO_PIN, 0);
+            gpio_pin_set(dwm->rx_led.port, dwm->rx_led.pin, 0);
             break;
         case 1:
-            gpio_pin_set(tx_led_dev, TX_LED_GPIO_PIN, 0);
+            gpio_pin_set(dwm->tx_led.port, dwm->tx_led.pin, 0);
             break;
         default:
             // do nothing for undefined led number
@@ -339,12 +688,14 @@ void led_off (uint32_t led)
  * */
 void led_on (uint32_t led)
 {
+    struct dwm_port_inst * dwm = dwm_cur();
+
     switch (led) {
         case 0:
-            gpio_pin_set(rx_led_dev, RX_LED_GPIO_PIN, 1);
+            gpio_pin_set(dwm->rx_led.port, dwm->rx_led.pin, 1);
             break;
         case 1:
-            gpio_pin_set(tx_led_dev, TX_LED_GPIO_PIN, 1);
+            gpio_pin_set(dwm->tx_led.port, dwm->tx_led.pin, 1);
             break;
         default:
             // do nothing for undefined led number
@@ -354,22 +705,168 @@ void led_on (uint32_t led)
 
 
 /* @fn      port_wakeup_dw3000
- * @brief   "slow" waking up of DW3000 using DW_CS only
+ * @brief   waking up of DW3000 using DW_CS only, for boards without the
+ *          WAKEUP pin: CS is held low, without clocks, until the DW3000
+ *          signals SPIRDY when the IRQ handler is installed (as in
+ *          port_wakeup_dw3000_fast()), else for PORT_WAKEUP_CS_US; then
+ *          IDLE_RC is checked and the configuration not kept in AON is
+ *          restored with dwt_restoreconfig().
+ *          The SPI must be at the slow rate (port_set_dw_ic_spi_slowrate()).
+ *          returns 0 for success, or -1 if the DW3000 did not wake in time
  * */
-void port_wakeup_dw3000(void)
+int port_wakeup_dw3000(void)
 {
-    gpio_pin_set(wakeup_dev, WAKEUP_GPIO_PIN, 0);
-    //TODO
+    struct dwm_port_inst * dwm = dwm_cur();
+    dw_spi_t * spi = dw_spi_get(dwm - dwm_insts);
+    int64_t end;
+
+    k_sem_reset(&dwm->wake_sem);
+    dwm->waking = (dwm->irq_handler != NULL);
+
+    if (dw_spi_cs_assert(spi) != 0) {
+        dwm->waking = false;
+        return -1;
+    }
+
+    if (dwm->waking) {
+        k_sem_take(&dwm->wake_sem, K_MSEC(PORT_WAKEUP_TIMEOUT_MS));
+    }
+    else {
+        k_busy_wait(PORT_WAKEUP_CS_US);
+    }
+
+    dw_spi_cs_release(spi);
+    dwm->waking = false;
+
+    end = k_uptime_get() + PORT_WAKEUP_TIMEOUT_MS;
+    while (!dwt_checkidlerc()) {
+        if (k_uptime_get() > end) {
+            LOG_ERR("%s: not in IDLE_RC", __func__);
+            return -1;
+        }
+        k_busy_wait(10);
+    }
+
+    dwt_restoreconfig();
+
+    return 0;
 }
 
 /* @fn      port_wakeup_dw3000_fast
- * @brief   waking up of DW3000 using DW_CS and DW_RESET pins.
- *          The DW_RESET signalling that the DW3000 is in the INIT state.
- *          the total fast wakeup takes ~2.2ms and depends on crystal startup time
+ * @brief   waking up of DW3000 using the WAKEUP pin and the SPIRDY interrupt.
+ *          WAKEUP is held high until the DW3000 signals SPIRDY (IDLE_RC
+ *          reached) on its IRQ line, rather than for a fixed time and then
+ *          polling dwt_checkidlerc(); then the configuration not kept in
+ *          AON is restored with dwt_restoreconfig().
+ *          The IRQ handler must be installed (port_set_dwic_isr) and the
+ *          cbSPIRdy callback, if any, should not call dwt_restoreconfig().
+ *          The total wakeup takes ~2ms and depends on crystal startup time.
+ *          returns 0 for success, or -1 if SPIRDY did not come in time
+ * */
+int port_wakeup_dw3000_fast(void)
+{
+    struct dwm_port_inst * dwm = dwm_cur();
+    int ret;
+
+    k_sem_reset(&dwm->wake_sem);
+    dwm->waking = true;
+
+    gpio_pin_set(dwm->wakeup.port, dwm->wakeup.pin, 1);
+    ret = k_sem_take(&dwm->wake_sem, K_MSEC(PORT_WAKEUP_TIMEOUT_MS));
+    gpio_pin_set(dwm->wakeup.port, dwm->wakeup.pin, 0);
+
+    dwm->waking = false;
+
+    if (ret != 0) {
+        LOG_ERR("%s: no SPIRDY", __func__);
+        return -1;
+    }
+
+    dwt_restoreconfig();
+
+    return 0;
+}
+
+/* @fn      port_sync_pulse
+ * @brief   one pulse on the SYNC line: the DW3000 samples SYNC with its
+ *          38.4 MHz clock, so a GPIO set then cleared is long enough.
+ *          returns 0 for success, or -1 if there is no "dwm-sync-gpios" pin
+ * */
+int port_sync_pulse(void)
+{
+    unsigned int key;
+
+    if (sync_pin == NULL) {
+        return -1;
+    }
+
+    key = irq_lock();
+    gpio_pin_set(sync_pin->port, sync_pin->pin, 1);
+    gpio_pin_set(sync_pin->port, sync_pin->pin, 0);
+    irq_unlock(key);
+
+    return 0;
+}
+
+/* @fn      port_sync_dw_ics
+ * @brief   restart the system time of every DW3000 instance on one SYNC
+ *          pulse: arm the one shot timebase reset of each (dwt_ostr_arm()),
+ *          pulse, then check each counter restarted (dwt_ostr_check()) and
+ *          disarm it. The instances must be initialised, in IDLE_PLL, and
+ *          share the SYNC line and the reference clock. The driver
+ *          selection is restored on return.
+ *          res, if not NULL, has one entry per instance.
+ *          returns 0 if all restarted, or -1 for error
  * */
-void port_wakeup_dw3000_fast(void)
+int port_sync_dw_ics(uint8_t wait, port_sync_result_t * res)
 {
-    //TODO
+    unsigned int cur = dwt_getlocaldataindex();
+    uint32_t start;
+    int ret = 0;
+
+    if (sync_pin == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < DWM_INST_COUNT; i++) {
+        port_select_dw_ic(i);
+        if (dwt_ostr_arm(wait) != DWT_SUCCESS) {
+            LOG_ERR("%s: DW3000 %d busy", __func__, i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        start = k_cycle_get_32();
+        port_sync_pulse();
+
+        for (int i = 0; i < DWM_INST_COUNT; i++) {
+            uint32_t us;
+            uint32_t systime;
+            int ok;
+
+            port_select_dw_ic(i);
+            us = port_tick_to_us(k_cycle_get_32() - start) + PORT_SYNC_MARGIN_US;
+            ok = (dwt_ostr_check(us, &systime) == DWT_SUCCESS) ? 0 : -1;
+            if (ok != 0) {
+                LOG_ERR("%s: DW3000 %d did not restart (%u)", __func__, i, systime);
+                ret = -1;
+            }
+            if (res != NULL) {
+                res[i].systime = systime;
+                res[i].max_us  = us;
+                res[i].ok      = ok;
+            }
+        }
+    }
+
+    for (int i = 0; i < DWM_INST_COUNT; i++) {
+        port_select_dw_ic(i);
+        dwt_ostr_disarm();
+    }
+    port_select_dw_ic(cur);
+
+    return ret;
 }
 
 /* @fn      port_set_dw_ic_spi_slowrate
@@ -381,14 +878,276 @@ void port_set_dw_ic_spi_slowrate(void)
 }
 
 /* @fn      port_set_dw_ic_spi_fastrate
- * @brief   set 8MHz
+ * @brief   set the fast rate: 8MHz, or the rate found by
+ *          port_calibrate_dw_ic_spi_fastrate()
  * */
 void port_set_dw_ic_spi_fastrate(void)
 {
-    //TODO
     set_spi_speed_fast();
 }
 
+/* SPI rates tried by port_calibrate_dw_ic_spi_fastrate(), ascending.
+ * The controller rounds each down to the nearest rate it supports. */
+static const uint32_t spi_cal_rates[] = {
+    8000000, 16000000, 20000000, 24000000, 32000000, 36000000, 38000000
+};
+
+#define SPI_CAL_ITERATIONS  (32)
+#define SPI_CAL_VERIFY      (8)     /* runs of SPI_CAL_ITERATIONS to confirm the rate kept */
+
+static volatile int spi_cal_rd_errors;
+
+static void spi_cal_rd_err_cb(void)
+{
+    spi_cal_rd_errors++;
+}
+
+/* @fn      spi_cal_check_rate
+ * @brief   run SPI_CAL_ITERATIONS device ID loopbacks with SPI CRC on reads
+ *          and writes at the currently selected rate
+ *          returns 0 if all passed, or -1 for error
+ * */
+static int spi_cal_check_rate(uint32_t dev_id)
+{
+    spi_cal_rd_errors = 0;
+
+    /* Clear any stale write CRC error: this is also a CRC checked write */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_SPICRCE_BIT_MASK);
+
+    for (int i = 0; i < SPI_CAL_ITERATIONS; i++) {
+        if (dwt_readdevid() != dev_id) {
+            return -1;
+        }
+    }
+
+    if (spi_cal_rd_errors != 0) {
+        return -1;
+    }
+
+    if (dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_SPICRCE_BIT_MASK) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* @fn      port_calibrate_dw_ic_spi_fastrate
+ * @brief   step the SPI rate up from 8MHz until device ID loopbacks fail
+ *          with SPI read and write CRC checking, then keep one rate below
+ *          the highest that passed, as a margin, once it passes
+ *          SPI_CAL_VERIFY more runs (else the next one down). 8MHz is kept
+ *          if nothing faster qualifies. The result is cached as the
+ *          fastrate.
+ *          The DW3000 must be in IDLE_PLL (rates above 7MHz), e.g. called
+ *          after dwt_initialise(); SPI CRC is left disabled on return.
+ *          returns the selected rate in Hz
+ * */
+uint32_t port_calibrate_dw_ic_spi_fastrate(void)
+{
+    uint32_t dev_id;
+    uint32_t best;
+    int good = 0;
+    int run;
+
+    /* Reference device ID, read at the safe slow rate */
+    port_set_dw_ic_spi_slowrate();
+    dev_id = dwt_readdevid();
+
+    dwt_enablespicrccheck(DWT_SPI_CRC_MODE_WRRD, spi_cal_rd_err_cb);
+
+    for (size_t i = 0; i < ARRAY_SIZE(spi_cal_rates); i++) {
+
+        set_spi_speed_trial(spi_cal_rates[i]);
+
+        if (spi_cal_check_rate(dev_id) != 0) {
+            LOG_INF("%s: %u Hz failed", __func__, spi_cal_rates[i]);
+            break;
+        }
+        good = (int)i;
+    }
+
+    /* Margin: one rate below the highest that passed, confirmed over more
+     * runs, stepping further down while it does not hold */
+    if (good > 0) {
+        good--;
+    }
+    while (good > 0) {
+        set_spi_speed_trial(spi_cal_rates[good]);
+        for (run = 0; run < SPI_CAL_VERIFY; run++) {
+            if (spi_cal_check_rate(dev_id) != 0) {
+                break;
+            }
+        }
+        if (run == SPI_CAL_VERIFY) {
+            break;
+        }
+        LOG_INF("%s: %u Hz failed verification", __func__, spi_cal_rates[good]);
+        good--;
+    }
+    best = spi_cal_rates[good];
+
+    /* Restore a known good rate before talking to the device again */
+    port_set_dw_ic_spi_slowrate();
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_SPICRCE_BIT_MASK);
+    dwt_enablespicrccheck(DWT_SPI_CRC_MODE_NO, NULL);
+
+    set_spi_speed_fast_freq(best);
+    port_set_dw_ic_spi_fastrate();
+
+    LOG_INF("%s: fastrate %u Hz", __func__, best);
+
+    return best;
+}
+
+
+/* Warm boot copy of the OTP data read by dwt_initialise(), one per
+ * instance. It lives in no-init RAM, which keeps its content over a warm
+ * reboot (e.g. sys_reboot(SYS_REBOOT_WARM) after an OTA update) and holds
+ * garbage after power-up: the magic and CRC tell the two apart. */
+#define PORT_WARM_CACHE_MAGIC   0x44574243  /* "DWBC" */
+
+typedef struct {
+    uint32_t         magic;
+    dwt_init_cache_t data;
+    uint8_t          crc8;
+} port_warm_cache_t;
+
+static __noinit port_warm_cache_t warm_cache[DWM_INST_COUNT];
+
+/* @fn      port_warm_cache_load
+ * @brief   hand the warm boot copy of the OTP data of the selected instance
+ *          to the next dwt_initialise(), see dwt_setinitcache()
+ *          returns 0 if a valid copy was found, or -1 (OTP will be read)
+ * */
+int port_warm_cache_load(void)
+{
+    port_warm_cache_t * wc = &warm_cache[dwm_cur() - dwm_insts];
+
+    if (wc->magic != PORT_WARM_CACHE_MAGIC ||
+        wc->crc8 != dwt_generatecrc8((uint8_t *) &wc->data, sizeof(wc->data), 0)) {
+        dwt_setinitcache(NULL);
+        return -1;
+    }
+
+    dwt_setinitcache(&wc->data);
+    return 0;
+}
+
+/* @fn      port_warm_cache_save
+ * @brief   keep the OTP data of the selected instance for the next warm
+ *          boot, call after dwt_initialise()
+ *          returns 0 for success, or -1 for error
+ * */
+int port_warm_cache_save(void)
+{
+    port_warm_cache_t * wc = &warm_cache[dwm_cur() - dwm_insts];
+
+    if (dwt_getinitcache(&wc->data) != DWT_SUCCESS) {
+        wc->magic = 0;
+        return -1;
+    }
+    wc->crc8  = dwt_generatecrc8((uint8_t *) &wc->data, sizeof(wc->data), 0);
+    wc->magic = PORT_WARM_CACHE_MAGIC;
+
+    return 0;
+}
+
+/* @fn      port_warm_cache_clear
+ * @brief   drop the warm boot copy of the selected instance
+ * */
+void port_warm_cache_clear(void)
+{
+    warm_cache[dwm_cur() - dwm_insts].magic = 0;
+    dwt_setinitcache(NULL);
+}
+
+/* Persistent per-instance values (e.g. calibration results), stored with
+ * the Zephyr settings subsystem under "dw3000/<instance>/<name>".
+ * Needs CONFIG_SETTINGS and a settings backend (e.g. CONFIG_SETTINGS_NVS
+ * on the storage partition), otherwise the functions return -1. */
+#if defined(CONFIG_SETTINGS)
+struct port_setting_dst {
+    void  * value;
+    size_t  len;
+    int     found;
+};
+
+static int port_setting_cb(const char *key, size_t len, settings_read_cb read_cb,
+                           void *cb_arg, void *param)
+{
+    struct port_setting_dst * dst = param;
+    const char * next;
+
+    /* exact key only */
+    if (settings_name_next(key, &next) != 0 || next != NULL) {
+        return 0;
+    }
+    if (len == dst->len && read_cb(cb_arg, dst->value, len) == (ssize_t)len) {
+        dst->found = 1;
+    }
+    return 0;
+}
+
+static int port_setting_key(char * key, size_t size, const char * name)
+{
+    static bool initialised;
+
+    if (!initialised) {
+        if (settings_subsys_init() != 0) {
+            return -1;
+        }
+        initialised = true;
+    }
+
+    snprintf(key, size, "dw3000/%d/%s", (int)(dwm_cur() - dwm_insts), name);
+    return 0;
+}
+#endif
+
+/* @fn      port_setting_save
+ * @brief   store a value of the selected instance
+ *          returns 0 for success, or -1 for error
+ * */
+int port_setting_save(const char * name, const void * value, size_t len)
+{
+#if defined(CONFIG_SETTINGS)
+    char key[SETTINGS_MAX_NAME_LEN + 1];
+
+    if (port_setting_key(key, sizeof(key), name) != 0 ||
+        settings_save_one(key, value, len) != 0) {
+        return -1;
+    }
+    return 0;
+#else
+    ARG_UNUSED(name);
+    ARG_UNUSED(value);
+    ARG_UNUSED(len);
+    return -1;
+#endif
+}
+
+/* @fn      port_setting_load
+ * @brief   read back a value stored with port_setting_save()
+ *          returns 0 if found (with the same length), or -1
+ * */
+int port_setting_load(const char * name, void * value, size_t len)
+{
+#if defined(CONFIG_SETTINGS)
+    char key[SETTINGS_MAX_NAME_LEN + 1];
+    struct port_setting_dst dst = { .value = value, .len = len, .found = 0 };
+
+    if (port_setting_key(key, sizeof(key), name) != 0 ||
+        settings_load_subtree_direct(key, port_setting_cb, &dst) != 0) {
+        return -1;
+    }
+    return dst.found ? 0 : -1;
+#else
+    ARG_UNUSED(name);
+    ARG_UNUSED(value);
+    ARG_UNUSED(len);
+    return -1;
+#endif
+}
 
 /****************************************************************************//**
  *
@@ -416,27 +1175,203 @@ void port_set_dw_ic_spi_fastrate(void)
  *
  * @return none
  */
-void port_set_dwic_isr(port_deca_isr_t deca_isr)
+/* @fn      dwm_wake_signal
+ * @brief   release port_wakeup_dw3000(_fast)() on the SPIRDY IRQ edge
+ * */
+static void dwm_wake_signal(struct dwm_port_inst * dwm)
+{
+    if (dwm->waking) {
+        dwm->waking = false;
+        k_sem_give(&dwm->wake_sem);
+    }
+}
+
+/* @fn      dwm_irq_run
+ * @brief   run the handler of an instance with the driver switched to it,
+ *          restoring the caller's selection on return
+ * */
+static void dwm_irq_run(struct dwm_port_inst * dwm)
+{
+    unsigned int inst = dwm - dwm_insts;
+#if (DWM_INST_COUNT > 1)
+    unsigned int prev = dwt_getlocaldataindex();
+
+    dwt_setlocaldataptr(inst);
+#endif
+
+    /* hold the device for the whole handler and its callbacks */
+    port_dw_ic_lock(inst);
+    dwm->irq_handler();
+    port_dw_ic_unlock(inst);
+
+#if (DWM_INST_COUNT > 1)
+    dwt_setlocaldataptr(prev);
+#endif
+}
+
+#if defined(DWM_IRQ_DEFERRED)
+
+/* @fn      dwm_irq_gpio_cb
+ * @brief   GPIO ISR: timestamp and hand over to dwm_irq_thread_fn
+ * */
+static void dwm_irq_gpio_cb(const struct device * dev, struct gpio_callback * cb, gpio_port_pins_t pins)
+{
+    struct dwm_port_inst * dwm = CONTAINER_OF(cb, struct dwm_port_inst, gpio_cb);
+
+    ARG_UNUSED(dev);
+    ARG_UNUSED(pins);
+
+    dwm->irq_cycles = k_cycle_get_32();
+    k_sem_give(&dwm->irq_sem);
+
+    dwm_wake_signal(dwm);
+}
+
+/* @fn      dwm_irq_thread_fn
+ * @brief   runs the DW3000 handler for as long as the IRQ line is active,
+ *          and records the IRQ edge to handler latency
+ * */
+static void dwm_irq_thread_fn(void * p1, void * p2, void * p3)
 {
-    if (irq_dev == NULL) {
-        LOG_INF("Configure IRQ on port \"%s\" pin %d", IRQ_GPIO_PORT, IRQ_GPIO_PIN);
-        irq_dev = device_get_binding(IRQ_GPIO_PORT);
-        if (!irq_dev) {
-            LOG_ERR("error: \"%s\" not found", IRQ_GPIO_PORT);
-            return;
+    struct dwm_port_inst * dwm = p1;
+    port_irq_latency_t   * lat = &dwm->irq_latency;
+
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (1) {
+        k_sem_take(&dwm->irq_sem, K_FOREVER);
+
+        uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - dwm->irq_cycles);
+
+        lat->last_us = us;
+        if (lat->count == 0 || us < lat->min_us) {
+            lat->min_us = us;
         }
+        if (us > lat->max_us) {
+            lat->max_us = us;
+        }
+        lat->total_us += us;
+        lat->count++;
+
+        /* the IRQ line stays high while events are pending */
+        do {
+            dwm_irq_run(dwm);
+        } while (gpio_pin_get(dwm->irq.port, dwm->irq.pin) == 1);
     }
+}
 
-    LOG_INF("Configure IRQ pin");
+/* @fn      port_get_irq_latency
+ * @brief   copy the IRQ to handler latency statistics of the selected
+ *          instance (deferred IRQ only)
+ * */
+void port_get_irq_latency(port_irq_latency_t * latency)
+{
+    *latency = dwm_cur()->irq_latency;
+}
 
-    /* Decawave interrupt */
-    gpio_pin_configure(irq_dev, IRQ_GPIO_PIN, (GPIO_INPUT | IRQ_GPIO_FLAGS));
+/* @fn      port_reset_irq_latency
+ * @brief   clear the IRQ to handler latency statistics of the selected
+ *          instance (deferred IRQ only)
+ * */
+void port_reset_irq_latency(void)
+{
+    memset(&dwm_cur()->irq_latency, 0, sizeof(port_irq_latency_t));
+}
+
+#else
+
+/* @fn      dwm_irq_work_fn
+ * @brief   runs the DW3000 handler, from the system work queue, for as
+ *          long as the IRQ line is active
+ * */
+static void dwm_irq_work_fn(struct k_work * work)
+{
+    struct dwm_port_inst * dwm = CONTAINER_OF(work, struct dwm_port_inst, irq_work);
+
+    /* the IRQ line stays high while events are pending */
+    do {
+        dwm_irq_run(dwm);
+    } while (gpio_pin_get(dwm->irq.port, dwm->irq.pin) == 1);
+}
+
+/* @fn      dwm_irq_gpio_cb
+ * @brief   GPIO ISR: run the DW3000 handler of the instance, or back off
+ *          to the system work queue when a thread holds the device or a
+ *          transfer is on the bus (the handler's SPI traffic would
+ *          interleave with it)
+ * */
+static void dwm_irq_gpio_cb(const struct device * dev, struct gpio_callback * cb, gpio_port_pins_t pins)
+{
+    struct dwm_port_inst * dwm = CONTAINER_OF(cb, struct dwm_port_inst, gpio_cb);
+
+    ARG_UNUSED(dev);
+    ARG_UNUSED(pins);
 
-    gpio_init_callback(&gpio_cb, (gpio_callback_handler_t)(deca_isr), BIT(IRQ_GPIO_PIN));
+    if (dw_spi_busy(dw_spi_get(dwm - dwm_insts))) {
+        k_work_submit(&dwm->irq_work);
+    }
+    else {
+        dwm_irq_run(dwm);
+    }
+    dwm_wake_signal(dwm);
+}
+
+void port_get_irq_latency(port_irq_latency_t * latency)
+{
+    memset(latency, 0, sizeof(*latency));
+}
 
-    gpio_add_callback(irq_dev, &gpio_cb);
+void port_reset_irq_latency(void) { }
 
-    gpio_pin_interrupt_configure(irq_dev, IRQ_GPIO_PIN, GPIO_INT_EDGE_RISING);
+#endif
+
+/* @fn      port_set_dwic_isr_inst
+ * @brief   install the DW3000 IRQ handler of instance inst. The handler
+ *          runs with the driver switched to that instance.
+ * */
+void port_set_dwic_isr_inst(int inst, port_deca_isr_t deca_isr)
+{
+    struct dwm_port_inst * dwm;
+    bool                   first;
+
+    if (inst < 0 || inst >= DWM_INST_COUNT) {
+        return;
+    }
+    dwm = &dwm_insts[inst];
+
+    LOG_INF("Configure IRQ on port \"%s\" pin %d", dwm->irq.port->name, dwm->irq.pin);
+    if (!device_is_ready(dwm->irq.port)) {
+        LOG_ERR("error: \"%s\" not ready", dwm->irq.port->name);
+        return;
+    }
+
+    /* Decawave interrupt */
+    gpio_pin_configure(dwm->irq.port, dwm->irq.pin, (GPIO_INPUT | dwm->irq.dt_flags));
+
+    first = (dwm->irq_handler == NULL);
+    dwm->irq_handler = deca_isr;
+
+    if (first) {
+#if defined(DWM_IRQ_DEFERRED)
+        k_sem_init(&dwm->irq_sem, 0, 1);
+        k_thread_create(&dwm->irq_thread, dwm_irq_stacks[inst],
+                        K_THREAD_STACK_SIZEOF(dwm_irq_stacks[inst]),
+                        dwm_irq_thread_fn, dwm, NULL, NULL,
+                        DWM_IRQ_THREAD_PRIO, 0, K_NO_WAIT);
+#else
+        k_work_init(&dwm->irq_work, dwm_irq_work_fn);
+#endif
+        gpio_init_callback(&dwm->gpio_cb, dwm_irq_gpio_cb, BIT(dwm->irq.pin));
+        gpio_add_callback(dwm->irq.port, &dwm->gpio_cb);
+    }
+
+    gpio_pin_interrupt_configure(dwm->irq.port, dwm->irq.pin, GPIO_INT_EDGE_RISING);
+}
+
+void port_set_dwic_isr(port_deca_isr_t deca_isr)
+{
+    port_set_dwic_isr_inst(dwt_getlocaldataindex(), deca_isr);
 }
 
 /****************************************************************************//**
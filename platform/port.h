@@ -22,6 +22,7 @@ extern "C" {
 #include <stdint.h>
 #include <string.h>
 #include "compiler.h"
+#include "deca_device_api.h"
 
 /* DW3000 IRQ handler type. */
 typedef void (*port_deca_isr_t)(void);
@@ -40,6 +41,63 @@ typedef void (*port_deca_isr_t)(void);
  */
 void port_set_dwic_isr(port_deca_isr_t deca_isr);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_set_dwic_isr_inst()
+ *
+ * @brief This function is used to install the handling function for the IRQ of one DW3000 instance.
+ *
+ * NOTE: the handler runs with the driver switched to that instance and the previous selection is
+ *       restored on return. port_set_dwic_isr() installs the handler of the selected instance.
+ *
+ * @param inst     DW3000 instance (devicetree instance number)
+ * @param deca_isr function pointer to DW3000 interrupt handler to install
+ *
+ * @return none
+ */
+void port_set_dwic_isr_inst(int inst, port_deca_isr_t deca_isr);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_select_dw_ic()
+ *
+ * @brief This function selects the DW3000 instance that the driver (dwt_setlocaldataptr()), the SPI
+ *        functions in deca_spi.h and the port functions below (wakeup, reset, LEDs, SPI rate) act on.
+ *
+ * NOTE: instances are the "qorvo,dwm3000" devicetree nodes, each with its own SPI bus/CS and pins.
+ *       Build with DWT_NUM_DW_DEV set to at least port_get_dw_ic_count().
+ *
+ * @param inst     DW3000 instance (devicetree instance number)
+ *
+ * @return 0 for success, or -1 for error
+ */
+int port_select_dw_ic(int inst);
+int port_get_dw_ic_count(void);
+
+/* DW3000 IRQ edge to handler latency, recorded when DWM_IRQ_DEFERRED is defined. */
+typedef struct {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+} port_irq_latency_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_get_irq_latency()
+ *
+ * @brief This function returns the IRQ to handler latency statistics.
+ *
+ * NOTE: with DWM_IRQ_DEFERRED defined, the DW3000 handler runs in a cooperative thread
+ *       (DWM_IRQ_THREAD_PRIO) woken by the GPIO ISR, else all counts read 0. Without it the
+ *       handler runs in the GPIO ISR, or from the system work queue when the device is busy
+ *       (dw_spi_busy()). DWT_THREAD_SAFE requires DWM_IRQ_DEFERRED.
+ *
+ * @param latency  returned statistics
+ *
+ * @return none
+ */
+void port_get_irq_latency(port_irq_latency_t * latency);
+void port_reset_irq_latency(void);
+
 
 /*****************************************************************************************************************//*
 **/
@@ -95,6 +153,29 @@ typedef int64_t         int64;
 
 void Sleep(uint32_t Delay);
 unsigned long portGetTickCnt(void);
+uint32_t port_tick_to_us(uint32_t ticks);
+
+/* Timing probe accumulators, times in cycles (see portGetTickCnt).
+ * The driver and SPI layer probes (dwt_probe_e in deca_device_api.h) are
+ * compiled in with DWM_PROBES defined; the functions are always available.
+ * Each DW3000 instance has its own probes, the functions use those of the
+ * selected instance (port_select_dw_ic()). A probe has a single start
+ * timestamp, so it should not be used from two contexts at once. */
+typedef struct {
+    const char * name;
+    uint32_t     start;
+    uint32_t     count;
+    uint32_t     last;
+    uint32_t     min;
+    uint32_t     max;
+    uint64_t     total;
+} port_probe_t;
+
+void port_probe_start(int probe);
+void port_probe_stop(int probe);
+const port_probe_t * port_probe_get(int probe);
+void port_probe_reset(void);
+void port_probe_dump(void);
 
 #define S1_SWITCH_ON  (1)
 #define S1_SWITCH_OFF (0)
@@ -103,11 +184,38 @@ unsigned long portGetTickCnt(void);
 int port_is_switch_on(uint16_t GPIOpin);
 int port_is_boot1_low(void);
 
-void port_wakeup_dw3000(void);
-void port_wakeup_dw3000_fast(void);
+/* Wake up with CS only (no WAKEUP pin) and restore the non-AON configuration,
+ * returns 0 for success, or -1 on timeout (see port.c) */
+int  port_wakeup_dw3000(void);
+/* Wake up on the SPIRDY interrupt and restore the non-AON configuration,
+ * returns 0 for success, or -1 on timeout (see port.c) */
+int  port_wakeup_dw3000_fast(void);
+
+/* Result of port_sync_dw_ics() for one instance */
+typedef struct {
+    uint32_t systime;   /* SYS_TIME read back after the pulse (DWT_SYSTIME_PER_US per us) */
+    uint32_t max_us;    /* bound on the time from the pulse to the read */
+    int      ok;        /* 0 if the counter restarted, else -1 */
+} port_sync_result_t;
+
+/* SYNC pin ("dwm-sync-gpios"): one pulse, and the one shot timebase reset of
+ * all instances, returns 0 for success, or -1 for error (see port.c) */
+int  port_sync_pulse(void);
+int  port_sync_dw_ics(uint8_t wait, port_sync_result_t * res);
 
 void port_set_dw_ic_spi_slowrate(void);
 void port_set_dw_ic_spi_fastrate(void);
+uint32_t port_calibrate_dw_ic_spi_fastrate(void);
+
+/* Warm boot copy of the OTP data (see dwt_setinitcache()), kept in no-init RAM:
+ * port_warm_cache_load() before dwt_initialise(), port_warm_cache_save() after it. */
+int  port_warm_cache_load(void);
+int  port_warm_cache_save(void);
+void port_warm_cache_clear(void);
+
+/* Persistent values of the selected instance (Zephyr settings, needs CONFIG_SETTINGS) */
+int  port_setting_save(const char * name, const void * value, size_t len);
+int  port_setting_load(const char * name, void * value, size_t len);
 
 void process_dwRSTn_irq(void);
 void process_deca_irq(void);
@@ -120,8 +228,42 @@ void spi_peripheral_init(void);
 
 void setup_DW3000RSTnIRQ(int enable);
 
+/* DW3000 reset strategies of port_reset_dw3000() */
+#define PORT_RESET_SOFT     0   /* dwt_softreset() over SPI, the caller waits for IDLE_RC */
+#define PORT_RESET_PIN      1   /* RSTn pulse and a fixed 2ms wait, the caller waits for IDLE_RC */
+#define PORT_RESET_PIN_IRQ  2   /* RSTn pulse, waits for the RSTn release and the SPIRDY IRQ: IDLE_RC on return */
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_reset_dw3000()
+ *
+ * @brief This function resets the selected DW3000 with one of the PORT_RESET_x strategies. reset_DWIC() uses
+ *        PORT_RESET_MODE (add_definitions(-DPORT_RESET_MODE=2) in the CMakeLists.txt), PORT_RESET_SOFT by default.
+ *
+ * NOTE: PORT_RESET_PIN_IRQ waits for the SPIRDY IRQ edge when the IRQ handler is installed (port_set_dwic_isr()),
+ *       else reads the status until IDLE_RC, up to PORT_RESET_TIMEOUT_MS for each wait.
+ *
+ * @param mode     PORT_RESET_SOFT, PORT_RESET_PIN or PORT_RESET_PIN_IRQ
+ *
+ * @return 0 for success, or -1 if the device did not come out of reset in time
+ */
+int  port_reset_dw3000(int mode);
 void reset_DWIC(void);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_recover_dw3000()
+ *
+ * @brief This function recovers the selected DW3000 after an SPI error or a brownout: PORT_RESET_PIN_IRQ reset,
+ *        dwt_initialise() from the warm boot copy of the OTP data (port_warm_cache_load()), then the configuration
+ *        from a register image (dwt_cfgimage_build()), without the OTP reads and the dwt_configure() register set up.
+ *
+ * NOTE: the TX power, antenna delays, interrupt mask and callbacks are set again by the application.
+ *
+ * @param img      register image to configure the device with, or NULL
+ *
+ * @return 0 for success, or -1 for error
+ */
+int  port_recover_dw3000(const dwt_cfgimage_t * img);
+
 extern uint32_t HAL_GetTick(void);
 
 #ifdef __cplusplus
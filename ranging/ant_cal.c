@@ -0,0 +1,224 @@
+/*! ----------------------------------------------------------------------------
+ * @file    ant_cal.c
+ * @brief   Antenna delay calibration and persistent storage
+ *
+ *          See ant_cal.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <port.h>
+#include <ranging_math.h>
+#include <ant_cal.h>
+
+static struct
+{
+    ant_cal_ref_t   ref[ANT_CAL_MAX_REFS];
+    uint8_t         count;
+    uint8_t         samples;
+    uint16_t        ant_dly;
+    uint8_t         n[ANT_CAL_MAX_REFS];
+    int32_t         err[ANT_CAL_MAX_REFS][ANT_CAL_MAX_SAMPLES];
+} cal;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ant_cal_median()
+ *
+ * @brief Sort the samples and return their median.
+ *
+ * @param v - samples, sorted on return
+ * @param n - number of samples
+ *
+ * @return median
+ */
+static int32_t ant_cal_median(int32_t *v, uint8_t n)
+{
+    int i, j;
+
+    for (i = 1; i < n; i++)
+    {
+        int32_t x = v[i];
+
+        for (j = i; (j > 0) && (v[j - 1] > x); j--)
+        {
+            v[j] = v[j - 1];
+        }
+        v[j] = x;
+    }
+
+    return (n & 1) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ant_cal_setting_name()
+ *
+ * @brief Return the settings name of the antenna delay of a channel.
+ *
+ * @param chan - channel
+ *
+ * @return name
+ */
+static const char * ant_cal_setting_name(uint8_t chan)
+{
+    return (chan == 9) ? "antdly9" : "antdly5";
+}
+
+int ant_cal_start(const ant_cal_ref_t *refs, uint8_t count, uint8_t samples, uint16_t ant_dly)
+{
+    if ((refs == NULL) || (count == 0) || (count > ANT_CAL_MAX_REFS) || (samples == 0) ||
+        (samples > ANT_CAL_MAX_SAMPLES))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&cal, 0, sizeof(cal));
+    memcpy(cal.ref, refs, count * sizeof(refs[0]));
+    cal.count = count;
+    cal.samples = samples;
+    cal.ant_dly = ant_dly;
+
+    return DWT_SUCCESS;
+}
+
+int ant_cal_push(const twr_result_t *result)
+{
+    uint8_t i, done = 1;
+
+    if ((result->status == TWR_OK) && result->has_tof)
+    {
+        for (i = 0; i < cal.count; i++)
+        {
+            if ((cal.ref[i].addr == result->peer) && (cal.n[i] < cal.samples))
+            {
+                cal.err[i][cal.n[i]++] = result->tof - ranging_mm_to_tof(cal.ref[i].distance_mm);
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < cal.count; i++)
+    {
+        if (cal.n[i] < cal.samples)
+        {
+            done = 0;
+        }
+    }
+
+    return done;
+}
+
+int ant_cal_solve(ant_cal_result_t *res)
+{
+    int32_t sum = 0, lo = INT32_MAX, hi = INT32_MIN, corr;
+    uint8_t i;
+
+    if (cal.count == 0)
+    {
+        return DWT_ERROR;
+    }
+
+    memset(res, 0, sizeof(*res));
+    for (i = 0; i < cal.count; i++)
+    {
+        if (cal.n[i] < cal.samples)
+        {
+            return DWT_ERROR;
+        }
+        res->error[i] = ant_cal_median(cal.err[i], cal.n[i]);
+        sum += res->error[i];
+        lo = (res->error[i] < lo) ? res->error[i] : lo;
+        hi = (res->error[i] > hi) ? res->error[i] : hi;
+    }
+    res->spread_mm = ranging_tof_to_mm(hi - lo);
+
+    /* mean error, rounded to whole dtu */
+    corr = sum / cal.count;
+    corr = (corr + ((corr >= 0) ? 8 : -8)) / (1 << RANGING_TOF_FRAC_BITS);
+    if ((corr > ANT_CAL_MAX_CORR_DTU) || (corr < -ANT_CAL_MAX_CORR_DTU) ||
+        ((int32_t)cal.ant_dly + corr < 0) || ((int32_t)cal.ant_dly + corr > 0xFFFF))
+    {
+        return DWT_ERROR;
+    }
+    res->ant_dly = (uint16_t)(cal.ant_dly + corr);
+
+    return DWT_SUCCESS;
+}
+
+int ant_cal_store(uint8_t chan, uint16_t ant_dly, uint8_t where)
+{
+    int ret = DWT_SUCCESS;
+
+    if (where & ANT_CAL_STORE_SETTINGS)
+    {
+        if (port_setting_save(ant_cal_setting_name(chan), &ant_dly, sizeof(ant_dly)) != 0)
+        {
+            ret = DWT_ERROR;
+        }
+    }
+
+    if (where & ANT_CAL_STORE_OTP)
+    {
+        uint32_t word;
+        uint16_t addr;
+
+        /* OTP bits can only be set: use the first blank slot */
+        for (addr = ANT_CAL_OTP_ADDRESS; addr < (ANT_CAL_OTP_ADDRESS + ANT_CAL_OTP_SLOTS); addr++)
+        {
+            dwt_otpread(addr, &word, 1);
+            if (word == 0)
+            {
+                break;
+            }
+        }
+        word = ((uint32_t)ANT_CAL_OTP_MAGIC << 24) | ((uint32_t)(chan & 0xF) << 16) | ant_dly;
+        if ((addr == (ANT_CAL_OTP_ADDRESS + ANT_CAL_OTP_SLOTS)) || (dwt_otpwriteandverify(word, addr) != DWT_SUCCESS))
+        {
+            ret = DWT_ERROR;
+        }
+    }
+
+    return ret;
+}
+
+int ant_cal_load(uint8_t chan, uint16_t *ant_dly)
+{
+    uint32_t word[ANT_CAL_OTP_SLOTS];
+    int i, found = 0;
+
+    if (port_setting_load(ant_cal_setting_name(chan), ant_dly, sizeof(*ant_dly)) == 0)
+    {
+        return ANT_CAL_STORE_SETTINGS;
+    }
+
+    dwt_otpread(ANT_CAL_OTP_ADDRESS, word, ANT_CAL_OTP_SLOTS);
+    for (i = 0; i < ANT_CAL_OTP_SLOTS; i++)
+    {
+        if (((word[i] >> 24) == ANT_CAL_OTP_MAGIC) && (((word[i] >> 16) & 0xF) == (chan & 0xF)))
+        {
+            *ant_dly = (uint16_t)word[i];
+            found = ANT_CAL_STORE_OTP;
+        }
+    }
+
+    return found;
+}
+
+uint16_t ant_cal_apply(uint8_t chan, uint16_t default_dly)
+{
+    uint16_t ant_dly;
+
+    if (ant_cal_load(chan, &ant_dly) == 0)
+    {
+        ant_dly = default_dly;
+    }
+
+    dwt_setrxantennadelay(ant_dly);
+    dwt_settxantennadelay(ant_dly);
+
+    return ant_dly;
+}
@@ -0,0 +1,138 @@
+/*! ----------------------------------------------------------------------------
+ * @file    ant_cal.h
+ * @brief   Antenna delay calibration and persistent storage
+ *
+ *          Calibration: the device ranges (SS-TWR initiator or DS-TWR
+ *          responder, which compute the distance) against calibrated
+ *          references at known distances. The median time of flight error
+ *          to each reference is the error of the device antenna delay (the
+ *          same delay is used for TX and RX, so a delay error of D adds D to
+ *          the time of flight). The errors of the references are averaged.
+ *
+ *          Storage: the Zephyr settings (port_setting_save(), rewritable) or
+ *          the DW3000 OTP (dwt_otpwriteandverify(), ANT_CAL_OTP_SLOTS writes
+ *          per device). ant_cal_apply() at init loads the delay of the
+ *          channel, the settings first, and programs it.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _ANT_CAL_H_
+#define _ANT_CAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <twr.h>
+
+#define ANT_CAL_MAX_REFS            4
+#define ANT_CAL_MAX_SAMPLES         32
+#define ANT_CAL_MAX_CORR_DTU        1000    /* larger corrections are refused (wrong distance, bad reference...) */
+
+/* OTP words: [31:24] ANT_CAL_OTP_MAGIC, [19:16] channel, [15:0] antenna delay. The last valid slot wins. */
+#ifndef ANT_CAL_OTP_ADDRESS
+#define ANT_CAL_OTP_ADDRESS         0x60
+#endif
+#define ANT_CAL_OTP_SLOTS           8
+#define ANT_CAL_OTP_MAGIC           0xAD
+
+/* Storage, for ant_cal_store() and the ant_cal_load() result */
+#define ANT_CAL_STORE_SETTINGS      0x1
+#define ANT_CAL_STORE_OTP           0x2
+
+typedef struct
+{
+    uint16_t    addr;           /* reference address */
+    int32_t     distance_mm;    /* surveyed distance */
+} ant_cal_ref_t;
+
+typedef struct
+{
+    uint16_t    ant_dly;                    /* calibrated antenna delay (TX and RX) */
+    int32_t     error[ANT_CAL_MAX_REFS];    /* median time of flight error per reference, in 1/16 dtu */
+    int32_t     spread_mm;                  /* largest difference between the reference errors */
+} ant_cal_result_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ant_cal_start()
+ *
+ * @brief Start collecting ranges for a calibration.
+ *
+ * @param refs - references (copied)
+ * @param count - number of references (1 to ANT_CAL_MAX_REFS)
+ * @param samples - ranges per reference (1 to ANT_CAL_MAX_SAMPLES)
+ * @param ant_dly - antenna delay the ranges are measured with
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters)
+ */
+int ant_cal_start(const ant_cal_ref_t *refs, uint8_t count, uint8_t samples, uint16_t ant_dly);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ant_cal_push()
+ *
+ * @brief Add a TWR result (results without time of flight or from other peers are ignored).
+ *
+ * @param result - TWR result
+ *
+ * @return 1 when all the references have their samples, else 0
+ */
+int ant_cal_push(const twr_result_t *result);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ant_cal_solve()
+ *
+ * @brief Compute the antenna delay from the collected ranges.
+ *
+ * @param res - result
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if samples are missing or the correction exceeds ANT_CAL_MAX_CORR_DTU
+ */
+int ant_cal_solve(ant_cal_result_t *res);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ant_cal_store()
+ *
+ * @brief Store the antenna delay of a channel.
+ *
+ * @param chan - channel (5 or 9)
+ * @param ant_dly - antenna delay
+ * @param where - ANT_CAL_STORE_SETTINGS and/or ANT_CAL_STORE_OTP
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if a store failed (or no OTP slot is left)
+ */
+int ant_cal_store(uint8_t chan, uint16_t ant_dly, uint8_t where);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ant_cal_load()
+ *
+ * @brief Load the stored antenna delay of a channel, from the settings or else from the OTP.
+ *
+ * @param chan - channel (5 or 9)
+ * @param ant_dly - loaded antenna delay
+ *
+ * @return ANT_CAL_STORE_SETTINGS or ANT_CAL_STORE_OTP (where it was found), or 0 if none is stored
+ */
+int ant_cal_load(uint8_t chan, uint16_t *ant_dly);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ant_cal_apply()
+ *
+ * @brief Load the stored antenna delay of a channel (or use the default) and program it for TX and RX.
+ *
+ * @param chan - channel (5 or 9)
+ * @param default_dly - delay used when none is stored
+ *
+ * @return antenna delay programmed
+ */
+uint16_t ant_cal_apply(uint8_t chan, uint16_t default_dly);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ANT_CAL_H_ */
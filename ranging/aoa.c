@@ -0,0 +1,345 @@
+/*! ----------------------------------------------------------------------------
+ * @file    aoa.c
+ * @brief   PDoA angle of arrival with per-board calibration
+ *
+ *          See aoa.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <aoa.h>
+
+#define AOA_ASIN_STEPS      64      /* asin table: 0 to 1 in 64 steps, Q15 input */
+#define AOA_ASIN_SHIFT      9       /* 32768 / AOA_ASIN_STEPS = 2^9 */
+#define AOA_HALF_WAVE_Q16   32768   /* default antenna spacing: half a wavelength */
+
+/* asin(i / 64) in 0.01 degree, linear interpolation is within 0.05 degree up to 72 degrees */
+static const int16_t aoa_asin_tab[AOA_ASIN_STEPS + 1] =
+{
+       0,   90,  179,  269,  358,  448,  538,  628,  718,  808,  899,  990, 1081, 1172, 1264, 1355,
+    1448, 1540, 1633, 1727, 1821, 1916, 2011, 2106, 2202, 2299, 2397, 2495, 2594, 2694, 2795, 2897,
+    3000, 3104, 3209, 3315, 3423, 3532, 3642, 3754, 3868, 3984, 4101, 4221, 4343, 4468, 4595, 4725,
+    4859, 4996, 5138, 5283, 5434, 5591, 5754, 5925, 6104, 6295, 6499, 6720, 6964, 7239, 7564, 7986,
+    9000
+};
+
+typedef struct
+{
+    uint16_t    addr;
+    uint8_t     used;
+    uint8_t     count;          /* samples in the window */
+    uint8_t     seq;
+    uint8_t     dist_count;     /* samples with a distance */
+    int16_t     ref;            /* PDoA of the first sample, the others are taken relative to it */
+    int16_t     min_d;
+    int16_t     max_d;
+    int32_t     sum_d;
+    int64_t     dist_sum;
+} aoa_peer_t;
+
+static struct
+{
+    aoa_config_t    cfg;
+    aoa_out_cb_t    cb;
+    const aoa_cal_t *cal;
+    aoa_peer_t      peer[AOA_MAX_PEERS];
+    aoa_stats_t     stats;
+} aoa;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_wrap()
+ *
+ * @brief Wrap a phase to (-pi, pi].
+ *
+ * @param p - phase, PDoA units
+ *
+ * @return wrapped phase
+ */
+static int16_t aoa_wrap(int32_t p)
+{
+    while (p > AOA_PI)
+    {
+        p -= AOA_2PI;
+    }
+    while (p <= -AOA_PI)
+    {
+        p += AOA_2PI;
+    }
+    return (int16_t)p;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_asin()
+ *
+ * @brief Integer arcsine.
+ *
+ * @param s - sine, Q15, -32768 to 32768
+ *
+ * @return angle, 0.01 degree
+ */
+static int16_t aoa_asin(int32_t s)
+{
+    uint32_t u = (s < 0) ? (uint32_t)-s : (uint32_t)s;
+    uint32_t i = u >> AOA_ASIN_SHIFT;
+    int32_t a;
+
+    if (i >= AOA_ASIN_STEPS)
+    {
+        a = aoa_asin_tab[AOA_ASIN_STEPS];
+    }
+    else
+    {
+        a = aoa_asin_tab[i] + (((aoa_asin_tab[i + 1] - aoa_asin_tab[i]) * (int32_t)(u & ((1U << AOA_ASIN_SHIFT) - 1)) +
+                                (1 << (AOA_ASIN_SHIFT - 1))) >> AOA_ASIN_SHIFT);
+    }
+    return (int16_t)((s < 0) ? -a : a);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_find_cal()
+ *
+ * @brief Find the calibration of a channel.
+ *
+ * @param chan - channel
+ *
+ * @return calibration, or NULL
+ */
+static const aoa_cal_t * aoa_find_cal(uint8_t chan)
+{
+    uint8_t i;
+
+    for (i = 0; i < aoa.cfg.cal_count; i++)
+    {
+        if (aoa.cfg.cal[i].chan == chan)
+        {
+            return &aoa.cfg.cal[i];
+        }
+    }
+    return NULL;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_find()
+ *
+ * @brief Find the window of a peer, or allocate it.
+ *
+ * @param addr - peer address
+ *
+ * @return peer state, or NULL if the table is full
+ */
+static aoa_peer_t * aoa_find(uint16_t addr)
+{
+    aoa_peer_t *free_peer = NULL;
+    int i;
+
+    for (i = 0; i < AOA_MAX_PEERS; i++)
+    {
+        if (aoa.peer[i].used && (aoa.peer[i].addr == addr))
+        {
+            return &aoa.peer[i];
+        }
+        if (!aoa.peer[i].used && (free_peer == NULL))
+        {
+            free_peer = &aoa.peer[i];
+        }
+    }
+
+    if (free_peer != NULL)
+    {
+        memset(free_peer, 0, sizeof(*free_peer));
+        free_peer->addr = addr;
+        free_peer->used = 1;
+    }
+    return free_peer;
+}
+
+int aoa_init(const aoa_config_t *cfg, aoa_out_cb_t cb)
+{
+    if ((cfg == NULL) || (cfg->cal == NULL) || (cfg->cal_count == 0) || (cfg->cal_count > AOA_MAX_CAL) ||
+        (cfg->window == 0) || (cfg->window > AOA_WINDOW_MAX))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&aoa, 0, sizeof(aoa));
+    aoa.cfg = *cfg;
+    aoa.cb = cb;
+    aoa.cal = aoa_find_cal(cfg->chan);
+
+    return (aoa.cal != NULL) ? DWT_SUCCESS : DWT_ERROR;
+}
+
+int aoa_set_channel(uint8_t chan)
+{
+    const aoa_cal_t *cal = aoa_find_cal(chan);
+    int i;
+
+    if (cal == NULL)
+    {
+        return DWT_ERROR;
+    }
+
+    aoa.cal = cal;
+    aoa.cfg.chan = chan;
+    for (i = 0; i < AOA_MAX_PEERS; i++)
+    {
+        aoa.peer[i].count = 0;
+    }
+    return DWT_SUCCESS;
+}
+
+int16_t aoa_pdoa_to_angle(int16_t pdoa)
+{
+    const aoa_cal_t *cal = aoa.cal;
+    int64_t s;
+    int32_t spacing;
+    uint8_t i;
+
+    if (cal == NULL)
+    {
+        return 0;
+    }
+
+    if ((cal->points != NULL) && (cal->count != 0))
+    {
+        const aoa_cal_point_t *pt = cal->points;
+
+        if ((cal->count == 1) || (pdoa <= pt[0].pdoa))
+        {
+            return pt[0].angle_cdeg;
+        }
+        for (i = 1; i < cal->count; i++)
+        {
+            if (pdoa <= pt[i].pdoa)
+            {
+                return (int16_t)(pt[i - 1].angle_cdeg + (int32_t)(pt[i].angle_cdeg - pt[i - 1].angle_cdeg) *
+                                 (pdoa - pt[i - 1].pdoa) / (pt[i].pdoa - pt[i - 1].pdoa));
+            }
+        }
+        return pt[cal->count - 1].angle_cdeg;
+    }
+
+    /* sin(angle) = pdoa / (2 pi spacing): in Q15, pdoa * 2^31 / (2pi * 2^11 * spacing * 2^16 / 2^16) */
+    spacing = (cal->spacing_q16 != 0) ? cal->spacing_q16 : AOA_HALF_WAVE_Q16;
+    s = ((int64_t)pdoa << 31) / ((int64_t)AOA_2PI * spacing);
+    if (s > 32768)
+    {
+        s = 32768;
+    }
+    else if (s < -32768)
+    {
+        s = -32768;
+    }
+    return aoa_asin((int32_t)s);
+}
+
+void aoa_sample(uint16_t peer, uint8_t seq, int32_t distance_mm, aoa_sample_t *sample)
+{
+    dwt_rxinfo_t info;
+
+    dwt_readrxinfo(&info, DWT_RXINFO_CIA | DWT_RXINFO_STS);
+
+    sample->peer = peer;
+    sample->seq = seq;
+    sample->pdoa = info.pdoa;
+    sample->sts_quality = info.stsQuality;
+    sample->distance_mm = distance_mm;
+}
+
+int aoa_push(const aoa_sample_t *sample)
+{
+    aoa_peer_t *p;
+    aoa_out_t out;
+    int16_t pdoa, d, lo, hi;
+    int32_t sum;
+
+    if ((sample->sts_quality != AOA_STS_NONE) && (sample->sts_quality < aoa.cfg.min_sts_quality))
+    {
+        aoa.stats.rej_sts++;
+        return 0;
+    }
+
+    p = aoa_find(sample->peer);
+    if (p == NULL)
+    {
+        aoa.stats.dropped_peers++;
+        return 0;
+    }
+    aoa.stats.accepted++;
+
+    pdoa = aoa_wrap((int32_t)sample->pdoa - aoa.cal->pdoa_offset);
+    if (p->count == 0)
+    {
+        p->ref = pdoa;
+        p->sum_d = 0;
+        p->min_d = 0;
+        p->max_d = 0;
+        p->dist_sum = 0;
+        p->dist_count = 0;
+    }
+
+    d = aoa_wrap((int32_t)pdoa - p->ref);
+    p->sum_d += d;
+    p->min_d = (d < p->min_d) ? d : p->min_d;
+    p->max_d = (d > p->max_d) ? d : p->max_d;
+    if (sample->distance_mm != AOA_DIST_NONE)
+    {
+        p->dist_sum += sample->distance_mm;
+        p->dist_count++;
+    }
+    p->seq = sample->seq;
+    p->count++;
+
+    if (p->count < aoa.cfg.window)
+    {
+        return 1;
+    }
+
+    /* Window full: mean PDoA (rounded), angle and spread */
+    sum = (p->sum_d >= 0) ? (p->sum_d + p->count / 2) : (p->sum_d - p->count / 2);
+    out.peer = p->addr;
+    out.seq = p->seq;
+    out.samples = p->count;
+    out.pdoa = aoa_wrap((int32_t)p->ref + sum / p->count);
+    out.angle_cdeg = aoa_pdoa_to_angle(out.pdoa);
+    lo = aoa_pdoa_to_angle(aoa_wrap((int32_t)p->ref + p->min_d));
+    hi = aoa_pdoa_to_angle(aoa_wrap((int32_t)p->ref + p->max_d));
+    out.spread_cdeg = (uint16_t)((hi > lo) ? (hi - lo) : (lo - hi));
+    out.distance_mm = (p->dist_count != 0) ? (int32_t)(p->dist_sum / p->dist_count) : AOA_DIST_NONE;
+
+    p->count = 0;
+    aoa.stats.results++;
+    if (aoa.cb != NULL)
+    {
+        aoa.cb(&out);
+    }
+    return 1;
+}
+
+uint8_t aoa_out_pack(const aoa_out_t *out, uint8_t *buf)
+{
+    buf[0] = (uint8_t)out->peer;
+    buf[1] = (uint8_t)(out->peer >> 8);
+    buf[2] = out->seq;
+    buf[3] = out->samples;
+    buf[4] = (uint8_t)out->angle_cdeg;
+    buf[5] = (uint8_t)((uint16_t)out->angle_cdeg >> 8);
+    buf[6] = (uint8_t)out->spread_cdeg;
+    buf[7] = (uint8_t)(out->spread_cdeg >> 8);
+    buf[8] = (uint8_t)out->distance_mm;
+    buf[9] = (uint8_t)((uint32_t)out->distance_mm >> 8);
+    buf[10] = (uint8_t)((uint32_t)out->distance_mm >> 16);
+    buf[11] = (uint8_t)((uint32_t)out->distance_mm >> 24);
+
+    return AOA_RECORD_LEN;
+}
+
+const aoa_stats_t * aoa_get_stats(void)
+{
+    return &aoa.stats;
+}
@@ -0,0 +1,200 @@
+/*! ----------------------------------------------------------------------------
+ * @file    aoa.h
+ * @brief   PDoA angle of arrival with per-board calibration
+ *
+ *          Turns the PDoA of the frames received on a two antenna device
+ *          (PDOA mode 1 or 3, dwt_readpdoa()) into an angle of arrival, and
+ *          averages it per peer over a window so one bearing-plus-distance
+ *          result is produced per window instead of one value per frame:
+ *
+ *          aoa_sample()    in the RX (or TWR result) callback, reads the PDoA
+ *                          and STS quality of the frame just received
+ *          aoa_push()      rejects a bad STS, accumulates the PDoA (and the
+ *                          distance, when there is one) of the peer and calls
+ *                          the output callback once the window is full
+ *
+ *          The calibration of a board is one aoa_cal_t per channel: the PDoA
+ *          measured with the peer at 0 degrees (see NOTE 3 of
+ *          simple_rx_pdoa.c), and either the antenna spacing, for the ideal
+ *          model sin(angle) = PDoA * wavelength / (2 pi spacing), or a table of
+ *          measured angle against PDoA, interpolated linearly.
+ *
+ *          The PDoA is averaged on the circle (relative to the first sample of
+ *          the window), so a window around +/-180 degrees of phase does not
+ *          average to 0. All arithmetic is integer: PDoA in [1:-11] radian
+ *          units as read, angles in 0.01 degree. The functions are not
+ *          reentrant: push from one context.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _AOA_H_
+#define _AOA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define AOA_MAX_PEERS           4
+#define AOA_WINDOW_MAX          64
+#define AOA_MAX_CAL             2           /* calibrations per board (channels) */
+
+#define AOA_PI                  6434        /* pi in PDoA units ([1:-11] radian) */
+#define AOA_2PI                 12868
+
+#define AOA_STS_NONE            INT16_MIN   /* sts_quality: no STS in the frame */
+#define AOA_DIST_NONE           INT32_MIN   /* distance_mm: no range for the frame */
+
+/* Packed result: peer (2), seq (1), samples (1), angle (2), spread (2), distance (4), little endian */
+#define AOA_RECORD_LEN          12
+
+/* Calibration point: angle measured for a PDoA (offset removed) */
+typedef struct
+{
+    int16_t     pdoa;
+    int16_t     angle_cdeg;
+} aoa_cal_point_t;
+
+/* Board calibration for one channel */
+typedef struct
+{
+    uint8_t     chan;
+    int16_t     pdoa_offset;        /* PDoA measured at 0 degrees */
+    uint16_t    spacing_q16;        /* antenna spacing / wavelength, Q16, 0: half a wavelength (ideal model) */
+    const aoa_cal_point_t *points;  /* table, ascending PDoA, used instead of the ideal model (NULL: not used) */
+    uint8_t     count;              /* points in the table */
+} aoa_cal_t;
+
+typedef struct
+{
+    const aoa_cal_t *cal;           /* calibrations of the board */
+    uint8_t     cal_count;          /* 1 to AOA_MAX_CAL */
+    uint8_t     chan;               /* channel in use */
+    uint8_t     window;             /* samples per result (1 to AOA_WINDOW_MAX) */
+    int16_t     min_sts_quality;    /* reject below (dwt_readstsquality() index), when the frame has an STS */
+} aoa_config_t;
+
+/* PDoA of one frame */
+typedef struct
+{
+    uint16_t    peer;
+    uint8_t     seq;
+    int16_t     pdoa;
+    int16_t     sts_quality;        /* or AOA_STS_NONE */
+    int32_t     distance_mm;        /* or AOA_DIST_NONE */
+} aoa_sample_t;
+
+/* Window result: bearing and distance */
+typedef struct
+{
+    uint16_t    peer;
+    uint8_t     seq;                /* sequence number of the last sample */
+    uint8_t     samples;
+    int16_t     pdoa;               /* mean PDoA, offset removed */
+    int16_t     angle_cdeg;         /* angle of arrival, 0.01 degree, -9000 to 9000 */
+    uint16_t    spread_cdeg;        /* angle between the extreme samples of the window */
+    int32_t     distance_mm;        /* mean of the samples with a distance, or AOA_DIST_NONE */
+} aoa_out_t;
+
+typedef struct
+{
+    uint32_t    accepted;
+    uint32_t    rej_sts;
+    uint32_t    dropped_peers;      /* samples from peers beyond AOA_MAX_PEERS */
+    uint32_t    results;
+} aoa_stats_t;
+
+typedef void (*aoa_out_cb_t)(const aoa_out_t *out);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_init()
+ *
+ * @brief Set the configuration and select the calibration of the channel, clear the peers and the counters.
+ *
+ * @param cfg - configuration (copied, the calibrations are not)
+ * @param cb - output callback, called from aoa_push()
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad configuration, or no calibration for the channel)
+ */
+int aoa_init(const aoa_config_t *cfg, aoa_out_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_set_channel()
+ *
+ * @brief Select the calibration of another channel (e.g. after a channel change), and restart the windows.
+ *
+ * @param chan - channel
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (no calibration for the channel, the current one is kept)
+ */
+int aoa_set_channel(uint8_t chan);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_pdoa_to_angle()
+ *
+ * @brief Convert a PDoA, offset already removed, to an angle with the current calibration.
+ *
+ * @param pdoa - PDoA, [1:-11] radian
+ *
+ * @return angle, 0.01 degree
+ */
+int16_t aoa_pdoa_to_angle(int16_t pdoa);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_sample()
+ *
+ * @brief Make a sample from the frame just received: PDoA and STS quality, read in one go (dwt_readrxinfo()).
+ *        Call from the RX callback, or from the TWR result callback with the result peer, seq and distance_mm.
+ *
+ * @param peer - address of the sender
+ * @param seq - frame sequence number
+ * @param distance_mm - range to the peer, or AOA_DIST_NONE
+ * @param sample - sample to fill
+ *
+ * @return none
+ */
+void aoa_sample(uint16_t peer, uint8_t seq, int32_t distance_mm, aoa_sample_t *sample);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_push()
+ *
+ * @brief Add a sample to the window of its peer. Calls the output callback when the window is full.
+ *
+ * @param sample - sample
+ *
+ * @return 1 if the sample was accepted, 0 if rejected
+ */
+int aoa_push(const aoa_sample_t *sample);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_out_pack()
+ *
+ * @brief Pack a result into AOA_RECORD_LEN bytes, e.g. for the host link.
+ *
+ * @param out - result
+ * @param buf - destination, AOA_RECORD_LEN bytes
+ *
+ * @return AOA_RECORD_LEN
+ */
+uint8_t aoa_out_pack(const aoa_out_t *out, uint8_t *buf);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aoa_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @return counters
+ */
+const aoa_stats_t * aoa_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AOA_H_ */
@@ -0,0 +1,397 @@
+/*! ----------------------------------------------------------------------------
+ * @file    multilat.c
+ * @brief   Position from the distances to N anchors (multilateration)
+ *
+ *          See multilat.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include <deca_device_api.h>
+#include <multilat.h>
+
+#define MULTILAT_DAMPING    1e-6f       /* diagonal damping, relative to the normal matrix trace */
+#define MULTILAT_MIN_DIST_M 1e-3f       /* distance below which the direction to an anchor is not used */
+#define MULTILAT_NO_DROP    0xFF
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn multilat_gauss_newton()
+ *
+ * @brief Gauss-Newton iterations from p over the anchors of the valid mask.
+ *
+ * @param ml - solver
+ * @param a - anchor coordinates, m from origin
+ * @param d - distances, m
+ * @param valid - anchors used
+ * @param p - start point, solution on return
+ * @param fix - iterations, status (MULTILAT_SINGULAR, MULTILAT_NO_CONVERGENCE or MULTILAT_OK)
+ *
+ * @return none
+ */
+static void multilat_gauss_newton(const multilat_t *ml, float a[][3], const float *d, uint32_t valid, float *p,
+                                  multilat_fix_t *fix)
+{
+    uint8_t dims = ml->cfg.dims;
+    float tol = ml->cfg.tol_mm * 1e-3f;
+    float n[3][3];
+    float g[3];
+    float step[3];
+    float u[3];
+    float r, res, det, damp;
+    uint8_t it, i, j, k;
+
+    fix->status = MULTILAT_NO_CONVERGENCE;
+
+    for (it = 0; it < ml->cfg.max_iter; it++)
+    {
+        memset(n, 0, sizeof(n));
+        memset(g, 0, sizeof(g));
+
+        // Normal equations: (J^T J) step = -J^T res, J row = unit vector from the anchor to p
+        for (i = 0; i < ml->count; i++)
+        {
+            if (!(valid & (1UL << i)))
+            {
+                continue;
+            }
+            for (k = 0, r = 0.0f; k < 3; k++)
+            {
+                u[k] = p[k] - a[i][k];
+                r += u[k] * u[k];
+            }
+            r = sqrtf(r);
+            if (r < MULTILAT_MIN_DIST_M)
+            {
+                continue;
+            }
+            res = r - d[i];
+            for (j = 0; j < dims; j++)
+            {
+                u[j] /= r;
+                g[j] -= u[j] * res;
+                for (k = 0; k <= j; k++)
+                {
+                    n[j][k] += u[j] * u[k];
+                }
+            }
+        }
+
+        damp = MULTILAT_DAMPING * (n[0][0] + n[1][1] + n[2][2]);
+        for (j = 0; j < dims; j++)
+        {
+            n[j][j] += damp;
+            for (k = 0; k < j; k++)
+            {
+                n[k][j] = n[j][k];
+            }
+        }
+
+        // Cramer's rule, the system is 2x2 or 3x3
+        if (dims == 2)
+        {
+            det = n[0][0] * n[1][1] - n[0][1] * n[1][0];
+            if (!(fabsf(det) > 1e-9f))
+            {
+                fix->status = MULTILAT_SINGULAR;
+                return;
+            }
+            step[0] = (g[0] * n[1][1] - g[1] * n[0][1]) / det;
+            step[1] = (n[0][0] * g[1] - n[1][0] * g[0]) / det;
+            step[2] = 0.0f;
+        }
+        else
+        {
+            float c0 = n[1][1] * n[2][2] - n[1][2] * n[2][1];
+            float c1 = n[1][0] * n[2][2] - n[1][2] * n[2][0];
+            float c2 = n[1][0] * n[2][1] - n[1][1] * n[2][0];
+
+            det = n[0][0] * c0 - n[0][1] * c1 + n[0][2] * c2;
+            if (!(fabsf(det) > 1e-12f))
+            {
+                fix->status = MULTILAT_SINGULAR;
+                return;
+            }
+            step[0] = (g[0] * c0
+                       - n[0][1] * (g[1] * n[2][2] - n[1][2] * g[2])
+                       + n[0][2] * (g[1] * n[2][1] - n[1][1] * g[2])) / det;
+            step[1] = (n[0][0] * (g[1] * n[2][2] - n[1][2] * g[2])
+                       - g[0] * c1
+                       + n[0][2] * (n[1][0] * g[2] - g[1] * n[2][0])) / det;
+            step[2] = (n[0][0] * (n[1][1] * g[2] - g[1] * n[2][1])
+                       - n[0][1] * (n[1][0] * g[2] - g[1] * n[2][0])
+                       + g[0] * c2) / det;
+        }
+
+        for (k = 0; k < dims; k++)
+        {
+            p[k] += step[k];
+        }
+        fix->iterations = it + 1;
+
+        if ((step[0] * step[0] + step[1] * step[1] + step[2] * step[2]) < tol * tol)
+        {
+            fix->status = MULTILAT_OK;
+            return;
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn multilat_residuals()
+ *
+ * @brief Residuals at p: RMS and largest.
+ *
+ * @param ml - solver
+ * @param a - anchor coordinates, m from origin
+ * @param d - distances, m
+ * @param valid - anchors used
+ * @param p - point
+ * @param fix - rms_mm, max_res_mm, used
+ *
+ * @return none
+ */
+static void multilat_residuals(const multilat_t *ml, float a[][3], const float *d, uint32_t valid, const float *p,
+                                  multilat_fix_t *fix)
+{
+    float sum = 0.0f;
+    float worst = 0.0f;
+    float r, res;
+    uint8_t used = 0;
+    uint8_t i, k;
+
+    for (i = 0; i < ml->count; i++)
+    {
+        if (!(valid & (1UL << i)))
+        {
+            continue;
+        }
+        for (k = 0, r = 0.0f; k < 3; k++)
+        {
+            r += (p[k] - a[i][k]) * (p[k] - a[i][k]);
+        }
+        res = fabsf(sqrtf(r) - d[i]);
+        sum += res * res;
+        if (res > worst)
+        {
+            worst = res;
+        }
+        used++;
+    }
+
+    r = (used != 0) ? sqrtf(sum / used) * 1000.0f : 0.0f;
+    fix->rms_mm = (r < 65535.0f) ? (uint16_t)(r + 0.5f) : 0xFFFF;
+    fix->max_res_mm = (worst * 1000.0f < 65535.0f) ? (uint16_t)(worst * 1000.0f + 0.5f) : 0xFFFF;
+    fix->used = used;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn multilat_count()
+ *
+ * @brief Number of bits set.
+ *
+ * @param valid - mask
+ *
+ * @return count
+ */
+static uint8_t multilat_count(uint32_t valid)
+{
+    uint8_t n = 0;
+
+    for (; valid != 0; valid &= valid - 1)
+    {
+        n++;
+    }
+
+    return n;
+}
+
+int multilat_init(multilat_t *ml, const multilat_config_t *cfg, const multilat_anchor_t *anchors, uint8_t count)
+{
+    uint8_t i;
+
+    if ((count == 0) || (count > MULTILAT_MAX_ANCHORS) || ((cfg->dims != 2) && (cfg->dims != 3)) ||
+        (cfg->max_iter == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(ml, 0, sizeof(*ml));
+    ml->cfg = *cfg;
+    memcpy(ml->anchor, anchors, count * sizeof(anchors[0]));
+    ml->count = count;
+
+    // Work around the anchor centroid: metres with small values keep the float precision
+    for (i = 0; i < count; i++)
+    {
+        ml->origin[0] += anchors[i].pos.x_mm * 1e-3f;
+        ml->origin[1] += anchors[i].pos.y_mm * 1e-3f;
+        ml->origin[2] += anchors[i].pos.z_mm * 1e-3f;
+    }
+    ml->origin[0] /= count;
+    ml->origin[1] /= count;
+    ml->origin[2] /= count;
+
+    return DWT_SUCCESS;
+}
+
+int multilat_solve(multilat_t *ml, const int32_t *dist_mm, uint32_t valid, multilat_fix_t *fix)
+{
+    float a[MULTILAT_MAX_ANCHORS][3];
+    float d[MULTILAT_MAX_ANCHORS];
+    float p[3];
+    float start[3];
+    float q[3];
+    multilat_fix_t retry;
+    uint8_t min = (ml->cfg.dims == 2) ? 3 : 4;
+    uint8_t i;
+
+    memset(fix, 0, sizeof(*fix));
+    fix->dropped = MULTILAT_NO_DROP;
+
+    valid &= (1UL << ml->count) - 1;
+    for (i = 0; i < ml->count; i++)
+    {
+        if (dist_mm[i] < 0)
+        {
+            valid &= ~(1UL << i);
+        }
+        a[i][0] = ml->anchor[i].pos.x_mm * 1e-3f - ml->origin[0];
+        a[i][1] = ml->anchor[i].pos.y_mm * 1e-3f - ml->origin[1];
+        a[i][2] = ml->anchor[i].pos.z_mm * 1e-3f - ml->origin[2];
+        d[i] = dist_mm[i] * 1e-3f;
+    }
+
+    fix->used = multilat_count(valid);
+    if (fix->used < min)
+    {
+        fix->status = MULTILAT_FEW_RANGES;
+        return DWT_ERROR;
+    }
+
+    // Start from the last good fix, else from the centroid (at the tag height in 2D)
+    if (ml->has_last)
+    {
+        memcpy(start, ml->last, sizeof(start));
+    }
+    else
+    {
+        start[0] = 0.0f;
+        start[1] = 0.0f;
+        start[2] = 0.0f;
+    }
+    if (ml->cfg.dims == 2)
+    {
+        start[2] = ml->cfg.z_mm * 1e-3f - ml->origin[2];
+    }
+
+    memcpy(p, start, sizeof(p));
+    multilat_gauss_newton(ml, a, d, valid, p, fix);
+    multilat_residuals(ml, a, d, valid, p, fix);
+
+    // A bad fit with spare ranges: solve again without each range in turn, keep the best fit. The least squares
+    // spread the error of a long range over the others, its own residual is not always the largest.
+    if ((fix->status != MULTILAT_SINGULAR) && (fix->rms_mm > ml->cfg.max_rms_mm) && (fix->used > min))
+    {
+        for (i = 0; i < ml->count; i++)
+        {
+            if (!(valid & (1UL << i)))
+            {
+                continue;
+            }
+            memcpy(q, start, sizeof(q));
+            multilat_gauss_newton(ml, a, d, valid & ~(1UL << i), q, &retry);
+            if (retry.status == MULTILAT_SINGULAR)
+            {
+                continue;
+            }
+            multilat_residuals(ml, a, d, valid & ~(1UL << i), q, &retry);
+            if (retry.rms_mm < fix->rms_mm)
+            {
+                *fix = retry;
+                fix->dropped = i;
+                memcpy(p, q, sizeof(p));
+            }
+        }
+    }
+
+    if ((fix->status == MULTILAT_OK) && (fix->rms_mm > ml->cfg.max_rms_mm))
+    {
+        fix->status = MULTILAT_BAD_FIT;
+    }
+
+    if (fix->status == MULTILAT_SINGULAR)
+    {
+        return DWT_ERROR;
+    }
+
+    fix->pos.x_mm = (int32_t)lrintf((p[0] + ml->origin[0]) * 1000.0f);
+    fix->pos.y_mm = (int32_t)lrintf((p[1] + ml->origin[1]) * 1000.0f);
+    fix->pos.z_mm = (int32_t)lrintf((p[2] + ml->origin[2]) * 1000.0f);
+
+    if (fix->status != MULTILAT_OK)
+    {
+        // A diverged or bad solve is no start point: the next one starts from the last good fix
+        return DWT_ERROR;
+    }
+    memcpy(ml->last, p, sizeof(p));
+    ml->has_last = 1;
+
+    return DWT_SUCCESS;
+}
+
+int multilat_solve_round(multilat_t *ml, const twr_sched_round_t *round, multilat_fix_t *fix)
+{
+    int32_t dist_mm[MULTILAT_MAX_ANCHORS];
+    uint32_t valid = 0;
+    uint8_t i, j;
+
+    for (i = 0; i < ml->count; i++)
+    {
+        dist_mm[i] = -1;
+        for (j = 0; j < round->count; j++)
+        {
+            const twr_result_t *r = &round->result[j];
+
+            if ((r->peer == ml->anchor[i].addr) && (r->status == TWR_OK) && r->has_tof)
+            {
+                // A slightly negative distance (antenna delay error at short range) is taken as 0
+                dist_mm[i] = (r->distance_mm > 0) ? r->distance_mm : 0;
+                valid |= 1UL << i;
+                break;
+            }
+        }
+    }
+
+    return multilat_solve(ml, dist_mm, valid, fix);
+}
+
+uint16_t multilat_fix_pack(const multilat_fix_t *fix, uint16_t tag, uint8_t *buf)
+{
+    int32_t v[3];
+    int i, k;
+
+    v[0] = fix->pos.x_mm;
+    v[1] = fix->pos.y_mm;
+    v[2] = fix->pos.z_mm;
+
+    buf[0] = (uint8_t)tag;
+    buf[1] = (uint8_t)(tag >> 8);
+    buf[2] = (uint8_t)fix->status;
+    buf[3] = fix->used;
+    for (k = 0; k < 3; k++)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            buf[4 + 4 * k + i] = (uint8_t)((uint32_t)v[k] >> (8 * i));
+        }
+    }
+    buf[16] = (uint8_t)fix->rms_mm;
+    buf[17] = (uint8_t)(fix->rms_mm >> 8);
+
+    return MULTILAT_RECORD_LEN;
+}
@@ -0,0 +1,161 @@
+/*! ----------------------------------------------------------------------------
+ * @file    multilat.h
+ * @brief   Position from the distances to N anchors (multilateration)
+ *
+ *          Solves the position of a tag from its distances to anchors at known
+ *          coordinates, e.g. the results of a twr_sched.h round, so a fix goes
+ *          up to the host instead of N distances:
+ *
+ *          multilat_solve()        distances in anchor order
+ *          multilat_solve_round()  the TWR_OK results of a scheduler round,
+ *                                  matched to the anchors by address
+ *
+ *          The solve is a Gauss-Newton least squares fit of the range
+ *          residuals (|p - anchor| - distance), in 2D (the tag height is
+ *          given: ground tags, anchors at any height) or 3D, in single
+ *          precision float around the anchor centroid. It starts from the
+ *          last good fix (or the centroid) and stops when the step falls
+ *          below tol_mm, usually after 2 to 5 iterations. A small diagonal
+ *          damping keeps the normal matrix invertible when the start point is
+ *          on the anchor plane.
+ *
+ *          The quality is the RMS of the residuals at the solution. With more
+ *          ranges than the minimum (3 in 2D, 4 in 3D), a fit worse than
+ *          max_rms_mm is solved again without each range in turn and the best
+ *          fit is kept, which removes one non line of sight (long) range. The
+ *          residuals do not show a bad geometry (e.g. anchors in line in 2D):
+ *          place the anchors around the area. No memory is allocated; a
+ *          multilat_t holds the anchors and the last fix of one tag.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MULTILAT_H_
+#define _MULTILAT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <twr_sched.h>
+
+#define MULTILAT_MAX_ANCHORS    TWR_SCHED_MAX_ANCHORS
+#define MULTILAT_RECORD_LEN     18      /* multilat_fix_pack() */
+
+typedef enum
+{
+    MULTILAT_OK = 0,
+    MULTILAT_FEW_RANGES,        /* fewer ranges than the minimum */
+    MULTILAT_SINGULAR,          /* normal matrix not invertible (no range in use gives a direction) */
+    MULTILAT_NO_CONVERGENCE,    /* still moving after max_iter iterations */
+    MULTILAT_BAD_FIT            /* residual RMS above max_rms_mm */
+} multilat_status_e;
+
+/* Coordinates, in mm */
+typedef struct
+{
+    int32_t     x_mm;
+    int32_t     y_mm;
+    int32_t     z_mm;
+} multilat_point_t;
+
+typedef struct
+{
+    uint16_t            addr;       /* for multilat_solve_round() */
+    multilat_point_t    pos;
+} multilat_anchor_t;
+
+typedef struct
+{
+    uint8_t     dims;               /* 2 (z fixed to z_mm) or 3 */
+    int32_t     z_mm;               /* 2D: tag height */
+    uint8_t     max_iter;           /* e.g. 10 */
+    uint16_t    tol_mm;             /* converged when the step is below, e.g. 5 */
+    uint16_t    max_rms_mm;         /* quality gate, e.g. 150 */
+} multilat_config_t;
+
+typedef struct
+{
+    multilat_status_e   status;
+    multilat_point_t    pos;        /* valid with MULTILAT_OK and MULTILAT_BAD_FIT */
+    uint16_t            rms_mm;     /* RMS of the range residuals at pos */
+    uint16_t            max_res_mm; /* largest residual (absolute) */
+    uint8_t             used;       /* ranges in the fit */
+    uint8_t             dropped;    /* anchor index of the range left out, 0xFF if none */
+    uint8_t             iterations;
+} multilat_fix_t;
+
+typedef struct
+{
+    multilat_config_t   cfg;
+    multilat_anchor_t   anchor[MULTILAT_MAX_ANCHORS];
+    uint8_t             count;
+    float               origin[3];  /* anchor centroid, m */
+    float               last[3];    /* last good fix, m from origin */
+    uint8_t             has_last;
+} multilat_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn multilat_init()
+ *
+ * @brief Set the configuration and the anchors, and forget the last fix.
+ *
+ * @param ml - solver
+ * @param cfg - configuration, copied
+ * @param anchors - anchors, copied
+ * @param count - number of anchors, up to MULTILAT_MAX_ANCHORS
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR for bad parameters
+ */
+int multilat_init(multilat_t *ml, const multilat_config_t *cfg, const multilat_anchor_t *anchors, uint8_t count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn multilat_solve()
+ *
+ * @brief Solve the position from distances in anchor order.
+ *
+ * @param ml - solver
+ * @param dist_mm - distance to each anchor
+ * @param valid - bit i set when dist_mm[i] is valid
+ * @param fix - result
+ *
+ * @return DWT_SUCCESS with a MULTILAT_OK fix, else DWT_ERROR (see fix->status)
+ */
+int multilat_solve(multilat_t *ml, const int32_t *dist_mm, uint32_t valid, multilat_fix_t *fix);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn multilat_solve_round()
+ *
+ * @brief Solve the position from the distances of a scheduler round (SS-TWR, the tag side has the distances).
+ *
+ * @param ml - solver
+ * @param round - round results
+ * @param fix - result
+ *
+ * @return DWT_SUCCESS with a MULTILAT_OK fix, else DWT_ERROR (see fix->status)
+ */
+int multilat_solve_round(multilat_t *ml, const twr_sched_round_t *round, multilat_fix_t *fix);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn multilat_fix_pack()
+ *
+ * @brief Pack a fix for the binary log or the uplink (DW_BINLOG_POSITION, DW_UPLINK_POSITION):
+ *        tag(2) status used x_mm(4) y_mm(4) z_mm(4) rms_mm(2), little endian.
+ *
+ * @param fix - fix
+ * @param tag - tag address
+ * @param buf - output buffer, MULTILAT_RECORD_LEN bytes
+ *
+ * @return MULTILAT_RECORD_LEN
+ */
+uint16_t multilat_fix_pack(const multilat_fix_t *fix, uint16_t tag, uint8_t *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MULTILAT_H_ */
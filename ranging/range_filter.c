@@ -0,0 +1,317 @@
+/*! ----------------------------------------------------------------------------
+ * @file    range_filter.c
+ * @brief   Per-peer range filtering with batched output
+ *
+ *          See range_filter.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <range_filter.h>
+
+typedef struct
+{
+    uint16_t    addr;
+    uint8_t     used;
+    uint8_t     count;                          /* median: window fill, Kalman: samples (saturated) */
+    uint8_t     head;                           /* median: next slot */
+    uint8_t     gate_rej;                       /* gate rejections in a row */
+    uint8_t     decim;                          /* accepted samples since the last queued result */
+    int32_t     win[RANGE_FILTER_WINDOW_MAX];   /* median: accepted samples */
+    int32_t     x_mm;                           /* estimate */
+    uint32_t    p_mm2;                          /* Kalman: estimate variance */
+} range_peer_t;
+
+static struct
+{
+    range_filter_config_t   cfg;
+    range_filter_batch_cb_t cb;
+    range_peer_t            peer[RANGE_FILTER_MAX_PEERS];
+    range_filter_out_t      out[RANGE_FILTER_BATCH_MAX];
+    uint8_t                 out_count;
+    range_filter_stats_t    stats;
+} rf;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_find()
+ *
+ * @brief Find the state of a peer, or allocate it.
+ *
+ * @param addr - peer address
+ *
+ * @return peer state, or NULL if the table is full
+ */
+static range_peer_t * range_filter_find(uint16_t addr)
+{
+    range_peer_t *free_peer = NULL;
+    int i;
+
+    for (i = 0; i < RANGE_FILTER_MAX_PEERS; i++)
+    {
+        if (rf.peer[i].used && (rf.peer[i].addr == addr))
+        {
+            return &rf.peer[i];
+        }
+        if (!rf.peer[i].used && (free_peer == NULL))
+        {
+            free_peer = &rf.peer[i];
+        }
+    }
+
+    if (free_peer != NULL)
+    {
+        memset(free_peer, 0, sizeof(*free_peer));
+        free_peer->used = 1;
+        free_peer->addr = addr;
+    }
+    return free_peer;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_median()
+ *
+ * @brief Return the median of the peer window (the lower one for an even count).
+ *
+ * @param p - peer state
+ *
+ * @return median, in mm
+ */
+static int32_t range_filter_median(const range_peer_t *p)
+{
+    int32_t v[RANGE_FILTER_WINDOW_MAX];
+    int i, j;
+
+    /* insertion sort, the window is small */
+    for (i = 0; i < p->count; i++)
+    {
+        int32_t x = p->win[i];
+
+        for (j = i; (j > 0) && (v[j - 1] > x); j--)
+        {
+            v[j] = v[j - 1];
+        }
+        v[j] = x;
+    }
+
+    return v[(p->count - 1) / 2];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_update()
+ *
+ * @brief Add an accepted sample to the peer estimate.
+ *
+ * @param p - peer state
+ * @param z_mm - sample
+ *
+ * @return none
+ */
+static void range_filter_update(range_peer_t *p, int32_t z_mm)
+{
+    if (rf.cfg.mode == RANGE_FILTER_MEDIAN)
+    {
+        p->win[p->head] = z_mm;
+        p->head = (p->head + 1) % rf.cfg.window;
+        if (p->count < rf.cfg.window)
+        {
+            p->count++;
+        }
+        p->x_mm = range_filter_median(p);
+        return;
+    }
+
+    if (p->count == 0)
+    {
+        p->x_mm = z_mm;
+        p->p_mm2 = rf.cfg.r_mm2;
+    }
+    else
+    {
+        /* random walk model: predict, then update with the Q16 gain p / (p + r) */
+        uint64_t pp = (uint64_t)p->p_mm2 + rf.cfg.q_mm2;
+        uint32_t k = (uint32_t)((pp << 16) / (pp + rf.cfg.r_mm2));
+        int64_t dx = ((int64_t)(z_mm - p->x_mm) * k) / 65536;
+
+        p->x_mm += (int32_t)dx;
+        p->p_mm2 = (uint32_t)((pp * (65536 - k)) >> 16);
+    }
+    if (p->count < 255)
+    {
+        p->count++;
+    }
+}
+
+/* API */
+
+void range_filter_default_config(range_filter_config_t *cfg)
+{
+    cfg->mode = RANGE_FILTER_MEDIAN;
+    cfg->window = 5;
+    cfg->q_mm2 = 100 * 100;         /* 10 cm per sample */
+    cfg->r_mm2 = 100 * 100;         /* 10 cm standard deviation */
+    cfg->min_sts_quality = 0;
+    cfg->min_fp_ratio_q8 = 64;
+    cfg->min_quality = 20;
+    cfg->prf = DWT_PRF_64M;
+    cfg->gate_mm = 500;
+    cfg->decimate = 1;
+    cfg->batch = 8;
+    cfg->read_sts = 0;
+}
+
+int range_filter_init(const range_filter_config_t *cfg, range_filter_batch_cb_t cb)
+{
+    if ((cfg == NULL) || (cfg->window == 0) || (cfg->window > RANGE_FILTER_WINDOW_MAX) ||
+        (cfg->batch == 0) || (cfg->batch > RANGE_FILTER_BATCH_MAX) || (cfg->decimate == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&rf, 0, sizeof(rf));
+    rf.cfg = *cfg;
+    rf.cb = cb;
+
+    return DWT_SUCCESS;
+}
+
+void range_filter_sample(const twr_result_t *result, range_sample_t *sample)
+{
+    dwt_rxdiag_t diag;
+    uint64_t fp, ch;
+
+    sample->peer = result->peer;
+    sample->seq = result->seq;
+    sample->distance_mm = result->distance_mm;
+    sample->sts_quality = RANGE_FILTER_STS_NONE;
+    sample->fp_ratio_q8 = RANGE_FILTER_FP_NONE;
+    sample->quality = RANGE_FILTER_QUALITY_NONE;
+
+    if (rf.cfg.read_sts)
+    {
+        dwt_readstsquality(&sample->sts_quality);
+    }
+
+    if ((rf.cfg.min_fp_ratio_q8 != 0) || (rf.cfg.min_quality != 0))
+    {
+        /* Only the 24 bytes of the diagnostics used by the quality estimate are read */
+        if (dwt_readdiagnostics_sel(&diag, RX_QUALITY_DIAG_FIELDS) != RX_QUALITY_DIAG_FIELDS)
+        {
+            return;
+        }
+
+        if (rf.cfg.min_quality != 0)
+        {
+            rx_quality_t q;
+
+            rx_quality_compute(&diag, rf.cfg.prf, &q);
+            sample->quality = q.score;
+        }
+    }
+
+    if (rf.cfg.min_fp_ratio_q8 != 0)
+    {
+        /* First path power (F1^2 + F2^2 + F3^2) / N^2 against the channel power C * 2^21 / N^2 (see the user
+         * manual), the F values have 2 fractional bits */
+        fp = (uint64_t)diag.ipatovF1 * diag.ipatovF1 + (uint64_t)diag.ipatovF2 * diag.ipatovF2 +
+             (uint64_t)diag.ipatovF3 * diag.ipatovF3;
+        ch = (uint64_t)diag.ipatovPower << 25;
+        if (ch != 0)
+        {
+            fp = (fp << 8) / ch;
+            sample->fp_ratio_q8 = (fp >= RANGE_FILTER_FP_NONE) ? (RANGE_FILTER_FP_NONE - 1) : (uint16_t)fp;
+        }
+    }
+}
+
+int range_filter_push(const range_sample_t *sample)
+{
+    range_peer_t *p;
+    range_filter_out_t *o;
+
+    if ((sample->sts_quality != RANGE_FILTER_STS_NONE) && (sample->sts_quality < rf.cfg.min_sts_quality))
+    {
+        rf.stats.rej_sts++;
+        return 0;
+    }
+    if ((sample->fp_ratio_q8 != RANGE_FILTER_FP_NONE) && (sample->fp_ratio_q8 < rf.cfg.min_fp_ratio_q8))
+    {
+        rf.stats.rej_fp++;
+        return 0;
+    }
+    if ((sample->quality != RANGE_FILTER_QUALITY_NONE) && (sample->quality < rf.cfg.min_quality))
+    {
+        rf.stats.rej_quality++;
+        return 0;
+    }
+
+    p = range_filter_find(sample->peer);
+    if (p == NULL)
+    {
+        rf.stats.dropped_peers++;
+        return 0;
+    }
+
+    if ((rf.cfg.gate_mm != 0) && (p->count != 0) &&
+        ((sample->distance_mm > p->x_mm + rf.cfg.gate_mm) || (sample->distance_mm < p->x_mm - rf.cfg.gate_mm)))
+    {
+        if (++p->gate_rej < RANGE_FILTER_RELOCK)
+        {
+            rf.stats.rej_gate++;
+            return 0;
+        }
+        /* consistently away from the estimate: start again from this sample */
+        rf.stats.relocks++;
+        p->count = 0;
+        p->head = 0;
+    }
+    p->gate_rej = 0;
+
+    range_filter_update(p, sample->distance_mm);
+    rf.stats.accepted++;
+
+    if (++p->decim < rf.cfg.decimate)
+    {
+        return 1;
+    }
+    p->decim = 0;
+
+    o = &rf.out[rf.out_count++];
+    o->peer = sample->peer;
+    o->seq = sample->seq;
+    o->samples = p->count;
+    o->distance_mm = p->x_mm;
+    o->raw_mm = sample->distance_mm;
+    o->quality = sample->quality;
+
+    if (rf.out_count >= rf.cfg.batch)
+    {
+        range_filter_flush();
+    }
+
+    return 1;
+}
+
+void range_filter_flush(void)
+{
+    if (rf.out_count == 0)
+    {
+        return;
+    }
+
+    rf.stats.batches++;
+    if (rf.cb != NULL)
+    {
+        rf.cb(rf.out, rf.out_count);
+    }
+    rf.out_count = 0;
+}
+
+const range_filter_stats_t * range_filter_get_stats(void)
+{
+    return &rf.stats;
+}
@@ -0,0 +1,183 @@
+/*! ----------------------------------------------------------------------------
+ * @file    range_filter.h
+ * @brief   Per-peer range filtering with batched output
+ *
+ *          Sits between the TWR engine (twr.h) and the application:
+ *
+ *          range_filter_sample()   in the TWR result callback, reads the
+ *                                  reception quality of the last frame
+ *          range_filter_push()     rejects the outliers, smooths the
+ *                                  distance of the peer (median or Kalman)
+ *                                  and queues the filtered result
+ *
+ *          The batch callback gets the queued results when the batch is full
+ *          (or on range_filter_flush()). With decimation, one result per peer
+ *          is queued every `decimate` accepted samples.
+ *
+ *          A sample is rejected when its STS quality is bad, when its first
+ *          path energy is too far below the channel energy (non line of sight
+ *          or late first path detection), when its reception quality score
+ *          (rx_quality.h) is too low, or when it is further than the gate
+ *          from the current estimate. After RANGE_FILTER_RELOCK gate
+ *          rejections in a row the peer estimate is restarted, so a real jump
+ *          (e.g. after a missed period) is followed.
+ *
+ *          All the arithmetic is integer, see ranging_math.h. The functions
+ *          are not reentrant: push and flush from one context.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RANGE_FILTER_H_
+#define _RANGE_FILTER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <twr.h>
+#include <rx_quality.h>
+
+#define RANGE_FILTER_MAX_PEERS      8
+#define RANGE_FILTER_WINDOW_MAX     7       /* median window */
+#define RANGE_FILTER_BATCH_MAX      16
+#define RANGE_FILTER_RELOCK         3       /* gate rejections in a row before the estimate restarts */
+
+#define RANGE_FILTER_STS_NONE       INT16_MIN   /* sts_quality: no STS in the frame */
+#define RANGE_FILTER_FP_NONE        0xFFFF      /* fp_ratio_q8: not read */
+#define RANGE_FILTER_QUALITY_NONE   0xFF        /* quality: not read */
+
+typedef enum
+{
+    RANGE_FILTER_MEDIAN = 0,
+    RANGE_FILTER_KALMAN
+} range_filter_mode_e;
+
+typedef struct
+{
+    range_filter_mode_e mode;
+    uint8_t     window;             /* median: number of samples (1 to RANGE_FILTER_WINDOW_MAX) */
+    uint32_t    q_mm2;              /* Kalman: process noise added per sample, mm^2 */
+    uint32_t    r_mm2;              /* Kalman: measurement noise, mm^2 */
+    int16_t     min_sts_quality;    /* reject below (dwt_readstsquality() index), when the frame has an STS */
+    uint16_t    min_fp_ratio_q8;    /* reject below: first path / channel energy, Q8 (64 = -6 dB), 0 disables */
+    uint8_t     min_quality;        /* reject below: rx_quality_t score (0 to 100), 0 disables */
+    uint8_t     prf;                /* PRF of the configuration, for the quality levels (DWT_PRF_64M) */
+    int32_t     gate_mm;            /* reject further than this from the estimate, 0 disables */
+    uint8_t     decimate;           /* queue one result every N accepted samples of a peer (1: all) */
+    uint8_t     batch;              /* results per batch (1 to RANGE_FILTER_BATCH_MAX) */
+    uint8_t     read_sts;           /* range_filter_sample() reads the STS quality */
+} range_filter_config_t;
+
+/* Raw range and reception quality */
+typedef struct
+{
+    uint16_t    peer;
+    uint8_t     seq;
+    int32_t     distance_mm;
+    int16_t     sts_quality;        /* or RANGE_FILTER_STS_NONE */
+    uint16_t    fp_ratio_q8;        /* first path / channel energy, Q8, or RANGE_FILTER_FP_NONE */
+    uint8_t     quality;            /* rx_quality_t score, or RANGE_FILTER_QUALITY_NONE */
+} range_sample_t;
+
+/* Filtered result */
+typedef struct
+{
+    uint16_t    peer;
+    uint8_t     seq;                /* sequence number of the last sample */
+    uint8_t     samples;            /* samples in the estimate (median window fill, Kalman: up to 255) */
+    int32_t     distance_mm;        /* filtered */
+    int32_t     raw_mm;             /* last accepted sample */
+    uint8_t     quality;            /* quality of the last accepted sample, or RANGE_FILTER_QUALITY_NONE */
+} range_filter_out_t;
+
+typedef struct
+{
+    uint32_t    accepted;
+    uint32_t    rej_sts;
+    uint32_t    rej_fp;
+    uint32_t    rej_quality;
+    uint32_t    rej_gate;
+    uint32_t    relocks;
+    uint32_t    dropped_peers;      /* samples from peers beyond RANGE_FILTER_MAX_PEERS */
+    uint32_t    batches;
+} range_filter_stats_t;
+
+typedef void (*range_filter_batch_cb_t)(const range_filter_out_t *out, uint8_t count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_default_config()
+ *
+ * @brief Default configuration: median of 5, STS quality >= 0, first path within 6 dB, quality score >= 20, 500 mm
+ *        gate, no decimation, batches of 8.
+ *
+ * @param cfg - configuration to fill
+ *
+ * @return none
+ */
+void range_filter_default_config(range_filter_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_init()
+ *
+ * @brief Set the configuration, clear the peers, the queue and the counters.
+ *
+ * @param cfg - configuration (copied)
+ * @param cb - batch callback, called from range_filter_push() or range_filter_flush()
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad configuration)
+ */
+int range_filter_init(const range_filter_config_t *cfg, range_filter_batch_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_sample()
+ *
+ * @brief Make a sample from a TWR result and the diagnostics of the frame just received (the final on a DS
+ *        responder, the response on an SS initiator). Call from the TWR result callback, before the receiver gets
+ *        another frame.
+ *
+ * @param result - TWR result, with has_tof set
+ * @param sample - sample to fill
+ *
+ * @return none
+ */
+void range_filter_sample(const twr_result_t *result, range_sample_t *sample);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_push()
+ *
+ * @brief Filter a sample and queue the result. Calls the batch callback when the batch is full.
+ *
+ * @param sample - sample
+ *
+ * @return 1 if the sample was accepted, 0 if rejected
+ */
+int range_filter_push(const range_sample_t *sample);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_flush()
+ *
+ * @brief Deliver the queued results, if any, to the batch callback.
+ *
+ * @return none
+ */
+void range_filter_flush(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn range_filter_get_stats()
+ *
+ * @brief Return the filter counters.
+ *
+ * @return counters
+ */
+const range_filter_stats_t * range_filter_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RANGE_FILTER_H_ */
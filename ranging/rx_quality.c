@@ -0,0 +1,157 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rx_quality.c
+ * @brief   First path and NLOS quality of a reception, in fixed point
+ *
+ *          See rx_quality.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <rx_quality.h>
+
+#define RX_QUALITY_A_PRF64_CDB      12170   /* A, 64 MHz PRF */
+#define RX_QUALITY_A_PRF16_CDB      11380   /* A, 16 MHz PRF */
+#define RX_QUALITY_F_FRAC_CDB       1204    /* 10 log10(16): F1..F3 have 2 fractional bits */
+#define RX_QUALITY_C_SCALE_CDB      6322    /* 10 log10(2^21) */
+
+#define RX_QUALITY_PEAK_AMP_MASK    0x1FFFFF    /* ipatovPeak [20:0] */
+#define RX_QUALITY_PEAK_IDX_SHIFT   21          /* ipatovPeak [30:21] */
+#define RX_QUALITY_PEAK_IDX_MASK    0x3FF
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_quality_log2_q16()
+ *
+ * @brief log2(x) in Q16: integer part from the MSB, fraction by repeated squaring of the mantissa.
+ *
+ * @param x - value, not 0
+ *
+ * @return log2(x), Q16
+ */
+static int32_t rx_quality_log2_q16(uint64_t x)
+{
+    uint64_t m;
+    int32_t r;
+    int msb = 63;
+    int i;
+
+    while (!(x & ((uint64_t)1 << msb)))
+    {
+        msb--;
+    }
+
+    /* mantissa in [1, 2), Q30 */
+    m = (msb >= 30) ? (x >> (msb - 30)) : (x << (30 - msb));
+    r = (int32_t)msb << 16;
+
+    for (i = 15; i >= 0; i--)
+    {
+        m = (m * m) >> 30;
+        if (m >= ((uint64_t)2 << 30))
+        {
+            m >>= 1;
+            r |= (int32_t)1 << i;
+        }
+    }
+    return r;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_quality_scale()
+ *
+ * @brief Map a value linearly from [good, bad] to [0, 100], clamped.
+ *
+ * @param v - value
+ * @param good - value giving 0
+ * @param bad - value giving 100 (may be below good)
+ *
+ * @return per cent
+ */
+static uint8_t rx_quality_scale(int32_t v, int32_t good, int32_t bad)
+{
+    int32_t p = (v - good) * 100 / (bad - good);
+
+    return (p <= 0) ? 0 : (p >= 100) ? 100 : (uint8_t)p;
+}
+
+int32_t rx_quality_cdb(uint64_t x)
+{
+    if (x == 0)
+    {
+        return 0;
+    }
+    /* 10 log10(x) = 10 log10(2) log2(x), in 0.01 dB */
+    return (int32_t)(((int64_t)rx_quality_log2_q16(x) * 30103 + 3276800) / 6553600);
+}
+
+int rx_quality_compute(const dwt_rxdiag_t *diag, uint8_t prf, rx_quality_t *q)
+{
+    uint64_t f2sum;
+    uint32_t f_max, peak_amp;
+    int32_t a, n2, f_cdb, c_cdb;
+    uint8_t nlos_diff, nlos_peak;
+
+    memset(q, 0, sizeof(*q));
+
+    f2sum = (uint64_t)diag->ipatovF1 * diag->ipatovF1 + (uint64_t)diag->ipatovF2 * diag->ipatovF2 +
+            (uint64_t)diag->ipatovF3 * diag->ipatovF3;
+    if ((f2sum == 0) || (diag->ipatovPower == 0) || (diag->ipatovAccumCount == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    a = (prf == DWT_PRF_16M) ? RX_QUALITY_A_PRF16_CDB : RX_QUALITY_A_PRF64_CDB;
+    n2 = 2 * rx_quality_cdb(diag->ipatovAccumCount);
+    f_cdb = rx_quality_cdb(f2sum) - RX_QUALITY_F_FRAC_CDB;
+    c_cdb = rx_quality_cdb(diag->ipatovPower) + RX_QUALITY_C_SCALE_CDB;
+
+    q->fp_cdbm = (int16_t)(f_cdb - n2 - a);
+    q->rx_cdbm = (int16_t)(c_cdb - n2 - a);
+    q->diff_cdb = (int16_t)(c_cdb - f_cdb);
+
+    /* strongest of the first path amplitudes against the peak, both without the fractional bits */
+    f_max = diag->ipatovF1;
+    if (diag->ipatovF2 > f_max)
+    {
+        f_max = diag->ipatovF2;
+    }
+    if (diag->ipatovF3 > f_max)
+    {
+        f_max = diag->ipatovF3;
+    }
+    peak_amp = diag->ipatovPeak & RX_QUALITY_PEAK_AMP_MASK;
+    if (peak_amp != 0)
+    {
+        uint32_t r = ((f_max >> 2) << 8) / peak_amp;
+        q->peak_q8 = (r > UINT16_MAX) ? UINT16_MAX : (uint16_t)r;
+    }
+    else
+    {
+        q->peak_q8 = 256;
+    }
+    q->delay = (int16_t)((((diag->ipatovPeak >> RX_QUALITY_PEAK_IDX_SHIFT) & RX_QUALITY_PEAK_IDX_MASK) << 6) -
+                         diag->ipatovFpIndex);
+
+    nlos_diff = rx_quality_scale(q->diff_cdb, RX_QUALITY_LOS_CDB, RX_QUALITY_NLOS_CDB);
+    nlos_peak = rx_quality_scale(q->peak_q8, RX_QUALITY_LOS_PEAK_Q8, RX_QUALITY_NLOS_PEAK_Q8);
+    q->nlos = (nlos_diff > nlos_peak) ? nlos_diff : nlos_peak;
+    q->score = 100 - q->nlos;
+
+    return DWT_SUCCESS;
+}
+
+int rx_quality_read(uint8_t prf, rx_quality_t *q)
+{
+    dwt_rxdiag_t diag;
+
+    if (dwt_readdiagnostics_sel(&diag, RX_QUALITY_DIAG_FIELDS) != RX_QUALITY_DIAG_FIELDS)
+    {
+        memset(q, 0, sizeof(*q));
+        return DWT_ERROR;
+    }
+    return rx_quality_compute(&diag, prf, q);
+}
@@ -0,0 +1,118 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rx_quality.h
+ * @brief   First path and NLOS quality of a reception, in fixed point
+ *
+ *          Turns the Ipatov diagnostics of the frame just received (first
+ *          path amplitudes F1..F3, channel power C, accumulated symbols N,
+ *          peak amplitude and index, first path index) into levels and a
+ *          line of sight indicator, from one selective diagnostics read of
+ *          24 bytes (dwt_readdiagnostics_sel(), RX_QUALITY_DIAG_FIELDS):
+ *
+ *          fp_cdbm     first path level  10 log10((F1^2 + F2^2 + F3^2) / N^2) - A
+ *          rx_cdbm     received level    10 log10(C * 2^21 / N^2) - A
+ *          diff_cdb    rx - fp: about 0 to 6 dB in line of sight, above 10 dB
+ *                      when the first path is blocked or reflected
+ *          peak_q8     first path amplitude / strongest path amplitude, 1.0
+ *                      when the first path is the strongest
+ *          delay       strongest path index - first path index, in samples (Q6)
+ *
+ *          (A is 121.7 dB at 64 MHz PRF, 113.8 dB at 16 MHz; levels are in
+ *          0.01 dB.) The levels do not include the DGC gain correction, which
+ *          cancels out in diff_cdb.
+ *
+ *          The NLOS estimate (per cent) is the larger of the level difference
+ *          between RX_QUALITY_LOS_CDB and RX_QUALITY_NLOS_CDB, and of the
+ *          peak ratio between RX_QUALITY_LOS_PEAK_Q8 and
+ *          RX_QUALITY_NLOS_PEAK_Q8, mapped linearly to 0..100. The score is
+ *          100 - NLOS, and 0 when the diagnostics were not logged: a range
+ *          measured on a frame with a score of 0 should not be trusted.
+ *
+ *          All the arithmetic is integer (log2 by repeated squaring). Enable
+ *          the diagnostics with dwt_configciadiag(DW_CIA_DIAG_LOG_MIN) or
+ *          above.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RX_QUALITY_H_
+#define _RX_QUALITY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+/* Thresholds of the NLOS estimate, override at build time */
+#ifndef RX_QUALITY_LOS_CDB
+#define RX_QUALITY_LOS_CDB          600     /* rx - fp below which the reception is line of sight */
+#endif
+#ifndef RX_QUALITY_NLOS_CDB
+#define RX_QUALITY_NLOS_CDB         1000    /* rx - fp above which it is not */
+#endif
+#ifndef RX_QUALITY_LOS_PEAK_Q8
+#define RX_QUALITY_LOS_PEAK_Q8      192     /* first path / peak above which the reception is line of sight */
+#endif
+#ifndef RX_QUALITY_NLOS_PEAK_Q8
+#define RX_QUALITY_NLOS_PEAK_Q8     64      /* first path / peak below which it is not */
+#endif
+
+#define RX_QUALITY_DIAG_FIELDS      (DWT_DIAG_IP_PEAK | DWT_DIAG_IP_POWER | DWT_DIAG_IP_F | DWT_DIAG_IP_FP | \
+                                     DWT_DIAG_IP_ACCUM)
+
+typedef struct
+{
+    int16_t     fp_cdbm;            /* first path level, 0.01 dBm */
+    int16_t     rx_cdbm;            /* received level, 0.01 dBm */
+    int16_t     diff_cdb;           /* rx - fp, 0.01 dB */
+    uint16_t    peak_q8;            /* first path / peak amplitude, Q8 */
+    int16_t     delay;              /* peak index - first path index, samples Q6 */
+    uint8_t     nlos;               /* NLOS estimate, per cent */
+    uint8_t     score;              /* 100 - nlos, 0 if the diagnostics were not available */
+} rx_quality_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_quality_cdb()
+ *
+ * @brief 10 log10(x) in 0.01 dB, in fixed point.
+ *
+ * @param x - value, 0 gives 0
+ *
+ * @return 1000 log10(x)
+ */
+int32_t rx_quality_cdb(uint64_t x);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_quality_compute()
+ *
+ * @brief Compute the quality from diagnostics already read (RX_QUALITY_DIAG_FIELDS, or the whole dwt_rxdiag_t).
+ *
+ * @param diag - diagnostics
+ * @param prf - DWT_PRF_16M or DWT_PRF_64M
+ * @param q - quality to fill
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the diagnostics are empty (q->score is 0)
+ */
+int rx_quality_compute(const dwt_rxdiag_t *diag, uint8_t prf, rx_quality_t *q);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_quality_read()
+ *
+ * @brief Read RX_QUALITY_DIAG_FIELDS of the frame just received and compute the quality.
+ *
+ * @param prf - DWT_PRF_16M or DWT_PRF_64M
+ * @param q - quality to fill
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the diagnostics could not be read (q->score is 0)
+ */
+int rx_quality_read(uint8_t prf, rx_quality_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RX_QUALITY_H_ */
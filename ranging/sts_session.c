@@ -0,0 +1,242 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sts_session.c
+ * @brief   STS session: host-side key/IV schedule for secure ranging
+ *
+ *          See sts_session.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <sts_session.h>
+
+#define STS_IV_WORDS        4
+
+static struct
+{
+    sts_session_config_t    cfg;
+    uint32_t                next;                   /* exchange the next sts_session_begin() starts */
+    uint32_t                primed;                 /* exchange whose IV is in the IV registers */
+    uint8_t                 primed_ok;              /* primed is valid */
+    uint32_t                dev_iv[STS_IV_WORDS];   /* IV registers contents */
+    sts_session_stats_t     stats;
+} sts;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_put32()
+ *
+ * @brief Store a 32-bit word little endian, as the registers take it.
+ *
+ * @param buf - destination
+ * @param val - word
+ *
+ * @return none
+ */
+static void sts_put32(uint8_t *buf, uint32_t val)
+{
+    buf[0] = (uint8_t)val;
+    buf[1] = (uint8_t)(val >> 8);
+    buf[2] = (uint8_t)(val >> 16);
+    buf[3] = (uint8_t)(val >> 24);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_iv_of()
+ *
+ * @brief Compute the IV of an exchange: IV of exchange 0 plus exchange * stride, over the 128 bits.
+ *
+ * @param exchange - exchange number
+ * @param iv - the 4 words of the IV, iv0 first
+ *
+ * @return none
+ */
+static void sts_iv_of(uint32_t exchange, uint32_t *iv)
+{
+    uint64_t add = (uint64_t)exchange * sts.cfg.stride;
+    uint64_t sum;
+    int i;
+
+    iv[0] = sts.cfg.iv.iv0;
+    iv[1] = sts.cfg.iv.iv1;
+    iv[2] = sts.cfg.iv.iv2;
+    iv[3] = sts.cfg.iv.iv3;
+
+    for (i = 0; (i < STS_IV_WORDS) && (add != 0); i++)
+    {
+        sum = (uint64_t)iv[i] + (uint32_t)add;
+        iv[i] = (uint32_t)sum;
+        add = (add >> 32) + (sum >> 32);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_init()
+ *
+ * @brief Program the STS key and the IV of exchange 0 and reset the exchange number.
+ *
+ * @param cfg - session configuration
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if cfg is NULL
+ */
+int sts_session_init(const sts_session_config_t *cfg)
+{
+    uint8_t buf[STS_KEY0_LEN * 4 + STS_IV0_LEN * STS_IV_WORDS];
+    int i;
+
+    if (cfg == NULL)
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&sts, 0, sizeof(sts));
+    sts.cfg = *cfg;
+    sts_iv_of(0, sts.dev_iv);
+
+    /* STS_KEY0..3 and STS_IV0..3 are contiguous, write them in one go */
+    sts_put32(&buf[0], cfg->key.key0);
+    sts_put32(&buf[4], cfg->key.key1);
+    sts_put32(&buf[8], cfg->key.key2);
+    sts_put32(&buf[12], cfg->key.key3);
+    for (i = 0; i < STS_IV_WORDS; i++)
+    {
+        sts_put32(&buf[16 + i * 4], sts.dev_iv[i]);
+    }
+    dwt_writetodevice(STS_KEY0_ID, 0, sizeof(buf), buf);
+
+    sts.primed = 0;
+    sts.primed_ok = 1;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_prime()
+ *
+ * @brief Write the words of the IV of the next exchange that differ from the IV registers contents.
+ *
+ * @return none
+ */
+void sts_session_prime(void)
+{
+    uint32_t iv[STS_IV_WORDS];
+    uint8_t buf[STS_IV0_LEN * STS_IV_WORDS];
+    int first, last, i;
+
+    if (sts.primed_ok && (sts.primed == sts.next))
+    {
+        return;
+    }
+
+    sts_iv_of(sts.next, iv);
+
+    for (first = 0; (first < STS_IV_WORDS) && (iv[first] == sts.dev_iv[first]); first++)
+        ;
+    for (last = STS_IV_WORDS - 1; (last >= first) && (iv[last] == sts.dev_iv[last]); last--)
+        ;
+
+    /* Mostly only the counter changes, a carry adds the words above it */
+    if (first <= last)
+    {
+        for (i = first; i <= last; i++)
+        {
+            sts_put32(&buf[(i - first) * 4], iv[i]);
+            sts.dev_iv[i] = iv[i];
+        }
+        dwt_writetodevice(STS_IV0_ID, (uint16_t)(first * 4), (uint16_t)((last - first + 1) * 4), buf);
+        sts.stats.iv_writes++;
+        sts.stats.iv_words += last - first + 1;
+    }
+
+    sts.primed = sts.next;
+    sts.primed_ok = 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_begin()
+ *
+ * @brief Load the IV of the next exchange into the STS generator.
+ *
+ * @return number of the exchange started
+ */
+uint32_t sts_session_begin(void)
+{
+    uint32_t exchange = sts.next;
+
+    if (!sts.primed_ok || (sts.primed != exchange))
+    {
+        sts.stats.late_primes++;
+        sts_session_prime();
+    }
+
+    dwt_configurestsloadiv();
+
+    sts.next = exchange + 1;
+    sts.stats.exchanges++;
+
+    return exchange;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_sync()
+ *
+ * @brief Set the number of the exchange the next sts_session_begin() starts.
+ *
+ * @param exchange - exchange number
+ *
+ * @return none
+ */
+void sts_session_sync(uint32_t exchange)
+{
+    if (exchange != sts.next)
+    {
+        sts.next = exchange;
+        sts.stats.syncs++;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_check()
+ *
+ * @brief Check the STS quality of the frame just received.
+ *
+ * @param quality - if not NULL, set to the STS quality index
+ *
+ * @return >= 0 for a good STS, < 0 for a bad one
+ */
+int sts_session_check(int16_t *quality)
+{
+    int16_t q;
+    int ret = dwt_readstsquality(&q);
+
+    if (ret >= 0)
+    {
+        sts.stats.sts_good++;
+    }
+    else
+    {
+        sts.stats.sts_bad++;
+    }
+    if (quality != NULL)
+    {
+        *quality = q;
+    }
+
+    return ret;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_get_stats()
+ *
+ * @brief Return the session counters.
+ *
+ * @return counters
+ */
+const sts_session_stats_t * sts_session_get_stats(void)
+{
+    return &sts.stats;
+}
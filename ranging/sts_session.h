@@ -0,0 +1,138 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sts_session.h
+ * @brief   STS session: host-side key/IV schedule for secure ranging
+ *
+ *          The STS key and IV are programmed once by sts_session_init(). The
+ *          IV of each exchange is then derived on the host, IV of exchange 0
+ *          plus the exchange number times the stride (a 128-bit add, the low
+ *          word being the counter), and kept in a shadow of the IV registers
+ *          so only the words that change are written.
+ *
+ *          The IV registers are only taken into the STS generator by the
+ *          LOAD_IV command, so the next IV can be written while the previous
+ *          frame is still in the air: sts_session_prime() after the last frame
+ *          of an exchange has been started (or when it is done), then
+ *          sts_session_begin() just before the first frame of the next one
+ *          costs a single short write. Within an exchange the device advances
+ *          the counter by itself (STS_SESSION_FRAME_STEP() per frame, 32 per
+ *          RX timeout), the stride must be larger than that to never reuse a
+ *          counter value.
+ *
+ *          A stride of 0 reloads the same IV for every exchange, as the STS
+ *          examples always did, and the two ends only have to agree on the
+ *          key and IV. Otherwise they must also agree on the exchange number,
+ *          sts_session_sync() puts a responder back in step (e.g. from the
+ *          sequence number of a poll received with a bad STS).
+ *
+ *          All functions can be called from the DW IC interrupt context.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _STS_SESSION_H_
+#define _STS_SESSION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+/* Counter advance of one frame with an STS of length sts_len (dwt_sts_lengths_e), see resync_sts() */
+#define STS_SESSION_FRAME_STEP(sts_len)     ((1UL << ((sts_len) + 2)) * 4)
+#define STS_SESSION_RXTO_STEP               32
+
+/* Stride for exchanges of up to 'frames' frames and 'timeouts' RX timeouts */
+#define STS_SESSION_STRIDE(sts_len, frames, timeouts) \
+    ((uint32_t)(frames) * STS_SESSION_FRAME_STEP(sts_len) + (uint32_t)(timeouts) * STS_SESSION_RXTO_STEP)
+
+typedef struct
+{
+    dwt_sts_cp_key_t    key;
+    dwt_sts_cp_iv_t     iv;         /* IV of exchange 0, iv0 is the counter */
+    uint32_t            stride;     /* IV step from one exchange to the next, 0: same IV for all exchanges */
+} sts_session_config_t;
+
+typedef struct
+{
+    uint32_t    exchanges;      /* sts_session_begin() calls */
+    uint32_t    iv_writes;      /* IV register writes (each of one or more contiguous words) */
+    uint32_t    iv_words;       /* IV words written */
+    uint32_t    late_primes;    /* exchanges begun without sts_session_prime() done for them */
+    uint32_t    sts_good;       /* sts_session_check() results */
+    uint32_t    sts_bad;
+    uint32_t    syncs;          /* sts_session_sync() calls that changed the exchange number */
+} sts_session_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_init()
+ *
+ * @brief Program the STS key and the IV of exchange 0 (one SPI write) and reset the exchange number. The next
+ *        sts_session_begin() starts exchange 0.
+ *
+ * @param cfg - session configuration, copied
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if cfg is NULL
+ */
+int sts_session_init(const sts_session_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_prime()
+ *
+ * @brief Write the IV of the next exchange to the IV registers, only the words that differ from the IV written last.
+ *        Nothing is loaded into the STS generator, so this can be done while a frame is in the air.
+ *
+ * @return none
+ */
+void sts_session_prime(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_begin()
+ *
+ * @brief Start the next exchange: load its IV into the STS generator (priming it first if sts_session_prime() has not
+ *        been called for it). Call this before the first frame of the exchange is sent or received.
+ *
+ * @return number of the exchange started
+ */
+uint32_t sts_session_begin(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_sync()
+ *
+ * @brief Set the number of the exchange the next sts_session_begin() starts.
+ *
+ * @param exchange - exchange number
+ *
+ * @return none
+ */
+void sts_session_sync(uint32_t exchange);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_check()
+ *
+ * @brief Check the STS quality of the frame just received (dwt_readstsquality()) and count the result.
+ *
+ * @param quality - if not NULL, set to the STS quality index
+ *
+ * @return >= 0 for a good STS, < 0 for a bad one (as dwt_readstsquality())
+ */
+int sts_session_check(int16_t *quality);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sts_session_get_stats()
+ *
+ * @brief Return the session counters.
+ *
+ * @return counters
+ */
+const sts_session_stats_t * sts_session_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STS_SESSION_H_ */
@@ -0,0 +1,162 @@
+/*! ----------------------------------------------------------------------------
+ * @file    tdma_sleep.c
+ * @brief   Timed-sleep scheduler for TDMA slots, on the DW3000 sleep counter
+ *
+ *          See tdma_sleep.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <tdma_sleep.h>
+
+/* Sleep counter unit from a calibration value in 1/256 crystal cycles per LP cycle:
+ * 4096 x 1e9 / (38.4e6 x 256) = 1250 / 3 ns */
+#define TDMA_SLEEP_CAL_Q8_TO_UNIT_NS(cal_q8)    ((uint32_t)(((uint64_t)(cal_q8) * 1250) / 3))
+
+static struct
+{
+    tdma_sleep_config_t cfg;
+    uint32_t            guard_uus;      /* guard time in use, widened after misses */
+    uint16_t            count;          /* sleep counter of the last wake-up */
+    uint16_t            since_cal;      /* wake-ups since the last calibration */
+    tdma_sleep_stats_t  stats;
+} sched;
+
+void tdma_sleep_default_config(tdma_sleep_config_t *cfg)
+{
+    cfg->superframe_uus = 1000000;
+    cfg->guard_uus = 200;
+    cfg->wake_uus = 2500;
+    cfg->recal_wakes = 16;
+    cfg->cal_samples = 4;
+    cfg->loop_shift = 2;
+}
+
+int tdma_sleep_calibrate(void)
+{
+    uint32_t sum = 0;
+    uint8_t i;
+
+    for (i = 0; i < sched.cfg.cal_samples; i++)
+    {
+        uint16_t cal = dwt_calibratesleepcnt();
+
+        if (cal == 0)
+        {
+            return DWT_ERROR;
+        }
+        sum += cal;
+    }
+
+    sched.stats.cal_unit_ns = TDMA_SLEEP_CAL_Q8_TO_UNIT_NS((sum << 8) / sched.cfg.cal_samples);
+    sched.stats.unit_ns = (uint32_t)((int32_t)sched.stats.cal_unit_ns + sched.stats.trim_ns);
+    sched.stats.cals++;
+    sched.since_cal = 0;
+
+    return DWT_SUCCESS;
+}
+
+int tdma_sleep_init(const tdma_sleep_config_t *cfg)
+{
+    if ((cfg == NULL) || (cfg->cal_samples == 0) || (cfg->superframe_uus <= cfg->wake_uus + cfg->guard_uus))
+    {
+        return DWT_ERROR;
+    }
+
+    sched.cfg = *cfg;
+    sched.guard_uus = cfg->guard_uus;
+    sched.count = 0;
+    memset(&sched.stats, 0, sizeof(sched.stats));
+
+    return tdma_sleep_calibrate();
+}
+
+int tdma_sleep_next(uint32_t since_ref_uus, tdma_sleep_wake_t *wake)
+{
+    uint32_t lead_uus = sched.cfg.wake_uus + sched.guard_uus;
+    uint64_t sleep_ns;
+    uint32_t count;
+
+    if ((wake == NULL) || (since_ref_uus >= sched.cfg.superframe_uus - lead_uus))
+    {
+        return DWT_ERROR;
+    }
+
+    if ((sched.cfg.recal_wakes != 0) && (++sched.since_cal >= sched.cfg.recal_wakes))
+    {
+        /* the last estimate is kept if the calibration fails */
+        (void)tdma_sleep_calibrate();
+    }
+
+    /* Wake up at the last unit boundary before the receiver has to be woken up, the host waits the rest */
+    sleep_ns = (uint64_t)(sched.cfg.superframe_uus - since_ref_uus - lead_uus) * 1000;
+    count = (uint32_t)(sleep_ns / sched.stats.unit_ns);
+    if (count > 0xFFFF)
+    {
+        count = 0xFFFF;
+    }
+
+    wake->count = (uint16_t)count;
+    wake->residual_uus = (uint32_t)((sleep_ns - (uint64_t)count * sched.stats.unit_ns) / 1000);
+    wake->guard_uus = sched.guard_uus;
+
+    if (count != 0)
+    {
+        dwt_configuresleepcnt((uint16_t)count);
+        sched.stats.wakes++;
+    }
+    sched.count = (uint16_t)count;
+
+    return DWT_SUCCESS;
+}
+
+int32_t tdma_sleep_ref(uint32_t rx_on_to_ref_uus)
+{
+    int32_t err = (int32_t)rx_on_to_ref_uus - (int32_t)sched.guard_uus;
+
+    sched.stats.last_err_uus = err;
+    sched.stats.refs++;
+
+    if (sched.count != 0)
+    {
+        /* Woken up early: the units were shorter than estimated */
+        int32_t step = (int32_t)(((int64_t)err * 1000 / sched.count) / (1 << sched.cfg.loop_shift));
+        int32_t trim = sched.stats.trim_ns - step;
+        int32_t lim = (int32_t)(sched.stats.cal_unit_ns / 16);
+
+        if (trim > lim)
+        {
+            trim = lim;
+        }
+        else if (trim < -lim)
+        {
+            trim = -lim;
+        }
+        sched.stats.trim_ns = trim;
+        sched.stats.unit_ns = (uint32_t)((int32_t)sched.stats.cal_unit_ns + trim);
+    }
+
+    sched.guard_uus = sched.cfg.guard_uus;
+
+    return err;
+}
+
+void tdma_sleep_missed(void)
+{
+    sched.stats.misses++;
+
+    if (sched.guard_uus < sched.cfg.guard_uus * TDMA_SLEEP_GUARD_MAX)
+    {
+        sched.guard_uus *= 2;
+    }
+}
+
+const tdma_sleep_stats_t * tdma_sleep_get_stats(void)
+{
+    return &sched.stats;
+}
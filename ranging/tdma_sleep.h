@@ -0,0 +1,169 @@
+/*! ----------------------------------------------------------------------------
+ * @file    tdma_sleep.h
+ * @brief   Timed-sleep scheduler for TDMA slots, on the DW3000 sleep counter
+ *
+ *          Puts the DW3000 to sleep after its slot and has it wake up on its
+ *          own low-power oscillator just before the next one, a guard time
+ *          ahead of the slot reference (e.g. the anchor frame opening the
+ *          slot).
+ *
+ *          The LP oscillator runs anywhere from 15 to 34 kHz and drifts with
+ *          temperature and voltage, so the scheduler keeps an estimate of the
+ *          sleep counter unit (4096 LP cycles, about 175 ms) in ns:
+ *           - open loop, from dwt_calibratesleepcnt() (LP cycles against the
+ *             38.4 MHz crystal), averaged over several samples and redone
+ *             every recal_wakes wake-ups,
+ *           - closed loop, from the error of each wake-up measured on the UWB
+ *             clock (tdma_sleep_ref()): the slot reference shows up later or
+ *             earlier in the receive window than the guard time. The error
+ *             trims the unit (the trim also absorbs a wrong wake_uus, and is
+ *             kept over the recalibrations).
+ *
+ *          The sleep counter only counts whole units, so the device wakes up
+ *          at the last unit boundary before the wake-up time and the rest (the
+ *          residual, below one unit) is waited by the host after the wake-up,
+ *          with the device in IDLE_RC (dwt_entersleep(DWT_DW_IDLE_RC), then
+ *          dwt_setdwstate(DWT_DW_IDLE) to lock the PLL). Only the guard time
+ *          is spent with the receiver on.
+ *
+ *          A missed slot reference (tdma_sleep_missed()) doubles the guard
+ *          time, up to TDMA_SLEEP_GUARD_MAX times the configured one; the
+ *          next reference brings it back.
+ *
+ *          Times in UWB microseconds (see UUS_TO_DWT_TIME).
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _TDMA_SLEEP_H_
+#define _TDMA_SLEEP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define TDMA_SLEEP_UNIT_LP_CYCLES   4096        /* sleep counter unit (dwt_configuresleepcnt() bits [27:12]) */
+#define TDMA_SLEEP_GUARD_MAX        8           /* guard time widening limit after missed references */
+
+/* Scheduler configuration */
+typedef struct
+{
+    uint32_t    superframe_uus;     /* slot period */
+    uint32_t    guard_uus;          /* the receiver opens this long before the expected slot reference */
+    uint32_t    wake_uus;           /* sleep counter expiry to receiver on: INIT_RC, IDLE_RC, restore, PLL lock */
+    uint16_t    recal_wakes;        /* LP oscillator calibration every recal_wakes wake-ups, 0 for init only */
+    uint8_t     cal_samples;        /* dwt_calibratesleepcnt() samples averaged per calibration */
+    uint8_t     loop_shift;         /* closed loop gain: 1 / 2^loop_shift of each error goes to the trim */
+} tdma_sleep_config_t;
+
+/* Next wake-up, from tdma_sleep_next() */
+typedef struct
+{
+    uint16_t    count;              /* sleep counter programmed, in units (0: too short to sleep) */
+    uint32_t    residual_uus;       /* host wait after the wake-up before opening the receiver */
+    uint32_t    guard_uus;          /* the slot reference is expected guard_uus after the receiver opens */
+} tdma_sleep_wake_t;
+
+/* Scheduler statistics */
+typedef struct
+{
+    uint32_t    unit_ns;            /* sleep counter unit in use: calibration plus trim */
+    uint32_t    cal_unit_ns;        /* last calibration */
+    int32_t     trim_ns;            /* closed loop trim */
+    int32_t     last_err_uus;       /* last wake-up error: > 0 woke up early */
+    uint32_t    wakes;
+    uint32_t    refs;               /* slot references received */
+    uint32_t    misses;             /* slot references missed */
+    uint32_t    cals;               /* LP oscillator calibrations */
+} tdma_sleep_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_sleep_default_config()
+ *
+ * @brief Fill a configuration: 1 s superframe, 200 uus guard time, 2500 uus wake-up, calibration every 16 wake-ups
+ *        over 4 samples, closed loop gain 1/4.
+ *
+ * @param cfg - configuration to fill
+ *
+ * @return none
+ */
+void tdma_sleep_default_config(tdma_sleep_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_sleep_init()
+ *
+ * @brief Set up the scheduler and calibrate the LP oscillator. The device must be awake; the sleep mode must include
+ *        the sleep counter wake-up (dwt_configuresleep() with DWT_SLEEP | DWT_SLP_EN).
+ *
+ * @param cfg - configuration (copied)
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters, or the calibration failed)
+ */
+int tdma_sleep_init(const tdma_sleep_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_sleep_next()
+ *
+ * @brief Plan the wake-up for the next slot and program the sleep counter (recalibrating the LP oscillator first when
+ *        due). Call right before dwt_entersleep(), device awake. With wake->count 0 the next slot is less than one
+ *        unit away: stay awake and wait wake->residual_uus instead of sleeping.
+ *
+ * @param since_ref_uus - time from the current slot reference to now (the sleep entry), on the UWB clock: e.g.
+ *                        dwt_readsystimestamphi32() minus the reference RX timestamp
+ * @param wake - returned wake-up plan
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the next slot is already too close (less than the wake-up and guard times)
+ */
+int tdma_sleep_next(uint32_t since_ref_uus, tdma_sleep_wake_t *wake);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_sleep_ref()
+ *
+ * @brief Report the slot reference received after a wake-up: its time after the receiver opened is the guard time
+ *        plus the wake-up error, which trims the sleep counter unit.
+ *
+ * @param rx_on_to_ref_uus - time from the receiver enable to the reference (its RX timestamp), on the UWB clock
+ *
+ * @return wake-up error, in UWB microseconds: > 0 woke up early, < 0 late
+ */
+int32_t tdma_sleep_ref(uint32_t rx_on_to_ref_uus);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_sleep_missed()
+ *
+ * @brief Report a slot without reference (receive timeout): the guard time is doubled for the next wake-up. The next
+ *        tdma_sleep_next() should then count from the expected reference, i.e. the receiver enable plus the guard.
+ *
+ * @return none
+ */
+void tdma_sleep_missed(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_sleep_calibrate()
+ *
+ * @brief Calibrate the LP oscillator now, e.g. after a temperature step (the closed loop trim is kept).
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the calibration failed
+ */
+int tdma_sleep_calibrate(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_sleep_get_stats()
+ *
+ * @brief Return the scheduler statistics.
+ *
+ * @return statistics
+ */
+const tdma_sleep_stats_t * tdma_sleep_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TDMA_SLEEP_H_ */
@@ -0,0 +1,548 @@
+/*! ----------------------------------------------------------------------------
+ * @file    tdoa.c
+ * @brief   TDoA anchor: blink reception and reference clock tracking
+ *
+ *          See tdoa.h.
+ *
+ *          Clock model: for a frame received at local time t, its time in the
+ *          reference anchor time base is
+ *
+ *              ref_tx + ref_tof + b0 + k * (t - local_rx)
+ *
+ *          where ref_tx/local_rx are the TX/RX timestamps of the last beacon,
+ *          and b0/k the least squares line through the (local_rx, ref_tx)
+ *          points of the window, taken relative to the last beacon so the
+ *          doubles keep sub-DTU resolution. k = 1 / (1 + drift). With a
+ *          single point, b0 = 0 and the drift is the carrier integrator one.
+ *          All time differences are taken modulo 2^40.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include <tdoa.h>
+
+#define TDOA_TIME_HALF      0x8000000000ULL
+
+/* Sleep() margin of tdoa_beacon_wait_ms() */
+#define TDOA_WAIT_MARGIN_MS 1
+
+static struct
+{
+    tdoa_config_t       cfg;
+    tdoa_record_cb_t    cb;
+    tdoa_sync_t         sync;
+    volatile uint8_t    active;
+    uint8_t             seq;            /* reference: next beacon sequence number */
+    uint8_t             tx_pending;     /* reference: beacon in flight */
+    uint8_t             grid;           /* reference: tx_time is on the beacon grid */
+    uint32_t            tx_time;        /* reference: last beacon delayed TX time (dwt_setdelayedtrxtime() units) */
+    uint32_t            period_hi;      /* reference: beacon grid period, same units */
+    uint64_t            tx_ts;          /* reference: predicted beacon TX timestamp */
+    uint64_t            holdover_dtu;
+    uint64_t            win_ref[TDOA_SYNC_WINDOW];      /* fit window, beacon TX timestamps */
+    uint64_t            win_local[TDOA_SYNC_WINDOW];    /* fit window, beacon RX timestamps */
+    uint8_t             win_head;       /* next window slot */
+    uint8_t             reject_run;     /* beacons dropped in a row */
+    double              fit_b0;         /* reference time of the last beacon minus its TX timestamp */
+    double              fit_k;          /* reference / local clock rate */
+    uint8_t             rx_buf[TDOA_SYNC_LEN];
+    uint8_t             tx_buf[TDOA_SYNC_LEN];
+} tdoa;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_ts_get()
+ *
+ * @brief Read a 40-bit little endian timestamp from a frame.
+ *
+ * @param buf - frame data
+ *
+ * @return timestamp
+ */
+static uint64_t tdoa_ts_get(const uint8_t *buf)
+{
+    uint64_t ts = 0;
+    int i;
+
+    for (i = 4; i >= 0; i--)
+    {
+        ts = (ts << 8) | buf[i];
+    }
+    return ts;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_rx_enable()
+ *
+ * @brief Enable the receiver, without timeout, for the next blink or beacon.
+ *
+ * @return none
+ */
+static void tdoa_rx_enable(void)
+{
+    if (tdoa.active)
+    {
+        dwt_setpreambledetecttimeout(0);
+        dwt_setrxtimeout(0);
+        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_offset_ppm()
+ *
+ * @brief Read the clock offset measurements of the last received frame.
+ *
+ * @return none
+ */
+static void tdoa_offset_ppm(void)
+{
+    float ci_mult = (tdoa.cfg.chan == 9) ? HERTZ_TO_PPM_MULTIPLIER_CHAN_9 : HERTZ_TO_PPM_MULTIPLIER_CHAN_5;
+
+    tdoa.sync.co_ppm = (float)(dwt_readclockoffset() * CLOCK_OFFSET_PPM_TO_RATIO * 1.0e6);
+    tdoa.sync.ci_ppm = (float)(dwt_readcarrierintegrator() * FREQ_OFFSET_MULTIPLIER * ci_mult);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_fit()
+ *
+ * @brief Fit the clock model line through the window points newer than the holdover.
+ *
+ * @param measured - carrier integrator drift, used with a single point
+ *
+ * @return none
+ */
+static void tdoa_fit(double measured)
+{
+    double x[TDOA_SYNC_WINDOW];
+    double y[TDOA_SYNC_WINDOW];
+    double mx = 0.0, my = 0.0, sxx = 0.0, sxy = 0.0, e2 = 0.0, e;
+    uint8_t idx = tdoa.win_head;
+    uint8_t n;
+
+    /* Points relative to the last beacon, newest first: x <= 0, y <= 0 */
+    for (n = 0; n < tdoa.sync.fit_count; n++)
+    {
+        idx = (idx == 0) ? (TDOA_SYNC_WINDOW - 1) : (idx - 1);
+        x[n] = -(double)((tdoa.sync.local_rx - tdoa.win_local[idx]) & TDOA_TIME_MASK);
+        y[n] = -(double)((tdoa.sync.ref_tx - tdoa.win_ref[idx]) & TDOA_TIME_MASK);
+        if (-x[n] > (double)tdoa.holdover_dtu)
+        {
+            break;
+        }
+        mx += x[n];
+        my += y[n];
+    }
+    tdoa.sync.fit_count = n;
+
+    if (n > 1)
+    {
+        mx /= n;
+        my /= n;
+        for (idx = 0; idx < n; idx++)
+        {
+            sxx += (x[idx] - mx) * (x[idx] - mx);
+            sxy += (x[idx] - mx) * (y[idx] - my);
+        }
+    }
+
+    if (sxx > 0.0)
+    {
+        tdoa.fit_k = sxy / sxx;
+        tdoa.fit_b0 = my - tdoa.fit_k * mx;
+        for (idx = 0; idx < n; idx++)
+        {
+            e = y[idx] - tdoa.fit_b0 - tdoa.fit_k * x[idx];
+            e2 += e * e;
+        }
+        tdoa.sync.drift = 1.0 / tdoa.fit_k - 1.0;
+        tdoa.sync.rms_dtu = (float)sqrt(e2 / n);
+    }
+    else
+    {
+        tdoa.fit_k = 1.0 / (1.0 + measured);
+        tdoa.fit_b0 = 0.0;
+        tdoa.sync.drift = measured;
+        tdoa.sync.rms_dtu = 0;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_beacon()
+ *
+ * @brief Check a beacon against the clock model, add it to the fit window and fit the model again.
+ *
+ * @param ref_tx - beacon TX timestamp (reference time)
+ * @param local_rx - beacon RX timestamp (local time)
+ * @param seq - beacon sequence number
+ *
+ * @return none
+ */
+static void tdoa_beacon(uint64_t ref_tx, uint64_t local_rx, uint8_t seq)
+{
+    /* a positive offset means the local clock is slower, so its intervals are shorter */
+    double measured = -tdoa.sync.ci_ppm * 1.0e-6;
+    double dl, dr, drift, err;
+
+    if (tdoa.sync.fit_count > 0)
+    {
+        dl = (double)((local_rx - tdoa.sync.local_rx) & TDOA_TIME_MASK);
+        dr = (double)((ref_tx - tdoa.sync.ref_tx) & TDOA_TIME_MASK);
+        drift = (dr > 0.0) ? (dl / dr - 1.0) : 1.0;
+
+        if (dl > (double)tdoa.holdover_dtu)
+        {
+            /* beyond the holdover: the fit drops the old points */
+        }
+        else if (fabs(drift - measured) * 1.0e6 > TDOA_DRIFT_MAX_PPM)
+        {
+            /* reference anchor reset, or time base jump: start again from this beacon */
+            tdoa.sync.fit_count = 0;
+            tdoa.sync.relocks++;
+        }
+        else if (tdoa.sync.fit_count > 1)
+        {
+            err = dr - (tdoa.fit_b0 + tdoa.fit_k * dl);
+            if (fabs(err) > TDOA_SYNC_GATE_DTU)
+            {
+                /* late first path on the beacon (multipath), or a wrong model after TDOA_SYNC_RELOCK of them */
+                tdoa.sync.rejected++;
+                if (++tdoa.reject_run < TDOA_SYNC_RELOCK)
+                {
+                    return;
+                }
+                tdoa.sync.fit_count = 0;
+                tdoa.sync.relocks++;
+            }
+        }
+    }
+
+    tdoa.win_ref[tdoa.win_head] = ref_tx;
+    tdoa.win_local[tdoa.win_head] = local_rx;
+    tdoa.win_head = (tdoa.win_head + 1) % TDOA_SYNC_WINDOW;
+    if (tdoa.sync.fit_count < TDOA_SYNC_WINDOW)
+    {
+        tdoa.sync.fit_count++;
+    }
+    tdoa.reject_run = 0;
+
+    tdoa.sync.ref_tx = ref_tx;
+    tdoa.sync.local_rx = local_rx;
+    tdoa.sync.seq = seq;
+    tdoa.sync.valid = 1;
+    tdoa.sync.beacons++;
+
+    tdoa_fit(measured);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_rx_beacon()
+ *
+ * @brief Check a received frame is a beacon of the reference anchor and update the clock model from it.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return none
+ */
+static void tdoa_rx_beacon(const dwt_cb_data_t *cb_data)
+{
+    uint16_t src;
+
+    if (cb_data->datalength != (TDOA_SYNC_LEN + FCS_LEN))
+    {
+        return;
+    }
+    dwt_readrxdata(tdoa.rx_buf, TDOA_SYNC_LEN, 0);
+
+    src = tdoa.rx_buf[TDOA_SYNC_SRC_IDX] | ((uint16_t)tdoa.rx_buf[TDOA_SYNC_SRC_IDX + 1] << 8);
+
+    if ((tdoa.rx_buf[1] != 0x88) || (tdoa.rx_buf[TDOA_SYNC_FUNC_IDX] != TDOA_FUNC_SYNC) ||
+        (tdoa.rx_buf[TDOA_SYNC_PAN_IDX] != (uint8_t)tdoa.cfg.pan_id) ||
+        (tdoa.rx_buf[TDOA_SYNC_PAN_IDX + 1] != (uint8_t)(tdoa.cfg.pan_id >> 8)) ||
+        (src != tdoa.cfg.ref_addr))
+    {
+        return;
+    }
+
+    tdoa_offset_ppm();
+    tdoa_beacon(tdoa_ts_get(&tdoa.rx_buf[TDOA_SYNC_TX_TS_IDX]), get_rx_timestamp_u64(),
+                tdoa.rx_buf[TDOA_SYNC_SN_IDX]);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_rx_blink()
+ *
+ * @brief Convert the RX timestamp of a blink to the reference time base and report it.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return none
+ */
+static void tdoa_rx_blink(const dwt_cb_data_t *cb_data)
+{
+    tdoa_record_t record;
+    int i;
+
+    if (cb_data->datalength != (TDOA_BLINK_LEN + FCS_LEN))
+    {
+        return;
+    }
+
+    if (tdoa_local_to_ref(get_rx_timestamp_u64(), &record.toa) != DWT_SUCCESS)
+    {
+        tdoa.sync.unsynced++;
+        return;
+    }
+
+    dwt_readrxdata(tdoa.rx_buf, TDOA_BLINK_LEN, 0);
+
+    record.anchor = tdoa.cfg.addr;
+    record.blink_seq = tdoa.rx_buf[TDOA_BLINK_SN_IDX];
+    record.sync_seq = tdoa.sync.seq;
+    record.tag_id = 0;
+    for (i = 7; i >= 0; i--)
+    {
+        record.tag_id = (record.tag_id << 8) | tdoa.rx_buf[TDOA_BLINK_ID_IDX + i];
+    }
+
+    tdoa.sync.blinks++;
+    if (tdoa.cb != NULL)
+    {
+        tdoa.cb(&record);
+    }
+}
+
+/* Driver callbacks */
+
+static void tdoa_tx_done_cb(const dwt_cb_data_t *cb_data)
+{
+    (void)cb_data;
+
+    if (tdoa.tx_pending)
+    {
+        /* reference anchor: its own beacon defines the time base */
+        tdoa.tx_pending = 0;
+        tdoa.sync.co_ppm = 0;
+        tdoa.sync.ci_ppm = 0;
+        tdoa_beacon(tdoa.tx_ts, tdoa.tx_ts, tdoa.tx_buf[TDOA_SYNC_SN_IDX]);
+    }
+    tdoa_rx_enable();
+}
+
+static void tdoa_rx_ok_cb(const dwt_cb_data_t *cb_data)
+{
+    uint8_t fc;
+
+    dwt_readrxdata(&fc, 1, 0);
+
+    if (fc == TDOA_BLINK_FC)
+    {
+        tdoa_rx_blink(cb_data);
+    }
+    else if ((fc == 0x41) && (tdoa.cfg.addr != tdoa.cfg.ref_addr))
+    {
+        tdoa_rx_beacon(cb_data);
+    }
+    tdoa_rx_enable();
+}
+
+static void tdoa_rx_err_cb(const dwt_cb_data_t *cb_data)
+{
+    (void)cb_data;
+
+    tdoa_rx_enable();
+}
+
+/* API */
+
+int tdoa_init(const tdoa_config_t *cfg, tdoa_record_cb_t cb)
+{
+    if ((cfg == NULL) || tdoa.active || (cfg->beacon_period_uus > TDOA_BEACON_PERIOD_MAX_UUS) ||
+        (cfg->holdover_uus > TDOA_HOLDOVER_MAX_UUS))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&tdoa, 0, sizeof(tdoa));
+    tdoa.cfg = *cfg;
+    tdoa.cb = cb;
+    if (tdoa.cfg.holdover_uus == 0)
+    {
+        tdoa.cfg.holdover_uus = TDOA_HOLDOVER_UUS;
+    }
+    tdoa.holdover_dtu = (uint64_t)tdoa.cfg.holdover_uus * UUS_TO_DWT_TIME;
+    tdoa.period_hi = (uint32_t)(((uint64_t)tdoa.cfg.beacon_period_uus * UUS_TO_DWT_TIME) >> 8) & 0xFFFFFFFEUL;
+
+    dwt_setcallbacks(&tdoa_tx_done_cb, &tdoa_rx_ok_cb, &tdoa_rx_err_cb, &tdoa_rx_err_cb, NULL, NULL);
+
+    dwt_setinterrupt(SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFTO_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXPTO_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXPHE_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFCE_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFSL_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXSTO_ENABLE_BIT_MASK,
+                     0,
+                     DWT_ENABLE_INT);
+
+    return DWT_SUCCESS;
+}
+
+void tdoa_start(void)
+{
+    tdoa.grid = 0;
+    tdoa.active = 1;
+    tdoa_rx_enable();
+}
+
+void tdoa_stop(void)
+{
+    tdoa.active = 0;
+    tdoa.tx_pending = 0;
+    dwt_forcetrxoff();
+}
+
+int tdoa_send_beacon(void)
+{
+    uint32_t lead = (TDOA_BEACON_LEAD_UUS * UUS_TO_DWT_TIME) >> 8;
+    uint32_t tx_time;
+    uint32_t late;
+    uint16_t dst = 0xFFFF;
+    int i;
+
+    if ((tdoa.cfg.addr != tdoa.cfg.ref_addr) || tdoa.tx_pending)
+    {
+        return DWT_ERROR;
+    }
+
+    dwt_forcetrxoff();
+
+    tx_time = dwt_readsystimestamphi32() + lead;
+    if ((tdoa.period_hi != 0) && tdoa.grid)
+    {
+        /* first grid slot at least the lead from now, the ones in between are skipped */
+        late = tx_time - tdoa.tx_time;
+        tdoa.sync.skipped += late / tdoa.period_hi;
+        tx_time = tdoa.tx_time + (late / tdoa.period_hi + 1) * tdoa.period_hi;
+    }
+    tx_time &= 0xFFFFFFFEUL;
+    tdoa.tx_time = tx_time;
+    tdoa.grid = 1;
+
+    dwt_setdelayedtrxtime(tx_time);
+    tdoa.tx_ts = ((((uint64_t)(tx_time & 0xFFFFFFFEUL)) << 8) + tdoa.cfg.tx_ant_dly) & TDOA_TIME_MASK;
+
+    tdoa.tx_buf[0] = 0x41;      /* data frame, PAN ID compression */
+    tdoa.tx_buf[1] = 0x88;      /* 16-bit addresses */
+    tdoa.tx_buf[TDOA_SYNC_SN_IDX] = tdoa.seq++;
+    tdoa.tx_buf[TDOA_SYNC_PAN_IDX] = (uint8_t)tdoa.cfg.pan_id;
+    tdoa.tx_buf[TDOA_SYNC_PAN_IDX + 1] = (uint8_t)(tdoa.cfg.pan_id >> 8);
+    tdoa.tx_buf[TDOA_SYNC_DST_IDX] = (uint8_t)dst;
+    tdoa.tx_buf[TDOA_SYNC_DST_IDX + 1] = (uint8_t)(dst >> 8);
+    tdoa.tx_buf[TDOA_SYNC_SRC_IDX] = (uint8_t)tdoa.cfg.addr;
+    tdoa.tx_buf[TDOA_SYNC_SRC_IDX + 1] = (uint8_t)(tdoa.cfg.addr >> 8);
+    tdoa.tx_buf[TDOA_SYNC_FUNC_IDX] = TDOA_FUNC_SYNC;
+    for (i = 0; i < 5; i++)
+    {
+        tdoa.tx_buf[TDOA_SYNC_TX_TS_IDX + i] = (uint8_t)(tdoa.tx_ts >> (8 * i));
+    }
+
+    dwt_writetxdata(TDOA_SYNC_LEN, tdoa.tx_buf, 0);     /* Zero offset in TX buffer. */
+    dwt_writetxfctrl(TDOA_SYNC_LEN + FCS_LEN, 0, 1);    /* Zero offset in TX buffer, ranging. */
+
+    tdoa.tx_pending = 1;
+    if (dwt_starttx(DWT_START_TX_DELAYED) != DWT_SUCCESS)
+    {
+        tdoa.tx_pending = 0;
+        tdoa_rx_enable();
+        return DWT_ERROR;
+    }
+
+    return DWT_SUCCESS;
+}
+
+uint32_t tdoa_beacon_wait_ms(void)
+{
+    uint32_t lead = (TDOA_BEACON_LEAD_UUS * UUS_TO_DWT_TIME) >> 8;
+    int32_t wait;
+    uint32_t ms;
+
+    if ((tdoa.period_hi == 0) || !tdoa.grid)
+    {
+        return 0;
+    }
+
+    wait = (int32_t)(tdoa.tx_time + tdoa.period_hi - lead - dwt_readsystimestamphi32());
+    if (wait <= 0)
+    {
+        return 0;
+    }
+
+    ms = (uint32_t)((((uint64_t)wait << 8) / UUS_TO_DWT_TIME) / 1000);
+    return (ms > TDOA_WAIT_MARGIN_MS) ? (ms - TDOA_WAIT_MARGIN_MS) : 0;
+}
+
+int tdoa_local_to_ref(uint64_t local_ts, uint64_t *ref_ts)
+{
+    uint64_t d = (local_ts - tdoa.sync.local_rx) & TDOA_TIME_MASK;
+    double dt;
+
+    if (!tdoa.sync.valid)
+    {
+        return DWT_ERROR;
+    }
+
+    if (d >= TDOA_TIME_HALF)
+    {
+        /* before the last beacon */
+        dt = -(double)((tdoa.sync.local_rx - local_ts) & TDOA_TIME_MASK);
+    }
+    else if (d > tdoa.holdover_dtu)
+    {
+        tdoa.sync.valid = 0;
+        return DWT_ERROR;
+    }
+    else
+    {
+        dt = (double)d;
+    }
+
+    dt = floor(tdoa.fit_b0 + tdoa.fit_k * dt + 0.5);
+    *ref_ts = (tdoa.sync.ref_tx + tdoa.cfg.ref_tof_dtu + (uint64_t)(int64_t)dt) & TDOA_TIME_MASK;
+
+    return DWT_SUCCESS;
+}
+
+const tdoa_sync_t * tdoa_get_sync(void)
+{
+    return &tdoa.sync;
+}
+
+uint16_t tdoa_record_pack(const tdoa_record_t *record, uint8_t *buf)
+{
+    int i;
+
+    buf[0] = (uint8_t)record->anchor;
+    buf[1] = (uint8_t)(record->anchor >> 8);
+    for (i = 0; i < 8; i++)
+    {
+        buf[2 + i] = (uint8_t)(record->tag_id >> (8 * i));
+    }
+    buf[10] = record->blink_seq;
+    buf[11] = record->sync_seq;
+    for (i = 0; i < 5; i++)
+    {
+        buf[12 + i] = (uint8_t)(record->toa >> (8 * i));
+    }
+
+    return TDOA_RECORD_LEN;
+}
@@ -0,0 +1,218 @@
+/*! ----------------------------------------------------------------------------
+ * @file    tdoa.h
+ * @brief   TDoA anchor: blink reception and reference clock tracking
+ *
+ *          Tags only transmit IEEE 802.15.4 blinks (as ex_01a_simple_tx). The
+ *          anchors timestamp them and report their time of arrival in the time
+ *          base of a reference anchor, so a location server can subtract the
+ *          arrival times of the same blink at several anchors.
+ *
+ *          The reference anchor sends sync beacons (tdoa_send_beacon()) that
+ *          carry their own TX timestamp, sent with dwt_setdelayedtrxtime().
+ *          With beacon_period_uus set, the beacons are on a fixed grid of the
+ *          reference clock: each one is sent exactly one period after the
+ *          previous one (a grid slot missed by the host is skipped), and
+ *          tdoa_beacon_wait_ms() tells the host when to program the next.
+ *
+ *          On each beacon an anchor updates its clock model against the
+ *          reference: a least squares line fit of the (local RX, reference
+ *          TX) timestamps of the last TDOA_SYNC_WINDOW beacons gives the
+ *          offset and the drift, the RMS residual of the fit its quality.
+ *          dwt_readcarrierintegrator() gives the drift until two beacons have
+ *          been received, and a beacon whose drift disagrees with it by more
+ *          than TDOA_DRIFT_MAX_PPM restarts the fit (reference reset). A
+ *          beacon further than TDOA_SYNC_GATE_DTU from the model prediction is
+ *          dropped (multipath on the beacon path), TDOA_SYNC_RELOCK in a row
+ *          restart the fit. tdoa_local_to_ref() converts any local timestamp
+ *          (e.g. of a blink) to the reference time base, until holdover_uus
+ *          after the last beacon.
+ *
+ *          The beacon period must be well under the 40-bit system time period
+ *          (17.2 s). A beacon loss longer than that period with no frame
+ *          received at all is not detected.
+ *
+ *          The record callback is called from the DW IC interrupt context. A
+ *          record packs into TDOA_RECORD_LEN bytes with tdoa_record_pack().
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _TDOA_H_
+#define _TDOA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+/* Blink: frame control, sequence number, 64-bit tag ID */
+#define TDOA_BLINK_FC               0xC5
+#define TDOA_BLINK_SN_IDX           1
+#define TDOA_BLINK_ID_IDX           2
+#define TDOA_BLINK_LEN              10
+
+/* Sync beacon: 802.15.4 data frame (as the TWR frames, see twr.h), function code and 40-bit TX timestamp */
+#define TDOA_FUNC_SYNC              0x30
+#define TDOA_SYNC_SN_IDX            2
+#define TDOA_SYNC_PAN_IDX           3
+#define TDOA_SYNC_DST_IDX           5
+#define TDOA_SYNC_SRC_IDX           7
+#define TDOA_SYNC_FUNC_IDX          9
+#define TDOA_SYNC_TX_TS_IDX         10
+#define TDOA_SYNC_LEN               15
+
+#define TDOA_TIME_MASK              0xFFFFFFFFFFULL     /* 40-bit system time */
+#define TDOA_BEACON_LEAD_UUS        1000                /* beacon sent at least that long after tdoa_send_beacon() */
+#define TDOA_BEACON_PERIOD_MAX_UUS  8000000             /* longest beacon grid period */
+#define TDOA_HOLDOVER_UUS           5000000             /* default holdover */
+#define TDOA_HOLDOVER_MAX_UUS       16000000            /* longest holdover, under the 40-bit time period */
+
+#define TDOA_SYNC_WINDOW            8                   /* beacons in the clock model fit */
+#define TDOA_SYNC_GATE_DTU          192                 /* beacon dropped further than this from the model (3 ns) */
+#define TDOA_SYNC_RELOCK            3                   /* beacons dropped in a row before the fit restarts */
+#define TDOA_DRIFT_MAX_PPM          100.0               /* drift disagreement with the carrier integrator restarting the fit */
+
+/* Packed record: anchor (2), tag ID (8), blink seq (1), sync seq (1), TOA (5), little endian */
+#define TDOA_RECORD_LEN             17
+
+typedef struct
+{
+    uint16_t    pan_id;
+    uint16_t    addr;           /* own short address */
+    uint16_t    ref_addr;       /* reference anchor address (== addr on the reference anchor) */
+    uint8_t     chan;           /* channel, to convert the carrier integrator to ppm */
+    uint16_t    tx_ant_dly;     /* TX antenna delay (reference anchor), added to the beacon TX timestamp */
+    uint64_t    ref_tof_dtu;    /* propagation time from the reference anchor, from the anchor survey */
+    uint32_t    beacon_period_uus;  /* reference: beacon grid period, up to TDOA_BEACON_PERIOD_MAX_UUS, 0 for none */
+    uint32_t    holdover_uus;   /* conversions refused this long after the last beacon, 0 for TDOA_HOLDOVER_UUS */
+} tdoa_config_t;
+
+/* Time difference record: blink time of arrival in the reference anchor time base */
+typedef struct
+{
+    uint16_t    anchor;         /* anchor that received the blink */
+    uint64_t    tag_id;
+    uint8_t     blink_seq;
+    uint8_t     sync_seq;       /* sequence number of the beacon the TOA is referred to */
+    uint64_t    toa;            /* 40-bit, device time units of the reference anchor */
+} tdoa_record_t;
+
+/* Clock model against the reference anchor */
+typedef struct
+{
+    uint8_t     valid;          /* a beacon has been received, within the holdover */
+    uint8_t     seq;            /* last beacon sequence number */
+    uint8_t     fit_count;      /* beacons in the fit */
+    uint64_t    ref_tx;         /* last beacon TX timestamp (reference time) */
+    uint64_t    local_rx;       /* last beacon RX timestamp (local time) */
+    double      drift;          /* local clock rate / reference clock rate - 1 */
+    float       rms_dtu;        /* RMS residual of the fit, device time units */
+    float       co_ppm;         /* last beacon clock offset (dwt_readclockoffset()), ppm, + when local is slower */
+    float       ci_ppm;         /* last beacon carrier integrator offset, ppm, + when local is slower */
+    uint32_t    beacons;        /* beacons received (reference: sent) */
+    uint32_t    rejected;       /* beacons dropped by the gate */
+    uint32_t    relocks;        /* fit restarts */
+    uint32_t    skipped;        /* reference: beacon grid slots missed */
+    uint32_t    blinks;         /* blinks reported */
+    uint32_t    unsynced;       /* blinks dropped, no beacon yet or beyond the holdover */
+} tdoa_sync_t;
+
+typedef void (*tdoa_record_cb_t)(const tdoa_record_t *record);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_init()
+ *
+ * @brief Set up the anchor: register the driver callbacks and enable the TX/RX interrupts. The device must already be
+ *        initialised and configured, with the antenna delays set, and dwt_isr() installed (port_set_dwic_isr()).
+ *
+ * @param cfg - anchor configuration (copied)
+ * @param cb - record callback
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters)
+ */
+int tdoa_init(const tdoa_config_t *cfg, tdoa_record_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_start()
+ *
+ * @brief Start receiving blinks and beacons (the receiver is re-enabled after each frame), until tdoa_stop().
+ *
+ * @return none
+ */
+void tdoa_start(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_stop()
+ *
+ * @brief Turn the receiver off.
+ *
+ * @return none
+ */
+void tdoa_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_send_beacon()
+ *
+ * @brief Reference anchor: send a sync beacon, then go back to reception. The beacon goes at the next slot of the
+ *        beacon grid at least TDOA_BEACON_LEAD_UUS from now (the receiver is off until then), or without grid
+ *        TDOA_BEACON_LEAD_UUS from now. The reference anchor clock model is set from its own beacon.
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (TX failed)
+ */
+int tdoa_send_beacon(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_beacon_wait_ms()
+ *
+ * @brief Reference anchor: time to wait before calling tdoa_send_beacon() for the next grid slot, so the receiver is
+ *        off for a short time only. E.g. loop on Sleep(tdoa_beacon_wait_ms()); tdoa_send_beacon();
+ *
+ * @return ms, 0 without grid or before the first beacon
+ */
+uint32_t tdoa_beacon_wait_ms(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_local_to_ref()
+ *
+ * @brief Convert a local timestamp (within 8 s of the last beacon, before or after) to the reference anchor time
+ *        base. The propagation time from the reference anchor (ref_tof_dtu) is included. Call from the DW IC
+ *        callbacks (interrupt context), where the model is updated.
+ *
+ * @param local_ts - local timestamp, 40-bit device time units
+ * @param ref_ts - reference time, 40-bit device time units
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR with no beacon or beyond the holdover
+ */
+int tdoa_local_to_ref(uint64_t local_ts, uint64_t *ref_ts);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_get_sync()
+ *
+ * @brief Return the clock model against the reference anchor and the counters.
+ *
+ * @return clock model
+ */
+const tdoa_sync_t * tdoa_get_sync(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_record_pack()
+ *
+ * @brief Pack a record for the uplink.
+ *
+ * @param record - record
+ * @param buf - output buffer, TDOA_RECORD_LEN bytes
+ *
+ * @return TDOA_RECORD_LEN
+ */
+uint16_t tdoa_record_pack(const tdoa_record_t *record, uint8_t *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TDOA_H_ */
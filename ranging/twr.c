@@ -0,0 +1,1794 @@
+/*! ----------------------------------------------------------------------------
+ * @file    twr.c
+ * @brief   Event driven two-way ranging (SS-TWR and DS-TWR) engine
+ *
+ *          See twr.h. The frames, timestamp handling and computations are the
+ *          ones of the ex_05a/ex_05b and ex_06a/ex_06b examples, see their
+ *          NOTES for the details.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include <ranging_math.h>
+#include <phy_timing.h>
+#include <twr.h>
+
+/* Multi-initiator responder: a DS exchange waiting for its final */
+typedef struct
+{
+    uint8_t         used;
+    uint8_t         mode;           /* twr_mode_e, TWR_MODE_DS or TWR_MODE_DS_BCAST */
+    uint8_t         poll_seq;
+    uint16_t        peer;
+    int16_t         clock_offset;   /* of the poll, then of the final */
+    uint64_t        poll_ts;        /* poll RX */
+    uint64_t        resp_ts;        /* predicted response TX */
+    uint32_t        final_open;     /* final window: receiver on for the final from final_open to final_close, */
+    uint32_t        final_close;    /* end of the final frame at the latest (high 32 bits of the device time) */
+} twr_session_t;
+
+/* Engine state, only changed by the API calls when idle and by the driver callbacks */
+static struct
+{
+    twr_config_t    cfg;
+    twr_result_cb_t cb;
+    volatile twr_state_e state;
+    twr_role_e      role;
+    twr_mode_e      mode;
+    uint16_t        peer;
+    uint8_t         seq;            /* next frame sequence number */
+    uint8_t         poll_seq;       /* sequence number of the poll of the exchange */
+    uint64_t        poll_ts;        /* initiator: poll TX, responder: poll RX */
+    uint64_t        resp_ts;        /* initiator: response RX, responder: predicted response TX */
+    uint32_t        phase_uus[TWR_PHASE_NUM];   /* initiator: phase durations of the exchange */
+    int16_t         clock_offset;   /* clock offset of the last frame from the peer */
+    uint8_t         rx_buf[TWR_FRAME_LEN_MAX];
+    uint8_t         tx_buf[TWR_FRAME_LEN_MAX];
+    /* broadcast DS-TWR */
+    uint8_t         bc_count;                           /* number of anchors */
+    uint8_t         bc_idx;                             /* anchor: own slot */
+    uint16_t        bc_slot_uus;                        /* response slot length */
+    uint16_t        bc_got;                             /* tag: anchors that answered, bit per slot */
+    uint16_t        bc_addr[TWR_BCAST_MAX_ANCHORS];     /* tag: anchor list */
+    uint64_t        bc_rx_ts[TWR_BCAST_MAX_ANCHORS];    /* tag: response RX timestamps */
+    uint32_t        bc_end;                             /* tag: end of the response window, in 256 dtu units */
+    /* reply delay tuning */
+    uint8_t         tune_on;
+    uint8_t         rx_open[TWR_TUNE_NUM];      /* next peer reply window opens right after the TX */
+    uint16_t        tune_margin_uus;
+    uint16_t        late_uus[TWR_TUNE_NUM];     /* margin added by the late TXs */
+    uint16_t        late_ok[TWR_TUNE_NUM];      /* replies since the last late TX or late_uus decay */
+    uint16_t        shr_uus;                    /* preamble, SFD and STS */
+    uint16_t        poll_tail_uus;              /* poll PHR and data */
+    uint16_t        resp_tail_uus;              /* DS response PHR and data */
+    twr_tune_t      tune;
+    /* multi-initiator responder */
+    uint8_t         multi;
+    uint16_t        ms_resp_uus[TWR_MODE_NUM];  /* response airtime */
+    uint16_t        ms_final_uus[TWR_MODE_NUM]; /* final airtime, longest broadcast final */
+    twr_session_t   sessions[TWR_SESSIONS];
+    twr_multi_t     ms;
+} twr;
+
+static void twr_tx_done_cb(const dwt_cb_data_t *cb_data);
+static void twr_rx_ok_cb(const dwt_cb_data_t *cb_data);
+static void twr_rx_to_cb(const dwt_cb_data_t *cb_data);
+static void twr_rx_err_cb(const dwt_cb_data_t *cb_data);
+static void twr_cca_fail_cb(const dwt_cb_data_t *cb_data);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_msg_init()
+ *
+ * @brief Write the common part of a frame (frame control, sequence number, PAN ID, addresses and function code).
+ *
+ * @param buf - frame buffer
+ * @param func - function code
+ * @param dst - destination address
+ *
+ * @return none
+ */
+static void twr_msg_init(uint8_t *buf, uint8_t func, uint16_t dst)
+{
+    buf[0] = 0x41;      /* data frame, PAN ID compression */
+    buf[1] = 0x88;      /* 16-bit addresses */
+    buf[TWR_MSG_SN_IDX] = twr.seq++;
+    buf[TWR_MSG_PAN_IDX] = (uint8_t)twr.cfg.pan_id;
+    buf[TWR_MSG_PAN_IDX + 1] = (uint8_t)(twr.cfg.pan_id >> 8);
+    buf[TWR_MSG_DST_IDX] = (uint8_t)dst;
+    buf[TWR_MSG_DST_IDX + 1] = (uint8_t)(dst >> 8);
+    buf[TWR_MSG_SRC_IDX] = (uint8_t)twr.cfg.addr;
+    buf[TWR_MSG_SRC_IDX + 1] = (uint8_t)(twr.cfg.addr >> 8);
+    buf[TWR_MSG_FUNC_IDX] = func;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_msg_read()
+ *
+ * @brief Read the received frame into rx_buf.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the frame is too long or too short to be a TWR frame (not read)
+ */
+static int twr_msg_read(const dwt_cb_data_t *cb_data)
+{
+    if ((cb_data->datalength > TWR_FRAME_LEN_MAX) || (cb_data->datalength < (TWR_MSG_COMMON_LEN + FCS_LEN)))
+    {
+        return DWT_ERROR;
+    }
+    dwt_readrxdata(twr.rx_buf, cb_data->datalength - FCS_LEN, 0);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_msg_match()
+ *
+ * @brief Check the frame in rx_buf (twr_msg_read()) is a TWR frame with the given function code, on our PAN,
+ *        addressed to this device (or broadcast).
+ *
+ * @param cb_data - RX callback data
+ * @param func - expected function code
+ * @param len - minimum frame length (without FCS)
+ *
+ * @return source address, or -1 if the frame is not the expected one
+ */
+static int32_t twr_msg_match(const dwt_cb_data_t *cb_data, uint8_t func, uint16_t len)
+{
+    uint16_t dst;
+
+    if (cb_data->datalength < (len + FCS_LEN))
+    {
+        return -1;
+    }
+
+    dst = twr.rx_buf[TWR_MSG_DST_IDX] | ((uint16_t)twr.rx_buf[TWR_MSG_DST_IDX + 1] << 8);
+
+    if ((twr.rx_buf[0] != 0x41) || (twr.rx_buf[1] != 0x88) ||
+        (twr.rx_buf[TWR_MSG_FUNC_IDX] != func) ||
+        (twr.rx_buf[TWR_MSG_PAN_IDX] != (uint8_t)twr.cfg.pan_id) ||
+        (twr.rx_buf[TWR_MSG_PAN_IDX + 1] != (uint8_t)(twr.cfg.pan_id >> 8)) ||
+        ((dst != twr.cfg.addr) && (dst != TWR_BROADCAST_ADDR)))
+    {
+        return -1;
+    }
+
+    return twr.rx_buf[TWR_MSG_SRC_IDX] | ((uint16_t)twr.rx_buf[TWR_MSG_SRC_IDX + 1] << 8);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_msg_check()
+ *
+ * @brief Read the received frame and check it is the expected one, see twr_msg_match().
+ *
+ * @param cb_data - RX callback data
+ * @param func - expected function code
+ * @param len - minimum frame length (without FCS)
+ *
+ * @return source address, or -1 if the frame is not the expected one
+ */
+static int32_t twr_msg_check(const dwt_cb_data_t *cb_data, uint8_t func, uint16_t len)
+{
+    if (twr_msg_read(cb_data) != DWT_SUCCESS)
+    {
+        return -1;
+    }
+
+    return twr_msg_match(cb_data, func, len);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_ts_u64()
+ *
+ * @brief Convert a 40-bit little-endian timestamp, as read from the device, to a 64-bit value.
+ *
+ * @param ts - 5-byte timestamp
+ *
+ * @return timestamp
+ */
+static uint64_t twr_ts_u64(const uint8_t *ts)
+{
+    uint64_t val = 0;
+    int8_t i;
+
+    for (i = 4; i >= 0; i--)
+    {
+        val = (val << 8) | ts[i];
+    }
+    return val;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_delayed_tx_ts()
+ *
+ * @brief Program the delayed TX time for a reply and return the TX timestamp it will have.
+ *
+ * @param rx_ts - RX timestamp the delay is counted from
+ * @param dly_uus - delay, in UWB microseconds
+ *
+ * @return predicted TX timestamp (programmed time plus TX antenna delay)
+ */
+static uint64_t twr_delayed_tx_ts(uint64_t rx_ts, uint32_t dly_uus)
+{
+    uint32_t tx_time = (uint32_t)((rx_ts + ((uint64_t)dly_uus * UUS_TO_DWT_TIME)) >> 8);
+
+    dwt_setdelayedtrxtime(tx_time);
+
+    return (((uint64_t)(tx_time & 0xFFFFFFFEUL)) << 8) + twr.cfg.tx_ant_dly;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_send()
+ *
+ * @brief Write the frame in tx_buf and start its transmission.
+ *
+ * @param len - frame length (without FCS)
+ * @param mode - dwt_starttx() mode
+ *
+ * @return dwt_starttx() result
+ */
+static int twr_send(uint16_t len, uint8_t mode)
+{
+    dwt_writetxdata(len, twr.tx_buf, 0);            /* Zero offset in TX buffer. */
+    dwt_writetxfctrl(len + FCS_LEN, 0, 1);          /* Zero offset in TX buffer, ranging. */
+
+    return dwt_starttx(mode);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_reply_dly()
+ *
+ * @brief Return the delay to use for a reply: the tuned one when the tuning is on, else the configured one.
+ *
+ * @param idx - reply
+ *
+ * @return delay, in UWB microseconds
+ */
+static uint32_t twr_reply_dly(twr_tune_e idx)
+{
+    if (twr.tune_on)
+    {
+        return twr.tune.reply_dly_uus[idx];
+    }
+    return (idx == TWR_TUNE_RESP) ? twr.cfg.poll_rx_to_resp_tx_dly_uus : twr.cfg.resp_rx_to_final_tx_dly_uus;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_reply()
+ *
+ * @brief Send a delayed reply (as twr_send()) and, when the tuning is on, measure the host turnaround from the frame
+ *        it replies to and update the reply delay.
+ *
+ *        The turnaround is measured after dwt_starttx() returns, so it includes the SPI transfers of the TX set-up.
+ *        The delay is the peak turnaround plus the SHR, as the delayed TX time is the RMARKER (end of the SFD) and the
+ *        transmission starts earlier, plus the margin.
+ *
+ * @param len - frame length (without FCS)
+ * @param mode - dwt_starttx() mode
+ * @param rx_ts - RX timestamp of the frame replied to
+ * @param idx - reply
+ *
+ * @return dwt_starttx() result
+ */
+static int twr_reply(uint16_t len, uint8_t mode, uint64_t rx_ts, twr_tune_e idx)
+{
+    int ret = twr_send(len, mode);
+    uint32_t lat, dly, max;
+
+    if (!twr.tune_on)
+    {
+        return ret;
+    }
+
+    /* 256 dtu units: 32-bit subtraction gives the right answer if the clock has wrapped */
+    lat = (uint32_t)(((uint64_t)(dwt_readsystimestamphi32() - (uint32_t)(rx_ts >> 8)) << 8) / UUS_TO_DWT_TIME);
+    if (lat > 0xFFFF)
+    {
+        lat = 0xFFFF;
+    }
+
+    twr.tune.replies[idx]++;
+    if (lat > twr.tune.latency_max_uus[idx])
+    {
+        twr.tune.latency_max_uus[idx] = (uint16_t)lat;
+    }
+    if (lat >= twr.tune.latency_uus[idx])
+    {
+        twr.tune.latency_uus[idx] = (uint16_t)lat;
+    }
+    else
+    {
+        twr.tune.latency_uus[idx] -= (uint16_t)((twr.tune.latency_uus[idx] - lat) >> 4);
+    }
+
+    if (ret != DWT_SUCCESS)
+    {
+        twr.tune.late_tx[idx]++;
+        if (twr.late_uus[idx] < (0xFFFF - TWR_TUNE_LATE_STEP_UUS))
+        {
+            twr.late_uus[idx] += TWR_TUNE_LATE_STEP_UUS;
+        }
+        twr.late_ok[idx] = 0;
+    }
+    else if ((twr.late_uus[idx] != 0) && (++twr.late_ok[idx] >= 64))
+    {
+        twr.late_uus[idx] /= 2;
+        twr.late_ok[idx] = 0;
+    }
+
+    /* The configured delay stays the upper bound */
+    dly = twr.tune.latency_uus[idx] + twr.shr_uus + twr.tune_margin_uus + twr.late_uus[idx];
+    max = (idx == TWR_TUNE_RESP) ? twr.cfg.poll_rx_to_resp_tx_dly_uus : twr.cfg.resp_rx_to_final_tx_dly_uus;
+    twr.tune.reply_dly_uus[idx] = (uint16_t)((dly < max) ? dly : max);
+
+    return ret;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_rx_window()
+ *
+ * @brief Set the receiver window for a peer reply, after the TX. With the tuning on, the window starts at the learnt
+ *        delay (or right after the TX after a miss) and still ends where the configured one ends.
+ *
+ * @param idx - peer reply
+ * @param dly_uus - configured RX enable delay, from the end of the TX frame
+ * @param timeout_uus - configured RX timeout
+ *
+ * @return none
+ */
+static void twr_rx_window(twr_tune_e idx, uint32_t dly_uus, uint32_t timeout_uus)
+{
+    uint16_t pre_timeout = twr.cfg.pre_timeout;
+
+    if (twr.tune_on)
+    {
+        uint32_t rx_dly = twr.rx_open[idx] ? 0 : twr.tune.rx_dly_uus[idx];
+
+        if (rx_dly > dly_uus)
+        {
+            rx_dly = dly_uus;
+        }
+
+        if (timeout_uus != 0)
+        {
+            timeout_uus += dly_uus - rx_dly;
+        }
+        if (twr.rx_open[idx])
+        {
+            pre_timeout = 0;
+        }
+        dly_uus = rx_dly;
+    }
+
+    dwt_setrxaftertxdelay(dly_uus);
+    dwt_setrxtimeout(timeout_uus);
+    dwt_setpreambledetecttimeout(pre_timeout);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_rx_learn()
+ *
+ * @brief Learn the RX enable delay for a peer reply from the RMARKER interval of the last exchange.
+ *
+ * @param idx - peer reply
+ * @param tx_ts - TX timestamp of the frame it replied to
+ * @param rx_ts - RX timestamp of the reply
+ * @param tx_tail_uus - PHR and data duration of the TX frame (the RX enable delay starts at its end)
+ *
+ * @return none
+ */
+static void twr_rx_learn(twr_tune_e idx, uint64_t tx_ts, uint64_t rx_ts, uint16_t tx_tail_uus)
+{
+    int32_t dly;
+
+    if (!twr.tune_on)
+    {
+        return;
+    }
+
+    dly = (int32_t)(((rx_ts - tx_ts) & 0xFFFFFFFFFFULL) / UUS_TO_DWT_TIME) - tx_tail_uus - twr.shr_uus -
+          TWR_TUNE_RX_GUARD_UUS;
+    twr.tune.rx_dly_uus[idx] = (dly < 0) ? 0 : (dly > 0xFFFF) ? 0xFFFF : (uint16_t)dly;
+    twr.rx_open[idx] = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_rx_listen()
+ *
+ * @brief Responder: enable the receiver, without timeout, for the next poll.
+ *
+ * @return none
+ */
+static void twr_rx_listen(void)
+{
+    twr.state = TWR_STATE_LISTEN;
+
+    dwt_setpreambledetecttimeout(0);
+    dwt_setrxtimeout(0);
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_done()
+ *
+ * @brief End the exchange: report the result, then go back to idle (initiator) or listening (responder).
+ *
+ * @param status - exchange status
+ * @param has_tof - tof_dtu is valid
+ * @param tof - time of flight, in 1/16 device time units (see ranging_math.h)
+ *
+ * @return none
+ */
+static void twr_done(twr_status_e status, uint8_t has_tof, int32_t tof)
+{
+    twr_result_t result;
+
+    result.status = status;
+    result.role = twr.role;
+    result.mode = twr.mode;
+    result.peer = twr.peer;
+    result.seq = twr.poll_seq;
+    result.has_tof = has_tof;
+    result.tof = tof;
+    result.distance_mm = has_tof ? ranging_tof_to_mm(tof) : 0;
+    result.clock_offset = twr.clock_offset;
+
+    if (twr.role == TWR_ROLE_RESPONDER)
+    {
+        memset(result.phase_uus, 0, sizeof(result.phase_uus));
+        twr_rx_listen();
+    }
+    else
+    {
+        memcpy(result.phase_uus, twr.phase_uus, sizeof(result.phase_uus));
+        twr.state = TWR_STATE_IDLE;
+    }
+
+    if (twr.cb != NULL)
+    {
+        twr.cb(&result);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_bcast_done()
+ *
+ * @brief Broadcast initiator: end the exchange and report one result per anchor.
+ *
+ * @param status - exchange status for the anchors that answered (the others get TWR_ERR_TIMEOUT)
+ *
+ * @return none
+ */
+static void twr_bcast_done(twr_status_e status)
+{
+    twr_result_t result;
+    uint8_t i;
+
+    twr.state = TWR_STATE_IDLE;
+
+    memset(&result, 0, sizeof(result));
+    result.role = TWR_ROLE_INITIATOR;
+    result.mode = TWR_MODE_DS_BCAST;
+    result.seq = twr.poll_seq;
+
+    for (i = 0; (i < twr.bc_count) && (twr.cb != NULL); i++)
+    {
+        result.peer = twr.bc_addr[i];
+        result.status = (twr.bc_got & (1U << i)) ? status : TWR_ERR_TIMEOUT;
+        twr.cb(&result);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_bcast_final()
+ *
+ * @brief Broadcast initiator: response window over, send the final with the timestamps of all the responses.
+ *
+ * @return none
+ */
+static void twr_bcast_final(void)
+{
+    uint64_t final_tx_ts;
+    uint16_t len = TWR_BC_FINAL_ENTRY_IDX;
+    uint8_t i, n = 0;
+
+    if (twr.bc_got == 0)
+    {
+        twr_bcast_done(TWR_ERR_TIMEOUT);
+        return;
+    }
+
+    final_tx_ts = twr_delayed_tx_ts(twr.poll_ts, twr.cfg.poll_rx_to_resp_tx_dly_uus +
+                                    (uint32_t)(twr.bc_count - 1) * twr.bc_slot_uus +
+                                    twr.cfg.resp_rx_to_final_tx_dly_uus);
+
+    twr_msg_init(twr.tx_buf, TWR_FUNC_BC_FINAL, TWR_BROADCAST_ADDR);
+    final_msg_set_ts(&twr.tx_buf[TWR_BC_FINAL_POLL_TX_TS_IDX], twr.poll_ts);
+    final_msg_set_ts(&twr.tx_buf[TWR_BC_FINAL_FINAL_TX_TS_IDX], final_tx_ts);
+    for (i = 0; i < twr.bc_count; i++)
+    {
+        if (twr.bc_got & (1U << i))
+        {
+            twr.tx_buf[len] = (uint8_t)twr.bc_addr[i];
+            twr.tx_buf[len + 1] = (uint8_t)(twr.bc_addr[i] >> 8);
+            final_msg_set_ts(&twr.tx_buf[len + 2], twr.bc_rx_ts[i]);
+            len += TWR_BC_FINAL_ENTRY_LEN;
+            n++;
+        }
+    }
+    twr.tx_buf[TWR_BC_FINAL_COUNT_IDX] = n;
+
+    twr.state = TWR_STATE_WAIT_FINAL_TX;
+    if (twr_send(len, DWT_START_TX_DELAYED) != DWT_SUCCESS)
+    {
+        twr_bcast_done(TWR_ERR_LATE_TX);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_bcast_rx_next()
+ *
+ * @brief Broadcast initiator: re-enable the receiver until the end of the response window, or send the final.
+ *
+ * @return none
+ */
+static void twr_bcast_rx_next(void)
+{
+    int32_t left = (int32_t)(twr.bc_end - dwt_readsystimestamphi32());  /* 256 dtu units */
+    uint32_t left_uus;
+
+    if (left > 0)
+    {
+        left_uus = (uint32_t)(((uint64_t)left << 8) / UUS_TO_DWT_TIME);
+        if (left_uus > (TWR_BCAST_GUARD_UUS / 2))
+        {
+            dwt_setrxtimeout(left_uus);
+            if (dwt_rxenable(DWT_START_RX_IMMEDIATE) == DWT_SUCCESS)
+            {
+                return;
+            }
+        }
+    }
+
+    twr_bcast_final();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_bcast_event()
+ *
+ * @brief Broadcast initiator: RX event in the response window; record the RX timestamp of a response from an anchor
+ *        of the list, then wait for the next one.
+ *
+ * @param cb_data - RX callback data, or NULL for a timeout/error
+ *
+ * @return none
+ */
+static void twr_bcast_event(const dwt_cb_data_t *cb_data)
+{
+    int32_t src = (cb_data != NULL) ? twr_msg_check(cb_data, TWR_FUNC_BC_RESP, TWR_MSG_COMMON_LEN) : -1;
+    uint16_t all = (uint16_t)((1U << twr.bc_count) - 1);
+    uint8_t i;
+
+    for (i = 0; (src >= 0) && (i < twr.bc_count); i++)
+    {
+        if (twr.bc_addr[i] == src)
+        {
+            twr.bc_rx_ts[i] = get_rx_timestamp_u64();
+            twr.bc_got |= 1U << i;
+            break;
+        }
+    }
+
+    if (twr.bc_got == all)
+    {
+        twr_bcast_final();
+    }
+    else
+    {
+        twr_bcast_rx_next();
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_bcast_find_slot()
+ *
+ * @brief Broadcast responder: find this device in the anchor list of a broadcast poll (in rx_buf).
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return 1 if found (bc_idx, bc_count and bc_slot_uus set), 0 otherwise
+ */
+static int twr_bcast_find_slot(const dwt_cb_data_t *cb_data)
+{
+    uint16_t idx;
+    uint8_t i;
+
+    twr.bc_count = twr.rx_buf[TWR_BC_POLL_COUNT_IDX];
+    twr.bc_slot_uus = twr.rx_buf[TWR_BC_POLL_SLOT_IDX] | ((uint16_t)twr.rx_buf[TWR_BC_POLL_SLOT_IDX + 1] << 8);
+
+    for (i = 0; (i < twr.bc_count) && (i < TWR_BCAST_MAX_ANCHORS); i++)
+    {
+        idx = TWR_BC_POLL_ADDR_IDX + 2 * i;
+        if ((idx + 2 + FCS_LEN) > cb_data->datalength)
+        {
+            break;
+        }
+        if ((twr.rx_buf[idx] | ((uint16_t)twr.rx_buf[idx + 1] << 8)) == twr.cfg.addr)
+        {
+            twr.bc_idx = i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_initiator_rx()
+ *
+ * @brief Initiator: response received. SS: compute the time of flight. DS: schedule the final.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return none
+ */
+static void twr_initiator_rx(const dwt_cb_data_t *cb_data)
+{
+    dwt_rxinfo_t info;
+    int32_t src = twr_msg_check(cb_data, (twr.mode == TWR_MODE_SS) ? TWR_FUNC_SS_RESP : TWR_FUNC_DS_RESP,
+                                (twr.mode == TWR_MODE_SS) ? (TWR_SS_RESP_RESP_TX_TS_IDX + RESP_MSG_TS_LEN) : TWR_MSG_COMMON_LEN);
+
+    if (src != twr.peer)
+    {
+        twr_done(TWR_ERR_FRAME, 0, 0);
+        return;
+    }
+
+    /* Timestamps (and the clock offset for SS) in as few SPI reads as possible, the final is due soon */
+    dwt_readrxinfo(&info, (twr.mode == TWR_MODE_SS) ? DWT_RXINFO_CIA : 0);
+    twr.poll_ts = twr_ts_u64(info.txStamp);
+    twr.resp_ts = twr_ts_u64(info.rxStamp);
+    twr_rx_learn(TWR_TUNE_RESP, twr.poll_ts, twr.resp_ts, twr.poll_tail_uus);
+    twr.phase_uus[TWR_PHASE_RESP] = ((uint32_t)twr.resp_ts - (uint32_t)twr.poll_ts) / UUS_TO_DWT_TIME;
+
+    if (twr.mode == TWR_MODE_SS)
+    {
+        uint32_t poll_rx_ts, resp_tx_ts;
+        int32_t rtd_init, rtd_resp;
+        int32_t clockOffsetRatio;
+
+        /* Clock offset ratio from the CIA clock offset estimate (CIA_DIAG_0, as dwt_readclockoffset()), see ex_06a NOTE 11 */
+        clockOffsetRatio = ranging_clock_offset_q32(info.clockOffset);
+        twr.clock_offset = info.clockOffset;
+
+        resp_msg_get_ts(&twr.rx_buf[TWR_SS_RESP_POLL_RX_TS_IDX], &poll_rx_ts);
+        resp_msg_get_ts(&twr.rx_buf[TWR_SS_RESP_RESP_TX_TS_IDX], &resp_tx_ts);
+
+        /* 32-bit subtractions give correct answers even if the clock has wrapped */
+        rtd_init = (uint32_t)twr.resp_ts - (uint32_t)twr.poll_ts;
+        rtd_resp = resp_tx_ts - poll_rx_ts;
+
+        twr_done(TWR_OK, 1, ranging_ss_tof(rtd_init, rtd_resp, clockOffsetRatio));
+    }
+    else
+    {
+        uint64_t final_tx_ts = twr_delayed_tx_ts(twr.resp_ts, twr_reply_dly(TWR_TUNE_FINAL));
+
+        twr_msg_init(twr.tx_buf, TWR_FUNC_DS_FINAL, twr.peer);
+        final_msg_set_ts(&twr.tx_buf[TWR_DS_FINAL_POLL_TX_TS_IDX], twr.poll_ts);
+        final_msg_set_ts(&twr.tx_buf[TWR_DS_FINAL_RESP_RX_TS_IDX], twr.resp_ts);
+        final_msg_set_ts(&twr.tx_buf[TWR_DS_FINAL_FINAL_TX_TS_IDX], final_tx_ts);
+
+        if (twr.cfg.sleep_after_final)
+        {
+            /* see NOTE in twr.h: the TX done interrupt would keep the device awake */
+            dwt_setinterrupt(SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK, 0, DWT_DISABLE_INT);
+            dwt_entersleepaftertx(1);
+        }
+
+        twr.state = TWR_STATE_WAIT_FINAL_TX;
+        if (twr_reply(TWR_DS_FINAL_FINAL_TX_TS_IDX + FINAL_MSG_TS_LEN, DWT_START_TX_DELAYED, twr.resp_ts,
+                      TWR_TUNE_FINAL) != DWT_SUCCESS)
+        {
+            if (twr.cfg.sleep_after_final)
+            {
+                dwt_entersleepaftertx(0);
+                dwt_setinterrupt(SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK, 0, DWT_ENABLE_INT);
+            }
+            twr_done(TWR_ERR_LATE_TX, 0, 0);
+        }
+        else
+        {
+            twr.phase_uus[TWR_PHASE_FINAL] = ((uint32_t)final_tx_ts - (uint32_t)twr.resp_ts) / UUS_TO_DWT_TIME;
+            /* read once the final is scheduled, off the reply deadline: valid until the receiver is enabled again */
+            twr.clock_offset = dwt_readclockoffset();
+            if (twr.cfg.sleep_after_final)
+            {
+                /* no TX done event will come, and the device is asleep once the final is sent */
+                twr_done(TWR_OK, 0, 0);
+            }
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_poll_match()
+ *
+ * @brief Responder: check the frame in rx_buf (twr_msg_read()) is a poll for this device, and set the mode (and for a
+ *        broadcast poll bc_idx, bc_count and bc_slot_uus).
+ *
+ * @param cb_data - RX callback data
+ * @param dly_uus - set to the response delay, from the poll RX
+ *
+ * @return source address, or -1 if the frame is not a poll for this device
+ */
+static int32_t twr_poll_match(const dwt_cb_data_t *cb_data, uint32_t *dly_uus)
+{
+    int32_t src;
+
+    *dly_uus = twr_reply_dly(TWR_TUNE_RESP);
+
+    if ((src = twr_msg_match(cb_data, TWR_FUNC_DS_POLL, TWR_MSG_COMMON_LEN)) >= 0)
+    {
+        twr.mode = TWR_MODE_DS;
+    }
+    else if ((src = twr_msg_match(cb_data, TWR_FUNC_SS_POLL, TWR_MSG_COMMON_LEN)) >= 0)
+    {
+        twr.mode = TWR_MODE_SS;
+    }
+    else if (((src = twr_msg_match(cb_data, TWR_FUNC_BC_POLL, TWR_BC_POLL_ADDR_IDX)) >= 0) && twr_bcast_find_slot(cb_data))
+    {
+        twr.mode = TWR_MODE_DS_BCAST;
+        *dly_uus = twr.cfg.poll_rx_to_resp_tx_dly_uus + (uint32_t)twr.bc_idx * twr.bc_slot_uus;    /* reply in our slot */
+    }
+    else
+    {
+        src = -1;
+    }
+
+    return src;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_resp_msg()
+ *
+ * @brief Responder: write the response to the poll of peer (SS, DS or broadcast from the mode) in tx_buf.
+ *
+ * @param poll_ts - poll RX timestamp
+ * @param resp_ts - predicted response TX timestamp
+ *
+ * @return frame length (without FCS)
+ */
+static uint16_t twr_resp_msg(uint64_t poll_ts, uint64_t resp_ts)
+{
+    if (twr.mode == TWR_MODE_SS)
+    {
+        twr_msg_init(twr.tx_buf, TWR_FUNC_SS_RESP, twr.peer);
+        resp_msg_set_ts(&twr.tx_buf[TWR_SS_RESP_POLL_RX_TS_IDX], poll_ts);
+        resp_msg_set_ts(&twr.tx_buf[TWR_SS_RESP_RESP_TX_TS_IDX], resp_ts);
+        return TWR_SS_RESP_RESP_TX_TS_IDX + RESP_MSG_TS_LEN;
+    }
+
+    if (twr.mode == TWR_MODE_DS)
+    {
+        twr_msg_init(twr.tx_buf, TWR_FUNC_DS_RESP, twr.peer);
+        twr.tx_buf[TWR_MSG_COMMON_LEN] = 0x02;      /* activity code: go on with the ranging exchange */
+        twr.tx_buf[TWR_MSG_COMMON_LEN + 1] = 0;
+        twr.tx_buf[TWR_MSG_COMMON_LEN + 2] = 0;
+        return TWR_MSG_COMMON_LEN + 3;
+    }
+
+    twr_msg_init(twr.tx_buf, TWR_FUNC_BC_RESP, twr.peer);
+    return TWR_MSG_COMMON_LEN;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_responder_poll()
+ *
+ * @brief Responder: poll received, schedule the response (and the final reception for DS).
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return none
+ */
+static void twr_responder_poll(const dwt_cb_data_t *cb_data)
+{
+    int32_t src;
+    uint16_t len;
+    uint8_t mode;
+    uint32_t dly_uus;
+
+    if ((twr_msg_read(cb_data) != DWT_SUCCESS) || ((src = twr_poll_match(cb_data, &dly_uus)) < 0))
+    {
+        twr_rx_listen();
+        return;
+    }
+
+    twr.peer = (uint16_t)src;
+    twr.poll_seq = twr.rx_buf[TWR_MSG_SN_IDX];
+    twr.poll_ts = get_rx_timestamp_u64();
+    twr.resp_ts = twr_delayed_tx_ts(twr.poll_ts, dly_uus);
+    len = twr_resp_msg(twr.poll_ts, twr.resp_ts);
+
+    if (twr.mode == TWR_MODE_SS)
+    {
+        mode = DWT_START_TX_DELAYED;
+        twr.state = TWR_STATE_WAIT_RESP_TX;
+    }
+    else
+    {
+        if (twr.mode == TWR_MODE_DS)
+        {
+            twr_rx_window(TWR_TUNE_FINAL, twr.cfg.resp_tx_to_final_rx_dly_uus, twr.cfg.final_rx_timeout_uus);
+        }
+        else
+        {
+            /* the final follows the last slot */
+            dwt_setrxaftertxdelay(twr.cfg.resp_tx_to_final_rx_dly_uus +
+                                  (uint32_t)(twr.bc_count - 1 - twr.bc_idx) * twr.bc_slot_uus);
+            dwt_setrxtimeout(twr.cfg.final_rx_timeout_uus);
+            dwt_setpreambledetecttimeout(twr.cfg.pre_timeout);
+        }
+        mode = DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED;
+        twr.state = TWR_STATE_WAIT_FINAL;
+    }
+
+    if (((twr.mode == TWR_MODE_DS_BCAST) ? twr_send(len, mode) :
+                                           twr_reply(len, mode, twr.poll_ts, TWR_TUNE_RESP)) != DWT_SUCCESS)
+    {
+        twr_done(TWR_ERR_LATE_TX, 0, 0);
+    }
+    else
+    {
+        /* poll clock offset: the receiver is enabled again after the response only */
+        twr.clock_offset = dwt_readclockoffset();
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_final_match()
+ *
+ * @brief Responder: check the frame in rx_buf (twr_msg_read()) is the final of the exchange with a peer, and get the
+ *        initiator timestamps it carries.
+ *
+ * @param cb_data - RX callback data
+ * @param mode - TWR_MODE_DS or TWR_MODE_DS_BCAST
+ * @param peer - initiator address
+ * @param poll_tx_ts - set to the poll TX timestamp (low 32 bits)
+ * @param resp_rx_ts - set to the RX timestamp of our response (low 32 bits)
+ * @param final_tx_ts - set to the final TX timestamp (low 32 bits)
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the frame is not the expected final
+ */
+static int twr_final_match(const dwt_cb_data_t *cb_data, twr_mode_e mode, uint16_t peer,
+                           uint32_t *poll_tx_ts, uint32_t *resp_rx_ts, uint32_t *final_tx_ts)
+{
+    if (mode == TWR_MODE_DS_BCAST)
+    {
+        uint16_t idx = TWR_BC_FINAL_ENTRY_IDX;
+        uint8_t i, n;
+
+        if (twr_msg_match(cb_data, TWR_FUNC_BC_FINAL, TWR_BC_FINAL_ENTRY_IDX) != peer)
+        {
+            return DWT_ERROR;
+        }
+
+        /* Look for our response RX timestamp */
+        n = twr.rx_buf[TWR_BC_FINAL_COUNT_IDX];
+        for (i = 0; i < n; i++, idx += TWR_BC_FINAL_ENTRY_LEN)
+        {
+            if ((idx + TWR_BC_FINAL_ENTRY_LEN + FCS_LEN) > cb_data->datalength)
+            {
+                i = n;
+                break;
+            }
+            if ((twr.rx_buf[idx] | ((uint16_t)twr.rx_buf[idx + 1] << 8)) == twr.cfg.addr)
+            {
+                break;
+            }
+        }
+        if (i == n)
+        {
+            return DWT_ERROR;
+        }
+
+        final_msg_get_ts(&twr.rx_buf[TWR_BC_FINAL_POLL_TX_TS_IDX], poll_tx_ts);
+        final_msg_get_ts(&twr.rx_buf[idx + 2], resp_rx_ts);
+        final_msg_get_ts(&twr.rx_buf[TWR_BC_FINAL_FINAL_TX_TS_IDX], final_tx_ts);
+    }
+    else
+    {
+        if (twr_msg_match(cb_data, TWR_FUNC_DS_FINAL, TWR_DS_FINAL_FINAL_TX_TS_IDX + FINAL_MSG_TS_LEN) != peer)
+        {
+            return DWT_ERROR;
+        }
+
+        final_msg_get_ts(&twr.rx_buf[TWR_DS_FINAL_POLL_TX_TS_IDX], poll_tx_ts);
+        final_msg_get_ts(&twr.rx_buf[TWR_DS_FINAL_RESP_RX_TS_IDX], resp_rx_ts);
+        final_msg_get_ts(&twr.rx_buf[TWR_DS_FINAL_FINAL_TX_TS_IDX], final_tx_ts);
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_final_tof()
+ *
+ * @brief Responder: DS-TWR time of flight from the responder and initiator timestamps of an exchange.
+ *
+ * @param poll_rx_ts - poll RX timestamp
+ * @param resp_tx_ts - response TX timestamp
+ * @param final_rx_ts - final RX timestamp
+ * @param poll_tx_ts - poll TX timestamp, from the final (low 32 bits)
+ * @param resp_rx_ts - response RX timestamp, from the final (low 32 bits)
+ * @param final_tx_ts - final TX timestamp, from the final (low 32 bits)
+ *
+ * @return time of flight, in 1/16 device time units (see ranging_math.h)
+ */
+static int32_t twr_final_tof(uint64_t poll_rx_ts, uint64_t resp_tx_ts, uint64_t final_rx_ts,
+                             uint32_t poll_tx_ts, uint32_t resp_rx_ts, uint32_t final_tx_ts)
+{
+    uint32_t poll_rx_ts_32, resp_tx_ts_32, final_rx_ts_32;
+    uint32_t Ra, Rb, Da, Db;
+
+    /* 32-bit subtractions give correct answers even if the clock has wrapped, see ex_05b NOTE 12 */
+    poll_rx_ts_32 = (uint32_t)poll_rx_ts;
+    resp_tx_ts_32 = (uint32_t)resp_tx_ts;
+    final_rx_ts_32 = (uint32_t)final_rx_ts;
+    Ra = resp_rx_ts - poll_tx_ts;
+    Rb = final_rx_ts_32 - resp_tx_ts_32;
+    Da = final_tx_ts - resp_rx_ts;
+    Db = resp_tx_ts_32 - poll_rx_ts_32;
+
+    return ranging_ds_tof(Ra, Rb, Da, Db);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_responder_final()
+ *
+ * @brief Responder: DS final received, compute the time of flight.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return none
+ */
+static void twr_responder_final(const dwt_cb_data_t *cb_data)
+{
+    uint32_t poll_tx_ts, resp_rx_ts, final_tx_ts;
+    uint64_t final_rx_ts, resp_tx_ts;
+    dwt_rxinfo_t info;
+
+    if ((twr_msg_read(cb_data) != DWT_SUCCESS) ||
+        (twr_final_match(cb_data, twr.mode, twr.peer, &poll_tx_ts, &resp_rx_ts, &final_tx_ts) != DWT_SUCCESS))
+    {
+        twr_done(TWR_ERR_FRAME, 0, 0);
+        return;
+    }
+
+    dwt_readrxinfo(&info, DWT_RXINFO_CIA);
+    final_rx_ts = twr_ts_u64(info.rxStamp);
+    twr.clock_offset = info.clockOffset;
+    resp_tx_ts = twr_ts_u64(info.txStamp);
+    if (twr.mode == TWR_MODE_DS)
+    {
+        twr_rx_learn(TWR_TUNE_FINAL, resp_tx_ts, final_rx_ts, twr.resp_tail_uus);
+    }
+
+    twr_done(TWR_OK, 1, twr_final_tof(twr.poll_ts, resp_tx_ts, final_rx_ts, poll_tx_ts, resp_rx_ts, final_tx_ts));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_uus_to_hi()
+ *
+ * @brief Convert a duration to units of the high 32 bits of the device time.
+ *
+ * @param uus - duration, in UWB microseconds
+ *
+ * @return duration, in 256 device time units
+ */
+static uint32_t twr_uus_to_hi(uint32_t uus)
+{
+    return (uint32_t)(((uint64_t)uus * UUS_TO_DWT_TIME) >> 8);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_report()
+ *
+ * @brief Multi-initiator responder: report the result of an exchange.
+ *
+ * @param sess - exchange
+ * @param status - exchange status
+ * @param has_tof - tof is valid
+ * @param tof - time of flight, in 1/16 device time units (see ranging_math.h)
+ *
+ * @return none
+ */
+static void twr_multi_report(const twr_session_t *sess, twr_status_e status, uint8_t has_tof, int32_t tof)
+{
+    twr_result_t result;
+
+    memset(&result, 0, sizeof(result));
+    result.status = status;
+    result.role = TWR_ROLE_RESPONDER;
+    result.mode = (twr_mode_e)sess->mode;
+    result.peer = sess->peer;
+    result.seq = sess->poll_seq;
+    result.has_tof = has_tof;
+    result.tof = tof;
+    result.distance_mm = has_tof ? ranging_tof_to_mm(tof) : 0;
+    result.clock_offset = sess->clock_offset;
+
+    if (twr.cb != NULL)
+    {
+        twr.cb(&result);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_free()
+ *
+ * @brief Multi-initiator responder: end a session and report its result.
+ *
+ * @param sess - session
+ * @param status - exchange status
+ * @param has_tof - tof is valid
+ * @param tof - time of flight, in 1/16 device time units
+ *
+ * @return none
+ */
+static void twr_multi_free(twr_session_t *sess, twr_status_e status, uint8_t has_tof, int32_t tof)
+{
+    sess->used = 0;
+    twr.ms.active--;
+    twr_multi_report(sess, status, has_tof, tof);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_expire()
+ *
+ * @brief Multi-initiator responder: end with TWR_ERR_TIMEOUT the sessions whose final window is over, and the previous
+ *        session of an initiator polling again (it gave that exchange up).
+ *
+ * @param now - current device time (high 32 bits)
+ * @param peer - initiator polling again, TWR_BROADCAST_ADDR if none
+ * @param keep - its new session, NULL if none
+ *
+ * @return none
+ */
+static void twr_multi_expire(uint32_t now, uint16_t peer, const twr_session_t *keep)
+{
+    twr_session_t *s;
+    uint8_t i;
+
+    for (i = 0; (i < TWR_SESSIONS) && (twr.ms.active != 0); i++)
+    {
+        s = &twr.sessions[i];
+        if (s->used && (s != keep) && ((s->peer == peer) || ((int32_t)(now - s->final_close) >= 0)))
+        {
+            twr.ms.timeouts++;
+            twr_multi_free(s, TWR_ERR_TIMEOUT, 0, 0);
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_rx_timeout()
+ *
+ * @brief Multi-initiator responder: RX timeout for a receiver enabled at a given time, so that it ends with the
+ *        earliest final window.
+ *
+ * @param from - device time the receiver is enabled (high 32 bits)
+ *
+ * @return RX timeout, in UWB microseconds, 0 (none) without sessions
+ */
+static uint32_t twr_multi_rx_timeout(uint32_t from)
+{
+    int32_t left, next = INT32_MAX;
+    uint32_t uus;
+    uint8_t i;
+
+    if (twr.ms.active == 0)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < TWR_SESSIONS; i++)
+    {
+        left = (int32_t)(twr.sessions[i].final_close - from);
+        if (twr.sessions[i].used && (left < next))
+        {
+            next = left;
+        }
+    }
+
+    if (next <= 0)
+    {
+        return 1;
+    }
+    uus = (uint32_t)(((uint64_t)next << 8) / UUS_TO_DWT_TIME) + 1;
+
+    return (uus > RX_FWTO_FWTO_BIT_MASK) ? RX_FWTO_FWTO_BIT_MASK : uus;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_rx_enable()
+ *
+ * @brief Multi-initiator responder: enable the receiver for the polls and the finals, until the earliest final
+ *        window ends.
+ *
+ * @param now - current device time (high 32 bits)
+ *
+ * @return none
+ */
+static void twr_multi_rx_enable(uint32_t now)
+{
+    dwt_setrxtimeout(twr_multi_rx_timeout(now));
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_slot()
+ *
+ * @brief Multi-initiator responder: check a new exchange fits between the sessions, and find a free session for it.
+ *
+ *        The device is busy from the poll RX to the end of the response TX (it cannot receive while the delayed TX
+ *        is pending), and for DS from the opening of the final window to the end of the final frame. Sessions over
+ *        (final window past, or the previous one of the same initiator) are not in the way.
+ *
+ * @param src - initiator address
+ * @param poll_hi - poll RX time (high 32 bits)
+ * @param busy_end - end of the response TX (high 32 bits)
+ * @param open - final window (high 32 bits), DS only
+ * @param close - end of the final frame at the latest (high 32 bits), DS only
+ * @param sess - set to a free session, NULL if none (SS: to the first session, not used)
+ * @param stale - set if there are sessions over
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the exchange overlaps a session
+ */
+static int twr_multi_slot(uint16_t src, uint32_t poll_hi, uint32_t busy_end, uint32_t open, uint32_t close,
+                          twr_session_t **sess, uint8_t *stale)
+{
+    twr_session_t *s;
+    uint8_t i;
+
+    *sess = (twr.mode == TWR_MODE_SS) ? &twr.sessions[0] : NULL;
+    *stale = 0;
+    for (i = 0; i < TWR_SESSIONS; i++)
+    {
+        s = &twr.sessions[i];
+        if (!s->used)
+        {
+            if (*sess == NULL)
+            {
+                *sess = s;
+            }
+            continue;
+        }
+        if ((s->peer == src) || ((int32_t)(poll_hi - s->final_close) >= 0))
+        {
+            *stale = 1;
+            continue;
+        }
+        /* wrap-safe interval overlaps */
+        if ((((int32_t)(poll_hi - s->final_close) < 0) && ((int32_t)(s->final_open - busy_end) < 0)) ||
+            ((twr.mode != TWR_MODE_SS) && ((int32_t)(open - s->final_close) < 0) && ((int32_t)(s->final_open - close) < 0)))
+        {
+            return DWT_ERROR;
+        }
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_poll()
+ *
+ * @brief Multi-initiator responder: poll in rx_buf (twr_poll_match()), answer it if it fits between the sessions (see
+ *        twr_multi_slot()). A poll not answered times out on the initiator side, which polls again. The sessions over
+ *        are ended after the response is scheduled, off the reply deadline.
+ *
+ * @param src - initiator address
+ * @param dly_uus - response delay, from the poll RX
+ * @param poll_ts - poll RX timestamp
+ *
+ * @return none
+ */
+static void twr_multi_poll(uint16_t src, uint32_t dly_uus, uint64_t poll_ts)
+{
+    twr_session_t *sess, ss;
+    uint32_t poll_hi = (uint32_t)(poll_ts >> 8);
+    uint32_t busy_end, open = 0, close = 0, dly;
+    uint16_t len;
+    uint8_t stale;
+
+    twr.ms.polls++;
+
+    busy_end = poll_hi + twr_uus_to_hi(dly_uus + twr.ms_resp_uus[twr.mode]);
+    if (twr.mode != TWR_MODE_SS)
+    {
+        dly = twr.cfg.resp_tx_to_final_rx_dly_uus;
+        if (twr.mode == TWR_MODE_DS_BCAST)
+        {
+            dly += (uint32_t)(twr.bc_count - 1 - twr.bc_idx) * twr.bc_slot_uus;     /* the final follows the last slot */
+        }
+        open = busy_end + twr_uus_to_hi(dly);
+        close = open + twr_uus_to_hi(twr.cfg.final_rx_timeout_uus + twr.ms_final_uus[twr.mode]);
+    }
+
+    if (twr_multi_slot(src, poll_hi, busy_end, open, close, &sess, &stale) != DWT_SUCCESS)
+    {
+        twr.ms.refused++;
+        sess = NULL;
+    }
+    else if (sess == NULL)
+    {
+        if (stale)
+        {
+            /* no free session but some over: end them now and look again */
+            twr_multi_expire(poll_hi, src, NULL);
+            twr_multi_slot(src, poll_hi, busy_end, open, close, &sess, &stale);
+        }
+        if (sess == NULL)
+        {
+            twr.ms.full++;
+        }
+    }
+    if (sess == NULL)
+    {
+        twr_multi_expire(poll_hi, src, NULL);
+        twr_multi_rx_enable(poll_hi);
+        return;
+    }
+
+    if (twr.mode == TWR_MODE_SS)
+    {
+        /* no session, reported once the response is scheduled */
+        sess = &ss;
+        sess->used = 0;
+    }
+    twr.peer = src;
+    sess->mode = (uint8_t)twr.mode;
+    sess->peer = src;
+    sess->poll_seq = twr.rx_buf[TWR_MSG_SN_IDX];
+    sess->poll_ts = poll_ts;
+    sess->resp_ts = twr_delayed_tx_ts(poll_ts, dly_uus);
+    sess->final_open = open;
+    sess->final_close = close;
+    len = twr_resp_msg(poll_ts, sess->resp_ts);
+
+    if (twr.mode != TWR_MODE_SS)
+    {
+        sess->used = 1;
+        if (++twr.ms.active > twr.ms.max_active)
+        {
+            twr.ms.max_active = twr.ms.active;
+        }
+    }
+
+    /* The receiver is back on right after the response, for the polls and the finals */
+    dwt_setrxaftertxdelay(0);
+    dwt_setrxtimeout(twr_multi_rx_timeout(busy_end));
+
+    if (((twr.mode == TWR_MODE_DS_BCAST) ? twr_send(len, DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED) :
+                                           twr_reply(len, DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED, poll_ts,
+                                                     TWR_TUNE_RESP)) != DWT_SUCCESS)
+    {
+        twr.ms.late_tx++;
+        if (sess->used)
+        {
+            twr_multi_free(sess, TWR_ERR_LATE_TX, 0, 0);
+        }
+        else
+        {
+            twr_multi_report(sess, TWR_ERR_LATE_TX, 0, 0);
+        }
+        twr_multi_expire(poll_hi, src, NULL);
+        twr_multi_rx_enable(poll_hi);
+        return;
+    }
+
+    /* poll clock offset: the receiver is enabled again after the response only */
+    sess->clock_offset = dwt_readclockoffset();
+    if (stale)
+    {
+        twr_multi_expire(poll_hi, src, sess);
+    }
+    if (twr.mode == TWR_MODE_SS)
+    {
+        twr_multi_report(sess, TWR_OK, 0, 0);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_event()
+ *
+ * @brief Multi-initiator responder: RX timeout (end of a final window) or error, expire the sessions and listen again.
+ *
+ * @return none
+ */
+static void twr_multi_event(void)
+{
+    uint32_t now = dwt_readsystimestamphi32();
+
+    twr_multi_expire(now, TWR_BROADCAST_ADDR, NULL);
+    twr_multi_rx_enable(now);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi_rx()
+ *
+ * @brief Multi-initiator responder: frame received. A poll opens a session, a final from an initiator with a session
+ *        ends it with the time of flight, anything else is ignored.
+ *
+ * @param cb_data - RX callback data
+ *
+ * @return none
+ */
+static void twr_multi_rx(const dwt_cb_data_t *cb_data)
+{
+    uint32_t poll_tx_ts, resp_rx_ts, final_tx_ts, dly_uus;
+    uint64_t rx_ts;
+    twr_session_t *sess;
+    dwt_rxinfo_t info;
+    int32_t src;
+    uint16_t peer;
+    uint8_t i;
+
+    if (twr_msg_read(cb_data) != DWT_SUCCESS)
+    {
+        twr_multi_event();
+        return;
+    }
+
+    if ((src = twr_poll_match(cb_data, &dly_uus)) >= 0)
+    {
+        twr_multi_poll((uint16_t)src, dly_uus, get_rx_timestamp_u64());
+        return;
+    }
+
+    /* Timestamps and clock offset in one go, as for any final */
+    dwt_readrxinfo(&info, DWT_RXINFO_CIA);
+    rx_ts = twr_ts_u64(info.rxStamp);
+
+    peer = twr.rx_buf[TWR_MSG_SRC_IDX] | ((uint16_t)twr.rx_buf[TWR_MSG_SRC_IDX + 1] << 8);
+    for (i = 0; i < TWR_SESSIONS; i++)
+    {
+        sess = &twr.sessions[i];
+        if (sess->used && (sess->peer == peer) &&
+            (twr_final_match(cb_data, (twr_mode_e)sess->mode, peer, &poll_tx_ts, &resp_rx_ts, &final_tx_ts) ==
+             DWT_SUCCESS))
+        {
+            sess->clock_offset = info.clockOffset;
+            twr.ms.finals++;
+            twr_multi_free(sess, TWR_OK, 1, twr_final_tof(sess->poll_ts, sess->resp_ts, rx_ts,
+                                                          poll_tx_ts, resp_rx_ts, final_tx_ts));
+            break;
+        }
+    }
+
+    twr_multi_expire((uint32_t)(rx_ts >> 8), TWR_BROADCAST_ADDR, NULL);
+    twr_multi_rx_enable((uint32_t)(rx_ts >> 8));
+}
+
+/* Driver callbacks */
+
+static void twr_tx_done_cb(const dwt_cb_data_t *cb_data)
+{
+    (void)cb_data;
+
+    switch (twr.state)
+    {
+        case TWR_STATE_WAIT_FINAL_TX:
+            if (twr.mode == TWR_MODE_DS_BCAST)
+            {
+                twr_bcast_done(TWR_OK);
+                break;
+            }
+            twr_done(TWR_OK, 0, 0);
+            break;
+        case TWR_STATE_WAIT_RESP_TX:
+            twr_done(TWR_OK, 0, 0);
+            break;
+        case TWR_STATE_BCAST_WAIT_RESP:
+            /* broadcast poll sent */
+            twr.poll_ts = get_tx_timestamp_u64();
+            break;
+        default:
+            /* poll or DS response sent, the RX is enabled after it */
+            break;
+    }
+}
+
+static void twr_rx_ok_cb(const dwt_cb_data_t *cb_data)
+{
+    switch (twr.state)
+    {
+        case TWR_STATE_WAIT_RESP:
+            twr_initiator_rx(cb_data);
+            break;
+        case TWR_STATE_BCAST_WAIT_RESP:
+            twr_bcast_event(cb_data);
+            break;
+        case TWR_STATE_LISTEN:
+            if (twr.multi)
+            {
+                twr_multi_rx(cb_data);
+                break;
+            }
+            twr_responder_poll(cb_data);
+            break;
+        case TWR_STATE_WAIT_FINAL:
+            twr_responder_final(cb_data);
+            break;
+        default:
+            break;
+    }
+}
+
+static void twr_rx_to_cb(const dwt_cb_data_t *cb_data)
+{
+    (void)cb_data;
+
+    switch (twr.state)
+    {
+        case TWR_STATE_WAIT_RESP:
+        case TWR_STATE_WAIT_FINAL:
+            if (twr.tune_on && (twr.mode != TWR_MODE_DS_BCAST))
+            {
+                /* the peer reply may have come before the window, open the next one right after the TX */
+                twr_tune_e idx = (twr.state == TWR_STATE_WAIT_RESP) ? TWR_TUNE_RESP : TWR_TUNE_FINAL;
+
+                twr.rx_open[idx] = 1;
+                twr.tune.rx_misses[idx]++;
+            }
+            twr_done(TWR_ERR_TIMEOUT, 0, 0);
+            break;
+        case TWR_STATE_BCAST_WAIT_RESP:
+            twr_bcast_final();
+            break;
+        case TWR_STATE_LISTEN:
+            if (twr.multi)
+            {
+                twr_multi_event();
+                break;
+            }
+            twr_rx_listen();
+            break;
+        default:
+            break;
+    }
+}
+
+static void twr_rx_err_cb(const dwt_cb_data_t *cb_data)
+{
+    (void)cb_data;
+
+    switch (twr.state)
+    {
+        case TWR_STATE_WAIT_RESP:
+        case TWR_STATE_WAIT_FINAL:
+            twr_done(TWR_ERR_RX, 0, 0);
+            break;
+        case TWR_STATE_BCAST_WAIT_RESP:
+            twr_bcast_event(NULL);
+            break;
+        case TWR_STATE_LISTEN:
+            if (twr.multi)
+            {
+                twr_multi_event();
+                break;
+            }
+            twr_rx_listen();
+            break;
+        default:
+            break;
+    }
+}
+
+static void twr_cca_fail_cb(const dwt_cb_data_t *cb_data)
+{
+    (void)cb_data;
+
+    /* poll cancelled, the device is back in IDLE */
+    if (twr.state == TWR_STATE_WAIT_RESP)
+    {
+        twr_done(TWR_ERR_BUSY, 0, 0);
+    }
+}
+
+/* API */
+
+void twr_default_config(twr_config_t *cfg, twr_role_e role)
+{
+    cfg->pan_id = TWR_DEFAULT_PAN_ID;
+    cfg->addr = (role == TWR_ROLE_INITIATOR) ? TWR_DEFAULT_INIT_ADDR : TWR_DEFAULT_RESP_ADDR;
+    cfg->tx_ant_dly = 16385;
+    cfg->pre_timeout = 5;
+    cfg->poll_tx_to_resp_rx_dly_uus = 700;
+    cfg->resp_rx_timeout_uus = 300;
+    cfg->resp_rx_to_final_tx_dly_uus = 700;
+    cfg->sleep_after_final = 0;
+    cfg->cca = 0;
+    cfg->poll_rx_to_resp_tx_dly_uus = 900;
+    cfg->resp_tx_to_final_rx_dly_uus = 500;
+    cfg->final_rx_timeout_uus = 220;
+}
+
+int twr_init(const twr_config_t *cfg, twr_result_cb_t cb)
+{
+    if ((cfg == NULL) || (twr.state != TWR_STATE_IDLE) || (cfg->cca && (cfg->pre_timeout == 0)))
+    {
+        return DWT_ERROR;
+    }
+
+    twr.cfg = *cfg;
+    twr.cb = cb;
+
+    dwt_setcallbacks(&twr_tx_done_cb, &twr_rx_ok_cb, &twr_rx_to_cb, &twr_rx_err_cb, NULL, NULL);
+    dwt_setcbccafail(cfg->cca ? &twr_cca_fail_cb : NULL);
+
+    dwt_setinterrupt(SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFTO_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXPTO_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXPHE_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFCE_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXFSL_ENABLE_BIT_MASK |
+                     SYS_ENABLE_LO_RXSTO_ENABLE_BIT_MASK,
+                     cfg->cca ? SYS_ENABLE_HI_CCA_FAIL_ENABLE_BIT_MASK : 0,
+                     DWT_ENABLE_INT);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_start_poll()
+ *
+ * @brief Initiator: send the poll of an exchange.
+ *
+ * @param mode - TWR_MODE_SS or TWR_MODE_DS
+ * @param peer - responder address
+ * @param txmode - DWT_START_TX_IMMEDIATE or DWT_START_TX_DELAYED (time already set)
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if an exchange is in progress or the delayed TX time is already past
+ */
+static int twr_start_poll(twr_mode_e mode, uint16_t peer, uint8_t txmode)
+{
+    if ((twr.state != TWR_STATE_IDLE) || (mode == TWR_MODE_DS_BCAST))
+    {
+        return DWT_ERROR;
+    }
+
+    twr.role = TWR_ROLE_INITIATOR;
+    twr.mode = mode;
+    twr.peer = peer;
+    twr.poll_seq = twr.seq;
+    memset(twr.phase_uus, 0, sizeof(twr.phase_uus));
+    twr.clock_offset = 0;
+
+    if (twr.cfg.sleep_after_final)
+    {
+        /* the device sleeps after the TX while armed: disarm it for the poll, see NOTE in twr.h */
+        dwt_entersleepaftertx(0);
+        dwt_setinterrupt(SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK, 0, DWT_ENABLE_INT);
+    }
+
+    if (twr.cfg.cca && (txmode == DWT_START_TX_IMMEDIATE))
+    {
+        /* the preamble detection timeout is the CCA window, see NOTE in twr.h */
+        twr.rx_open[TWR_TUNE_RESP] = 0;
+        txmode = DWT_START_TX_CCA;
+    }
+
+    twr_rx_window(TWR_TUNE_RESP, twr.cfg.poll_tx_to_resp_rx_dly_uus, twr.cfg.resp_rx_timeout_uus);
+
+    twr_msg_init(twr.tx_buf, (mode == TWR_MODE_SS) ? TWR_FUNC_SS_POLL : TWR_FUNC_DS_POLL, peer);
+
+    twr.state = TWR_STATE_WAIT_RESP;
+    if (twr_send(TWR_MSG_COMMON_LEN, txmode | DWT_RESPONSE_EXPECTED) != DWT_SUCCESS)
+    {
+        twr.state = TWR_STATE_IDLE;
+        return DWT_ERROR;
+    }
+
+    return DWT_SUCCESS;
+}
+
+int twr_start(twr_mode_e mode, uint16_t peer)
+{
+    return twr_start_poll(mode, peer, DWT_START_TX_IMMEDIATE);
+}
+
+int twr_start_delayed(twr_mode_e mode, uint16_t peer, uint32_t tx_time)
+{
+    if (twr.state != TWR_STATE_IDLE)
+    {
+        return DWT_ERROR;
+    }
+
+    dwt_setdelayedtrxtime(tx_time);
+
+    return twr_start_poll(mode, peer, DWT_START_TX_DELAYED);
+}
+
+int twr_start_bcast(const uint16_t *anchors, uint8_t count, uint16_t slot_uus)
+{
+    uint32_t window_uus;
+    uint8_t i;
+
+    if ((twr.state != TWR_STATE_IDLE) || (count == 0) || (count > TWR_BCAST_MAX_ANCHORS))
+    {
+        return DWT_ERROR;
+    }
+
+    twr.role = TWR_ROLE_INITIATOR;
+    twr.mode = TWR_MODE_DS_BCAST;
+    twr.peer = TWR_BROADCAST_ADDR;
+    twr.poll_seq = twr.seq;
+    twr.bc_count = count;
+    twr.bc_slot_uus = slot_uus;
+    twr.bc_got = 0;
+    memcpy(twr.bc_addr, anchors, count * sizeof(anchors[0]));
+
+    twr_msg_init(twr.tx_buf, TWR_FUNC_BC_POLL, TWR_BROADCAST_ADDR);
+    twr.tx_buf[TWR_BC_POLL_COUNT_IDX] = count;
+    twr.tx_buf[TWR_BC_POLL_SLOT_IDX] = (uint8_t)slot_uus;
+    twr.tx_buf[TWR_BC_POLL_SLOT_IDX + 1] = (uint8_t)(slot_uus >> 8);
+    for (i = 0; i < count; i++)
+    {
+        twr.tx_buf[TWR_BC_POLL_ADDR_IDX + 2 * i] = (uint8_t)anchors[i];
+        twr.tx_buf[TWR_BC_POLL_ADDR_IDX + 2 * i + 1] = (uint8_t)(anchors[i] >> 8);
+    }
+
+    /* The receiver stays on (re-enabled after each response) until the end of the last slot */
+    window_uus = twr.cfg.resp_rx_timeout_uus + (uint32_t)(count - 1) * slot_uus;
+    dwt_setrxaftertxdelay(twr.cfg.poll_tx_to_resp_rx_dly_uus);
+    dwt_setrxtimeout(window_uus);
+    dwt_setpreambledetecttimeout(0);
+
+    /* Approximate end of the window (the poll is sent now) */
+    twr.bc_end = dwt_readsystimestamphi32() +
+                 (uint32_t)(((uint64_t)(twr.cfg.poll_tx_to_resp_rx_dly_uus + window_uus) * UUS_TO_DWT_TIME) >> 8);
+
+    twr.state = TWR_STATE_BCAST_WAIT_RESP;
+    if (twr_send(TWR_BC_POLL_ADDR_IDX + 2 * count, DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED) != DWT_SUCCESS)
+    {
+        twr.state = TWR_STATE_IDLE;
+        return DWT_ERROR;
+    }
+
+    return DWT_SUCCESS;
+}
+
+uint16_t twr_bcast_slot_uus(const dwt_config_t *config)
+{
+    return (uint16_t)(twr_frame_airtime_uus(config, TWR_MSG_COMMON_LEN + FCS_LEN) + TWR_BCAST_GUARD_UUS);
+}
+
+int twr_listen(void)
+{
+    if (twr.state != TWR_STATE_IDLE)
+    {
+        return DWT_ERROR;
+    }
+
+    twr.role = TWR_ROLE_RESPONDER;
+    twr_rx_listen();
+
+    return DWT_SUCCESS;
+}
+
+void twr_stop(void)
+{
+    twr.state = TWR_STATE_IDLE;
+    dwt_forcetrxoff();
+
+    memset(twr.sessions, 0, sizeof(twr.sessions));
+    twr.ms.active = 0;
+}
+
+twr_state_e twr_get_state(void)
+{
+    return twr.state;
+}
+
+uint32_t twr_frame_airtime_uus(const dwt_config_t *config, uint16_t len)
+{
+    return phy_timing_frame_uus(config, len);
+}
+
+uint32_t twr_exchange_uus(const twr_config_t *cfg, const dwt_config_t *config, twr_mode_e mode)
+{
+    /* The reply delays are counted between RMARKERs (end of SFD), so the poll SHR and the PHR and data of the
+     * last frame add up to less than the airtime of the longest frame */
+    if (mode == TWR_MODE_SS)
+    {
+        return cfg->poll_rx_to_resp_tx_dly_uus +
+               twr_frame_airtime_uus(config, TWR_SS_RESP_RESP_TX_TS_IDX + RESP_MSG_TS_LEN + FCS_LEN);
+    }
+
+    return cfg->poll_rx_to_resp_tx_dly_uus + cfg->resp_rx_to_final_tx_dly_uus +
+           twr_frame_airtime_uus(config, TWR_DS_FINAL_FINAL_TX_TS_IDX + FINAL_MSG_TS_LEN + FCS_LEN);
+}
+
+int twr_autotune(const dwt_config_t *config, uint16_t margin_uus)
+{
+    uint8_t i;
+
+    if (twr.state != TWR_STATE_IDLE)
+    {
+        return DWT_ERROR;
+    }
+
+    twr.tune_on = 0;
+    if (config == NULL)
+    {
+        return DWT_SUCCESS;
+    }
+
+    memset(&twr.tune, 0, sizeof(twr.tune));
+    for (i = 0; i < TWR_TUNE_NUM; i++)
+    {
+        twr.rx_open[i] = 0;
+        twr.late_uus[i] = 0;
+        twr.late_ok[i] = 0;
+    }
+    twr.tune.reply_dly_uus[TWR_TUNE_RESP] = (uint16_t)twr.cfg.poll_rx_to_resp_tx_dly_uus;
+    twr.tune.reply_dly_uus[TWR_TUNE_FINAL] = (uint16_t)twr.cfg.resp_rx_to_final_tx_dly_uus;
+    twr.tune.rx_dly_uus[TWR_TUNE_RESP] = (uint16_t)twr.cfg.poll_tx_to_resp_rx_dly_uus;
+    twr.tune.rx_dly_uus[TWR_TUNE_FINAL] = (uint16_t)twr.cfg.resp_tx_to_final_rx_dly_uus;
+
+    twr.tune_margin_uus = margin_uus;
+    twr.shr_uus = (uint16_t)phy_timing_shr_uus(config);
+    twr.poll_tail_uus = (uint16_t)(twr_frame_airtime_uus(config, TWR_MSG_COMMON_LEN + FCS_LEN) - twr.shr_uus);
+    twr.resp_tail_uus = (uint16_t)(twr_frame_airtime_uus(config, TWR_MSG_COMMON_LEN + 3 + FCS_LEN) - twr.shr_uus);
+    twr.tune_on = 1;
+
+    return DWT_SUCCESS;
+}
+
+const twr_tune_t * twr_get_tune(void)
+{
+    return &twr.tune;
+}
+
+int twr_multi(const dwt_config_t *config)
+{
+    if (twr.state != TWR_STATE_IDLE)
+    {
+        return DWT_ERROR;
+    }
+
+    twr.multi = 0;
+    memset(twr.sessions, 0, sizeof(twr.sessions));
+    memset(&twr.ms, 0, sizeof(twr.ms));
+    if (config == NULL)
+    {
+        return DWT_SUCCESS;
+    }
+
+    twr.ms_resp_uus[TWR_MODE_SS] = (uint16_t)twr_frame_airtime_uus(config, TWR_SS_RESP_RESP_TX_TS_IDX + RESP_MSG_TS_LEN +
+                                                                   FCS_LEN);
+    twr.ms_resp_uus[TWR_MODE_DS] = (uint16_t)twr_frame_airtime_uus(config, TWR_MSG_COMMON_LEN + 3 + FCS_LEN);
+    twr.ms_resp_uus[TWR_MODE_DS_BCAST] = (uint16_t)twr_frame_airtime_uus(config, TWR_MSG_COMMON_LEN + FCS_LEN);
+    twr.ms_final_uus[TWR_MODE_SS] = 0;
+    twr.ms_final_uus[TWR_MODE_DS] = (uint16_t)twr_frame_airtime_uus(config, TWR_DS_FINAL_FINAL_TX_TS_IDX +
+                                                                    FINAL_MSG_TS_LEN + FCS_LEN);
+    twr.ms_final_uus[TWR_MODE_DS_BCAST] = (uint16_t)twr_frame_airtime_uus(config, TWR_FRAME_LEN_MAX);
+    twr.multi = 1;
+
+    return DWT_SUCCESS;
+}
+
+const twr_multi_t * twr_get_multi(void)
+{
+    return &twr.ms;
+}
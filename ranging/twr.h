@@ -0,0 +1,416 @@
+/*! ----------------------------------------------------------------------------
+ * @file    twr.h
+ * @brief   Event driven two-way ranging (SS-TWR and DS-TWR) engine
+ *
+ *          The engine runs the ranging exchanges of the ex_05a/ex_05b (DS-TWR)
+ *          and ex_06a/ex_06b (SS-TWR) examples as a state machine driven by the
+ *          dwt_setcallbacks() events, so the host is free (or asleep) between
+ *          frames. It uses the same frames, so it interoperates with those
+ *          examples when the default addresses are used.
+ *
+ *          Initiator: twr_start() sends a poll and the result callback is
+ *                     called once the exchange is over.
+ *          Responder: twr_listen() waits for polls and answers each one (SS,
+ *                     DS or broadcast DS, from the poll function code); the
+ *                     result callback is called after each exchange. With
+ *                     twr_multi(), the exchanges of several initiators are
+ *                     interleaved, see NOTE below.
+ *          Broadcast: twr_start_bcast() ranges with several anchors at once:
+ *                     one poll, one response per anchor slot, one final.
+ *
+ *          The result callback is called from the DW IC interrupt context (the
+ *          ISR, or the deferred IRQ thread when built with DWM_IRQ_DEFERRED).
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _TWR_H_
+#define _TWR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+/* Addresses used by the ex_05x/ex_06x examples ('VE' initiator, 'WA' responder) */
+#define TWR_DEFAULT_PAN_ID          0xDECA
+#define TWR_DEFAULT_INIT_ADDR       0x4556
+#define TWR_DEFAULT_RESP_ADDR       0x4157
+#define TWR_BROADCAST_ADDR          0xFFFF
+
+/* Frame layout: 802.15.4 data frame, 16-bit addresses, PAN ID compression */
+#define TWR_MSG_SN_IDX              2
+#define TWR_MSG_PAN_IDX             3
+#define TWR_MSG_DST_IDX             5
+#define TWR_MSG_SRC_IDX             7
+#define TWR_MSG_FUNC_IDX            9
+#define TWR_MSG_COMMON_LEN          10
+
+/* Function codes */
+#define TWR_FUNC_SS_POLL            0xE0
+#define TWR_FUNC_SS_RESP            0xE1
+#define TWR_FUNC_DS_POLL            0x21
+#define TWR_FUNC_DS_RESP            0x10
+#define TWR_FUNC_DS_FINAL           0x23
+#define TWR_FUNC_BC_POLL            0x25
+#define TWR_FUNC_BC_RESP            0x11
+#define TWR_FUNC_BC_FINAL           0x27
+
+/* Payload indexes */
+#define TWR_SS_RESP_POLL_RX_TS_IDX  10
+#define TWR_SS_RESP_RESP_TX_TS_IDX  14
+#define TWR_DS_FINAL_POLL_TX_TS_IDX 10
+#define TWR_DS_FINAL_RESP_RX_TS_IDX 14
+#define TWR_DS_FINAL_FINAL_TX_TS_IDX 18
+
+/* Broadcast DS-TWR: the poll carries the slot length and the anchor list (slot order), the final the poll and final
+ * TX timestamps and, for each anchor that answered, its address and the response RX timestamp */
+#define TWR_BCAST_MAX_ANCHORS       8
+#define TWR_BC_POLL_COUNT_IDX       10
+#define TWR_BC_POLL_SLOT_IDX        11
+#define TWR_BC_POLL_ADDR_IDX        13
+#define TWR_BC_FINAL_POLL_TX_TS_IDX 10
+#define TWR_BC_FINAL_FINAL_TX_TS_IDX 14
+#define TWR_BC_FINAL_COUNT_IDX      18
+#define TWR_BC_FINAL_ENTRY_IDX      19
+#define TWR_BC_FINAL_ENTRY_LEN      (2 + FINAL_MSG_TS_LEN)
+#define TWR_BCAST_GUARD_UUS         250 /* time in a response slot for the tag to re-enable its receiver */
+
+/* longest frame handled (broadcast final, with FCS) */
+#define TWR_FRAME_LEN_MAX           (TWR_BC_FINAL_ENTRY_IDX + TWR_BCAST_MAX_ANCHORS * TWR_BC_FINAL_ENTRY_LEN + 2)
+
+typedef enum
+{
+    TWR_MODE_SS = 0,    /* single-sided: poll, response */
+    TWR_MODE_DS,        /* double-sided: poll, response, final */
+    TWR_MODE_DS_BCAST,  /* double-sided, one to many: broadcast poll, one response per anchor slot, final */
+    TWR_MODE_NUM
+} twr_mode_e;
+
+typedef enum
+{
+    TWR_ROLE_INITIATOR = 0,
+    TWR_ROLE_RESPONDER,
+} twr_role_e;
+
+typedef enum
+{
+    TWR_STATE_IDLE = 0,
+    TWR_STATE_WAIT_RESP,        /* initiator: poll sent, waiting for the response */
+    TWR_STATE_BCAST_WAIT_RESP,  /* initiator: broadcast poll sent, waiting for the responses */
+    TWR_STATE_WAIT_FINAL_TX,    /* initiator: DS final scheduled */
+    TWR_STATE_LISTEN,           /* responder: waiting for a poll */
+    TWR_STATE_WAIT_RESP_TX,     /* responder: SS response scheduled */
+    TWR_STATE_WAIT_FINAL,       /* responder: DS response scheduled, waiting for the final */
+} twr_state_e;
+
+typedef enum
+{
+    TWR_OK = 0,
+    TWR_ERR_TIMEOUT = -1,       /* no (expected) frame before the RX timeout */
+    TWR_ERR_RX = -2,            /* RX error */
+    TWR_ERR_LATE_TX = -3,       /* delayed TX time was already past (dwt_starttx() error) */
+    TWR_ERR_FRAME = -4,         /* unexpected frame */
+    TWR_ERR_BUSY = -5,          /* poll not sent, a preamble was detected (cca) */
+} twr_status_e;
+
+/* Phases of an initiator exchange, timed between the RMARKERs (device timestamps) */
+typedef enum
+{
+    TWR_PHASE_RESP = 0,         /* poll TX to response RX */
+    TWR_PHASE_FINAL,            /* DS: response RX to final TX */
+    TWR_PHASE_NUM
+} twr_phase_e;
+
+/* Engine configuration. Delays and timeouts in UWB microseconds, as in the examples (see their NOTES) */
+typedef struct
+{
+    uint16_t    pan_id;
+    uint16_t    addr;                           /* own short address */
+    uint16_t    tx_ant_dly;                     /* TX antenna delay, added to the predicted TX timestamps */
+    uint16_t    pre_timeout;                    /* preamble detection timeout for expected frames, in PACs */
+    /* initiator */
+    uint32_t    poll_tx_to_resp_rx_dly_uus;     /* poll TX end to RX enable */
+    uint32_t    resp_rx_timeout_uus;            /* response RX timeout */
+    uint32_t    resp_rx_to_final_tx_dly_uus;    /* DS: response RX to final TX */
+    uint8_t     sleep_after_final;              /* DS: the device enters sleep after the final TX, see NOTE below */
+    uint8_t     cca;                            /* SS/DS poll sent after a clear CCA, see NOTE below */
+    /* responder */
+    uint32_t    poll_rx_to_resp_tx_dly_uus;     /* poll RX to response TX */
+    uint32_t    resp_tx_to_final_rx_dly_uus;    /* DS: response TX end to RX enable */
+    uint32_t    final_rx_timeout_uus;           /* DS: final RX timeout */
+} twr_config_t;
+
+/* Result of one ranging exchange */
+typedef struct
+{
+    twr_status_e    status;
+    twr_role_e      role;
+    twr_mode_e      mode;
+    uint16_t        peer;       /* address of the other device */
+    uint8_t         seq;        /* sequence number of the poll */
+    uint8_t         has_tof;    /* tof/distance_mm are valid (SS initiator, DS responder) */
+    int32_t         tof;        /* time of flight, in 1/16 device time units (see ranging_math.h) */
+    int32_t         distance_mm;    /* distance, in mm */
+    uint32_t        phase_uus[TWR_PHASE_NUM];   /* initiator: phase durations, in UWB microseconds, 0 if not reached */
+    int16_t         clock_offset;   /* clock offset of the last frame from the peer (dwt_readclockoffset()), valid with
+                                     * TWR_OK except in broadcast mode */
+} twr_result_t;
+
+typedef void (*twr_result_cb_t)(const twr_result_t *result);
+
+/* NOTE: with sleep_after_final set, a DS-TWR initiator arms dwt_entersleepaftertx() and masks the TX done interrupt
+ * (an active IRQ line keeps the device awake) before scheduling the final, and reports TWR_OK as soon as the final is
+ * scheduled: the device goes to sleep by itself once the frame is sent, and the host must not access it before
+ * waking it up (dwt_wakeup_ic(), dwt_restoreconfig()). The next poll disarms the sleep and unmasks the interrupt.
+ * The device must be configured for sleep first (dwt_configuresleep()). SS-TWR exchanges and errors leave the device
+ * awake. */
+
+/* NOTE: with cca set, twr_start() sends the poll with DWT_START_TX_CCA: the CCA window is the preamble detection
+ * timeout of the response window (pre_timeout PACs, the register serves both), which then always opens at the learnt
+ * delay. A preamble detected within it cancels the poll and ends the exchange with TWR_ERR_BUSY; the caller backs off
+ * (e.g. mac_csma_busy()) and starts again. Delayed polls (twr_start_delayed(), the schedulers) are sent without CCA,
+ * their slot is the channel access. */
+
+/* NOTE: a responder in the multi-initiator mode (twr_multi()) keeps a session per DS exchange waiting for its final,
+ * keyed by the initiator address, with the poll RX and response TX timestamps and the final window (from the
+ * configured final RX delay and timeout). The receiver stays on between the response and the final for the polls of
+ * the other initiators and the finals of all the sessions; its timeout is the end of the earliest final window, which
+ * ends that session with TWR_ERR_TIMEOUT. A poll is answered when its response TX (the device cannot receive while a
+ * delayed TX is pending) and its final window do not overlap the final window of another session; otherwise it is not
+ * answered, the initiator times out and polls again (its next poll ends its previous session). SS results are
+ * reported as soon as the response is scheduled. With the tuning on, the response delays are tuned as usual; the final
+ * windows always use the configured delays. */
+
+#ifndef TWR_SESSIONS
+#define TWR_SESSIONS                8   /* multi-initiator responder: DS exchanges waiting for their final */
+#endif
+
+typedef struct
+{
+    uint32_t    polls;          /* polls received */
+    uint32_t    refused;        /* polls not answered, the exchange would overlap the final window of a session */
+    uint32_t    full;           /* polls not answered, no free session */
+    uint32_t    late_tx;        /* responses dwt_starttx() found late */
+    uint32_t    finals;         /* finals received, range computed */
+    uint32_t    timeouts;       /* sessions ended without their final */
+    uint8_t     active;         /* sessions waiting for their final */
+    uint8_t     max_active;     /* highest active */
+} twr_multi_t;
+
+/* Reply delay tuning (twr_autotune()), see twr.c */
+#define TWR_TUNE_LATE_STEP_UUS      50  /* reply delay increase after a late TX */
+#define TWR_TUNE_RX_GUARD_UUS       10  /* receiver enabled that long before the expected preamble */
+
+typedef enum
+{
+    TWR_TUNE_RESP = 0,          /* responder: poll RX to response TX (SS and DS, not broadcast) */
+    TWR_TUNE_FINAL,             /* DS initiator: response RX to final TX */
+    TWR_TUNE_NUM
+} twr_tune_e;
+
+typedef struct
+{
+    uint32_t    replies[TWR_TUNE_NUM];      /* delayed replies sent */
+    uint32_t    late_tx[TWR_TUNE_NUM];      /* replies dwt_starttx() found late */
+    uint16_t    latency_uus[TWR_TUNE_NUM];  /* RX timestamp to dwt_starttx(), peak (slowly decaying) */
+    uint16_t    latency_max_uus[TWR_TUNE_NUM];  /* RX timestamp to dwt_starttx(), highest seen */
+    uint16_t    reply_dly_uus[TWR_TUNE_NUM];    /* reply delay in use */
+    uint16_t    rx_dly_uus[TWR_TUNE_NUM];   /* RX enable delay in use for the peer reply (resp, final) */
+    uint32_t    rx_misses[TWR_TUNE_NUM];    /* peer reply timeouts, the receiver then opens right after TX */
+} twr_tune_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_default_config()
+ *
+ * @brief Fill a configuration with the addresses and timings of the DS-TWR examples (6.8 Mb/s, 128 preamble).
+ *
+ * @param cfg - configuration to fill
+ * @param role - selects the default address (TWR_DEFAULT_INIT_ADDR or TWR_DEFAULT_RESP_ADDR)
+ *
+ * @return none
+ */
+void twr_default_config(twr_config_t *cfg, twr_role_e role);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_init()
+ *
+ * @brief Set up the engine: register the driver callbacks and enable the TX/RX interrupts. The device must already be
+ *        initialised and configured, with the antenna delays set, and dwt_isr() installed (port_set_dwic_isr()).
+ *
+ * @param cfg - engine configuration (copied)
+ * @param cb - result callback
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters)
+ */
+int twr_init(const twr_config_t *cfg, twr_result_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_start()
+ *
+ * @brief Initiator: start a ranging exchange with a responder. The result callback is called when it is over.
+ *
+ * @param mode - TWR_MODE_SS or TWR_MODE_DS (see twr_start_bcast() for TWR_MODE_DS_BCAST)
+ * @param peer - responder address
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if an exchange is in progress
+ */
+int twr_start(twr_mode_e mode, uint16_t peer);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_start_delayed()
+ *
+ * @brief Initiator: as twr_start(), with the poll sent at a given device time (see dwt_setdelayedtrxtime()).
+ *
+ * @param mode - TWR_MODE_SS or TWR_MODE_DS
+ * @param peer - responder address
+ * @param tx_time - poll TX time, in units of 512 device time units (high 32 bits of the 40-bit system time)
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if an exchange is in progress or tx_time is already past (no result reported)
+ */
+int twr_start_delayed(twr_mode_e mode, uint16_t peer, uint32_t tx_time);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_start_bcast()
+ *
+ * @brief Initiator: start a broadcast DS-TWR exchange with several anchors, N + 2 frames instead of 3N. Anchor i
+ *        replies poll_rx_to_resp_tx_dly_uus + i * slot_uus after the poll, the final is sent
+ *        resp_rx_to_final_tx_dly_uus after the last slot. The result callback is called once per anchor when the
+ *        exchange is over (status only, the distances are computed by the anchors).
+ *
+ * @param anchors - anchor addresses, in slot order
+ * @param count - number of anchors, up to TWR_BCAST_MAX_ANCHORS
+ * @param slot_uus - response slot length, see twr_bcast_slot_uus()
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if an exchange is in progress or the parameters are wrong
+ */
+int twr_start_bcast(const uint16_t *anchors, uint8_t count, uint16_t slot_uus);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_bcast_slot_uus()
+ *
+ * @brief Return the default broadcast response slot length: response airtime plus TWR_BCAST_GUARD_UUS.
+ *
+ * @param config - device configuration
+ *
+ * @return slot length, in UWB microseconds
+ */
+uint16_t twr_bcast_slot_uus(const dwt_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_listen()
+ *
+ * @brief Responder: answer the polls addressed to this device (or broadcast polls listing it) until twr_stop() is
+ *        called.
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if an exchange is in progress
+ */
+int twr_listen(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_stop()
+ *
+ * @brief Abort any exchange, turn the transceiver off and leave the engine idle. No result is reported.
+ *
+ * @return none
+ */
+void twr_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_get_state()
+ *
+ * @brief Return the engine state.
+ *
+ * @return state
+ */
+twr_state_e twr_get_state(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_frame_airtime_uus()
+ *
+ * @brief Return the on-air duration of a frame: preamble, SFD, STS, PHR and data (with the Reed-Solomon parity). Read
+ *        from the timing table when config is the one of a profile applied with phy_timing_apply(), see phy_timing.h.
+ *
+ * @param config - device configuration
+ * @param len - frame length, including the FCS
+ *
+ * @return duration, in UWB microseconds (rounded up)
+ */
+uint32_t twr_frame_airtime_uus(const dwt_config_t *config, uint16_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_exchange_uus()
+ *
+ * @brief Return the duration of an exchange, from the start of the poll to the end of the last frame.
+ *
+ * @param cfg - engine configuration (reply delays)
+ * @param config - device configuration
+ * @param mode - TWR_MODE_SS or TWR_MODE_DS
+ *
+ * @return duration, in UWB microseconds
+ */
+uint32_t twr_exchange_uus(const twr_config_t *cfg, const dwt_config_t *config, twr_mode_e mode);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_autotune()
+ *
+ * @brief Enable or disable the reply delay tuning. When enabled, the engine measures the host turnaround (RX timestamp
+ *        to dwt_starttx()) of each delayed reply. It then uses the shortest delay it can safely program: the peak
+ *        turnaround plus the SHR duration and the margin. The delays from the configuration stay the upper bound.
+ *        Each late TX adds TWR_TUNE_LATE_STEP_UUS to the margin, which slowly decays back afterwards.
+ *
+ *        The receiver windows for the peer replies are also learnt from the timestamps. They start
+ *        TWR_TUNE_RX_GUARD_UUS before the expected preamble and end where the configured window ends, so a peer with
+ *        shorter (tuned) delays is still received. After a timeout, the next window opens right after the TX, without
+ *        the preamble detection timeout. Broadcast exchanges always use the configured delays.
+ *
+ *        Call when the engine is idle, after twr_init().
+ *
+ * @param config - device configuration (frame durations), NULL to disable the tuning
+ * @param margin_uus - margin added to the measured turnaround
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the engine is not idle
+ */
+int twr_autotune(const dwt_config_t *config, uint16_t margin_uus);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_get_tune()
+ *
+ * @brief Return the reply delay tuning state and counters.
+ *
+ * @return tuning state
+ */
+const twr_tune_t * twr_get_tune(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_multi()
+ *
+ * @brief Enable or disable the multi-initiator responder mode (see NOTE above): twr_listen() then interleaves the
+ *        exchanges of up to TWR_SESSIONS initiators. Clears the sessions and the counters. Call when the engine is
+ *        idle, after twr_init().
+ *
+ * @param config - device configuration (frame durations), NULL to disable the mode
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the engine is not idle
+ */
+int twr_multi(const dwt_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_get_multi()
+ *
+ * @brief Return the multi-initiator responder counters.
+ *
+ * @return counters
+ */
+const twr_multi_t * twr_get_multi(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TWR_H_ */
@@ -0,0 +1,188 @@
+/*! ----------------------------------------------------------------------------
+ * @file    twr_energy.c
+ * @brief   Energy per range model of a low-power ranging tag
+ *
+ *          See twr_energy.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_vals.h>
+#include <shared_defines.h>
+#include <twr.h>
+#include <twr_energy.h>
+
+static struct
+{
+    twr_energy_model_t  model;
+    uint32_t            rx_dly_uus;         /* poll TX end to RX enable */
+    uint32_t            rx_timeout_uus;     /* response RX timeout */
+    uint32_t            poll_uus;           /* frame airtimes */
+    uint32_t            ss_resp_uus;
+    uint32_t            ds_resp_uus;
+    uint32_t            final_uus;
+    twr_energy_range_t  range;
+    twr_energy_totals_t totals;
+} energy;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_charge_nc()
+ *
+ * @brief Return the charge drawn in a state for a duration.
+ *
+ * @param state - device state
+ * @param us - duration, in microseconds
+ *
+ * @return charge, in nC (rounded)
+ */
+static uint32_t twr_energy_charge_nc(twr_energy_state_e state, uint32_t us)
+{
+    /* nA x us = fC */
+    return (uint32_t)(((uint64_t)energy.model.current_na[state] * us + 500000) / 1000000);
+}
+
+void twr_energy_default_model(twr_energy_model_t *model)
+{
+    model->current_na[TWR_ENERGY_SLEEP] = 500;
+    model->current_na[TWR_ENERGY_WAKE] = 4000000;
+    model->current_na[TWR_ENERGY_IDLE] = 12000000;
+    model->current_na[TWR_ENERGY_TX] = 35000000;
+    model->current_na[TWR_ENERGY_RX] = 55000000;
+}
+
+int twr_energy_init(const twr_energy_model_t *model, const dwt_config_t *config, const twr_config_t *cfg)
+{
+    if ((model == NULL) || (config == NULL) || (cfg == NULL))
+    {
+        return DWT_ERROR;
+    }
+
+    energy.model = *model;
+    energy.rx_dly_uus = cfg->poll_tx_to_resp_rx_dly_uus;
+    energy.rx_timeout_uus = cfg->resp_rx_timeout_uus;
+    energy.poll_uus = twr_frame_airtime_uus(config, TWR_MSG_COMMON_LEN + FCS_LEN);
+    energy.ss_resp_uus = twr_frame_airtime_uus(config, TWR_SS_RESP_RESP_TX_TS_IDX + RESP_MSG_TS_LEN + FCS_LEN);
+    energy.ds_resp_uus = twr_frame_airtime_uus(config, TWR_MSG_COMMON_LEN + 3 + FCS_LEN);
+    energy.final_uus = twr_frame_airtime_uus(config, TWR_DS_FINAL_FINAL_TX_TS_IDX + FINAL_MSG_TS_LEN + FCS_LEN);
+
+    memset(&energy.range, 0, sizeof(energy.range));
+    twr_energy_clear();
+
+    return DWT_SUCCESS;
+}
+
+void twr_energy_begin(void)
+{
+    memset(&energy.range, 0, sizeof(energy.range));
+}
+
+void twr_energy_add(twr_energy_state_e state, uint32_t us)
+{
+    if (state < TWR_ENERGY_NUM)
+    {
+        energy.range.us[state] += us;
+    }
+}
+
+uint32_t twr_energy_exchange(const twr_result_t *result, uint32_t active_us)
+{
+    uint32_t resp_uus = (result->mode == TWR_MODE_SS) ? energy.ss_resp_uus : energy.ds_resp_uus;
+    uint32_t tx_us = energy.poll_uus;
+    uint32_t rx_us;
+    uint32_t span_us;
+
+    if (result->phase_uus[TWR_PHASE_RESP] != 0)
+    {
+        /* The phase runs between the RMARKERs, i.e. from the poll start to the response start plus the preamble:
+         * the RX is on from the poll end plus the RX delay to the response end. */
+        span_us = result->phase_uus[TWR_PHASE_RESP] + resp_uus;
+        if (span_us >= energy.poll_uus + energy.rx_dly_uus + resp_uus)
+        {
+            rx_us = span_us - energy.poll_uus - energy.rx_dly_uus;
+        }
+        else
+        {
+            /* the receiver opened later than configured (reply delay tuning) */
+            rx_us = resp_uus;
+        }
+
+        if (result->phase_uus[TWR_PHASE_FINAL] != 0)
+        {
+            /* final scheduled: it ends the exchange */
+            span_us = result->phase_uus[TWR_PHASE_RESP] + result->phase_uus[TWR_PHASE_FINAL] + energy.final_uus;
+            tx_us += energy.final_uus;
+        }
+    }
+    else
+    {
+        /* no response: the receiver was on for the whole timeout (or until the RX error) */
+        rx_us = energy.rx_timeout_uus;
+        span_us = energy.poll_uus + energy.rx_dly_uus + energy.rx_timeout_uus;
+    }
+
+    if (span_us < active_us)
+    {
+        span_us = active_us;
+    }
+
+    energy.range.us[TWR_ENERGY_TX] += tx_us;
+    energy.range.us[TWR_ENERGY_RX] += rx_us;
+    energy.range.us[TWR_ENERGY_IDLE] += (span_us > tx_us + rx_us) ? (span_us - tx_us - rx_us) : 0;
+
+    return span_us;
+}
+
+const twr_energy_range_t * twr_energy_end(twr_status_e status)
+{
+    twr_energy_range_t *r = &energy.range;
+    int i;
+
+    r->status = status;
+    r->total_us = 0;
+    r->total_nc = 0;
+    for (i = 0; i < TWR_ENERGY_NUM; i++)
+    {
+        r->nc[i] = twr_energy_charge_nc((twr_energy_state_e)i, r->us[i]);
+        r->total_us += r->us[i];
+        r->total_nc += r->nc[i];
+
+        energy.totals.us[i] += r->us[i];
+        energy.totals.nc[i] += r->nc[i];
+    }
+
+    energy.totals.ranges++;
+    if (status == TWR_OK)
+    {
+        energy.totals.ok++;
+    }
+    energy.totals.total_us += r->total_us;
+    energy.totals.total_nc += r->total_nc;
+
+    return r;
+}
+
+const twr_energy_totals_t * twr_energy_get_totals(void)
+{
+    return &energy.totals;
+}
+
+uint32_t twr_energy_avg_na(void)
+{
+    if (energy.totals.total_us == 0)
+    {
+        return 0;
+    }
+
+    /* nC / us = mA */
+    return (uint32_t)(energy.totals.total_nc * 1000000 / energy.totals.total_us);
+}
+
+void twr_energy_clear(void)
+{
+    memset(&energy.totals, 0, sizeof(energy.totals));
+}
@@ -0,0 +1,179 @@
+/*! ----------------------------------------------------------------------------
+ * @file    twr_energy.h
+ * @brief   Energy per range model of a low-power ranging tag
+ *
+ *          Estimates the DW3000 charge of each ranging cycle (sleep, wake-up,
+ *          exchange) from the time spent in each device state and a current
+ *          per state. The application measures the sleep and wake-up times
+ *          with the host timer; the exchange is split into TX, RX and idle
+ *          time from the engine result (twr.h phase times), the configured
+ *          delays and the frame airtime.
+ *
+ *          The default currents are typical DW3000 figures at 3.3 V on
+ *          channel 5 and only give orders of magnitude: replace them with the
+ *          board measurements (twr_energy_init()). The host MCU is not
+ *          modelled.
+ *
+ *          Charges are in nC (uA x ms), the average current in nA: the
+ *          battery life is its capacity over the average current.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _TWR_ENERGY_H_
+#define _TWR_ENERGY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+#include <twr.h>
+
+/* Device states of a ranging cycle */
+typedef enum
+{
+    TWR_ENERGY_SLEEP = 0,       /* SLEEP (or DEEPSLEEP) between ranges */
+    TWR_ENERGY_WAKE,            /* wake-up: INIT_RC, IDLE_RC and the configuration restore */
+    TWR_ENERGY_IDLE,            /* IDLE_PLL during the exchange, between frames */
+    TWR_ENERGY_TX,              /* transmitting */
+    TWR_ENERGY_RX,              /* receiver on, listening or receiving */
+    TWR_ENERGY_NUM
+} twr_energy_state_e;
+
+/* Current drawn in each state, in nA */
+typedef struct
+{
+    uint32_t    current_na[TWR_ENERGY_NUM];
+} twr_energy_model_t;
+
+/* One ranging cycle */
+typedef struct
+{
+    twr_status_e    status;                     /* exchange status */
+    uint32_t        us[TWR_ENERGY_NUM];         /* time in each state */
+    uint32_t        nc[TWR_ENERGY_NUM];         /* charge of each state */
+    uint32_t        total_us;
+    uint32_t        total_nc;
+} twr_energy_range_t;
+
+/* Sums since twr_energy_init() or twr_energy_clear() */
+typedef struct
+{
+    uint32_t    ranges;
+    uint32_t    ok;                             /* ranges with a TWR_OK exchange */
+    uint64_t    us[TWR_ENERGY_NUM];
+    uint64_t    nc[TWR_ENERGY_NUM];
+    uint64_t    total_us;
+    uint64_t    total_nc;
+} twr_energy_totals_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_default_model()
+ *
+ * @brief Fill a model with typical DW3000 currents (3.3 V, channel 5): sleep 0.5 uA, wake-up 4 mA, IDLE_PLL 12 mA,
+ *        TX 35 mA, RX 55 mA.
+ *
+ * @param model - model to fill
+ *
+ * @return none
+ */
+void twr_energy_default_model(twr_energy_model_t *model);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_init()
+ *
+ * @brief Set the model and the exchange timings, and clear the totals.
+ *
+ * @param model - currents (copied)
+ * @param config - device configuration, for the frame airtime
+ * @param cfg - TWR engine configuration of the tag, for the RX delay and timeout
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters)
+ */
+int twr_energy_init(const twr_energy_model_t *model, const dwt_config_t *config, const twr_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_begin()
+ *
+ * @brief Start the record of a ranging cycle.
+ *
+ * @return none
+ */
+void twr_energy_begin(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_add()
+ *
+ * @brief Add a measured state duration to the current cycle.
+ *
+ * @param state - device state
+ * @param us - duration, in microseconds
+ *
+ * @return none
+ */
+void twr_energy_add(twr_energy_state_e state, uint32_t us);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_exchange()
+ *
+ * @brief Add an initiator exchange to the current cycle. The TX time is the poll airtime (and the final airtime if it
+ *        was sent), the RX time runs from the RX enable to the end of the response (or for the whole RX timeout if no
+ *        response came), the rest of the exchange is IDLE_PLL. The exchange lasts the longer of active_us and its
+ *        device time from the phase times, which does not include the host latency to report the result (SS-TWR) and
+ *        goes on after the report when the final is still scheduled (DS-TWR with sleep_after_final).
+ *
+ * @param result - exchange result
+ * @param active_us - host time from twr_start() to the result (or to dwt_entersleep()), in microseconds
+ *
+ * @return exchange duration, in microseconds: the part over active_us overlaps the host measured sleep time
+ */
+uint32_t twr_energy_exchange(const twr_result_t *result, uint32_t active_us);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_end()
+ *
+ * @brief Close the current cycle: compute its charge and add it to the totals.
+ *
+ * @param status - exchange status of the cycle
+ *
+ * @return cycle record, valid until the next twr_energy_begin()
+ */
+const twr_energy_range_t * twr_energy_end(twr_status_e status);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_get_totals()
+ *
+ * @brief Return the sums of the closed cycles.
+ *
+ * @return totals
+ */
+const twr_energy_totals_t * twr_energy_get_totals(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_avg_na()
+ *
+ * @brief Return the average current over the closed cycles.
+ *
+ * @return average current, in nA (0 if no time was recorded)
+ */
+uint32_t twr_energy_avg_na(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_energy_clear()
+ *
+ * @brief Clear the totals.
+ *
+ * @return none
+ */
+void twr_energy_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TWR_ENERGY_H_ */
@@ -0,0 +1,195 @@
+/*! ----------------------------------------------------------------------------
+ * @file    twr_sched.c
+ * @brief   TDMA ranging scheduler: one tag (initiator) and N anchors (responders)
+ *
+ *          See twr_sched.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <shared_defines.h>
+#include <twr.h>
+#include <twr_sched.h>
+
+static struct
+{
+    twr_mode_e              mode;
+    uint16_t                anchors[TWR_SCHED_MAX_ANCHORS];
+    uint8_t                 count;
+    uint32_t                slot_uus;
+    twr_sched_round_cb_t    cb;
+    volatile uint8_t        busy;
+    uint8_t                 slot;           /* current slot */
+    uint32_t                round_start;    /* TX time of the first poll, in 512 dtu units */
+    twr_sched_round_t       round;
+    twr_sched_stats_t       stats[TWR_SCHED_MAX_ANCHORS];
+} sched;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_slot_time()
+ *
+ * @brief Return the poll TX time of a slot.
+ *
+ * @param slot - slot index in the round
+ *
+ * @return TX time, in 512 dtu units (wraps with the system time)
+ */
+static uint32_t twr_sched_slot_time(uint8_t slot)
+{
+    return sched.round_start + (uint32_t)(((uint64_t)slot * sched.slot_uus * UUS_TO_DWT_TIME) >> 8);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_next()
+ *
+ * @brief Start the poll of the next slot with a poll on time, skipping (as late) those already past; report the
+ *        round once the last slot is over.
+ *
+ * @return none
+ */
+static void twr_sched_next(void)
+{
+    while (sched.slot < sched.count)
+    {
+        uint8_t idx = sched.slot;
+
+        sched.stats[idx].polls++;
+        if (twr_start_delayed(sched.mode, sched.anchors[idx], twr_sched_slot_time(idx)) == DWT_SUCCESS)
+        {
+            return;
+        }
+
+        /* Slot missed */
+        sched.stats[idx].late_tx++;
+        memset(&sched.round.result[idx], 0, sizeof(sched.round.result[idx]));
+        sched.round.result[idx].status = TWR_ERR_LATE_TX;
+        sched.round.result[idx].role = TWR_ROLE_INITIATOR;
+        sched.round.result[idx].mode = sched.mode;
+        sched.round.result[idx].peer = sched.anchors[idx];
+        sched.slot++;
+    }
+
+    sched.busy = 0;
+    if (sched.cb != NULL)
+    {
+        sched.cb(&sched.round);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_result_cb()
+ *
+ * @brief TWR engine result callback: record the slot result and go on with the next slot.
+ *
+ * @param result - exchange result
+ *
+ * @return none
+ */
+static void twr_sched_result_cb(const twr_result_t *result)
+{
+    twr_sched_stats_t *stats;
+
+    if (!sched.busy || (sched.slot >= sched.count))
+    {
+        return;
+    }
+
+    stats = &sched.stats[sched.slot];
+    sched.round.result[sched.slot] = *result;
+
+    switch (result->status)
+    {
+        case TWR_OK:
+            stats->ok++;
+            if (result->has_tof)
+            {
+                stats->last_distance_mm = result->distance_mm;
+            }
+            break;
+        case TWR_ERR_TIMEOUT:
+            stats->timeouts++;
+            break;
+        case TWR_ERR_RX:
+            stats->rx_errors++;
+            break;
+        case TWR_ERR_LATE_TX:
+            stats->late_tx++;
+            break;
+        default:
+            stats->frame_errors++;
+            break;
+    }
+
+    sched.slot++;
+    twr_sched_next();
+}
+
+int twr_sched_init(const twr_config_t *cfg, const dwt_config_t *config, twr_mode_e mode,
+                   const uint16_t *anchors, uint8_t count, twr_sched_round_cb_t cb)
+{
+    if ((count == 0) || (count > TWR_SCHED_MAX_ANCHORS) || sched.busy)
+    {
+        return DWT_ERROR;
+    }
+
+    if (twr_init(cfg, twr_sched_result_cb) != DWT_SUCCESS)
+    {
+        return DWT_ERROR;
+    }
+
+    sched.mode = mode;
+    memcpy(sched.anchors, anchors, count * sizeof(anchors[0]));
+    sched.count = count;
+    sched.cb = cb;
+    sched.slot_uus = twr_exchange_uus(cfg, config, mode) + TWR_SCHED_GUARD_UUS;
+    twr_sched_reset_stats();
+
+    return DWT_SUCCESS;
+}
+
+void twr_sched_set_slot_uus(uint32_t slot_uus)
+{
+    sched.slot_uus = slot_uus;
+}
+
+uint32_t twr_sched_get_slot_uus(void)
+{
+    return sched.slot_uus;
+}
+
+int twr_sched_start_round(void)
+{
+    if (sched.busy || (twr_get_state() != TWR_STATE_IDLE))
+    {
+        return DWT_ERROR;
+    }
+
+    sched.busy = 1;
+    sched.slot = 0;
+    sched.round.count = sched.count;
+    sched.round_start = dwt_readsystimestamphi32() + (uint32_t)(((uint64_t)TWR_SCHED_LEAD_UUS * UUS_TO_DWT_TIME) >> 8);
+
+    twr_sched_next();
+
+    return DWT_SUCCESS;
+}
+
+int twr_sched_busy(void)
+{
+    return sched.busy;
+}
+
+const twr_sched_stats_t * twr_sched_get_stats(uint8_t idx)
+{
+    return (idx < sched.count) ? &sched.stats[idx] : NULL;
+}
+
+void twr_sched_reset_stats(void)
+{
+    memset(sched.stats, 0, sizeof(sched.stats));
+}
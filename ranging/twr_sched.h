@@ -0,0 +1,141 @@
+/*! ----------------------------------------------------------------------------
+ * @file    twr_sched.h
+ * @brief   TDMA ranging scheduler: one tag (initiator) and N anchors (responders)
+ *
+ *          A round ranges the tag against every anchor of a list in back to
+ *          back slots. Each poll is sent with dwt_setdelayedtrxtime() at the
+ *          start of its slot, the slots being sized from the reply delays and
+ *          the frame airtime (twr_exchange_uus()) plus a guard time for the
+ *          host to handle the end of the exchange.
+ *
+ *          The scheduler drives the TWR engine (twr.h) and owns its result
+ *          callback; the round callback is called from the DW IC interrupt
+ *          context once the last slot is over.
+ *
+ *          With TWR_MODE_SS the distances are computed on the tag. With
+ *          TWR_MODE_DS they are computed on the anchors (the tag gets the
+ *          exchange status only).
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _TWR_SCHED_H_
+#define _TWR_SCHED_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+#include <twr.h>
+
+#define TWR_SCHED_MAX_ANCHORS   8
+#define TWR_SCHED_GUARD_UUS     300     /* default time after an exchange for the host to program the next poll */
+#define TWR_SCHED_LEAD_UUS      500     /* time from twr_sched_start_round() to the first poll */
+
+/* Per anchor statistics */
+typedef struct
+{
+    uint32_t    polls;          /* exchanges started */
+    uint32_t    ok;             /* exchanges completed */
+    uint32_t    timeouts;
+    uint32_t    rx_errors;
+    uint32_t    frame_errors;
+    uint32_t    late_tx;        /* slots missed: the poll or final TX time was already past */
+    int32_t     last_distance_mm;   /* last distance measured (SS only), in mm */
+} twr_sched_stats_t;
+
+/* Results of a round, in anchor list order */
+typedef struct
+{
+    uint8_t         count;
+    twr_result_t    result[TWR_SCHED_MAX_ANCHORS];
+} twr_sched_round_t;
+
+typedef void (*twr_sched_round_cb_t)(const twr_sched_round_t *round);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_init()
+ *
+ * @brief Set up the scheduler and the TWR engine (twr_init()). The slot length is computed from the engine reply
+ *        delays and the device configuration, plus TWR_SCHED_GUARD_UUS.
+ *
+ * @param cfg - TWR engine configuration of the tag (the anchors must use the same reply delays)
+ * @param config - device configuration, for the frame airtime
+ * @param mode - TWR_MODE_SS or TWR_MODE_DS
+ * @param anchors - anchor addresses (copied)
+ * @param count - number of anchors, up to TWR_SCHED_MAX_ANCHORS
+ * @param cb - round callback
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters)
+ */
+int twr_sched_init(const twr_config_t *cfg, const dwt_config_t *config, twr_mode_e mode,
+                   const uint16_t *anchors, uint8_t count, twr_sched_round_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_set_slot_uus()
+ *
+ * @brief Override the slot length.
+ *
+ * @param slot_uus - slot length, in UWB microseconds
+ *
+ * @return none
+ */
+void twr_sched_set_slot_uus(uint32_t slot_uus);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_get_slot_uus()
+ *
+ * @brief Return the slot length (the round lasts count slots).
+ *
+ * @return slot length, in UWB microseconds
+ */
+uint32_t twr_sched_get_slot_uus(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_start_round()
+ *
+ * @brief Start a round: the first poll is sent TWR_SCHED_LEAD_UUS later, then one per slot.
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if a round is in progress
+ */
+int twr_sched_start_round(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_busy()
+ *
+ * @brief Return whether a round is in progress.
+ *
+ * @return 1 if busy, 0 otherwise
+ */
+int twr_sched_busy(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_get_stats()
+ *
+ * @brief Return the statistics of an anchor.
+ *
+ * @param idx - index in the anchor list
+ *
+ * @return statistics, or NULL if idx is out of range
+ */
+const twr_sched_stats_t * twr_sched_get_stats(uint8_t idx);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn twr_sched_reset_stats()
+ *
+ * @brief Clear the statistics of all anchors.
+ *
+ * @return none
+ */
+void twr_sched_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TWR_SCHED_H_ */
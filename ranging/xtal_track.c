@@ -0,0 +1,195 @@
+/*! ----------------------------------------------------------------------------
+ * @file    xtal_track.c
+ * @brief   Closed-loop crystal trim tracking against a reference peer
+ *
+ *          See xtal_track.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_vals.h>
+#include <port.h>
+#include <xtal_track.h>
+
+static struct
+{
+    xtal_track_config_t cfg;
+    int32_t             sum;            /* clock offsets of the window, in 2^-26 units */
+    uint8_t             count;          /* samples in the window */
+    uint8_t             settle;         /* samples still to drop */
+    uint8_t             in_band;        /* windows in a row within the band */
+    xtal_track_state_t  st;
+} track;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xtal_track_ppb()
+ *
+ * @brief Convert a clock offset to ppb.
+ *
+ * @param clock_offset - clock offset, in 2^-26 units (the sum of several)
+ *
+ * @return offset, in ppb
+ */
+static int32_t xtal_track_ppb(int32_t clock_offset)
+{
+    return (int32_t)(((int64_t)clock_offset * 1000000000) / (1 << 26));
+}
+
+void xtal_track_default_config(xtal_track_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->ref_addr = XTAL_TRACK_ANY_PEER;
+    cfg->target_ppb = 0;
+    cfg->band_ppb = 1000;
+    cfg->step_ppb = 1200;
+    cfg->outlier_ppb = 50000;
+    cfg->window = 8;
+    cfg->settle = 2;
+    cfg->converge_windows = 4;
+    cfg->save = 1;
+}
+
+int xtal_track_init(const xtal_track_config_t *cfg)
+{
+    uint8_t trim;
+
+    if ((cfg == NULL) || (cfg->window == 0) || (cfg->step_ppb == 0) || (cfg->band_ppb < cfg->step_ppb / 2))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&track, 0, sizeof(track));
+    track.cfg = *cfg;
+
+    if ((port_setting_load(XTAL_TRACK_SETTING_NAME, &trim, sizeof(trim)) == 0) && (trim <= XTAL_TRIM_BIT_MASK))
+    {
+        track.st.saved_trim = trim;
+        track.st.has_saved = 1;
+        dwt_setxtaltrim(trim);
+    }
+    track.st.trim = dwt_getxtaltrim();
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xtal_track_converged()
+ *
+ * @brief Window within the band: count it, and save the trim once converged.
+ *
+ * @return none
+ */
+static void xtal_track_converged(void)
+{
+    if (track.in_band < track.cfg.converge_windows)
+    {
+        track.in_band++;
+    }
+    if (track.in_band < track.cfg.converge_windows)
+    {
+        return;
+    }
+
+    track.st.converged = 1;
+    if (track.cfg.save && (!track.st.has_saved || (track.st.saved_trim != track.st.trim)))
+    {
+        /* tried once per convergence: a failing backend does not write on every window */
+        track.st.saved_trim = track.st.trim;
+        track.st.has_saved = 1;
+        if (port_setting_save(XTAL_TRACK_SETTING_NAME, &track.st.trim, sizeof(track.st.trim)) == 0)
+        {
+            track.st.saves++;
+        }
+    }
+}
+
+int xtal_track_push(uint16_t peer, int16_t clock_offset)
+{
+    int32_t err;
+    int32_t codes;
+    int32_t trim;
+
+    if ((track.cfg.ref_addr != XTAL_TRACK_ANY_PEER) && (peer != track.cfg.ref_addr))
+    {
+        track.st.drops++;
+        return 0;
+    }
+
+    err = xtal_track_ppb(clock_offset) - track.cfg.target_ppb;
+    if ((track.settle != 0) || (err > (int32_t)track.cfg.outlier_ppb) || (err < -(int32_t)track.cfg.outlier_ppb))
+    {
+        if (track.settle != 0)
+        {
+            track.settle--;
+        }
+        track.st.drops++;
+        return 0;
+    }
+
+    track.st.samples++;
+    track.sum += clock_offset;
+    if (++track.count < track.cfg.window)
+    {
+        return 0;
+    }
+
+    track.st.mean_ppb = xtal_track_ppb(track.sum) / track.count;
+    track.st.windows++;
+    track.sum = 0;
+    track.count = 0;
+
+    err = track.st.mean_ppb - track.cfg.target_ppb;
+    if ((err <= (int32_t)track.cfg.band_ppb) && (err >= -(int32_t)track.cfg.band_ppb))
+    {
+        xtal_track_converged();
+        return 0;
+    }
+
+    /* Local clock slower than the target (err > 0): lower the trim, at least one step out of the band */
+    codes = (err >= 0) ? (err + (int32_t)track.cfg.step_ppb / 2) / (int32_t)track.cfg.step_ppb :
+                         (err - (int32_t)track.cfg.step_ppb / 2) / (int32_t)track.cfg.step_ppb;
+    if (codes == 0)
+    {
+        codes = (err > 0) ? 1 : -1;
+    }
+
+    trim = (int32_t)track.st.trim - codes;
+    if (trim < 0)
+    {
+        trim = 0;
+    }
+    else if (trim > XTAL_TRIM_BIT_MASK)
+    {
+        trim = XTAL_TRIM_BIT_MASK;
+    }
+
+    track.in_band = 0;
+    track.st.converged = 0;
+    if ((uint8_t)trim == track.st.trim)
+    {
+        /* end of the trim range */
+        return 0;
+    }
+
+    dwt_setxtaltrim((uint8_t)trim);
+    track.st.trim = (uint8_t)trim;
+    track.st.changes++;
+    track.settle = track.cfg.settle;
+
+    return 1;
+}
+
+void xtal_track_apply(void)
+{
+    dwt_setxtaltrim(track.st.trim);
+}
+
+const xtal_track_state_t * xtal_track_get_state(void)
+{
+    return &track.st;
+}
@@ -0,0 +1,141 @@
+/*! ----------------------------------------------------------------------------
+ * @file    xtal_track.h
+ * @brief   Closed-loop crystal trim tracking against a reference peer
+ *
+ *          Keeps the local crystal at a fixed offset (usually 0) from the
+ *          crystal of a reference peer, as ex_02f does in its loop, from the
+ *          clock offset of the frames received from it (dwt_readclockoffset(),
+ *          e.g. twr_result_t.clock_offset):
+ *           - the samples of the reference peer are averaged over a window,
+ *             samples far from the target are dropped (wrong sender, bad
+ *             carrier lock),
+ *           - the trim is only changed when the window mean is out of a dead
+ *             band around the target: the band is at least half a trim step,
+ *             so that the trim does not toggle between two codes,
+ *           - after a change the next samples are dropped (frames in flight
+ *             measured with the old trim) and a new window starts,
+ *           - after converge_windows windows in a row within the band the
+ *             trim is converged and saved (port_setting_save(), only when it
+ *             differs from the saved one), xtal_track_init() applies it at the
+ *             next boot: the first ranges start close to the reference and the
+ *             loop only has the drift since then to follow.
+ *
+ *          Aligned crystals take the clock offset error out of SS-TWR and
+ *          shorten the TDoA clock model re-acquisition after a wake-up.
+ *
+ *          Frequencies in ppb, with the sign of dwt_readclockoffset(): > 0 when
+ *          the local clock is slower than the peer's. A slower crystal needs a
+ *          lower trim code (less load capacitance).
+ *
+ *          The trim is written from xtal_track_push(), which does one SPI
+ *          write at most: it can be called from the TWR result callback. Do
+ *          not also let dw_tempcomp.h follow its crystal model (xtal_comp), the
+ *          two would fight over the trim.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _XTAL_TRACK_H_
+#define _XTAL_TRACK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define XTAL_TRACK_ANY_PEER         0xFFFF      /* ref_addr: track every peer (a single reference in range) */
+#define XTAL_TRACK_SETTING_NAME     "xtal_trim"
+
+/* Tracking configuration */
+typedef struct
+{
+    uint16_t    ref_addr;           /* reference peer short address, or XTAL_TRACK_ANY_PEER */
+    int32_t     target_ppb;         /* clock offset to keep to the reference */
+    uint32_t    band_ppb;           /* dead band: no trim change while the window mean is within target +/- band */
+    uint32_t    step_ppb;           /* frequency change per trim code step */
+    uint32_t    outlier_ppb;        /* samples further than this from the target are dropped */
+    uint8_t     window;             /* samples averaged per decision */
+    uint8_t     settle;             /* samples dropped after a trim change */
+    uint8_t     converge_windows;   /* windows in a row within the band to declare the trim converged */
+    uint8_t     save;               /* save the converged trim in the settings */
+} xtal_track_config_t;
+
+/* Tracking state */
+typedef struct
+{
+    uint8_t     trim;               /* trim in use */
+    uint8_t     saved_trim;         /* trim in the settings (valid with has_saved) */
+    uint8_t     has_saved;
+    uint8_t     converged;          /* the trim has been within the band for converge_windows windows */
+    int32_t     mean_ppb;           /* last window mean */
+    uint32_t    samples;            /* samples used */
+    uint32_t    drops;              /* samples dropped: other peer, outlier or settling */
+    uint32_t    windows;
+    uint32_t    changes;            /* trim changes */
+    uint32_t    saves;              /* settings writes */
+} xtal_track_state_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xtal_track_default_config()
+ *
+ * @brief Fill a configuration: any peer, 0 ppm target, 1 ppm dead band, 1.2 ppm per trim step, 50 ppm outliers,
+ *        windows of 8 samples, 2 samples settling, converged after 4 windows, saved.
+ *
+ * @param cfg - configuration to fill
+ *
+ * @return none
+ */
+void xtal_track_default_config(xtal_track_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xtal_track_init()
+ *
+ * @brief Start tracking from the saved trim if there is one (it is then written), or from the trim in use (OTP or
+ *        default one). Call after dwt_initialise().
+ *
+ * @param cfg - configuration (copied)
+ *
+ * @return DWT_SUCCESS or DWT_ERROR (bad parameters: empty window, zero step or a band below half a step)
+ */
+int xtal_track_init(const xtal_track_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xtal_track_push()
+ *
+ * @brief Add the clock offset of a frame received from a peer, and adjust the trim at the end of a window.
+ *
+ * @param peer - short address of the sender
+ * @param clock_offset - clock offset of the frame (dwt_readclockoffset(), 2^-26 units)
+ *
+ * @return 1 if the trim changed, 0 if not
+ */
+int xtal_track_push(uint16_t peer, int16_t clock_offset);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xtal_track_apply()
+ *
+ * @brief Write the tracked trim again, after a dwt_initialise() (which loads the OTP trim) or a device reset.
+ *
+ * @return none
+ */
+void xtal_track_apply(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn xtal_track_get_state()
+ *
+ * @brief Return the tracking state.
+ *
+ * @return state
+ */
+const xtal_track_state_t * xtal_track_get_state(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _XTAL_TRACK_H_ */
@@ -0,0 +1,108 @@
+/*! ----------------------------------------------------------------------------
+ * @file    chan_hop.c
+ * @brief   Pseudo-random hopping between channel 5 and channel 9
+ *
+ *          See chan_hop.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <chan_hop.h>
+
+static struct
+{
+    chan_hop_config_t   cfg;
+    dwt_chanhop_t       hop;
+    chan_hop_stats_t    stats;
+} chop;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn chan_hop_hash()
+ *
+ * @brief Mix the seed and the slot number (32-bit integer hash, every input bit changes about half the output bits).
+ *
+ * @param seed - network seed
+ * @param slot - slot number
+ *
+ * @return hash
+ */
+static uint32_t chan_hop_hash(uint32_t seed, uint32_t slot)
+{
+    uint32_t x = seed ^ (slot * 0x9E3779B9UL);
+
+    x ^= x >> 16;
+    x *= 0x7FEB352DUL;
+    x ^= x >> 15;
+    x *= 0x846CA68BUL;
+    x ^= x >> 16;
+
+    return x;
+}
+
+int chan_hop_init(const chan_hop_config_t *cfg, dwt_config_t *config, dwt_txconfig_t *txconfig5,
+                  dwt_txconfig_t *txconfig9)
+{
+    if ((cfg->mask & CHAN_HOP_BOTH) == 0)
+    {
+        return DWT_ERROR;
+    }
+
+    chop.cfg = *cfg;
+    memset(&chop.stats, 0, sizeof(chop.stats));
+
+    return dwt_chanhop_init(&chop.hop, config, txconfig5, txconfig9);
+}
+
+uint8_t chan_hop_channel(uint32_t slot)
+{
+    switch (chop.cfg.mask & CHAN_HOP_BOTH)
+    {
+    case CHAN_HOP_CH5:
+        return 5;
+    case CHAN_HOP_CH9:
+        return 9;
+    default:
+        return (chan_hop_hash(chop.cfg.seed, slot) & 0x80000000UL) ? 9 : 5;
+    }
+}
+
+int chan_hop_goto(uint32_t slot)
+{
+    uint8_t chan = chan_hop_channel(slot);
+
+    chop.stats.slots[(chan == 9) ? 1 : 0]++;
+    if (chan == chop.hop.chan)
+    {
+        return DWT_SUCCESS;
+    }
+
+    if (dwt_chanhop_set(&chop.hop, chan) != DWT_SUCCESS)
+    {
+        chop.stats.errors++;
+        return DWT_ERROR;
+    }
+    chop.stats.hops++;
+
+    return DWT_SUCCESS;
+}
+
+int chan_hop_set_mask(uint8_t mask)
+{
+    if ((mask & CHAN_HOP_BOTH) == 0)
+    {
+        return DWT_ERROR;
+    }
+    chop.cfg.mask = mask;
+
+    return DWT_SUCCESS;
+}
+
+const chan_hop_stats_t * chan_hop_get_stats(void)
+{
+    return &chop.stats;
+}
@@ -0,0 +1,114 @@
+/*! ----------------------------------------------------------------------------
+ * @file    chan_hop.h
+ * @brief   Pseudo-random hopping between channel 5 and channel 9
+ *
+ *          All the nodes of a network share a seed and a slot number (TDMA
+ *          slot, beacon sequence number, superframe count...). The channel of
+ *          a slot is a hash of the seed and the slot number, so a node that
+ *          joins late or misses slots computes the same channel as the others
+ *          without any state. Networks with different seeds hop independently,
+ *          and share the air on about half of the slots only.
+ *
+ *          chan_hop_init() calibrates both channels once (dwt_chanhop_init()),
+ *          chan_hop_goto() retunes the device for a slot with dwt_chanhop_set()
+ *          when the slot is on the other channel. A channel can be taken out
+ *          of the schedule (chan_hop_set_mask()), e.g. while it is jammed: the
+ *          slots then all use the other one.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _CHAN_HOP_H_
+#define _CHAN_HOP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+/* Channels of the schedule */
+#define CHAN_HOP_CH5        0x01
+#define CHAN_HOP_CH9        0x02
+#define CHAN_HOP_BOTH       (CHAN_HOP_CH5 | CHAN_HOP_CH9)
+
+typedef struct
+{
+    uint32_t    seed;                       /* shared by all the nodes of the network */
+    uint8_t     mask;                       /* CHAN_HOP_CH5 and/or CHAN_HOP_CH9 */
+} chan_hop_config_t;
+
+typedef struct
+{
+    uint32_t    slots[2];                   /* slots on channel 5, channel 9 */
+    uint32_t    hops;                       /* retunes */
+    uint32_t    errors;                     /* failed retunes (PLL lock) */
+} chan_hop_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn chan_hop_init()
+ *
+ * @brief Calibrate both channels (dwt_chanhop_init(), see its conditions) and clear the counters. The device is left
+ *        on config->chan.
+ *
+ * @param cfg - schedule, copied
+ * @param config - configuration shared by both channels
+ * @param txconfig5 - TX spectrum configuration for channel 5
+ * @param txconfig9 - TX spectrum configuration for channel 9
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR for an empty mask or if the calibration failed
+ */
+int chan_hop_init(const chan_hop_config_t *cfg, dwt_config_t *config, dwt_txconfig_t *txconfig5,
+                  dwt_txconfig_t *txconfig9);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn chan_hop_channel()
+ *
+ * @brief Channel of a slot.
+ *
+ * @param slot - slot number
+ *
+ * @return 5 or 9
+ */
+uint8_t chan_hop_channel(uint32_t slot);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn chan_hop_goto()
+ *
+ * @brief Tune the device to the channel of a slot. The device should be in IDLE (e.g. after dwt_forcetrxoff()).
+ *
+ * @param slot - slot number
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the PLL did not lock (retried at the next call)
+ */
+int chan_hop_goto(uint32_t slot);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn chan_hop_set_mask()
+ *
+ * @brief Set the channels of the schedule, from the next chan_hop_goto(). All the nodes must use the same mask.
+ *
+ * @param mask - CHAN_HOP_CH5 and/or CHAN_HOP_CH9
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR for an empty mask
+ */
+int chan_hop_set_mask(uint8_t mask);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn chan_hop_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @return counters
+ */
+const chan_hop_stats_t * chan_hop_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CHAN_HOP_H_ */
@@ -0,0 +1,284 @@
+/*! ----------------------------------------------------------------------------
+ * @file    cir_stream.c
+ * @brief   CIR capture: chunked accumulator reads packed into a compact stream
+ *
+ *          See cir_stream.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <cir_stream.h>
+
+#define CIR_SAMPLE_LEN      6           /* 3 bytes real, 3 bytes imaginary, as read */
+#define CIR_BITS_PER_SAMPLE 36
+#define CIR_VAL_MASK        0x3FFFF     /* 18-bit value */
+#define CIR_ACC_SAMPLES     2048        /* accumulator memory, 12288 bytes */
+#define CIR_OUT_LEN         (CIR_STREAM_HDR_LEN + (CIR_STREAM_CHUNK * CIR_BITS_PER_SAMPLE + 7) / 8 + 1)
+
+typedef enum
+{
+    CIR_IDLE,
+    CIR_READ,           /* next chunk to read */
+    CIR_READ_WAIT,      /* asynchronous read in progress */
+    CIR_SEND            /* output pending */
+} cir_state_e;
+
+static struct
+{
+    cir_stream_config_t cfg;
+    cir_state_e     state;
+    uint16_t        next;               /* next sample to read */
+    uint16_t        end;                /* end of the window */
+    uint16_t        chunk;              /* samples in the chunk being read */
+    volatile uint8_t read_done;
+    volatile int8_t read_result;
+    uint64_t        bits;               /* bit accumulator of the packer */
+    uint8_t         nbits;
+    uint8_t         raw[CIR_STREAM_CHUNK * CIR_SAMPLE_LEN + 1];
+    uint8_t         out[CIR_OUT_LEN];
+    uint16_t        out_len;
+    uint16_t        out_pos;
+    cir_stream_stats_t stats;
+} cir;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_read_done()
+ *
+ * @brief Completion of the asynchronous accumulator read (interrupt context).
+ *
+ * @param result - transfer result
+ * @param arg - not used
+ *
+ * @return none
+ */
+static void cir_read_done(int result, void *arg)
+{
+    (void)arg;
+    cir.read_result = (result == 0) ? DWT_SUCCESS : DWT_ERROR;
+    cir.read_done = 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_put_bits()
+ *
+ * @brief Add bits to the output, whole bytes are moved to the output buffer.
+ *
+ * @param val - bits, LSB first
+ * @param n - number of bits, up to 32
+ *
+ * @return none
+ */
+static void cir_put_bits(uint32_t val, uint8_t n)
+{
+    cir.bits |= (uint64_t)val << cir.nbits;
+    cir.nbits += n;
+    while (cir.nbits >= 8)
+    {
+        cir.out[cir.out_len++] = (uint8_t)cir.bits;
+        cir.bits >>= 8;
+        cir.nbits -= 8;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_pack()
+ *
+ * @brief Pack the chunk just read (after the dummy octet), and the padding if it is the last one.
+ *
+ * @return none
+ */
+static void cir_pack(void)
+{
+    const uint8_t *p = &cir.raw[1];
+    uint16_t i;
+
+    for (i = 0; i < cir.chunk; i++, p += CIR_SAMPLE_LEN)
+    {
+        cir_put_bits(((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16) & CIR_VAL_MASK, 18);
+        cir_put_bits(((uint32_t)p[3] | (uint32_t)p[4] << 8 | (uint32_t)p[5] << 16) & CIR_VAL_MASK, 18);
+    }
+    cir.stats.samples += cir.chunk;
+    cir.next += cir.chunk;
+
+    if ((cir.next >= cir.end) && (cir.nbits != 0))
+    {
+        cir.out[cir.out_len++] = (uint8_t)cir.bits;
+        cir.bits = 0;
+        cir.nbits = 0;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_read()
+ *
+ * @brief Read (or start reading) the next chunk.
+ *
+ * @return DWT_SUCCESS or DWT_ERROR
+ */
+static int cir_read(void)
+{
+    uint16_t left = cir.end - cir.next;
+    uint16_t len;
+
+    cir.chunk = (left < CIR_STREAM_CHUNK) ? left : CIR_STREAM_CHUNK;
+    len = cir.chunk * CIR_SAMPLE_LEN + 1;
+
+    if (cir.cfg.async)
+    {
+        cir.read_done = 0;
+        if (dwt_readaccdata_async(cir.raw, len, cir.next, cir_read_done, NULL) != DWT_SUCCESS)
+        {
+            dwt_readaccdata_async_done();
+            return DWT_ERROR;
+        }
+        cir.state = CIR_READ_WAIT;
+        return DWT_SUCCESS;
+    }
+
+    dwt_readaccdata(cir.raw, len, cir.next);
+    cir_pack();
+    cir.state = CIR_SEND;
+    return DWT_SUCCESS;
+}
+
+int cir_stream_init(const cir_stream_config_t *cfg)
+{
+    if ((cfg == NULL) || (cfg->write == NULL) || (cfg->acc_len == 0) ||
+        ((uint32_t)cfg->acc_start + cfg->acc_len > CIR_ACC_SAMPLES))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&cir, 0, sizeof(cir));
+    cir.cfg = *cfg;
+    cir.state = CIR_IDLE;
+
+    return DWT_SUCCESS;
+}
+
+int cir_stream_start(uint16_t seq, uint16_t fp_index)
+{
+    uint16_t first = cir.cfg.acc_start;
+    uint16_t last = cir.cfg.acc_start + cir.cfg.acc_len;
+    uint16_t fp = cir.cfg.acc_start + (fp_index >> 6);
+    uint8_t flags = 0;
+
+    if (cir.state != CIR_IDLE)
+    {
+        cir.stats.busy++;
+        return DWT_ERROR;
+    }
+
+    if ((cir.cfg.pre != 0) || (cir.cfg.post != 0))
+    {
+        flags |= CIR_STREAM_FLAG_CROP;
+        first = (fp >= first + cir.cfg.pre) ? (fp - cir.cfg.pre) : first;
+        last = (fp + cir.cfg.post < last) ? (fp + cir.cfg.post) : last;
+        if (last <= first)
+        {
+            last = first + 1;
+        }
+    }
+
+    cir.next = first;
+    cir.end = last;
+    cir.bits = 0;
+    cir.nbits = 0;
+
+    cir.out[0] = 'C';
+    cir.out[1] = 'I';
+    cir.out[2] = CIR_STREAM_VERSION;
+    cir.out[3] = flags;
+    cir.out[4] = (uint8_t)seq;
+    cir.out[5] = (uint8_t)(seq >> 8);
+    cir.out[6] = (uint8_t)(first - cir.cfg.acc_start);
+    cir.out[7] = (uint8_t)((first - cir.cfg.acc_start) >> 8);
+    cir.out[8] = (uint8_t)(last - first);
+    cir.out[9] = (uint8_t)((last - first) >> 8);
+    cir.out[10] = (uint8_t)fp_index;
+    cir.out[11] = (uint8_t)(fp_index >> 8);
+    cir.out_len = CIR_STREAM_HDR_LEN;
+    cir.out_pos = 0;
+
+    /* The header goes out with the first chunk */
+    cir.state = CIR_READ;
+
+    return DWT_SUCCESS;
+}
+
+int cir_stream_poll(void)
+{
+    int n;
+
+    switch (cir.state)
+    {
+    case CIR_IDLE:
+        return 0;
+
+    case CIR_READ:
+        if (cir_read() != DWT_SUCCESS)
+        {
+            break;
+        }
+        return 1;
+
+    case CIR_READ_WAIT:
+        if (!cir.read_done)
+        {
+            return 1;
+        }
+        dwt_readaccdata_async_done();
+        if (cir.read_result != DWT_SUCCESS)
+        {
+            break;
+        }
+        cir_pack();
+        cir.state = CIR_SEND;
+        return 1;
+
+    case CIR_SEND:
+        n = cir.cfg.write(&cir.out[cir.out_pos], cir.out_len - cir.out_pos);
+        if (n < 0)
+        {
+            break;
+        }
+        cir.out_pos += (uint16_t)n;
+        cir.stats.bytes += (uint32_t)n;
+        if (cir.out_pos < cir.out_len)
+        {
+            cir.stats.stalls++;
+            return 1;
+        }
+
+        cir.out_len = 0;
+        cir.out_pos = 0;
+        if (cir.next < cir.end)
+        {
+            cir.state = CIR_READ;
+            return 1;
+        }
+        cir.stats.records++;
+        cir.state = CIR_IDLE;
+        return 0;
+    }
+
+    /* Read or transport error: the record is abandoned */
+    cir.stats.errors++;
+    cir.state = CIR_IDLE;
+    return 0;
+}
+
+int cir_stream_acc_free(void)
+{
+    return (cir.state == CIR_IDLE) || ((cir.state == CIR_SEND) && (cir.next >= cir.end));
+}
+
+const cir_stream_stats_t * cir_stream_get_stats(void)
+{
+    return &cir.stats;
+}
@@ -0,0 +1,132 @@
+/*! ----------------------------------------------------------------------------
+ * @file    cir_stream.h
+ * @brief   CIR capture: chunked accumulator reads packed into a compact stream
+ *
+ *          Reads the CIR (accumulator) of the frame just received in chunks
+ *          of CIR_STREAM_CHUNK samples, with dwt_readaccdata() or, with
+ *          CONFIG_SPI_ASYNC, dwt_readaccdata_async() so the SPI transfer
+ *          overlaps the packing and sending of the previous chunk, and packs
+ *          it into records written through a transport callback (RTT, UART):
+ *
+ *          header  'C' 'I' version flags seq(2) first(2) count(2) fp_index(2)
+ *          samples count x 36 bits: 18-bit I then 18-bit Q, little endian bit
+ *                  order, padded to a byte at the end of the record
+ *
+ *          The dummy octet of each accumulator read and the 6 unused bits of
+ *          each 24-bit value are dropped: 4.5 bytes per sample instead of 6.
+ *          first is the index of the first sample, fp_index the first path
+ *          index (10.6 fixed point, as ipatovFpIndex), so a window cropped
+ *          around the first path (CIR_STREAM_FLAG_CROP) is placed offline.
+ *
+ *          The transport callback takes what it can and returns how many
+ *          bytes it took: when it takes less (full RTT buffer, UART FIFO),
+ *          cir_stream_poll() keeps the rest and reads no further chunk until
+ *          it is sent. The accumulator is overwritten by the next reception:
+ *          do not enable the receiver before cir_stream_acc_free(), the end of
+ *          the record can still be streaming out then.
+ *
+ *          The functions are not reentrant: call them from one thread.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _CIR_STREAM_H_
+#define _CIR_STREAM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define CIR_STREAM_CHUNK        32          /* samples per accumulator read */
+#define CIR_STREAM_VERSION      1
+#define CIR_STREAM_HDR_LEN      12
+#define CIR_STREAM_FLAG_CROP    0x01        /* window around the first path, not the whole CIR */
+
+#define CIR_IPATOV_LEN_PRF64    1016        /* Ipatov CIR samples, 64 MHz PRF */
+#define CIR_IPATOV_LEN_PRF16    992         /* Ipatov CIR samples, 16 MHz PRF */
+
+/* Transport: take up to len bytes, return the number taken (0 if none fits now), negative on error */
+typedef int (*cir_stream_write_t)(const uint8_t *data, uint16_t len);
+
+typedef struct
+{
+    cir_stream_write_t write;
+    uint16_t    acc_start;          /* first accumulator sample of the CIR (0 for the Ipatov CIR) */
+    uint16_t    acc_len;            /* samples in the CIR, e.g. CIR_IPATOV_LEN_PRF64 */
+    uint16_t    pre;                /* crop: samples before the first path, pre = post = 0 for the whole CIR */
+    uint16_t    post;               /* crop: samples from the first path on */
+    uint8_t     async;              /* use dwt_readaccdata_async() (needs CONFIG_SPI_ASYNC) */
+} cir_stream_config_t;
+
+typedef struct
+{
+    uint32_t    records;            /* records completed */
+    uint32_t    samples;
+    uint32_t    bytes;              /* bytes taken by the transport */
+    uint32_t    stalls;             /* polls where the transport took less than offered */
+    uint32_t    busy;               /* cir_stream_start() refused, a record was in progress */
+    uint32_t    errors;             /* records abandoned (transport or read error) */
+} cir_stream_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_stream_init()
+ *
+ * @brief Set the configuration and clear the counters.
+ *
+ * @param cfg - configuration, copied
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR for a bad configuration
+ */
+int cir_stream_init(const cir_stream_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_stream_start()
+ *
+ * @brief Start the record of the CIR of the frame just received. Nothing is read yet, cir_stream_poll() does the work.
+ *
+ * @param seq - record sequence number (e.g. of the frame)
+ * @param fp_index - first path index, 10.6 fixed point (ipatovFpIndex of dwt_readdiagnostics_sel() DWT_DIAG_IP_FP)
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if a record is in progress
+ */
+int cir_stream_start(uint16_t seq, uint16_t fp_index);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_stream_poll()
+ *
+ * @brief Move the record on: send what is pending, and when all of it has been taken read and pack the next chunk
+ *        (or check the asynchronous read for completion).
+ *
+ * @return 1 while a record is in progress, 0 when idle
+ */
+int cir_stream_poll(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_stream_acc_free()
+ *
+ * @brief Tell if the accumulator is no longer needed: the whole window has been read.
+ *
+ * @return 1 if the receiver can be enabled again
+ */
+int cir_stream_acc_free(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_stream_get_stats()
+ *
+ * @brief Return the counters.
+ *
+ * @return counters
+ */
+const cir_stream_stats_t * cir_stream_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CIR_STREAM_H_ */
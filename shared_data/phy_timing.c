@@ -0,0 +1,281 @@
+/*! ----------------------------------------------------------------------------
+ * @file    phy_timing.c
+ * @brief   Per PHY profile timing tables: frame airtime, SHR durations and RX timeouts
+ *
+ *          See phy_timing.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <phy_timing.h>
+
+/* Durations in units of 10 ps, 1 UUS = 512 / 499.2 us */
+#define PHY_10PS_PER_UUS    102564
+#define PHY_SYM_PRF64       101763      /* preamble symbol, PRF 64 MHz (codes 9 to 24) */
+#define PHY_SYM_PRF16       99359       /* preamble symbol, PRF 16 MHz */
+#define PHY_BIT_6M8         12821       /* data bit at 6.8 Mb/s */
+#define PHY_BIT_850K        102564      /* data bit at 850 kb/s, and PHR bit at the standard rate */
+
+static const dwt_config_t phy_ref =
+{
+    .txPreambLength = DWT_PLEN_128, .txCode = 9, .sfdType = DWT_SFD_DW_8,
+    .dataRate = DWT_BR_6M8, .phrRate = DWT_PHRRATE_STD, .stsMode = DWT_STS_MODE_OFF,
+};
+
+static struct
+{
+    phy_timing_t    profiles[PHY_TIMING_PROFILES];
+    phy_timing_t    *cur;
+    phy_timing_t    none;                   /* current table before the first phy_timing_apply() */
+} phyt = { .cur = &phyt.none };
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_uus()
+ *
+ * @brief Convert a duration to UUS, rounded up.
+ *
+ * @param t - duration, in units of 10 ps
+ *
+ * @return duration, in UUS
+ */
+static uint32_t phy_uus(uint64_t t)
+{
+    return (uint32_t)((t + PHY_10PS_PER_UUS - 1) / PHY_10PS_PER_UUS);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_sym_10ps()
+ *
+ * @brief Return the preamble (SFD, STS) symbol duration of a configuration.
+ *
+ * @param config - device configuration
+ *
+ * @return duration, in units of 10 ps
+ */
+static uint32_t phy_sym_10ps(const dwt_config_t *config)
+{
+    return ((config->txCode >= 9) && (config->txCode <= 24)) ? PHY_SYM_PRF64 : PHY_SYM_PRF16;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_plen()
+ *
+ * @brief Return the preamble length of a configuration.
+ *
+ * @param config - device configuration
+ *
+ * @return preamble length, in symbols
+ */
+static uint32_t phy_plen(const dwt_config_t *config)
+{
+    static const uint16_t plen[16] =
+    {
+        /* indexed by DWT_PLEN_xxx */
+        [DWT_PLEN_32] = 32, [DWT_PLEN_64] = 64, [DWT_PLEN_72] = 72, [DWT_PLEN_128] = 128,
+        [DWT_PLEN_256] = 256, [DWT_PLEN_512] = 512, [DWT_PLEN_1024] = 1024, [DWT_PLEN_1536] = 1536,
+        [DWT_PLEN_2048] = 2048, [DWT_PLEN_4096] = 4096,
+    };
+
+    return plen[config->txPreambLength & 0xF];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_sts_syms()
+ *
+ * @brief Return the STS length of a configuration.
+ *
+ * @param config - device configuration
+ *
+ * @return STS length, in symbols, 0 when off
+ */
+static uint32_t phy_sts_syms(const dwt_config_t *config)
+{
+    if ((config->stsMode & DWT_STS_CONFIG_MASK) == DWT_STS_MODE_OFF)
+    {
+        return 0;
+    }
+
+    return 32U << config->stsLength;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_shr_10ps()
+ *
+ * @brief Return the SHR (preamble, SFD and STS) duration of a configuration.
+ *
+ * @param config - device configuration
+ *
+ * @return duration, in units of 10 ps
+ */
+static uint64_t phy_shr_10ps(const dwt_config_t *config)
+{
+    uint32_t syms = phy_plen(config) + ((config->sfdType == DWT_SFD_DW_16) ? DWT_SFD_LEN16 : DWT_SFD_LEN8) +
+                    phy_sts_syms(config);
+
+    return (uint64_t)syms * phy_sym_10ps(config);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_air_uus()
+ *
+ * @brief Compute the airtime of a frame.
+ *
+ * @param config - device configuration
+ * @param len - frame length, FCS included
+ *
+ * @return airtime, in UUS
+ */
+static uint32_t phy_air_uus(const dwt_config_t *config, uint16_t len)
+{
+    uint32_t bit = (config->dataRate == DWT_BR_6M8) ? PHY_BIT_6M8 : PHY_BIT_850K;
+    uint32_t phr_bit = (config->phrRate == DWT_PHRRATE_DTA) ? bit : PHY_BIT_850K;
+    uint32_t bits;
+    uint64_t t = phy_shr_10ps(config);
+
+    if ((config->stsMode & DWT_STS_CONFIG_MASK) != DWT_STS_MODE_ND)
+    {
+        /* PHR (19 bits + 2 SECDED bits), data with the Reed-Solomon parity (48 bits per 330 bits block) */
+        bits = len * 8;
+        bits += ((bits + 329) / 330) * 48;
+        t += 21 * phr_bit + (uint64_t)bits * bit;
+    }
+
+    return phy_uus(t);
+}
+
+int phy_timing_apply(uint8_t profile, const dwt_config_t *config)
+{
+    static const uint8_t pac[4] = { [DWT_PAC8] = 8, [DWT_PAC16] = 16, [DWT_PAC32] = 32, [DWT_PAC4] = 4 };
+    phy_timing_t *t;
+    uint32_t sym;
+    uint32_t air, ref;
+    uint16_t len;
+
+    if ((profile >= PHY_TIMING_PROFILES) || (config == NULL))
+    {
+        return DWT_ERROR;
+    }
+
+    t = &phyt.profiles[profile];
+    sym = phy_sym_10ps(config);
+
+    t->config = config;
+    t->preamble_uus = (uint16_t)phy_uus((uint64_t)phy_plen(config) * sym);
+    t->sfd_uus = (uint16_t)phy_uus((uint64_t)((config->sfdType == DWT_SFD_DW_16) ? DWT_SFD_LEN16 : DWT_SFD_LEN8) * sym);
+    t->sts_uus = (uint16_t)phy_uus((uint64_t)phy_sts_syms(config) * sym);
+    t->shr_uus = (uint16_t)phy_uus(phy_shr_10ps(config));
+    /* A preamble not detected within its own length will not be */
+    t->pto_pac = (uint16_t)((phy_plen(config) + pac[config->rxPAC & 3] - 1) / pac[config->rxPAC & 3] + 1);
+
+    for (len = 0; len <= PHY_TIMING_LEN_MAX; len++)
+    {
+        air = phy_air_uus(config, len);
+        ref = phy_air_uus(&phy_ref, len);
+        t->air_uus[len] = (uint16_t)air;
+        t->extra_uus[len] = (uint16_t)((air > ref) ? (air - ref) : 0);
+    }
+
+    phyt.cur = t;
+
+    return DWT_SUCCESS;
+}
+
+int phy_timing_select(uint8_t profile)
+{
+    if ((profile >= PHY_TIMING_PROFILES) || (phyt.profiles[profile].config == NULL))
+    {
+        return DWT_ERROR;
+    }
+
+    phyt.cur = &phyt.profiles[profile];
+
+    return DWT_SUCCESS;
+}
+
+const phy_timing_t * phy_timing_get(void)
+{
+    return phyt.cur;
+}
+
+uint32_t phy_timing_air_uus(uint16_t len)
+{
+    if (len <= PHY_TIMING_LEN_MAX)
+    {
+        return phyt.cur->air_uus[len];
+    }
+
+    return (phyt.cur->config != NULL) ? phy_air_uus(phyt.cur->config, len) : 0;
+}
+
+uint32_t phy_timing_extra_uus(uint16_t len)
+{
+    uint32_t air, ref;
+
+    if (len <= PHY_TIMING_LEN_MAX)
+    {
+        return phyt.cur->extra_uus[len];
+    }
+
+    if (phyt.cur->config == NULL)
+    {
+        return 0;
+    }
+    air = phy_air_uus(phyt.cur->config, len);
+    ref = phy_air_uus(&phy_ref, len);
+
+    return (air > ref) ? (air - ref) : 0;
+}
+
+uint32_t phy_timing_rx_dly_uus(uint32_t dly_uus)
+{
+    uint32_t dly = dly_uus + phyt.cur->sts_uus;
+
+    return (dly > phyt.cur->preamble_uus) ? (dly - phyt.cur->preamble_uus) : 0;
+}
+
+uint32_t phy_timing_rx_timeout_uus(uint32_t ref_uus, uint16_t len)
+{
+    uint32_t extra;
+
+    if (ref_uus == 0)
+    {
+        return phy_timing_air_uus(len) + 2 * PHY_TIMING_RX_GUARD_UUS;
+    }
+
+    /* Guard on the scaled timeouts until they are measured, see phy_timing.h */
+    extra = phy_timing_extra_uus(len);
+    if (extra != 0)
+    {
+        extra += PHY_TIMING_RX_MARGIN_UUS;
+    }
+
+    return ref_uus + extra;
+}
+
+uint32_t phy_timing_frame_uus(const dwt_config_t *config, uint16_t len)
+{
+    uint8_t i;
+
+    if (len <= PHY_TIMING_LEN_MAX)
+    {
+        for (i = 0; i < PHY_TIMING_PROFILES; i++)
+        {
+            if (phyt.profiles[i].config == config)
+            {
+                return phyt.profiles[i].air_uus[len];
+            }
+        }
+    }
+
+    return phy_air_uus(config, len);
+}
+
+uint32_t phy_timing_shr_uus(const dwt_config_t *config)
+{
+    return phy_uus(phy_shr_10ps(config));
+}
@@ -0,0 +1,184 @@
+/*! ----------------------------------------------------------------------------
+ * @file    phy_timing.h
+ * @brief   Per PHY profile timing tables: frame airtime, SHR durations and RX timeouts
+ *
+ *          The durations that depend on the PHY configuration (preamble
+ *          length and PRF, SFD, STS, data and PHR rates) are computed once,
+ *          when a profile is applied (phy_timing_apply(), right after
+ *          dwt_configure() or dwt_cfgimage_apply()), into a table:
+ *
+ *          - the preamble, SFD and STS durations, and the SHR (all three,
+ *            from the start of the frame to the RMARKER);
+ *          - the airtime of a frame for each length up to PHY_TIMING_LEN_MAX;
+ *          - the airtime over the reference profile, 6.8 Mb/s with a 128
+ *            symbol preamble, an 8 symbol SFD and no STS, for each length:
+ *            the delays and timeouts of the examples and engines are tuned
+ *            for the reference profile, and are lengthened by this much for
+ *            slower or longer profiles;
+ *          - the shortest preamble detection timeout that still covers the
+ *            preamble.
+ *
+ *          The table of the current profile (phy_timing_select()) is then
+ *          read without looking at the configuration again. Up to
+ *          PHY_TIMING_PROFILES profiles keep their table, numbered by the
+ *          application (e.g. as the profiles of rx_errors.h), so that
+ *          switching profile is a table switch. All durations are in UWB
+ *          microseconds (1 UUS = 512 / 499.2 us), rounded up.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _PHY_TIMING_H_
+#define _PHY_TIMING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#ifndef PHY_TIMING_PROFILES
+#define PHY_TIMING_PROFILES     4           /* profiles with a table */
+#endif
+#ifndef PHY_TIMING_LEN_MAX
+#define PHY_TIMING_LEN_MAX      127         /* longest frame of the tables, FCS included, longer ones are computed */
+#endif
+#ifndef PHY_TIMING_RX_GUARD_UUS
+#define PHY_TIMING_RX_GUARD_UUS 16          /* receiver on before the expected preamble, and kept on after the frame */
+#endif
+#ifndef PHY_TIMING_RX_MARGIN_UUS
+#define PHY_TIMING_RX_MARGIN_UUS 500        /* added to a reference timeout lengthened for a slower profile, see below */
+#endif
+
+typedef struct
+{
+    const dwt_config_t  *config;                    /* configuration the table was computed for, NULL for none */
+    uint16_t    preamble_uus;                       /* preamble */
+    uint16_t    sfd_uus;                            /* SFD */
+    uint16_t    sts_uus;                            /* STS, 0 when off */
+    uint16_t    shr_uus;                            /* preamble, SFD and STS */
+    uint16_t    pto_pac;                            /* shortest preamble detection timeout, in PACs */
+    uint16_t    air_uus[PHY_TIMING_LEN_MAX + 1];    /* frame airtime by frame length */
+    uint16_t    extra_uus[PHY_TIMING_LEN_MAX + 1];  /* airtime over the reference profile by frame length, 0 if shorter */
+} phy_timing_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_apply()
+ *
+ * @brief Compute the table of a profile and make it the current one. Call it when the profile is applied to the
+ *        device, and again if its configuration changes.
+ *
+ * @param profile - profile number, below PHY_TIMING_PROFILES
+ * @param config - configuration of the profile, kept by reference
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the profile number is out of range
+ */
+int phy_timing_apply(uint8_t profile, const dwt_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_select()
+ *
+ * @brief Make the table of a profile already applied the current one, e.g. after dwt_cfgimage_switch().
+ *
+ * @param profile - profile number
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the profile has no table
+ */
+int phy_timing_select(uint8_t profile);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_get()
+ *
+ * @brief Return the table of the current profile.
+ *
+ * @return table, all zero (config NULL) before the first phy_timing_apply()
+ */
+const phy_timing_t * phy_timing_get(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_air_uus()
+ *
+ * @brief Airtime of a frame in the current profile.
+ *
+ * @param len - frame length, FCS included
+ *
+ * @return airtime
+ */
+uint32_t phy_timing_air_uus(uint16_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_extra_uus()
+ *
+ * @brief Airtime of a frame in the current profile over its airtime in the reference profile: what to add to a reply
+ *        delay or an RX timeout tuned for the reference profile.
+ *
+ * @param len - frame length, FCS included
+ *
+ * @return extra airtime, 0 if the current profile is not slower
+ */
+uint32_t phy_timing_extra_uus(uint16_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_rx_dly_uus()
+ *
+ * @brief Delay from a TX RMARKER to turn the receiver on for the reply (e.g. dwt_setdelayedtrxtime() before
+ *        dwt_rxenable(DWT_START_RX_DLY_TS)), from a delay counted to the reply preamble as in the STS examples: one
+ *        preamble earlier, and the STS later, as the responder adds it to its reply delay with phy_timing_extra_uus().
+ *
+ * @param dly_uus - delay from the TX RMARKER
+ *
+ * @return delay to turn the receiver on
+ */
+uint32_t phy_timing_rx_dly_uus(uint32_t dly_uus);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_rx_timeout_uus()
+ *
+ * @brief RX timeout (dwt_setrxtimeout()) for a frame in the current profile: a timeout tuned for the reference profile
+ *        lengthened by the extra airtime of the frame. With no reference timeout, the shortest safe one for a
+ *        receiver turned on PHY_TIMING_RX_GUARD_UUS before the frame: the airtime and a guard on both sides.
+ *
+ *        When the frame is longer than in the reference profile, PHY_TIMING_RX_MARGIN_UUS is added as well, as the
+ *        former set_resp_rx_timeout() did: the lengthened timeouts have not been measured on hardware yet, and the
+ *        margin stays until they are. In the reference profile the tuned timeout is used as is.
+ *
+ * @param ref_uus - timeout tuned for the reference profile, 0 for the shortest safe one
+ * @param len - frame length, FCS included
+ *
+ * @return RX timeout
+ */
+uint32_t phy_timing_rx_timeout_uus(uint32_t ref_uus, uint16_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_frame_uus()
+ *
+ * @brief Airtime of a frame in any configuration: read from the table when the configuration is the one of a profile
+ *        applied, else computed.
+ *
+ * @param config - device configuration
+ * @param len - frame length, FCS included
+ *
+ * @return airtime
+ */
+uint32_t phy_timing_frame_uus(const dwt_config_t *config, uint16_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn phy_timing_shr_uus()
+ *
+ * @brief Duration of the preamble, SFD and STS in any configuration.
+ *
+ * @param config - device configuration
+ *
+ * @return duration
+ */
+uint32_t phy_timing_shr_uus(const dwt_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PHY_TIMING_H_ */
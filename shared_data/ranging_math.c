@@ -0,0 +1,88 @@
+/*! ----------------------------------------------------------------------------
+ * @file    ranging_math.c
+ * @brief   Fixed-point time of flight and distance computations
+ *
+ *          See ranging_math.h. All the intermediate values fit in 64 bits:
+ *          the DS-TWR products use the modulo 2^64 arithmetic of uint64_t,
+ *          their difference (time of flight times the sum) always fits.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <ranging_math.h>
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ranging_div_round()
+ *
+ * @brief Signed division rounded to the nearest integer.
+ *
+ * @param num - numerator
+ * @param den - denominator, > 0
+ *
+ * @return num / den, rounded
+ */
+static int64_t ranging_div_round(int64_t num, int64_t den)
+{
+    return (num >= 0) ? ((num + den / 2) / den) : -((-num + den / 2) / den);
+}
+
+int32_t ranging_clock_offset_q32(int16_t clock_offset)
+{
+    return (int32_t)clock_offset * (1 << 6);
+}
+
+int32_t ranging_carrier_q32(int32_t ci, uint8_t chan)
+{
+    int64_t mult = (chan == 9) ? RANGING_CI_RATIO_CH9_Q48 : RANGING_CI_RATIO_CH5_Q48;
+
+    /* A positive carrier integrator means the remote clock is slower (HERTZ_TO_PPM_MULTIPLIER_CHAN_x < 0) */
+    return (int32_t)-ranging_div_round((int64_t)ci * mult, (int64_t)1 << 16);
+}
+
+int32_t ranging_ss_tof(int32_t rtd_init, int32_t rtd_resp, int32_t ratio_q32)
+{
+    int64_t tof;
+
+    tof = ((int64_t)rtd_init - rtd_resp) * (1 << RANGING_TOF_FRAC_BITS);
+    tof += ranging_div_round((int64_t)rtd_resp * ratio_q32, (int64_t)1 << (32 - RANGING_TOF_FRAC_BITS));
+
+    return (int32_t)ranging_div_round(tof, 2);
+}
+
+int32_t ranging_ds_tof(uint32_t ra, uint32_t rb, uint32_t da, uint32_t db)
+{
+    int64_t num = (int64_t)((uint64_t)ra * rb - (uint64_t)da * db);
+    int64_t den = (int64_t)((uint64_t)ra + rb + da + db);
+
+    if (den == 0)
+    {
+        return 0;
+    }
+
+    return (int32_t)ranging_div_round(num * (1 << RANGING_TOF_FRAC_BITS), den);
+}
+
+int32_t ranging_tof_to_mm(int32_t tof)
+{
+    return (int32_t)ranging_div_round((int64_t)tof * RANGING_MM_PER_DTU_Q16, (int64_t)1 << (16 + RANGING_TOF_FRAC_BITS));
+}
+
+int32_t ranging_mm_to_tof(int32_t mm)
+{
+    return (int32_t)ranging_div_round((int64_t)mm << (16 + RANGING_TOF_FRAC_BITS), RANGING_MM_PER_DTU_Q16);
+}
+
+char * ranging_mm_to_str(int32_t mm, char *buf)
+{
+    uint32_t cm = (uint32_t)((mm < 0) ? -(int64_t)mm : mm);
+
+    cm = (cm + 5) / 10;
+    snprintf(buf, RANGING_MM_STR_LEN, "%s%lu.%02lu", (mm < 0) ? "-" : "", (unsigned long)(cm / 100),
+             (unsigned long)(cm % 100));
+
+    return buf;
+}
@@ -0,0 +1,131 @@
+/*! ----------------------------------------------------------------------------
+ * @file    ranging_math.h
+ * @brief   Fixed-point time of flight and distance computations
+ *
+ *          Integer versions of the SS-TWR and DS-TWR formulas of the ranging
+ *          examples, for hosts without a double precision FPU. The times of
+ *          flight are in 1/16 device time units (RANGING_TOF_FRAC_BITS), the
+ *          clock offset ratios in 2^-32 units and the distances in mm.
+ *
+ *          Against the float versions, the error is below 1 mm for the
+ *          distances and below 1/16 dtu for the times of flight (RTDs up to
+ *          33 ms and clock offsets up to 100 ppm).
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RANGING_MATH_H_
+#define _RANGING_MATH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define RANGING_TOF_FRAC_BITS       4
+
+/* Distance of one device time unit (SPEED_OF_LIGHT * DWT_TIME_UNITS), in mm, Q16 */
+#define RANGING_MM_PER_DTU_Q16      307387
+
+/* Carrier integrator to clock offset ratio (FREQ_OFFSET_MULTIPLIER / carrier frequency), Q48 */
+#define RANGING_CI_RATIO_CH5_Q48    161319
+#define RANGING_CI_RATIO_CH9_Q48    131072
+
+/* Buffer length for ranging_mm_to_str() */
+#define RANGING_MM_STR_LEN          16
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ranging_clock_offset_q32()
+ *
+ * @brief Convert the clock offset of the last received frame (dwt_readclockoffset(), 2^-26 units) to a ratio.
+ *
+ * @param clock_offset - dwt_readclockoffset() value, positive when the local clock is slower than the remote one
+ *
+ * @return clock offset ratio, in 2^-32 units
+ */
+int32_t ranging_clock_offset_q32(int16_t clock_offset);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ranging_carrier_q32()
+ *
+ * @brief Convert the carrier integrator of the last received frame (dwt_readcarrierintegrator()) to a clock offset
+ *        ratio, with the same sign convention as ranging_clock_offset_q32().
+ *
+ * @param ci - dwt_readcarrierintegrator() value
+ * @param chan - channel (5 or 9)
+ *
+ * @return clock offset ratio, in 2^-32 units
+ */
+int32_t ranging_carrier_q32(int32_t ci, uint8_t chan);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ranging_ss_tof()
+ *
+ * @brief SS-TWR time of flight, the responder turnaround corrected with the clock offset ratio:
+ *        (rtd_init - rtd_resp * (1 - ratio)) / 2.
+ *
+ * @param rtd_init - initiator round trip (response RX - poll TX), in dtu
+ * @param rtd_resp - responder turnaround (response TX - poll RX), in dtu
+ * @param ratio_q32 - clock offset ratio measured on the response, in 2^-32 units
+ *
+ * @return time of flight, in 1/16 dtu
+ */
+int32_t ranging_ss_tof(int32_t rtd_init, int32_t rtd_resp, int32_t ratio_q32);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ranging_ds_tof()
+ *
+ * @brief Asymmetric DS-TWR time of flight: (Ra * Rb - Da * Db) / (Ra + Rb + Da + Db). The clock offsets cancel out.
+ *
+ * @param ra - initiator round trip (response RX - poll TX), in dtu
+ * @param rb - responder round trip (final RX - response TX), in dtu
+ * @param da - initiator turnaround (final TX - response RX), in dtu
+ * @param db - responder turnaround (response TX - poll RX), in dtu
+ *
+ * @return time of flight, in 1/16 dtu
+ */
+int32_t ranging_ds_tof(uint32_t ra, uint32_t rb, uint32_t da, uint32_t db);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ranging_tof_to_mm()
+ *
+ * @brief Convert a time of flight to a distance.
+ *
+ * @param tof - time of flight, in 1/16 dtu
+ *
+ * @return distance, in mm
+ */
+int32_t ranging_tof_to_mm(int32_t tof);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ranging_mm_to_tof()
+ *
+ * @brief Convert a distance to a time of flight (inverse of ranging_tof_to_mm()).
+ *
+ * @param mm - distance, in mm
+ *
+ * @return time of flight, in 1/16 dtu
+ */
+int32_t ranging_mm_to_tof(int32_t mm);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ranging_mm_to_str()
+ *
+ * @brief Format a distance in metres with 2 decimals ("-1.23"), without floating point.
+ *
+ * @param mm - distance, in mm
+ * @param buf - output buffer, RANGING_MM_STR_LEN bytes
+ *
+ * @return buf
+ */
+char * ranging_mm_to_str(int32_t mm, char *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RANGING_MATH_H_ */
@@ -0,0 +1,448 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rf_test.c
+ * @brief   RF production test sequencer on the continuous wave and
+ *          continuous frame modes
+ *
+ *          See rf_test.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deca_device_api.h>
+#include <rf_test.h>
+
+#define RF_TEST_MAX_ARGS        12
+
+/* Frame sent in continuous frame mode: an 802.15.4e blink, as in ex_04b_cont_frame */
+static const uint8_t rf_test_frame[] = {0xC5, 0, 'D', 'E', 'C', 'A', 'W', 'A', 'V', 'E', 0, 0};
+
+static const char * const rf_test_mode_name[] = { "off", "cw", "frame" };
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_reply()
+ *
+ * @brief Format and write a reply line.
+ *
+ * @param t - sequencer
+ * @param fmt - printf format
+ *
+ * @return none
+ */
+static void rf_test_reply(rf_test_t *t, const char *fmt, ...)
+{
+    char line[RF_TEST_LINE_MAX];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    t->write(line);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_check()
+ *
+ * @brief Check a step.
+ *
+ * @param step - step
+ *
+ * @return DWT_SUCCESS or DWT_ERROR
+ */
+static int rf_test_check(const rf_test_step_t *step)
+{
+    if (step->mode == RF_TEST_OFF)
+    {
+        return DWT_SUCCESS;
+    }
+    if ((step->mode > RF_TEST_FRAME) || ((step->chan != 5) && (step->chan != 9)) || (step->pg_delay > 0x3F))
+    {
+        return DWT_ERROR;
+    }
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_parse_mode()
+ *
+ * @brief Parse a test mode name.
+ *
+ * @param s - "cw" or "frame"
+ *
+ * @return RF_TEST_CW, RF_TEST_FRAME, or RF_TEST_OFF if unknown
+ */
+static uint8_t rf_test_parse_mode(const char *s)
+{
+    if (strcmp(s, "cw") == 0)
+    {
+        return RF_TEST_CW;
+    }
+    if (strcmp(s, "frame") == 0)
+    {
+        return RF_TEST_FRAME;
+    }
+    return RF_TEST_OFF;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_sweep()
+ *
+ * @brief Append the steps of a power and PG delay sweep.
+ *
+ * @param t - sequencer
+ * @param base - mode, channel, dwell time and period of the steps
+ * @param pwr - first, last and step of the power byte
+ * @param pg - first, last and step of the PG delay
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the sequence is full (the steps that fit are added)
+ */
+static int rf_test_sweep(rf_test_t *t, rf_test_step_t *base, const uint32_t pwr[3], const uint32_t pg[3])
+{
+    uint32_t p, d;
+
+    if ((pwr[0] > pwr[1]) || (pwr[1] > 0xFF) || (pwr[2] == 0) || (pg[0] > pg[1]) || (pg[2] == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    for (p = pwr[0]; p <= pwr[1]; p += pwr[2])
+    {
+        for (d = pg[0]; d <= pg[1]; d += pg[2])
+        {
+            base->power = p * 0x01010101UL;
+            base->pg_delay = (uint8_t)d;
+            if (rf_test_add(t, base) != DWT_SUCCESS)
+            {
+                return DWT_ERROR;
+            }
+        }
+    }
+    return DWT_SUCCESS;
+}
+
+void rf_test_init(rf_test_t *t, const dwt_config_t *config, const dwt_txconfig_t *txconfig, rf_test_write_t write)
+{
+    memset(t, 0, sizeof(*t));
+    t->config = *config;
+    t->write = write;
+    t->cur.mode = RF_TEST_OFF;
+    t->cur.chan = config->chan;
+    t->cur.pg_delay = txconfig->PGdly;
+    t->cur.power = txconfig->power;
+}
+
+int rf_test_apply(rf_test_t *t, const rf_test_step_t *step)
+{
+    if (rf_test_check(step) != DWT_SUCCESS)
+    {
+        return DWT_ERROR;
+    }
+
+    if (t->cur.mode != RF_TEST_OFF)
+    {
+        dwt_disablecontinuousmode();
+        t->cur.mode = RF_TEST_OFF;
+    }
+    t->applied++;
+
+    if (step->mode != RF_TEST_OFF)
+    {
+        uint8_t txrf = 0;
+
+        if (step->chan != t->cur.chan)
+        {
+            /* PLL and RX calibration on the new channel, the TX power and PG delay are written again */
+            t->config.chan = step->chan;
+            t->configures++;
+            if (dwt_configure(&t->config) != DWT_SUCCESS)
+            {
+                rf_test_reply(t, "ERR configure ch %u", step->chan);
+                return DWT_ERROR;
+            }
+            t->cur.chan = step->chan;
+            txrf = 1;
+        }
+        if (txrf || (step->power != t->cur.power) || (step->pg_delay != t->cur.pg_delay))
+        {
+            dwt_txconfig_t txconfig = { step->pg_delay, step->power, 0 };
+
+            dwt_configuretxrf(&txconfig);
+            t->cur.power = step->power;
+            t->cur.pg_delay = step->pg_delay;
+            t->txrf++;
+        }
+
+        if (step->mode == RF_TEST_CW)
+        {
+            dwt_configcwmode(step->chan);
+        }
+        else
+        {
+            dwt_configcontinuousframemode(step->period, step->chan);
+            if (!t->frame_written)
+            {
+                dwt_writetxdata(sizeof(rf_test_frame), (uint8_t *)rf_test_frame, 0);
+                dwt_writetxfctrl(sizeof(rf_test_frame), 0, 0);
+                t->frame_written = 1;
+            }
+            dwt_starttx(DWT_START_TX_IMMEDIATE);
+        }
+        t->cur.mode = step->mode;
+        t->cur.period = step->period;
+    }
+
+    rf_test_reply(t, "STEP %u %s %u 0x%08lx 0x%02x %lu", t->index, rf_test_mode_name[t->cur.mode], t->cur.chan,
+                  (unsigned long)t->cur.power, t->cur.pg_delay, (unsigned long)t->cur.period);
+    return DWT_SUCCESS;
+}
+
+int rf_test_add(rf_test_t *t, const rf_test_step_t *step)
+{
+    if ((t->count >= RF_TEST_MAX_STEPS) || (step->mode == RF_TEST_OFF) || (rf_test_check(step) != DWT_SUCCESS))
+    {
+        return DWT_ERROR;
+    }
+    t->step[t->count++] = *step;
+    return DWT_SUCCESS;
+}
+
+int rf_test_run(rf_test_t *t, uint16_t loops, uint32_t now_ms)
+{
+    if (t->count == 0)
+    {
+        return DWT_ERROR;
+    }
+    t->running = 1;
+    t->loops = loops;
+    t->index = 0;
+    t->step_ms = now_ms;
+    if (rf_test_apply(t, &t->step[0]) != DWT_SUCCESS)
+    {
+        rf_test_stop(t);
+        return DWT_ERROR;
+    }
+    return DWT_SUCCESS;
+}
+
+int rf_test_next(rf_test_t *t, uint32_t now_ms)
+{
+    if (!t->running)
+    {
+        return DWT_ERROR;
+    }
+
+    if (++t->index >= t->count)
+    {
+        if (t->loops == 1)
+        {
+            rf_test_stop(t);
+            rf_test_reply(t, "DONE");
+            return DWT_SUCCESS;
+        }
+        if (t->loops != 0)
+        {
+            t->loops--;
+        }
+        t->index = 0;
+    }
+
+    t->step_ms = now_ms;
+    if (rf_test_apply(t, &t->step[t->index]) != DWT_SUCCESS)
+    {
+        rf_test_stop(t);
+        return DWT_ERROR;
+    }
+    return DWT_SUCCESS;
+}
+
+void rf_test_stop(rf_test_t *t)
+{
+    t->running = 0;
+    if (t->cur.mode != RF_TEST_OFF)
+    {
+        dwt_disablecontinuousmode();
+        t->cur.mode = RF_TEST_OFF;
+    }
+}
+
+void rf_test_poll(rf_test_t *t, uint32_t now_ms)
+{
+    uint32_t dwell;
+
+    if (!t->running)
+    {
+        return;
+    }
+    dwell = t->step[t->index].dwell_ms;
+    if ((dwell != 0) && ((uint32_t)(now_ms - t->step_ms) >= dwell))
+    {
+        rf_test_next(t, now_ms);
+    }
+}
+
+int rf_test_command(rf_test_t *t, const char *line, uint32_t now_ms)
+{
+    char buf[RF_TEST_LINE_MAX];
+    char *argv[RF_TEST_MAX_ARGS];
+    uint32_t num[RF_TEST_MAX_ARGS];
+    rf_test_step_t step;
+    int argc = 0;
+    int i;
+    char *p;
+
+    strncpy(buf, line, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    /* split on blanks, numbers parsed ahead (0 for a word) */
+    for (p = buf; (*p != '\0') && (argc < RF_TEST_MAX_ARGS); )
+    {
+        while ((*p == ' ') || (*p == '\t') || (*p == '\r'))
+        {
+            *p++ = '\0';
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+        argv[argc] = p;
+        num[argc] = strtoul(p, NULL, 0);
+        argc++;
+        while ((*p != '\0') && (*p != ' ') && (*p != '\t') && (*p != '\r'))
+        {
+            p++;
+        }
+    }
+    if (argc == 0)
+    {
+        return DWT_SUCCESS;
+    }
+
+    memset(&step, 0, sizeof(step));
+    step.period = RF_TEST_PERIOD_DEFAULT;
+
+    if ((strcmp(argv[0], "cw") == 0) && (argc == 4))
+    {
+        step.mode = RF_TEST_CW;
+    }
+    else if ((strcmp(argv[0], "frame") == 0) && (argc == 5))
+    {
+        step.mode = RF_TEST_FRAME;
+        step.period = num[4];
+    }
+    else if (strcmp(argv[0], "off") == 0)
+    {
+        rf_test_stop(t);
+        rf_test_reply(t, "OK");
+        return DWT_SUCCESS;
+    }
+    else if (strcmp(argv[0], "clear") == 0)
+    {
+        rf_test_stop(t);
+        t->count = 0;
+        rf_test_reply(t, "OK");
+        return DWT_SUCCESS;
+    }
+    else if ((strcmp(argv[0], "add") == 0) && ((argc == 6) || (argc == 7)))
+    {
+        step.mode = rf_test_parse_mode(argv[1]);
+        step.chan = (uint8_t)num[2];
+        step.power = num[3];
+        step.pg_delay = (uint8_t)num[4];
+        step.dwell_ms = num[5];
+        if (argc == 7)
+        {
+            step.period = num[6];
+        }
+        if (rf_test_add(t, &step) != DWT_SUCCESS)
+        {
+            rf_test_reply(t, "ERR step");
+            return DWT_ERROR;
+        }
+        rf_test_reply(t, "OK %u", t->count);
+        return DWT_SUCCESS;
+    }
+    else if ((strcmp(argv[0], "sweep") == 0) && ((argc == 10) || (argc == 11)))
+    {
+        step.mode = rf_test_parse_mode(argv[1]);
+        step.chan = (uint8_t)num[2];
+        step.dwell_ms = num[9];
+        if (argc == 11)
+        {
+            step.period = num[10];
+        }
+        if (rf_test_sweep(t, &step, &num[3], &num[6]) != DWT_SUCCESS)
+        {
+            rf_test_reply(t, "ERR sweep (%u steps)", t->count);
+            return DWT_ERROR;
+        }
+        rf_test_reply(t, "OK %u", t->count);
+        return DWT_SUCCESS;
+    }
+    else if (strcmp(argv[0], "run") == 0)
+    {
+        rf_test_reply(t, "OK");
+        if (rf_test_run(t, (argc > 1) ? (uint16_t)num[1] : 1, now_ms) != DWT_SUCCESS)
+        {
+            rf_test_reply(t, "ERR run");
+            return DWT_ERROR;
+        }
+        return DWT_SUCCESS;
+    }
+    else if (strcmp(argv[0], "next") == 0)
+    {
+        if (rf_test_next(t, now_ms) != DWT_SUCCESS)
+        {
+            rf_test_reply(t, "ERR next");
+            return DWT_ERROR;
+        }
+        return DWT_SUCCESS;
+    }
+    else if (strcmp(argv[0], "stop") == 0)
+    {
+        rf_test_stop(t);
+        rf_test_reply(t, "OK");
+        return DWT_SUCCESS;
+    }
+    else if (strcmp(argv[0], "list") == 0)
+    {
+        for (i = 0; i < t->count; i++)
+        {
+            rf_test_reply(t, "%u %s %u 0x%08lx 0x%02x %lu %lu", i, rf_test_mode_name[t->step[i].mode],
+                          t->step[i].chan, (unsigned long)t->step[i].power, t->step[i].pg_delay,
+                          (unsigned long)t->step[i].dwell_ms, (unsigned long)t->step[i].period);
+        }
+        rf_test_reply(t, "OK %u", t->count);
+        return DWT_SUCCESS;
+    }
+    else if (strcmp(argv[0], "status") == 0)
+    {
+        rf_test_reply(t, "OK %s %s step %u/%u loops %u configures %lu txrf %lu applied %lu",
+                      t->running ? "running" : "idle", rf_test_mode_name[t->cur.mode], t->index, t->count,
+                      t->loops, (unsigned long)t->configures, (unsigned long)t->txrf, (unsigned long)t->applied);
+        return DWT_SUCCESS;
+    }
+    else
+    {
+        rf_test_reply(t, "ERR command");
+        return DWT_ERROR;
+    }
+
+    /* cw / frame: a step run at once, out of the sequence */
+    step.chan = (uint8_t)num[1];
+    step.power = num[2];
+    step.pg_delay = (uint8_t)num[3];
+    t->running = 0;
+    if (rf_test_apply(t, &step) != DWT_SUCCESS)
+    {
+        rf_test_reply(t, "ERR step");
+        return DWT_ERROR;
+    }
+    rf_test_reply(t, "OK");
+    return DWT_SUCCESS;
+}
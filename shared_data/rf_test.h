@@ -0,0 +1,204 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rf_test.h
+ * @brief   RF production test sequencer on the continuous wave and
+ *          continuous frame modes
+ *
+ *          A sequence is a table of steps, each one a test mode (CW or
+ *          continuous frame), a channel, a TX power and PG delay, and a dwell
+ *          time. rf_test_poll() moves to the next step when the dwell time is
+ *          over (or on the "next" command for a dwell of 0, so the host paces
+ *          its instrument). Going from one step to the next only writes what
+ *          changes: the test mode is left with dwt_disablecontinuousmode()
+ *          instead of a reset, dwt_configure() runs only on a channel change
+ *          and dwt_configuretxrf() only on a power or PG delay change.
+ *
+ *          The host drives it with text lines, from any transport (RTT, UART),
+ *          passed to rf_test_command(). Replies and step events go through the
+ *          write callback, one line each:
+ *
+ *          cw <ch> <power> <pgdly>                 CW now (no sequence)
+ *          frame <ch> <power> <pgdly> <period>     continuous frame now
+ *          off                                     test mode off
+ *          clear                                   empty the sequence
+ *          add cw|frame <ch> <power> <pgdly> <dwell_ms> [period]
+ *          sweep cw|frame <ch> <pwr_first> <pwr_last> <pwr_step>
+ *                <pg_first> <pg_last> <pg_step> <dwell_ms> [period]
+ *                                                  add the steps of a sweep,
+ *                                                  power outer loop, the power
+ *                                                  byte in all 4 TX_POWER bytes
+ *          run [loops]                             start, 0: loop forever
+ *          next                                    next step now
+ *          stop                                    stop the sequence, mode off
+ *          list / status
+ *
+ *          Numbers are decimal or 0x hexadecimal, power is the TX_POWER
+ *          register, period the frame repetition rate (about 8 ns units, see
+ *          dwt_configcontinuousframemode()). Replies: "OK", "ERR <reason>",
+ *          "STEP <index> <mode> <ch> <power> <pgdly> <period>" when a step
+ *          starts and "DONE" at the end of the sequence.
+ *
+ *          The functions are not reentrant: call them from one thread.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RF_TEST_H_
+#define _RF_TEST_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define RF_TEST_MAX_STEPS       64
+#define RF_TEST_LINE_MAX        80          /* command and reply lines */
+#define RF_TEST_PERIOD_DEFAULT  124800      /* 1 ms */
+
+typedef enum
+{
+    RF_TEST_OFF = 0,
+    RF_TEST_CW,
+    RF_TEST_FRAME
+} rf_test_mode_e;
+
+typedef struct
+{
+    uint8_t     mode;                       /* rf_test_mode_e */
+    uint8_t     chan;                       /* 5 or 9 */
+    uint8_t     pg_delay;
+    uint32_t    power;                      /* TX_POWER register */
+    uint32_t    period;                     /* RF_TEST_FRAME: frame repetition rate */
+    uint32_t    dwell_ms;                   /* 0: until "next" */
+} rf_test_step_t;
+
+/* Reply transport: write one line (without end of line) */
+typedef void (*rf_test_write_t)(const char *line);
+
+typedef struct
+{
+    dwt_config_t    config;                 /* device configuration, the channel follows the steps */
+    rf_test_write_t write;
+    rf_test_step_t  step[RF_TEST_MAX_STEPS];
+    uint8_t         count;                  /* steps in the sequence */
+    uint8_t         index;                  /* current step */
+    uint8_t         running;
+    uint8_t         frame_written;          /* test frame in the TX buffer */
+    uint16_t        loops;                  /* runs left, 0: forever */
+    uint32_t        step_ms;                /* start of the current step */
+    rf_test_step_t  cur;                    /* what the device runs, mode RF_TEST_OFF if none */
+    uint32_t        configures;             /* dwt_configure() calls (channel changes) */
+    uint32_t        txrf;                   /* dwt_configuretxrf() calls */
+    uint32_t        applied;                /* steps applied */
+} rf_test_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_init()
+ *
+ * @brief Start the sequencer with an empty sequence. The device must be initialised and configured with config and
+ *        txconfig (dwt_configure(), dwt_configuretxrf()).
+ *
+ * @param t - sequencer
+ * @param config - device configuration
+ * @param txconfig - TX configuration in use
+ * @param write - reply transport
+ *
+ * @return none
+ */
+void rf_test_init(rf_test_t *t, const dwt_config_t *config, const dwt_txconfig_t *txconfig, rf_test_write_t write);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_apply()
+ *
+ * @brief Set the device to a step, writing only what changed from the current one, and report it ("STEP").
+ *
+ * @param t - sequencer
+ * @param step - step, RF_TEST_OFF to leave the test mode
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR for a bad channel or if dwt_configure() failed (test mode off then)
+ */
+int rf_test_apply(rf_test_t *t, const rf_test_step_t *step);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_add()
+ *
+ * @brief Append a step to the sequence.
+ *
+ * @param t - sequencer
+ * @param step - step
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the sequence is full or the step is bad
+ */
+int rf_test_add(rf_test_t *t, const rf_test_step_t *step);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_run()
+ *
+ * @brief Start the sequence from its first step.
+ *
+ * @param t - sequencer
+ * @param loops - runs of the sequence, 0 to loop until rf_test_stop()
+ * @param now_ms - current time
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the sequence is empty or the first step failed
+ */
+int rf_test_run(rf_test_t *t, uint16_t loops, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_next()
+ *
+ * @brief Go to the next step of the running sequence, or end it ("DONE").
+ *
+ * @param t - sequencer
+ * @param now_ms - current time
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if not running or the step failed
+ */
+int rf_test_next(rf_test_t *t, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_stop()
+ *
+ * @brief Stop the sequence and leave the test mode.
+ *
+ * @param t - sequencer
+ *
+ * @return none
+ */
+void rf_test_stop(rf_test_t *t);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_poll()
+ *
+ * @brief Move to the next step when the dwell time of the current one is over. Call periodically, at the dwell
+ *        time resolution wanted.
+ *
+ * @param t - sequencer
+ * @param now_ms - current time
+ *
+ * @return none
+ */
+void rf_test_poll(rf_test_t *t, uint32_t now_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rf_test_command()
+ *
+ * @brief Run a command line (see above) and write the reply.
+ *
+ * @param t - sequencer
+ * @param line - command, without end of line
+ * @param now_ms - current time
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR ("ERR" reply)
+ */
+int rf_test_command(rf_test_t *t, const char *line, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RF_TEST_H_ */
@@ -0,0 +1,302 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rx_errors.c
+ * @brief   RX error accounting by kind, peer and PHY profile
+ *
+ *          See rx_errors.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <rx_errors.h>
+
+/* Kinds of the frame error rate */
+#define RX_ERR_FRAME_KINDS  ((1UL << RX_ERR_PHE) | (1UL << RX_ERR_RSE) | (1UL << RX_ERR_CRC) | (1UL << RX_ERR_SFDTO) | \
+                             (1UL << RX_ERR_STS) | (1UL << RX_ERR_STS_QUAL))
+
+static struct
+{
+    rx_err_hist_t   hist[RX_ERR_CELLS + 1];     /* the overflow histogram last */
+    uint8_t         used;                       /* histograms in use, the overflow one excluded */
+    rx_err_hist_t   *cur;                       /* histogram of the context, NULL until something is counted */
+    uint16_t        peer;
+    uint8_t         profile;
+    rx_err_event_t  log[RX_ERR_LOG_LEN];
+    uint8_t         log_head;                   /* next log entry */
+    uint8_t         log_count;
+    rx_err_clock_t  clock_ms;
+} rxe;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_find()
+ *
+ * @brief Find the histogram of a (peer, profile) pair.
+ *
+ * @param peer - peer address
+ * @param profile - PHY profile
+ *
+ * @return histogram, or NULL
+ */
+static rx_err_hist_t * rx_err_find(uint16_t peer, uint8_t profile)
+{
+    uint8_t i;
+
+    for (i = 0; i < rxe.used; i++)
+    {
+        if ((rxe.hist[i].peer == peer) && (rxe.hist[i].profile == profile))
+        {
+            return &rxe.hist[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_cur()
+ *
+ * @brief Histogram of the context, taken on first use: a new one, or the overflow one when they are all in use.
+ *
+ * @return histogram
+ */
+static rx_err_hist_t * rx_err_cur(void)
+{
+    rx_err_hist_t *hist;
+
+    if (rxe.cur != NULL)
+    {
+        return rxe.cur;
+    }
+
+    hist = rx_err_find(rxe.peer, rxe.profile);
+    if (hist == NULL)
+    {
+        if (rxe.used < RX_ERR_CELLS)
+        {
+            hist = &rxe.hist[rxe.used++];
+            hist->peer = rxe.peer;
+            hist->profile = rxe.profile;
+        }
+        else
+        {
+            hist = &rxe.hist[RX_ERR_CELLS];
+        }
+    }
+    rxe.cur = hist;
+
+    return hist;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_count()
+ *
+ * @brief Count and log an error of the context.
+ *
+ * @param kind - error kind
+ *
+ * @return none
+ */
+static void rx_err_count(rx_err_kind_e kind)
+{
+    rx_err_hist_t *hist = rx_err_cur();
+    rx_err_event_t *ev = &rxe.log[rxe.log_head];
+
+    if (hist->count[kind] != UINT16_MAX)
+    {
+        hist->count[kind]++;
+    }
+
+    ev->time_ms = (rxe.clock_ms != NULL) ? rxe.clock_ms() : 0;
+    ev->peer = rxe.peer;
+    ev->profile = rxe.profile;
+    ev->kind = (uint8_t)kind;
+    rxe.log_head = (rxe.log_head + 1) % RX_ERR_LOG_LEN;
+    if (rxe.log_count < RX_ERR_LOG_LEN)
+    {
+        rxe.log_count++;
+    }
+}
+
+void rx_err_init(rx_err_clock_t clock_ms)
+{
+    memset(&rxe, 0, sizeof(rxe));
+    rxe.hist[RX_ERR_CELLS].peer = RX_ERR_PEER_ANY;
+    rxe.hist[RX_ERR_CELLS].profile = RX_ERR_PROFILE_ANY;
+    rxe.peer = RX_ERR_PEER_ANY;
+    rxe.clock_ms = clock_ms;
+}
+
+void rx_err_context(uint16_t peer, uint8_t profile)
+{
+    if ((peer != rxe.peer) || (profile != rxe.profile))
+    {
+        rxe.peer = peer;
+        rxe.profile = profile;
+        rxe.cur = NULL;
+    }
+}
+
+uint32_t rx_err_status(uint32_t status)
+{
+    uint32_t kinds = 0;
+    rx_err_hist_t *hist;
+    uint8_t k;
+
+    if (status & SYS_STATUS_RXPHE_BIT_MASK)
+    {
+        kinds |= 1UL << RX_ERR_PHE;
+    }
+    if (status & SYS_STATUS_RXFSL_BIT_MASK)
+    {
+        kinds |= 1UL << RX_ERR_RSE;
+    }
+    if (status & SYS_STATUS_RXFCE_BIT_MASK)
+    {
+        kinds |= 1UL << RX_ERR_CRC;
+    }
+    if (status & SYS_STATUS_RXSTO_BIT_MASK)
+    {
+        kinds |= 1UL << RX_ERR_SFDTO;
+    }
+    if (status & SYS_STATUS_RXPTO_BIT_MASK)
+    {
+        kinds |= 1UL << RX_ERR_PTO;
+    }
+    if (status & SYS_STATUS_RXFTO_BIT_MASK)
+    {
+        kinds |= 1UL << RX_ERR_RTO;
+    }
+    if (status & SYS_STATUS_ARFE_BIT_MASK)
+    {
+        kinds |= 1UL << RX_ERR_ARFE;
+    }
+    if (status & SYS_STATUS_CPERR_BIT_MASK)
+    {
+        kinds |= 1UL << RX_ERR_STS;
+    }
+
+    if (kinds == 0)
+    {
+        if (status & SYS_STATUS_RXFCG_BIT_MASK)
+        {
+            hist = rx_err_cur();
+            if (hist->good != UINT16_MAX)
+            {
+                hist->good++;
+            }
+        }
+        return 0;
+    }
+
+    for (k = 0; k < RX_ERR_KINDS; k++)
+    {
+        if (kinds & (1UL << k))
+        {
+            rx_err_count((rx_err_kind_e)k);
+        }
+    }
+
+    return kinds;
+}
+
+void rx_err_record(rx_err_kind_e kind)
+{
+    if (kind < RX_ERR_KINDS)
+    {
+        rx_err_count(kind);
+    }
+}
+
+void rx_err_sched_late(const dwt_sched_event_t *event)
+{
+    (void)event;
+
+    rx_err_count(RX_ERR_LATE_TX);
+}
+
+const rx_err_hist_t * rx_err_get(uint16_t peer, uint8_t profile)
+{
+    return rx_err_find(peer, profile);
+}
+
+const rx_err_hist_t * rx_err_get_all(uint8_t *count)
+{
+    uint8_t i;
+
+    /* The overflow histogram only when something went in it */
+    *count = rxe.used;
+    if (rxe.hist[RX_ERR_CELLS].good != 0)
+    {
+        *count = RX_ERR_CELLS + 1;
+    }
+    for (i = 0; i < RX_ERR_KINDS; i++)
+    {
+        if (rxe.hist[RX_ERR_CELLS].count[i] != 0)
+        {
+            *count = RX_ERR_CELLS + 1;
+        }
+    }
+
+    return rxe.hist;
+}
+
+uint16_t rx_err_per_permille(uint16_t peer, uint8_t profile)
+{
+    const rx_err_hist_t *hist = rx_err_find(peer, profile);
+    uint32_t errors = 0;
+    uint8_t k;
+
+    if (hist == NULL)
+    {
+        return 0;
+    }
+
+    for (k = 0; k < RX_ERR_KINDS; k++)
+    {
+        if (RX_ERR_FRAME_KINDS & (1UL << k))
+        {
+            errors += hist->count[k];
+        }
+    }
+
+    if ((errors + hist->good) == 0)
+    {
+        return 0;
+    }
+
+    return (uint16_t)((errors * 1000) / (errors + hist->good));
+}
+
+void rx_err_age(void)
+{
+    uint8_t i, k;
+
+    for (i = 0; i <= RX_ERR_CELLS; i++)
+    {
+        rxe.hist[i].good >>= 1;
+        for (k = 0; k < RX_ERR_KINDS; k++)
+        {
+            rxe.hist[i].count[k] >>= 1;
+        }
+    }
+}
+
+uint8_t rx_err_log(rx_err_event_t *events, uint8_t max)
+{
+    uint8_t n = (max < rxe.log_count) ? max : rxe.log_count;
+    uint8_t idx = rxe.log_head;
+    uint8_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        idx = (idx == 0) ? (RX_ERR_LOG_LEN - 1) : (idx - 1);
+        events[i] = rxe.log[idx];
+    }
+
+    return n;
+}
@@ -0,0 +1,220 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rx_errors.h
+ * @brief   RX error accounting by kind, peer and PHY profile
+ *
+ *          Sorts the outcome of each reception (SYS_STATUS, from a polling
+ *          loop or from cb_data->status in the dwt_isr() callbacks) and the
+ *          errors the application finds itself (STS quality, unexpected frame,
+ *          late TX) into kinds, and counts them in a histogram per peer and
+ *          PHY profile along with the good frames:
+ *
+ *          PHE        PHY header error (RXPHE)
+ *          RSE        Reed Solomon error, frame sync loss (RXFSL)
+ *          CRC        frame received with a bad CRC (RXFCE)
+ *          SFDTO      SFD timeout (RXSTO)
+ *          PTO        preamble detection timeout (RXPTO)
+ *          RTO        frame wait timeout (RXFTO)
+ *          ARFE       frame rejected by the frame filter
+ *          STS        STS / CP error (CPERR)
+ *          STS_QUAL   STS quality index too low (dwt_readstsquality(), sts_session_check())
+ *          BAD_FRAME  frame received, not the one expected
+ *          LATE_TX    delayed TX issued too late (dwt_starttx() error, dwt_sched_init() late event)
+ *
+ *          The peer and the profile are the ones of the exchange in progress,
+ *          set with rx_err_context() (a preamble timeout has no source
+ *          address). The profile is a number of the application's choosing,
+ *          e.g. an index in its table of PHY configurations. Histograms are
+ *          kept for RX_ERR_CELLS (peer, profile) pairs; the others share one
+ *          overflow histogram. Counters are 16 bits and saturate, and
+ *          rx_err_age() halves them all, so that called periodically the
+ *          histograms follow the recent link conditions: this is what
+ *          rx_err_per_permille() reports, to pick a more robust profile or a
+ *          longer reply delay when it degrades.
+ *
+ *          The last RX_ERR_LOG_LEN errors are also kept with their time
+ *          (rx_err_log()).
+ *
+ *          The functions can be called from the DW IC callbacks and read no
+ *          register.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RX_ERRORS_H_
+#define _RX_ERRORS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#ifndef RX_ERR_CELLS
+#define RX_ERR_CELLS            8           /* (peer, profile) histograms, plus the overflow one */
+#endif
+#ifndef RX_ERR_LOG_LEN
+#define RX_ERR_LOG_LEN          16          /* last errors kept with their time */
+#endif
+
+#define RX_ERR_PEER_ANY         0xFFFF      /* no peer (no exchange in progress), and the overflow histogram */
+#define RX_ERR_PROFILE_ANY      0xFF        /* overflow histogram */
+
+typedef enum
+{
+    RX_ERR_PHE = 0,
+    RX_ERR_RSE,
+    RX_ERR_CRC,
+    RX_ERR_SFDTO,
+    RX_ERR_PTO,
+    RX_ERR_RTO,
+    RX_ERR_ARFE,
+    RX_ERR_STS,
+    RX_ERR_STS_QUAL,
+    RX_ERR_BAD_FRAME,
+    RX_ERR_LATE_TX,
+    RX_ERR_KINDS
+} rx_err_kind_e;
+
+/* Histogram of a (peer, profile) pair */
+typedef struct
+{
+    uint16_t    peer;                       /* peer address, RX_ERR_PEER_ANY */
+    uint8_t     profile;                    /* PHY profile, RX_ERR_PROFILE_ANY for the overflow histogram */
+    uint16_t    good;                       /* frames received with a good CRC (and STS) */
+    uint16_t    count[RX_ERR_KINDS];        /* errors by kind */
+} rx_err_hist_t;
+
+/* Logged error */
+typedef struct
+{
+    uint32_t    time_ms;                    /* clock_ms() when counted */
+    uint16_t    peer;
+    uint8_t     profile;
+    uint8_t     kind;                       /* rx_err_kind_e */
+} rx_err_event_t;
+
+typedef uint32_t (*rx_err_clock_t)(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_init()
+ *
+ * @brief Clear the histograms and the log, and set the context to no peer, profile 0.
+ *
+ * @param clock_ms - time of the logged errors in ms (e.g. a wrapper of k_uptime_get_32()), may be NULL
+ *
+ * @return none
+ */
+void rx_err_init(rx_err_clock_t clock_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_context()
+ *
+ * @brief Set the peer and the profile the next outcomes are counted against, e.g. at the start of an exchange.
+ *
+ * @param peer - peer address, or RX_ERR_PEER_ANY
+ * @param profile - PHY profile
+ *
+ * @return none
+ */
+void rx_err_context(uint16_t peer, uint8_t profile);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_status()
+ *
+ * @brief Count the outcome of a reception from SYS_STATUS: a good frame, or its errors and timeouts. In the no data
+ *        STS mode (no RXFCG) a frame without error is not counted.
+ *
+ * @param status - SYS_STATUS (low 32 bits), read by the polling loop or cb_data->status in a callback
+ *
+ * @return bit mask of the kinds counted (1 << rx_err_kind_e), 0 for a good frame or no event
+ */
+uint32_t rx_err_status(uint32_t status);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_record()
+ *
+ * @brief Count an error found by the application.
+ *
+ * @param kind - error kind
+ *
+ * @return none
+ */
+void rx_err_record(rx_err_kind_e kind);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_sched_late()
+ *
+ * @brief Late event call-back of the driver schedule queue (dwt_sched_init()): counts a LATE_TX.
+ *
+ * @param event - event skipped
+ *
+ * @return none
+ */
+void rx_err_sched_late(const dwt_sched_event_t *event);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_get()
+ *
+ * @brief Return the histogram of a (peer, profile) pair.
+ *
+ * @param peer - peer address
+ * @param profile - PHY profile
+ *
+ * @return histogram, or NULL if the pair has none (counted in the overflow histogram, or nothing counted)
+ */
+const rx_err_hist_t * rx_err_get(uint16_t peer, uint8_t profile);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_get_all()
+ *
+ * @brief Return all the histograms, e.g. to send them to a host.
+ *
+ * @param count - set to the number of histograms in use, the overflow one last
+ *
+ * @return histograms
+ */
+const rx_err_hist_t * rx_err_get_all(uint8_t *count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_per_permille()
+ *
+ * @brief Frame error rate of a (peer, profile) pair: frames with a PHE, RSE, CRC, SFDTO, STS or STS_QUAL error
+ *        among those and the good frames (timeouts are not frames).
+ *
+ * @param peer - peer address
+ * @param profile - PHY profile
+ *
+ * @return rate per mille, 0 with no frame counted
+ */
+uint16_t rx_err_per_permille(uint16_t peer, uint8_t profile);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_age()
+ *
+ * @brief Halve all the counters, to weight the recent outcomes more.
+ *
+ * @return none
+ */
+void rx_err_age(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_log()
+ *
+ * @brief Copy the logged errors, newest first.
+ *
+ * @param events - where to copy them
+ * @param max - room in events
+ *
+ * @return number of events copied
+ */
+uint8_t rx_err_log(rx_err_event_t *events, uint8_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RX_ERRORS_H_ */
@@ -59,6 +59,36 @@ typedef enum
     AES_RES_ERROR_IGNORE_FRAME=-4
 }aes_results_e;
 
+/* View of a received frame (mac_frame_parse_802_15_4(), mac_frame_parse_802_15_8()): where its fields are, found in
+ * one pass over the header. Nothing is copied: the offsets index the parsed buffer, or the DW IC RX buffer for the
+ * bytes past the part read. A length of 0 means the field is absent. */
+typedef struct
+{
+    const uint8_t *frame;           /* parsed bytes (header at least) */
+    uint16_t    frame_len;          /* frame length, FCS included */
+    uint8_t     type;               /* frame type, frame control bits 0-2 */
+    uint8_t     version;            /* frame version, frame control bits 12-13 */
+    uint8_t     security;           /* security enabled */
+    uint8_t     ack_req;            /* ACK request */
+    int16_t     seq;                /* sequence number, -1 if suppressed */
+    uint16_t    dst_pan_off;
+    uint16_t    src_pan_off;        /* 0 if absent (offset 0 is the frame control) */
+    uint16_t    dst_addr_off;
+    uint8_t     dst_addr_len;
+    uint16_t    src_addr_off;
+    uint8_t     src_addr_len;
+    uint16_t    aux_off;            /* auxiliary security header (802.15.8: nonce part) */
+    uint8_t     aux_len;
+    uint8_t     sec_level;          /* security level, 802.15.4 */
+    uint16_t    frame_cnt_off;      /* frame counter, 0 if suppressed */
+    uint16_t    key_id_off;         /* key identifier: key source, then key index */
+    uint8_t     key_id_len;
+    uint8_t     mic_len;
+    uint16_t    hdr_len;            /* MHR up to the payload (header IEs included): the AES header length */
+    uint16_t    payload_off;
+    uint16_t    payload_len;        /* without MIC and FCS */
+}mac_frame_view_t;
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,212 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sniff_sched.c
+ * @brief   Adaptive SNIFF mode duty cycle
+ *
+ *          See sniff_sched.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <deca_device_api.h>
+#include <sniff_sched.h>
+
+#define SNIFF_SYMBOL_PS     1017600     /* preamble symbol, 64 MHz PRF */
+#define SNIFF_OFF_UNIT_PS   1024000     /* SNIFF OFF time unit, 128/125 us */
+#define SNIFF_OFF_MAX       255
+#define SNIFF_CNT12_MASK    0xFFF       /* 12-bit event counters */
+
+static struct
+{
+    sniff_sched_config_t    cfg;
+    dwt_deviceentcnts_t     prev;
+    uint8_t                 quiet;      /* quiet windows in a row */
+    sniff_sched_stats_t     stats;
+} sniff;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_apply()
+ *
+ * @brief Program the current level.
+ *
+ * @return none
+ */
+static void sniff_apply(void)
+{
+    uint8_t level = sniff.stats.level;
+
+    if (level == sniff.cfg.levels - 1)
+    {
+        dwt_setsniffmode(0, 0, 0);
+    }
+    else
+    {
+        dwt_setsniffmode(1, sniff.cfg.on_pacs, sniff.stats.off[level]);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_set_top()
+ *
+ * @brief Find the highest level within the budget and drop to it if above.
+ *
+ * @return 1 if the level changed, 0 if not
+ */
+static int sniff_set_top(void)
+{
+    uint8_t top = 0;
+    uint8_t i;
+
+    for (i = 1; i < sniff.cfg.levels; i++)
+    {
+        if (sniff.stats.duty[i] <= sniff.cfg.budget_permille)
+        {
+            top = i;
+        }
+    }
+    sniff.stats.top = top;
+
+    if (sniff.stats.level > top)
+    {
+        sniff.stats.level = top;
+        sniff.stats.changes++;
+        sniff_apply();
+        return 1;
+    }
+    return 0;
+}
+
+int sniff_sched_init(const sniff_sched_config_t *cfg)
+{
+    uint32_t on_ps, max_off, off_ps;
+    uint8_t i, n;
+
+    if ((cfg == NULL) || (cfg->levels < 2) || (cfg->levels > SNIFF_SCHED_MAX_LEVELS) ||
+        (cfg->on_pacs == 0) || (cfg->on_pacs > 15) || (cfg->pac_symbols == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    /* The IC adds one PAC to the ON time. A preamble must always contain a whole ON window: OFF + 2 ON <= preamble */
+    on_ps = (uint32_t)(cfg->on_pacs + 1) * cfg->pac_symbols * SNIFF_SYMBOL_PS / 1000;
+    if ((uint32_t)cfg->preamble_symbols * (SNIFF_SYMBOL_PS / 1000) <= 2 * on_ps)
+    {
+        return DWT_ERROR;
+    }
+    max_off = ((uint32_t)cfg->preamble_symbols * (SNIFF_SYMBOL_PS / 1000) - 2 * on_ps) / (SNIFF_OFF_UNIT_PS / 1000);
+    if (max_off > SNIFF_OFF_MAX)
+    {
+        max_off = SNIFF_OFF_MAX;
+    }
+    if (max_off == 0)
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&sniff, 0, sizeof(sniff));
+    sniff.cfg = *cfg;
+
+    /* SNIFF levels from max_off down to max_off / n, then full RX */
+    n = cfg->levels - 1;
+    for (i = 0; i < n; i++)
+    {
+        sniff.stats.off[i] = (uint8_t)((max_off * (n - i) + n - 1) / n);
+        off_ps = (uint32_t)sniff.stats.off[i] * (SNIFF_OFF_UNIT_PS / 1000);
+        sniff.stats.duty[i] = (uint16_t)(on_ps * 1000 / (on_ps + off_ps));
+    }
+    sniff.stats.off[n] = 0;
+    sniff.stats.duty[n] = 1000;
+
+    sniff.stats.level = 0;
+    sniff_set_top();
+    sniff_apply();
+
+    dwt_configeventcounters(1);
+    memset(&sniff.prev, 0, sizeof(sniff.prev));
+
+    return DWT_SUCCESS;
+}
+
+void sniff_sched_set_budget(uint16_t budget_permille)
+{
+    sniff.cfg.budget_permille = budget_permille;
+    sniff_set_top();
+}
+
+int sniff_sched_update(uint32_t elapsed_ms)
+{
+    dwt_deviceentcnts_t cnt;
+    uint32_t frames, late, fps;
+    uint8_t level = sniff.stats.level;
+
+    dwt_readeventcounters(&cnt);
+
+    /* The counters wrap, only the difference to the previous read is used */
+    frames = ((cnt.CRCG - sniff.prev.CRCG) & SNIFF_CNT12_MASK) + ((cnt.CRCB - sniff.prev.CRCB) & SNIFF_CNT12_MASK) +
+             ((cnt.PHE - sniff.prev.PHE) & SNIFF_CNT12_MASK) + ((cnt.RSL - sniff.prev.RSL) & SNIFF_CNT12_MASK);
+    late = ((cnt.SFDTO - sniff.prev.SFDTO) & SNIFF_CNT12_MASK) + ((cnt.RSL - sniff.prev.RSL) & SNIFF_CNT12_MASK);
+    sniff.prev = cnt;
+
+    sniff.stats.frames += frames;
+    sniff.stats.late += late;
+    sniff.stats.time_ms[level] += elapsed_ms;
+
+    fps = (elapsed_ms != 0) ? (frames * 1000 / elapsed_ms) : 0;
+
+    if ((fps > sniff.cfg.up_fps) ||
+        ((late != 0) && (late * 1000 >= (uint32_t)sniff.cfg.miss_permille * (frames + late))))
+    {
+        sniff.quiet = 0;
+        if (level < sniff.stats.top)
+        {
+            level++;
+        }
+    }
+    else if (fps < sniff.cfg.down_fps)
+    {
+        if (++sniff.quiet >= sniff.cfg.hold)
+        {
+            sniff.quiet = 0;
+            if (level > 0)
+            {
+                level--;
+            }
+        }
+    }
+    else
+    {
+        sniff.quiet = 0;
+    }
+
+    if (level == sniff.stats.level)
+    {
+        return 0;
+    }
+
+    sniff.stats.level = level;
+    sniff.stats.changes++;
+    sniff_apply();
+    return 1;
+}
+
+uint16_t sniff_sched_avg_duty(void)
+{
+    uint64_t sum = 0;
+    uint64_t total = 0;
+    uint8_t i;
+
+    for (i = 0; i < sniff.cfg.levels; i++)
+    {
+        sum += (uint64_t)sniff.stats.time_ms[i] * sniff.stats.duty[i];
+        total += sniff.stats.time_ms[i];
+    }
+    return (total != 0) ? (uint16_t)(sum / total) : sniff.stats.duty[sniff.stats.level];
+}
+
+const sniff_sched_stats_t * sniff_sched_get_stats(void)
+{
+    return &sniff.stats;
+}
@@ -0,0 +1,124 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sniff_sched.h
+ * @brief   Adaptive SNIFF mode duty cycle
+ *
+ *          Moves the receiver along a ladder of SNIFF settings, from the
+ *          longest OFF time a preamble of the senders still overlaps (lowest
+ *          current) to full RX, by the traffic seen in the DW IC event
+ *          counters:
+ *
+ *          - frames received per second (CRCG + CRCB + PHE + RSL) above
+ *            up_fps, or too many late preamble detections (SFD timeouts and
+ *            sync losses, the cost of a long OFF time) move one step up
+ *          - fewer than down_fps frames per second for hold windows in a row
+ *            move one step down
+ *
+ *          The application sets the budget, the highest average RX duty
+ *          allowed (per mille, 1000 allows full RX): levels above it are never
+ *          used, however busy the channel. sniff_sched_update() is called
+ *          periodically (e.g. every 100 ms) with the time elapsed. A new level
+ *          is set with dwt_setsniffmode() and is used from the next
+ *          dwt_rxenable().
+ *
+ *          The module enables and owns the event counters: do not clear them
+ *          elsewhere while it runs.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _SNIFF_SCHED_H_
+#define _SNIFF_SCHED_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <deca_device_api.h>
+
+#define SNIFF_SCHED_MAX_LEVELS  8           /* including full RX */
+
+typedef struct
+{
+    uint8_t     pac_symbols;                /* PAC size of the configuration: 4, 8, 16 or 32 */
+    uint16_t    preamble_symbols;           /* preamble length of the senders (e.g. 128) */
+    uint8_t     on_pacs;                    /* SNIFF ON time, dwt_setsniffmode() timeOn (1 to 15) */
+    uint8_t     levels;                     /* ladder length, 2 to SNIFF_SCHED_MAX_LEVELS, the top one is full RX */
+    uint16_t    budget_permille;            /* highest average RX duty allowed */
+    uint16_t    up_fps;                     /* frames per second above which the duty goes up */
+    uint16_t    down_fps;                   /* frames per second below which the duty goes down */
+    uint16_t    miss_permille;              /* late detections per mille of detected preambles to go up */
+    uint8_t     hold;                       /* quiet windows before going down */
+} sniff_sched_config_t;
+
+typedef struct
+{
+    uint8_t     off[SNIFF_SCHED_MAX_LEVELS];        /* OFF time of each level (dwt_setsniffmode() timeOff) */
+    uint16_t    duty[SNIFF_SCHED_MAX_LEVELS];       /* RX duty of each level, per mille */
+    uint32_t    time_ms[SNIFF_SCHED_MAX_LEVELS];    /* time spent at each level */
+    uint32_t    frames;                             /* frames seen */
+    uint32_t    late;                               /* late preamble detections seen */
+    uint32_t    changes;                            /* level changes */
+    uint8_t     level;                              /* current level */
+    uint8_t     top;                                /* highest level the budget allows */
+} sniff_sched_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_sched_init()
+ *
+ * @brief Build the ladder, clear and enable the event counters and start at the lowest level.
+ *
+ * @param cfg - configuration, copied
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR for a bad configuration (e.g. a preamble too short for SNIFF mode)
+ */
+int sniff_sched_init(const sniff_sched_config_t *cfg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_sched_set_budget()
+ *
+ * @brief Change the RX duty budget. The level drops at once if it is now above the budget.
+ *
+ * @param budget_permille - highest average RX duty allowed, per mille
+ *
+ * @return none
+ */
+void sniff_sched_set_budget(uint16_t budget_permille);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_sched_update()
+ *
+ * @brief Read the event counters and move one level up or down if the traffic of the window asks for it.
+ *
+ * @param elapsed_ms - time since the previous call (or sniff_sched_init())
+ *
+ * @return 1 if the level changed, 0 if not
+ */
+int sniff_sched_update(uint32_t elapsed_ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_sched_avg_duty()
+ *
+ * @brief Average RX duty since sniff_sched_init(), weighted by the time spent at each level.
+ *
+ * @return duty, per mille
+ */
+uint16_t sniff_sched_avg_duty(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_sched_get_stats()
+ *
+ * @brief Return the ladder and the counters.
+ *
+ * @return counters
+ */
+const sniff_sched_stats_t * sniff_sched_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SNIFF_SCHED_H_ */
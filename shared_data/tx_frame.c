@@ -0,0 +1,105 @@
+/*! ----------------------------------------------------------------------------
+ * @file    tx_frame.c
+ * @brief   Frame composed in place in the DW IC TX buffer, with partial updates
+ *
+ *          See tx_frame.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <deca_device_api.h>
+#include <tx_frame.h>
+
+void tx_frame_init(tx_frame_t *frame, uint8_t *data, uint16_t len, uint16_t offset)
+{
+    frame->data = data;
+    frame->len = len;
+    frame->offset = offset;
+    tx_frame_invalidate(frame);
+}
+
+void tx_frame_mark(tx_frame_t *frame, uint16_t idx, uint16_t len)
+{
+    uint16_t start = idx;
+    uint16_t end = idx + len;
+    uint8_t i = 0;
+
+    if (end > frame->len)
+    {
+        end = frame->len;
+    }
+    if (start >= end)
+    {
+        return;
+    }
+
+    /* Absorb the ranges overlapping or close to the new one */
+    while (i < frame->count)
+    {
+        tx_frame_range_t *r = &frame->range[i];
+
+        if ((r->start <= end + TX_FRAME_MERGE_GAP) && (start <= r->end + TX_FRAME_MERGE_GAP))
+        {
+            start = (r->start < start) ? r->start : start;
+            end = (r->end > end) ? r->end : end;
+            *r = frame->range[--frame->count];
+            i = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    /* No room: one range over all of them */
+    if (frame->count == TX_FRAME_MAX_RANGES)
+    {
+        for (i = 0; i < frame->count; i++)
+        {
+            start = (frame->range[i].start < start) ? frame->range[i].start : start;
+            end = (frame->range[i].end > end) ? frame->range[i].end : end;
+        }
+        frame->count = 0;
+    }
+
+    frame->range[frame->count].start = start;
+    frame->range[frame->count].end = end;
+    frame->count++;
+}
+
+void tx_frame_set_u8(tx_frame_t *frame, uint16_t idx, uint8_t val)
+{
+    if (frame->data[idx] != val)
+    {
+        frame->data[idx] = val;
+        tx_frame_mark(frame, idx, 1);
+    }
+}
+
+void tx_frame_invalidate(tx_frame_t *frame)
+{
+    frame->range[0].start = 0;
+    frame->range[0].end = frame->len;
+    frame->count = 1;
+}
+
+int tx_frame_commit(tx_frame_t *frame)
+{
+    uint8_t i;
+
+    for (i = 0; i < frame->count; i++)
+    {
+        tx_frame_range_t *r = &frame->range[i];
+
+        if (dwt_writetxdata(r->end - r->start, &frame->data[r->start], frame->offset + r->start) != DWT_SUCCESS)
+        {
+            return DWT_ERROR;
+        }
+    }
+    frame->count = 0;
+
+    return DWT_SUCCESS;
+}
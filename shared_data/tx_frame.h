@@ -0,0 +1,120 @@
+/*! ----------------------------------------------------------------------------
+ * @file    tx_frame.h
+ * @brief   Frame composed in place in the DW IC TX buffer, with partial updates
+ *
+ *          A tx_frame_t is a host copy of a frame kept at a fixed offset of
+ *          the TX buffer. The first tx_frame_commit() writes the whole frame,
+ *          the following ones only the byte ranges changed since (sequence
+ *          number, timestamps, ...), each through the txBufferOffset of
+ *          dwt_writetxdata(). E.g. a DS-TWR final is 13 bytes (sequence
+ *          number and three timestamps) on the critical path, not 22.
+ *
+ *          Ranges closer than TX_FRAME_MERGE_GAP bytes are written as one, a
+ *          short gap costing less than the header of another SPI transaction.
+ *
+ *          Frames sharing the TX buffer must each have their own offset: a
+ *          frame written over another one (or the TX buffer lost in sleep, or
+ *          replaced by an AES job) needs tx_frame_invalidate(). Offsets up to
+ *          127 are written directly, above that each write goes through the
+ *          indirect pointer and costs two more register writes.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _TX_FRAME_H_
+#define _TX_FRAME_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define TX_FRAME_MAX_RANGES     4       /* dirty ranges tracked, more are merged into one */
+#define TX_FRAME_MERGE_GAP      3       /* ranges this close are written as one */
+
+typedef struct
+{
+    uint16_t    start;
+    uint16_t    end;                    /* first byte after the range */
+} tx_frame_range_t;
+
+typedef struct
+{
+    uint8_t     *data;                  /* host copy of the frame (without FCS) */
+    uint16_t    len;
+    uint16_t    offset;                 /* offset of the frame in the TX buffer */
+    uint8_t     count;                  /* dirty ranges */
+    tx_frame_range_t range[TX_FRAME_MAX_RANGES];
+} tx_frame_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_frame_init()
+ *
+ * @brief Attach a frame to its place in the TX buffer. The whole frame is dirty.
+ *
+ * @param frame - frame
+ * @param data - host copy of the frame, kept (not copied)
+ * @param len - frame length, without FCS
+ * @param offset - offset in the TX buffer
+ *
+ * @return none
+ */
+void tx_frame_init(tx_frame_t *frame, uint8_t *data, uint16_t len, uint16_t offset);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_frame_mark()
+ *
+ * @brief Mark bytes of the host copy as changed, e.g. after final_msg_set_ts().
+ *
+ * @param frame - frame
+ * @param idx - first byte
+ * @param len - number of bytes
+ *
+ * @return none
+ */
+void tx_frame_mark(tx_frame_t *frame, uint16_t idx, uint16_t len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_frame_set_u8()
+ *
+ * @brief Set a byte of the frame, marking it only if it changes.
+ *
+ * @param frame - frame
+ * @param idx - byte index
+ * @param val - value
+ *
+ * @return none
+ */
+void tx_frame_set_u8(tx_frame_t *frame, uint16_t idx, uint8_t val);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_frame_invalidate()
+ *
+ * @brief Mark the whole frame as changed, when the TX buffer does not hold it anymore.
+ *
+ * @param frame - frame
+ *
+ * @return none
+ */
+void tx_frame_invalidate(tx_frame_t *frame);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_frame_commit()
+ *
+ * @brief Write the changed ranges of the frame to the TX buffer.
+ *
+ * @param frame - frame
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the frame does not fit the TX buffer
+ */
+int tx_frame_commit(tx_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TX_FRAME_H_ */
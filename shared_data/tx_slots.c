@@ -0,0 +1,81 @@
+/*! ----------------------------------------------------------------------------
+ * @file    tx_slots.c
+ * @brief   Frames pre-staged in slots of the DW IC TX buffer
+ *
+ *          See tx_slots.h.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <deca_device_api.h>
+#include <deca_vals.h>
+#include <tx_slots.h>
+
+int tx_slots_init(tx_slots_t *slots, uint16_t offset, uint16_t size)
+{
+    if ((uint32_t)offset + size > TX_BUFFER_MAX_LEN)
+    {
+        return DWT_ERROR;
+    }
+
+    slots->count = 0;
+    slots->next = offset;
+    slots->end = offset + size;
+
+    return DWT_SUCCESS;
+}
+
+int tx_slots_add(tx_slots_t *slots, uint8_t *data, uint16_t len, uint8_t ranging)
+{
+    uint8_t slot = slots->count;
+
+    /* Room for the FCS too, it is not written but the next slot must not start before the end of the frame */
+    if ((slot == TX_SLOTS_MAX) || ((uint32_t)slots->next + len + FCS_LEN > slots->end))
+    {
+        return DWT_ERROR;
+    }
+
+    tx_frame_init(&slots->frame[slot], data, len, slots->next);
+    slots->ranging[slot] = ranging;
+    slots->next += len + FCS_LEN;
+    slots->count++;
+
+    return slot;
+}
+
+tx_frame_t * tx_slots_frame(tx_slots_t *slots, uint8_t slot)
+{
+    return &slots->frame[slot];
+}
+
+int tx_slots_stage(tx_slots_t *slots)
+{
+    uint8_t i;
+
+    for (i = 0; i < slots->count; i++)
+    {
+        if (tx_frame_commit(&slots->frame[i]) != DWT_SUCCESS)
+        {
+            return DWT_ERROR;
+        }
+    }
+
+    return DWT_SUCCESS;
+}
+
+int tx_slots_send(tx_slots_t *slots, uint8_t slot, uint8_t mode)
+{
+    tx_frame_t *frame = &slots->frame[slot];
+
+    if ((slot >= slots->count) || (tx_frame_commit(frame) != DWT_SUCCESS))
+    {
+        return DWT_ERROR;
+    }
+
+    dwt_writetxfctrl(frame->len + FCS_LEN, frame->offset, slots->ranging[slot]);
+
+    return dwt_starttx(mode);
+}
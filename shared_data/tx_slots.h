@@ -0,0 +1,113 @@
+/*! ----------------------------------------------------------------------------
+ * @file    tx_slots.h
+ * @brief   Frames pre-staged in slots of the DW IC TX buffer
+ *
+ *          The TX buffer (TX_BUFFER_MAX_LEN bytes) holds several frames. A
+ *          tx_slots_t lays frames out back to back in a region of it, each
+ *          one a tx_frame_t (tx_frame.h), and writes them ahead of time with
+ *          tx_slots_stage(). Sending a staged frame is then only
+ *          dwt_writetxfctrl() with its offset and dwt_starttx(): e.g. a
+ *          response and the alternative replies to the same request, or a
+ *          queue of beacons fired back to back with delayed TX times.
+ *
+ *          A frame changed after staging (tx_frame_set_u8()/tx_frame_mark() on
+ *          tx_slots_frame()) has its changed bytes written by tx_slots_send(),
+ *          or earlier by tx_slots_stage(). Slots within the first 128 bytes
+ *          are written directly, the others through the indirect pointer.
+ *
+ * @attention
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _TX_SLOTS_H_
+#define _TX_SLOTS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <tx_frame.h>
+
+#define TX_SLOTS_MAX            8
+
+typedef struct
+{
+    tx_frame_t  frame[TX_SLOTS_MAX];
+    uint8_t     ranging[TX_SLOTS_MAX];  /* ranging bit of each frame */
+    uint8_t     count;
+    uint16_t    next;                   /* TX buffer offset of the next slot */
+    uint16_t    end;                    /* end of the region */
+} tx_slots_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_slots_init()
+ *
+ * @brief Start an empty set of slots in a region of the TX buffer.
+ *
+ * @param slots - slots
+ * @param offset - start of the region in the TX buffer
+ * @param size - size of the region
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the region is not in the TX buffer
+ */
+int tx_slots_init(tx_slots_t *slots, uint16_t offset, uint16_t size);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_slots_add()
+ *
+ * @brief Add a frame in the next slot. The frame is written by the next tx_slots_stage() or tx_slots_send().
+ *
+ * @param slots - slots
+ * @param data - frame, without FCS, kept (not copied)
+ * @param len - frame length, without FCS
+ * @param ranging - ranging bit of the frame
+ *
+ * @return slot number, or DWT_ERROR if there is no room left
+ */
+int tx_slots_add(tx_slots_t *slots, uint8_t *data, uint16_t len, uint8_t ranging);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_slots_frame()
+ *
+ * @brief Return the frame of a slot, to update it with tx_frame_set_u8()/tx_frame_mark().
+ *
+ * @param slots - slots
+ * @param slot - slot number
+ *
+ * @return frame
+ */
+tx_frame_t * tx_slots_frame(tx_slots_t *slots, uint8_t slot);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_slots_stage()
+ *
+ * @brief Write the changed bytes of all the frames, off the critical path.
+ *
+ * @param slots - slots
+ *
+ * @return DWT_SUCCESS or DWT_ERROR
+ */
+int tx_slots_stage(tx_slots_t *slots);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_slots_send()
+ *
+ * @brief Send the frame of a slot: its changed bytes if any, the frame control, then dwt_starttx(). A delayed mode
+ *        uses the time set with dwt_setdelayedtrxtime().
+ *
+ * @param slots - slots
+ * @param slot - slot number
+ * @param mode - dwt_starttx() mode
+ *
+ * @return dwt_starttx() result
+ */
+int tx_slots_send(tx_slots_t *slots, uint8_t slot, uint8_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TX_SLOTS_H_ */
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Decode the binary result log of platform/dw_binlog.c.
+
+Reads the byte stream of the log transport (e.g. the file written by
+JLinkRTTLogger for the RTT up channel, or a UART capture) and prints one line
+per record, converting the raw values. Records lost on the target (full ring
+or transport error) show as gaps in the sequence numbers and are counted.
+
+    record  0xA5 type seq(2) time_ms(4) payload, little endian
+
+usage: binlog_decode.py [--csv] [--prf16] [file]    (stdin without file)
+"""
+
+import argparse
+import math
+import struct
+import sys
+
+SYNC = 0xA5
+HDR = struct.Struct('<BBHI')
+
+DTU_S = 1.0 / (499.2e6 * 128.0)         # device time unit
+A_PRF64_DB = 121.7
+A_PRF16_DB = 113.8
+
+RANGE = 1
+DIAG = 2
+TIMING = 3
+POSITION = 6
+
+POSITION_STATUS = {0: 'ok', 1: 'few_ranges', 2: 'singular', 3: 'no_convergence', 4: 'bad_fit'}
+
+PAYLOAD = {
+    RANGE: struct.Struct('<Hhii'),                       # peer, clock_offset, dist_mm, tof (1/16 DTU)
+    DIAG: struct.Struct('<HHIIIII'),                    # fp_index, accum_count, peak, power, f1, f2, f3
+    TIMING: struct.Struct('<HHI'),                      # id, arg, us
+    POSITION: struct.Struct('<HBBiiiH'),                # tag, status, used, x_mm, y_mm, z_mm, rms_mm
+}
+
+
+def rx_levels(accum, power, f1, f2, f3, a_db):
+    """First path and RX levels in dBm, as ranging/rx_quality.c."""
+    f2sum = f1 * f1 + f2 * f2 + f3 * f3
+    if accum == 0 or power == 0 or f2sum == 0:
+        return None, None
+    n2 = 20.0 * math.log10(accum)
+    fp = 10.0 * math.log10(f2sum / 16.0) - n2 - a_db
+    rx = 10.0 * math.log10(power * 2.0 ** 21) - n2 - a_db
+    return fp, rx
+
+
+def position_fields(tag, status, used, x_mm, y_mm, z_mm, rms_mm):
+    """ranging/multilat.h fix."""
+    return [('tag', '0x%04X' % tag), ('status', POSITION_STATUS.get(status, status)), ('used', used),
+            ('x_m', '%.3f' % (x_mm / 1000.0)), ('y_m', '%.3f' % (y_mm / 1000.0)),
+            ('z_m', '%.3f' % (z_mm / 1000.0)), ('rms_mm', rms_mm)]
+
+
+def decode(rec_type, payload, a_db):
+    if rec_type == RANGE:
+        peer, offset, dist_mm, tof = payload
+        return 'range', [('peer', '0x%04X' % peer), ('dist_m', '%.3f' % (dist_mm / 1000.0)),
+                         ('tof_ps', '%.1f' % (tof / 16.0 * DTU_S * 1e12)),
+                         ('clock_offset_ppm', '%.3f' % (offset * 1e6 / 2.0 ** 26))]
+    if rec_type == DIAG:
+        fp_index, accum, peak, power, f1, f2, f3 = payload
+        fp, rx = rx_levels(accum, power, f1, f2, f3, a_db)
+        return 'diag', [('fp_index', '%.2f' % (fp_index / 64.0)), ('accum', accum),
+                        ('peak_index', (peak >> 21) & 0x3FF), ('peak_amp', peak & 0x1FFFFF),
+                        ('fp_dbm', '-' if fp is None else '%.1f' % fp),
+                        ('rx_dbm', '-' if rx is None else '%.1f' % rx)]
+    if rec_type == TIMING:
+        tid, arg, us = payload
+        return 'timing', [('id', tid), ('arg', arg), ('us', us)]
+    if rec_type == POSITION:
+        return 'position', position_fields(*payload)
+    return None, None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the dw_binlog record stream')
+    parser.add_argument('file', nargs='?', help='capture file (stdin when omitted)')
+    parser.add_argument('--csv', action='store_true', help='comma separated values, one record type per line')
+    parser.add_argument('--prf16', action='store_true', help='16 MHz PRF (RX level constant)')
+    args = parser.parse_args()
+
+    data = open(args.file, 'rb').read() if args.file else sys.stdin.buffer.read()
+    a_db = A_PRF16_DB if args.prf16 else A_PRF64_DB
+
+    pos = 0
+    records = lost = skipped = 0
+    expected = None
+    while pos + HDR.size <= len(data):
+        sync, rec_type, seq, time_ms = HDR.unpack_from(data, pos)
+        fmt = PAYLOAD.get(rec_type)
+        if sync != SYNC or fmt is None or pos + HDR.size + fmt.size > len(data):
+            # not on a record boundary (capture started mid-record, or corrupted): resynchronise
+            pos += 1
+            skipped += 1
+            continue
+
+        payload = fmt.unpack_from(data, pos + HDR.size)
+        pos += HDR.size + fmt.size
+        records += 1
+        if expected is not None:
+            lost += (seq - expected) & 0xFFFF
+        expected = (seq + 1) & 0xFFFF
+
+        name, fields = decode(rec_type, payload, a_db)
+        if args.csv:
+            print(','.join([name, str(seq), str(time_ms)] + [str(v) for _, v in fields]))
+        else:
+            print('%10u %5u %-6s %s' % (time_ms, seq, name, ' '.join('%s=%s' % f for f in fields)))
+
+    print('%u records, %u lost, %u bytes skipped' % (records, lost, skipped), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
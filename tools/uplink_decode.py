@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""Decode the gateway uplink of platform/dw_uplink.c.
+
+Reads the byte stream from a serial port (--port, needs pyserial) or a
+capture file, splits it into frames on the 0x00 delimiter, COBS decodes them,
+checks the CRC and prints one line per record. Frames with a bad CRC are
+counted and skipped, batches lost between the anchor and the host show as
+gaps in the batch sequence numbers, records dropped on the anchor (full
+batch) are reported by the anchor in each batch.
+
+    batch   version count src(2) seq(2) dropped(2) time_ms(4) records crc(2)
+    record  type len payload(len)
+
+usage: uplink_decode.py [--csv] [--port DEV [--baud N]] [file]
+"""
+
+import argparse
+import struct
+import sys
+
+VERSION = 1
+HDR = struct.Struct('<BBHHHI')
+
+DTU_S = 1.0 / (499.2e6 * 128.0)
+
+POSITION_STATUS = {0: 'ok', 1: 'few_ranges', 2: 'singular', 3: 'no_convergence', 4: 'bad_fit'}
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def record_fields(rec_type, payload):
+    if rec_type == 1 and len(payload) == 12:
+        peer, offset, dist_mm, tof = struct.unpack('<Hhii', payload)
+        return 'range', [('peer', '0x%04X' % peer), ('dist_m', '%.3f' % (dist_mm / 1000.0)),
+                         ('tof_ps', '%.1f' % (tof / 16.0 * DTU_S * 1e12)),
+                         ('clock_offset_ppm', '%.3f' % (offset * 1e6 / 2.0 ** 26))]
+    if rec_type == 2 and len(payload) == 24:
+        fp_index, accum, peak, power, f1, f2, f3 = struct.unpack('<HHIIIII', payload)
+        return 'diag', [('fp_index', '%.2f' % (fp_index / 64.0)), ('accum', accum),
+                        ('peak_index', (peak >> 21) & 0x3FF), ('peak_amp', peak & 0x1FFFFF),
+                        ('power', power), ('f1', f1), ('f2', f2), ('f3', f3)]
+    if rec_type == 3 and len(payload) == 8:
+        tid, arg, us = struct.unpack('<HHI', payload)
+        return 'timing', [('id', tid), ('arg', arg), ('us', us)]
+    if rec_type == 4 and len(payload) == 17:
+        anchor, tag, blink_seq, sync_seq = struct.unpack_from('<HQBB', payload)
+        toa = int.from_bytes(payload[12:17], 'little')
+        return 'tdoa', [('anchor', '0x%04X' % anchor), ('tag', '%016X' % tag), ('blink_seq', blink_seq),
+                        ('sync_seq', sync_seq), ('toa_dtu', toa), ('toa_s', '%.12f' % (toa * DTU_S))]
+    if rec_type == 5:
+        return 'cir', [('bytes', len(payload)), ('data', payload.hex())]
+    if rec_type == 6 and len(payload) == 18:
+        tag, status, used, x_mm, y_mm, z_mm, rms_mm = struct.unpack('<HBBiiiH', payload)
+        return 'position', [('tag', '0x%04X' % tag), ('status', POSITION_STATUS.get(status, status)), ('used', used),
+                            ('x_m', '%.3f' % (x_mm / 1000.0)), ('y_m', '%.3f' % (y_mm / 1000.0)),
+                            ('z_m', '%.3f' % (z_mm / 1000.0)), ('rms_mm', rms_mm)]
+    if rec_type == 7 and len(payload) >= 6:
+        rx_ts = int.from_bytes(payload[0:5], 'little')
+        return 'frame', [('rx_dtu', rx_ts), ('flags', '0x%02X' % payload[5]), ('len', len(payload) - 6),
+                         ('data', payload[6:].hex())]
+    return 'type%u' % rec_type, [('data', payload.hex())]
+
+
+class Decoder:
+    def __init__(self, csv):
+        self.csv = csv
+        self.next_seq = {}
+        self.frames = self.bad = self.lost = self.dropped = self.records = 0
+
+    def frame(self, raw):
+        batch = cobs_decode(raw)
+        if batch is None or len(batch) < HDR.size + 2 or crc16(batch[:-2]) != struct.unpack('<H', batch[-2:])[0]:
+            self.bad += 1
+            return
+        version, count, src, seq, dropped, time_ms = HDR.unpack_from(batch)
+        if version != VERSION:
+            self.bad += 1
+            return
+        self.frames += 1
+        self.dropped += dropped
+        if src in self.next_seq:
+            self.lost += (seq - self.next_seq[src]) & 0xFFFF
+        self.next_seq[src] = (seq + 1) & 0xFFFF
+
+        pos = HDR.size
+        end = len(batch) - 2
+        for _ in range(count):
+            if pos + 2 > end:
+                break
+            rec_type, rec_len = batch[pos], batch[pos + 1]
+            payload = batch[pos + 2:pos + 2 + rec_len]
+            pos += 2 + rec_len
+            self.records += 1
+            name, fields = record_fields(rec_type, payload)
+            if self.csv:
+                print(','.join(['%04X' % src, str(seq), str(time_ms), name] + [str(v) for _, v in fields]))
+            else:
+                print('%04X %5u %10u %-6s %s' % (src, seq, time_ms, name, ' '.join('%s=%s' % f for f in fields)))
+
+    def feed(self, data, pending):
+        pending += data
+        while True:
+            end = pending.find(b'\x00')
+            if end < 0:
+                return pending
+            if end > 0:
+                self.frame(bytes(pending[:end]))
+            del pending[:end + 1]
+
+    def summary(self):
+        print('%u batches, %u records, %u bad frames, %u batches lost, %u records dropped by the anchors'
+              % (self.frames, self.records, self.bad, self.lost, self.dropped), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the dw_uplink frames')
+    parser.add_argument('file', nargs='?', help='capture file (stdin when omitted and no port)')
+    parser.add_argument('--port', help='serial port, e.g. /dev/ttyACM0')
+    parser.add_argument('--baud', type=int, default=1000000)
+    parser.add_argument('--csv', action='store_true', help='comma separated values')
+    args = parser.parse_args()
+
+    dec = Decoder(args.csv)
+    pending = bytearray()
+    try:
+        if args.port:
+            import serial
+            port = serial.Serial(args.port, args.baud, rtscts=True, timeout=0.1)
+            port.dtr = True
+            while True:
+                pending = dec.feed(port.read(4096), pending)
+        else:
+            stream = open(args.file, 'rb') if args.file else sys.stdin.buffer
+            while True:
+                data = stream.read(4096)
+                if not data:
+                    break
+                pending = dec.feed(data, pending)
+    except KeyboardInterrupt:
+        pass
+    dec.summary()
+
+
+if __name__ == '__main__':
+    main()